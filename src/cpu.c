@@ -111,6 +111,10 @@
 #include <sys/protosw.h>
 #endif /* HAVE_PERFSTAT */
 
+#if KERNEL_LINUX
+#include "utils_procfs.h"
+#endif
+
 #if !PROCESSOR_CPU_LOAD_INFO && !KERNEL_LINUX && !HAVE_LIBKSTAT &&             \
     !CAN_USE_SYSCTL && !HAVE_SYSCTLBYNAME && !HAVE_LIBSTATGRAB &&              \
     !HAVE_PERFSTAT
@@ -128,7 +132,7 @@ static mach_msg_type_number_t cpu_list_len;
 /* #endif PROCESSOR_CPU_LOAD_INFO */
 
 #elif defined(KERNEL_LINUX)
-/* no variables needed */
+static procfs_file_t *proc_stat;
 /* #endif KERNEL_LINUX */
 
 #elif defined(HAVE_LIBKSTAT)
@@ -629,26 +633,37 @@ static int cpu_read(void) {
 
 #elif defined(KERNEL_LINUX) /* {{{ */
   int cpu;
-  FILE *fh;
-  char buf[1024];
+  char *line;
+  ssize_t status;
 
   char *fields[9];
   int numfields;
 
-  if ((fh = fopen("/proc/stat", "r")) == NULL) {
+  if (proc_stat == NULL) {
+    proc_stat = procfs_open("/proc/stat");
+    if (proc_stat == NULL) {
+      char errbuf[1024];
+      ERROR("cpu plugin: open (/proc/stat) failed: %s",
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      return -1;
+    }
+  }
+
+  status = procfs_read(proc_stat);
+  if (status < 0) {
     char errbuf[1024];
-    ERROR("cpu plugin: fopen (/proc/stat) failed: %s",
-          sstrerror(errno, errbuf, sizeof(errbuf)));
+    ERROR("cpu plugin: reading /proc/stat failed: %s",
+          sstrerror((int)-status, errbuf, sizeof(errbuf)));
     return -1;
   }
 
-  while (fgets(buf, 1024, fh) != NULL) {
-    if (strncmp(buf, "cpu", 3))
+  while ((line = procfs_getline(proc_stat)) != NULL) {
+    if (strncmp(line, "cpu", 3))
       continue;
-    if ((buf[3] < '0') || (buf[3] > '9'))
+    if ((line[3] < '0') || (line[3] > '9'))
       continue;
 
-    numfields = strsplit(buf, fields, 9);
+    numfields = strsplit(line, fields, 9);
     if (numfields < 5)
       continue;
 
@@ -671,7 +686,6 @@ static int cpu_read(void) {
                   now);
     }
   }
-  fclose(fh);
 /* }}} #endif defined(KERNEL_LINUX) */
 
 #elif defined(HAVE_LIBKSTAT) /* {{{ */
@@ -857,8 +871,19 @@ static int cpu_read(void) {
   return 0;
 }
 
+#if KERNEL_LINUX
+static int cpu_shutdown(void) {
+  procfs_close(proc_stat);
+  proc_stat = NULL;
+  return 0;
+} /* int cpu_shutdown */
+#endif
+
 void module_register(void) {
   plugin_register_init("cpu", init);
   plugin_register_config("cpu", cpu_config, config_keys, config_keys_num);
   plugin_register_read("cpu", cpu_read);
+#if KERNEL_LINUX
+  plugin_register_shutdown("cpu", cpu_shutdown);
+#endif
 } /* void module_register */
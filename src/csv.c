@@ -25,18 +25,68 @@
 
 #include "common.h"
 #include "plugin.h"
+#include "utils_avltree.h"
 #include "utils_cache.h"
 
+#ifndef CSV_DEFAULT_MAX_OPEN_FILES
+#define CSV_DEFAULT_MAX_OPEN_FILES 128
+#endif
+
+#ifndef CSV_DEFAULT_FLUSH_INTERVAL
+#define CSV_DEFAULT_FLUSH_INTERVAL TIME_T_TO_CDTIME_T(10)
+#endif
+
+/* Files which have not been written to for this long are closed, e.g. the
+ * files of the previous day. */
+#define CSV_IDLE_TIMEOUT TIME_T_TO_CDTIME_T(300)
+
+/*
+ * Private types
+ */
+/* An open CSV file. Open files are kept in a tree, keyed by file name, and in
+ * a list ordered by last use, so the least recently used file can be closed
+ * when the number of open files exceeds `MaxOpenFiles'. The file is locked
+ * using fcntl(2) while it is open. */
+struct csv_file_s {
+  char *filename;
+  int fd;
+  dev_t dev;
+  ino_t ino;
+
+  char *buffer;
+  size_t buffer_fill;
+  cdtime_t buffer_since;
+  cdtime_t last_write;
+
+  struct csv_file_s *prev;
+  struct csv_file_s *next;
+};
+typedef struct csv_file_s csv_file_t;
+
 /*
  * Private variables
  */
-static const char *config_keys[] = {"DataDir", "StoreRates"};
+static const char *config_keys[] = {"DataDir",    "StoreRates",
+                                    "MaxOpenFiles", "WriteBufferSize",
+                                    "FlushInterval", "SyncOnFlush"};
 static int config_keys_num = STATIC_ARRAY_SIZE(config_keys);
 
 static char *datadir = NULL;
 static int store_rates = 0;
 static int use_stdio = 0;
 
+static size_t max_open_files = CSV_DEFAULT_MAX_OPEN_FILES;
+static size_t write_buffer_size = 0;
+static cdtime_t flush_interval = CSV_DEFAULT_FLUSH_INTERVAL;
+static _Bool sync_on_flush = 0;
+
+static pthread_mutex_t files_lock = PTHREAD_MUTEX_INITIALIZER;
+static c_avl_tree_t *files_tree = NULL;
+static csv_file_t *files_head = NULL; /* most recently used */
+static csv_file_t *files_tail = NULL; /* least recently used */
+static size_t files_num = 0;
+static cdtime_t files_last_check = 0;
+
 static int value_list_to_string(char *buffer, int buffer_len,
                                 const data_set_t *ds, const value_list_t *vl) {
   int offset;
@@ -177,6 +227,210 @@ static int csv_create_file(const char *filename, const data_set_t *ds) {
   return 0;
 } /* int csv_create_file */
 
+/* Writes the buffered lines to disk. Must hold files_lock. */
+static int csv_file_flush_unsafe(csv_file_t *f, _Bool sync) /* {{{ */
+{
+  if (f->buffer_fill > 0) {
+    if (swrite(f->fd, f->buffer, f->buffer_fill) != 0) {
+      char errbuf[1024];
+      ERROR("csv plugin: write (%s) failed: %s", f->filename,
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      f->buffer_fill = 0;
+      return -1;
+    }
+    f->buffer_fill = 0;
+
+    if (sync && (fdatasync(f->fd) != 0)) {
+      char errbuf[1024];
+      WARNING("csv plugin: fdatasync (%s) failed: %s", f->filename,
+              sstrerror(errno, errbuf, sizeof(errbuf)));
+    }
+  }
+
+  return 0;
+} /* }}} int csv_file_flush_unsafe */
+
+/* Flushes and closes the file. Must hold files_lock. */
+static void csv_file_close_unsafe(csv_file_t *f) /* {{{ */
+{
+  csv_file_flush_unsafe(f, sync_on_flush);
+
+  c_avl_remove(files_tree, f->filename, NULL, NULL);
+  if (f->prev != NULL)
+    f->prev->next = f->next;
+  else
+    files_head = f->next;
+  if (f->next != NULL)
+    f->next->prev = f->prev;
+  else
+    files_tail = f->prev;
+  files_num--;
+
+  /* The lock is released implicitly. */
+  close(f->fd);
+  sfree(f->filename);
+  sfree(f->buffer);
+  sfree(f);
+} /* }}} void csv_file_close_unsafe */
+
+/* Returns the open file "filename", opening and, if necessary, creating it.
+ * Must hold files_lock. */
+static csv_file_t *csv_file_get_unsafe(const char *filename, /* {{{ */
+                                       const data_set_t *ds) {
+  struct stat statbuf;
+  struct flock fl = {0};
+  csv_file_t *f = NULL;
+  int status;
+
+  if (c_avl_get(files_tree, filename, (void *)&f) == 0) {
+    /* move to the front of the LRU list */
+    if (f->prev != NULL) {
+      f->prev->next = f->next;
+      if (f->next != NULL)
+        f->next->prev = f->prev;
+      else
+        files_tail = f->prev;
+
+      f->prev = NULL;
+      f->next = files_head;
+      files_head->prev = f;
+      files_head = f;
+    }
+    return f;
+  }
+
+  if (stat(filename, &statbuf) == -1) {
+    if (errno == ENOENT) {
+      if (csv_create_file(filename, ds))
+        return NULL;
+    } else {
+      char errbuf[1024];
+      ERROR("stat(%s) failed: %s", filename,
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      return NULL;
+    }
+  } else if (!S_ISREG(statbuf.st_mode)) {
+    ERROR("stat(%s): Not a regular file!", filename);
+    return NULL;
+  }
+
+  int fd = open(filename, O_WRONLY | O_APPEND);
+  if (fd < 0) {
+    char errbuf[1024];
+    ERROR("csv plugin: open (%s) failed: %s", filename,
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return NULL;
+  }
+
+  fl.l_pid = getpid();
+  fl.l_type = F_WRLCK;
+  fl.l_whence = SEEK_SET;
+
+  status = fcntl(fd, F_SETLK, &fl);
+  if (status != 0) {
+    char errbuf[1024];
+    ERROR("csv plugin: flock (%s) failed: %s", filename,
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    close(fd);
+    return NULL;
+  }
+
+  f = calloc(1, sizeof(*f));
+  if (f != NULL) {
+    f->filename = strdup(filename);
+    if (write_buffer_size > 0)
+      f->buffer = malloc(write_buffer_size);
+  }
+  if ((f == NULL) || (f->filename == NULL) ||
+      ((write_buffer_size > 0) && (f->buffer == NULL)) ||
+      (fstat(fd, &statbuf) != 0) ||
+      (c_avl_insert(files_tree, f->filename, f) != 0)) {
+    ERROR("csv plugin: Adding \"%s\" to the open files failed.", filename);
+    if (f != NULL) {
+      sfree(f->filename);
+      sfree(f->buffer);
+    }
+    sfree(f);
+    close(fd);
+    return NULL;
+  }
+
+  f->fd = fd;
+  f->dev = statbuf.st_dev;
+  f->ino = statbuf.st_ino;
+
+  f->next = files_head;
+  if (files_head != NULL)
+    files_head->prev = f;
+  files_head = f;
+  if (files_tail == NULL)
+    files_tail = f;
+  files_num++;
+
+  return f;
+} /* }}} csv_file_t *csv_file_get_unsafe */
+
+/* Appends one line to the file, writing it through if it does not fit into
+ * the buffer. Must hold files_lock. */
+static int csv_file_append_unsafe(csv_file_t *f, char const *line, /* {{{ */
+                                  size_t line_len, cdtime_t now) {
+  f->last_write = now;
+
+  if (f->buffer_fill + line_len > write_buffer_size)
+    if (csv_file_flush_unsafe(f, /* sync = */ 0) != 0)
+      return -1;
+
+  if (line_len > write_buffer_size) {
+    if (swrite(f->fd, line, line_len) != 0) {
+      char errbuf[1024];
+      ERROR("csv plugin: write (%s) failed: %s", f->filename,
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      return -1;
+    }
+    return 0;
+  }
+
+  if (f->buffer_fill == 0)
+    f->buffer_since = now;
+  memcpy(f->buffer + f->buffer_fill, line, line_len);
+  f->buffer_fill += line_len;
+
+  return 0;
+} /* }}} int csv_file_append_unsafe */
+
+/* Flushes buffers older than `FlushInterval' and closes files which are idle
+ * or have been removed or replaced, e.g. by log rotation. With "force" set,
+ * all buffers are flushed. Must hold files_lock. */
+static void csv_files_check_unsafe(cdtime_t now, _Bool force) /* {{{ */
+{
+  csv_file_t *next;
+
+  files_last_check = now;
+
+  for (csv_file_t *f = files_head; f != NULL; f = next) {
+    struct stat statbuf;
+
+    next = f->next;
+
+    if ((now - f->last_write) >= CSV_IDLE_TIMEOUT) {
+      DEBUG("csv plugin: Closing idle file \"%s\".", f->filename);
+      csv_file_close_unsafe(f);
+      continue;
+    }
+
+    if ((stat(f->filename, &statbuf) != 0) || (statbuf.st_dev != f->dev) ||
+        (statbuf.st_ino != f->ino)) {
+      DEBUG("csv plugin: \"%s\" has been removed or replaced.", f->filename);
+      csv_file_close_unsafe(f);
+      continue;
+    }
+
+    if ((f->buffer_fill > 0) &&
+        (force || ((now - f->buffer_since) >= flush_interval)))
+      csv_file_flush_unsafe(f, sync_on_flush);
+  }
+} /* }}} void csv_files_check_unsafe */
+
 static int csv_config(const char *key, const char *value) {
   if (strcasecmp("DataDir", key) == 0) {
     if (datadir != NULL) {
@@ -207,6 +461,29 @@ static int csv_config(const char *key, const char *value) {
       store_rates = 1;
     else
       store_rates = 0;
+  } else if (strcasecmp("MaxOpenFiles", key) == 0) {
+    int tmp = atoi(value);
+    if (tmp < 0) {
+      ERROR("csv plugin: \"MaxOpenFiles\" must not be negative.");
+      return -1;
+    }
+    max_open_files = (size_t)tmp;
+  } else if (strcasecmp("WriteBufferSize", key) == 0) {
+    int tmp = atoi(value);
+    if (tmp < 0) {
+      ERROR("csv plugin: \"WriteBufferSize\" must not be negative.");
+      return -1;
+    }
+    write_buffer_size = (size_t)tmp;
+  } else if (strcasecmp("FlushInterval", key) == 0) {
+    double tmp = atof(value);
+    if (tmp <= 0.0) {
+      ERROR("csv plugin: \"FlushInterval\" must be positive.");
+      return -1;
+    }
+    flush_interval = DOUBLE_TO_CDTIME_T(tmp);
+  } else if (strcasecmp("SyncOnFlush", key) == 0) {
+    sync_on_flush = IS_TRUE(value) ? 1 : 0;
   } else {
     return -1;
   }
@@ -215,12 +492,8 @@ static int csv_config(const char *key, const char *value) {
 
 static int csv_write(const data_set_t *ds, const value_list_t *vl,
                      user_data_t __attribute__((unused)) * user_data) {
-  struct stat statbuf;
   char filename[512];
   char values[4096];
-  FILE *csv;
-  int csv_fd;
-  struct flock fl = {0};
   int status;
 
   if (0 != strcmp(ds->type, vl->type)) {
@@ -253,53 +526,72 @@ static int csv_write(const data_set_t *ds, const value_list_t *vl,
     return 0;
   }
 
-  if (stat(filename, &statbuf) == -1) {
-    if (errno == ENOENT) {
-      if (csv_create_file(filename, ds))
-        return -1;
-    } else {
-      char errbuf[1024];
-      ERROR("stat(%s) failed: %s", filename,
-            sstrerror(errno, errbuf, sizeof(errbuf)));
+  size_t values_len = strlen(values);
+  if (values_len + 1 >= sizeof(values)) {
+    ERROR("csv plugin: Buffer too small.");
+    return -1;
+  }
+  values[values_len] = '\n';
+  values_len++;
+
+  cdtime_t now = cdtime();
+
+  pthread_mutex_lock(&files_lock);
+
+  if (files_tree == NULL) {
+    files_tree = c_avl_create((int (*)(const void *, const void *))strcmp);
+    if (files_tree == NULL) {
+      pthread_mutex_unlock(&files_lock);
+      ERROR("csv plugin: c_avl_create failed.");
       return -1;
     }
-  } else if (!S_ISREG(statbuf.st_mode)) {
-    ERROR("stat(%s): Not a regular file!", filename);
-    return -1;
   }
 
-  csv = fopen(filename, "a");
-  if (csv == NULL) {
-    char errbuf[1024];
-    ERROR("csv plugin: fopen (%s) failed: %s", filename,
-          sstrerror(errno, errbuf, sizeof(errbuf)));
+  csv_file_t *f = csv_file_get_unsafe(filename, ds);
+  if (f == NULL) {
+    pthread_mutex_unlock(&files_lock);
     return -1;
   }
-  csv_fd = fileno(csv);
 
-  fl.l_pid = getpid();
-  fl.l_type = F_WRLCK;
-  fl.l_whence = SEEK_SET;
+  status = csv_file_append_unsafe(f, values, values_len, now);
+  if (status != 0)
+    csv_file_close_unsafe(f);
 
-  status = fcntl(csv_fd, F_SETLK, &fl);
-  if (status != 0) {
-    char errbuf[1024];
-    ERROR("csv plugin: flock (%s) failed: %s", filename,
-          sstrerror(errno, errbuf, sizeof(errbuf)));
-    fclose(csv);
-    return -1;
-  }
+  if ((now - files_last_check) >= flush_interval)
+    csv_files_check_unsafe(now, /* force = */ 0);
 
-  fprintf(csv, "%s\n", values);
+  while (files_num > max_open_files)
+    csv_file_close_unsafe(files_tail);
 
-  /* The lock is implicitely released. I we don't release it explicitely
-   * because the `FILE *' may need to flush a cache first */
-  fclose(csv);
+  pthread_mutex_unlock(&files_lock);
 
-  return 0;
+  return (status == 0) ? 0 : -1;
 } /* int csv_write */
 
+static int csv_flush(cdtime_t __attribute__((unused)) timeout,
+                     const char __attribute__((unused)) * identifier,
+                     user_data_t __attribute__((unused)) * user_data) {
+  pthread_mutex_lock(&files_lock);
+  csv_files_check_unsafe(cdtime(), /* force = */ 1);
+  pthread_mutex_unlock(&files_lock);
+
+  return 0;
+} /* int csv_flush */
+
+static int csv_shutdown(void) {
+  pthread_mutex_lock(&files_lock);
+  while (files_tail != NULL)
+    csv_file_close_unsafe(files_tail);
+  c_avl_destroy(files_tree);
+  files_tree = NULL;
+  pthread_mutex_unlock(&files_lock);
+
+  return 0;
+} /* int csv_shutdown */
+
 void module_register(void) {
   plugin_register_config("csv", csv_config, config_keys, config_keys_num);
   plugin_register_write("csv", csv_write, /* user_data = */ NULL);
+  plugin_register_flush("csv", csv_flush, /* user_data = */ NULL);
+  plugin_register_shutdown("csv", csv_shutdown);
 } /* void module_register */
@@ -25,7 +25,6 @@
 
 #include "common.h"
 #include "plugin.h"
-#include "utils_avltree.h"
 #include "utils_complain.h"
 #include "utils_curl_stats.h"
 
@@ -57,16 +56,41 @@ struct cj_key_s /* {{{ */
 };
 /* }}} */
 
+struct cj_tree_s;
+typedef struct cj_tree_s cj_tree_t;
+
 /* cj_tree_entry_t is a union of either a metric configuration ("key") or a tree
  * mapping array indexes / map keys to a descendant cj_tree_entry_t*. */
 typedef struct {
   enum { KEY, TREE } type;
   union {
-    c_avl_tree_t *tree;
+    cj_tree_t *tree;
     cj_key_t *key;
   };
+  /* need_name is set if a key without "Instance" is at or below this entry,
+   * i.e. if the name matched by this entry is used in a type instance. */
+  _Bool need_name;
 } cj_tree_entry_t;
 
+typedef struct {
+  char *name;
+  size_t name_len;
+  uint32_t hash;
+  cj_tree_entry_t *entry;
+} cj_tree_slot_t;
+
+/* cj_tree_t maps the map keys / array indexes of one nesting level to their
+ * entries. It is an open addressing hash table with a load factor of at most
+ * 1/2, so that the names reported by the parser can be looked up in place,
+ * without copying them first. The entry for CJ_ANY is kept aside and returned
+ * when no other entry matches. */
+struct cj_tree_s {
+  cj_tree_slot_t *slots;
+  size_t slots_num; /* power of two */
+  size_t entries_num;
+  cj_tree_entry_t *any;
+};
+
 /* cj_state_t is a stack providing the configuration relevant for the context
  * that is currently being parsed. If entry->type == KEY, the parser should
  * expect a metric (a numeric value). If entry->type == TREE, the parser should
@@ -104,12 +128,33 @@ struct cj_s /* {{{ */
   char curl_errbuf[CURL_ERROR_SIZE];
 
   yajl_handle yajl;
-  c_avl_tree_t *tree;
+  cj_tree_t *tree;
+  cj_tree_entry_t root;
   int depth;
   cj_state_t state[YAJL_MAX_DEPTH];
+
+  /* Configured URLs are registered by cj_init(), see there. */
+  struct cj_s *next;
 };
 typedef struct cj_s cj_t; /* }}} */
 
+/* cj_multi_t fetches all URLs sharing the same interval from a single read
+ * callback, using the multi interface of libcurl. Connections are cached by
+ * the multi handle and reused by the next read. */
+struct cj_multi_s /* {{{ */
+{
+  cdtime_t interval;
+  CURLM *multi;
+  cj_t **dbs;
+  size_t dbs_num;
+
+  struct cj_multi_s *next;
+};
+typedef struct cj_multi_s cj_multi_t; /* }}} */
+
+static cj_t *cj_list;
+static int cj_concurrent_requests;
+
 #if HAVE_YAJL_V2
 typedef size_t yajl_len_t;
 #else
@@ -183,42 +228,156 @@ static int cj_get_type(cj_key_t *key) {
   return ds->ds[0].type;
 }
 
+static uint32_t cj_hash(char const *name, size_t name_len) /* {{{ */
+{
+  /* FNV-1a */
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < name_len; i++) {
+    hash ^= (uint32_t)(unsigned char)name[i];
+    hash *= 16777619U;
+  }
+  return hash;
+} /* }}} uint32_t cj_hash */
+
+static cj_tree_slot_t *cj_tree_find(cj_tree_t *tree, /* {{{ */
+                                    char const *name, size_t name_len,
+                                    uint32_t hash) {
+  size_t mask = tree->slots_num - 1;
+
+  for (size_t i = hash & mask; tree->slots[i].name != NULL;
+       i = (i + 1) & mask) {
+    cj_tree_slot_t *slot = tree->slots + i;
+    if ((slot->hash == hash) && (slot->name_len == name_len) &&
+        (memcmp(slot->name, name, name_len) == 0))
+      return slot;
+  }
+
+  return NULL;
+} /* }}} cj_tree_slot_t *cj_tree_find */
+
+/* cj_tree_get returns the entry for "name" or, if there is none, the entry for
+ * CJ_ANY. Returns NULL if neither exists. */
+static cj_tree_entry_t *cj_tree_get(cj_tree_t *tree, /* {{{ */
+                                    char const *name, size_t name_len) {
+  if (tree->entries_num > 0) {
+    cj_tree_slot_t *slot =
+        cj_tree_find(tree, name, name_len, cj_hash(name, name_len));
+    if (slot != NULL)
+      return slot->entry;
+  }
+
+  return tree->any;
+} /* }}} cj_tree_entry_t *cj_tree_get */
+
+static int cj_tree_resize(cj_tree_t *tree, size_t slots_num) /* {{{ */
+{
+  cj_tree_slot_t *slots = calloc(slots_num, sizeof(*slots));
+  if (slots == NULL)
+    return ENOMEM;
+
+  for (size_t i = 0; i < tree->slots_num; i++) {
+    if (tree->slots[i].name == NULL)
+      continue;
+
+    size_t j = tree->slots[i].hash & (slots_num - 1);
+    while (slots[j].name != NULL)
+      j = (j + 1) & (slots_num - 1);
+    slots[j] = tree->slots[i];
+  }
+
+  sfree(tree->slots);
+  tree->slots = slots;
+  tree->slots_num = slots_num;
+  return 0;
+} /* }}} int cj_tree_resize */
+
+/* cj_tree_insert adds "e" to "tree". Returns EEXIST if "name" is already
+ * present. */
+static int cj_tree_insert(cj_tree_t *tree, char const *name, /* {{{ */
+                          cj_tree_entry_t *e) {
+  if (strcmp(CJ_ANY, name) == 0) {
+    if (tree->any != NULL)
+      return EEXIST;
+    tree->any = e;
+    return 0;
+  }
+
+  size_t name_len = strlen(name);
+  uint32_t hash = cj_hash(name, name_len);
+
+  if (2 * (tree->entries_num + 1) > tree->slots_num) {
+    int status = cj_tree_resize(tree, (tree->slots_num == 0)
+                                          ? 8
+                                          : 2 * tree->slots_num);
+    if (status != 0)
+      return status;
+  }
+
+  if (cj_tree_find(tree, name, name_len, hash) != NULL)
+    return EEXIST;
+
+  size_t mask = tree->slots_num - 1;
+  size_t i = hash & mask;
+  while (tree->slots[i].name != NULL)
+    i = (i + 1) & mask;
+
+  char *copy = strdup(name);
+  if (copy == NULL)
+    return ENOMEM;
+
+  tree->slots[i] = (cj_tree_slot_t){
+      .name = copy, .name_len = name_len, .hash = hash, .entry = e,
+  };
+  tree->entries_num++;
+  return 0;
+} /* }}} int cj_tree_insert */
+
 /* cj_load_key loads the configuration for "key" from the parent context and
- * sets either .key or .tree in the current context. */
-static int cj_load_key(cj_t *db, char const *key) {
+ * sets either .key or .tree in the current context. "key" does not need to be
+ * null-terminated. */
+static int cj_load_key(cj_t *db, char const *key, size_t key_len) {
   if (db == NULL || key == NULL || db->depth <= 0)
     return EINVAL;
 
-  sstrncpy(db->state[db->depth].name, key, sizeof(db->state[db->depth].name));
+  cj_state_t *state = db->state + db->depth;
+  cj_tree_entry_t *parent = db->state[db->depth - 1].entry;
 
-  if (db->state[db->depth - 1].entry == NULL ||
-      db->state[db->depth - 1].entry->type != TREE) {
+  if (parent == NULL || parent->type != TREE) {
+    state->entry = NULL;
     return 0;
   }
 
-  c_avl_tree_t *tree = db->state[db->depth - 1].entry->tree;
-  cj_tree_entry_t *e = NULL;
+  state->entry = cj_tree_get(parent->tree, key, key_len);
 
-  if (c_avl_get(tree, key, (void *)&e) == 0) {
-    db->state[db->depth].entry = e;
-  } else if (c_avl_get(tree, CJ_ANY, (void *)&e) == 0) {
-    db->state[db->depth].entry = e;
-  } else {
-    db->state[db->depth].entry = NULL;
+  /* Only keep a copy of the name if it may end up in a type instance. */
+  if ((state->entry != NULL) && state->entry->need_name) {
+    key_len = COUCH_MIN(key_len, sizeof(state->name) - 1);
+    memcpy(state->name, key, key_len);
+    state->name[key_len] = 0;
   }
 
   return 0;
 }
 
+static void cj_load_index(cj_t *db) {
+  cj_tree_entry_t *parent = db->state[db->depth - 1].entry;
+
+  if (parent == NULL || parent->type != TREE) {
+    db->state[db->depth].entry = NULL;
+    return;
+  }
+
+  char name[DATA_MAX_NAME_LEN];
+  int len = snprintf(name, sizeof(name), "%d", db->state[db->depth].index);
+  cj_load_key(db, name, (size_t)len);
+}
+
 static void cj_advance_array(cj_t *db) {
   if (!db->state[db->depth].in_array)
     return;
 
   db->state[db->depth].index++;
-
-  char name[DATA_MAX_NAME_LEN];
-  snprintf(name, sizeof(name), "%d", db->state[db->depth].index);
-  cj_load_key(db, name);
+  cj_load_index(db);
 }
 
 /* yajl callbacks */
@@ -238,18 +397,20 @@ static int cj_cb_null(void *ctx) {
 static int cj_cb_number(void *ctx, const char *number, yajl_len_t number_len) {
   cj_t *db = (cj_t *)ctx;
 
+  if (db->state[db->depth].entry == NULL) {
+    cj_advance_array(ctx);
+    return CJ_CB_CONTINUE;
+  }
+
   /* Create a null-terminated version of the string. */
   char buffer[number_len + 1];
   memcpy(buffer, number, number_len);
   buffer[sizeof(buffer) - 1] = 0;
 
-  if (db->state[db->depth].entry == NULL ||
-      db->state[db->depth].entry->type != KEY) {
-    if (db->state[db->depth].entry != NULL) {
-      NOTICE("curl_json plugin: Found \"%s\", but the configuration expects a "
-             "map.",
-             buffer);
-    }
+  if (db->state[db->depth].entry->type != KEY) {
+    NOTICE("curl_json plugin: Found \"%s\", but the configuration expects a "
+           "map.",
+           buffer);
     cj_advance_array(ctx);
     return CJ_CB_CONTINUE;
   }
@@ -275,12 +436,7 @@ static int cj_cb_number(void *ctx, const char *number, yajl_len_t number_len) {
  * NULL. */
 static int cj_cb_map_key(void *ctx, unsigned char const *in_name,
                          yajl_len_t in_name_len) {
-  char name[in_name_len + 1];
-
-  memmove(name, in_name, in_name_len);
-  name[sizeof(name) - 1] = 0;
-
-  if (cj_load_key(ctx, name) != 0)
+  if (cj_load_key(ctx, (char const *)in_name, (size_t)in_name_len) != 0)
     return CJ_CB_ABORT;
 
   return CJ_CB_CONTINUE;
@@ -325,7 +481,7 @@ static int cj_cb_start_array(void *ctx) {
   db->state[db->depth].in_array = 1;
   db->state[db->depth].index = 0;
 
-  cj_load_key(db, "0");
+  cj_load_index(db);
 
   return CJ_CB_CONTINUE;
 }
@@ -358,22 +514,36 @@ static void cj_key_free(cj_key_t *key) /* {{{ */
   sfree(key);
 } /* }}} void cj_key_free */
 
-static void cj_tree_free(c_avl_tree_t *tree) /* {{{ */
+static void cj_tree_free(cj_tree_t *tree);
+
+static void cj_tree_entry_free(cj_tree_entry_t *e) /* {{{ */
 {
-  char *name;
-  cj_tree_entry_t *e;
+  if (e == NULL)
+    return;
 
-  while (c_avl_pick(tree, (void *)&name, (void *)&e) == 0) {
-    sfree(name);
+  if (e->type == KEY)
+    cj_key_free(e->key);
+  else
+    cj_tree_free(e->tree);
+  sfree(e);
+} /* }}} void cj_tree_entry_free */
 
-    if (e->type == KEY)
-      cj_key_free(e->key);
-    else
-      cj_tree_free(e->tree);
-    sfree(e);
+static void cj_tree_free(cj_tree_t *tree) /* {{{ */
+{
+  if (tree == NULL)
+    return;
+
+  for (size_t i = 0; i < tree->slots_num; i++) {
+    if (tree->slots[i].name == NULL)
+      continue;
+
+    sfree(tree->slots[i].name);
+    cj_tree_entry_free(tree->slots[i].entry);
   }
+  cj_tree_entry_free(tree->any);
 
-  c_avl_destroy(tree);
+  sfree(tree->slots);
+  sfree(tree);
 } /* }}} void cj_tree_free */
 
 static void cj_free(void *arg) /* {{{ */
@@ -414,10 +584,6 @@ static void cj_free(void *arg) /* {{{ */
 
 /* Configuration handling functions {{{ */
 
-static c_avl_tree_t *cj_avl_create(void) {
-  return c_avl_create((int (*)(const void *, const void *))strcmp);
-}
-
 static int cj_config_append_string(const char *name,
                                    struct curl_slist **dest, /* {{{ */
                                    oconfig_item_t *ci) {
@@ -444,10 +610,14 @@ static int cj_config_append_string(const char *name,
  * { "httpd": { "requests": { "count": $key, "current": $key } } }
  */
 static int cj_append_key(cj_t *db, cj_key_t *key) { /* {{{ */
-  if (db->tree == NULL)
-    db->tree = cj_avl_create();
+  if (db->tree == NULL) {
+    db->tree = calloc(1, sizeof(*db->tree));
+    if (db->tree == NULL)
+      return ENOMEM;
+  }
 
-  c_avl_tree_t *tree = db->tree;
+  cj_tree_t *tree = db->tree;
+  _Bool need_name = (key->instance == NULL);
 
   char const *start = key->path;
   if (*start == '/')
@@ -464,20 +634,38 @@ static int cj_append_key(cj_t *db, cj_key_t *key) { /* {{{ */
     len = COUCH_MIN(len, sizeof(name) - 1);
     sstrncpy(name, start, len + 1);
 
-    cj_tree_entry_t *e;
-    if (c_avl_get(tree, name, (void *)&e) != 0) {
+    cj_tree_entry_t *e = NULL;
+    if (strcmp(CJ_ANY, name) == 0) {
+      e = tree->any;
+    } else if (tree->entries_num > 0) {
+      cj_tree_slot_t *slot =
+          cj_tree_find(tree, name, strlen(name), cj_hash(name, strlen(name)));
+      if (slot != NULL)
+        e = slot->entry;
+    }
+
+    if (e == NULL) {
       e = calloc(1, sizeof(*e));
       if (e == NULL)
         return ENOMEM;
       e->type = TREE;
-      e->tree = cj_avl_create();
+      e->tree = calloc(1, sizeof(*e->tree));
+      if (e->tree == NULL) {
+        sfree(e);
+        return ENOMEM;
+      }
 
-      c_avl_insert(tree, strdup(name), e);
+      int status = cj_tree_insert(tree, name, e);
+      if (status != 0) {
+        cj_tree_entry_free(e);
+        return status;
+      }
     }
 
     if (e->type != TREE)
       return EINVAL;
 
+    e->need_name |= need_name;
     tree = e->tree;
     start = end + 1;
   }
@@ -492,8 +680,14 @@ static int cj_append_key(cj_t *db, cj_key_t *key) { /* {{{ */
     return ENOMEM;
   e->type = KEY;
   e->key = key;
+  e->need_name = need_name;
 
-  c_avl_insert(tree, strdup(start), e);
+  int status = cj_tree_insert(tree, start, e);
+  if (status != 0) {
+    /* The key is owned by the caller until it has been inserted. */
+    sfree(e);
+    return status;
+  }
   return 0;
 } /* }}} int cj_append_key */
 
@@ -557,7 +751,11 @@ static int cj_config_add_key(cj_t *db, /* {{{ */
   }
 
   status = cj_append_key(db, key);
-  if (status != 0) {
+  if (status == EEXIST) {
+    WARNING("curl_json plugin: Ignoring duplicate key \"%s\".", key->path);
+    cj_key_free(key);
+    return 0;
+  } else if (status != 0) {
     cj_key_free(key);
     return -1;
   }
@@ -574,6 +772,7 @@ static int cj_init_curl(cj_t *db) /* {{{ */
   }
 
   curl_easy_setopt(db->curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(db->curl, CURLOPT_PRIVATE, db);
   curl_easy_setopt(db->curl, CURLOPT_WRITEFUNCTION, cj_curl_callback);
   curl_easy_setopt(db->curl, CURLOPT_WRITEDATA, db);
   curl_easy_setopt(db->curl, CURLOPT_USERAGENT, COLLECTD_USERAGENT);
@@ -719,24 +918,13 @@ static int cj_config_add_url(oconfig_item_t *ci) /* {{{ */
       status = cj_init_curl(db);
   }
 
-  /* If all went well, register this database for reading */
+  /* If all went well, queue this database for registration by cj_init() */
   if (status == 0) {
-    char *cb_name;
-
     if (db->instance == NULL)
       db->instance = strdup("default");
 
-    DEBUG("curl_json plugin: Registering new read callback: %s", db->instance);
-
-    cb_name = ssnprintf_alloc("curl_json-%s-%s", db->instance,
-                              db->url ? db->url : db->sock);
-
-    plugin_register_complex_read(/* group = */ NULL, cb_name, cj_read,
-                                 /* interval = */ db->interval,
-                                 &(user_data_t){
-                                     .data = db, .free_func = cj_free,
-                                 });
-    sfree(cb_name);
+    db->next = cj_list;
+    cj_list = db;
   } else {
     cj_free(db);
     return -1;
@@ -765,6 +953,23 @@ static int cj_config(oconfig_item_t *ci) /* {{{ */
         success++;
       else
         errors++;
+    } else if (strcasecmp("ConcurrentRequests", child->key) == 0) {
+      status = cf_util_get_int(child, &cj_concurrent_requests);
+      if ((status == 0) && (cj_concurrent_requests < 0)) {
+        WARNING("curl_json plugin: `ConcurrentRequests' must not be "
+                "negative.");
+        cj_concurrent_requests = 0;
+        status = -1;
+      }
+#if !HAVE_CURL_MULTI_WAIT
+      if ((status == 0) && (cj_concurrent_requests > 0)) {
+        WARNING("curl_json plugin: `ConcurrentRequests' is not supported by "
+                "this version of libcurl and will be ignored.");
+        cj_concurrent_requests = 0;
+      }
+#endif
+      if (status != 0)
+        errors++;
     } else {
       WARNING("curl_json plugin: Option `%s' not allowed here.", child->key);
       errors++;
@@ -852,15 +1057,13 @@ static int cj_sock_perform(cj_t *db) /* {{{ */
   return 0;
 } /* }}} int cj_sock_perform */
 
-static int cj_curl_perform(cj_t *db) /* {{{ */
+/* cj_curl_check checks the outcome of a finished transfer and dispatches its
+ * statistics. */
+static int cj_curl_check(cj_t *db, CURLcode status) /* {{{ */
 {
-  int status;
   long rc;
   char *url;
 
-  curl_easy_setopt(db->curl, CURLOPT_URL, db->url);
-
-  status = curl_easy_perform(db->curl);
   if (status != CURLE_OK) {
     ERROR("curl_json plugin: curl_easy_perform failed with status %i: %s (%s)",
           status, db->curl_errbuf, db->url);
@@ -881,12 +1084,20 @@ static int cj_curl_perform(cj_t *db) /* {{{ */
     return -1;
   }
   return 0;
+} /* }}} int cj_curl_check */
+
+static int cj_curl_perform(cj_t *db) /* {{{ */
+{
+  curl_easy_setopt(db->curl, CURLOPT_URL, db->url);
+
+  return cj_curl_check(db, curl_easy_perform(db->curl));
 } /* }}} int cj_curl_perform */
 
-static int cj_perform(cj_t *db) /* {{{ */
+/* cj_parse_begin prepares "db" for parsing a new document. */
+static int cj_parse_begin(cj_t *db) /* {{{ */
 {
-  int status;
-  yajl_handle yprev = db->yajl;
+  db->depth = 0;
+  memset(&db->state, 0, sizeof(db->state));
 
   db->yajl = yajl_alloc(&ycallbacks,
 #if HAVE_YAJL_V2
@@ -897,40 +1108,60 @@ static int cj_perform(cj_t *db) /* {{{ */
                         /* context = */ (void *)db);
   if (db->yajl == NULL) {
     ERROR("curl_json plugin: yajl_alloc failed.");
-    db->yajl = yprev;
     return -1;
   }
 
-  if (db->url)
-    status = cj_curl_perform(db);
-  else
-    status = cj_sock_perform(db);
-  if (status < 0) {
-    yajl_free(db->yajl);
-    db->yajl = yprev;
-    return -1;
-  }
+  /* This is not a compound literal because EPEL6's GCC is not cool enough to
+   * handle anonymous unions within compound literals. */
+  memset(&db->root, 0, sizeof(db->root));
+  db->root.type = TREE;
+  db->root.tree = db->tree;
+  db->state[0].entry = &db->root;
 
+  return 0;
+} /* }}} int cj_parse_begin */
+
+/* cj_parse_finish completes parsing the document if "status" indicates that it
+ * has been received successfully, and releases the parser. */
+static int cj_parse_finish(cj_t *db, int status) /* {{{ */
+{
+  if (status == 0) {
 #if HAVE_YAJL_V2
-  status = yajl_complete_parse(db->yajl);
+    yajl_status ystatus = yajl_complete_parse(db->yajl);
 #else
-  status = yajl_parse_complete(db->yajl);
+    yajl_status ystatus = yajl_parse_complete(db->yajl);
 #endif
-  if (status != yajl_status_ok) {
-    unsigned char *errmsg;
-
-    errmsg = yajl_get_error(db->yajl, /* verbose = */ 0,
-                            /* jsonText = */ NULL, /* jsonTextLen = */ 0);
-    ERROR("curl_json plugin: yajl_parse_complete failed: %s", (char *)errmsg);
-    yajl_free_error(db->yajl, errmsg);
-    yajl_free(db->yajl);
-    db->yajl = yprev;
-    return -1;
+    if (ystatus != yajl_status_ok) {
+      unsigned char *errmsg;
+
+      errmsg = yajl_get_error(db->yajl, /* verbose = */ 0,
+                              /* jsonText = */ NULL, /* jsonTextLen = */ 0);
+      ERROR("curl_json plugin: yajl_parse_complete failed: %s",
+            (char *)errmsg);
+      yajl_free_error(db->yajl, errmsg);
+      status = -1;
+    }
   }
 
   yajl_free(db->yajl);
-  db->yajl = yprev;
-  return 0;
+  db->yajl = NULL;
+  db->state[0].entry = NULL;
+
+  return (status == 0) ? 0 : -1;
+} /* }}} int cj_parse_finish */
+
+static int cj_perform(cj_t *db) /* {{{ */
+{
+  int status = cj_parse_begin(db);
+  if (status != 0)
+    return status;
+
+  if (db->url)
+    status = cj_curl_perform(db);
+  else
+    status = cj_sock_perform(db);
+
+  return cj_parse_finish(db, status);
 } /* }}} int cj_perform */
 
 static int cj_read(user_data_t *ud) /* {{{ */
@@ -944,28 +1175,228 @@ static int cj_read(user_data_t *ud) /* {{{ */
 
   db = (cj_t *)ud->data;
 
-  db->depth = 0;
-  memset(&db->state, 0, sizeof(db->state));
+  return cj_perform(db);
+} /* }}} int cj_read */
 
-  /* This is not a compound literal because EPEL6's GCC is not cool enough to
-   * handle anonymous unions within compound literals. */
-  cj_tree_entry_t root = {0};
-  root.type = TREE;
-  root.tree = db->tree;
-  db->state[0].entry = &root;
+#if HAVE_CURL_MULTI_WAIT
+static void cj_multi_free(void *arg) /* {{{ */
+{
+  cj_multi_t *m = arg;
 
-  int status = cj_perform(db);
+  if (m == NULL)
+    return;
 
-  db->state[0].entry = NULL;
+  for (size_t i = 0; i < m->dbs_num; i++)
+    cj_free(m->dbs[i]);
+  sfree(m->dbs);
 
-  return status;
-} /* }}} int cj_read */
+  if (m->multi != NULL)
+    curl_multi_cleanup(m->multi);
+
+  sfree(m);
+} /* }}} void cj_multi_free */
+
+static int cj_multi_add(cj_multi_t *m, cj_t *db) /* {{{ */
+{
+  if (cj_parse_begin(db) != 0)
+    return -1;
+
+  curl_easy_setopt(db->curl, CURLOPT_URL, db->url);
+
+  CURLMcode status = curl_multi_add_handle(m->multi, db->curl);
+  if (status != CURLM_OK) {
+    ERROR("curl_json plugin: curl_multi_add_handle failed: %s (%s)",
+          curl_multi_strerror(status), db->url);
+    cj_parse_finish(db, -1);
+    return -1;
+  }
+
+  return 0;
+} /* }}} int cj_multi_add */
+
+/* cj_multi_read fetches all URLs of a group concurrently, keeping at most
+ * cj_concurrent_requests transfers in flight. Each response is parsed as it
+ * arrives, so the callbacks of different URLs are interleaved. */
+static int cj_multi_read(user_data_t *ud) /* {{{ */
+{
+  if ((ud == NULL) || (ud->data == NULL)) {
+    ERROR("curl_json plugin: cj_multi_read: Invalid user data.");
+    return -1;
+  }
+
+  cj_multi_t *m = ud->data;
+  size_t next = 0;
+  size_t active = 0;
+  size_t failed = 0;
+
+  while ((next < m->dbs_num) || (active > 0)) {
+    while ((next < m->dbs_num) &&
+           (active < (size_t)cj_concurrent_requests)) {
+      if (cj_multi_add(m, m->dbs[next]) == 0)
+        active++;
+      else
+        failed++;
+      next++;
+    }
+
+    int running = 0;
+    CURLMcode status = curl_multi_perform(m->multi, &running);
+    if (status != CURLM_OK) {
+      ERROR("curl_json plugin: curl_multi_perform failed: %s",
+            curl_multi_strerror(status));
+      break;
+    }
+
+    CURLMsg *msg;
+    int queued = 0;
+    while ((msg = curl_multi_info_read(m->multi, &queued)) != NULL) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      char *priv = NULL;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+      cj_t *db = (cj_t *)priv;
+      CURLcode result = msg->data.result;
+
+      /* msg is invalid after the handle has been removed. */
+      curl_multi_remove_handle(m->multi, msg->easy_handle);
+      active--;
+
+      if (cj_parse_finish(db, cj_curl_check(db, result)) != 0)
+        failed++;
+    }
+
+    /* Start the next transfers right away if there is room for them. */
+    if ((running > 0) && ((next >= m->dbs_num) ||
+                          (active >= (size_t)cj_concurrent_requests)))
+      curl_multi_wait(m->multi, /* extra_fds = */ NULL,
+                      /* extra_nfds = */ 0, /* timeout_ms = */ 1000,
+                      /* numfds = */ NULL);
+  }
+
+  /* Only reached early if curl_multi_perform failed. */
+  for (size_t i = 0; i < next; i++) {
+    if (m->dbs[i]->yajl == NULL)
+      continue;
+
+    curl_multi_remove_handle(m->multi, m->dbs[i]->curl);
+    cj_parse_finish(m->dbs[i], -1);
+    failed++;
+  }
+  failed += m->dbs_num - next;
+
+  return (failed < m->dbs_num) ? 0 : -1;
+} /* }}} int cj_multi_read */
+
+static cj_multi_t *cj_multi_get(cj_multi_t **groups, /* {{{ */
+                                cdtime_t interval) {
+  for (cj_multi_t *m = *groups; m != NULL; m = m->next)
+    if (m->interval == interval)
+      return m;
+
+  cj_multi_t *m = calloc(1, sizeof(*m));
+  if (m == NULL)
+    return NULL;
+
+  m->multi = curl_multi_init();
+  if (m->multi == NULL) {
+    ERROR("curl_json plugin: curl_multi_init failed.");
+    sfree(m);
+    return NULL;
+  }
+  m->interval = interval;
+
+  m->next = *groups;
+  *groups = m;
+  return m;
+} /* }}} cj_multi_t *cj_multi_get */
+
+/* cj_register_multi moves all URLs from cj_list into one group per interval and
+ * registers a read callback for each group. Sockets are left in cj_list. */
+static void cj_register_multi(void) /* {{{ */
+{
+  cj_multi_t *groups = NULL;
+  cj_t **prev = &cj_list;
+
+  while (*prev != NULL) {
+    cj_t *db = *prev;
+
+    cj_multi_t *m = (db->url != NULL) ? cj_multi_get(&groups, db->interval)
+                                      : NULL;
+    if (m == NULL) {
+      prev = &db->next;
+      continue;
+    }
+
+    cj_t **tmp = realloc(m->dbs, (m->dbs_num + 1) * sizeof(*m->dbs));
+    if (tmp == NULL) {
+      ERROR("curl_json plugin: realloc failed.");
+      prev = &db->next;
+      continue;
+    }
+    m->dbs = tmp;
+    m->dbs[m->dbs_num] = db;
+    m->dbs_num++;
+
+    *prev = db->next;
+    db->next = NULL;
+  }
+
+  while (groups != NULL) {
+    cj_multi_t *m = groups;
+    groups = m->next;
+    m->next = NULL;
+
+    if (m->dbs_num == 0) {
+      cj_multi_free(m);
+      continue;
+    }
+
+    char cb_name[DATA_MAX_NAME_LEN];
+    snprintf(cb_name, sizeof(cb_name), "curl_json-concurrent-%.3f",
+             CDTIME_T_TO_DOUBLE(m->interval));
+
+    DEBUG("curl_json plugin: Registering new read callback: %s (%zu URLs)",
+          cb_name, m->dbs_num);
+
+    plugin_register_complex_read(/* group = */ NULL, cb_name, cj_multi_read,
+                                 /* interval = */ m->interval,
+                                 &(user_data_t){
+                                     .data = m, .free_func = cj_multi_free,
+                                 });
+  }
+} /* }}} void cj_register_multi */
+#endif /* HAVE_CURL_MULTI_WAIT */
 
 static int cj_init(void) /* {{{ */
 {
   /* Call this while collectd is still single-threaded to avoid
    * initialization issues in libgcrypt. */
   curl_global_init(CURL_GLOBAL_SSL);
+
+#if HAVE_CURL_MULTI_WAIT
+  if (cj_concurrent_requests > 0)
+    cj_register_multi();
+#endif
+
+  while (cj_list != NULL) {
+    cj_t *db = cj_list;
+    cj_list = db->next;
+    db->next = NULL;
+
+    DEBUG("curl_json plugin: Registering new read callback: %s", db->instance);
+
+    char *cb_name = ssnprintf_alloc("curl_json-%s-%s", db->instance,
+                                    db->url ? db->url : db->sock);
+
+    plugin_register_complex_read(/* group = */ NULL, cb_name, cj_read,
+                                 /* interval = */ db->interval,
+                                 &(user_data_t){
+                                     .data = db, .free_func = cj_free,
+                                 });
+    sfree(cb_name);
+  }
+
   return 0;
 } /* }}} int cj_init */
 
@@ -11,6 +11,7 @@
 #include "curl_json.c"
 
 #include "testing.h"
+#include "utils_avltree.h"
 
 static void test_submit(cj_t *db, cj_key_t *key, value_t *value) {
   /* hack: we repurpose db->curl to store received values. */
@@ -20,6 +21,15 @@ static void test_submit(cj_t *db, cj_key_t *key, value_t *value) {
   memmove(value_copy, value, sizeof(*value_copy));
 
   assert(c_avl_insert(values, key->path, value_copy) == 0);
+
+  /* hack: and db->curl_errbuf to store the type instance of the last value. */
+  if (key->instance == NULL) {
+    int len = 0;
+    for (int i = 0; i < db->depth; i++)
+      len += snprintf(db->curl_errbuf + len, sizeof(db->curl_errbuf) - len,
+                      i ? "-%s" : "%s", db->state[i + 1].name);
+  } else
+    sstrncpy(db->curl_errbuf, key->instance, sizeof(db->curl_errbuf));
 }
 
 static derive_t test_metric(cj_t *db, char const *path) {
@@ -33,42 +43,32 @@ static derive_t test_metric(cj_t *db, char const *path) {
   return -1;
 }
 
-static cj_t *test_setup(char *json, char *key_path) {
+static cj_t *test_setup_keys(char *json, char **key_paths,
+                             size_t key_paths_num) {
   cj_t *db = calloc(1, sizeof(*db));
-  db->yajl = yajl_alloc(&ycallbacks,
-#if HAVE_YAJL_V2
-                        /* alloc funcs = */ NULL,
-#else
-                        /* alloc funcs = */ NULL, NULL,
-#endif
-                        /* context = */ (void *)db);
 
   /* hack; see above. */
-  db->curl = (void *)cj_avl_create();
-
-  cj_key_t *key = calloc(1, sizeof(*key));
-  key->path = strdup(key_path);
-  key->type = strdup("MAGIC");
+  db->curl = (void *)c_avl_create((int (*)(const void *, const void *))strcmp);
 
-  assert(cj_append_key(db, key) == 0);
+  for (size_t i = 0; i < key_paths_num; i++) {
+    cj_key_t *key = calloc(1, sizeof(*key));
+    key->path = strdup(key_paths[i]);
+    key->type = strdup("MAGIC");
 
-  cj_tree_entry_t root = {0};
-  root.type = TREE;
-  root.tree = db->tree;
-  db->state[0].entry = &root;
+    assert(cj_append_key(db, key) == 0);
+  }
 
+  assert(cj_parse_begin(db) == 0);
   cj_curl_callback(json, strlen(json), 1, db);
-#if HAVE_YAJL_V2
-  yajl_complete_parse(db->yajl);
-#else
-  yajl_parse_complete(db->yajl);
-#endif
-
-  db->state[0].entry = NULL;
+  cj_parse_finish(db, 0);
 
   return db;
 }
 
+static cj_t *test_setup(char *json, char *key_path) {
+  return test_setup_keys(json, &key_path, 1);
+}
+
 static void test_teardown(cj_t *db) {
   c_avl_tree_t *values = (void *)db->curl;
   db->curl = NULL;
@@ -81,9 +81,6 @@ static void test_teardown(cj_t *db) {
   }
   c_avl_destroy(values);
 
-  yajl_free(db->yajl);
-  db->yajl = NULL;
-
   cj_free(db);
 }
 
@@ -139,10 +136,74 @@ DEF_TEST(parse) {
   return 0;
 }
 
+DEF_TEST(key_tree) {
+  char *key_paths[64];
+  char json[4096] = "{";
+
+  /* Enough keys to grow the hash table a few times. */
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(key_paths); i++) {
+    char path[32];
+    snprintf(path, sizeof(path), "k%zu/v", i);
+    key_paths[i] = strdup(path);
+
+    size_t len = strlen(json);
+    snprintf(json + len, sizeof(json) - len, "%s\"k%zu\":{\"v\":%zu}",
+             (i == 0) ? "" : ",", i, i);
+  }
+  size_t len = strlen(json);
+  snprintf(json + len, sizeof(json) - len, "}");
+
+  cj_t *db = test_setup_keys(json, key_paths, STATIC_ARRAY_SIZE(key_paths));
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(key_paths); i++) {
+    EXPECT_EQ_INT((int)i, (int)test_metric(db, key_paths[i]));
+    sfree(key_paths[i]);
+  }
+  test_teardown(db);
+
+  /* Exact matches take precedence over the wildcard. */
+  char *wildcard[] = {"a/*", "a/b"};
+  db = test_setup_keys("{\"a\":{\"b\":1,\"c\":2}}", wildcard,
+                       STATIC_ARRAY_SIZE(wildcard));
+  EXPECT_EQ_INT(1, (int)test_metric(db, "a/b"));
+  EXPECT_EQ_INT(2, (int)test_metric(db, "a/*"));
+  EXPECT_EQ_STR("a-c", db->curl_errbuf);
+  test_teardown(db);
+
+  /* Keys must match in full, not just by prefix. */
+  db = test_setup("{\"foobar\":1,\"fo\":2,\"foo\":3}", "foo");
+  EXPECT_EQ_INT(3, (int)test_metric(db, "foo"));
+  test_teardown(db);
+
+  /* Array indexes and matched wildcards are used as the type instance. */
+  char *array[] = {"x/0/y", "x/*/y"};
+  db = test_setup_keys("{\"x\":[{\"y\":5},{\"y\":6}]}", array,
+                       STATIC_ARRAY_SIZE(array));
+  EXPECT_EQ_INT(5, (int)test_metric(db, "x/0/y"));
+  EXPECT_EQ_INT(6, (int)test_metric(db, "x/*/y"));
+  EXPECT_EQ_STR("x-1-y", db->curl_errbuf);
+  test_teardown(db);
+
+  /* A key may only be configured once. */
+  db = calloc(1, sizeof(*db));
+  cj_key_t *keys[2];
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(keys); i++) {
+    keys[i] = calloc(1, sizeof(*keys[i]));
+    keys[i]->path = strdup("a/b");
+    keys[i]->type = strdup("MAGIC");
+  }
+  EXPECT_EQ_INT(0, cj_append_key(db, keys[0]));
+  EXPECT_EQ_INT(EEXIST, cj_append_key(db, keys[1]));
+  cj_key_free(keys[1]);
+  cj_free(db);
+
+  return 0;
+}
+
 int main(int argc, char **argv) {
   cj_submit = test_submit;
 
   RUN_TEST(parse);
+  RUN_TEST(key_tree);
 
   END_TEST;
 }
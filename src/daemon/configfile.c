@@ -110,12 +110,15 @@ static cf_global_option_t cf_global_options[] = {
     {"WriteThreads", NULL, 0, "5"},
     {"WriteQueueLimitHigh", NULL, 0, NULL},
     {"WriteQueueLimitLow", NULL, 0, NULL},
+    {"LogQueueLength", NULL, 0, "0"},
     {"Timeout", NULL, 0, "2"},
     {"AutoLoadPlugin", NULL, 0, "false"},
     {"CollectInternalStats", NULL, 0, "false"},
     {"PreCacheChain", NULL, 0, "PreCache"},
     {"PostCacheChain", NULL, 0, "PostCache"},
-    {"MaxReadInterval", NULL, 0, "86400"}};
+    {"MaxReadInterval", NULL, 0, "86400"},
+    {"HistoryWindow", NULL, 0, NULL},
+    {"HistoryMemoryLimit", NULL, 0, "128"}};
 static int cf_global_options_num = STATIC_ARRAY_SIZE(cf_global_options);
 
 static int cf_default_typesdb = 1;
@@ -277,7 +280,13 @@ static int dispatch_loadplugin(oconfig_item_t *ci) {
       cf_util_get_cdtime(child, &ctx.flush_interval);
     else if (strcasecmp("FlushTimeout", child->key) == 0)
       cf_util_get_cdtime(child, &ctx.flush_timeout);
-    else {
+    else if (strcasecmp("ReadThreadPool", child->key) == 0) {
+      char *pool_name = NULL;
+      if (cf_util_get_string(child, &pool_name) == 0) {
+        ctx.read_pool = plugin_get_read_pool(pool_name);
+        sfree(pool_name);
+      }
+    } else {
       WARNING("Ignoring unknown LoadPlugin option \"%s\" "
               "for plugin \"%s\"",
               child->key, ci->values[0].value.string);
@@ -416,6 +425,52 @@ static int dispatch_block_plugin(oconfig_item_t *ci) {
   return 0;
 }
 
+static int dispatch_block_read_pool(oconfig_item_t *ci) {
+  read_pool_t *pool;
+  char *name = NULL;
+  int status;
+
+  status = cf_util_get_string(ci, &name);
+  if (status != 0) {
+    ERROR("The `ReadThreadPool' block needs exactly one string argument.");
+    return status;
+  }
+
+  if (strcasecmp("default", name) == 0) {
+    ERROR("The size of the default read thread pool is set with the "
+          "`ReadThreads' option.");
+    sfree(name);
+    return -1;
+  }
+
+  pool = plugin_define_read_pool(name);
+  sfree(name);
+  if (pool == NULL)
+    return -1;
+
+  for (int i = 0; i < ci->children_num; ++i) {
+    oconfig_item_t *child = ci->children + i;
+
+    if (strcasecmp("Threads", child->key) == 0) {
+      int threads = 0;
+      status = cf_util_get_int(child, &threads);
+      if ((status == 0) && (threads < 1)) {
+        ERROR("ReadThreadPool: `Threads' must be positive.");
+        status = -1;
+      }
+      if (status == 0)
+        status = plugin_set_read_pool_threads(pool, (size_t)threads);
+    } else {
+      WARNING("Ignoring unknown ReadThreadPool option \"%s\".", child->key);
+    }
+
+    if (status != 0)
+      return status;
+  }
+
+  return 0;
+} /* int dispatch_block_read_pool */
+
 static int dispatch_block(oconfig_item_t *ci) {
   if (strcasecmp(ci->key, "LoadPlugin") == 0)
     return dispatch_loadplugin(ci);
@@ -423,6 +478,8 @@ static int dispatch_block(oconfig_item_t *ci) {
     return dispatch_block_plugin(ci);
   else if (strcasecmp(ci->key, "Chain") == 0)
     return fc_configure(ci);
+  else if (strcasecmp(ci->key, "ReadThreadPool") == 0)
+    return dispatch_block_read_pool(ci);
 
   return 0;
 }
@@ -1024,6 +1081,11 @@ int cf_read(const char *filename) {
 
   oconfig_free(conf);
 
+  /* Read thread pools may be defined after the plugins using them, so their
+   * names can only be checked once the whole file has been read. */
+  if (plugin_check_read_pools() != 0)
+    ret = -1;
+
   /* Read the default types.db if no `TypesDB' option was given. */
   if (cf_default_typesdb) {
     if (read_types_list(PKGDATADIR "/types.db") != 0)
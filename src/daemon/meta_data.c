@@ -409,6 +409,30 @@ int meta_data_toc(meta_data_t *md, char ***toc) /* {{{ */
   return count;
 } /* }}} int meta_data_toc */
 
+int meta_data_iterate(meta_data_t *md, /* {{{ */
+                      meta_data_iterate_cb callback, void *user_data) {
+  int status = 0;
+
+  if ((md == NULL) || (callback == NULL))
+    return -EINVAL;
+
+  pthread_mutex_lock(&md->lock);
+
+  for (meta_entry_t *e = md->head; (e != NULL) && (status == 0); e = e->next) {
+    void const *value;
+
+    if (e->type == MD_TYPE_STRING)
+      value = e->value.mv_string;
+    else
+      value = &e->value;
+
+    status = callback(e->key, e->type, value, user_data);
+  }
+
+  pthread_mutex_unlock(&md->lock);
+  return status;
+} /* }}} int meta_data_iterate */
+
 int meta_data_delete(meta_data_t *md, const char *key) /* {{{ */
 {
   meta_entry_t *this;
@@ -579,6 +603,41 @@ int meta_data_get_string(meta_data_t *md, /* {{{ */
   return 0;
 } /* }}} int meta_data_get_string */
 
+int meta_data_get_string_buffer(meta_data_t *md, /* {{{ */
+                                const char *key, char *buffer,
+                                size_t buffer_size) {
+  meta_entry_t *e;
+  size_t len;
+
+  if ((md == NULL) || (key == NULL) || (buffer == NULL) || (buffer_size == 0))
+    return -EINVAL;
+
+  pthread_mutex_lock(&md->lock);
+
+  e = md_entry_lookup(md, key);
+  if (e == NULL) {
+    pthread_mutex_unlock(&md->lock);
+    return -ENOENT;
+  }
+
+  if (e->type != MD_TYPE_STRING) {
+    ERROR("meta_data_get_string_buffer: Type mismatch for key `%s'", e->key);
+    pthread_mutex_unlock(&md->lock);
+    return -ENOENT;
+  }
+
+  len = strlen(e->value.mv_string);
+  if (len >= buffer_size) {
+    pthread_mutex_unlock(&md->lock);
+    return -ENOMEM;
+  }
+  memcpy(buffer, e->value.mv_string, len + 1);
+
+  pthread_mutex_unlock(&md->lock);
+
+  return 0;
+} /* }}} int meta_data_get_string_buffer */
+
 int meta_data_get_signed_int(meta_data_t *md, /* {{{ */
                              const char *key, int64_t *value) {
   meta_entry_t *e;
@@ -49,6 +49,16 @@ void meta_data_destroy(meta_data_t *md);
 int meta_data_exists(meta_data_t *md, const char *key);
 int meta_data_type(meta_data_t *md, const char *key);
 int meta_data_toc(meta_data_t *md, char ***toc);
+
+/* Calls "callback" for each entry, in the order of meta_data_toc(), without
+ * copying keys or values. "value" points to the value's type: a "char const"
+ * for MD_TYPE_STRING, an "int64_t" for MD_TYPE_SIGNED_INT and so on. The
+ * meta data is locked meanwhile, so the callback must not use "md". Stops at
+ * the first non-zero return value of the callback and returns it. */
+typedef int (*meta_data_iterate_cb)(char const *key, int type,
+                                    void const *value, void *user_data);
+int meta_data_iterate(meta_data_t *md, meta_data_iterate_cb callback,
+                      void *user_data);
 int meta_data_delete(meta_data_t *md, const char *key);
 
 int meta_data_add_string(meta_data_t *md, const char *key, const char *value);
@@ -59,6 +69,10 @@ int meta_data_add_double(meta_data_t *md, const char *key, double value);
 int meta_data_add_boolean(meta_data_t *md, const char *key, _Bool value);
 
 int meta_data_get_string(meta_data_t *md, const char *key, char **value);
+/* Copies the string into "buffer" without allocating memory. Returns -ENOMEM
+ * if the string does not fit. */
+int meta_data_get_string_buffer(meta_data_t *md, const char *key,
+                                char *buffer, size_t buffer_size);
 int meta_data_get_signed_int(meta_data_t *md, const char *key, int64_t *value);
 int meta_data_get_unsigned_int(meta_data_t *md, const char *key,
                                uint64_t *value);
@@ -74,6 +74,11 @@ DEF_TEST(base) {
   EXPECT_EQ_STR("foobar", s);
   sfree(s);
 
+  char buffer[8];
+  CHECK_ZERO(meta_data_get_string_buffer(m, "string", buffer, sizeof(buffer)));
+  EXPECT_EQ_STR("foobar", buffer);
+  EXPECT_EQ_INT(-ENOMEM, meta_data_get_string_buffer(m, "string", buffer, 6));
+
   CHECK_ZERO(meta_data_get_signed_int(m, "signed_int", &si));
   EXPECT_EQ_INT(-1, (int)si);
 
@@ -92,6 +97,8 @@ DEF_TEST(base) {
   EXPECT_EQ_INT(-2, meta_data_get_string(m, "unsigned_int", &s));
   EXPECT_EQ_INT(-2, meta_data_get_string(m, "double", &s));
   EXPECT_EQ_INT(-2, meta_data_get_string(m, "boolean", &s));
+  EXPECT_EQ_INT(-2, meta_data_get_string_buffer(m, "boolean", buffer,
+                                                sizeof(buffer)));
 
   /* replace existing keys */
   CHECK_ZERO(meta_data_add_signed_int(m, "string", 666));
@@ -109,8 +116,51 @@ DEF_TEST(base) {
   return 0;
 }
 
+static int iterate_cb(char const *key, int type, void const *value,
+                      void *user_data) {
+  char *buffer = user_data;
+  size_t len = strlen(buffer);
+
+  if (type == MD_TYPE_STRING)
+    snprintf(buffer + len, 64 - len, "%s=%s;", key, (char const *)value);
+  else if (type == MD_TYPE_SIGNED_INT)
+    snprintf(buffer + len, 64 - len, "%s=%" PRIi64 ";", key,
+             *(int64_t const *)value);
+  else if (type == MD_TYPE_BOOLEAN)
+    snprintf(buffer + len, 64 - len, "%s=%d;", key, *(_Bool const *)value);
+  else
+    return -1;
+
+  return 0;
+}
+
+DEF_TEST(iterate) {
+  meta_data_t *m;
+  char buffer[64] = "";
+
+  CHECK_NOT_NULL(m = meta_data_create());
+  CHECK_ZERO(meta_data_iterate(m, iterate_cb, buffer));
+  EXPECT_EQ_STR("", buffer);
+
+  CHECK_ZERO(meta_data_add_string(m, "string", "foobar"));
+  CHECK_ZERO(meta_data_add_signed_int(m, "signed_int", -1));
+  CHECK_ZERO(meta_data_add_boolean(m, "boolean", 1));
+  CHECK_ZERO(meta_data_iterate(m, iterate_cb, buffer));
+  EXPECT_EQ_STR("string=foobar;signed_int=-1;boolean=1;", buffer);
+
+  /* The callback's return value stops the iteration. */
+  CHECK_ZERO(meta_data_add_double(m, "double", 47.11));
+  buffer[0] = 0;
+  EXPECT_EQ_INT(-1, meta_data_iterate(m, iterate_cb, buffer));
+  EXPECT_EQ_STR("string=foobar;signed_int=-1;boolean=1;", buffer);
+
+  meta_data_destroy(m);
+  return 0;
+}
+
 int main(void) {
   RUN_TEST(base);
+  RUN_TEST(iterate);
 
   END_TEST;
 }
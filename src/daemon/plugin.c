@@ -38,7 +38,9 @@
 #include "utils_cache.h"
 #include "utils_complain.h"
 #include "utils_heap.h"
+#include "utils_history.h"
 #include "utils_llist.h"
+#include "utils_log_ring.h"
 #include "utils_random.h"
 #include "utils_time.h"
 
@@ -55,6 +57,7 @@ struct callback_func_s {
   void *cf_callback;
   user_data_t cf_udata;
   plugin_ctx_t cf_ctx;
+  int cf_log_level; /* log callbacks only, see plugin_set_log_level() */
 };
 typedef struct callback_func_s callback_func_t;
 
@@ -74,9 +77,34 @@ struct read_func_s {
   cdtime_t rf_interval;
   cdtime_t rf_effective_interval;
   cdtime_t rf_next_read;
+  read_pool_t *rf_pool;
 };
 typedef struct read_func_s read_func_t;
 
+/* Each pool has its own heap of read functions and its own threads. The
+ * heaps, the condition variables and the statistics are protected by
+ * `read_lock'. */
+struct read_pool_s {
+  char *name;
+  /* set by a <ReadThreadPool> block; always set for the default pool */
+  _Bool defined;
+  size_t threads_max;
+  c_heap_t *heap;
+  pthread_cond_t cond;
+  pthread_t *threads;
+  size_t threads_num;
+
+  /* statistics */
+  size_t threads_busy;
+  derive_t reads;
+  derive_t failures;
+  derive_t overruns;
+  derive_t skipped;
+  cdtime_t max_delay;
+
+  read_pool_t *next;
+};
+
 struct write_queue_s;
 typedef struct write_queue_s write_queue_t;
 struct write_queue_s {
@@ -114,13 +142,11 @@ static char *plugindir = NULL;
 #ifndef DEFAULT_MAX_READ_INTERVAL
 #define DEFAULT_MAX_READ_INTERVAL TIME_T_TO_CDTIME_T_STATIC(86400)
 #endif
-static c_heap_t *read_heap = NULL;
+#define DEFAULT_READ_POOL "default"
+static read_pool_t *read_pools = NULL; /* the default pool comes first */
 static llist_t *read_list;
 static int read_loop = 1;
 static pthread_mutex_t read_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t read_cond = PTHREAD_COND_INITIALIZER;
-static pthread_t *read_threads = NULL;
-static size_t read_threads_num = 0;
 static cdtime_t max_read_interval = DEFAULT_MAX_READ_INTERVAL;
 
 static write_queue_t *write_queue_head;
@@ -141,6 +167,25 @@ static long write_limit_low = 0;
 static derive_t stats_values_dropped = 0;
 static _Bool record_statistics = 0;
 
+/* Least important severity any log callback is interested in. Messages below
+ * it are discarded before they are formatted. */
+static int log_level_max = LOG_DEBUG;
+
+/* With "LogQueueLength", plugin_log() only copies messages into log_ring and
+ * the log thread calls the log callbacks. The ring is never freed, because
+ * other threads may still be logging while the daemon shuts down. Only one
+ * thread at a time may take messages from the ring, which is ensured by
+ * log_drain_lock. */
+static log_ring_t *log_ring = NULL;
+static _Bool log_async = 0;
+static _Bool log_loop = 1;
+static _Bool log_thread_waiting = 0;
+static uint64_t log_dropped = 0;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t log_thread;
+
 /*
  * Static functions
  */
@@ -153,6 +198,66 @@ static const char *plugin_get_dir(void) {
     return plugindir;
 }
 
+static void plugin_update_read_pool_statistics(void) /* {{{ */
+{
+  value_list_t vl = VALUE_LIST_INIT;
+
+  sstrncpy(vl.plugin, "collectd", sizeof(vl.plugin));
+  vl.interval = plugin_get_interval();
+  vl.values_len = 1;
+
+  for (read_pool_t *pool = read_pools; pool != NULL; pool = pool->next) {
+    gauge_t threads_total, threads_busy, max_delay;
+    derive_t reads, failures, overruns, skipped;
+
+    pthread_mutex_lock(&read_lock);
+    threads_total = (gauge_t)pool->threads_num;
+    threads_busy = (gauge_t)pool->threads_busy;
+    reads = pool->reads;
+    failures = pool->failures;
+    overruns = pool->overruns;
+    skipped = pool->skipped;
+    max_delay = CDTIME_T_TO_DOUBLE(pool->max_delay);
+    pool->max_delay = 0;
+    pthread_mutex_unlock(&read_lock);
+
+    ssnprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "read_pool-%s",
+              pool->name);
+
+    /* Read pool : threads */
+    sstrncpy(vl.type, "threads", sizeof(vl.type));
+    vl.values = &(value_t){.gauge = threads_total};
+    sstrncpy(vl.type_instance, "total", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+    vl.values = &(value_t){.gauge = threads_busy};
+    sstrncpy(vl.type_instance, "busy", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+
+    /* Read pool : reads, failed reads, reads that took longer than their
+     * interval and reads skipped because the pool was behind schedule */
+    sstrncpy(vl.type, "derive", sizeof(vl.type));
+    vl.values = &(value_t){.derive = reads};
+    sstrncpy(vl.type_instance, "reads", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+    vl.values = &(value_t){.derive = failures};
+    sstrncpy(vl.type_instance, "failures", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+    vl.values = &(value_t){.derive = overruns};
+    sstrncpy(vl.type_instance, "overruns", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+    vl.values = &(value_t){.derive = skipped};
+    sstrncpy(vl.type_instance, "skipped", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+
+    /* Read pool : largest delay between the time a read was due and the
+     * time it was started, since the last report */
+    sstrncpy(vl.type, "duration", sizeof(vl.type));
+    vl.values = &(value_t){.gauge = max_delay};
+    sstrncpy(vl.type_instance, "max_delay", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+  }
+} /* }}} void plugin_update_read_pool_statistics */
+
 static int plugin_update_internal_statistics(void) { /* {{{ */
   gauge_t copy_write_queue_length = (gauge_t)write_queue_length;
 
@@ -188,6 +293,34 @@ static int plugin_update_internal_statistics(void) { /* {{{ */
   vl.type_instance[0] = 0;
   plugin_dispatch_values(&vl);
 
+  /* History store */
+  uh_stats_t history;
+  if (uh_enabled() && (uh_stats(&history) == 0)) {
+    sstrncpy(vl.plugin_instance, "history", sizeof(vl.plugin_instance));
+
+    vl.values = &(value_t){.gauge = (gauge_t)history.memory};
+    sstrncpy(vl.type, "memory", sizeof(vl.type));
+    vl.type_instance[0] = 0;
+    plugin_dispatch_values(&vl);
+
+    vl.values = &(value_t){.gauge = (gauge_t)history.series_num};
+    sstrncpy(vl.type, "count", sizeof(vl.type));
+    sstrncpy(vl.type_instance, "series", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+
+    vl.values = &(value_t){.gauge = (gauge_t)history.points_num};
+    sstrncpy(vl.type_instance, "points", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+
+    vl.values = &(value_t){.derive = (derive_t)history.evicted};
+    sstrncpy(vl.type, "derive", sizeof(vl.type));
+    sstrncpy(vl.type_instance, "evicted", sizeof(vl.type_instance));
+    plugin_dispatch_values(&vl);
+  }
+
+  /* Read thread pools */
+  plugin_update_read_pool_statistics();
+
   return 0;
 } /* }}} int plugin_update_internal_statistics */
 
@@ -233,24 +366,29 @@ static void destroy_all_callbacks(llist_t **list) /* {{{ */
   *list = NULL;
 } /* }}} void destroy_all_callbacks */
 
-static void destroy_read_heap(void) /* {{{ */
+static void destroy_read_pools(void) /* {{{ */
 {
-  if (read_heap == NULL)
-    return;
+  while (read_pools != NULL) {
+    read_pool_t *pool = read_pools;
+    read_pools = pool->next;
 
-  while (42) {
-    read_func_t *rf;
+    while (pool->heap != NULL) {
+      read_func_t *rf;
 
-    rf = c_heap_get_root(read_heap);
-    if (rf == NULL)
-      break;
-    sfree(rf->rf_name);
-    destroy_callback((callback_func_t *)rf);
-  }
+      rf = c_heap_get_root(pool->heap);
+      if (rf == NULL)
+        break;
+      sfree(rf->rf_name);
+      destroy_callback((callback_func_t *)rf);
+    }
 
-  c_heap_destroy(read_heap);
-  read_heap = NULL;
-} /* }}} void destroy_read_heap */
+    c_heap_destroy(pool->heap);
+    pthread_cond_destroy(&pool->cond);
+    sfree(pool->threads);
+    sfree(pool->name);
+    sfree(pool);
+  }
+} /* }}} void destroy_read_pools */
 
 static int register_callback(llist_t **list, /* {{{ */
                              const char *name, callback_func_t *cf) {
@@ -364,6 +502,7 @@ static int create_register_callback(llist_t **list, /* {{{ */
   }
 
   cf->cf_ctx = plugin_get_ctx();
+  cf->cf_log_level = LOG_DEBUG;
 
   return register_callback(list, name, cf);
 } /* }}} int create_register_callback */
@@ -436,7 +575,9 @@ static int plugin_load_file(const char *file, _Bool global) {
   return 0;
 }
 
-static void *plugin_read_thread(void __attribute__((unused)) * args) {
+static void *plugin_read_thread(void *args) {
+  read_pool_t *pool = args;
+
   while (read_loop != 0) {
     read_func_t *rf;
     plugin_ctx_t old_ctx;
@@ -452,9 +593,9 @@ static void *plugin_read_thread(void __attribute__((unused)) * args) {
      * to call c_heap_get_root() and pthread_cond_wait() in the
      * same protected block. */
     pthread_mutex_lock(&read_lock);
-    rf = c_heap_get_root(read_heap);
+    rf = c_heap_get_root(pool->heap);
     if (rf == NULL) {
-      pthread_cond_wait(&read_cond, &read_lock);
+      pthread_cond_wait(&pool->cond, &read_lock);
       pthread_mutex_unlock(&read_lock);
       continue;
     }
@@ -479,7 +620,7 @@ static void *plugin_read_thread(void __attribute__((unused)) * args) {
      * pthread_cond_timedwait returns. */
     rc = 0;
     while ((read_loop != 0) && (cdtime() < rf->rf_next_read) && rc == 0) {
-      rc = pthread_cond_timedwait(&read_cond, &read_lock,
+      rc = pthread_cond_timedwait(&pool->cond, &read_lock,
                                   &CDTIME_T_TO_TIMESPEC(rf->rf_next_read));
     }
 
@@ -491,7 +632,7 @@ static void *plugin_read_thread(void __attribute__((unused)) * args) {
      * the sleep, too. */
     if (read_loop == 0) {
       /* Insert `rf' again, so it can be free'd correctly */
-      c_heap_insert(read_heap, rf);
+      c_heap_insert(pool->heap, rf);
       break;
     }
 
@@ -511,6 +652,10 @@ static void *plugin_read_thread(void __attribute__((unused)) * args) {
 
     DEBUG("plugin_read_thread: Handling `%s'.", rf->rf_name);
 
+    pthread_mutex_lock(&read_lock);
+    pool->threads_busy++;
+    pthread_mutex_unlock(&read_lock);
+
     start = cdtime();
 
     old_ctx = plugin_set_ctx(rf->rf_ctx);
@@ -552,6 +697,18 @@ static void *plugin_read_thread(void __attribute__((unused)) * args) {
     /* calculate the time spent in the read function */
     elapsed = (now - start);
 
+    pthread_mutex_lock(&read_lock);
+    pool->threads_busy--;
+    pool->reads++;
+    if (status != 0)
+      pool->failures++;
+    if (elapsed > rf->rf_effective_interval)
+      pool->overruns++;
+    if ((start > rf->rf_next_read) &&
+        ((start - rf->rf_next_read) > pool->max_delay))
+      pool->max_delay = start - rf->rf_next_read;
+    pthread_mutex_unlock(&read_lock);
+
     if (elapsed > rf->rf_effective_interval)
       WARNING(
           "plugin_read_thread: read-function of the `%s' plugin took %.3f "
@@ -578,13 +735,17 @@ static void *plugin_read_thread(void __attribute__((unused)) * args) {
        * so this value doesn't trail off into the
        * past too much. */
       rf->rf_next_read = now;
+
+      pthread_mutex_lock(&read_lock);
+      pool->skipped++;
+      pthread_mutex_unlock(&read_lock);
     }
 
     DEBUG("plugin_read_thread: Next read of the `%s' plugin at %.3f.",
           rf->rf_name, CDTIME_T_TO_DOUBLE(rf->rf_next_read));
 
     /* Re-insert this read function into the heap again. */
-    c_heap_insert(read_heap, rf);
+    c_heap_insert(pool->heap, rf);
   } /* while (read_loop) */
 
   pthread_exit(NULL);
@@ -621,22 +782,22 @@ static void set_thread_name(pthread_t tid, char const *name) {
 #endif
 }
 
-static void start_read_threads(size_t num) /* {{{ */
+static void start_read_threads(read_pool_t *pool, size_t num) /* {{{ */
 {
-  if (read_threads != NULL)
+  if (pool->threads != NULL)
     return;
 
-  read_threads = (pthread_t *)calloc(num, sizeof(pthread_t));
-  if (read_threads == NULL) {
+  pool->threads = (pthread_t *)calloc(num, sizeof(pthread_t));
+  if (pool->threads == NULL) {
     ERROR("plugin: start_read_threads: calloc failed.");
     return;
   }
 
-  read_threads_num = 0;
+  pool->threads_num = 0;
   for (size_t i = 0; i < num; i++) {
-    int status = pthread_create(read_threads + read_threads_num,
+    int status = pthread_create(pool->threads + pool->threads_num,
                                 /* attr = */ NULL, plugin_read_thread,
-                                /* arg = */ NULL);
+                                /* arg = */ pool);
     if (status != 0) {
       char errbuf[1024];
       ERROR("plugin: start_read_threads: pthread_create failed "
@@ -646,33 +807,44 @@ static void start_read_threads(size_t num) /* {{{ */
     }
 
     char name[THREAD_NAME_MAX];
-    snprintf(name, sizeof(name), "reader#%zu", read_threads_num);
-    set_thread_name(read_threads[read_threads_num], name);
+    if (pool == read_pools)
+      snprintf(name, sizeof(name), "reader#%zu", pool->threads_num);
+    else
+      snprintf(name, sizeof(name), "reader#%zu/%s", pool->threads_num,
+               pool->name);
+    set_thread_name(pool->threads[pool->threads_num], name);
 
-    read_threads_num++;
+    pool->threads_num++;
   } /* for (i) */
 } /* }}} void start_read_threads */
 
 static void stop_read_threads(void) {
-  if (read_threads == NULL)
+  size_t threads_num = 0;
+
+  for (read_pool_t *pool = read_pools; pool != NULL; pool = pool->next)
+    threads_num += pool->threads_num;
+  if (threads_num == 0)
     return;
 
-  INFO("collectd: Stopping %zu read threads.", read_threads_num);
+  INFO("collectd: Stopping %zu read threads.", threads_num);
 
   pthread_mutex_lock(&read_lock);
   read_loop = 0;
-  DEBUG("plugin: stop_read_threads: Signalling `read_cond'");
-  pthread_cond_broadcast(&read_cond);
+  DEBUG("plugin: stop_read_threads: Signalling read pools");
+  for (read_pool_t *pool = read_pools; pool != NULL; pool = pool->next)
+    pthread_cond_broadcast(&pool->cond);
   pthread_mutex_unlock(&read_lock);
 
-  for (size_t i = 0; i < read_threads_num; i++) {
-    if (pthread_join(read_threads[i], NULL) != 0) {
-      ERROR("plugin: stop_read_threads: pthread_join failed.");
+  for (read_pool_t *pool = read_pools; pool != NULL; pool = pool->next) {
+    for (size_t i = 0; i < pool->threads_num; i++) {
+      if (pthread_join(pool->threads[i], NULL) != 0) {
+        ERROR("plugin: stop_read_threads: pthread_join failed.");
+      }
+      pool->threads[i] = (pthread_t)0;
     }
-    read_threads[i] = (pthread_t)0;
+    sfree(pool->threads);
+    pool->threads_num = 0;
   }
-  sfree(read_threads);
-  read_threads_num = 0;
 } /* void stop_read_threads */
 
 static void plugin_value_list_free(value_list_t *vl) /* {{{ */
@@ -742,19 +914,19 @@ plugin_value_list_clone(value_list_t const *vl_orig) /* {{{ */
   return vl;
 } /* }}} value_list_t *plugin_value_list_clone */
 
-static int plugin_write_enqueue(value_list_t const *vl) /* {{{ */
+static write_queue_t *plugin_write_queue_entry(value_list_t const *vl) /* {{{ */
 {
   write_queue_t *q;
 
   q = malloc(sizeof(*q));
   if (q == NULL)
-    return ENOMEM;
+    return NULL;
   q->next = NULL;
 
   q->vl = plugin_value_list_clone(vl);
   if (q->vl == NULL) {
     sfree(q);
-    return ENOMEM;
+    return NULL;
   }
 
   /* Store context of caller (read plugin); otherwise, it would not be
@@ -762,21 +934,40 @@ static int plugin_write_enqueue(value_list_t const *vl) /* {{{ */
    * value-list later on. */
   q->ctx = plugin_get_ctx();
 
+  return q;
+} /* }}} write_queue_t *plugin_write_queue_entry */
+
+/* Appends the list of "num" entries from "head" to "tail" to the write queue
+ * while holding the lock once. */
+static void plugin_write_enqueue_list(write_queue_t *head, write_queue_t *tail,
+                                      long num) /* {{{ */
+{
   pthread_mutex_lock(&write_lock);
 
   if (write_queue_tail == NULL) {
-    write_queue_head = q;
-    write_queue_tail = q;
-    write_queue_length = 1;
+    write_queue_head = head;
+    write_queue_tail = tail;
+    write_queue_length = num;
   } else {
-    write_queue_tail->next = q;
-    write_queue_tail = q;
-    write_queue_length += 1;
+    write_queue_tail->next = head;
+    write_queue_tail = tail;
+    write_queue_length += num;
   }
 
-  pthread_cond_signal(&write_cond);
+  if (num > 1)
+    pthread_cond_broadcast(&write_cond);
+  else
+    pthread_cond_signal(&write_cond);
   pthread_mutex_unlock(&write_lock);
+} /* }}} void plugin_write_enqueue_list */
+
+static int plugin_write_enqueue(value_list_t const *vl) /* {{{ */
+{
+  write_queue_t *q = plugin_write_queue_entry(vl);
+  if (q == NULL)
+    return ENOMEM;
 
+  plugin_write_enqueue_list(q, q, 1);
   return 0;
 } /* }}} int plugin_write_enqueue */
 
@@ -906,6 +1097,122 @@ static void stop_write_threads(void) /* {{{ */
   }
 } /* }}} void stop_write_threads */
 
+static void log_dispatch(int level, char const *msg) /* {{{ */
+{
+  for (llentry_t *le = llist_head(list_log); le != NULL; le = le->next) {
+    callback_func_t *cf = le->value;
+    plugin_log_cb callback = cf->cf_callback;
+
+    if (level > cf->cf_log_level)
+      continue;
+
+    /* do not switch plugin context; rather keep the context
+     * (interval) information of the calling plugin */
+
+    (*callback)(level, msg, &cf->cf_udata);
+  }
+} /* }}} void log_dispatch */
+
+static void log_dispatch_dropped(void) /* {{{ */
+{
+  uint64_t dropped = __atomic_exchange_n(&log_dropped, 0, __ATOMIC_RELAXED);
+  if (dropped == 0)
+    return;
+
+  char msg[128];
+  snprintf(msg, sizeof(msg),
+           "plugin_log: %" PRIu64 " messages have been dropped because the "
+           "log queue was full.",
+           dropped);
+  log_dispatch(LOG_WARNING, msg);
+} /* }}} void log_dispatch_dropped */
+
+/* log_drain dispatches all messages in log_ring. */
+static void log_drain(void) /* {{{ */
+{
+  char msg[LOG_RING_MESSAGE_SIZE];
+  int level;
+
+  pthread_mutex_lock(&log_drain_lock);
+  while (log_ring_pop(log_ring, &level, msg, sizeof(msg)) == 0)
+    log_dispatch(level, msg);
+  log_dispatch_dropped();
+  pthread_mutex_unlock(&log_drain_lock);
+} /* }}} void log_drain */
+
+static void *plugin_log_thread(void __attribute__((unused)) * args) /* {{{ */
+{
+  pthread_mutex_lock(&log_lock);
+  while (log_loop) {
+    pthread_mutex_unlock(&log_lock);
+
+    log_drain();
+
+    pthread_mutex_lock(&log_lock);
+    /* Producers only signal log_cond if the flag is set, so it has to be
+     * visible before the ring is checked for the last time. */
+    __atomic_store_n(&log_thread_waiting, 1, __ATOMIC_SEQ_CST);
+    if (log_loop && log_ring_empty(log_ring)) {
+      cdtime_t timeout = cdtime() + TIME_T_TO_CDTIME_T(1);
+      pthread_cond_timedwait(&log_cond, &log_lock,
+                             &CDTIME_T_TO_TIMESPEC(timeout));
+    }
+    __atomic_store_n(&log_thread_waiting, 0, __ATOMIC_SEQ_CST);
+  }
+  pthread_mutex_unlock(&log_lock);
+
+  return NULL;
+} /* }}} void *plugin_log_thread */
+
+static void start_log_thread(size_t queue_length) /* {{{ */
+{
+  if ((queue_length == 0) || log_async)
+    return;
+
+  if (log_ring == NULL) {
+    log_ring = log_ring_create(queue_length);
+    if (log_ring == NULL) {
+      ERROR("plugin: start_log_thread: log_ring_create failed.");
+      return;
+    }
+  }
+
+  log_loop = 1;
+  int status = pthread_create(&log_thread, /* attr = */ NULL,
+                              plugin_log_thread, /* arg = */ NULL);
+  if (status != 0) {
+    char errbuf[1024];
+    ERROR("plugin: start_log_thread: pthread_create failed "
+          "with status %i (%s).",
+          status, sstrerror(status, errbuf, sizeof(errbuf)));
+    return;
+  }
+  set_thread_name(log_thread, "logger");
+
+  __atomic_store_n(&log_async, 1, __ATOMIC_RELEASE);
+} /* }}} void start_log_thread */
+
+static void stop_log_thread(void) /* {{{ */
+{
+  if (!log_async)
+    return;
+
+  /* New messages are handled synchronously from here on. Threads which have
+   * seen log_async set may still push messages; plugin_log() checks the flag
+   * again afterwards and drains the ring itself if it has been cleared. */
+  __atomic_store_n(&log_async, 0, __ATOMIC_SEQ_CST);
+
+  pthread_mutex_lock(&log_lock);
+  log_loop = 0;
+  pthread_cond_broadcast(&log_cond);
+  pthread_mutex_unlock(&log_lock);
+
+  pthread_join(log_thread, NULL);
+
+  /* Messages pushed while the thread was shutting down. */
+  log_drain();
+} /* }}} void stop_log_thread */
+
 /*
  * Public functions
  */
@@ -1102,6 +1409,12 @@ static int plugin_insert_read(read_func_t *rf) {
   rf->rf_next_read = cdtime();
   rf->rf_effective_interval = rf->rf_interval;
 
+  if (rf->rf_pool == NULL) {
+    rf->rf_pool = plugin_get_read_pool(DEFAULT_READ_POOL);
+    if (rf->rf_pool == NULL)
+      return -1;
+  }
+
   pthread_mutex_lock(&read_lock);
 
   if (read_list == NULL) {
@@ -1113,15 +1426,6 @@ static int plugin_insert_read(read_func_t *rf) {
     }
   }
 
-  if (read_heap == NULL) {
-    read_heap = c_heap_create(plugin_compare_read_func);
-    if (read_heap == NULL) {
-      pthread_mutex_unlock(&read_lock);
-      ERROR("plugin_insert_read: c_heap_create failed.");
-      return -1;
-    }
-  }
-
   le = llist_search(read_list, rf->rf_name);
   if (le != NULL) {
     pthread_mutex_unlock(&read_lock);
@@ -1138,7 +1442,7 @@ static int plugin_insert_read(read_func_t *rf) {
     return -1;
   }
 
-  status = c_heap_insert(read_heap, rf);
+  status = c_heap_insert(rf->rf_pool->heap, rf);
   if (status != 0) {
     pthread_mutex_unlock(&read_lock);
     ERROR("plugin_insert_read: c_heap_insert failed.");
@@ -1149,12 +1453,110 @@ static int plugin_insert_read(read_func_t *rf) {
   /* This does not fail. */
   llist_append(read_list, le);
 
-  /* Wake up all the read threads. */
-  pthread_cond_broadcast(&read_cond);
+  /* Wake up all the read threads of the pool. */
+  pthread_cond_broadcast(&rf->rf_pool->cond);
   pthread_mutex_unlock(&read_lock);
   return 0;
 } /* int plugin_insert_read */
 
+read_pool_t *plugin_get_read_pool(const char *name) /* {{{ */
+{
+  read_pool_t *pool;
+
+  if (name == NULL)
+    return NULL;
+
+  /* Make sure the default pool is the first one. */
+  if ((read_pools == NULL) && (strcmp(DEFAULT_READ_POOL, name) != 0))
+    if (plugin_get_read_pool(DEFAULT_READ_POOL) == NULL)
+      return NULL;
+
+  pthread_mutex_lock(&read_lock);
+  for (pool = read_pools; pool != NULL; pool = pool->next) {
+    if (strcmp(pool->name, name) == 0) {
+      pthread_mutex_unlock(&read_lock);
+      return pool;
+    }
+  }
+
+  pool = calloc(1, sizeof(*pool));
+  if (pool == NULL) {
+    pthread_mutex_unlock(&read_lock);
+    ERROR("plugin_get_read_pool: calloc failed.");
+    return NULL;
+  }
+
+  pool->name = strdup(name);
+  pool->heap = c_heap_create(plugin_compare_read_func);
+  if ((pool->name == NULL) || (pool->heap == NULL)) {
+    pthread_mutex_unlock(&read_lock);
+    ERROR("plugin_get_read_pool: Creating the pool \"%s\" failed.", name);
+    sfree(pool->name);
+    c_heap_destroy(pool->heap);
+    sfree(pool);
+    return NULL;
+  }
+  pthread_cond_init(&pool->cond, /* attr = */ NULL);
+  pool->threads_max = 1;
+  pool->defined = (strcmp(DEFAULT_READ_POOL, name) == 0);
+
+  if (read_pools == NULL) {
+    read_pools = pool;
+  } else {
+    read_pool_t *last = read_pools;
+    while (last->next != NULL)
+      last = last->next;
+    last->next = pool;
+  }
+  pthread_mutex_unlock(&read_lock);
+
+  return pool;
+} /* }}} read_pool_t *plugin_get_read_pool */
+
+read_pool_t *plugin_define_read_pool(const char *name) /* {{{ */
+{
+  read_pool_t *pool = plugin_get_read_pool(name);
+  if (pool == NULL)
+    return NULL;
+
+  pthread_mutex_lock(&read_lock);
+  pool->defined = 1;
+  pthread_mutex_unlock(&read_lock);
+
+  return pool;
+} /* }}} read_pool_t *plugin_define_read_pool */
+
+int plugin_check_read_pools(void) /* {{{ */
+{
+  int status = 0;
+
+  pthread_mutex_lock(&read_lock);
+  for (read_pool_t *pool = read_pools; pool != NULL; pool = pool->next) {
+    if (pool->defined)
+      continue;
+
+    ERROR("The read thread pool \"%s\" is used by a `LoadPlugin' block but "
+          "not defined by a `ReadThreadPool' block.",
+          pool->name);
+    status = -1;
+  }
+  pthread_mutex_unlock(&read_lock);
+
+  return status;
+} /* }}} int plugin_check_read_pools */
+
+int plugin_set_read_pool_threads(read_pool_t *pool, size_t num) /* {{{ */
+{
+  if ((pool == NULL) || (num == 0))
+    return EINVAL;
+
+  pthread_mutex_lock(&read_lock);
+  pool->threads_max = num;
+  pthread_mutex_unlock(&read_lock);
+
+  return 0;
+} /* }}} int plugin_set_read_pool_threads */
+
 int plugin_register_read(const char *name, int (*callback)(void)) {
   read_func_t *rf;
   int status;
@@ -1173,6 +1575,7 @@ int plugin_register_read(const char *name, int (*callback)(void)) {
   rf->rf_name = strdup(name);
   rf->rf_type = RF_SIMPLE;
   rf->rf_interval = plugin_get_interval();
+  rf->rf_pool = rf->rf_ctx.read_pool;
 
   status = plugin_insert_read(rf);
   if (status != 0) {
@@ -1214,6 +1617,7 @@ int plugin_register_complex_read(const char *group, const char *name,
   }
 
   rf->rf_ctx = plugin_get_ctx();
+  rf->rf_pool = rf->rf_ctx.read_pool;
 
   status = plugin_insert_read(rf);
   if (status != 0) {
@@ -1374,11 +1778,48 @@ int plugin_register_data_set(const data_set_t *ds) {
   return c_avl_insert(data_sets, (void *)ds_copy->type, (void *)ds_copy);
 } /* int plugin_register_data_set */
 
+static void log_update_level(void) /* {{{ */
+{
+  int level = LOG_ERR;
+
+  if ((list_log == NULL) || (llist_head(list_log) == NULL)) {
+    log_level_max = LOG_DEBUG;
+    return;
+  }
+
+  for (llentry_t *le = llist_head(list_log); le != NULL; le = le->next) {
+    callback_func_t *cf = le->value;
+    if (cf->cf_log_level > level)
+      level = cf->cf_log_level;
+  }
+
+  log_level_max = level;
+} /* }}} void log_update_level */
+
 int plugin_register_log(const char *name, plugin_log_cb callback,
                         user_data_t const *ud) {
-  return create_register_callback(&list_log, name, (void *)callback, ud);
+  int status = create_register_callback(&list_log, name, (void *)callback, ud);
+  log_update_level();
+  return status;
 } /* int plugin_register_log */
 
+int plugin_set_log_level(const char *name, int level) /* {{{ */
+{
+  llentry_t *le;
+
+  if (list_log == NULL)
+    return ENOENT;
+
+  le = llist_search(list_log, name);
+  if (le == NULL)
+    return ENOENT;
+
+  callback_func_t *cf = le->value;
+  cf->cf_log_level = level;
+  log_update_level();
+  return 0;
+} /* }}} int plugin_set_log_level */
+
 int plugin_register_notification(const char *name,
                                  plugin_notification_cb callback,
                                  user_data_t const *ud) {
@@ -1543,7 +1984,9 @@ int plugin_unregister_data_set(const char *name) {
 } /* int plugin_unregister_data_set */
 
 int plugin_unregister_log(const char *name) {
-  return plugin_unregister(list_log, name);
+  int status = plugin_unregister(list_log, name);
+  log_update_level();
+  return status;
 }
 
 int plugin_unregister_notification(const char *name) {
@@ -1559,6 +2002,16 @@ int plugin_init_all(void) {
   /* Init the value cache */
   uc_init();
 
+  /* Init the history store, which is disabled unless HistoryWindow is set. */
+  long history_limit = global_option_get_long("HistoryMemoryLimit",
+                                              /* default = */ 128);
+  if (history_limit < 0) {
+    ERROR("HistoryMemoryLimit must be positive or zero.");
+    history_limit = 128;
+  }
+  uh_init(global_option_get_time("HistoryWindow", /* default = */ 0),
+          (size_t)history_limit * 1048576);
+
   if (IS_TRUE(global_option_get("CollectInternalStats"))) {
     record_statistics = 1;
     plugin_register_read("collectd", plugin_update_internal_statistics);
@@ -1596,7 +2049,15 @@ int plugin_init_all(void) {
     write_threads_num = 5;
   }
 
-  if ((list_init == NULL) && (read_heap == NULL))
+  long log_queue_length = global_option_get_long("LogQueueLength",
+                                                 /* default = */ 0);
+  if (log_queue_length < 0) {
+    ERROR("LogQueueLength must be positive or zero.");
+    log_queue_length = 0;
+  }
+  start_log_thread((size_t)log_queue_length);
+
+  if ((list_init == NULL) && (read_list == NULL))
     return ret;
 
   /* Calling all init callbacks before checking if read callbacks
@@ -1636,14 +2097,18 @@ int plugin_init_all(void) {
       global_option_get_time("MaxReadInterval", DEFAULT_MAX_READ_INTERVAL);
 
   /* Start read-threads */
-  if (read_heap != NULL) {
+  if (read_list != NULL) {
     const char *rt;
     int num;
 
     rt = global_option_get("ReadThreads");
     num = atoi(rt);
-    if (num != -1)
-      start_read_threads((num > 0) ? ((size_t)num) : 5);
+    if (num != -1) {
+      start_read_threads(read_pools, (num > 0) ? ((size_t)num) : 5);
+      for (read_pool_t *pool = read_pools->next; pool != NULL;
+           pool = pool->next)
+        start_read_threads(pool, pool->threads_max);
+    }
   }
   return ret;
 } /* void plugin_init_all */
@@ -1660,42 +2125,41 @@ int plugin_read_all_once(void) {
   int status;
   int return_status = 0;
 
-  if (read_heap == NULL) {
+  if (read_list == NULL) {
     NOTICE("No read-functions are registered.");
     return 0;
   }
 
-  while (42) {
+  for (read_pool_t *pool = read_pools; pool != NULL; pool = pool->next) {
     read_func_t *rf;
-    plugin_ctx_t old_ctx;
 
-    rf = c_heap_get_root(read_heap);
-    if (rf == NULL)
-      break;
+    while ((rf = c_heap_get_root(pool->heap)) != NULL) {
+      plugin_ctx_t old_ctx;
 
-    old_ctx = plugin_set_ctx(rf->rf_ctx);
+      old_ctx = plugin_set_ctx(rf->rf_ctx);
 
-    if (rf->rf_type == RF_SIMPLE) {
-      int (*callback)(void);
+      if (rf->rf_type == RF_SIMPLE) {
+        int (*callback)(void);
 
-      callback = rf->rf_callback;
-      status = (*callback)();
-    } else {
-      plugin_read_cb callback;
+        callback = rf->rf_callback;
+        status = (*callback)();
+      } else {
+        plugin_read_cb callback;
 
-      callback = rf->rf_callback;
-      status = (*callback)(&rf->rf_udata);
-    }
+        callback = rf->rf_callback;
+        status = (*callback)(&rf->rf_udata);
+      }
 
-    plugin_set_ctx(old_ctx);
+      plugin_set_ctx(old_ctx);
 
-    if (status != 0) {
-      NOTICE("read-function of plugin `%s' failed.", rf->rf_name);
-      return_status = -1;
-    }
+      if (status != 0) {
+        NOTICE("read-function of plugin `%s' failed.", rf->rf_name);
+        return_status = -1;
+      }
 
-    sfree(rf->rf_name);
-    destroy_callback((void *)rf);
+      sfree(rf->rf_name);
+      destroy_callback((void *)rf);
+    }
   }
 
   return return_status;
@@ -1819,16 +2283,20 @@ int plugin_shutdown_all(void) {
   read_list = NULL;
   pthread_mutex_unlock(&read_lock);
 
-  destroy_read_heap();
+  destroy_read_pools();
 
   /* blocks until all write threads have shut down. */
   stop_write_threads();
+  uh_destroy();
 
   /* ask all plugins to write out the state they kept. */
   plugin_flush(/* plugin = */ NULL,
                /* timeout = */ 0,
                /* identifier = */ NULL);
 
+  /* log plugins may close their files in the shutdown callbacks. */
+  stop_log_thread();
+
   le = NULL;
   if (list_shutdown != NULL)
     le = llist_head(list_shutdown);
@@ -1866,6 +2334,7 @@ int plugin_shutdown_all(void) {
   destroy_all_callbacks(&list_notification);
   destroy_all_callbacks(&list_shutdown);
   destroy_all_callbacks(&list_log);
+  log_update_level();
 
   plugin_free_loaded();
   plugin_free_data_sets();
@@ -2005,6 +2474,7 @@ static int plugin_dispatch_values_internal(value_list_t *vl) {
 
   /* Update the value cache */
   uc_update(ds, vl);
+  uh_update(ds, vl);
 
   if (post_cache_chain != NULL) {
     status = fc_process_chain(ds, vl, post_cache_chain);
@@ -2086,18 +2556,28 @@ static _Bool check_drop_value(void) /* {{{ */
     return 0;
 } /* }}} _Bool check_drop_value */
 
-int plugin_dispatch_values(value_list_t const *vl) {
-  int status;
+/* Returns true if a value list is to be dropped because the write queue
+ * exceeds its limit, and counts it. */
+static _Bool plugin_drop_value(void) /* {{{ */
+{
   static pthread_mutex_t statistics_lock = PTHREAD_MUTEX_INITIALIZER;
 
-  if (check_drop_value()) {
-    if (record_statistics) {
-      pthread_mutex_lock(&statistics_lock);
-      stats_values_dropped++;
-      pthread_mutex_unlock(&statistics_lock);
-    }
+  if (!check_drop_value())
     return 0;
+
+  if (record_statistics) {
+    pthread_mutex_lock(&statistics_lock);
+    stats_values_dropped++;
+    pthread_mutex_unlock(&statistics_lock);
   }
+  return 1;
+} /* }}} _Bool plugin_drop_value */
+
+int plugin_dispatch_values(value_list_t const *vl) {
+  int status;
+
+  if (plugin_drop_value())
+    return 0;
 
   status = plugin_write_enqueue(vl);
   if (status != 0) {
@@ -2111,6 +2591,43 @@ int plugin_dispatch_values(value_list_t const *vl) {
   return 0;
 }
 
+int plugin_dispatch_values_batch(value_list_t const *vl, size_t vl_num) {
+  write_queue_t *head = NULL;
+  write_queue_t *tail = NULL;
+  long num = 0;
+  int status = 0;
+
+  for (size_t i = 0; i < vl_num; i++) {
+    if (plugin_drop_value())
+      continue;
+
+    write_queue_t *q = plugin_write_queue_entry(vl + i);
+    if (q == NULL) {
+      status = ENOMEM;
+      continue;
+    }
+
+    if (tail == NULL)
+      head = q;
+    else
+      tail->next = q;
+    tail = q;
+    num++;
+  }
+
+  if (num > 0)
+    plugin_write_enqueue_list(head, tail, num);
+
+  if (status != 0) {
+    char errbuf[1024];
+    ERROR("plugin_dispatch_values_batch: Enqueuing %zu of %zu value lists "
+          "failed: %s",
+          vl_num - (size_t)num, vl_num,
+          sstrerror(status, errbuf, sizeof(errbuf)));
+  }
+  return status;
+}
+
 __attribute__((sentinel)) int
 plugin_dispatch_multivalue(value_list_t const *template, /* {{{ */
                            _Bool store_percentage, int store_type, ...) {
@@ -2224,15 +2741,18 @@ int plugin_dispatch_notification(const notification_t *notif) {
 } /* int plugin_dispatch_notification */
 
 void plugin_log(int level, const char *format, ...) {
-  char msg[1024];
+  char msg[LOG_RING_MESSAGE_SIZE];
   va_list ap;
-  llentry_t *le;
 
 #if !COLLECT_DEBUG
   if (level >= LOG_DEBUG)
     return;
 #endif
 
+  /* No log callback wants the message: don't bother formatting it. */
+  if (level > log_level_max)
+    return;
+
   va_start(ap, format);
   vsnprintf(msg, sizeof(msg), format, ap);
   msg[sizeof(msg) - 1] = '\0';
@@ -2243,20 +2763,26 @@ void plugin_log(int level, const char *format, ...) {
     return;
   }
 
-  le = llist_head(list_log);
-  while (le != NULL) {
-    callback_func_t *cf;
-    plugin_log_cb callback;
-
-    cf = le->value;
-    callback = cf->cf_callback;
-
-    /* do not switch plugin context; rather keep the context
-     * (interval) information of the calling plugin */
+  if (!__atomic_load_n(&log_async, __ATOMIC_ACQUIRE)) {
+    log_dispatch(level, msg);
+    return;
+  }
 
-    (*callback)(level, msg, &cf->cf_udata);
+  if (log_ring_push(log_ring, level, msg) != 0)
+    __atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
 
-    le = le->next;
+  /* Pairs with the stores of log_async in stop_log_thread() and of
+   * log_thread_waiting in plugin_log_thread(). If the log thread is being
+   * stopped, its last drain may have missed this message. */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (!__atomic_load_n(&log_async, __ATOMIC_RELAXED)) {
+    log_drain();
+    return;
+  }
+  if (__atomic_load_n(&log_thread_waiting, __ATOMIC_RELAXED)) {
+    pthread_mutex_lock(&log_lock);
+    pthread_cond_signal(&log_cond);
+    pthread_mutex_unlock(&log_lock);
   }
 } /* void plugin_log */
 
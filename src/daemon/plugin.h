@@ -174,10 +174,18 @@ struct user_data_s {
 };
 typedef struct user_data_s user_data_t;
 
+/* A read thread pool runs the read callbacks assigned to it on its own
+ * threads, so slow plugins can not delay the reads of other plugins. */
+struct read_pool_s;
+typedef struct read_pool_s read_pool_t;
+
 struct plugin_ctx_s {
   cdtime_t interval;
   cdtime_t flush_interval;
   cdtime_t flush_timeout;
+  /* Pool for read callbacks registered in this context; NULL selects the
+   * default pool sized by the "ReadThreads" option. */
+  read_pool_t *read_pool;
 };
 typedef struct plugin_ctx_s plugin_ctx_t;
 
@@ -283,6 +291,17 @@ int plugin_register_config(const char *name,
                            const char **keys, int keys_num);
 int plugin_register_complex_config(const char *type,
                                    int (*callback)(oconfig_item_t *));
+/* plugin_get_read_pool returns the read thread pool called "name", creating
+ * it with one thread if it does not exist yet. plugin_define_read_pool does
+ * the same and marks the pool as configured by a <ReadThreadPool> block.
+ * plugin_set_read_pool_threads sets the number of threads started for a pool
+ * by plugin_init_all. plugin_check_read_pools returns an error if a pool used
+ * by a plugin has not been defined, e.g. because its name is misspelled. */
+read_pool_t *plugin_get_read_pool(const char *name);
+read_pool_t *plugin_define_read_pool(const char *name);
+int plugin_set_read_pool_threads(read_pool_t *pool, size_t num);
+int plugin_check_read_pools(void);
+
 int plugin_register_init(const char *name, plugin_init_cb callback);
 int plugin_register_read(const char *name, int (*callback)(void));
 /* "user_data" will be freed automatically, unless
@@ -317,6 +336,21 @@ int plugin_unregister_data_set(const char *name);
 int plugin_unregister_log(const char *name);
 int plugin_unregister_notification(const char *name);
 
+/*
+ * NAME
+ *  plugin_set_log_level
+ *
+ * DESCRIPTION
+ *  Sets the least important severity the log callback `name' wants to
+ *  receive, e.g. LOG_ERR. plugin_log() skips formatting messages no log
+ *  callback is interested in. Log callbacks which never call this function
+ *  receive all messages.
+ *
+ * RETURN VALUE
+ *  Zero on success, ENOENT if no log callback `name' has been registered.
+ */
+int plugin_set_log_level(const char *name, int level);
+
 /*
  * NAME
  *  plugin_log_available_writers
@@ -345,6 +379,28 @@ void plugin_log_available_writers(void);
  */
 int plugin_dispatch_values(value_list_t const *vl);
 
+/*
+ * NAME
+ *  plugin_dispatch_values_batch
+ *
+ * DESCRIPTION
+ *  Dispatches "vl_num" value lists, like calling `plugin_dispatch_values' for
+ *  each of them, but adds them to the write queue at once.
+ *
+ * RETURN VALUE
+ *  Zero upon success or an error code if any value list could not be
+ *  enqueued.
+ */
+int plugin_dispatch_values_batch(value_list_t const *vl, size_t vl_num);
+
+#ifdef TESTING_H
+/* In libplugin_mock, copies of the dispatched value lists, without their meta
+ * data, are kept in mock_dispatched until mock_dispatched_reset is called. */
+extern value_list_t *mock_dispatched;
+extern size_t mock_dispatched_num;
+void mock_dispatched_reset(void);
+#endif
+
 /*
  * NAME
  *  plugin_dispatch_multivalue
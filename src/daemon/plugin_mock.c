@@ -37,6 +37,16 @@ void plugin_set_dir(const char *dir) { /* nop */
 
 int plugin_load(const char *name, _Bool global) { return ENOTSUP; }
 
+read_pool_t *plugin_get_read_pool(const char *name) { return NULL; }
+
+read_pool_t *plugin_define_read_pool(const char *name) { return NULL; }
+
+int plugin_set_read_pool_threads(read_pool_t *pool, size_t num) {
+  return ENOTSUP;
+}
+
+int plugin_check_read_pools(void) { return 0; }
+
 int plugin_register_config(const char *name,
                            int (*callback)(const char *key, const char *val),
                            const char **keys, int keys_num) {
@@ -63,13 +73,85 @@ int plugin_register_complex_read(const char *group, const char *name,
   return ENOTSUP;
 }
 
+int plugin_register_write(const char *name, plugin_write_cb callback,
+                          user_data_t const *user_data) {
+  return ENOTSUP;
+}
+
+int plugin_register_flush(const char *name, plugin_flush_cb callback,
+                          user_data_t const *user_data) {
+  return ENOTSUP;
+}
+
+int plugin_register_missing(const char *name, plugin_missing_cb callback,
+                            user_data_t const *user_data) {
+  return ENOTSUP;
+}
+
+int plugin_register_notification(const char *name,
+                                 plugin_notification_cb callback,
+                                 user_data_t const *user_data) {
+  return ENOTSUP;
+}
+
 int plugin_register_shutdown(const char *name, int (*callback)(void)) {
   return ENOTSUP;
 }
 
 int plugin_register_data_set(const data_set_t *ds) { return ENOTSUP; }
 
-int plugin_dispatch_values(value_list_t const *vl) { return ENOTSUP; }
+int plugin_set_log_level(const char *name, int level) { return ENOTSUP; }
+
+value_list_t *mock_dispatched = NULL;
+size_t mock_dispatched_num = 0;
+static pthread_mutex_t mock_dispatched_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int mock_dispatch(value_list_t const *vl) {
+  value_t *values = calloc(vl->values_len, sizeof(*values));
+  if (values == NULL)
+    return ENOMEM;
+  memcpy(values, vl->values, vl->values_len * sizeof(*values));
+
+  pthread_mutex_lock(&mock_dispatched_lock);
+  value_list_t *tmp = realloc(mock_dispatched, (mock_dispatched_num + 1) *
+                                                   sizeof(*mock_dispatched));
+  if (tmp == NULL) {
+    pthread_mutex_unlock(&mock_dispatched_lock);
+    free(values);
+    return ENOMEM;
+  }
+  mock_dispatched = tmp;
+
+  value_list_t *copy = mock_dispatched + mock_dispatched_num;
+  *copy = *vl;
+  copy->values = values;
+  copy->meta = NULL;
+  mock_dispatched_num++;
+  pthread_mutex_unlock(&mock_dispatched_lock);
+
+  return 0;
+}
+
+void mock_dispatched_reset(void) {
+  pthread_mutex_lock(&mock_dispatched_lock);
+  for (size_t i = 0; i < mock_dispatched_num; i++)
+    free(mock_dispatched[i].values);
+  free(mock_dispatched);
+  mock_dispatched = NULL;
+  mock_dispatched_num = 0;
+  pthread_mutex_unlock(&mock_dispatched_lock);
+}
+
+int plugin_dispatch_values(value_list_t const *vl) { return mock_dispatch(vl); }
+
+int plugin_dispatch_values_batch(value_list_t const *vl, size_t vl_num) {
+  for (size_t i = 0; i < vl_num; i++) {
+    int status = mock_dispatch(vl + i);
+    if (status != 0)
+      return status;
+  }
+  return 0;
+}
 
 int plugin_flush(const char *plugin, cdtime_t timeout, const char *identifier) {
   return ENOTSUP;
@@ -112,6 +194,12 @@ plugin_ctx_t plugin_set_ctx(plugin_ctx_t ctx) {
 
 cdtime_t plugin_get_interval(void) { return mock_context.interval; }
 
+int plugin_thread_create(pthread_t *thread, const pthread_attr_t *attr,
+                         void *(*start_routine)(void *), void *arg,
+                         char const *name) {
+  return pthread_create(thread, attr, start_routine, arg);
+}
+
 /* TODO(octo): this function is actually from filter_chain.h, but in order not
  * to tumble down that rabbit hole, we're declaring it here. A better solution
  * would be to hard-code the top-level config keys in daemon/collectd.c to avoid
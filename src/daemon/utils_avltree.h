@@ -147,6 +147,21 @@ int c_avl_get(c_avl_tree_t *t, const void *key, void **value);
 int c_avl_pick(c_avl_tree_t *t, void **key, void **value);
 
 c_avl_iterator_t *c_avl_get_iterator(c_avl_tree_t *t);
+
+/*
+ * NAME
+ *   c_avl_get_iterator_after
+ *
+ * DESCRIPTION
+ *   Creates an iterator whose first call to `c_avl_iterator_next' returns the
+ *   smallest key greater than `key'. This allows to resume an iteration after
+ *   the tree has been modified. If `key' is NULL, this is equivalent to
+ *   `c_avl_get_iterator'.
+ *
+ * RETURN VALUE
+ *   An iterator object on success or NULL else.
+ */
+c_avl_iterator_t *c_avl_get_iterator_after(c_avl_tree_t *t, const void *key);
 int c_avl_iterator_next(c_avl_iterator_t *iter, void **key, void **value);
 int c_avl_iterator_prev(c_avl_iterator_t *iter, void **key, void **value);
 void c_avl_iterator_destroy(c_avl_iterator_t *iter);
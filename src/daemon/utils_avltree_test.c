@@ -130,8 +130,44 @@ DEF_TEST(success) {
   return 0;
 }
 
+DEF_TEST(iterator_after) {
+  char *keys[] = {"b", "d", "f", "h", "j", "l", "n"};
+  struct {
+    char *after;
+    char *want;
+  } cases[] = {
+      {NULL, "b"}, {"a", "b"}, {"b", "d"}, {"c", "d"},
+      {"k", "l"},  {"m", "n"}, {"n", NULL}, {"z", NULL},
+  };
+
+  c_avl_tree_t *t;
+  CHECK_NOT_NULL(t = c_avl_create(compare_callback));
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(keys); i++)
+    CHECK_ZERO(c_avl_insert(t, keys[i], keys[i]));
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cases); i++) {
+    c_avl_iterator_t *iter;
+    char *key = NULL;
+    char *value = NULL;
+
+    CHECK_NOT_NULL(iter = c_avl_get_iterator_after(t, cases[i].after));
+    int status = c_avl_iterator_next(iter, (void *)&key, (void *)&value);
+    if (cases[i].want == NULL) {
+      EXPECT_EQ_INT(-1, status);
+    } else {
+      EXPECT_EQ_INT(0, status);
+      EXPECT_EQ_STR(cases[i].want, key);
+    }
+    c_avl_iterator_destroy(iter);
+  }
+
+  c_avl_destroy(t);
+  return 0;
+}
+
 int main(void) {
   RUN_TEST(success);
+  RUN_TEST(iterator_after);
 
   END_TEST;
 }
@@ -657,6 +657,103 @@ int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number) {
   return 0;
 } /* int uc_get_names */
 
+int uc_get_names_chunk(char *after, size_t after_size, char const *prefix,
+                       size_t max, char ***ret_names, cdtime_t **ret_times,
+                       size_t *ret_number) {
+  char *key;
+  cache_entry_t *value;
+
+  char **names = NULL;
+  cdtime_t *times = NULL;
+  size_t number = 0;
+  size_t prefix_len = (prefix != NULL) ? strlen(prefix) : 0;
+
+  if ((after == NULL) || (after_size == 0) || (max == 0) ||
+      (ret_names == NULL) || (ret_number == NULL))
+    return EINVAL;
+
+  names = calloc(max, sizeof(*names));
+  times = calloc(max, sizeof(*times));
+  if ((names == NULL) || (times == NULL)) {
+    ERROR("uc_get_names_chunk: calloc failed.");
+    sfree(names);
+    sfree(times);
+    return ENOMEM;
+  }
+
+  /* Names are sorted, so all names starting with "prefix" follow each other,
+   * beginning at the first name not smaller than the prefix. */
+  char const *start = after;
+  if ((prefix_len > 0) && (strcmp(after, prefix) < 0))
+    start = prefix;
+
+  pthread_mutex_lock(&cache_lock);
+
+  c_avl_iterator_t *iter = c_avl_get_iterator_after(
+      cache_tree, (start[0] != 0) ? start : NULL);
+  /* The iterator skips "start" itself, which must be included if it is the
+   * prefix. */
+  _Bool include_start = (start == prefix) &&
+                        (c_avl_get(cache_tree, prefix, (void *)&value) == 0);
+
+  after[0] = 0;
+  size_t visited = 0;
+  int status = 0;
+  while ((iter != NULL) && (visited < max)) {
+    if (include_start) {
+      key = (char *)prefix;
+      include_start = 0;
+    } else if (c_avl_iterator_next(iter, (void *)&key, (void *)&value) != 0) {
+      break;
+    }
+
+    if ((prefix_len > 0) && (strncmp(key, prefix, prefix_len) != 0)) {
+      /* past the last matching name */
+      after[0] = 0;
+      break;
+    }
+
+    visited++;
+    sstrncpy(after, key, after_size);
+
+    /* remove missing values when list values */
+    if (value->state == STATE_MISSING)
+      continue;
+
+    times[number] = value->last_time;
+    names[number] = strdup(key);
+    if (names[number] == NULL) {
+      status = ENOMEM;
+      break;
+    }
+    number++;
+  }
+
+  /* If fewer than "max" entries were visited, the end has been reached. */
+  if (visited < max)
+    after[0] = 0;
+
+  c_avl_iterator_destroy(iter);
+  pthread_mutex_unlock(&cache_lock);
+
+  if (status != 0) {
+    for (size_t i = 0; i < number; i++)
+      sfree(names[i]);
+    sfree(names);
+    sfree(times);
+    return status;
+  }
+
+  *ret_names = names;
+  if (ret_times != NULL)
+    *ret_times = times;
+  else
+    sfree(times);
+  *ret_number = number;
+
+  return 0;
+} /* int uc_get_names_chunk */
+
 int uc_get_state(const data_set_t *ds, const value_list_t *vl) {
   char name[6 * DATA_MAX_NAME_LEN];
   cache_entry_t *ce = NULL;
@@ -50,6 +50,26 @@ value_t *uc_get_value(const data_set_t *ds, const value_list_t *vl);
 size_t uc_get_size(void);
 int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number);
 
+/*
+ * NAME
+ *   uc_get_names_chunk
+ *
+ * DESCRIPTION
+ *   Like `uc_get_names', but only returns the names of the (at most) `max'
+ *   cache entries following `after' in lexicographical order, so that the
+ *   cache lock is only held for a limited time. `after' is updated to the last
+ *   name visited and can be passed to the next call; it is set to the empty
+ *   string once the end of the cache has been reached. `after_size' should be
+ *   at least 6 * DATA_MAX_NAME_LEN. If `prefix' is not NULL, only names
+ *   starting with `prefix' are returned.
+ *
+ * RETURN VALUE
+ *   Zero on success, an errno value otherwise.
+ */
+int uc_get_names_chunk(char *after, size_t after_size, char const *prefix,
+                       size_t max, char ***ret_names, cdtime_t **ret_times,
+                       size_t *ret_number);
+
 int uc_get_state(const data_set_t *ds, const value_list_t *vl);
 int uc_set_state(const data_set_t *ds, const value_list_t *vl, int state);
 int uc_get_hits(const data_set_t *ds, const value_list_t *vl);
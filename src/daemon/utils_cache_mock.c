@@ -41,3 +41,9 @@ int uc_get_rate_by_name(const char *name, gauge_t **ret_values,
 int uc_get_names(char ***ret_names, cdtime_t **ret_times, size_t *ret_number) {
   return ENOTSUP;
 }
+
+int uc_get_names_chunk(char *after, size_t after_size, char const *prefix,
+                       size_t max, char ***ret_names, cdtime_t **ret_times,
+                       size_t *ret_number) {
+  return ENOTSUP;
+}
@@ -0,0 +1,372 @@
+/**
+ * collectd - src/daemon/utils_gorilla.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "utils_gorilla.h"
+
+#define GORILLA_SIZE_MAX 4096
+#define GORILLA_NO_WINDOW 0xff
+
+static int gorilla_leading_zeros(uint64_t v) /* {{{ */
+{
+#if defined(__GNUC__) && __GNUC__
+  return __builtin_clzll(v);
+#else
+  int n = 0;
+  while (!(v & (((uint64_t)1) << 63))) {
+    v <<= 1;
+    n++;
+  }
+  return n;
+#endif
+} /* }}} int gorilla_leading_zeros */
+
+static int gorilla_trailing_zeros(uint64_t v) /* {{{ */
+{
+#if defined(__GNUC__) && __GNUC__
+  return __builtin_ctzll(v);
+#else
+  int n = 0;
+  while (!(v & 1)) {
+    v >>= 1;
+    n++;
+  }
+  return n;
+#endif
+} /* }}} int gorilla_trailing_zeros */
+
+static uint64_t gorilla_double_to_bits(double d) /* {{{ */
+{
+  uint64_t v;
+  memcpy(&v, &d, sizeof(v));
+  return v;
+} /* }}} uint64_t gorilla_double_to_bits */
+
+static double gorilla_bits_to_double(uint64_t v) /* {{{ */
+{
+  double d;
+  memcpy(&d, &v, sizeof(d));
+  return d;
+} /* }}} double gorilla_bits_to_double */
+
+/* Writes the lower "bits" bits of "value" to "data", most significant bit
+ * first. "data" must have been zeroed. */
+static void gorilla_write(uint8_t *data, size_t *pos, uint64_t value,
+                          int bits) /* {{{ */
+{
+  while (bits > 0) {
+    int offset = (int)(*pos % 8);
+    int n = 8 - offset;
+    if (n > bits)
+      n = bits;
+
+    uint8_t byte = (uint8_t)((value >> (bits - n)) & ((1u << n) - 1));
+    data[*pos / 8] |= (uint8_t)(byte << (8 - offset - n));
+
+    *pos += (size_t)n;
+    bits -= n;
+  }
+} /* }}} void gorilla_write */
+
+static uint64_t gorilla_read(uint8_t const *data, size_t *pos,
+                             int bits) /* {{{ */
+{
+  uint64_t value = 0;
+
+  while (bits > 0) {
+    int offset = (int)(*pos % 8);
+    int n = 8 - offset;
+    if (n > bits)
+      n = bits;
+
+    uint8_t byte = (uint8_t)(data[*pos / 8] >> (8 - offset - n));
+    value = (value << n) | (byte & ((1u << n) - 1));
+
+    *pos += (size_t)n;
+    bits -= n;
+  }
+
+  return value;
+} /* }}} uint64_t gorilla_read */
+
+static int64_t gorilla_read_signed(uint8_t const *data, size_t *pos,
+                                   int bits) /* {{{ */
+{
+  uint64_t v = gorilla_read(data, pos, bits);
+  if (v & (((uint64_t)1) << (bits - 1)))
+    return (int64_t)v - (((int64_t)1) << bits);
+  return (int64_t)v;
+} /* }}} int64_t gorilla_read_signed */
+
+/* Timestamps: the delta of delta is stored with a variable-length prefix
+ * selecting the number of bits that follow. */
+static int gorilla_dod_width(int64_t dod, int *ret_prefix_bits) /* {{{ */
+{
+  if (dod == 0) {
+    *ret_prefix_bits = 1;
+    return 0;
+  } else if ((dod >= -64) && (dod <= 63)) {
+    *ret_prefix_bits = 2;
+    return 7;
+  } else if ((dod >= -256) && (dod <= 255)) {
+    *ret_prefix_bits = 3;
+    return 9;
+  } else if ((dod >= -2048) && (dod <= 2047)) {
+    *ret_prefix_bits = 4;
+    return 12;
+  }
+  *ret_prefix_bits = 4;
+  return 32;
+} /* }}} int gorilla_dod_width */
+
+/* Returns true if a XOR with "leading" and "trailing" zero bits fits into the
+ * meaningful bits of the previously stored XOR. */
+static _Bool gorilla_reuse_window(gorilla_column_t const *col, int leading,
+                                  int trailing) /* {{{ */
+{
+  return (col->leading != GORILLA_NO_WINDOW) && (leading >= col->leading) &&
+         (trailing >= col->trailing);
+} /* }}} _Bool gorilla_reuse_window */
+
+static size_t gorilla_value_bits(gorilla_column_t const *col,
+                                 uint64_t xor) /* {{{ */
+{
+  if (xor == 0)
+    return 1;
+
+  int leading = gorilla_leading_zeros(xor);
+  int trailing = gorilla_trailing_zeros(xor);
+  if (leading > 31)
+    leading = 31;
+
+  if (gorilla_reuse_window(col, leading, trailing))
+    return (size_t)(2 + 64 - col->leading - col->trailing);
+  return (size_t)(2 + 5 + 6 + 64 - leading - trailing);
+} /* }}} size_t gorilla_value_bits */
+
+static void gorilla_write_value(uint8_t *data, size_t *pos,
+                                gorilla_column_t *col, uint64_t xor) /* {{{ */
+{
+  if (xor == 0) {
+    gorilla_write(data, pos, 0, 1);
+    return;
+  }
+
+  int leading = gorilla_leading_zeros(xor);
+  int trailing = gorilla_trailing_zeros(xor);
+  if (leading > 31)
+    leading = 31;
+
+  if (gorilla_reuse_window(col, leading, trailing)) {
+    gorilla_write(data, pos, 2, 2);
+    gorilla_write(data, pos, xor >> col->trailing,
+                  64 - col->leading - col->trailing);
+    return;
+  }
+
+  int length = 64 - leading - trailing;
+  gorilla_write(data, pos, 3, 2);
+  gorilla_write(data, pos, (uint64_t)leading, 5);
+  /* A length of 64 does not fit into six bits and is stored as zero. */
+  gorilla_write(data, pos, (uint64_t)(length % 64), 6);
+  gorilla_write(data, pos, xor >> trailing, length);
+
+  col->leading = (uint8_t)leading;
+  col->trailing = (uint8_t)trailing;
+} /* }}} void gorilla_write_value */
+
+gorilla_chunk_t *gorilla_chunk_create(size_t size, size_t values_num) /* {{{ */
+{
+  if ((size == 0) || (size > GORILLA_SIZE_MAX) || (values_num == 0) ||
+      (values_num > GORILLA_VALUES_MAX))
+    return NULL;
+
+  gorilla_chunk_t *c = calloc(1, offsetof(gorilla_chunk_t, data) + size);
+  if (c == NULL)
+    return NULL;
+
+  c->size = (uint16_t)size;
+  c->values_num = (uint8_t)values_num;
+  return c;
+} /* }}} gorilla_chunk_t *gorilla_chunk_create */
+
+int gorilla_chunk_append(gorilla_chunk_t *c, gorilla_column_t *columns,
+                         int64_t time, double const *values) /* {{{ */
+{
+  uint64_t xor[GORILLA_VALUES_MAX];
+  size_t pos = (size_t)c->bits;
+
+  if (c->count == 0) {
+    if ((size_t)64 * c->values_num > (size_t)8 * c->size)
+      return ENOSPC;
+
+    for (size_t i = 0; i < c->values_num; i++) {
+      columns[i].value = gorilla_double_to_bits(values[i]);
+      columns[i].leading = GORILLA_NO_WINDOW;
+      columns[i].trailing = 0;
+      gorilla_write(c->data, &pos, columns[i].value, 64);
+    }
+
+    c->first = time;
+    c->last = time;
+    c->delta = 0;
+    c->count = 1;
+    c->bits = (uint16_t)pos;
+    return 0;
+  }
+
+  if (time <= c->last)
+    return EINVAL;
+  if ((c->count == UINT16_MAX) || (time - c->last > INT32_MAX))
+    return ENOSPC;
+
+  int64_t delta = time - c->last;
+  int64_t dod = delta - c->delta;
+  int prefix_bits;
+  int dod_bits = gorilla_dod_width(dod, &prefix_bits);
+
+  /* Make sure the entire point fits before modifying anything. */
+  size_t need = (size_t)(prefix_bits + dod_bits);
+  for (size_t i = 0; i < c->values_num; i++) {
+    xor[i] = gorilla_double_to_bits(values[i]) ^ columns[i].value;
+    need += gorilla_value_bits(columns + i, xor[i]);
+  }
+  if (pos + need > (size_t)8 * c->size)
+    return ENOSPC;
+
+  /* The prefix is a run of up to four one bits, terminated by a zero bit
+   * unless it is the longest one. */
+  if (dod_bits == 0)
+    gorilla_write(c->data, &pos, 0, 1);
+  else if (dod_bits == 32)
+    gorilla_write(c->data, &pos, 0xf, 4);
+  else
+    gorilla_write(c->data, &pos, (((uint64_t)1) << prefix_bits) - 2,
+                  prefix_bits);
+  if (dod_bits > 0)
+    gorilla_write(c->data, &pos, (uint64_t)dod, dod_bits);
+
+  for (size_t i = 0; i < c->values_num; i++) {
+    gorilla_write_value(c->data, &pos, columns + i, xor[i]);
+    columns[i].value ^= xor[i];
+  }
+
+  c->last = time;
+  c->delta = (int32_t)delta;
+  c->count++;
+  c->bits = (uint16_t)pos;
+  return 0;
+} /* }}} int gorilla_chunk_append */
+
+gorilla_chunk_t *gorilla_chunk_seal(gorilla_chunk_t *c) /* {{{ */
+{
+  size_t size = ((size_t)c->bits + 7) / 8;
+  if (size >= c->size)
+    return c;
+
+  gorilla_chunk_t *tmp = realloc(c, offsetof(gorilla_chunk_t, data) + size);
+  if (tmp == NULL)
+    return c;
+
+  tmp->size = (uint16_t)size;
+  return tmp;
+} /* }}} gorilla_chunk_t *gorilla_chunk_seal */
+
+size_t gorilla_chunk_memory(gorilla_chunk_t const *c) /* {{{ */
+{
+  return offsetof(gorilla_chunk_t, data) + c->size;
+} /* }}} size_t gorilla_chunk_memory */
+
+void gorilla_iter_init(gorilla_iter_t *iter, gorilla_chunk_t const *c) /* {{{ */
+{
+  iter->chunk = c;
+  iter->pos = 0;
+  iter->index = 0;
+  iter->time = 0;
+  iter->delta = 0;
+} /* }}} void gorilla_iter_init */
+
+int gorilla_iter_next(gorilla_iter_t *iter, int64_t *ret_time,
+                      double *ret_values) /* {{{ */
+{
+  gorilla_chunk_t const *c = iter->chunk;
+  uint8_t const *data = c->data;
+
+  if (iter->index >= c->count)
+    return ENOENT;
+
+  if (iter->index == 0) {
+    iter->time = c->first;
+    iter->delta = 0;
+    for (size_t i = 0; i < c->values_num; i++) {
+      iter->columns[i].value = gorilla_read(data, &iter->pos, 64);
+      iter->columns[i].leading = GORILLA_NO_WINDOW;
+      iter->columns[i].trailing = 0;
+    }
+  } else {
+    int dod_bits = 32;
+    int prefix_bits = 0;
+    while (prefix_bits < 4) {
+      prefix_bits++;
+      if (gorilla_read(data, &iter->pos, 1) == 0) {
+        static int const widths[] = {0, 7, 9, 12};
+        dod_bits = widths[prefix_bits - 1];
+        break;
+      }
+    }
+
+    if (dod_bits > 0)
+      iter->delta += gorilla_read_signed(data, &iter->pos, dod_bits);
+    iter->time += iter->delta;
+
+    for (size_t i = 0; i < c->values_num; i++) {
+      gorilla_column_t *col = iter->columns + i;
+      uint64_t xor;
+
+      if (gorilla_read(data, &iter->pos, 1) == 0)
+        continue;
+
+      if (gorilla_read(data, &iter->pos, 1) == 0) {
+        xor = gorilla_read(data, &iter->pos, 64 - col->leading - col->trailing)
+              << col->trailing;
+      } else {
+        int leading = (int)gorilla_read(data, &iter->pos, 5);
+        int length = (int)gorilla_read(data, &iter->pos, 6);
+        if (length == 0)
+          length = 64;
+
+        col->leading = (uint8_t)leading;
+        col->trailing = (uint8_t)(64 - leading - length);
+        xor = gorilla_read(data, &iter->pos, length) << col->trailing;
+      }
+      col->value ^= xor;
+    }
+  }
+
+  iter->index++;
+  *ret_time = iter->time;
+  for (size_t i = 0; i < c->values_num; i++)
+    ret_values[i] = gorilla_bits_to_double(iter->columns[i].value);
+  return 0;
+} /* }}} int gorilla_iter_next */
@@ -0,0 +1,129 @@
+/**
+ * collectd - src/daemon/utils_gorilla.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_GORILLA_H
+#define UTILS_GORILLA_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compression of time series as described in "Gorilla: A Fast, Scalable,
+ * In-Memory Time Series Database" (Pelkonen et al., VLDB 2015).
+ *
+ * Points are appended to fixed-size chunks. Timestamps, in milliseconds, are
+ * stored as the difference between consecutive deltas ("delta of delta") in
+ * a variable number of bits, which is a single bit for points arriving at a
+ * regular interval. Values are stored as the XOR with the previous value of
+ * the same column, omitting the leading and trailing zero bits, which is
+ * again a single bit if the value did not change. Each point may have up to
+ * GORILLA_VALUES_MAX values ("columns"); they are interleaved in the same bit
+ * stream. */
+
+#define GORILLA_VALUES_MAX 64
+
+/* Per-column state of the encoder and decoder. */
+typedef struct {
+  uint64_t value;   /* previous value, as bits */
+  uint8_t leading;  /* leading zeros of the last stored XOR, or 0xff */
+  uint8_t trailing; /* trailing zeros of the last stored XOR */
+} gorilla_column_t;
+
+typedef struct {
+  int64_t first; /* time of the first point, in milliseconds */
+  int64_t last;  /* time of the last point, in milliseconds */
+  int32_t delta; /* difference between the last two timestamps */
+  uint16_t count;
+  uint16_t bits;
+  uint16_t size;
+  uint8_t values_num;
+  uint8_t data[];
+} gorilla_chunk_t;
+
+typedef struct {
+  gorilla_chunk_t const *chunk;
+  gorilla_column_t columns[GORILLA_VALUES_MAX];
+  size_t pos;
+  uint16_t index;
+  int64_t time;
+  int64_t delta;
+} gorilla_iter_t;
+
+/*
+ * NAME
+ *   gorilla_chunk_create
+ *
+ * DESCRIPTION
+ *   Allocates a new, empty chunk which holds "size" bytes of compressed data.
+ *   Every point appended to the chunk has "values_num" values. Returns NULL
+ *   if "size" exceeds 4096, "values_num" is zero or exceeds
+ *   GORILLA_VALUES_MAX, or memory allocation failed.
+ */
+gorilla_chunk_t *gorilla_chunk_create(size_t size, size_t values_num);
+
+/*
+ * NAME
+ *   gorilla_chunk_append
+ *
+ * DESCRIPTION
+ *   Appends a point to the chunk. "columns" holds the encoder state and must
+ *   point to an array of "values_num" elements; it is initialized when the
+ *   first point is appended and has to be passed to all subsequent calls for
+ *   the same chunk.
+ *
+ * RETURN VALUE
+ *   Zero on success, EINVAL if "time" is not after the last point's time and
+ *   ENOSPC if the point does not fit into the chunk. In the latter case the
+ *   point should be appended to a new chunk instead.
+ */
+int gorilla_chunk_append(gorilla_chunk_t *c, gorilla_column_t *columns,
+                         int64_t time, double const *values);
+
+/*
+ * NAME
+ *   gorilla_chunk_seal
+ *
+ * DESCRIPTION
+ *   Shrinks a chunk which will not be appended to anymore to the memory it
+ *   actually uses. Returns the (possibly moved) chunk.
+ */
+gorilla_chunk_t *gorilla_chunk_seal(gorilla_chunk_t *c);
+
+/* Returns the number of bytes allocated for the chunk. */
+size_t gorilla_chunk_memory(gorilla_chunk_t const *c);
+
+/*
+ * NAME
+ *   gorilla_iter_init
+ *   gorilla_iter_next
+ *
+ * DESCRIPTION
+ *   Decodes the points of a chunk in order. gorilla_iter_next() stores the
+ *   time and the "values_num" values of the next point at "ret_time" and
+ *   "ret_values" and returns zero, or returns ENOENT once all points have been
+ *   read. The chunk must not be modified while it is being iterated.
+ */
+void gorilla_iter_init(gorilla_iter_t *iter, gorilla_chunk_t const *c);
+int gorilla_iter_next(gorilla_iter_t *iter, int64_t *ret_time,
+                      double *ret_values);
+
+#endif /* UTILS_GORILLA_H */
@@ -0,0 +1,147 @@
+/**
+ * collectd - src/daemon/utils_gorilla_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "testing.h"
+#include "utils_gorilla.h"
+
+/* Appends points until the chunk is full and checks that decoding yields
+ * exactly the appended points. */
+static int check_roundtrip(size_t values_num, int64_t const *times,
+                           double const *values, size_t points_num) {
+  gorilla_column_t columns[GORILLA_VALUES_MAX];
+  gorilla_chunk_t *c;
+  size_t appended = 0;
+
+  CHECK_NOT_NULL(c = gorilla_chunk_create(512, values_num));
+  for (size_t i = 0; i < points_num; i++) {
+    int status = gorilla_chunk_append(c, columns, times[i],
+                                      values + i * values_num);
+    if (status == ENOSPC)
+      break;
+    EXPECT_EQ_INT(0, status);
+    appended++;
+  }
+  OK(appended > 0);
+  EXPECT_EQ_INT(appended, c->count);
+  EXPECT_EQ_UINT64(times[0], c->first);
+  EXPECT_EQ_UINT64(times[appended - 1], c->last);
+
+  c = gorilla_chunk_seal(c);
+  EXPECT_EQ_INT((c->bits + 7) / 8, c->size);
+
+  gorilla_iter_t iter;
+  gorilla_iter_init(&iter, c);
+  for (size_t i = 0; i < appended; i++) {
+    double got[GORILLA_VALUES_MAX];
+    int64_t time;
+
+    EXPECT_EQ_INT(0, gorilla_iter_next(&iter, &time, got));
+    EXPECT_EQ_UINT64(times[i], time);
+    for (size_t j = 0; j < values_num; j++) {
+      double want = values[i * values_num + j];
+      /* Compare bits, so that NaN and -0.0 are covered, too. */
+      OK(memcmp(&want, got + j, sizeof(want)) == 0);
+    }
+  }
+  double unused[GORILLA_VALUES_MAX];
+  int64_t time;
+  EXPECT_EQ_INT(ENOENT, gorilla_iter_next(&iter, &time, unused));
+
+  free(c);
+  return 0;
+}
+
+DEF_TEST(regular) {
+  int64_t times[200];
+  double values[200];
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(times); i++) {
+    times[i] = 1500000000000 + 10000 * (int64_t)i;
+    values[i] = (i % 10 < 5) ? 42.0 : 23.5;
+  }
+
+  CHECK_ZERO(check_roundtrip(1, times, values, STATIC_ARRAY_SIZE(times)));
+  return 0;
+}
+
+DEF_TEST(irregular) {
+  int64_t times[300];
+  double values[3 * 300];
+  int64_t jitter[] = {0, 3, -7, 100, -250, 1900, -3000, 86400000, 1};
+  int64_t t = 1500000000000;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(times); i++) {
+    t += 10000 + jitter[i % STATIC_ARRAY_SIZE(jitter)];
+    times[i] = t;
+    values[3 * i] = (double)i / 7.0;
+    values[3 * i + 1] = (i % 3) ? -0.0 : NAN;
+    values[3 * i + 2] = (i % 4) ? 1e300 * (double)i : -1e-300;
+  }
+
+  CHECK_ZERO(check_roundtrip(3, times, values, STATIC_ARRAY_SIZE(times)));
+  return 0;
+}
+
+DEF_TEST(errors) {
+  gorilla_column_t columns[2];
+  double values[2] = {1.0, 2.0};
+  gorilla_chunk_t *c;
+
+  OK(gorilla_chunk_create(0, 1) == NULL);
+  OK(gorilla_chunk_create(4097, 1) == NULL);
+  OK(gorilla_chunk_create(64, 0) == NULL);
+  OK(gorilla_chunk_create(64, GORILLA_VALUES_MAX + 1) == NULL);
+
+  /* Two raw values take 16 bytes. */
+  CHECK_NOT_NULL(c = gorilla_chunk_create(8, 2));
+  EXPECT_EQ_INT(ENOSPC, gorilla_chunk_append(c, columns, 1000, values));
+  free(c);
+
+  CHECK_NOT_NULL(c = gorilla_chunk_create(32, 2));
+  CHECK_ZERO(gorilla_chunk_append(c, columns, 1000, values));
+  EXPECT_EQ_INT(EINVAL, gorilla_chunk_append(c, columns, 1000, values));
+  EXPECT_EQ_INT(EINVAL, gorilla_chunk_append(c, columns, 999, values));
+  /* Deltas of more than 2^31 milliseconds need a new chunk. */
+  EXPECT_EQ_INT(ENOSPC,
+                gorilla_chunk_append(c, columns, 1000 + 4294967296, values));
+  CHECK_ZERO(gorilla_chunk_append(c, columns, 2000, values));
+
+  /* Unchanged values at a regular interval take three bits per point. */
+  size_t bits = c->bits;
+  CHECK_ZERO(gorilla_chunk_append(c, columns, 3000, values));
+  EXPECT_EQ_INT(bits + 3, c->bits);
+  free(c);
+
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(regular);
+  RUN_TEST(irregular);
+  RUN_TEST(errors);
+
+  END_TEST;
+}
@@ -0,0 +1,527 @@
+/**
+ * collectd - src/daemon/utils_history.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "plugin.h"
+#include "utils_avltree.h"
+#include "utils_gorilla.h"
+#include "utils_history.h"
+
+/* Size of the chunks points are appended to. Full chunks are shrunk to the
+ * size they actually use. */
+#define UH_CHUNK_SIZE 128
+
+/* Approximate size of a node of the AVL tree, which is accounted for each
+ * series. */
+#define UH_NODE_SIZE (6 * sizeof(void *))
+
+/* Number of stale series evicted at most per update. */
+#define UH_STALE_EVICT_MAX 2
+
+typedef struct uh_series_s uh_series_t;
+struct uh_series_s {
+  char *name;
+
+  /* Oldest first; points are appended to the last chunk. */
+  gorilla_chunk_t **chunks;
+  size_t chunks_num;
+
+  /* Previous values, if the data set has non-gauge data sources. */
+  value_t *raw;
+  cdtime_t last_time;
+
+  size_t memory;
+
+  /* LRU list, most recently updated first. */
+  uh_series_t *prev;
+  uh_series_t *next;
+
+  size_t values_num;
+  gorilla_column_t columns[];
+};
+
+typedef struct {
+  cdtime_t *times;
+  gauge_t *values;
+  size_t num;
+  size_t size;
+  size_t values_num;
+} uh_result_t;
+
+static pthread_mutex_t uh_lock = PTHREAD_MUTEX_INITIALIZER;
+static c_avl_tree_t *uh_tree;
+static uh_series_t *uh_head;
+static uh_series_t *uh_tail;
+
+static cdtime_t uh_window;
+static size_t uh_memory_limit;
+
+static size_t uh_memory;
+static size_t uh_points;
+static uint64_t uh_evicted;
+
+static void uh_memory_add(uh_series_t *s, size_t size) /* {{{ */
+{
+  s->memory += size;
+  uh_memory += size;
+} /* }}} void uh_memory_add */
+
+static void uh_memory_sub(uh_series_t *s, size_t size) /* {{{ */
+{
+  s->memory -= size;
+  uh_memory -= size;
+} /* }}} void uh_memory_sub */
+
+static void uh_lru_unlink(uh_series_t *s) /* {{{ */
+{
+  if (s->prev != NULL)
+    s->prev->next = s->next;
+  else
+    uh_head = s->next;
+
+  if (s->next != NULL)
+    s->next->prev = s->prev;
+  else
+    uh_tail = s->prev;
+
+  s->prev = NULL;
+  s->next = NULL;
+} /* }}} void uh_lru_unlink */
+
+static void uh_lru_push(uh_series_t *s) /* {{{ */
+{
+  s->prev = NULL;
+  s->next = uh_head;
+  if (uh_head != NULL)
+    uh_head->prev = s;
+  uh_head = s;
+  if (uh_tail == NULL)
+    uh_tail = s;
+} /* }}} void uh_lru_push */
+
+static void uh_series_free(uh_series_t *s) /* {{{ */
+{
+  if (s == NULL)
+    return;
+
+  for (size_t i = 0; i < s->chunks_num; i++) {
+    uh_points -= s->chunks[i]->count;
+    free(s->chunks[i]);
+  }
+  uh_memory -= s->memory;
+
+  sfree(s->chunks);
+  sfree(s->raw);
+  sfree(s->name);
+  free(s);
+} /* }}} void uh_series_free */
+
+static uh_series_t *uh_series_create(char const *name,
+                                     data_set_t const *ds) /* {{{ */
+{
+  uh_series_t *s =
+      calloc(1, sizeof(*s) + ds->ds_num * sizeof(gorilla_column_t));
+  if (s == NULL)
+    return NULL;
+
+  s->values_num = ds->ds_num;
+  s->name = strdup(name);
+  if (s->name == NULL) {
+    free(s);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < ds->ds_num; i++) {
+    if (ds->ds[i].type == DS_TYPE_GAUGE)
+      continue;
+
+    s->raw = calloc(ds->ds_num, sizeof(*s->raw));
+    if (s->raw == NULL) {
+      free(s->name);
+      free(s);
+      return NULL;
+    }
+    uh_memory_add(s, ds->ds_num * sizeof(*s->raw));
+    break;
+  }
+
+  uh_memory_add(s, sizeof(*s) + ds->ds_num * sizeof(gorilla_column_t) +
+                       strlen(name) + 1 + UH_NODE_SIZE);
+  return s;
+} /* }}} uh_series_t *uh_series_create */
+
+static void uh_evict(uh_series_t *s) /* {{{ */
+{
+  c_avl_remove(uh_tree, s->name, NULL, NULL);
+  uh_lru_unlink(s);
+  uh_series_free(s);
+  uh_evicted++;
+} /* }}} void uh_evict */
+
+/* Converts the values of "vl" to rates. Returns false if the value list is
+ * not newer than the previous one. */
+static _Bool uh_series_rates(uh_series_t *s, data_set_t const *ds,
+                             value_list_t const *vl, gauge_t *rates) /* {{{ */
+{
+  if (vl->time <= s->last_time)
+    return 0;
+
+  double interval = CDTIME_T_TO_DOUBLE(vl->time - s->last_time);
+  for (size_t i = 0; i < ds->ds_num; i++) {
+    value_t v = vl->values[i];
+
+    if (ds->ds[i].type == DS_TYPE_GAUGE) {
+      rates[i] = v.gauge;
+      continue;
+    }
+
+    if (s->last_time == 0)
+      rates[i] = NAN;
+    else if (ds->ds[i].type == DS_TYPE_COUNTER)
+      rates[i] = ((gauge_t)counter_diff(s->raw[i].counter, v.counter)) /
+                 interval;
+    else if (ds->ds[i].type == DS_TYPE_DERIVE)
+      rates[i] = ((gauge_t)(v.derive - s->raw[i].derive)) / interval;
+    else /* DS_TYPE_ABSOLUTE */
+      rates[i] = ((gauge_t)v.absolute) / interval;
+    s->raw[i] = v;
+  }
+
+  s->last_time = vl->time;
+  return 1;
+} /* }}} _Bool uh_series_rates */
+
+static int uh_series_add_chunk(uh_series_t *s) /* {{{ */
+{
+  gorilla_chunk_t **tmp =
+      realloc(s->chunks, (s->chunks_num + 1) * sizeof(*s->chunks));
+  if (tmp == NULL)
+    return ENOMEM;
+  s->chunks = tmp;
+
+  gorilla_chunk_t *c = gorilla_chunk_create(UH_CHUNK_SIZE, s->values_num);
+  if (c == NULL)
+    return ENOMEM;
+
+  if (s->chunks_num > 0) {
+    gorilla_chunk_t *last = s->chunks[s->chunks_num - 1];
+    size_t before = gorilla_chunk_memory(last);
+    last = gorilla_chunk_seal(last);
+    uh_memory_sub(s, before - gorilla_chunk_memory(last));
+    s->chunks[s->chunks_num - 1] = last;
+  }
+
+  s->chunks[s->chunks_num] = c;
+  s->chunks_num++;
+  uh_memory_add(s, gorilla_chunk_memory(c) + sizeof(*s->chunks));
+  return 0;
+} /* }}} int uh_series_add_chunk */
+
+static int uh_series_append(uh_series_t *s, cdtime_t time,
+                            gauge_t const *rates) /* {{{ */
+{
+  int64_t time_ms = (int64_t)CDTIME_T_TO_MS(time);
+  int status = ENOSPC;
+
+  if (s->chunks_num > 0)
+    status = gorilla_chunk_append(s->chunks[s->chunks_num - 1], s->columns,
+                                  time_ms, rates);
+  if (status == ENOSPC) {
+    status = uh_series_add_chunk(s);
+    if (status == 0)
+      status = gorilla_chunk_append(s->chunks[s->chunks_num - 1], s->columns,
+                                    time_ms, rates);
+  }
+  if (status != 0)
+    return status;
+
+  uh_points++;
+
+  /* Drop chunks which only hold points outside of the window. */
+  int64_t cutoff = time_ms - (int64_t)CDTIME_T_TO_MS(uh_window);
+  size_t expired = 0;
+  while ((expired < s->chunks_num - 1) && (s->chunks[expired]->last < cutoff)) {
+    uh_points -= s->chunks[expired]->count;
+    uh_memory_sub(s, gorilla_chunk_memory(s->chunks[expired]) +
+                         sizeof(*s->chunks));
+    free(s->chunks[expired]);
+    expired++;
+  }
+  if (expired > 0) {
+    s->chunks_num -= expired;
+    memmove(s->chunks, s->chunks + expired,
+            s->chunks_num * sizeof(*s->chunks));
+  }
+
+  return 0;
+} /* }}} int uh_series_append */
+
+int uh_init(cdtime_t window, size_t memory_limit) /* {{{ */
+{
+  if (window == 0)
+    return 0;
+
+  pthread_mutex_lock(&uh_lock);
+  if (uh_tree == NULL)
+    uh_tree = c_avl_create((int (*)(const void *, const void *))strcmp);
+  if (uh_tree == NULL) {
+    pthread_mutex_unlock(&uh_lock);
+    ERROR("uh_init: c_avl_create failed.");
+    return ENOMEM;
+  }
+  uh_window = window;
+  uh_memory_limit = memory_limit;
+  pthread_mutex_unlock(&uh_lock);
+
+  return 0;
+} /* }}} int uh_init */
+
+void uh_destroy(void) /* {{{ */
+{
+  pthread_mutex_lock(&uh_lock);
+  while (uh_head != NULL) {
+    uh_series_t *s = uh_head;
+    uh_lru_unlink(s);
+    uh_series_free(s);
+  }
+  c_avl_destroy(uh_tree);
+  uh_tree = NULL;
+
+  uh_window = 0;
+  uh_memory = 0;
+  uh_points = 0;
+  uh_evicted = 0;
+  pthread_mutex_unlock(&uh_lock);
+} /* }}} void uh_destroy */
+
+_Bool uh_enabled(void) /* {{{ */
+{
+  return uh_window != 0;
+} /* }}} _Bool uh_enabled */
+
+int uh_update(data_set_t const *ds, value_list_t const *vl) /* {{{ */
+{
+  char name[6 * DATA_MAX_NAME_LEN];
+  gauge_t rates[GORILLA_VALUES_MAX];
+  uh_series_t *s = NULL;
+
+  if (uh_window == 0)
+    return 0;
+  if ((ds->ds_num == 0) || (ds->ds_num > GORILLA_VALUES_MAX))
+    return EINVAL;
+  if (FORMAT_VL(name, sizeof(name), vl) != 0) {
+    ERROR("uh_update: FORMAT_VL failed.");
+    return -1;
+  }
+
+  pthread_mutex_lock(&uh_lock);
+
+  if (c_avl_get(uh_tree, name, (void *)&s) == 0) {
+    if (s->values_num != ds->ds_num) {
+      pthread_mutex_unlock(&uh_lock);
+      return EINVAL;
+    }
+    uh_lru_unlink(s);
+  } else {
+    s = uh_series_create(name, ds);
+    if ((s == NULL) || (c_avl_insert(uh_tree, s->name, s) != 0)) {
+      uh_series_free(s);
+      pthread_mutex_unlock(&uh_lock);
+      ERROR("uh_update: Creating series \"%s\" failed.", name);
+      return ENOMEM;
+    }
+  }
+  uh_lru_push(s);
+
+  int status = 0;
+  if (uh_series_rates(s, ds, vl, rates))
+    status = uh_series_append(s, vl->time, rates);
+
+  /* Evict series which have not been updated within the window, and the
+   * least recently updated series while the store exceeds its limit. */
+  cdtime_t now = cdtime();
+  for (int i = 0; (i < UH_STALE_EVICT_MAX) && (uh_tail != s) &&
+                  (uh_tail->last_time + uh_window < now);
+       i++)
+    uh_evict(uh_tail);
+  while ((uh_memory_limit > 0) && (uh_memory > uh_memory_limit) &&
+         (uh_tail != s))
+    uh_evict(uh_tail);
+
+  pthread_mutex_unlock(&uh_lock);
+  return status;
+} /* }}} int uh_update */
+
+static int uh_result_append(uh_result_t *r, int64_t time_ms,
+                            gauge_t const *values) /* {{{ */
+{
+  if (r->num >= r->size) {
+    size_t size = (r->size == 0) ? 64 : 2 * r->size;
+
+    cdtime_t *times = realloc(r->times, size * sizeof(*times));
+    if (times == NULL)
+      return ENOMEM;
+    r->times = times;
+
+    gauge_t *tmp = realloc(r->values, size * r->values_num * sizeof(*tmp));
+    if (tmp == NULL)
+      return ENOMEM;
+    r->values = tmp;
+
+    r->size = size;
+  }
+
+  r->times[r->num] = MS_TO_CDTIME_T(time_ms);
+  memcpy(r->values + r->num * r->values_num, values,
+         r->values_num * sizeof(*values));
+  r->num++;
+  return 0;
+} /* }}} int uh_result_append */
+
+static void uh_aggregate(gauge_t *agg, size_t *agg_num, gauge_t const *values,
+                         size_t values_num,
+                         uh_aggregation_t aggregation) /* {{{ */
+{
+  for (size_t i = 0; i < values_num; i++) {
+    if (isnan(values[i]))
+      continue;
+
+    if (agg_num[i] == 0)
+      agg[i] = values[i];
+    else if (aggregation == UH_MINIMUM)
+      agg[i] = (values[i] < agg[i]) ? values[i] : agg[i];
+    else if (aggregation == UH_MAXIMUM)
+      agg[i] = (values[i] > agg[i]) ? values[i] : agg[i];
+    else
+      agg[i] += values[i];
+    agg_num[i]++;
+  }
+} /* }}} void uh_aggregate */
+
+static int uh_aggregate_flush(uh_result_t *r, int64_t time_ms, gauge_t *agg,
+                              size_t *agg_num,
+                              uh_aggregation_t aggregation) /* {{{ */
+{
+  for (size_t i = 0; i < r->values_num; i++) {
+    if (agg_num[i] == 0)
+      agg[i] = NAN;
+    else if (aggregation == UH_AVERAGE)
+      agg[i] /= (gauge_t)agg_num[i];
+    agg_num[i] = 0;
+  }
+
+  return uh_result_append(r, time_ms, agg);
+} /* }}} int uh_aggregate_flush */
+
+int uh_query(char const *name, cdtime_t start, cdtime_t end, cdtime_t step,
+             uh_aggregation_t aggregation, cdtime_t **ret_times,
+             gauge_t **ret_values, size_t *ret_points,
+             size_t *ret_values_num) /* {{{ */
+{
+  gauge_t values[GORILLA_VALUES_MAX];
+  gauge_t agg[GORILLA_VALUES_MAX];
+  size_t agg_num[GORILLA_VALUES_MAX] = {0};
+  int64_t bucket = 0;
+  _Bool have_bucket = 0;
+  uh_series_t *s = NULL;
+  int status = 0;
+
+  if ((name == NULL) || (ret_times == NULL) || (ret_values == NULL) ||
+      (ret_points == NULL) || (ret_values_num == NULL))
+    return EINVAL;
+
+  int64_t start_ms = (start == 0) ? INT64_MIN : (int64_t)CDTIME_T_TO_MS(start);
+  int64_t end_ms = (end == 0) ? INT64_MAX : (int64_t)CDTIME_T_TO_MS(end);
+  int64_t step_ms = (int64_t)CDTIME_T_TO_MS(step);
+  if ((step != 0) && (step_ms == 0))
+    step_ms = 1;
+
+  pthread_mutex_lock(&uh_lock);
+  if ((uh_tree == NULL) || (c_avl_get(uh_tree, name, (void *)&s) != 0)) {
+    pthread_mutex_unlock(&uh_lock);
+    return ENOENT;
+  }
+
+  uh_result_t r = {.values_num = s->values_num};
+  for (size_t i = 0; (status == 0) && (i < s->chunks_num); i++) {
+    gorilla_chunk_t const *c = s->chunks[i];
+    gorilla_iter_t iter;
+    int64_t time_ms;
+
+    if ((c->last < start_ms) || (c->first > end_ms))
+      continue;
+
+    gorilla_iter_init(&iter, c);
+    while ((status == 0) && (gorilla_iter_next(&iter, &time_ms, values) == 0)) {
+      if (time_ms < start_ms)
+        continue;
+      if (time_ms > end_ms)
+        break;
+
+      if (step_ms == 0) {
+        status = uh_result_append(&r, time_ms, values);
+        continue;
+      }
+
+      int64_t b = time_ms - (time_ms % step_ms);
+      if (have_bucket && (b != bucket))
+        status = uh_aggregate_flush(&r, bucket, agg, agg_num, aggregation);
+      bucket = b;
+      have_bucket = 1;
+      uh_aggregate(agg, agg_num, values, r.values_num, aggregation);
+    }
+  }
+  if ((status == 0) && have_bucket)
+    status = uh_aggregate_flush(&r, bucket, agg, agg_num, aggregation);
+
+  pthread_mutex_unlock(&uh_lock);
+
+  if (status != 0) {
+    sfree(r.times);
+    sfree(r.values);
+    return status;
+  }
+
+  *ret_times = r.times;
+  *ret_values = r.values;
+  *ret_points = r.num;
+  *ret_values_num = r.values_num;
+  return 0;
+} /* }}} int uh_query */
+
+int uh_stats(uh_stats_t *ret_stats) /* {{{ */
+{
+  if (ret_stats == NULL)
+    return EINVAL;
+
+  pthread_mutex_lock(&uh_lock);
+  ret_stats->series_num = (uh_tree != NULL) ? (size_t)c_avl_size(uh_tree) : 0;
+  ret_stats->points_num = uh_points;
+  ret_stats->memory = uh_memory;
+  ret_stats->evicted = uh_evicted;
+  pthread_mutex_unlock(&uh_lock);
+
+  return 0;
+} /* }}} int uh_stats */
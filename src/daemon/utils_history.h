@@ -0,0 +1,102 @@
+/**
+ * collectd - src/daemon/utils_history.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_HISTORY_H
+#define UTILS_HISTORY_H 1
+
+#include "plugin.h"
+
+/* The history store keeps the recent values of every series passing through
+ * the write path in memory, compressed with utils_gorilla. Counters, derives
+ * and absolute values are stored as rates, like in the value cache.
+ *
+ * Each series keeps at least "window" worth of points; older chunks are
+ * dropped. If the store uses more than "memory_limit" bytes, the least
+ * recently updated series are evicted entirely. Series which have not been
+ * updated for longer than the window are evicted, too. */
+
+typedef enum {
+  UH_AVERAGE = 0,
+  UH_MINIMUM,
+  UH_MAXIMUM,
+} uh_aggregation_t;
+
+typedef struct {
+  size_t series_num;
+  size_t points_num;
+  size_t memory;
+  uint64_t evicted;
+} uh_stats_t;
+
+/*
+ * NAME
+ *   uh_init
+ *
+ * DESCRIPTION
+ *   Enables the history store. A "window" of zero disables it, which is the
+ *   default. A "memory_limit" of zero means no limit.
+ */
+int uh_init(cdtime_t window, size_t memory_limit);
+
+/* Frees all series and disables the store. */
+void uh_destroy(void);
+
+/*
+ * NAME
+ *   uh_update
+ *
+ * DESCRIPTION
+ *   Appends the value list to the history of its series. Does nothing if the
+ *   store is disabled.
+ */
+int uh_update(data_set_t const *ds, value_list_t const *vl);
+
+/*
+ * NAME
+ *   uh_query
+ *
+ * DESCRIPTION
+ *   Returns the points of the series "name" with a time in [start, end]. A
+ *   "start" or "end" of zero does not limit the range. If "step" is non-zero,
+ *   points are aggregated into intervals of "step" length, aligned to
+ *   multiples of "step", and the start of each interval is returned as its
+ *   time.
+ *
+ *   The times are stored in a newly allocated array at "ret_times", the
+ *   "ret_points" times "ret_values_num" values in one at "ret_values". The
+ *   caller has to free both.
+ *
+ * RETURN VALUE
+ *   Zero on success, ENOENT if the series is unknown or the store is
+ *   disabled, or another errno value on failure.
+ */
+int uh_query(char const *name, cdtime_t start, cdtime_t end, cdtime_t step,
+             uh_aggregation_t aggregation, cdtime_t **ret_times,
+             gauge_t **ret_values, size_t *ret_points, size_t *ret_values_num);
+
+/* Returns true if the history store is enabled. */
+_Bool uh_enabled(void);
+
+int uh_stats(uh_stats_t *ret_stats);
+
+#endif /* UTILS_HISTORY_H */
@@ -0,0 +1,143 @@
+/**
+ * collectd - src/daemon/utils_history_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Fills the history store with BENCH_SERIES gauge series of BENCH_POINTS
+ * points each, i.e. 15 minutes at a 10 second interval, and reports the
+ * memory used per point, both as accounted by the store and as the growth of
+ * the resident set size. A third of the series are constant, a third count
+ * up slowly and a third are noisy with one decimal digit. Timestamps have a
+ * few milliseconds of jitter, like values read by collectd. Build with
+ * "make bench_utils_history"; the number of series may be given as argument.
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_history.h"
+
+#include <time.h>
+
+#define BENCH_SERIES 1000000
+#define BENCH_POINTS 90
+
+static data_source_t dsrc = {"value", DS_TYPE_GAUGE, NAN, NAN};
+static data_set_t ds = {"gauge", 1, &dsrc};
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static size_t read_rss(void) {
+  char buffer[1024];
+  size_t rss = 0;
+  FILE *fh = fopen("/proc/self/status", "r");
+
+  if (fh == NULL)
+    return 0;
+  while (fgets(buffer, sizeof(buffer), fh) != NULL)
+    if (strncmp(buffer, "VmRSS:", 6) == 0)
+      rss = 1024 * (size_t)strtoull(buffer + 6, NULL, 10);
+  fclose(fh);
+  return rss;
+}
+
+static gauge_t bench_value(size_t series, size_t point) {
+  switch (series % 3) {
+  case 0:
+    return 100.0;
+  case 1:
+    return (gauge_t)(series + point / 4);
+  default:
+    return (gauge_t)((series * 7919 + point * 104729) % 1000) / 10.0;
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t series_num = BENCH_SERIES;
+  if (argc > 1)
+    series_num = (size_t)strtoull(argv[1], NULL, 10);
+
+  if (uh_init(TIME_T_TO_CDTIME_T(BENCH_POINTS * 10), 0) != 0)
+    return 1;
+
+  value_list_t vl = VALUE_LIST_INIT;
+  value_t value;
+  vl.values = &value;
+  vl.values_len = 1;
+  vl.interval = TIME_T_TO_CDTIME_T(10);
+  sstrncpy(vl.host, "host.example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "bench", sizeof(vl.plugin));
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+
+  size_t rss = read_rss();
+  double start = cpu_time();
+  for (size_t p = 0; p < BENCH_POINTS; p++) {
+    for (size_t s = 0; s < series_num; s++) {
+      cdtime_t jitter = MS_TO_CDTIME_T((s + p * 31) % 5);
+      vl.time = TIME_T_TO_CDTIME_T(1500000000 + 10 * p) + jitter;
+      value.gauge = bench_value(s, p);
+      snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%zu", s);
+      if (uh_update(&ds, &vl) != 0)
+        return 1;
+    }
+  }
+  double update_time = cpu_time() - start;
+  size_t rss_delta = read_rss() - rss;
+
+  uh_stats_t stats;
+  uh_stats(&stats);
+
+  cdtime_t *times;
+  gauge_t *values;
+  size_t points_num, values_num;
+  start = cpu_time();
+  for (size_t s = 0; s < 10000; s++) {
+    char name[6 * DATA_MAX_NAME_LEN];
+    snprintf(name, sizeof(name), "host.example.com/bench-%zu/gauge",
+             s % series_num);
+    if (uh_query(name, 0, 0, 0, UH_AVERAGE, &times, &values, &points_num,
+                 &values_num) != 0)
+      return 1;
+    free(times);
+    free(values);
+  }
+  double query_time = cpu_time() - start;
+
+  printf("%zu series, %zu points\n", stats.series_num, stats.points_num);
+  printf("accounted: %8.1f MiB, %5.2f bytes/point (16 uncompressed)\n",
+         (double)stats.memory / 1048576.0,
+         (double)stats.memory / (double)stats.points_num);
+  printf("RSS:       %8.1f MiB, %5.2f bytes/point\n",
+         (double)rss_delta / 1048576.0,
+         (double)rss_delta / (double)stats.points_num);
+  printf("update:    %8.3f us/point\n",
+         1e6 * update_time / (double)(series_num * BENCH_POINTS));
+  printf("query:     %8.3f us/series (%zu points)\n", 1e6 * query_time / 1e4,
+         points_num);
+
+  uh_destroy();
+  return 0;
+}
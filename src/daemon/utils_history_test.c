@@ -0,0 +1,246 @@
+/**
+ * collectd - src/daemon/utils_history_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+/* testing.h must come first to declare cdtime_mock in utils_time.h. */
+#include "testing.h"
+
+#include "common.h"
+#include "utils_history.h"
+
+static data_source_t dsrc_gauge = {"value", DS_TYPE_GAUGE, NAN, NAN};
+static data_set_t ds_gauge = {"gauge", 1, &dsrc_gauge};
+
+static data_source_t dsrc_derive[] = {{"rx", DS_TYPE_DERIVE, 0, NAN},
+                                      {"tx", DS_TYPE_DERIVE, 0, NAN}};
+static data_set_t ds_derive = {"if_octets", 2, dsrc_derive};
+
+static int update(data_set_t const *ds, char const *plugin_instance,
+                  cdtime_t time, value_t *values) {
+  value_list_t vl = {
+      .values = values,
+      .values_len = ds->ds_num,
+      .time = time,
+      .interval = TIME_T_TO_CDTIME_T(10),
+  };
+  sstrncpy(vl.host, "example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "test", sizeof(vl.plugin));
+  sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
+  sstrncpy(vl.type, ds->type, sizeof(vl.type));
+
+  cdtime_mock = time;
+  return uh_update(ds, &vl);
+}
+
+DEF_TEST(disabled) {
+  cdtime_t *times = NULL;
+  gauge_t *values = NULL;
+  size_t points_num = 0, values_num = 0;
+
+  OK(!uh_enabled());
+  CHECK_ZERO(update(&ds_gauge, "a", TIME_T_TO_CDTIME_T(1000),
+                    &(value_t){.gauge = 1}));
+  EXPECT_EQ_INT(ENOENT, uh_query("example.com/test-a/gauge", 0, 0, 0,
+                                 UH_AVERAGE, &times, &values, &points_num,
+                                 &values_num));
+  return 0;
+}
+
+DEF_TEST(gauge) {
+  cdtime_t *times = NULL;
+  gauge_t *values = NULL;
+  size_t points_num = 0, values_num = 0;
+
+  CHECK_ZERO(uh_init(TIME_T_TO_CDTIME_T(3600), 0));
+  OK(uh_enabled());
+
+  /* 20 minutes of data, 10 second interval. */
+  for (int i = 0; i < 120; i++)
+    CHECK_ZERO(update(&ds_gauge, "a", TIME_T_TO_CDTIME_T(1000000 + 10 * i),
+                      &(value_t){.gauge = (gauge_t)i}));
+
+  CHECK_ZERO(uh_query("example.com/test-a/gauge", 0, 0, 0, UH_AVERAGE, &times,
+                      &values, &points_num, &values_num));
+  EXPECT_EQ_INT(120, points_num);
+  EXPECT_EQ_INT(1, values_num);
+  for (size_t i = 0; i < points_num; i++) {
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(1000000 + 10 * i), times[i]);
+    EXPECT_EQ_DOUBLE((gauge_t)i, values[i]);
+  }
+  sfree(times);
+  sfree(values);
+
+  /* Range query. */
+  CHECK_ZERO(uh_query("example.com/test-a/gauge",
+                      TIME_T_TO_CDTIME_T(1000100), TIME_T_TO_CDTIME_T(1000200),
+                      0, UH_AVERAGE, &times, &values, &points_num,
+                      &values_num));
+  EXPECT_EQ_INT(11, points_num);
+  EXPECT_EQ_DOUBLE(10.0, values[0]);
+  EXPECT_EQ_DOUBLE(20.0, values[10]);
+  sfree(times);
+  sfree(values);
+
+  /* Downsampled to one minute. */
+  struct {
+    uh_aggregation_t aggregation;
+    gauge_t want;
+  } cases[] = {
+      {UH_AVERAGE, 4.5}, {UH_MINIMUM, 2.0}, {UH_MAXIMUM, 7.0},
+  };
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cases); i++) {
+    CHECK_ZERO(uh_query("example.com/test-a/gauge", 0, 0,
+                        TIME_T_TO_CDTIME_T(60), cases[i].aggregation, &times,
+                        &values, &points_num, &values_num));
+    /* 1000000 is not a multiple of 60, so the data spans 21 intervals. */
+    EXPECT_EQ_INT(21, points_num);
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(999960), times[0]);
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(1000020), times[1]);
+    EXPECT_EQ_DOUBLE(cases[i].want, values[1]);
+    sfree(times);
+    sfree(values);
+  }
+
+  EXPECT_EQ_INT(ENOENT, uh_query("example.com/test-b/gauge", 0, 0, 0,
+                                 UH_AVERAGE, &times, &values, &points_num,
+                                 &values_num));
+
+  uh_destroy();
+  return 0;
+}
+
+DEF_TEST(rates) {
+  cdtime_t *times = NULL;
+  gauge_t *values = NULL;
+  size_t points_num = 0, values_num = 0;
+
+  CHECK_ZERO(uh_init(TIME_T_TO_CDTIME_T(3600), 0));
+
+  for (int i = 0; i < 3; i++) {
+    value_t v[] = {{.derive = 100 * i}, {.derive = 1000 * i}};
+    CHECK_ZERO(update(&ds_derive, "a", TIME_T_TO_CDTIME_T(1000000 + 10 * i),
+                      v));
+  }
+
+  CHECK_ZERO(uh_query("example.com/test-a/if_octets", 0, 0, 0, UH_AVERAGE,
+                      &times, &values, &points_num, &values_num));
+  EXPECT_EQ_INT(3, points_num);
+  EXPECT_EQ_INT(2, values_num);
+  EXPECT_EQ_DOUBLE(NAN, values[0]);
+  EXPECT_EQ_DOUBLE(NAN, values[1]);
+  EXPECT_EQ_DOUBLE(10.0, values[2]);
+  EXPECT_EQ_DOUBLE(100.0, values[3]);
+  EXPECT_EQ_DOUBLE(10.0, values[4]);
+  EXPECT_EQ_DOUBLE(100.0, values[5]);
+  sfree(times);
+  sfree(values);
+
+  /* Aggregation ignores NaN. */
+  CHECK_ZERO(uh_query("example.com/test-a/if_octets", 0, 0,
+                      TIME_T_TO_CDTIME_T(3600), UH_AVERAGE, &times, &values,
+                      &points_num, &values_num));
+  EXPECT_EQ_INT(1, points_num);
+  EXPECT_EQ_DOUBLE(10.0, values[0]);
+  EXPECT_EQ_DOUBLE(100.0, values[1]);
+  sfree(times);
+  sfree(values);
+
+  uh_destroy();
+  return 0;
+}
+
+DEF_TEST(window) {
+  uh_stats_t stats;
+
+  CHECK_ZERO(uh_init(TIME_T_TO_CDTIME_T(600), 0));
+
+  /* A day worth of points must not be kept for a ten minute window. */
+  for (int i = 0; i < 8640; i++)
+    CHECK_ZERO(update(&ds_gauge, "a", TIME_T_TO_CDTIME_T(1000000 + 10 * i),
+                      &(value_t){.gauge = (gauge_t)(i % 17)}));
+  CHECK_ZERO(uh_stats(&stats));
+  EXPECT_EQ_INT(1, stats.series_num);
+  OK(stats.points_num >= 60);
+  OK(stats.points_num < 300);
+
+  /* Series not updated within the window are evicted. */
+  CHECK_ZERO(update(&ds_gauge, "b", TIME_T_TO_CDTIME_T(2000000),
+                    &(value_t){.gauge = 1}));
+  CHECK_ZERO(uh_stats(&stats));
+  EXPECT_EQ_INT(1, stats.series_num);
+  EXPECT_EQ_INT(1, stats.points_num);
+  EXPECT_EQ_INT(1, stats.evicted);
+
+  uh_destroy();
+  return 0;
+}
+
+DEF_TEST(memory_limit) {
+  uh_stats_t stats;
+  cdtime_t *times = NULL;
+  gauge_t *values = NULL;
+  size_t points_num = 0, values_num = 0;
+
+  CHECK_ZERO(uh_init(TIME_T_TO_CDTIME_T(3600), 64 * 1024));
+
+  for (int i = 0; i < 1000; i++) {
+    char instance[DATA_MAX_NAME_LEN];
+    snprintf(instance, sizeof(instance), "%d", i);
+    CHECK_ZERO(update(&ds_gauge, instance, TIME_T_TO_CDTIME_T(1000000),
+                      &(value_t){.gauge = (gauge_t)i}));
+  }
+  for (int i = 1; i < 10; i++)
+    CHECK_ZERO(update(&ds_gauge, "999", TIME_T_TO_CDTIME_T(1000000 + 10 * i),
+                      &(value_t){.gauge = (gauge_t)i}));
+
+  CHECK_ZERO(uh_stats(&stats));
+  OK(stats.memory <= 64 * 1024);
+  OK(stats.series_num < 1000);
+  OK(stats.evicted > 0);
+
+  /* The most recently updated series are kept. */
+  CHECK_ZERO(uh_query("example.com/test-999/gauge", 0, 0, 0, UH_AVERAGE,
+                      &times, &values, &points_num, &values_num));
+  EXPECT_EQ_INT(10, points_num);
+  sfree(times);
+  sfree(values);
+  EXPECT_EQ_INT(ENOENT, uh_query("example.com/test-0/gauge", 0, 0, 0,
+                                 UH_AVERAGE, &times, &values, &points_num,
+                                 &values_num));
+
+  uh_destroy();
+  CHECK_ZERO(uh_stats(&stats));
+  EXPECT_EQ_INT(0, stats.memory);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(disabled);
+  RUN_TEST(gauge);
+  RUN_TEST(rates);
+  RUN_TEST(window);
+  RUN_TEST(memory_limit);
+
+  END_TEST;
+}
@@ -0,0 +1,138 @@
+/**
+ * collectd - src/daemon/utils_log_ring.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_log_ring.h"
+
+/* Bounded multi-producer queue after Dmitry Vyukov's design: every slot
+ * carries a sequence number telling producers and the consumer whose turn it
+ * is. A producer claims a position with a compare-and-swap on "head" and
+ * publishes the slot by advancing its sequence number; the consumer releases
+ * the slot for the next round the same way. */
+
+typedef struct {
+  size_t seq;
+  int level;
+  char message[LOG_RING_MESSAGE_SIZE];
+} log_slot_t;
+
+struct log_ring_s {
+  log_slot_t *slots;
+  size_t mask;
+
+  /* Producers and the consumer write to different cache lines. */
+  size_t head __attribute__((aligned(64)));
+  size_t tail __attribute__((aligned(64)));
+};
+
+log_ring_t *log_ring_create(size_t size) /* {{{ */
+{
+  size_t n = 2;
+  while (n < size)
+    n *= 2;
+
+  log_ring_t *r = calloc(1, sizeof(*r));
+  if (r == NULL)
+    return NULL;
+
+  r->slots = calloc(n, sizeof(*r->slots));
+  if (r->slots == NULL) {
+    sfree(r);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < n; i++)
+    r->slots[i].seq = i;
+  r->mask = n - 1;
+
+  return r;
+} /* }}} log_ring_t *log_ring_create */
+
+void log_ring_destroy(log_ring_t *r) /* {{{ */
+{
+  if (r == NULL)
+    return;
+
+  sfree(r->slots);
+  sfree(r);
+} /* }}} void log_ring_destroy */
+
+int log_ring_push(log_ring_t *r, int level, char const *message) /* {{{ */
+{
+  size_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+  log_slot_t *slot;
+
+  while (42) {
+    slot = r->slots + (pos & r->mask);
+    size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&r->head, &pos, pos + 1,
+                                      /* weak = */ 1, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED))
+        break;
+      /* pos has been updated by the failed compare-and-swap. */
+    } else if (diff < 0) {
+      return ENOBUFS;
+    } else {
+      pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    }
+  }
+
+  /* Not sstrncpy(): strncpy() pads the whole slot with zeros. */
+  size_t len = strnlen(message, sizeof(slot->message) - 1);
+  memcpy(slot->message, message, len);
+  slot->message[len] = 0;
+  slot->level = level;
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+  return 0;
+} /* }}} int log_ring_push */
+
+int log_ring_pop(log_ring_t *r, int *level, char *buffer, /* {{{ */
+                 size_t buffer_size) {
+  size_t pos = r->tail;
+  log_slot_t *slot = r->slots + (pos & r->mask);
+
+  if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+    return EAGAIN;
+
+  size_t len = strnlen(slot->message, buffer_size - 1);
+  memcpy(buffer, slot->message, len);
+  buffer[len] = 0;
+  *level = slot->level;
+
+  r->tail = pos + 1;
+  __atomic_store_n(&slot->seq, pos + r->mask + 1, __ATOMIC_RELEASE);
+
+  return 0;
+} /* }}} int log_ring_pop */
+
+_Bool log_ring_empty(log_ring_t *r) /* {{{ */
+{
+  log_slot_t *slot = r->slots + (r->tail & r->mask);
+  return __atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST) != r->tail + 1;
+} /* }}} _Bool log_ring_empty */
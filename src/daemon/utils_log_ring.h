@@ -0,0 +1,82 @@
+/**
+ * collectd - src/daemon/utils_log_ring.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_LOG_RING_H
+#define UTILS_LOG_RING_H 1
+
+#include "collectd.h"
+
+/* A bounded queue of log messages which any number of threads may push to
+ * without taking a lock, drained by a single consumer. Messages are copied
+ * into preallocated slots, so pushing never allocates memory either. When the
+ * ring is full, log_ring_push fails and the caller is expected to count the
+ * message as dropped. */
+
+#define LOG_RING_MESSAGE_SIZE 1024
+
+struct log_ring_s;
+typedef struct log_ring_s log_ring_t;
+
+/*
+ * NAME
+ *   log_ring_create
+ *
+ * DESCRIPTION
+ *   Allocates a ring holding "size" messages. "size" is rounded up to the
+ *   next power of two. Returns NULL on failure.
+ */
+log_ring_t *log_ring_create(size_t size);
+
+void log_ring_destroy(log_ring_t *r);
+
+/*
+ * NAME
+ *   log_ring_push
+ *
+ * DESCRIPTION
+ *   Copies "message", truncated to LOG_RING_MESSAGE_SIZE bytes, into the ring.
+ *   May be called from any thread.
+ *
+ * RETURN VALUE
+ *   Zero on success, ENOBUFS if the ring is full.
+ */
+int log_ring_push(log_ring_t *r, int level, char const *message);
+
+/*
+ * NAME
+ *   log_ring_pop
+ *
+ * DESCRIPTION
+ *   Removes the oldest message from the ring and copies it to "buffer". Must
+ *   only be called by one thread at a time.
+ *
+ * RETURN VALUE
+ *   Zero on success, EAGAIN if the ring is empty.
+ */
+int log_ring_pop(log_ring_t *r, int *level, char *buffer, size_t buffer_size);
+
+/* Returns true if the ring holds no messages. Intended for the consumer to
+ * check before going to sleep. */
+_Bool log_ring_empty(log_ring_t *r);
+
+#endif /* UTILS_LOG_RING_H */
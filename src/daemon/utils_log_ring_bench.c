@@ -0,0 +1,147 @@
+/**
+ * collectd - src/daemon/utils_log_ring_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Replays the logging done by the filedata read path, one FINFO() message
+ * per dispatched value, through the daemon's plugin_log():
+ *
+ *  - "gated": the log callback's LogLevel is "err", so the message is
+ *    discarded before it is formatted,
+ *  - "sync": LogLevel "info", the callback writes each message to a file from
+ *    the calling thread,
+ *  - "ring": LogLevel "info" and "LogQueueLength", messages are pushed to the
+ *    log ring which the log thread drains to the same file.
+ *
+ * The values are logged in reads of BENCH_READ_VALUES each. Reports the time
+ * per value spent in the calling (read) thread; waiting for the log thread to
+ * catch up between reads is not counted. Build with
+ * "make bench_utils_log_ring".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "configfile.h"
+#include "plugin.h"
+
+#include <sched.h>
+#include <time.h>
+
+#define BENCH_VALUES 1000000
+#define BENCH_READ_VALUES 4000
+#define BENCH_QUEUE_LENGTH "4096"
+
+/* Defined in collectd.c, which is not linked into the benchmark. */
+char hostname_g[DATA_MAX_NAME_LEN] = "example.com";
+cdtime_t interval_g;
+int timeout_g;
+#if HAVE_LIBKSTAT
+kstat_ctl_t *kc;
+#endif
+
+static FILE *log_fh = NULL;
+static uint64_t logged = 0;
+
+static double wall_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static void log_callback(int level, char const *msg,
+                         user_data_t __attribute__((unused)) * ud) {
+  fprintf(log_fh, "[%d] %s\n", level, msg);
+  fflush(log_fh);
+  __atomic_fetch_add(&logged, 1, __ATOMIC_RELEASE);
+}
+
+/* the per-value message of filedata_dispatch_values() */
+static double read_path(_Bool wait) {
+  value_list_t vl = VALUE_LIST_INIT;
+  sstrncpy(vl.host, "oss01.example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "lustre", sizeof(vl.plugin));
+  sstrncpy(vl.plugin_instance, "fs0-OST0001", sizeof(vl.plugin_instance));
+  sstrncpy(vl.type, "derive", sizeof(vl.type));
+  vl.time = cdtime();
+
+  __atomic_store_n(&logged, 0, __ATOMIC_RELEASE);
+
+  double total = 0.0;
+  for (uint64_t i = 0; i < BENCH_VALUES; i++) {
+    if ((i % BENCH_READ_VALUES) == 0) {
+      /* Let the log thread catch up with the previous read. */
+      while (wait && (__atomic_load_n(&logged, __ATOMIC_ACQUIRE) < i))
+        sched_yield();
+      total -= wall_time();
+    }
+
+    ssnprintf(vl.type_instance, sizeof(vl.type_instance), "read_bytes-%" PRIu64,
+              i % 64);
+    INFO("host %s, "
+         "plugin %s, "
+         "plugin_instance %s, "
+         "type %s, "
+         "type_instance %s, "
+         "tsdb_name %s, "
+         "tsdb_tags %s, "
+         "value %" PRIu64 ", "
+         "time %llu ns",
+         vl.host, vl.plugin, vl.plugin_instance, vl.type, vl.type_instance,
+         "ost_stats_read_bytes", "optype=read ost_index=OST0001 fs_name=fs0",
+         i, (unsigned long long)CDTIME_T_TO_NS(vl.time));
+
+    if ((i % BENCH_READ_VALUES) == BENCH_READ_VALUES - 1)
+      total += wall_time();
+  }
+  return 1e9 * total / BENCH_VALUES;
+}
+
+int main(void) {
+  char path[] = "/tmp/bench_log_ringXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return 1;
+  log_fh = fdopen(fd, "w");
+  unlink(path);
+
+  plugin_init_ctx();
+  plugin_register_log("bench", log_callback, /* user_data = */ NULL);
+
+  plugin_set_log_level("bench", LOG_ERR);
+  double gated = read_path(/* wait = */ 0);
+
+  plugin_set_log_level("bench", LOG_INFO);
+  double sync = read_path(/* wait = */ 1);
+
+  /* Starts the log thread. */
+  global_option_set("LogQueueLength", BENCH_QUEUE_LENGTH, /* from_cli = */ 0);
+  plugin_init_all();
+  double async = read_path(/* wait = */ 1);
+  plugin_shutdown_all();
+  fclose(log_fh);
+
+  printf("LogLevel err:  gated %6.1f ns/value\n", gated);
+  printf("LogLevel info: sync  %6.1f ns/value, ring %6.1f ns/value (%.1fx)\n",
+         sync, async, sync / async);
+  return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * collectd - src/daemon/utils_log_ring_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "plugin.h"
+#include "testing.h"
+#include "utils_log_ring.h"
+
+#include <sched.h>
+
+#define PRODUCERS 4
+#define MESSAGES 20000
+
+DEF_TEST(push_pop) {
+  log_ring_t *r;
+  char buffer[LOG_RING_MESSAGE_SIZE];
+  int level;
+
+  /* rounded up to four slots */
+  CHECK_NOT_NULL(r = log_ring_create(3));
+  OK(log_ring_empty(r));
+  EXPECT_EQ_INT(EAGAIN, log_ring_pop(r, &level, buffer, sizeof(buffer)));
+
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 4; i++) {
+      char msg[16];
+      snprintf(msg, sizeof(msg), "message %d", i);
+      EXPECT_EQ_INT(0, log_ring_push(r, LOG_ERR + i, msg));
+    }
+    EXPECT_EQ_INT(ENOBUFS, log_ring_push(r, LOG_ERR, "dropped"));
+    OK(!log_ring_empty(r));
+
+    for (int i = 0; i < 4; i++) {
+      char msg[16];
+      snprintf(msg, sizeof(msg), "message %d", i);
+      EXPECT_EQ_INT(0, log_ring_pop(r, &level, buffer, sizeof(buffer)));
+      EXPECT_EQ_INT(LOG_ERR + i, level);
+      EXPECT_EQ_STR(msg, buffer);
+    }
+    OK(log_ring_empty(r));
+    EXPECT_EQ_INT(EAGAIN, log_ring_pop(r, &level, buffer, sizeof(buffer)));
+  }
+
+  log_ring_destroy(r);
+  return 0;
+}
+
+DEF_TEST(truncate) {
+  log_ring_t *r;
+  char msg[2 * LOG_RING_MESSAGE_SIZE];
+  char buffer[16];
+  int level;
+
+  memset(msg, 'x', sizeof(msg) - 1);
+  msg[sizeof(msg) - 1] = 0;
+
+  CHECK_NOT_NULL(r = log_ring_create(2));
+  EXPECT_EQ_INT(0, log_ring_push(r, LOG_INFO, msg));
+  EXPECT_EQ_INT(0, log_ring_pop(r, &level, buffer, sizeof(buffer)));
+  EXPECT_EQ_INT(sizeof(buffer) - 1, strlen(buffer));
+
+  log_ring_destroy(r);
+  return 0;
+}
+
+static log_ring_t *ring;
+
+static void *producer(void *arg) {
+  int id = *(int *)arg;
+
+  for (int i = 0; i < MESSAGES; i++) {
+    char msg[32];
+    snprintf(msg, sizeof(msg), "%d %d", id, i);
+    while (log_ring_push(ring, id, msg) != 0)
+      sched_yield();
+  }
+  return NULL;
+}
+
+DEF_TEST(producers) {
+  pthread_t threads[PRODUCERS];
+  int ids[PRODUCERS];
+  int next[PRODUCERS] = {0};
+  char buffer[LOG_RING_MESSAGE_SIZE];
+  int level;
+
+  CHECK_NOT_NULL(ring = log_ring_create(64));
+  for (int i = 0; i < PRODUCERS; i++) {
+    ids[i] = i;
+    CHECK_ZERO(pthread_create(threads + i, NULL, producer, ids + i));
+  }
+
+  /* every message arrives exactly once and in order per producer */
+  int received = 0;
+  _Bool in_order = 1;
+  while (received < PRODUCERS * MESSAGES) {
+    if (log_ring_pop(ring, &level, buffer, sizeof(buffer)) != 0) {
+      sched_yield();
+      continue;
+    }
+
+    int id, seq;
+    if ((sscanf(buffer, "%d %d", &id, &seq) != 2) || (id < 0) ||
+        (id >= PRODUCERS) || (id != level) || (seq != next[id]))
+      in_order = 0;
+    else
+      next[id]++;
+    received++;
+  }
+  OK(in_order);
+
+  for (int i = 0; i < PRODUCERS; i++)
+    pthread_join(threads[i], NULL);
+  OK(log_ring_empty(ring));
+
+  log_ring_destroy(ring);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(push_pop);
+  RUN_TEST(truncate);
+  RUN_TEST(producers);
+
+  END_TEST;
+}
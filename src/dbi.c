@@ -74,10 +74,40 @@ struct cdbi_database_s /* {{{ */
   udb_query_t **queries;
   size_t queries_num;
 
-  dbi_conn connection;
+  /* Queries are spread over this many connections. The read thread uses the
+   * first one, each of the others is used by its own worker thread. */
+  dbi_conn *connections;
+  size_t connections_num;
+
+  /* The workers are started by the first read and kept until shutdown. */
+  struct cdbi_worker_s *workers;
+  size_t workers_num;
+  _Bool workers_started;
+  _Bool workers_shutdown;
+
+  /* Protects the fields below. "read_cond" is signaled when "read_generation"
+   * is incremented to start a read, "done_cond" when "workers_busy" drops to
+   * zero. */
+  pthread_mutex_t lock;
+  pthread_cond_t read_cond;
+  pthread_cond_t done_cond;
+  uint64_t read_generation;
+  size_t workers_busy;
+  size_t next_query;
+  size_t success;
 };
 typedef struct cdbi_database_s cdbi_database_t; /* }}} */
 
+struct cdbi_worker_s /* {{{ */
+{
+  cdbi_database_t *db;
+  size_t index;
+  pthread_t thread;
+  /* The last read this worker took part in. */
+  uint64_t read_generation;
+};
+typedef struct cdbi_worker_s cdbi_worker_t; /* }}} */
+
 /*
  * Global variables
  */
@@ -90,6 +120,7 @@ static cdbi_database_t **databases = NULL;
 static size_t databases_num = 0;
 
 static int cdbi_read_database(user_data_t *ud);
+static void cdbi_stop_workers(cdbi_database_t *db);
 
 /*
  * Functions
@@ -171,8 +202,12 @@ static void cdbi_database_free(cdbi_database_t *db) /* {{{ */
   if (db == NULL)
     return;
 
+  cdbi_stop_workers(db);
+
   sfree(db->name);
+  sfree(db->select_db);
   sfree(db->driver);
+  sfree(db->host);
 
   for (size_t i = 0; i < db->driver_options_num; i++) {
     sfree(db->driver_options[i].key);
@@ -185,6 +220,16 @@ static void cdbi_database_free(cdbi_database_t *db) /* {{{ */
     for (size_t i = 0; i < db->queries_num; ++i)
       udb_query_delete_preparation_area(db->q_prep_areas[i]);
   free(db->q_prep_areas);
+  sfree(db->queries);
+
+  if (db->connections != NULL)
+    for (size_t i = 0; i < db->connections_num; i++)
+      if (db->connections[i] != NULL)
+        dbi_conn_close(db->connections[i]);
+  sfree(db->connections);
+  pthread_cond_destroy(&db->read_cond);
+  pthread_cond_destroy(&db->done_cond);
+  pthread_mutex_destroy(&db->lock);
 
   sfree(db);
 } /* }}} void cdbi_database_free */
@@ -205,6 +250,7 @@ static void cdbi_database_free(cdbi_database_t *db) /* {{{ */
  *   <Database "plugin_instance1">
  *     Driver "mysql"
  *     Interval 120
+ *     Connections 4
  *     DriverOption "hostname" "localhost"
  *     ...
  *     Query "plugin_instance0"
@@ -281,6 +327,11 @@ static int cdbi_config_add_database(oconfig_item_t *ci) /* {{{ */
     return status;
   }
 
+  pthread_mutex_init(&db->lock, /* attr = */ NULL);
+  pthread_cond_init(&db->read_cond, /* attr = */ NULL);
+  pthread_cond_init(&db->done_cond, /* attr = */ NULL);
+  db->connections_num = 1;
+
   /* Fill the `cdbi_database_t' structure.. */
   for (int i = 0; i < ci->children_num; i++) {
     oconfig_item_t *child = ci->children + i;
@@ -298,7 +349,15 @@ static int cdbi_config_add_database(oconfig_item_t *ci) /* {{{ */
       status = cf_util_get_string(child, &db->host);
     else if (strcasecmp("Interval", child->key) == 0)
       status = cf_util_get_cdtime(child, &db->interval);
-    else {
+    else if (strcasecmp("Connections", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp < 1)) {
+        WARNING("dbi plugin: `Connections' must be at least 1.");
+        status = -1;
+      } else if (status == 0)
+        db->connections_num = (size_t)tmp;
+    } else {
       WARNING("dbi plugin: Option `%s' not allowed here.", child->key);
       status = -1;
     }
@@ -322,6 +381,14 @@ static int cdbi_config_add_database(oconfig_item_t *ci) /* {{{ */
     break;
   } /* while (status == 0) */
 
+  if (status == 0) {
+    db->connections = calloc(db->connections_num, sizeof(*db->connections));
+    if (db->connections == NULL) {
+      ERROR("dbi plugin: calloc failed.");
+      status = -1;
+    }
+  }
+
   while ((status == 0) && (db->queries_num > 0)) {
     db->q_prep_areas = calloc(db->queries_num, sizeof(*db->q_prep_areas));
     if (db->q_prep_areas == NULL) {
@@ -433,7 +500,7 @@ static int cdbi_init(void) /* {{{ */
 } /* }}} int cdbi_init */
 
 static int cdbi_read_database_query(cdbi_database_t *db, /* {{{ */
-                                    udb_query_t *q,
+                                    dbi_conn conn, udb_query_t *q,
                                     udb_query_preparation_area_t *prep_area) {
   const char *statement;
   dbi_result res;
@@ -465,13 +532,13 @@ static int cdbi_read_database_query(cdbi_database_t *db, /* {{{ */
   statement = udb_query_get_statement(q);
   assert(statement != NULL);
 
-  res = dbi_conn_query(db->connection, statement);
+  res = dbi_conn_query(conn, statement);
   if (res == NULL) {
     char errbuf[1024];
     ERROR("dbi plugin: cdbi_read_database_query (%s, %s): "
           "dbi_conn_query failed: %s",
           db->name, udb_query_get_name(q),
-          cdbi_strerror(db->connection, errbuf, sizeof(errbuf)));
+          cdbi_strerror(conn, errbuf, sizeof(errbuf)));
     BAIL_OUT(-1);
   } else /* Get the number of columns */
   {
@@ -483,7 +550,7 @@ static int cdbi_read_database_query(cdbi_database_t *db, /* {{{ */
       ERROR("dbi plugin: cdbi_read_database_query (%s, %s): "
             "dbi_result_get_numfields failed: %s",
             db->name, udb_query_get_name(q),
-            cdbi_strerror(db->connection, errbuf, sizeof(errbuf)));
+            cdbi_strerror(conn, errbuf, sizeof(errbuf)));
       BAIL_OUT(-1);
     }
 
@@ -551,7 +618,7 @@ static int cdbi_read_database_query(cdbi_database_t *db, /* {{{ */
           "dbi_result_first_row failed: %s. Maybe the statement didn't "
           "return any rows?",
           db->name, udb_query_get_name(q),
-          cdbi_strerror(db->connection, errbuf, sizeof(errbuf)));
+          cdbi_strerror(conn, errbuf, sizeof(errbuf)));
     udb_query_finish_result(q, prep_area);
     BAIL_OUT(-1);
   } /* }}} */
@@ -591,12 +658,12 @@ static int cdbi_read_database_query(cdbi_database_t *db, /* {{{ */
     /* Get the next row from the database. */
     status = dbi_result_next_row(res); /* {{{ */
     if (status != 1) {
-      if (dbi_conn_error(db->connection, NULL) != 0) {
+      if (dbi_conn_error(conn, NULL) != 0) {
         char errbuf[1024];
         WARNING("dbi plugin: cdbi_read_database_query (%s, %s): "
                 "dbi_result_next_row failed: %s.",
                 db->name, udb_query_get_name(q),
-                cdbi_strerror(db->connection, errbuf, sizeof(errbuf)));
+                cdbi_strerror(conn, errbuf, sizeof(errbuf)));
       }
       break;
     } /* }}} */
@@ -610,19 +677,19 @@ static int cdbi_read_database_query(cdbi_database_t *db, /* {{{ */
 #undef BAIL_OUT
 } /* }}} int cdbi_read_database_query */
 
-static int cdbi_connect_database(cdbi_database_t *db) /* {{{ */
-{
+static int cdbi_connect_database(cdbi_database_t *db, /* {{{ */
+                                 dbi_conn *ret_connection) {
   dbi_driver driver;
   dbi_conn connection;
   int status;
 
-  if (db->connection != NULL) {
-    status = dbi_conn_ping(db->connection);
+  if (*ret_connection != NULL) {
+    status = dbi_conn_ping(*ret_connection);
     if (status != 0) /* connection is alive */
       return 0;
 
-    dbi_conn_close(db->connection);
-    db->connection = NULL;
+    dbi_conn_close(*ret_connection);
+    *ret_connection = NULL;
   }
 
   driver = dbi_driver_open_r(db->driver, dbi_instance);
@@ -714,38 +781,156 @@ static int cdbi_connect_database(cdbi_database_t *db) /* {{{ */
     }
   }
 
-  db->connection = connection;
+  *ret_connection = connection;
   return 0;
 } /* }}} int cdbi_connect_database */
 
-static int cdbi_read_database(user_data_t *ud) /* {{{ */
-{
-  cdbi_database_t *db = (cdbi_database_t *)ud->data;
-  int success;
-  int status;
-
+/* Runs queries on connection "index" until none are left. */
+static void cdbi_read_database_queries(cdbi_database_t *db, /* {{{ */
+                                       size_t index) {
+  dbi_conn *connection = db->connections + index;
   unsigned int db_version;
+  int status;
 
-  status = cdbi_connect_database(db);
+  status = cdbi_connect_database(db, connection);
   if (status != 0)
-    return status;
-  assert(db->connection != NULL);
+    return;
+  assert(*connection != NULL);
 
-  db_version = dbi_conn_get_engine_version(db->connection);
+  db_version = dbi_conn_get_engine_version(*connection);
   /* TODO: Complain if `db_version == 0' */
 
-  success = 0;
-  for (size_t i = 0; i < db->queries_num; i++) {
+  while (42) {
+    size_t i;
+
+    pthread_mutex_lock(&db->lock);
+    i = db->next_query++;
+    pthread_mutex_unlock(&db->lock);
+
+    if (i >= db->queries_num)
+      break;
+
     /* Check if we know the database's version and if so, if this query applies
      * to that version. */
     if ((db_version != 0) &&
         (udb_query_check_version(db->queries[i], db_version) == 0))
       continue;
 
-    status = cdbi_read_database_query(db, db->queries[i], db->q_prep_areas[i]);
-    if (status == 0)
-      success++;
+    status = cdbi_read_database_query(db, *connection, db->queries[i],
+                                      db->q_prep_areas[i]);
+    if (status == 0) {
+      pthread_mutex_lock(&db->lock);
+      db->success++;
+      pthread_mutex_unlock(&db->lock);
+    }
+  }
+} /* }}} void cdbi_read_database_queries */
+
+static void *cdbi_read_database_worker(void *arg) /* {{{ */
+{
+  cdbi_worker_t *worker = arg;
+  cdbi_database_t *db = worker->db;
+
+  pthread_mutex_lock(&db->lock);
+  while (42) {
+    while (!db->workers_shutdown &&
+           (worker->read_generation == db->read_generation))
+      pthread_cond_wait(&db->read_cond, &db->lock);
+
+    if (db->workers_shutdown)
+      break;
+    worker->read_generation = db->read_generation;
+    pthread_mutex_unlock(&db->lock);
+
+    cdbi_read_database_queries(db, worker->index);
+
+    pthread_mutex_lock(&db->lock);
+    db->workers_busy--;
+    if (db->workers_busy == 0)
+      pthread_cond_signal(&db->done_cond);
+  }
+  pthread_mutex_unlock(&db->lock);
+
+  return NULL;
+} /* }}} void *cdbi_read_database_worker */
+
+/* Starts one worker for each connection but the first, and no more than there
+ * are queries to share out. If starting a worker fails, the read goes ahead
+ * with the workers started so far. */
+static void cdbi_start_workers(cdbi_database_t *db) /* {{{ */
+{
+  size_t workers_num;
+
+  db->workers_started = 1;
+
+  workers_num = db->connections_num;
+  if (workers_num > db->queries_num)
+    workers_num = db->queries_num;
+  if (workers_num <= 1)
+    return;
+  workers_num--;
+
+  db->workers = calloc(workers_num, sizeof(*db->workers));
+  if (db->workers == NULL) {
+    ERROR("dbi plugin: Database `%s': calloc failed.", db->name);
+    return;
+  }
+
+  for (size_t i = 0; i < workers_num; i++) {
+    cdbi_worker_t *worker = db->workers + i;
+
+    *worker = (cdbi_worker_t){
+        .db = db, .index = i + 1, .read_generation = db->read_generation};
+
+    int status = plugin_thread_create(&worker->thread, /* attr = */ NULL,
+                                      cdbi_read_database_worker, worker,
+                                      "dbi read");
+    if (status != 0) {
+      char errbuf[1024];
+      ERROR("dbi plugin: Database `%s': plugin_thread_create failed: %s",
+            db->name, sstrerror(status, errbuf, sizeof(errbuf)));
+      break;
+    }
+    db->workers_num++;
   }
+} /* }}} void cdbi_start_workers */
+
+static void cdbi_stop_workers(cdbi_database_t *db) /* {{{ */
+{
+  pthread_mutex_lock(&db->lock);
+  db->workers_shutdown = 1;
+  pthread_cond_broadcast(&db->read_cond);
+  pthread_mutex_unlock(&db->lock);
+
+  for (size_t i = 0; i < db->workers_num; i++)
+    pthread_join(db->workers[i].thread, /* retval = */ NULL);
+  sfree(db->workers);
+  db->workers_num = 0;
+} /* }}} void cdbi_stop_workers */
+
+static int cdbi_read_database(user_data_t *ud) /* {{{ */
+{
+  cdbi_database_t *db = (cdbi_database_t *)ud->data;
+  size_t success;
+
+  if (!db->workers_started)
+    cdbi_start_workers(db);
+
+  pthread_mutex_lock(&db->lock);
+  db->next_query = 0;
+  db->success = 0;
+  db->workers_busy = db->workers_num;
+  db->read_generation++;
+  pthread_cond_broadcast(&db->read_cond);
+  pthread_mutex_unlock(&db->lock);
+
+  cdbi_read_database_queries(db, 0);
+
+  pthread_mutex_lock(&db->lock);
+  while (db->workers_busy > 0)
+    pthread_cond_wait(&db->done_cond, &db->lock);
+  success = db->success;
+  pthread_mutex_unlock(&db->lock);
 
   if (success == 0) {
     ERROR("dbi plugin: All queries failed for database `%s'.", db->name);
@@ -757,13 +942,8 @@ static int cdbi_read_database(user_data_t *ud) /* {{{ */
 
 static int cdbi_shutdown(void) /* {{{ */
 {
-  for (size_t i = 0; i < databases_num; i++) {
-    if (databases[i]->connection != NULL) {
-      dbi_conn_close(databases[i]->connection);
-      databases[i]->connection = NULL;
-    }
+  for (size_t i = 0; i < databases_num; i++)
     cdbi_database_free(databases[i]);
-  }
   sfree(databases);
   databases_num = 0;
 
@@ -0,0 +1,212 @@
+/**
+ * collectd - src/dbi_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Creates an SQLite database with BENCH_ROWS rows in a temporary directory,
+ * reads it with BENCH_QUERIES queries, each returning one shard of the rows,
+ * through libdbi's "sqlite3" driver with 1, 2, 4 and 8 connections per
+ * database and reports the time per read and the number of rows per second.
+ * Build with "make bench_dbi".
+ */
+
+#include "dbi.c"
+
+#define BENCH_ROWS 200000
+#define BENCH_QUERIES 32
+#define BENCH_NAMES 8000
+#define BENCH_READS 20
+
+/* cdtime() is mocked by libplugin_mock. */
+static cdtime_t bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TIMESPEC_TO_CDTIME_T(&ts);
+}
+
+static char bench_dir[] = "/tmp/collectd_bench_dbi.XXXXXX";
+
+static void bench_set_options(cdbi_database_t *db) {
+  static cdbi_driver_option_t options[2];
+
+  options[0] = (cdbi_driver_option_t){.key = "dbname",
+                                      .value.string = "bench.db"};
+  options[1] = (cdbi_driver_option_t){.key = "sqlite3_dbdir",
+                                      .value.string = bench_dir};
+  db->driver_options = options;
+  db->driver_options_num = STATIC_ARRAY_SIZE(options);
+}
+
+static int bench_exec(dbi_conn conn, char const *statement) {
+  dbi_result res = dbi_conn_query(conn, statement);
+  if (res == NULL) {
+    char errbuf[1024];
+    fprintf(stderr, "\"%s\" failed: %s\n", statement,
+            cdbi_strerror(conn, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+  dbi_result_free(res);
+  return 0;
+}
+
+static int bench_populate(void) {
+  cdbi_database_t db = {.name = "bench", .driver = "sqlite3"};
+  dbi_conn conn = NULL;
+  char statement[512];
+
+  bench_set_options(&db);
+  if (cdbi_connect_database(&db, &conn) != 0)
+    return -1;
+
+  snprintf(statement, sizeof(statement),
+           "CREATE TABLE metrics AS "
+           "WITH RECURSIVE seq(i) AS "
+           "(SELECT 0 UNION ALL SELECT i + 1 FROM seq WHERE i + 1 < %d) "
+           "SELECT i %% %d AS shard, 'metric' || (i %% %d) AS name, "
+           "i AS value FROM seq",
+           BENCH_ROWS, BENCH_QUERIES, BENCH_NAMES);
+  int status = bench_exec(conn, statement);
+  if (status == 0)
+    status = bench_exec(conn, "CREATE INDEX metrics_shard ON metrics (shard)");
+
+  dbi_conn_close(conn);
+  return status;
+}
+
+/* <Query "shardN">
+ *   Statement "SELECT name, value FROM metrics WHERE shard = N"
+ *   <Result>
+ *     Type "MAGIC"
+ *     InstancesFrom "name"
+ *     ValuesFrom "value"
+ *   </Result>
+ * </Query> */
+static int bench_create_query(size_t n) {
+  char name[32];
+  char statement[256];
+
+  snprintf(name, sizeof(name), "shard%zu", n);
+  snprintf(statement, sizeof(statement),
+           "SELECT name, value FROM metrics WHERE shard = %zu",
+           n);
+
+  oconfig_value_t name_value = {.value.string = name,
+                                .type = OCONFIG_TYPE_STRING};
+  oconfig_value_t statement_value = {.value.string = statement,
+                                     .type = OCONFIG_TYPE_STRING};
+  oconfig_value_t type_value = {.value.string = "MAGIC",
+                                .type = OCONFIG_TYPE_STRING};
+  oconfig_value_t instances_value = {.value.string = "name",
+                                     .type = OCONFIG_TYPE_STRING};
+  oconfig_value_t values_value = {.value.string = "value",
+                                  .type = OCONFIG_TYPE_STRING};
+  oconfig_item_t result_children[] = {
+      {.key = "Type", .values = &type_value, .values_num = 1},
+      {.key = "InstancesFrom", .values = &instances_value, .values_num = 1},
+      {.key = "ValuesFrom", .values = &values_value, .values_num = 1},
+  };
+  oconfig_item_t query_children[] = {
+      {.key = "Statement", .values = &statement_value, .values_num = 1},
+      {.key = "Result",
+       .children = result_children,
+       .children_num = STATIC_ARRAY_SIZE(result_children)},
+  };
+  oconfig_item_t ci = {
+      .key = "Query",
+      .values = &name_value,
+      .values_num = 1,
+      .children = query_children,
+      .children_num = STATIC_ARRAY_SIZE(query_children),
+  };
+
+  return udb_query_create(&queries, &queries_num, &ci, /* callback = */ NULL);
+}
+
+static void bench_run(size_t connections_num) {
+  cdbi_database_t *db = calloc(1, sizeof(*db));
+
+  db->name = strdup("bench");
+  db->driver = strdup("sqlite3");
+  db->connections_num = connections_num;
+  db->connections = calloc(connections_num, sizeof(*db->connections));
+  pthread_mutex_init(&db->lock, NULL);
+  pthread_cond_init(&db->read_cond, NULL);
+  pthread_cond_init(&db->done_cond, NULL);
+
+  for (size_t i = 0; i < queries_num; i++)
+    udb_query_pick_from_list_by_name(udb_query_get_name(queries[i]), queries,
+                                     queries_num, &db->queries,
+                                     &db->queries_num);
+  db->q_prep_areas = calloc(db->queries_num, sizeof(*db->q_prep_areas));
+  for (size_t i = 0; i < db->queries_num; i++)
+    db->q_prep_areas[i] = udb_query_allocate_preparation_area(db->queries[i]);
+
+  /* The first read connects. */
+  bench_set_options(db);
+  if (cdbi_read_database(&(user_data_t){.data = db}) != 0)
+    exit(1);
+
+  cdtime_t start = bench_now();
+  for (size_t i = 0; i < BENCH_READS; i++)
+    cdbi_read_database(&(user_data_t){.data = db});
+  double elapsed = CDTIME_T_TO_DOUBLE(bench_now() - start);
+
+  printf("Connections %2zu  %8.2f ms/read  %10.0f rows/s\n", connections_num,
+         1e3 * elapsed / BENCH_READS,
+         (double)BENCH_READS * BENCH_ROWS / elapsed);
+
+  /* The options are static, see bench_set_options(). */
+  db->driver_options = NULL;
+  db->driver_options_num = 0;
+  cdbi_database_free(db);
+}
+
+int main(void) {
+  if (mkdtemp(bench_dir) == NULL)
+    return 1;
+
+  if (dbi_initialize_r(NULL, &dbi_instance) < 1) {
+    fprintf(stderr, "dbi_initialize_r failed.\n");
+    return 1;
+  }
+
+  if (bench_populate() != 0)
+    return 1;
+
+  for (size_t i = 0; i < BENCH_QUERIES; i++)
+    if (bench_create_query(i) != 0)
+      return 1;
+
+  bench_run(1);
+  bench_run(2);
+  bench_run(4);
+  bench_run(8);
+
+  udb_query_free(queries, queries_num);
+  dbi_shutdown_r(dbi_instance);
+
+  char path[sizeof(bench_dir) + 16];
+  snprintf(path, sizeof(path), "%s/bench.db", bench_dir);
+  unlink(path);
+  rmdir(bench_dir);
+  return 0;
+}
@@ -78,6 +78,10 @@
 #include <sys/protosw.h>
 #endif
 
+#if KERNEL_LINUX
+#include "utils_procfs.h"
+#endif
+
 #if HAVE_IOKIT_IOKITLIB_H
 static mach_port_t io_master_port = MACH_PORT_NULL;
 /* This defaults to false for backwards compatibility. Please fix in the next
@@ -114,6 +118,7 @@ typedef struct diskstats {
 } diskstats_t;
 
 static diskstats_t *disklist;
+static procfs_file_t *proc_diskstats;
 /* #endif KERNEL_LINUX */
 #elif KERNEL_FREEBSD
 static struct gmesh geom_tree;
@@ -264,6 +269,8 @@ static int disk_shutdown(void) {
   if (handle_udev != NULL)
     udev_unref(handle_udev);
 #endif /* HAVE_UDEV_H */
+  procfs_close(proc_diskstats);
+  proc_diskstats = NULL;
 #endif /* KERNEL_LINUX */
   return 0;
 } /* int disk_shutdown */
@@ -652,8 +659,8 @@ static int disk_read(void) {
   geom_stats_snapshot_free(snap);
 
 #elif KERNEL_LINUX
-  FILE *fh;
-  char buffer[1024];
+  char *line;
+  ssize_t status;
 
   char *fields[32];
   int numfields;
@@ -677,22 +684,33 @@ static int disk_read(void) {
 
   diskstats_t *ds, *pre_ds;
 
-  if ((fh = fopen("/proc/diskstats", "r")) == NULL) {
-    fh = fopen("/proc/partitions", "r");
-    if (fh == NULL) {
-      ERROR("disk plugin: fopen (/proc/{diskstats,partitions}) failed.");
+  if (proc_diskstats == NULL) {
+    proc_diskstats = procfs_open("/proc/diskstats");
+    if (proc_diskstats == NULL)
+      proc_diskstats = procfs_open("/proc/partitions");
+    if (proc_diskstats == NULL) {
+      ERROR("disk plugin: open (/proc/{diskstats,partitions}) failed.");
       return -1;
     }
+  }
 
-    /* Kernel is 2.4.* */
+  /* Kernel is 2.4.* */
+  if (strcmp("/proc/partitions", procfs_path(proc_diskstats)) == 0)
     fieldshift = 1;
+
+  status = procfs_read(proc_diskstats);
+  if (status < 0) {
+    char errbuf[1024];
+    ERROR("disk plugin: reading %s failed: %s", procfs_path(proc_diskstats),
+          sstrerror((int)-status, errbuf, sizeof(errbuf)));
+    return -1;
   }
 
-  while (fgets(buffer, sizeof(buffer), fh) != NULL) {
+  while ((line = procfs_getline(proc_diskstats)) != NULL) {
     char *disk_name;
     char *output_name;
 
-    numfields = strsplit(buffer, fields, 32);
+    numfields = strsplit(line, fields, 32);
 
     if ((numfields != (14 + fieldshift)) && (numfields != 7))
       continue;
@@ -882,9 +900,7 @@ static int disk_read(void) {
     /* release udev-based alternate name, if allocated */
     sfree(alt_name);
 #endif
-  } /* while (fgets (buffer, sizeof (buffer), fh) != NULL) */
-
-  fclose(fh);
+  } /* while ((line = procfs_getline(proc_diskstats)) != NULL) */
 /* #endif defined(KERNEL_LINUX) */
 
 #elif HAVE_LIBKSTAT
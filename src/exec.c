@@ -33,6 +33,7 @@
 
 #include "utils_cmd_putnotif.h"
 #include "utils_cmd_putval.h"
+#include "utils_cmd_putvals.h"
 
 #include <grp.h>
 #include <pwd.h>
@@ -496,9 +497,20 @@ failed:
   return -1;
 } /* int fork_child }}} */
 
-static int parse_line(char *buffer) /* {{{ */
+static int parse_line(char *buffer, cmd_putvals_t **putvals) /* {{{ */
 {
-  if (strncasecmp("PUTVAL", buffer, strlen("PUTVAL")) == 0)
+  if (cmd_putvals_active(*putvals))
+    return cmd_handle_putvals(stdout, *putvals, buffer);
+  else if ((strncasecmp("PUTVALS", buffer, strlen("PUTVALS")) == 0) &&
+           ((buffer[7] == 0) || isspace((int)buffer[7]))) {
+    if (*putvals == NULL)
+      *putvals = cmd_putvals_create();
+    if (*putvals == NULL) {
+      ERROR("exec plugin: cmd_putvals_create failed.");
+      return -1;
+    }
+    return cmd_handle_putvals(stdout, *putvals, buffer);
+  } else if (strncasecmp("PUTVAL", buffer, strlen("PUTVAL")) == 0)
     return cmd_handle_putval(stdout, buffer);
   else if (strncasecmp("PUTNOTIF", buffer, strlen("PUTNOTIF")) == 0)
     return handle_putnotif(stdout, buffer);
@@ -519,6 +531,7 @@ static void *exec_read_one(void *arg) /* {{{ */
   char buffer_err[1024];
   char *pbuffer = buffer;
   char *pbuffer_err = buffer_err;
+  cmd_putvals_t *putvals = NULL;
 
   status = fork_child(pl, NULL, &fd, &fd_err);
   if (status < 0) {
@@ -574,7 +587,7 @@ static void *exec_read_one(void *arg) /* {{{ */
         if (*(pnl - 1) == '\r')
           *(pnl - 1) = '\0';
 
-        parse_line(pbuffer);
+        parse_line(pbuffer, &putvals);
 
         pbuffer = ++pnl;
       }
@@ -652,6 +665,7 @@ static void *exec_read_one(void *arg) /* {{{ */
   close(fd);
   if (fd_err >= 0)
     close(fd_err);
+  cmd_putvals_destroy(putvals);
 
   pthread_exit((void *)0);
   return NULL;
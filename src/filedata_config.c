@@ -33,6 +33,7 @@
 #include "filedata_common.h"
 #include "filedata_config.h"
 #include "filedata_xml.h"
+#include "utils_procfs.h"
 
 int filedata_compile_regex(regex_t *preg, const char *regex)
 {
@@ -401,6 +402,8 @@ void filedata_definition_fini(struct filedata_definition *definition)
 {
 	struct filedata_math_entry *fme;
 	struct filedata_math_entry *tmp;
+	struct filedata_open_file *fof;
+	struct filedata_open_file *fof_tmp;
 
 	if (definition->fd_root)
 		filedata_entry_free(definition->fd_root);
@@ -419,6 +422,14 @@ void filedata_definition_fini(struct filedata_definition *definition)
 		list_del_init(&fme->fme_linkage);
 		filedata_math_entry_free(fme);
 	}
+
+	HASH_ITER(hh, definition->fd_open_files, fof, fof_tmp) {
+		HASH_DEL(definition->fd_open_files, fof);
+		procfs_close(fof->fof_file);
+		free(fof->fof_path);
+		free(fof);
+	}
+	definition->fd_open_files_num = 0;
 }
 
 /* TODO: read form XML file */
@@ -360,6 +360,16 @@ struct filedata_entry {
 	struct list_head	    fe_active_item_types;
 };
 
+/* A file kept open between reads, see filedata_read_open_file() */
+struct filedata_open_file {
+	/* Path of the file, key of the hash table */
+	char			*fof_path;
+	struct procfs_file_s	*fof_file;
+	/* Value of fd_query_times when the file was read the last time */
+	unsigned long long	 fof_query_times;
+	UT_hash_handle		 hh;
+};
+
 typedef int (*filedata_read_file_fn)
 	(const char *path, char **buf, ssize_t *data_size,
 	 void *private_data);
@@ -401,6 +411,10 @@ struct filedata_definition {
 
 	/* list of match entries */
 	struct list_head	fd_math_entries;
+
+	/* Files kept open between reads, hashed by path */
+	struct filedata_open_file *fd_open_files;
+	unsigned int		  fd_open_files_num;
 };
 
 struct filedata_configs {
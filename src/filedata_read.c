@@ -29,6 +29,7 @@
 #include "filedata_config.h"
 #include "filedata_read.h"
 #include "utils_cache.h"
+#include "utils_procfs.h"
 #include <stdbool.h>
 
 static int
@@ -1198,6 +1199,90 @@ err:
 	return status;
 }
 
+/*
+ * Files are kept open and re-read in every query, which saves the open and
+ * close calls and the allocation of the buffer. The number of open files is
+ * limited, files beyond the limit are read with filedata_read_file().
+ */
+#define FILEDATA_MAX_OPEN_FILES 256
+/* Files not read in this many queries are closed */
+#define FILEDATA_OPEN_FILE_EXPIRE 16
+
+static void filedata_open_file_free(struct filedata_definition *definition,
+				    struct filedata_open_file *fof)
+{
+	HASH_DEL(definition->fd_open_files, fof);
+	definition->fd_open_files_num--;
+	procfs_close(fof->fof_file);
+	free(fof->fof_path);
+	free(fof);
+}
+
+/*
+ * The returned buffer belongs to the open file and is valid until the file
+ * is read the next time. Returns -EMFILE if too many files are open.
+ */
+static int filedata_read_open_file(struct filedata_definition *definition,
+				   const char *path, char **buf,
+				   ssize_t *data_size)
+{
+	struct filedata_open_file *fof;
+	ssize_t size;
+
+	HASH_FIND_STR(definition->fd_open_files, path, fof);
+	if (fof == NULL) {
+		if (definition->fd_open_files_num >= FILEDATA_MAX_OPEN_FILES)
+			return -EMFILE;
+
+		fof = calloc(1, sizeof(*fof));
+		if (fof == NULL) {
+			ERROR("failed to allocate memory");
+			return -1;
+		}
+		fof->fof_path = strdup(path);
+		if (fof->fof_path == NULL) {
+			ERROR("failed to allocate memory");
+			free(fof);
+			return -1;
+		}
+		fof->fof_file = procfs_open(path);
+		if (fof->fof_file == NULL) {
+			ERROR("failed to open %s", path);
+			free(fof->fof_path);
+			free(fof);
+			return -1;
+		}
+		HASH_ADD_KEYPTR(hh, definition->fd_open_files, fof->fof_path,
+				strlen(fof->fof_path), fof);
+		definition->fd_open_files_num++;
+	}
+
+	size = procfs_read(fof->fof_file);
+	if (size < 0) {
+		ERROR("failed to read %s", path);
+		filedata_open_file_free(definition, fof);
+		return -1;
+	}
+	fof->fof_query_times = definition->fd_query_times;
+
+	*buf = procfs_data(fof->fof_file);
+	*data_size = size;
+	FINFO("file size :%zd", size);
+	return 0;
+}
+
+static void filedata_open_files_expire(struct filedata_definition *definition)
+{
+	struct filedata_open_file *fof;
+	struct filedata_open_file *tmp;
+
+	HASH_ITER(hh, definition->fd_open_files, fof, tmp) {
+		if (definition->fd_query_times - fof->fof_query_times >=
+		    FILEDATA_OPEN_FILE_EXPIRE)
+			filedata_open_file_free(definition, fof);
+	}
+}
+
 static int filedata_write_file(const char *path, char *value)
 {
 	struct stat st;
@@ -1384,6 +1469,7 @@ filedata_entry_read_constant(struct filedata_entry *entry,
 	char path[MAX_NAME_LENGH + 1];
 	int status = 0;
 	char *filebuf;
+	bool free_filebuf = true;
 	struct filedata_item_type *type;
 	ssize_t size;
 	int max_size = sizeof(path) - 1;
@@ -1415,7 +1501,14 @@ filedata_entry_read_constant(struct filedata_entry *entry,
 				&filebuf, &size,
 				(entry->fe_definition)->fd_private_definition.fd_private_data);
 		} else {
-			status = filedata_read_file(path, &filebuf, &size);
+			status = filedata_read_open_file(entry->fe_definition,
+							 path, &filebuf,
+							 &size);
+			if (status == -EMFILE)
+				status = filedata_read_file(path, &filebuf,
+							    &size);
+			else
+				free_filebuf = false;
 		}
 		if (status) {
 			ERROR("unable to read file %s", path);
@@ -1434,11 +1527,13 @@ filedata_entry_read_constant(struct filedata_entry *entry,
 				ERROR("unable to parse file %s for type %s",
 				      path,
 				      type->fit_type_name);
-				free(filebuf);
+				if (free_filebuf)
+					free(filebuf);
 				return status;
 			}
 		}
-		free(filebuf);
+		if (free_filebuf)
+			free(filebuf);
 		if (entry->fe_write_after_read) {
 			status = filedata_write_file(path, entry->fe_write_content);
 			if (status) {
@@ -1581,6 +1676,7 @@ int filedata_entry_read(struct filedata_entry *entry, char *pwd)
 
 	INIT_LIST_HEAD(&path_head);
 	status = __filedata_entry_read(entry, pwd, &path_head);
+	filedata_open_files_expire(entry->fe_definition);
 
 	status1 = filedata_submit_math_instance(entry);
 	if (!status && status1)
@@ -55,6 +55,10 @@
 #include <sys/protosw.h>
 #endif
 
+#if KERNEL_LINUX
+#include "utils_procfs.h"
+#endif
+
 /*
  * Various people have reported problems with `getifaddrs' and varying versions
  * of `glibc'. That's why it's disabled by default. Since more statistics are
@@ -98,6 +102,10 @@ static int numif = 0;
 static _Bool unique_name = 0;
 #endif /* HAVE_LIBKSTAT */
 
+#if !HAVE_GETIFADDRS && KERNEL_LINUX
+static procfs_file_t *proc_net_dev;
+#endif
+
 static int interface_config(const char *key, const char *value) {
   if (ignorelist == NULL)
     ignorelist = ignorelist_create(/* invert = */ 1);
@@ -226,8 +234,8 @@ static int interface_read(void) {
 /* #endif HAVE_GETIFADDRS */
 
 #elif KERNEL_LINUX
-  FILE *fh;
-  char buffer[1024];
+  char *line;
+  ssize_t status;
   derive_t incoming, outgoing;
   char *device;
 
@@ -235,20 +243,31 @@ static int interface_read(void) {
   char *fields[16];
   int numfields;
 
-  if ((fh = fopen("/proc/net/dev", "r")) == NULL) {
+  if (proc_net_dev == NULL) {
+    proc_net_dev = procfs_open("/proc/net/dev");
+    if (proc_net_dev == NULL) {
+      char errbuf[1024];
+      WARNING("interface plugin: open (/proc/net/dev) failed: %s",
+              sstrerror(errno, errbuf, sizeof(errbuf)));
+      return -1;
+    }
+  }
+
+  status = procfs_read(proc_net_dev);
+  if (status < 0) {
     char errbuf[1024];
-    WARNING("interface plugin: fopen: %s",
-            sstrerror(errno, errbuf, sizeof(errbuf)));
+    WARNING("interface plugin: reading /proc/net/dev failed: %s",
+            sstrerror((int)-status, errbuf, sizeof(errbuf)));
     return -1;
   }
 
-  while (fgets(buffer, 1024, fh) != NULL) {
-    if (!(dummy = strchr(buffer, ':')))
+  while ((line = procfs_getline(proc_net_dev)) != NULL) {
+    if (!(dummy = strchr(line, ':')))
       continue;
     dummy[0] = '\0';
     dummy++;
 
-    device = buffer;
+    device = line;
     while (device[0] == ' ')
       device++;
 
@@ -279,8 +298,6 @@ static int interface_read(void) {
     outgoing = atoll(fields[11]);
     if_submit(device, "if_dropped", incoming, outgoing);
   }
-
-  fclose(fh);
 /* #endif KERNEL_LINUX */
 
 #elif HAVE_LIBKSTAT
@@ -388,6 +405,14 @@ static int interface_read(void) {
   return 0;
 } /* int interface_read */
 
+#if !HAVE_GETIFADDRS && KERNEL_LINUX
+static int interface_shutdown(void) {
+  procfs_close(proc_net_dev);
+  proc_net_dev = NULL;
+  return 0;
+} /* int interface_shutdown */
+#endif
+
 void module_register(void) {
   plugin_register_config("interface", interface_config, config_keys,
                          config_keys_num);
@@ -395,4 +420,7 @@ void module_register(void) {
   plugin_register_init("interface", interface_init);
 #endif
   plugin_register_read("interface", interface_read);
+#if !HAVE_GETIFADDRS && KERNEL_LINUX
+  plugin_register_shutdown("interface", interface_shutdown);
+#endif
 } /* void module_register */
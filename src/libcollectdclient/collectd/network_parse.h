@@ -35,6 +35,20 @@
 
 LCC_BEGIN_DECLS
 
+/* lcc_network_dict_t holds the strings received as part of meta data, keyed
+ * by the sender's dictionary session. It may be shared by multiple threads. */
+struct lcc_network_dict_s;
+typedef struct lcc_network_dict_s lcc_network_dict_t;
+
+lcc_network_dict_t *lcc_network_dict_create(void);
+void lcc_network_dict_destroy(lcc_network_dict_t *dict);
+
+/* lcc_network_dict_set_max_memory limits the memory used by the strings of all
+ * senders together to "max_bytes", 64 MiB by default. When the limit is
+ * reached, the strings of the least recently heard of senders are dropped. */
+void lcc_network_dict_set_max_memory(lcc_network_dict_t *dict,
+                                     size_t max_bytes);
+
 typedef struct {
   /* writer is the callback used to send incoming lcc_value_list_t to. */
   lcc_value_list_writer_t writer;
@@ -44,6 +58,11 @@ typedef struct {
 
   /* security_level is the minimal required security level. */
   lcc_security_level_t security_level;
+
+  /* dict is used to resolve the strings of meta data. Meta data is ignored if
+   * this is NULL. The same dictionary must be used for all packets received
+   * from one sender. */
+  lcc_network_dict_t *dict;
 } lcc_network_parse_options_t;
 
 /* lcc_network_parse parses data received from the network and calls "w" with
@@ -72,6 +72,28 @@ typedef struct lcc_identifier_s lcc_identifier_t;
 #define LCC_IDENTIFIER_INIT                                                    \
   { "localhost", "", "", "", "" }
 
+/*
+ * Meta data types
+ */
+#define LCC_META_TYPE_STRING 1
+#define LCC_META_TYPE_SIGNED_INT 2
+#define LCC_META_TYPE_UNSIGNED_INT 3
+#define LCC_META_TYPE_DOUBLE 4
+#define LCC_META_TYPE_BOOLEAN 5
+
+struct lcc_meta_s {
+  char const *key;
+  int type;
+  union {
+    char const *string;
+    int64_t signed_int;
+    uint64_t unsigned_int;
+    double double_value;
+    int boolean;
+  } value;
+};
+typedef struct lcc_meta_s lcc_meta_t;
+
 struct lcc_value_list_s {
   value_t *values;
   int *values_types;
@@ -79,10 +101,12 @@ struct lcc_value_list_s {
   double time;
   double interval;
   lcc_identifier_t identifier;
+  lcc_meta_t *meta;
+  size_t meta_len;
 };
 typedef struct lcc_value_list_s lcc_value_list_t;
 #define LCC_VALUE_LIST_INIT                                                    \
-  { NULL, NULL, 0, 0, 0, LCC_IDENTIFIER_INIT }
+  { NULL, NULL, 0, 0, 0, LCC_IDENTIFIER_INIT, NULL, 0 }
 
 /* lcc_value_list_writer_t is a write callback to which value lists are
  * dispatched. */
@@ -34,6 +34,8 @@
 #include <string.h>
 
 #include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 
 #if HAVE_GCRYPT_H
 #if defined __APPLE__
@@ -75,9 +77,20 @@ GCRY_THREAD_OPTION_PTHREAD_IMPL;
 #define TYPE_MESSAGE 0x0100
 #define TYPE_SEVERITY 0x0101
 
+/* Types to transmit meta data using a string dictionary */
+#define TYPE_DICT_SESSION 0x0020
+#define TYPE_DICT_ENTRY 0x0021
+#define TYPE_META 0x0022
+
 #define TYPE_SIGN_SHA256 0x0200
 #define TYPE_ENCR_AES256 0x0210
 
+/* Number of strings after which the dictionary is started anew. */
+#define DICT_MAX_ENTRIES 65536
+/* Strings are sent again after this many seconds, in case the receiver missed
+ * the packet with the definition. */
+#define DICT_REFRESH_INTERVAL 60
+
 #define PART_SIGNATURE_SHA256_SIZE 36
 #define PART_ENCRYPTION_AES256_SIZE 42
 
@@ -94,6 +107,22 @@ GCRY_THREAD_OPTION_PTHREAD_IMPL;
 /*
  * Data types
  */
+struct dict_entry_s {
+  char *str;
+  uint32_t id;
+  time_t last_sent;
+};
+typedef struct dict_entry_s dict_entry_t;
+
+/* Open addressing hash table of the strings sent as part of the meta data. */
+struct dict_s {
+  dict_entry_t *entries;
+  size_t size;
+  size_t num;
+  uint64_t session;
+};
+typedef struct dict_s dict_t;
+
 struct lcc_network_buffer_s {
   char *buffer;
   size_t size;
@@ -102,6 +131,11 @@ struct lcc_network_buffer_s {
   char *ptr;
   size_t free;
 
+  dict_t dict;
+  int state_have_session;
+  char *state_meta;
+  size_t state_meta_len;
+
   lcc_security_level_t seclevel;
   char *username;
   char *password;
@@ -405,6 +439,267 @@ static int nb_add_string(char **ret_buffer, /* {{{ */
   return 0;
 } /* }}} int nb_add_string */
 
+static uint32_t dict_hash(char const *str) /* {{{ */
+{
+  /* FNV-1a */
+  uint32_t h = 2166136261u;
+  for (; *str != 0; str++) {
+    h ^= (uint8_t)*str;
+    h *= 16777619u;
+  }
+  return h;
+} /* }}} uint32_t dict_hash */
+
+static void dict_reset(dict_t *d) /* {{{ */
+{
+  uint64_t session = 0;
+  FILE *fh;
+
+  for (size_t i = 0; i < d->size; i++)
+    free(d->entries[i].str);
+  free(d->entries);
+  d->entries = NULL;
+  d->size = 0;
+  d->num = 0;
+
+  fh = fopen("/dev/urandom", "r");
+  if (fh != NULL) {
+    if (fread(&session, sizeof(session), 1, fh) != 1)
+      session = 0;
+    fclose(fh);
+  }
+  if (session == 0)
+    session = (((uint64_t)time(NULL)) << 32) ^ ((uint64_t)getpid()) ^
+              ((uint64_t)(uintptr_t)d);
+  d->session = session;
+} /* }}} void dict_reset */
+
+/* dict_reserve makes room for "num" more strings. Entry pointers stay valid
+ * until the next call. */
+static int dict_reserve(dict_t *d, size_t num) /* {{{ */
+{
+  size_t new_size = (d->size == 0) ? 64 : d->size;
+
+  while ((d->num + num) * 2 > new_size)
+    new_size *= 2;
+  if (new_size == d->size)
+    return 0;
+
+  dict_entry_t *new_entries = calloc(new_size, sizeof(*new_entries));
+  if (new_entries == NULL)
+    return ENOMEM;
+
+  for (size_t j = 0; j < d->size; j++) {
+    if (d->entries[j].str == NULL)
+      continue;
+    size_t i = dict_hash(d->entries[j].str) & (new_size - 1);
+    while (new_entries[i].str != NULL)
+      i = (i + 1) & (new_size - 1);
+    new_entries[i] = d->entries[j];
+  }
+
+  free(d->entries);
+  d->entries = new_entries;
+  d->size = new_size;
+  return 0;
+} /* }}} int dict_reserve */
+
+/* dict_lookup returns the entry of "str", adding it if necessary. Room must
+ * have been made with dict_reserve(). */
+static dict_entry_t *dict_lookup(dict_t *d, char const *str) /* {{{ */
+{
+  size_t i;
+
+  i = dict_hash(str) & (d->size - 1);
+  while (d->entries[i].str != NULL) {
+    if (strcmp(d->entries[i].str, str) == 0)
+      return &d->entries[i];
+    i = (i + 1) & (d->size - 1);
+  }
+
+  d->entries[i].str = strdup(str);
+  if (d->entries[i].str == NULL)
+    return NULL;
+  d->entries[i].id = (uint32_t)d->num;
+  d->entries[i].last_sent = 0;
+  d->num++;
+
+  return &d->entries[i];
+} /* }}} dict_entry_t *dict_lookup */
+
+static int nb_add_dict_entry(char **ret_buffer, /* {{{ */
+                             size_t *ret_buffer_len, dict_entry_t const *e) {
+  size_t str_len = strlen(e->str);
+  size_t packet_len = 2 * sizeof(uint16_t) + sizeof(uint32_t) + str_len + 1;
+  uint16_t pkg_type = htons(TYPE_DICT_ENTRY);
+  uint16_t pkg_length = htons((uint16_t)packet_len);
+  uint32_t pkg_id = htonl(e->id);
+  char *packet_ptr = *ret_buffer;
+
+  if ((*ret_buffer_len < packet_len) || (packet_len > UINT16_MAX))
+    return ENOMEM;
+
+  memcpy(packet_ptr, &pkg_type, sizeof(pkg_type));
+  memcpy(packet_ptr + 2, &pkg_length, sizeof(pkg_length));
+  memcpy(packet_ptr + 4, &pkg_id, sizeof(pkg_id));
+  memcpy(packet_ptr + 8, e->str, str_len + 1);
+
+  *ret_buffer = packet_ptr + packet_len;
+  *ret_buffer_len -= packet_len;
+  return 0;
+} /* }}} int nb_add_dict_entry */
+
+static void nb_need_entry(dict_entry_t **defs, size_t *defs_num, /* {{{ */
+                          dict_entry_t *e, time_t now) {
+  if ((e->last_sent != 0) && ((now - e->last_sent) < DICT_REFRESH_INTERVAL))
+    return;
+  for (size_t i = 0; i < *defs_num; i++)
+    if (defs[i] == e)
+      return;
+  defs[(*defs_num)++] = e;
+} /* }}} void nb_need_entry */
+
+/* nb_add_meta writes the meta data of "vl" as a TYPE_META part, preceded by
+ * the definitions of strings the receiver has not been sent recently. */
+static int nb_add_meta(lcc_network_buffer_t *nb, char **ret_buffer, /* {{{ */
+                       size_t *ret_buffer_len, const lcc_value_list_t *vl) {
+  char payload[nb->size];
+  size_t payload_len = sizeof(uint16_t);
+  uint16_t num = 0;
+  dict_entry_t *defs[2 * vl->meta_len + 1];
+  size_t defs_num = 0;
+  time_t now = time(NULL);
+
+  if (nb->dict.num + 2 * vl->meta_len > DICT_MAX_ENTRIES) {
+    dict_reset(&nb->dict);
+    nb->state_have_session = 0;
+    nb->state_meta_len = SIZE_MAX;
+  }
+  if (dict_reserve(&nb->dict, 2 * vl->meta_len) != 0)
+    return ENOMEM;
+
+  for (size_t i = 0; i < vl->meta_len; i++) {
+    lcc_meta_t const *m = vl->meta + i;
+    dict_entry_t *key;
+    uint8_t type = (uint8_t)m->type;
+    uint32_t id;
+    uint64_t tmp64;
+    uint8_t tmp8;
+    double d;
+    size_t value_size = (m->type == LCC_META_TYPE_STRING)
+                            ? sizeof(id)
+                            : (m->type == LCC_META_TYPE_BOOLEAN) ? 1 : 8;
+
+    if ((m->key == NULL) ||
+        (payload_len + sizeof(id) + sizeof(type) + value_size > sizeof(payload)))
+      return EINVAL;
+
+    char *value_ptr = payload + payload_len + sizeof(id) + sizeof(type);
+    switch (m->type) {
+    case LCC_META_TYPE_STRING: {
+      if (m->value.string == NULL)
+        return EINVAL;
+      dict_entry_t *e = dict_lookup(&nb->dict, m->value.string);
+      if (e == NULL)
+        return ENOMEM;
+      nb_need_entry(defs, &defs_num, e, now);
+      id = htonl(e->id);
+      memcpy(value_ptr, &id, sizeof(id));
+      break;
+    }
+    case LCC_META_TYPE_SIGNED_INT:
+      tmp64 = htonll((uint64_t)m->value.signed_int);
+      memcpy(value_ptr, &tmp64, sizeof(tmp64));
+      break;
+    case LCC_META_TYPE_UNSIGNED_INT:
+      tmp64 = htonll(m->value.unsigned_int);
+      memcpy(value_ptr, &tmp64, sizeof(tmp64));
+      break;
+    case LCC_META_TYPE_DOUBLE:
+      d = htond(m->value.double_value);
+      memcpy(value_ptr, &d, sizeof(d));
+      break;
+    case LCC_META_TYPE_BOOLEAN:
+      tmp8 = m->value.boolean ? 1 : 0;
+      memcpy(value_ptr, &tmp8, sizeof(tmp8));
+      break;
+    default:
+      return EINVAL;
+    }
+
+    key = dict_lookup(&nb->dict, m->key);
+    if (key == NULL)
+      return ENOMEM;
+    nb_need_entry(defs, &defs_num, key, now);
+
+    id = htonl(key->id);
+    memcpy(payload + payload_len, &id, sizeof(id));
+    memcpy(payload + payload_len + sizeof(id), &type, sizeof(type));
+    payload_len += sizeof(id) + sizeof(type) + value_size;
+    num++;
+  }
+
+  if (num == 0)
+    payload_len = 0;
+  else {
+    uint16_t tmp16 = htons(num);
+    memcpy(payload, &tmp16, sizeof(tmp16));
+  }
+
+  /* Meta data stays in effect for all following values of the packet. */
+  if ((payload_len == nb->state_meta_len) &&
+      ((payload_len == 0) ||
+       (memcmp(payload, nb->state_meta, payload_len) == 0)))
+    return 0;
+
+  char *buffer = *ret_buffer;
+  size_t buffer_len = *ret_buffer_len;
+  int status;
+
+  if ((payload_len != 0) && !nb->state_have_session) {
+    status = nb_add_number(&buffer, &buffer_len, TYPE_DICT_SESSION,
+                           nb->dict.session);
+    if (status != 0)
+      return status;
+  }
+
+  for (size_t i = 0; i < defs_num; i++) {
+    status = nb_add_dict_entry(&buffer, &buffer_len, defs[i]);
+    if (status != 0)
+      return status;
+  }
+
+  /* Make sure the values fit, too, so that definitions are not marked as sent
+   * when the caller has to start a new packet. */
+  size_t packet_len = 2 * sizeof(uint16_t) + ((num == 0) ? 2 : payload_len);
+  size_t values_len = 3 * sizeof(uint16_t) + vl->values_len * 9;
+  if (buffer_len < packet_len + values_len)
+    return ENOMEM;
+
+  uint16_t pkg_type = htons(TYPE_META);
+  uint16_t pkg_length = htons((uint16_t)packet_len);
+  memcpy(buffer, &pkg_type, sizeof(pkg_type));
+  memcpy(buffer + 2, &pkg_length, sizeof(pkg_length));
+  if (num == 0)
+    memset(buffer + 4, 0, 2);
+  else
+    memcpy(buffer + 4, payload, payload_len);
+  buffer += packet_len;
+  buffer_len -= packet_len;
+
+  /* Everything fit into the buffer: update the state. */
+  for (size_t i = 0; i < defs_num; i++)
+    defs[i]->last_sent = now;
+  if (payload_len != 0)
+    nb->state_have_session = 1;
+  memcpy(nb->state_meta, payload, payload_len);
+  nb->state_meta_len = payload_len;
+
+  *ret_buffer = buffer;
+  *ret_buffer_len = buffer_len;
+  return 0;
+} /* }}} int nb_add_meta */
+
 static int nb_add_value_list(lcc_network_buffer_t *nb, /* {{{ */
                              const lcc_value_list_t *vl) {
   char *buffer = nb->ptr;
@@ -467,6 +762,10 @@ static int nb_add_value_list(lcc_network_buffer_t *nb, /* {{{ */
     nb->state.interval = vl->interval;
   }
 
+  if (((vl->meta_len > 0) || (nb->state_meta_len > 0)) &&
+      (nb_add_meta(nb, &buffer, &buffer_size, vl) != 0))
+    return -1;
+
   if (nb_add_values(&buffer, &buffer_size, vl) != 0)
     return -1;
 
@@ -616,10 +915,14 @@ lcc_network_buffer_t *lcc_network_buffer_create(size_t size) /* {{{ */
 
   nb->size = size;
   nb->buffer = calloc(1, nb->size);
-  if (nb->buffer == NULL) {
+  nb->state_meta = calloc(1, nb->size);
+  if ((nb->buffer == NULL) || (nb->state_meta == NULL)) {
+    free(nb->buffer);
+    free(nb->state_meta);
     free(nb);
     return NULL;
   }
+  dict_reset(&nb->dict);
 
   nb->ptr = nb->buffer;
   nb->free = nb->size;
@@ -636,6 +939,10 @@ void lcc_network_buffer_destroy(lcc_network_buffer_t *nb) /* {{{ */
   if (nb == NULL)
     return;
 
+  for (size_t i = 0; i < nb->dict.size; i++)
+    free(nb->dict.entries[i].str);
+  free(nb->dict.entries);
+  free(nb->state_meta);
   free(nb->buffer);
   free(nb);
 } /* }}} void lcc_network_buffer_destroy */
@@ -687,6 +994,8 @@ int lcc_network_buffer_initialize(lcc_network_buffer_t *nb) /* {{{ */
   memset(&nb->state, 0, sizeof(nb->state));
   nb->ptr = nb->buffer;
   nb->free = nb->size;
+  nb->state_have_session = 0;
+  nb->state_meta_len = 0;
 
 #if HAVE_GCRYPT_H
   if (nb->seclevel == SIGN) {
@@ -132,9 +132,185 @@ static int buffer_uint16(buffer_t *b, uint16_t *out) {
 #define TYPE_VALUES 0x0006
 #define TYPE_INTERVAL 0x0007
 #define TYPE_INTERVAL_HR 0x0009
+#define TYPE_DICT_SESSION 0x0020
+#define TYPE_DICT_ENTRY 0x0021
+#define TYPE_META 0x0022
 #define TYPE_SIGN_SHA256 0x0200
 #define TYPE_ENCR_AES256 0x0210
 
+#define DICT_MAX_ENTRIES 65536
+#define DICT_MAX_SESSIONS 4096
+#define DICT_HASH_SIZE 1024
+#define DICT_DEFAULT_MAX_MEMORY (64 * 1048576)
+
+typedef struct dict_session_s {
+  uint64_t session;
+  char **strings;
+  size_t strings_num;
+  /* memory used by this session, see lcc_network_dict_s.bytes */
+  size_t bytes;
+  /* next session in the same hash bucket */
+  struct dict_session_s *hash_next;
+  /* least recently used list, most recently used first */
+  struct dict_session_s *prev;
+  struct dict_session_s *next;
+} dict_session_t;
+
+struct lcc_network_dict_s {
+  pthread_mutex_t lock;
+  dict_session_t *hash[DICT_HASH_SIZE];
+  dict_session_t *head;
+  dict_session_t *tail;
+  size_t sessions_num;
+  /* memory used by all sessions and the upper limit for it */
+  size_t bytes;
+  size_t max_bytes;
+};
+
+static void dict_session_free(dict_session_t *s) {
+  if (s == NULL)
+    return;
+
+  for (size_t i = 0; i < s->strings_num; i++)
+    free(s->strings[i]);
+  free(s->strings);
+  free(s);
+}
+
+lcc_network_dict_t *lcc_network_dict_create(void) {
+  lcc_network_dict_t *dict = calloc(1, sizeof(*dict));
+  if (dict == NULL)
+    return NULL;
+
+  pthread_mutex_init(&dict->lock, NULL);
+  dict->max_bytes = DICT_DEFAULT_MAX_MEMORY;
+  return dict;
+}
+
+void lcc_network_dict_set_max_memory(lcc_network_dict_t *dict,
+                                     size_t max_bytes) {
+  if (dict == NULL)
+    return;
+
+  pthread_mutex_lock(&dict->lock);
+  dict->max_bytes = max_bytes;
+  pthread_mutex_unlock(&dict->lock);
+}
+
+void lcc_network_dict_destroy(lcc_network_dict_t *dict) {
+  if (dict == NULL)
+    return;
+
+  while (dict->head != NULL) {
+    dict_session_t *next = dict->head->next;
+    dict_session_free(dict->head);
+    dict->head = next;
+  }
+  pthread_mutex_destroy(&dict->lock);
+  free(dict);
+}
+
+static dict_session_t **dict_bucket(lcc_network_dict_t *dict, uint64_t id) {
+  /* Session IDs are random, but do not rely on the low bits alone. */
+  return &dict->hash[(id ^ (id >> 32)) % DICT_HASH_SIZE];
+}
+
+static void dict_unlink(lcc_network_dict_t *dict, dict_session_t *s) {
+  if (s->prev != NULL)
+    s->prev->next = s->next;
+  else
+    dict->head = s->next;
+
+  if (s->next != NULL)
+    s->next->prev = s->prev;
+  else
+    dict->tail = s->prev;
+
+  s->prev = s->next = NULL;
+}
+
+static void dict_push_front(lcc_network_dict_t *dict, dict_session_t *s) {
+  s->prev = NULL;
+  s->next = dict->head;
+  if (dict->head != NULL)
+    dict->head->prev = s;
+  else
+    dict->tail = s;
+  dict->head = s;
+}
+
+/* dict_evict removes "s" from the dictionary and frees it. Must be called with
+ * dict->lock held. */
+static void dict_evict(lcc_network_dict_t *dict, dict_session_t *s) {
+  dict_session_t **ptr = dict_bucket(dict, s->session);
+  while (*ptr != s)
+    ptr = &(*ptr)->hash_next;
+  *ptr = s->hash_next;
+
+  dict_unlink(dict, s);
+  dict->sessions_num--;
+  dict->bytes -= s->bytes;
+  dict_session_free(s);
+}
+
+/* dict_make_room evicts least recently used sessions other than "keep" until
+ * "need" more bytes fit. Returns zero if they do. Must be called with
+ * dict->lock held. */
+static int dict_make_room(lcc_network_dict_t *dict, dict_session_t const *keep,
+                          size_t need) {
+  while ((dict->bytes + need > dict->max_bytes) && (dict->tail != NULL) &&
+         (dict->tail != keep))
+    dict_evict(dict, dict->tail);
+
+  return (dict->bytes + need > dict->max_bytes) ? ENOMEM : 0;
+}
+
+/* dict_session_get returns the session "id", creating it if necessary. Must be
+ * called with dict->lock held. */
+static dict_session_t *dict_session_get(lcc_network_dict_t *dict,
+                                        uint64_t id) {
+  dict_session_t **bucket = dict_bucket(dict, id);
+  dict_session_t *s = *bucket;
+
+  while ((s != NULL) && (s->session != id))
+    s = s->hash_next;
+
+  if (s != NULL) {
+    if (s != dict->head) {
+      dict_unlink(dict, s);
+      dict_push_front(dict, s);
+    }
+    return s;
+  }
+
+  if (dict->sessions_num >= DICT_MAX_SESSIONS)
+    dict_evict(dict, dict->tail);
+  if (dict_make_room(dict, NULL, sizeof(*s)) != 0)
+    return NULL;
+
+  s = calloc(1, sizeof(*s));
+  if (s == NULL)
+    return NULL;
+  s->session = id;
+  s->bytes = sizeof(*s);
+
+  s->hash_next = *bucket;
+  *bucket = s;
+  dict_push_front(dict, s);
+  dict->sessions_num++;
+  dict->bytes += s->bytes;
+  return s;
+}
+
+static void meta_free(lcc_meta_t *meta, size_t meta_len) {
+  for (size_t i = 0; i < meta_len; i++) {
+    free((void *)meta[i].key);
+    if (meta[i].type == LCC_META_TYPE_STRING)
+      free((void *)meta[i].value.string);
+  }
+  free(meta);
+}
+
 static int parse_int(void *payload, size_t payload_size, uint64_t *out) {
   uint64_t tmp;
 
@@ -286,6 +462,172 @@ static double ntohd(double val) /* {{{ */
   }
 } /* }}} double ntohd */
 
+static int parse_dict_entry(void *payload, size_t payload_size,
+                            uint64_t const *session,
+                            lcc_network_dict_t *dict) {
+  uint8_t *in = payload;
+  uint32_t id;
+
+  if ((payload_size <= sizeof(id)) || (in[payload_size - 1] != '\0'))
+    return EINVAL;
+
+  memmove(&id, in, sizeof(id));
+  id = be32toh(id);
+
+  /* Without a session, there is nothing the string could be referred to by. */
+  if ((dict == NULL) || (session == NULL) || (id >= DICT_MAX_ENTRIES))
+    return 0;
+
+  char *str = strdup((char *)in + sizeof(id));
+  if (str == NULL)
+    return ENOMEM;
+  size_t str_size = strlen(str) + 1;
+
+  pthread_mutex_lock(&dict->lock);
+  dict_session_t *s = dict_session_get(dict, *session);
+  if (s != NULL) {
+    size_t num = s->strings_num;
+    size_t old_size = 0;
+
+    if (id >= s->strings_num) {
+      /* Grow geometrically, so that ascending IDs are not copied over and
+       * over again. */
+      if (num == 0)
+        num = 16;
+      while (num <= id)
+        num *= 2;
+    } else if (s->strings[id] != NULL) {
+      old_size = strlen(s->strings[id]) + 1;
+    }
+
+    size_t grow = (num - s->strings_num) * sizeof(*s->strings) + str_size;
+    if (dict_make_room(dict, s, (grow > old_size) ? (grow - old_size) : 0) !=
+        0) {
+      s = NULL;
+    } else if (num > s->strings_num) {
+      char **tmp = realloc(s->strings, num * sizeof(*tmp));
+      if (tmp == NULL) {
+        s = NULL;
+      } else {
+        memset(tmp + s->strings_num, 0, (num - s->strings_num) * sizeof(*tmp));
+        s->strings = tmp;
+        s->strings_num = num;
+      }
+    }
+
+    if (s != NULL) {
+      free(s->strings[id]);
+      s->strings[id] = str;
+      str = NULL;
+      s->bytes = s->bytes + grow - old_size;
+      dict->bytes = dict->bytes + grow - old_size;
+    }
+  }
+  pthread_mutex_unlock(&dict->lock);
+
+  free(str);
+  return 0;
+}
+
+/* parse_meta replaces the meta data of "state". Entries referring to strings
+ * which have not been received (yet) are silently dropped. */
+static int parse_meta(void *payload, size_t payload_size,
+                      uint64_t const *session, lcc_network_dict_t *dict,
+                      lcc_value_list_t *state) {
+  buffer_t *b = &(buffer_t){
+      .data = payload, .len = payload_size,
+  };
+  uint16_t num;
+
+  if (buffer_uint16(b, &num))
+    return EINVAL;
+
+  meta_free(state->meta, state->meta_len);
+  state->meta = NULL;
+  state->meta_len = 0;
+
+  if ((num == 0) || (dict == NULL) || (session == NULL))
+    return 0;
+
+  lcc_meta_t *meta = calloc(num, sizeof(*meta));
+  if (meta == NULL)
+    return ENOMEM;
+  size_t meta_len = 0;
+
+  pthread_mutex_lock(&dict->lock);
+  dict_session_t *s = dict_session_get(dict, *session);
+  for (uint16_t i = 0; (s != NULL) && (i < num); i++) {
+    uint32_t key_id, str_id;
+    uint64_t tmp64;
+    uint8_t type;
+    lcc_meta_t m = {.key = NULL};
+
+    if (buffer_next(b, &key_id, sizeof(key_id)) ||
+        buffer_next(b, &type, sizeof(type)))
+      break;
+    key_id = be32toh(key_id);
+    m.type = (int)type;
+
+    if (type == LCC_META_TYPE_STRING) {
+      if (buffer_next(b, &str_id, sizeof(str_id)))
+        break;
+      str_id = be32toh(str_id);
+      if ((str_id >= s->strings_num) || (s->strings[str_id] == NULL))
+        continue;
+      m.value.string = s->strings[str_id];
+    } else if (type == LCC_META_TYPE_BOOLEAN) {
+      uint8_t tmp8;
+      if (buffer_next(b, &tmp8, sizeof(tmp8)))
+        break;
+      m.value.boolean = tmp8 ? 1 : 0;
+    } else if ((type == LCC_META_TYPE_SIGNED_INT) ||
+               (type == LCC_META_TYPE_UNSIGNED_INT) ||
+               (type == LCC_META_TYPE_DOUBLE)) {
+      if (buffer_next(b, &tmp64, sizeof(tmp64)))
+        break;
+      if (type == LCC_META_TYPE_DOUBLE) {
+        double d;
+        memmove(&d, &tmp64, sizeof(d));
+        m.value.double_value = ntohd(d);
+      } else if (type == LCC_META_TYPE_SIGNED_INT) {
+        m.value.signed_int = (int64_t)be64toh(tmp64);
+      } else {
+        m.value.unsigned_int = be64toh(tmp64);
+      }
+    } else {
+      /* The size of unknown types is unknown, too. */
+      break;
+    }
+
+    if ((key_id >= s->strings_num) || (s->strings[key_id] == NULL))
+      continue;
+
+    m.key = strdup(s->strings[key_id]);
+    if ((m.key != NULL) && (type == LCC_META_TYPE_STRING)) {
+      m.value.string = strdup(m.value.string);
+      if (m.value.string == NULL) {
+        free((void *)m.key);
+        m.key = NULL;
+      }
+    }
+    if (m.key == NULL)
+      continue;
+
+    meta[meta_len] = m;
+    meta_len++;
+  }
+  pthread_mutex_unlock(&dict->lock);
+
+  if (meta_len == 0) {
+    free(meta);
+    return 0;
+  }
+
+  state->meta = meta;
+  state->meta_len = meta_len;
+  return 0;
+}
+
 static int parse_values(void *payload, size_t payload_size,
                         lcc_value_list_t *state) {
   buffer_t *b = &(buffer_t){
@@ -503,13 +845,11 @@ static int parse_encrypt_aes256(void *data, size_t data_size,
 }
 #endif
 
-static int network_parse(void *data, size_t data_size, lcc_security_level_t sl,
-                         lcc_network_parse_options_t const *opts) {
-  buffer_t *b = &(buffer_t){
-      .data = data, .len = data_size,
-  };
-
-  lcc_value_list_t state = {0};
+static int network_parse_parts(buffer_t *b, lcc_security_level_t sl,
+                               lcc_network_parse_options_t const *opts,
+                               lcc_value_list_t *state) {
+  uint64_t session = 0;
+  _Bool have_session = 0;
 
   while (b->len > 0) {
     uint16_t type = 0, sz = 0;
@@ -536,7 +876,7 @@ static int network_parse(void *data, size_t data_size, lcc_security_level_t sl,
     case TYPE_PLUGIN_INSTANCE:
     case TYPE_TYPE:
     case TYPE_TYPE_INSTANCE: {
-      if (parse_identifier(type, payload, sizeof(payload), &state)) {
+      if (parse_identifier(type, payload, sizeof(payload), state)) {
         DEBUG("lcc_network_parse(): parse_identifier failed.\n");
         return EINVAL;
       }
@@ -547,15 +887,46 @@ static int network_parse(void *data, size_t data_size, lcc_security_level_t sl,
     case TYPE_INTERVAL_HR:
     case TYPE_TIME:
     case TYPE_TIME_HR: {
-      if (parse_time(type, payload, sizeof(payload), &state)) {
+      if (parse_time(type, payload, sizeof(payload), state)) {
         DEBUG("lcc_network_parse(): parse_time failed.\n");
         return EINVAL;
       }
       break;
     }
 
+    case TYPE_DICT_SESSION: {
+      if (parse_int(payload, sizeof(payload), &session)) {
+        DEBUG("lcc_network_parse(): parse_int failed.\n");
+        return EINVAL;
+      }
+      have_session = 1;
+      break;
+    }
+
+    case TYPE_DICT_ENTRY: {
+      int status = parse_dict_entry(payload, sizeof(payload),
+                                    have_session ? &session : NULL,
+                                    opts->dict);
+      if (status != 0) {
+        DEBUG("lcc_network_parse(): parse_dict_entry failed.\n");
+        return status;
+      }
+      break;
+    }
+
+    case TYPE_META: {
+      int status = parse_meta(payload, sizeof(payload),
+                              have_session ? &session : NULL, opts->dict,
+                              state);
+      if (status != 0) {
+        DEBUG("lcc_network_parse(): parse_meta failed.\n");
+        return status;
+      }
+      break;
+    }
+
     case TYPE_VALUES: {
-      lcc_value_list_t vl = state;
+      lcc_value_list_t vl = *state;
       if (parse_values(payload, sizeof(payload), &vl)) {
         DEBUG("lcc_network_parse(): parse_values failed.\n");
         return EINVAL;
@@ -607,6 +978,19 @@ static int network_parse(void *data, size_t data_size, lcc_security_level_t sl,
   return 0;
 }
 
+static int network_parse(void *data, size_t data_size, lcc_security_level_t sl,
+                         lcc_network_parse_options_t const *opts) {
+  buffer_t *b = &(buffer_t){
+      .data = data, .len = data_size,
+  };
+
+  lcc_value_list_t state = {0};
+
+  int status = network_parse_parts(b, sl, opts, &state);
+  meta_free(state.meta, state.meta_len);
+  return status;
+}
+
 int lcc_network_parse(void *data, size_t data_size,
                       lcc_network_parse_options_t opts) {
   if (opts.password_lookup) {
@@ -481,6 +481,272 @@ static int test_decrypt_aes256() {
   return 0;
 }
 
+static char meta_tags[1024];
+static size_t meta_received;
+
+static int meta_writer(lcc_value_list_t const *vl) {
+  char want_name[sizeof("filedata.") + LCC_NAME_LEN];
+
+  if (vl->meta_len != 2) {
+    fprintf(stderr, "meta_writer: vl->meta_len = %zu, want 2\n", vl->meta_len);
+    return EINVAL;
+  }
+
+  snprintf(want_name, sizeof(want_name), "filedata.%s",
+           vl->identifier.type_instance);
+  if ((strcmp("tsdb_name", vl->meta[0].key) != 0) ||
+      (vl->meta[0].type != LCC_META_TYPE_STRING) ||
+      (strcmp(want_name, vl->meta[0].value.string) != 0) ||
+      (strcmp("tsdb_tags", vl->meta[1].key) != 0) ||
+      (vl->meta[1].type != LCC_META_TYPE_STRING) ||
+      (strcmp(meta_tags, vl->meta[1].value.string) != 0)) {
+    fprintf(stderr, "meta_writer: unexpected meta data for \"%s\"\n",
+            vl->identifier.type_instance);
+    return EINVAL;
+  }
+
+  meta_received++;
+  return 0;
+}
+
+static int meta_flush(lcc_network_buffer_t *nb, lcc_network_dict_t *dict,
+                      size_t *bytes) {
+  uint8_t buffer[LCC_NETWORK_BUFFER_SIZE_DEFAULT];
+  size_t buffer_size = sizeof(buffer);
+
+  lcc_network_buffer_finalize(nb);
+  lcc_network_buffer_get(nb, buffer, &buffer_size);
+  lcc_network_buffer_initialize(nb);
+  if (buffer_size == 0)
+    return 0;
+
+  *bytes += buffer_size;
+  return lcc_network_parse(buffer, buffer_size,
+                           (lcc_network_parse_options_t){
+                               .writer = (dict != NULL) ? meta_writer
+                                                        : nop_writer,
+                               .dict = dict,
+                           });
+}
+
+/* meta_send sends "num" value lists and returns the number of bytes used. */
+static size_t meta_send(lcc_network_buffer_t *nb, lcc_network_dict_t *dict,
+                        size_t num) {
+  size_t bytes = 0;
+
+  for (size_t i = 0; i < num; i++) {
+    char name[sizeof("filedata.") + LCC_NAME_LEN];
+    lcc_value_list_t vl = LCC_VALUE_LIST_INIT;
+    value_t values[] = {{.gauge = (gauge_t)i}};
+    int values_types[] = {LCC_TYPE_GAUGE};
+    lcc_meta_t meta[] = {
+        {.key = "tsdb_name", .type = LCC_META_TYPE_STRING},
+        {.key = "tsdb_tags",
+         .type = LCC_META_TYPE_STRING,
+         .value.string = meta_tags},
+    };
+
+    vl.values = values;
+    vl.values_types = values_types;
+    vl.values_len = 1;
+    vl.time = 1500000000.0;
+    vl.interval = 10.0;
+    strncpy(vl.identifier.host, "example.com", LCC_NAME_LEN);
+    strncpy(vl.identifier.plugin, "filedata", LCC_NAME_LEN);
+    strncpy(vl.identifier.type, "gauge", LCC_NAME_LEN);
+    snprintf(vl.identifier.type_instance, LCC_NAME_LEN, "metric%zu", i);
+    snprintf(name, sizeof(name), "filedata.%s", vl.identifier.type_instance);
+    meta[0].value.string = name;
+    if (dict != NULL) {
+      vl.meta = meta;
+      vl.meta_len = 2;
+    }
+
+    if (lcc_network_buffer_add_value(nb, &vl) == 0)
+      continue;
+    if (meta_flush(nb, dict, &bytes) != 0)
+      return 0;
+    if (lcc_network_buffer_add_value(nb, &vl) != 0)
+      return 0;
+  }
+
+  if (meta_flush(nb, dict, &bytes) != 0)
+    return 0;
+  return bytes;
+}
+
+static int test_meta() {
+  size_t const num = 1000;
+  int ret = 0;
+
+  memset(meta_tags, 'x', sizeof(meta_tags) - 1);
+  memcpy(meta_tags, "env=", strlen("env="));
+
+  lcc_network_buffer_t *nb =
+      lcc_network_buffer_create(LCC_NETWORK_BUFFER_SIZE_DEFAULT);
+  lcc_network_dict_t *dict = lcc_network_dict_create();
+  assert((nb != NULL) && (dict != NULL));
+
+  size_t bytes_plain = meta_send(nb, NULL, num);
+  size_t bytes_first = meta_send(nb, dict, num);
+  size_t bytes_steady = meta_send(nb, dict, num);
+
+  /* Without a dictionary, each value list would carry both strings. */
+  size_t bytes_naive = bytes_plain + num * (strlen("tsdb_name") +
+                                            strlen("filedata.metric000") +
+                                            strlen("tsdb_tags") +
+                                            strlen(meta_tags) + 4 + 4 * 2);
+
+  printf("# bytes/value: no meta data %.1f, inline strings (estimate) %.1f, "
+         "dictionary first pass %.1f, dictionary steady state %.1f\n",
+         (double)bytes_plain / num, (double)bytes_naive / num,
+         (double)bytes_first / num, (double)bytes_steady / num);
+
+  if ((bytes_plain == 0) || (bytes_first == 0) || (bytes_steady == 0)) {
+    fprintf(stderr, "test_meta: sending or parsing failed\n");
+    ret = -1;
+  } else if (meta_received != 2 * num) {
+    fprintf(stderr, "test_meta: meta_received = %zu, want %zu\n",
+            meta_received, 2 * num);
+    ret = -1;
+  } else if (bytes_steady >= bytes_first || bytes_first >= bytes_naive) {
+    fprintf(stderr, "test_meta: dictionary does not reduce the size\n");
+    ret = -1;
+  } else {
+    printf("ok - meta data round trip\n");
+  }
+
+  /* Without a dictionary the receiver ignores the meta data parts. */
+  uint8_t buffer[LCC_NETWORK_BUFFER_SIZE_DEFAULT];
+  size_t buffer_size = sizeof(buffer);
+  lcc_value_list_t vl = LCC_VALUE_LIST_INIT;
+  value_t values[] = {{.gauge = 42.0}};
+  int values_types[] = {LCC_TYPE_GAUGE};
+  lcc_meta_t meta[] = {
+      {.key = "tsdb_tags", .type = LCC_META_TYPE_STRING, .value.string = "a"},
+  };
+  vl.values = values;
+  vl.values_types = values_types;
+  vl.values_len = 1;
+  vl.meta = meta;
+  vl.meta_len = 1;
+  strncpy(vl.identifier.host, "example.com", LCC_NAME_LEN);
+  strncpy(vl.identifier.plugin, "filedata", LCC_NAME_LEN);
+  strncpy(vl.identifier.type, "gauge", LCC_NAME_LEN);
+  lcc_network_buffer_add_value(nb, &vl);
+  lcc_network_buffer_finalize(nb);
+  lcc_network_buffer_get(nb, buffer, &buffer_size);
+  int status = lcc_network_parse(buffer, buffer_size,
+                                 (lcc_network_parse_options_t){
+                                     .writer = nop_writer,
+                                 });
+  if (status != 0) {
+    fprintf(stderr, "test_meta: parsing without dictionary = %d, want 0\n",
+            status);
+    ret = -1;
+  } else {
+    printf("ok - meta data ignored without dictionary\n");
+  }
+
+  lcc_network_dict_destroy(dict);
+  lcc_network_buffer_destroy(nb);
+  return ret;
+}
+
+static int dict_put(lcc_network_dict_t *dict, uint64_t session, uint32_t id,
+                    size_t len) {
+  uint8_t payload[sizeof(id) + 1024];
+  uint32_t id_be = htobe32(id);
+
+  assert(len < sizeof(payload) - sizeof(id));
+  memcpy(payload, &id_be, sizeof(id_be));
+  memset(payload + sizeof(id), 'x', len);
+  payload[sizeof(id) + len] = 0;
+  return parse_dict_entry(payload, sizeof(id) + len + 1, &session, dict);
+}
+
+/* dict_bytes recomputes the memory used by the dictionary and checks the
+ * bookkeeping of each session. */
+static size_t dict_bytes(lcc_network_dict_t *dict) {
+  size_t sum = 0;
+  size_t num = 0;
+
+  for (dict_session_t *s = dict->head; s != NULL; s = s->next) {
+    size_t bytes = sizeof(*s) + s->strings_num * sizeof(*s->strings);
+    for (size_t i = 0; i < s->strings_num; i++)
+      if (s->strings[i] != NULL)
+        bytes += strlen(s->strings[i]) + 1;
+    if (bytes != s->bytes)
+      return 0;
+    dict_session_t *found = *dict_bucket(dict, s->session);
+    while ((found != NULL) && (found != s))
+      found = found->hash_next;
+    if (found == NULL)
+      return 0;
+    sum += bytes;
+    num++;
+  }
+
+  return (num == dict->sessions_num) ? sum : 0;
+}
+
+static int test_dict_memory() {
+  size_t const max = 65536;
+  lcc_network_dict_t *dict = lcc_network_dict_create();
+  assert(dict != NULL);
+  lcc_network_dict_set_max_memory(dict, max);
+
+  /* 100 senders with 100 strings of 100 bytes each; sender 1 stays busy. */
+  for (uint64_t session = 1; session <= 100; session++) {
+    for (uint32_t id = 0; id < 100; id++) {
+      if ((dict_put(dict, session, id, 100) != 0) ||
+          (dict_put(dict, 1, id % 10, 50) != 0)) {
+        fprintf(stderr, "test_dict_memory: parse_dict_entry failed\n");
+        lcc_network_dict_destroy(dict);
+        return -1;
+      }
+    }
+  }
+
+  size_t bytes = dict_bytes(dict);
+  if ((bytes == 0) || (bytes != dict->bytes) || (bytes > max)) {
+    fprintf(stderr, "test_dict_memory: bytes = %zu, tracked %zu, max %zu\n",
+            bytes, dict->bytes, max);
+    lcc_network_dict_destroy(dict);
+    return -1;
+  }
+  if ((dict->head == NULL) || (dict->head->session != 1) ||
+      (dict->tail == dict->head)) {
+    fprintf(stderr, "test_dict_memory: sender 1 has been evicted\n");
+    lcc_network_dict_destroy(dict);
+    return -1;
+  }
+
+  /* A sparse ID would need a table larger than the limit. */
+  if ((dict_put(dict, 4242, DICT_MAX_ENTRIES - 1, 10) != 0) ||
+      (dict_session_get(dict, 4242)->strings_num != 0) ||
+      (dict_bytes(dict) != dict->bytes) || (dict->bytes > max)) {
+    fprintf(stderr, "test_dict_memory: sparse ID has been stored\n");
+    lcc_network_dict_destroy(dict);
+    return -1;
+  }
+
+  /* Ascending IDs grow the table geometrically. */
+  lcc_network_dict_set_max_memory(dict, DICT_DEFAULT_MAX_MEMORY);
+  for (uint32_t id = 0; id < 1000; id++)
+    dict_put(dict, 4243, id, 1);
+  size_t num = dict_session_get(dict, 4243)->strings_num;
+  if ((num < 1000) || (num >= 2048) || ((num & (num - 1)) != 0)) {
+    fprintf(stderr, "test_dict_memory: strings_num = %zu\n", num);
+    lcc_network_dict_destroy(dict);
+    return -1;
+  }
+
+  lcc_network_dict_destroy(dict);
+  printf("ok - meta data dictionary memory limit\n");
+  return 0;
+}
+
 int main(void) {
   int ret = 0;
 
@@ -506,6 +772,12 @@ int main(void) {
   if ((status = test_decrypt_aes256())) {
     ret = status;
   }
+  if ((status = test_meta())) {
+    ret = status;
+  }
+  if ((status = test_dict_memory())) {
+    ret = status;
+  }
 
   return ret;
 }
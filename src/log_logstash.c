@@ -60,9 +60,11 @@ static int log_logstash_config(const char *key, const char *value) {
     log_level = parse_log_severity(value);
     if (log_level < 0) {
       log_level = LOG_INFO;
+      plugin_set_log_level("log_logstash", log_level);
       ERROR("log_logstash: invalid loglevel [%s] defaulting to 'info'", value);
       return 1;
     }
+    plugin_set_log_level("log_logstash", log_level);
   } else if (0 == strcasecmp(key, "File")) {
     sfree(log_file);
     log_file = strdup(value);
@@ -336,6 +338,7 @@ void module_register(void) {
                          config_keys_num);
   plugin_register_log("log_logstash", log_logstash_log,
                       /* user_data = */ NULL);
+  plugin_set_log_level("log_logstash", log_level);
   plugin_register_notification("log_logstash", log_logstash_notification,
                                /* user_data = */ NULL);
 } /* void module_register (void) */
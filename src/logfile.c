@@ -52,9 +52,11 @@ static int logfile_config(const char *key, const char *value) {
     log_level = parse_log_severity(value);
     if (log_level < 0) {
       log_level = LOG_INFO;
+      plugin_set_log_level("logfile", log_level);
       ERROR("logfile: invalid loglevel [%s] defaulting to 'info'", value);
       return 1;
     }
+    plugin_set_log_level("logfile", log_level);
   } else if (0 == strcasecmp(key, "File")) {
     sfree(log_file);
     log_file = strdup(value);
@@ -201,6 +203,7 @@ void module_register(void) {
   plugin_register_config("logfile", logfile_config, config_keys,
                          config_keys_num);
   plugin_register_log("logfile", logfile_log, /* user_data = */ NULL);
+  plugin_set_log_level("logfile", log_level);
   plugin_register_notification("logfile", logfile_notification,
                                /* user_data = */ NULL);
 } /* void module_register (void) */
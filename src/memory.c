@@ -60,6 +60,10 @@
 #include <sys/protosw.h>
 #endif /* HAVE_PERFSTAT */
 
+#if KERNEL_LINUX
+#include "utils_procfs.h"
+#endif
+
 /* vm_statistics_data_t */
 #if HAVE_HOST_STATISTICS
 static mach_port_t port_host;
@@ -71,7 +75,7 @@ static vm_size_t pagesize;
 /* #endif HAVE_SYSCTLBYNAME */
 
 #elif KERNEL_LINUX
-/* no global variables */
+static procfs_file_t *proc_meminfo;
 /* #endif KERNEL_LINUX */
 
 #elif HAVE_LIBKSTAT
@@ -262,8 +266,8 @@ static int memory_read_internal(value_list_t *vl) {
 /* #endif HAVE_SYSCTLBYNAME */
 
 #elif KERNEL_LINUX
-  FILE *fh;
-  char buffer[1024];
+  char *line;
+  ssize_t status;
 
   char *fields[8];
   int numfields;
@@ -279,46 +283,53 @@ static int memory_read_internal(value_list_t *vl) {
   gauge_t mem_slab_reclaimable = 0;
   gauge_t mem_slab_unreclaimable = 0;
 
-  if ((fh = fopen("/proc/meminfo", "r")) == NULL) {
+  if (proc_meminfo == NULL) {
+    proc_meminfo = procfs_open("/proc/meminfo");
+    if (proc_meminfo == NULL) {
+      char errbuf[1024];
+      WARNING("memory: open (/proc/meminfo) failed: %s",
+              sstrerror(errno, errbuf, sizeof(errbuf)));
+      return -1;
+    }
+  }
+
+  status = procfs_read(proc_meminfo);
+  if (status < 0) {
     char errbuf[1024];
-    WARNING("memory: fopen: %s", sstrerror(errno, errbuf, sizeof(errbuf)));
+    WARNING("memory: reading /proc/meminfo failed: %s",
+            sstrerror((int)-status, errbuf, sizeof(errbuf)));
     return -1;
   }
 
-  while (fgets(buffer, sizeof(buffer), fh) != NULL) {
+  while ((line = procfs_getline(proc_meminfo)) != NULL) {
     gauge_t *val = NULL;
 
-    if (strncasecmp(buffer, "MemTotal:", 9) == 0)
+    if (strncasecmp(line, "MemTotal:", 9) == 0)
       val = &mem_total;
-    else if (strncasecmp(buffer, "MemFree:", 8) == 0)
+    else if (strncasecmp(line, "MemFree:", 8) == 0)
       val = &mem_free;
-    else if (strncasecmp(buffer, "Buffers:", 8) == 0)
+    else if (strncasecmp(line, "Buffers:", 8) == 0)
       val = &mem_buffered;
-    else if (strncasecmp(buffer, "Cached:", 7) == 0)
+    else if (strncasecmp(line, "Cached:", 7) == 0)
       val = &mem_cached;
-    else if (strncasecmp(buffer, "Slab:", 5) == 0)
+    else if (strncasecmp(line, "Slab:", 5) == 0)
       val = &mem_slab_total;
-    else if (strncasecmp(buffer, "SReclaimable:", 13) == 0) {
+    else if (strncasecmp(line, "SReclaimable:", 13) == 0) {
       val = &mem_slab_reclaimable;
       detailed_slab_info = 1;
-    } else if (strncasecmp(buffer, "SUnreclaim:", 11) == 0) {
+    } else if (strncasecmp(line, "SUnreclaim:", 11) == 0) {
       val = &mem_slab_unreclaimable;
       detailed_slab_info = 1;
     } else
       continue;
 
-    numfields = strsplit(buffer, fields, STATIC_ARRAY_SIZE(fields));
+    numfields = strsplit(line, fields, STATIC_ARRAY_SIZE(fields));
     if (numfields < 2)
       continue;
 
     *val = 1024.0 * atof(fields[1]);
   }
 
-  if (fclose(fh)) {
-    char errbuf[1024];
-    WARNING("memory: fclose: %s", sstrerror(errno, errbuf, sizeof(errbuf)));
-  }
-
   if (mem_total < (mem_free + mem_buffered + mem_cached + mem_slab_total))
     return -1;
 
@@ -490,8 +501,20 @@ static int memory_read(void) /* {{{ */
   return memory_read_internal(&vl);
 } /* }}} int memory_read */
 
+#if KERNEL_LINUX
+static int memory_shutdown(void) /* {{{ */
+{
+  procfs_close(proc_meminfo);
+  proc_meminfo = NULL;
+  return 0;
+} /* }}} int memory_shutdown */
+#endif
+
 void module_register(void) {
   plugin_register_complex_config("memory", memory_config);
   plugin_register_init("memory", memory_init);
   plugin_register_read("memory", memory_read);
+#if KERNEL_LINUX
+  plugin_register_shutdown("memory", memory_shutdown);
+#endif
 } /* void module_register */
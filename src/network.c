@@ -24,14 +24,17 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE /* For struct ip_mreq */
+#define _GNU_SOURCE /* For recvmmsg(2) */
 
 #include "collectd.h"
 
 #include "common.h"
 #include "plugin.h"
+#include "utils_avltree.h"
 #include "utils_cache.h"
 #include "utils_complain.h"
 #include "utils_fbhash.h"
+#include "utils_random.h"
 
 #include "network.h"
 
@@ -117,12 +120,16 @@ struct sockent_client {
 
 struct sockent_server {
   int *fd;
+  /* Index of the receive thread reading from fd[i], or -1 if the socket is
+   * shared by all receive threads. */
+  int *fd_thread;
   size_t fd_num;
 #if HAVE_GCRYPT_H
   int security_level;
   char *auth_file;
   fbhash_t *userdb;
   gcry_cipher_hd_t cypher;
+  pthread_mutex_t cypher_lock;
 #endif
 };
 
@@ -250,14 +257,81 @@ struct part_encryption_aes256_s {
 };
 typedef struct part_encryption_aes256_s part_encryption_aes256_t;
 
+/*                      1 1 1 1 1 1 1 1 1 1 2 2 2 2 2 2 2 2 2 2 3 3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * +-------------------------------+-------------------------------+
+ * ! Type (TYPE_DICT_ENTRY)        ! Length                        !
+ * +-------------------------------+-------------------------------+
+ * ! String ID                                                     !
+ * +---------------------------------------------------------------+
+ * : (Length - 8) Bytes, null terminated                           :
+ * +---------------------------------------------------------------+
+ *
+ * Strings used by meta data (keys and string values) are sent once per
+ * dictionary session (TYPE_DICT_SESSION, a random 64 bit number chosen by the
+ * sender) and are referred to by their ID afterwards. Since packets may get
+ * lost, the sender repeats each definition every `MetaDataRefreshInterval'.
+ *
+ * +-------------------------------+-------------------------------+
+ * ! Type (TYPE_META)              ! Length                        !
+ * +-------------------------------+---------------+---------------+
+ * ! Num of entries                ! Key ID ...                    :
+ * +-------------------------------+---------------+---------------+
+ * : ... Key ID                    ! MD type       ! Value ...     :
+ * +-------------------------------+---------------+---------------+
+ *
+ * The value is a string ID (4 bytes) for MD_TYPE_STRING, one byte for
+ * MD_TYPE_BOOLEAN and eight bytes otherwise. The meta data applies to all
+ * following value parts of the packet, until the next TYPE_META part.
+ */
+#define NETWORK_DICT_MAX_ENTRIES 65536
+#define NETWORK_DICT_MAX_SESSIONS 4096
+#define NETWORK_DICT_DEFAULT_MAX_MEMORY 64 /* MiB */
+#define NETWORK_DICT_SESSION_TIMEOUT TIME_T_TO_CDTIME_T(3600)
+
+struct send_dict_entry_s {
+  uint32_t id;
+  cdtime_t last_sent;
+};
+typedef struct send_dict_entry_s send_dict_entry_t;
+
+struct recv_dict_s {
+  uint64_t session;
+  char **strings;
+  size_t strings_num;
+  cdtime_t last_seen;
+  /* Memory used by this dictionary, see recv_dicts_bytes. */
+  size_t bytes;
+  /* Least recently used list, most recently used first. */
+  struct recv_dict_s *prev;
+  struct recv_dict_s *next;
+};
+typedef struct recv_dict_s recv_dict_t;
+
 struct receive_list_entry_s {
   char *data;
   int data_len;
-  int fd;
+  sockent_t *se;
   struct receive_list_entry_s *next;
 };
 typedef struct receive_list_entry_s receive_list_entry_t;
 
+/* Each receive thread polls its own set of sockets. With `ReceiveThreads' > 1
+ * every unicast `Listen' address is bound once per thread using SO_REUSEPORT,
+ * so the kernel spreads the incoming datagrams across the threads. */
+struct receive_thread_s {
+  pthread_t id;
+  _Bool running;
+
+  struct pollfd *pollfd;
+  sockent_t **pollfd_se;
+  size_t pollfd_num;
+};
+typedef struct receive_thread_s receive_thread_t;
+
+/* Upper bound for the number of idle entries kept in the receive pool. */
+#define RECEIVE_POOL_MAX_FREE 16384
+
 /*
  * Private variables
  */
@@ -266,6 +340,12 @@ static int network_config_ttl = 0;
 static size_t network_config_packet_size = 1452;
 static _Bool network_config_forward = 0;
 static _Bool network_config_stats = 0;
+static size_t network_config_receive_threads = 1;
+static size_t network_config_dispatch_threads = 1;
+static size_t network_config_receive_batch = 32;
+static _Bool network_config_send_meta = 0;
+static cdtime_t network_config_meta_refresh = 0;
+static size_t network_config_meta_max_memory = NETWORK_DICT_DEFAULT_MAX_MEMORY;
 
 static sockent_t *sending_sockets = NULL;
 
@@ -275,17 +355,22 @@ static pthread_mutex_t receive_list_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t receive_list_cond = PTHREAD_COND_INITIALIZER;
 static uint64_t receive_list_length = 0;
 
+/* Entries (and their packet buffers) handed back by the dispatch threads are
+ * kept here and reused by the receive threads. */
+static receive_list_entry_t *receive_pool_head = NULL;
+static size_t receive_pool_length = 0;
+static pthread_mutex_t receive_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static sockent_t *listen_sockets = NULL;
-static struct pollfd *listen_sockets_pollfd = NULL;
 static size_t listen_sockets_num = 0;
 
 /* The receive and dispatch threads will run as long as `listen_loop' is set to
  * zero. */
 static int listen_loop = 0;
-static int receive_thread_running = 0;
-static pthread_t receive_thread_id;
-static int dispatch_thread_running = 0;
-static pthread_t dispatch_thread_id;
+static receive_thread_t *receive_threads = NULL;
+static size_t receive_threads_num = 0;
+static pthread_t *dispatch_threads = NULL;
+static size_t dispatch_threads_num = 0;
 
 /* Buffer in which to-be-sent network packets are constructed. */
 static char *send_buffer;
@@ -295,12 +380,29 @@ static cdtime_t send_buffer_last_update;
 static value_list_t send_buffer_vl = VALUE_LIST_INIT;
 static pthread_mutex_t send_buffer_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* Meta data state of the send buffer, also protected by send_buffer_lock. */
+static c_avl_tree_t *send_dict = NULL;
+static uint64_t send_dict_session = 0;
+static uint32_t send_dict_next_id = 0;
+static _Bool send_buffer_have_session = 0;
+static char *send_buffer_meta = NULL;
+static size_t send_buffer_meta_len = 0;
+
+/* Dictionaries of the remote senders, keyed by session. They are also kept
+ * in a least recently used list, so that the dictionaries of senders which
+ * have gone away are evicted first once the dictionaries, together, use more
+ * than `MetaDataMaxMemory'. */
+static c_avl_tree_t *recv_dicts = NULL;
+static recv_dict_t *recv_dicts_head = NULL;
+static recv_dict_t *recv_dicts_tail = NULL;
+static size_t recv_dicts_bytes = 0;
+static pthread_mutex_t recv_dicts_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* XXX: These counters are incremented from one place only. The spot in which
- * the values are incremented is either only reachable by one thread (the
- * dispatch thread, for example) or locked by some lock (send_buffer_lock for
- * example). Only if neither is true, the stats_lock is acquired. The counters
- * are always read without holding a lock in the hope that writing 8 bytes to
- * memory is an atomic operation. */
+ * the values are incremented is either locked by some lock (send_buffer_lock
+ * for example) or the stats_lock is acquired, since there may be more than one
+ * receive and dispatch thread. The counters are always read without holding a
+ * lock in the hope that writing 8 bytes to memory is an atomic operation. */
 static derive_t stats_octets_rx = 0;
 static derive_t stats_octets_tx = 0;
 static derive_t stats_packets_rx = 0;
@@ -391,7 +493,7 @@ static _Bool check_send_notify_okay(const notification_t *n) /* {{{ */
 } /* }}} _Bool check_send_notify_okay */
 
 static int network_dispatch_values(value_list_t *vl, /* {{{ */
-                                   const char *username) {
+                                   const char *username, meta_data_t *meta) {
   int status;
 
   if ((vl->time == 0) || (strlen(vl->host) == 0) || (strlen(vl->plugin) == 0) ||
@@ -407,13 +509,15 @@ static int network_dispatch_values(value_list_t *vl, /* {{{ */
           "NOT dispatching %s.",
           name);
 #endif
+    pthread_mutex_lock(&stats_lock);
     stats_values_not_dispatched++;
+    pthread_mutex_unlock(&stats_lock);
     return 0;
   }
 
   assert(vl->meta == NULL);
 
-  vl->meta = meta_data_create();
+  vl->meta = (meta != NULL) ? meta_data_clone(meta) : meta_data_create();
   if (vl->meta == NULL) {
     ERROR("network plugin: meta_data_create failed.");
     return -ENOMEM;
@@ -438,7 +542,9 @@ static int network_dispatch_values(value_list_t *vl, /* {{{ */
   }
 
   plugin_dispatch_values(vl);
+  pthread_mutex_lock(&stats_lock);
   stats_values_dispatched++;
+  pthread_mutex_unlock(&stats_lock);
 
   meta_data_destroy(vl->meta);
   vl->meta = NULL;
@@ -736,6 +842,85 @@ static int write_part_string(char **ret_buffer, size_t *ret_buffer_len,
   return 0;
 } /* int write_part_string */
 
+static int write_part_dict_entry(char **ret_buffer, /* {{{ */
+                                 size_t *ret_buffer_len, uint32_t id,
+                                 const char *str, size_t str_len) {
+  char *buffer;
+  size_t buffer_len;
+
+  uint16_t pkg_type;
+  uint16_t pkg_length;
+  uint32_t pkg_id;
+
+  size_t offset;
+
+  buffer_len = 2 * sizeof(uint16_t) + sizeof(pkg_id) + str_len + 1;
+  if ((*ret_buffer_len < buffer_len) || (buffer_len > UINT16_MAX))
+    return -1;
+
+  pkg_type = htons(TYPE_DICT_ENTRY);
+  pkg_length = htons((uint16_t)buffer_len);
+  pkg_id = htonl(id);
+
+  buffer = *ret_buffer;
+  offset = 0;
+  memcpy(buffer + offset, &pkg_type, sizeof(pkg_type));
+  offset += sizeof(pkg_type);
+  memcpy(buffer + offset, &pkg_length, sizeof(pkg_length));
+  offset += sizeof(pkg_length);
+  memcpy(buffer + offset, &pkg_id, sizeof(pkg_id));
+  offset += sizeof(pkg_id);
+  memcpy(buffer + offset, str, str_len);
+  offset += str_len;
+  memset(buffer + offset, '\0', 1);
+  offset += 1;
+
+  assert(offset == buffer_len);
+
+  *ret_buffer = buffer + buffer_len;
+  *ret_buffer_len -= buffer_len;
+
+  return 0;
+} /* }}} int write_part_dict_entry */
+
+static int write_part_meta(char **ret_buffer, size_t *ret_buffer_len, /* {{{ */
+                           const char *payload, size_t payload_len) {
+  char *buffer;
+  size_t buffer_len;
+
+  part_header_t pkg_head;
+  uint16_t pkg_num = 0;
+
+  size_t offset;
+
+  /* An empty part clears the meta data of the following values. */
+  if (payload_len == 0) {
+    payload = (const char *)&pkg_num;
+    payload_len = sizeof(pkg_num);
+  }
+
+  buffer_len = sizeof(pkg_head) + payload_len;
+  if ((*ret_buffer_len < buffer_len) || (buffer_len > UINT16_MAX))
+    return -1;
+
+  pkg_head.type = htons(TYPE_META);
+  pkg_head.length = htons((uint16_t)buffer_len);
+
+  buffer = *ret_buffer;
+  offset = 0;
+  memcpy(buffer + offset, &pkg_head, sizeof(pkg_head));
+  offset += sizeof(pkg_head);
+  memcpy(buffer + offset, payload, payload_len);
+  offset += payload_len;
+
+  assert(offset == buffer_len);
+
+  *ret_buffer = buffer + buffer_len;
+  *ret_buffer_len -= buffer_len;
+
+  return 0;
+} /* }}} int write_part_meta */
+
 static int parse_part_values(void **ret_buffer, size_t *ret_buffer_len,
                              value_t **ret_values, size_t *ret_num_values) {
   char *buffer = *ret_buffer;
@@ -965,6 +1150,366 @@ static int parse_part_string(void **ret_buffer, size_t *ret_buffer_len,
   return 0;
 } /* int parse_part_string */
 
+static int recv_dict_compare(const void *a, const void *b) /* {{{ */
+{
+  uint64_t sa = *((const uint64_t *)a);
+  uint64_t sb = *((const uint64_t *)b);
+
+  if (sa < sb)
+    return -1;
+  else if (sa > sb)
+    return 1;
+  return 0;
+} /* }}} int recv_dict_compare */
+
+static void recv_dict_free(recv_dict_t *d) /* {{{ */
+{
+  if (d == NULL)
+    return;
+
+  for (size_t i = 0; i < d->strings_num; i++)
+    sfree(d->strings[i]);
+  sfree(d->strings);
+  sfree(d);
+} /* }}} void recv_dict_free */
+
+static void recv_dict_unlink(recv_dict_t *d) /* {{{ */
+{
+  if (d->prev != NULL)
+    d->prev->next = d->next;
+  else
+    recv_dicts_head = d->next;
+
+  if (d->next != NULL)
+    d->next->prev = d->prev;
+  else
+    recv_dicts_tail = d->prev;
+
+  d->prev = d->next = NULL;
+} /* }}} void recv_dict_unlink */
+
+static void recv_dict_push_front(recv_dict_t *d) /* {{{ */
+{
+  d->prev = NULL;
+  d->next = recv_dicts_head;
+  if (recv_dicts_head != NULL)
+    recv_dicts_head->prev = d;
+  else
+    recv_dicts_tail = d;
+  recv_dicts_head = d;
+} /* }}} void recv_dict_push_front */
+
+/* Removes "d" from the tree and the list and frees it.
+ * recv_dicts_lock must be held. */
+static void recv_dict_evict(recv_dict_t *d) /* {{{ */
+{
+  c_avl_remove(recv_dicts, &d->session, NULL, NULL);
+  recv_dict_unlink(d);
+  recv_dicts_bytes -= d->bytes;
+  recv_dict_free(d);
+} /* }}} void recv_dict_evict */
+
+/* Evicts least recently used dictionaries other than "keep" until "need" more
+ * bytes fit into `MetaDataMaxMemory'. Returns zero if they do.
+ * recv_dicts_lock must be held. */
+static int recv_dict_make_room(recv_dict_t const *keep, /* {{{ */
+                               size_t need) {
+  size_t max = network_config_meta_max_memory * 1048576;
+
+  while ((recv_dicts_bytes + need > max) && (recv_dicts_tail != NULL) &&
+         (recv_dicts_tail != keep)) {
+    static c_complain_t complain_evict = C_COMPLAIN_INIT_STATIC;
+    c_complain(LOG_NOTICE, &complain_evict,
+               "network plugin: Meta data dictionaries use more than "
+               "`MetaDataMaxMemory'; dropping the least recently used ones.");
+    recv_dict_evict(recv_dicts_tail);
+  }
+
+  return (recv_dicts_bytes + need > max) ? -1 : 0;
+} /* }}} int recv_dict_make_room */
+
+/* Returns the dictionary of "session", creating it if necessary. The
+ * dictionaries of senders which have not been heard of for a while are
+ * removed. recv_dicts_lock must be held. */
+static recv_dict_t *recv_dict_get(uint64_t session) /* {{{ */
+{
+  recv_dict_t *d = NULL;
+  cdtime_t now = cdtime();
+
+  if (recv_dicts == NULL) {
+    recv_dicts = c_avl_create(recv_dict_compare);
+    if (recv_dicts == NULL)
+      return NULL;
+  }
+
+  if (c_avl_get(recv_dicts, &session, (void *)&d) == 0) {
+    d->last_seen = now;
+    if (d != recv_dicts_head) {
+      recv_dict_unlink(d);
+      recv_dict_push_front(d);
+    }
+    return d;
+  }
+
+  while ((recv_dicts_tail != NULL) &&
+         ((now - recv_dicts_tail->last_seen) > NETWORK_DICT_SESSION_TIMEOUT))
+    recv_dict_evict(recv_dicts_tail);
+
+  if (c_avl_size(recv_dicts) >= NETWORK_DICT_MAX_SESSIONS) {
+    static c_complain_t complain_too_many = C_COMPLAIN_INIT_STATIC;
+    c_complain(LOG_NOTICE, &complain_too_many,
+               "network plugin: More than %d meta data dictionaries; "
+               "dropping the least recently used ones.",
+               NETWORK_DICT_MAX_SESSIONS);
+    recv_dict_evict(recv_dicts_tail);
+  }
+
+  if (recv_dict_make_room(NULL, sizeof(*d)) != 0)
+    return NULL;
+
+  d = calloc(1, sizeof(*d));
+  if (d == NULL)
+    return NULL;
+  d->session = session;
+  d->last_seen = now;
+  d->bytes = sizeof(*d);
+
+  if (c_avl_insert(recv_dicts, &d->session, d) != 0) {
+    sfree(d);
+    return NULL;
+  }
+  recv_dict_push_front(d);
+  recv_dicts_bytes += d->bytes;
+
+  return d;
+} /* }}} recv_dict_t *recv_dict_get */
+
+static void recv_dict_destroy_all(void) /* {{{ */
+{
+  uint64_t *key;
+  recv_dict_t *d;
+
+  pthread_mutex_lock(&recv_dicts_lock);
+  if (recv_dicts != NULL) {
+    while (c_avl_pick(recv_dicts, (void *)&key, (void *)&d) == 0)
+      recv_dict_free(d);
+    c_avl_destroy(recv_dicts);
+    recv_dicts = NULL;
+  }
+  recv_dicts_head = recv_dicts_tail = NULL;
+  recv_dicts_bytes = 0;
+  pthread_mutex_unlock(&recv_dicts_lock);
+} /* }}} void recv_dict_destroy_all */
+
+static int parse_part_dict_entry(void **ret_buffer, /* {{{ */
+                                 size_t *ret_buffer_len,
+                                 const uint64_t *session) {
+  char *buffer = *ret_buffer;
+  size_t buffer_len = *ret_buffer_len;
+
+  uint16_t tmp16;
+  uint32_t tmp32;
+  size_t const header_size = 2 * sizeof(uint16_t) + sizeof(uint32_t);
+
+  uint16_t pkg_length;
+  uint32_t id;
+  size_t str_size;
+
+  recv_dict_t *d;
+  char *str;
+
+  if (buffer_len < header_size)
+    return -1;
+
+  memcpy(&tmp16, buffer + sizeof(tmp16), sizeof(tmp16));
+  pkg_length = ntohs(tmp16);
+  if ((pkg_length <= header_size) || (pkg_length > buffer_len))
+    return -1;
+
+  memcpy(&tmp32, buffer + 2 * sizeof(tmp16), sizeof(tmp32));
+  id = ntohl(tmp32);
+
+  if (buffer[pkg_length - 1] != 0) {
+    WARNING("network plugin: parse_part_dict_entry: "
+            "Received string does not end with a NULL-byte.");
+    return -1;
+  }
+
+  /* Strings are stored and accounted for up to the first null byte. */
+  str_size = strlen(buffer + header_size) + 1;
+
+  *ret_buffer = buffer + pkg_length;
+  *ret_buffer_len = buffer_len - pkg_length;
+
+  /* Without a session, there is nothing the string could be referred to by. */
+  if ((session == NULL) || (id >= NETWORK_DICT_MAX_ENTRIES))
+    return 0;
+
+  str = malloc(str_size);
+  if (str == NULL)
+    return 0;
+  memcpy(str, buffer + header_size, str_size);
+
+  pthread_mutex_lock(&recv_dicts_lock);
+  d = recv_dict_get(*session);
+  if (d != NULL) {
+    size_t new_num = d->strings_num;
+    size_t old_size = 0;
+    size_t grow;
+
+    if (id >= d->strings_num) {
+      if (new_num == 0)
+        new_num = 16;
+      while (new_num <= id)
+        new_num *= 2;
+    } else if (d->strings[id] != NULL)
+      old_size = strlen(d->strings[id]) + 1;
+    grow = (new_num - d->strings_num) * sizeof(*d->strings) + str_size;
+
+    if (recv_dict_make_room(d, (grow > old_size) ? (grow - old_size) : 0) !=
+        0) {
+      static c_complain_t complain_full = C_COMPLAIN_INIT_STATIC;
+      c_complain(LOG_WARNING, &complain_full,
+                 "network plugin: The meta data dictionary of a sender does "
+                 "not fit into `MetaDataMaxMemory'; ignoring some of its "
+                 "strings.");
+      d = NULL;
+    } else if (new_num > d->strings_num) {
+      char **tmp = realloc(d->strings, new_num * sizeof(*tmp));
+      if (tmp == NULL) {
+        d = NULL;
+      } else {
+        memset(tmp + d->strings_num, 0,
+               (new_num - d->strings_num) * sizeof(*tmp));
+        d->strings = tmp;
+        d->strings_num = new_num;
+      }
+    }
+
+    if (d != NULL) {
+      sfree(d->strings[id]);
+      d->strings[id] = str;
+      str = NULL;
+      d->bytes = d->bytes + grow - old_size;
+      recv_dicts_bytes = recv_dicts_bytes + grow - old_size;
+    }
+  }
+  pthread_mutex_unlock(&recv_dicts_lock);
+
+  sfree(str);
+  return 0;
+} /* }}} int parse_part_dict_entry */
+
+/* Decodes a TYPE_META part into "*ret_meta", replacing the meta data which was
+ * in effect before. Entries referring to unknown strings are skipped. */
+static int parse_part_meta(void **ret_buffer, size_t *ret_buffer_len, /* {{{ */
+                           const uint64_t *session, meta_data_t **ret_meta) {
+  char *buffer = *ret_buffer;
+  size_t buffer_len = *ret_buffer_len;
+
+  uint16_t tmp16;
+  size_t const header_size = 2 * sizeof(uint16_t);
+
+  uint16_t pkg_length;
+  uint16_t num;
+  size_t offset;
+
+  recv_dict_t *d;
+  meta_data_t *meta = NULL;
+
+  if (buffer_len < header_size + sizeof(num))
+    return -1;
+
+  memcpy(&tmp16, buffer + sizeof(tmp16), sizeof(tmp16));
+  pkg_length = ntohs(tmp16);
+  if ((pkg_length < header_size + sizeof(num)) || (pkg_length > buffer_len))
+    return -1;
+
+  memcpy(&tmp16, buffer + header_size, sizeof(tmp16));
+  num = ntohs(tmp16);
+  offset = header_size + sizeof(num);
+
+  *ret_buffer = buffer + pkg_length;
+  *ret_buffer_len = buffer_len - pkg_length;
+
+  meta_data_destroy(*ret_meta);
+  *ret_meta = NULL;
+
+  if ((num == 0) || (session == NULL))
+    return 0;
+
+  meta = meta_data_create();
+  if (meta == NULL)
+    return 0;
+
+  pthread_mutex_lock(&recv_dicts_lock);
+  d = recv_dict_get(*session);
+  for (uint16_t i = 0; (d != NULL) && (i < num); i++) {
+    uint32_t tmp32;
+    uint64_t tmp64;
+    uint32_t key_id;
+    uint8_t type;
+    const char *key;
+
+    if ((offset + sizeof(tmp32) + sizeof(type)) > pkg_length)
+      break;
+    memcpy(&tmp32, buffer + offset, sizeof(tmp32));
+    offset += sizeof(tmp32);
+    key_id = ntohl(tmp32);
+    memcpy(&type, buffer + offset, sizeof(type));
+    offset += sizeof(type);
+
+    key = (key_id < d->strings_num) ? d->strings[key_id] : NULL;
+
+    if (type == MD_TYPE_STRING) {
+      const char *value;
+
+      if ((offset + sizeof(tmp32)) > pkg_length)
+        break;
+      memcpy(&tmp32, buffer + offset, sizeof(tmp32));
+      offset += sizeof(tmp32);
+      tmp32 = ntohl(tmp32);
+
+      value = (tmp32 < d->strings_num) ? d->strings[tmp32] : NULL;
+      if ((key != NULL) && (value != NULL))
+        meta_data_add_string(meta, key, value);
+    } else if (type == MD_TYPE_BOOLEAN) {
+      uint8_t value;
+
+      if ((offset + sizeof(value)) > pkg_length)
+        break;
+      memcpy(&value, buffer + offset, sizeof(value));
+      offset += sizeof(value);
+
+      if (key != NULL)
+        meta_data_add_boolean(meta, key, value ? 1 : 0);
+    } else {
+      if ((offset + sizeof(tmp64)) > pkg_length)
+        break;
+      memcpy(&tmp64, buffer + offset, sizeof(tmp64));
+      offset += sizeof(tmp64);
+
+      if (key == NULL)
+        continue;
+
+      if (type == MD_TYPE_SIGNED_INT)
+        meta_data_add_signed_int(meta, key, (int64_t)ntohll(tmp64));
+      else if (type == MD_TYPE_UNSIGNED_INT)
+        meta_data_add_unsigned_int(meta, key, (uint64_t)ntohll(tmp64));
+      else if (type == MD_TYPE_DOUBLE) {
+        double value;
+        memcpy(&value, &tmp64, sizeof(value));
+        meta_data_add_double(meta, key, ntohd(value));
+      } else
+        break;
+    }
+  }
+  pthread_mutex_unlock(&recv_dicts_lock);
+
+  *ret_meta = meta;
+  return 0;
+} /* }}} int parse_part_meta */
+
 /* Forward declaration: parse_part_sign_sha256 and parse_part_encr_aes256 call
  * parse_packet and vice versa. */
 #define PP_SIGNED 0x01
@@ -1215,8 +1760,11 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
   assert(buffer_offset ==
          (username_len + PART_ENCRYPTION_AES256_SIZE - sizeof(pea.hash)));
 
+  /* The cypher handle is shared by all dispatch threads. */
+  pthread_mutex_lock(&se->data.server.cypher_lock);
   cypher = network_get_aes256_cypher(se, pea.iv, sizeof(pea.iv), pea.username);
   if (cypher == NULL) {
+    pthread_mutex_unlock(&se->data.server.cypher_lock);
     ERROR("network plugin: Failed to get cypher. Username: %s", pea.username);
     sfree(pea.username);
     return -1;
@@ -1229,6 +1777,7 @@ static int parse_part_encr_aes256(sockent_t *se, /* {{{ */
   err = gcry_cipher_decrypt(cypher, buffer + buffer_offset,
                             part_size - buffer_offset,
                             /* in = */ NULL, /* in len = */ 0);
+  pthread_mutex_unlock(&se->data.server.cypher_lock);
   if (err != 0) {
     sfree(pea.username);
     ERROR("network plugin: gcry_cipher_decrypt returned: %s. Username: %s",
@@ -1320,6 +1869,10 @@ static int parse_packet(sockent_t *se, /* {{{ */
   value_list_t vl = VALUE_LIST_INIT;
   notification_t n = {0};
 
+  uint64_t dict_session = 0;
+  _Bool have_dict_session = 0;
+  meta_data_t *meta = NULL;
+
 #if HAVE_GCRYPT_H
   int packet_was_signed = (flags & PP_SIGNED);
   int packet_was_encrypted = (flags & PP_ENCRYPTED);
@@ -1399,9 +1952,19 @@ static int parse_packet(sockent_t *se, /* {{{ */
       if (status != 0)
         break;
 
-      network_dispatch_values(&vl, username);
+      network_dispatch_values(&vl, username, meta);
 
       sfree(vl.values);
+    } else if (pkg_type == TYPE_DICT_SESSION) {
+      status = parse_part_number(&buffer, &buffer_size, &dict_session);
+      if (status == 0)
+        have_dict_session = 1;
+    } else if (pkg_type == TYPE_DICT_ENTRY) {
+      status = parse_part_dict_entry(&buffer, &buffer_size,
+                                     have_dict_session ? &dict_session : NULL);
+    } else if (pkg_type == TYPE_META) {
+      status = parse_part_meta(&buffer, &buffer_size,
+                               have_dict_session ? &dict_session : NULL, &meta);
     } else if (pkg_type == TYPE_TIME) {
       uint64_t tmp = 0;
       status = parse_part_number(&buffer, &buffer_size, &tmp);
@@ -1489,6 +2052,8 @@ static int parse_packet(sockent_t *se, /* {{{ */
     }
   } /* while (buffer_size > sizeof (part_header_t)) */
 
+  meta_data_destroy(meta);
+
   if (status == 0 && buffer_size > 0)
     WARNING("network plugin: parse_packet: Received truncated "
             "packet, try increasing `MaxPacketSize'");
@@ -1521,11 +2086,13 @@ static void free_sockent_server(struct sockent_server *ses) /* {{{ */
   }
 
   sfree(ses->fd);
+  sfree(ses->fd_thread);
 #if HAVE_GCRYPT_H
   sfree(ses->auth_file);
   fbh_destroy(ses->userdb);
   if (ses->cypher != NULL)
     gcry_cipher_close(ses->cypher);
+  pthread_mutex_destroy(&ses->cypher_lock);
 #endif
 } /* }}} void free_sockent_server */
 
@@ -1695,8 +2262,21 @@ static int network_set_interface(const sockent_t *se,
   return 0;
 } /* }}} network_set_interface */
 
+static _Bool network_addr_is_multicast(const struct addrinfo *ai) /* {{{ */
+{
+  if (ai->ai_family == AF_INET) {
+    struct sockaddr_in *addr = (struct sockaddr_in *)ai->ai_addr;
+    return IN_MULTICAST(ntohl(addr->sin_addr.s_addr)) ? 1 : 0;
+  } else if (ai->ai_family == AF_INET6) {
+    struct sockaddr_in6 *addr = (struct sockaddr_in6 *)ai->ai_addr;
+    return IN6_IS_ADDR_MULTICAST(&addr->sin6_addr) ? 1 : 0;
+  }
+
+  return 0;
+} /* }}} _Bool network_addr_is_multicast */
+
 static int network_bind_socket(int fd, const struct addrinfo *ai,
-                               const int interface_idx) {
+                               const int interface_idx, _Bool reuse_port) {
 #if KERNEL_SOLARIS
   char loop = 0;
 #else
@@ -1712,6 +2292,20 @@ static int network_bind_socket(int fd, const struct addrinfo *ai,
     return -1;
   }
 
+#ifdef SO_REUSEPORT
+  /* let the kernel balance datagrams across the sockets of all receive
+   * threads */
+  if (reuse_port &&
+      (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == -1)) {
+    char errbuf[1024];
+    ERROR("network plugin: setsockopt (reuseport): %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+#else
+  assert(!reuse_port);
+#endif
+
   DEBUG("fd = %i; calling `bind'", fd);
 
   if (bind(fd, ai->ai_addr, ai->ai_addrlen) == -1) {
@@ -1849,12 +2443,14 @@ static sockent_t *sockent_create(int type) /* {{{ */
 
   if (type == SOCKENT_TYPE_SERVER) {
     se->data.server.fd = NULL;
+    se->data.server.fd_thread = NULL;
     se->data.server.fd_num = 0;
 #if HAVE_GCRYPT_H
     se->data.server.security_level = SECURITY_LEVEL_NONE;
     se->data.server.auth_file = NULL;
     se->data.server.userdb = NULL;
     se->data.server.cypher = NULL;
+    pthread_mutex_init(&se->data.server.cypher_lock, /* attr = */ NULL);
 #endif
   } else {
     se->data.client.fd = -1;
@@ -2070,34 +2666,55 @@ static int sockent_server_listen(sockent_t *se) /* {{{ */
 
   for (struct addrinfo *ai_ptr = ai_list; ai_ptr != NULL;
        ai_ptr = ai_ptr->ai_next) {
-    int *tmp;
+    /* Open one socket per receive thread if the kernel can balance the
+     * datagrams between them. Multicast datagrams are delivered to every
+     * socket of a SO_REUSEPORT group, so those sockets are shared instead. */
+    size_t copies = 1;
+#ifdef SO_REUSEPORT
+    if (!network_addr_is_multicast(ai_ptr))
+      copies = network_config_receive_threads;
+#endif
 
-    tmp = realloc(se->data.server.fd,
-                  sizeof(*tmp) * (se->data.server.fd_num + 1));
-    if (tmp == NULL) {
-      ERROR("network plugin: realloc failed.");
-      continue;
-    }
-    se->data.server.fd = tmp;
-    tmp = se->data.server.fd + se->data.server.fd_num;
+    for (size_t i = 0; i < copies; i++) {
+      int *tmp;
+      int fd;
 
-    *tmp = socket(ai_ptr->ai_family, ai_ptr->ai_socktype, ai_ptr->ai_protocol);
-    if (*tmp < 0) {
-      char errbuf[1024];
-      ERROR("network plugin: socket(2) failed: %s",
-            sstrerror(errno, errbuf, sizeof(errbuf)));
-      continue;
-    }
+      tmp = realloc(se->data.server.fd,
+                    sizeof(*tmp) * (se->data.server.fd_num + 1));
+      if (tmp == NULL) {
+        ERROR("network plugin: realloc failed.");
+        break;
+      }
+      se->data.server.fd = tmp;
 
-    status = network_bind_socket(*tmp, ai_ptr, se->interface);
-    if (status != 0) {
-      close(*tmp);
-      *tmp = -1;
-      continue;
-    }
+      tmp = realloc(se->data.server.fd_thread,
+                    sizeof(*tmp) * (se->data.server.fd_num + 1));
+      if (tmp == NULL) {
+        ERROR("network plugin: realloc failed.");
+        break;
+      }
+      se->data.server.fd_thread = tmp;
+
+      fd = socket(ai_ptr->ai_family, ai_ptr->ai_socktype, ai_ptr->ai_protocol);
+      if (fd < 0) {
+        char errbuf[1024];
+        ERROR("network plugin: socket(2) failed: %s",
+              sstrerror(errno, errbuf, sizeof(errbuf)));
+        break;
+      }
+
+      status = network_bind_socket(fd, ai_ptr, se->interface,
+                                   /* reuse_port = */ (copies > 1));
+      if (status != 0) {
+        close(fd);
+        break;
+      }
 
-    se->data.server.fd_num++;
-    continue;
+      se->data.server.fd[se->data.server.fd_num] = fd;
+      se->data.server.fd_thread[se->data.server.fd_num] =
+          (copies > 1) ? (int)i : -1;
+      se->data.server.fd_num++;
+    }
   } /* for (ai_list) */
 
   freeaddrinfo(ai_list);
@@ -2107,6 +2724,29 @@ static int sockent_server_listen(sockent_t *se) /* {{{ */
   return 0;
 } /* }}} int sockent_server_listen */
 
+static int receive_thread_add_fd(receive_thread_t *rt, int fd, /* {{{ */
+                                 sockent_t *se) {
+  struct pollfd *tmp_pollfd;
+  sockent_t **tmp_se;
+
+  tmp_pollfd = realloc(rt->pollfd, sizeof(*tmp_pollfd) * (rt->pollfd_num + 1));
+  if (tmp_pollfd == NULL)
+    return ENOMEM;
+  rt->pollfd = tmp_pollfd;
+
+  tmp_se = realloc(rt->pollfd_se, sizeof(*tmp_se) * (rt->pollfd_num + 1));
+  if (tmp_se == NULL)
+    return ENOMEM;
+  rt->pollfd_se = tmp_se;
+
+  rt->pollfd[rt->pollfd_num] = (struct pollfd){
+      .fd = fd, .events = POLLIN | POLLPRI, .revents = 0};
+  rt->pollfd_se[rt->pollfd_num] = se;
+  rt->pollfd_num++;
+
+  return 0;
+} /* }}} int receive_thread_add_fd */
+
 /* Add a sockent to the global list of sockets */
 static int sockent_add(sockent_t *se) /* {{{ */
 {
@@ -2116,22 +2756,29 @@ static int sockent_add(sockent_t *se) /* {{{ */
     return -1;
 
   if (se->type == SOCKENT_TYPE_SERVER) {
-    struct pollfd *tmp;
-
-    tmp = realloc(listen_sockets_pollfd,
-                  sizeof(*tmp) * (listen_sockets_num + se->data.server.fd_num));
-    if (tmp == NULL) {
-      ERROR("network plugin: realloc failed.");
-      return -1;
+    if (receive_threads == NULL) {
+      receive_threads =
+          calloc(network_config_receive_threads, sizeof(*receive_threads));
+      if (receive_threads == NULL) {
+        ERROR("network plugin: calloc failed.");
+        return -1;
+      }
+      receive_threads_num = network_config_receive_threads;
     }
-    listen_sockets_pollfd = tmp;
-    tmp = listen_sockets_pollfd + listen_sockets_num;
 
     for (size_t i = 0; i < se->data.server.fd_num; i++) {
-      memset(tmp + i, 0, sizeof(*tmp));
-      tmp[i].fd = se->data.server.fd[i];
-      tmp[i].events = POLLIN | POLLPRI;
-      tmp[i].revents = 0;
+      int fd = se->data.server.fd[i];
+      int thread = se->data.server.fd_thread[i];
+
+      for (size_t j = 0; j < receive_threads_num; j++) {
+        if ((thread >= 0) && ((size_t)thread != j))
+          continue;
+
+        if (receive_thread_add_fd(receive_threads + j, fd, se) != 0) {
+          ERROR("network plugin: realloc failed.");
+          return -1;
+        }
+      }
     }
 
     listen_sockets_num += se->data.server.fd_num;
@@ -2157,11 +2804,87 @@ static int sockent_add(sockent_t *se) /* {{{ */
   return 0;
 } /* }}} int sockent_add */
 
+static void receive_entry_free(receive_list_entry_t *ent) /* {{{ */
+{
+  if (ent == NULL)
+    return;
+
+  sfree(ent->data);
+  sfree(ent);
+} /* }}} void receive_entry_free */
+
+/* Fills `ents' with `num' entries, taken from the pool if possible. Returns the
+ * number of entries that could be provided. */
+static size_t receive_pool_get(receive_list_entry_t **ents, /* {{{ */
+                               size_t num) {
+  size_t have = 0;
+
+  pthread_mutex_lock(&receive_pool_lock);
+  while ((have < num) && (receive_pool_head != NULL)) {
+    ents[have] = receive_pool_head;
+    receive_pool_head = receive_pool_head->next;
+    receive_pool_length--;
+    have++;
+  }
+  pthread_mutex_unlock(&receive_pool_lock);
+
+  for (; have < num; have++) {
+    receive_list_entry_t *ent = calloc(1, sizeof(*ent));
+    if (ent == NULL) {
+      ERROR("network plugin: calloc failed.");
+      break;
+    }
+
+    ent->data = malloc(network_config_packet_size);
+    if (ent->data == NULL) {
+      ERROR("network plugin: malloc failed.");
+      sfree(ent);
+      break;
+    }
+
+    ents[have] = ent;
+  }
+
+  for (size_t i = 0; i < have; i++) {
+    ents[i]->data_len = 0;
+    ents[i]->se = NULL;
+    ents[i]->next = NULL;
+  }
+
+  return have;
+} /* }}} size_t receive_pool_get */
+
+static void receive_pool_put(receive_list_entry_t *ent) /* {{{ */
+{
+  pthread_mutex_lock(&receive_pool_lock);
+  if (receive_pool_length < RECEIVE_POOL_MAX_FREE) {
+    ent->next = receive_pool_head;
+    receive_pool_head = ent;
+    receive_pool_length++;
+    ent = NULL;
+  }
+  pthread_mutex_unlock(&receive_pool_lock);
+
+  /* The pool is full: release the entry. */
+  receive_entry_free(ent);
+} /* }}} void receive_pool_put */
+
+static void receive_pool_destroy(void) /* {{{ */
+{
+  pthread_mutex_lock(&receive_pool_lock);
+  while (receive_pool_head != NULL) {
+    receive_list_entry_t *next = receive_pool_head->next;
+    receive_entry_free(receive_pool_head);
+    receive_pool_head = next;
+  }
+  receive_pool_length = 0;
+  pthread_mutex_unlock(&receive_pool_lock);
+} /* }}} void receive_pool_destroy */
+
 static void *dispatch_thread(void __attribute__((unused)) * arg) /* {{{ */
 {
   while (42) {
     receive_list_entry_t *ent;
-    sockent_t *se;
 
     /* Lock and wait for more data to come in */
     pthread_mutex_lock(&receive_list_lock);
@@ -2170,9 +2893,10 @@ static void *dispatch_thread(void __attribute__((unused)) * arg) /* {{{ */
 
     /* Remove the head entry and unlock */
     ent = receive_list_head;
-    if (ent != NULL)
+    if (ent != NULL) {
       receive_list_head = ent->next;
-    receive_list_length--;
+      receive_list_length--;
+    }
     pthread_mutex_unlock(&receive_list_lock);
 
     /* Check whether we are supposed to exit. We do NOT check `listen_loop'
@@ -2180,58 +2904,98 @@ static void *dispatch_thread(void __attribute__((unused)) * arg) /* {{{ */
     if (ent == NULL)
       break;
 
-    /* Look for the correct `sockent_t' */
-    se = listen_sockets;
-    while (se != NULL) {
-      size_t i;
+    parse_packet(ent->se, ent->data, ent->data_len, /* flags = */ 0,
+                 /* username = */ NULL);
+    receive_pool_put(ent);
+  } /* while (42) */
 
-      for (i = 0; i < se->data.server.fd_num; i++)
-        if (se->data.server.fd[i] == ent->fd)
-          break;
+  return NULL;
+} /* }}} void *dispatch_thread */
 
-      if (i < se->data.server.fd_num)
-        break;
+/* Reads up to `num' datagrams from `fd' into the buffers of `ents' without
+ * blocking. Returns the number of datagrams read or -1 on error. */
+#if HAVE_RECVMMSG
+static int network_recv_batch(int fd, receive_list_entry_t **ents, /* {{{ */
+                              struct mmsghdr *msgs, struct iovec *iovs,
+                              size_t num) {
+  int status;
 
-      se = se->next;
-    }
+  for (size_t i = 0; i < num; i++) {
+    iovs[i].iov_base = ents[i]->data;
+    iovs[i].iov_len = network_config_packet_size;
 
-    if (se == NULL) {
-      ERROR("network plugin: Got packet from FD %i, but can't "
-            "find an appropriate socket entry.",
-            ent->fd);
-      sfree(ent->data);
-      sfree(ent);
-      continue;
+    memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  status = recvmmsg(fd, msgs, (unsigned int)num, MSG_DONTWAIT,
+                    /* timeout = */ NULL);
+  if (status < 0) {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+      return 0;
+    return -1;
+  }
+
+  for (int i = 0; i < status; i++)
+    ents[i]->data_len = (int)msgs[i].msg_len;
+
+  return status;
+} /* }}} int network_recv_batch */
+#else  /* if !HAVE_RECVMMSG */
+static int network_recv_batch(int fd, receive_list_entry_t **ents, /* {{{ */
+                              size_t num) {
+  size_t i;
+
+  for (i = 0; i < num; i++) {
+    ssize_t len;
+
+    len = recv(fd, ents[i]->data, network_config_packet_size, MSG_DONTWAIT);
+    if (len < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+        break;
+      return (i > 0) ? (int)i : -1;
     }
 
-    parse_packet(se, ent->data, ent->data_len, /* flags = */ 0,
-                 /* username = */ NULL);
-    sfree(ent->data);
-    sfree(ent);
-  } /* while (42) */
+    ents[i]->data_len = (int)len;
+  }
 
-  return NULL;
-} /* }}} void *dispatch_thread */
+  return (int)i;
+} /* }}} int network_recv_batch */
+#endif /* !HAVE_RECVMMSG */
 
-static int network_receive(void) /* {{{ */
+static int network_receive(receive_thread_t *rt) /* {{{ */
 {
-  char buffer[network_config_packet_size];
-  int buffer_len;
+  size_t batch_size = network_config_receive_batch;
+  receive_list_entry_t *batch[batch_size];
+#if HAVE_RECVMMSG
+  struct mmsghdr msgs[batch_size];
+  struct iovec iovs[batch_size];
+#endif
 
+  _Bool batch_valid = 1;
   int status = 0;
 
   receive_list_entry_t *private_list_head;
   receive_list_entry_t *private_list_tail;
   uint64_t private_list_length;
 
-  assert(listen_sockets_num > 0);
+  assert(rt->pollfd_num > 0);
 
   private_list_head = NULL;
   private_list_tail = NULL;
   private_list_length = 0;
 
+  size_t have = receive_pool_get(batch, batch_size);
+  if (have != batch_size) {
+    ERROR("network plugin: Allocating the receive buffers failed.");
+    for (size_t i = 0; i < have; i++)
+      receive_entry_free(batch[i]);
+    return ENOMEM;
+  }
+
   while (listen_loop == 0) {
-    status = poll(listen_sockets_pollfd, listen_sockets_num, -1);
+    status = poll(rt->pollfd, rt->pollfd_num, -1);
     if (status <= 0) {
       char errbuf[1024];
       if (errno == EINTR)
@@ -2241,16 +3005,21 @@ static int network_receive(void) /* {{{ */
       break;
     }
 
-    for (size_t i = 0; (i < listen_sockets_num) && (status > 0); i++) {
-      receive_list_entry_t *ent;
+    for (size_t i = 0; (i < rt->pollfd_num) && (status > 0); i++) {
+      uint64_t octets = 0;
+      int received;
 
-      if ((listen_sockets_pollfd[i].revents & (POLLIN | POLLPRI)) == 0)
+      if ((rt->pollfd[i].revents & (POLLIN | POLLPRI)) == 0)
         continue;
       status--;
 
-      buffer_len = recv(listen_sockets_pollfd[i].fd, buffer, sizeof(buffer),
-                        0 /* no flags */);
-      if (buffer_len < 0) {
+#if HAVE_RECVMMSG
+      received =
+          network_recv_batch(rt->pollfd[i].fd, batch, msgs, iovs, batch_size);
+#else
+      received = network_recv_batch(rt->pollfd[i].fd, batch, batch_size);
+#endif
+      if (received < 0) {
         char errbuf[1024];
         status = (errno != 0) ? errno : -1;
         ERROR("network plugin: recv(2) failed: %s",
@@ -2258,39 +3027,41 @@ static int network_receive(void) /* {{{ */
         break;
       }
 
-      stats_octets_rx += ((uint64_t)buffer_len);
-      stats_packets_rx++;
+      /* The packets are read directly into the buffers of pooled entries, so
+       * they can be handed to the dispatch threads without copying. */
+      for (int j = 0; j < received; j++) {
+        receive_list_entry_t *ent = batch[j];
 
-      /* TODO: Possible performance enhancement: Do not free
-       * these entries in the dispatch thread but put them in
-       * another list, so we don't have to allocate more and
-       * more of these structures. */
-      ent = calloc(1, sizeof(*ent));
-      if (ent == NULL) {
-        ERROR("network plugin: calloc failed.");
-        status = ENOMEM;
-        break;
+        ent->se = rt->pollfd_se[i];
+        octets += (uint64_t)ent->data_len;
+
+        if (private_list_head == NULL)
+          private_list_head = ent;
+        else
+          private_list_tail->next = ent;
+        private_list_tail = ent;
+        private_list_length++;
       }
 
-      ent->data = malloc(network_config_packet_size);
-      if (ent->data == NULL) {
-        sfree(ent);
-        ERROR("network plugin: malloc failed.");
+      if (received == 0)
+        continue;
+
+      pthread_mutex_lock(&stats_lock);
+      stats_octets_rx += octets;
+      stats_packets_rx += (uint64_t)received;
+      pthread_mutex_unlock(&stats_lock);
+
+      /* Replace the entries that were used up. */
+      size_t refilled = receive_pool_get(batch, (size_t)received);
+      if (refilled != (size_t)received) {
+        for (size_t j = 0; j < refilled; j++)
+          receive_entry_free(batch[j]);
+        for (size_t j = (size_t)received; j < batch_size; j++)
+          receive_entry_free(batch[j]);
+        batch_valid = 0;
         status = ENOMEM;
         break;
       }
-      ent->fd = listen_sockets_pollfd[i].fd;
-      ent->next = NULL;
-
-      memcpy(ent->data, buffer, buffer_len);
-      ent->data_len = buffer_len;
-
-      if (private_list_head == NULL)
-        private_list_head = ent;
-      else
-        private_list_tail->next = ent;
-      private_list_tail = ent;
-      private_list_length++;
 
       /* Do not block here. Blocking here has led to
        * insufficient performance in the past. */
@@ -2305,7 +3076,10 @@ static int network_receive(void) /* {{{ */
         receive_list_tail = private_list_tail;
         receive_list_length += private_list_length;
 
-        pthread_cond_signal(&receive_list_cond);
+        if (private_list_length > 1)
+          pthread_cond_broadcast(&receive_list_cond);
+        else
+          pthread_cond_signal(&receive_list_cond);
         pthread_mutex_unlock(&receive_list_lock);
 
         private_list_head = NULL;
@@ -2314,7 +3088,7 @@ static int network_receive(void) /* {{{ */
       }
 
       status = 0;
-    } /* for (listen_sockets_pollfd) */
+    } /* for (rt->pollfd) */
 
     if (status != 0)
       break;
@@ -2331,15 +3105,20 @@ static int network_receive(void) /* {{{ */
     receive_list_tail = private_list_tail;
     receive_list_length += private_list_length;
 
-    pthread_cond_signal(&receive_list_cond);
+    pthread_cond_broadcast(&receive_list_cond);
     pthread_mutex_unlock(&receive_list_lock);
   }
 
+  /* Entries which have not been filled are not needed anymore. */
+  if (batch_valid)
+    for (size_t i = 0; i < batch_size; i++)
+      receive_entry_free(batch[i]);
+
   return status;
 } /* }}} int network_receive */
 
-static void *receive_thread(void __attribute__((unused)) * arg) {
-  return network_receive() ? (void *)1 : (void *)0;
+static void *receive_thread(void *arg) {
+  return network_receive(arg) ? (void *)1 : (void *)0;
 } /* void *receive_thread */
 
 static void network_init_buffer(void) {
@@ -2349,6 +3128,9 @@ static void network_init_buffer(void) {
   send_buffer_last_update = 0;
 
   memset(&send_buffer_vl, 0, sizeof(send_buffer_vl));
+
+  send_buffer_have_session = 0;
+  send_buffer_meta_len = 0;
 } /* int network_init_buffer */
 
 static void network_send_buffer_plain(sockent_t *se, /* {{{ */
@@ -2547,9 +3329,234 @@ static void network_send_buffer(char *buffer, size_t buffer_len) /* {{{ */
   } /* for (sending_sockets) */
 } /* }}} void network_send_buffer */
 
+static void send_dict_reset(void) /* {{{ */
+{
+  char *key;
+  send_dict_entry_t *ent;
+
+  if (send_dict != NULL) {
+    while (c_avl_pick(send_dict, (void *)&key, (void *)&ent) == 0) {
+      sfree(key);
+      sfree(ent);
+    }
+  } else {
+    send_dict = c_avl_create((int (*)(const void *, const void *))strcmp);
+  }
+
+  send_dict_session = (((uint64_t)cdrand_u()) << 32) | ((uint64_t)cdrand_u());
+  send_dict_next_id = 0;
+
+  /* The current packet refers to the old session: start a new one and make
+   * sure the meta data is sent again. */
+  send_buffer_have_session = 0;
+  send_buffer_meta_len = SIZE_MAX;
+} /* }}} void send_dict_reset */
+
+static send_dict_entry_t *send_dict_lookup(const char *str) /* {{{ */
+{
+  send_dict_entry_t *ent = NULL;
+  char *key;
+
+  if (c_avl_get(send_dict, str, (void *)&ent) == 0)
+    return ent;
+
+  key = strdup(str);
+  ent = calloc(1, sizeof(*ent));
+  if ((key == NULL) || (ent == NULL)) {
+    sfree(key);
+    sfree(ent);
+    return NULL;
+  }
+  ent->id = send_dict_next_id;
+
+  if (c_avl_insert(send_dict, key, ent) != 0) {
+    sfree(key);
+    sfree(ent);
+    return NULL;
+  }
+  send_dict_next_id++;
+
+  return ent;
+} /* }}} send_dict_entry_t *send_dict_lookup */
+
+/* Adds "ent" to the strings which need to be (re-)defined in this packet. */
+static void send_dict_need(send_dict_entry_t *ent, const char *str, /* {{{ */
+                           cdtime_t now, send_dict_entry_t **defs,
+                           const char **defs_str, size_t *defs_num) {
+  if ((ent->last_sent != 0) &&
+      ((now - ent->last_sent) < network_config_meta_refresh))
+    return;
+
+  for (size_t i = 0; i < *defs_num; i++)
+    if (defs[i] == ent)
+      return;
+
+  defs[*defs_num] = ent;
+  defs_str[*defs_num] = str;
+  (*defs_num)++;
+} /* }}} void send_dict_need */
+
+/* Writes the meta data of "vl" as TYPE_META part, preceded by the definitions
+ * of all strings the receiver may not know yet. Meta data used internally by
+ * the network plugin is not sent. */
+static int add_meta_to_buffer(char **ret_buffer, /* {{{ */
+                              size_t *ret_buffer_size, const value_list_t *vl) {
+  char **toc = NULL;
+  int toc_num = 0;
+  char payload[network_config_packet_size];
+  size_t payload_len = 0;
+  uint16_t num = 0;
+  cdtime_t now = cdtime();
+  int status = 0;
+
+  if (vl->meta != NULL)
+    toc_num = meta_data_toc(vl->meta, &toc);
+  if (toc_num < 0)
+    toc_num = 0;
+
+  /* Every entry needs at most two new strings. */
+  if ((send_dict_next_id + 2 * (size_t)toc_num) > NETWORK_DICT_MAX_ENTRIES)
+    send_dict_reset();
+
+  send_dict_entry_t *defs[2 * toc_num + 1];
+  const char *defs_str[2 * toc_num + 1];
+  char *values[toc_num + 1];
+  size_t defs_num = 0;
+  size_t values_num = 0;
+
+  payload_len = sizeof(num);
+  for (int i = 0; i < toc_num; i++) {
+    send_dict_entry_t *key_ent;
+    int type;
+    uint8_t type8;
+    uint32_t tmp32;
+    uint64_t tmp64;
+    size_t value_size;
+
+    if (strncmp("network:", toc[i], strlen("network:")) == 0)
+      continue;
+
+    type = meta_data_type(vl->meta, toc[i]);
+    value_size = (type == MD_TYPE_STRING)
+                     ? sizeof(tmp32)
+                     : (type == MD_TYPE_BOOLEAN) ? 1 : sizeof(tmp64);
+    if ((payload_len + sizeof(tmp32) + sizeof(type8) + value_size) >
+        sizeof(payload))
+      break;
+
+    key_ent = send_dict_lookup(toc[i]);
+    if (key_ent == NULL)
+      continue;
+
+    if (type == MD_TYPE_STRING) {
+      send_dict_entry_t *value_ent;
+      char *value = NULL;
+
+      if (meta_data_get_string(vl->meta, toc[i], &value) != 0)
+        continue;
+      values[values_num++] = value;
+
+      value_ent = send_dict_lookup(value);
+      if (value_ent == NULL)
+        continue;
+      send_dict_need(value_ent, value, now, defs, defs_str, &defs_num);
+      tmp32 = htonl(value_ent->id);
+      memcpy(payload + payload_len + sizeof(tmp32) + sizeof(type8), &tmp32,
+             sizeof(tmp32));
+    } else if (type == MD_TYPE_BOOLEAN) {
+      _Bool value = 0;
+      uint8_t value8;
+
+      meta_data_get_boolean(vl->meta, toc[i], &value);
+      value8 = value ? 1 : 0;
+      memcpy(payload + payload_len + sizeof(tmp32) + sizeof(type8), &value8,
+             sizeof(value8));
+    } else if (type == MD_TYPE_SIGNED_INT) {
+      int64_t value = 0;
+
+      meta_data_get_signed_int(vl->meta, toc[i], &value);
+      tmp64 = htonll((uint64_t)value);
+      memcpy(payload + payload_len + sizeof(tmp32) + sizeof(type8), &tmp64,
+             sizeof(tmp64));
+    } else if (type == MD_TYPE_UNSIGNED_INT) {
+      uint64_t value = 0;
+
+      meta_data_get_unsigned_int(vl->meta, toc[i], &value);
+      tmp64 = htonll(value);
+      memcpy(payload + payload_len + sizeof(tmp32) + sizeof(type8), &tmp64,
+             sizeof(tmp64));
+    } else if (type == MD_TYPE_DOUBLE) {
+      double value = 0.0;
+
+      meta_data_get_double(vl->meta, toc[i], &value);
+      value = htond(value);
+      memcpy(payload + payload_len + sizeof(tmp32) + sizeof(type8), &value,
+             sizeof(value));
+    } else {
+      continue;
+    }
+
+    send_dict_need(key_ent, toc[i], now, defs, defs_str, &defs_num);
+    tmp32 = htonl(key_ent->id);
+    type8 = (uint8_t)type;
+    memcpy(payload + payload_len, &tmp32, sizeof(tmp32));
+    memcpy(payload + payload_len + sizeof(tmp32), &type8, sizeof(type8));
+    payload_len += sizeof(tmp32) + sizeof(type8) + value_size;
+    num++;
+  }
+
+  if (num == 0)
+    payload_len = 0;
+  else {
+    uint16_t tmp16 = htons(num);
+    memcpy(payload, &tmp16, sizeof(tmp16));
+  }
+
+  /* The meta data is in effect until the next TYPE_META part. */
+  if ((payload_len == send_buffer_meta_len) &&
+      ((payload_len == 0) ||
+       (memcmp(payload, send_buffer_meta, payload_len) == 0)))
+    goto out;
+
+  if ((payload_len != 0) && !send_buffer_have_session) {
+    status = write_part_number(ret_buffer, ret_buffer_size, TYPE_DICT_SESSION,
+                               send_dict_session);
+    if (status != 0)
+      goto out;
+    send_buffer_have_session = 1;
+  }
+
+  for (size_t i = 0; i < defs_num; i++) {
+    status = write_part_dict_entry(ret_buffer, ret_buffer_size, defs[i]->id,
+                                   defs_str[i], strlen(defs_str[i]));
+    if (status != 0)
+      goto out;
+  }
+
+  status = write_part_meta(ret_buffer, ret_buffer_size, payload, payload_len);
+  if (status != 0)
+    goto out;
+
+  /* Only now the definitions are known to be part of the packet. */
+  for (size_t i = 0; i < defs_num; i++)
+    defs[i]->last_sent = now;
+
+  memcpy(send_buffer_meta, payload, payload_len);
+  send_buffer_meta_len = payload_len;
+
+out:
+  for (size_t i = 0; i < values_num; i++)
+    sfree(values[i]);
+  for (int i = 0; i < toc_num; i++)
+    sfree(toc[i]);
+  sfree(toc);
+
+  return status;
+} /* }}} int add_meta_to_buffer */
+
 static int add_to_buffer(char *buffer, size_t buffer_size, /* {{{ */
                          value_list_t *vl_def, const data_set_t *ds,
-                         const value_list_t *vl) {
+                         const value_list_t *vl, _Bool with_meta) {
   char *buffer_orig = buffer;
 
   if (strcmp(vl_def->host, vl->host) != 0) {
@@ -2604,6 +3611,9 @@ static int add_to_buffer(char *buffer, size_t buffer_size, /* {{{ */
              sizeof(vl_def->type_instance));
   }
 
+  if (with_meta && (add_meta_to_buffer(&buffer, &buffer_size, vl) != 0))
+    return -1;
+
   if (write_part_values(&buffer, &buffer_size, ds, vl) != 0)
     return -1;
 
@@ -2655,7 +3665,7 @@ static int network_write(const data_set_t *ds, const value_list_t *vl,
   status = add_to_buffer(send_buffer_ptr,
                          network_config_packet_size -
                              (send_buffer_fill + BUFF_SIG_SIZE),
-                         &send_buffer_vl, ds, vl);
+                         &send_buffer_vl, ds, vl, network_config_send_meta);
   if (status >= 0) {
     /* status == bytes added to the buffer */
     send_buffer_fill += status;
@@ -2669,7 +3679,17 @@ static int network_write(const data_set_t *ds, const value_list_t *vl,
     status = add_to_buffer(send_buffer_ptr,
                            network_config_packet_size -
                                (send_buffer_fill + BUFF_SIG_SIZE),
-                           &send_buffer_vl, ds, vl);
+                           &send_buffer_vl, ds, vl, network_config_send_meta);
+
+    /* The meta data does not fit into an empty packet: send the values
+     * without it. */
+    if ((status < 0) && network_config_send_meta) {
+      network_init_buffer();
+      status = add_to_buffer(send_buffer_ptr,
+                             network_config_packet_size -
+                                 (send_buffer_fill + BUFF_SIG_SIZE),
+                             &send_buffer_vl, ds, vl, /* with_meta = */ 0);
+    }
 
     if (status >= 0) {
       send_buffer_fill += status;
@@ -2735,6 +3755,23 @@ static int network_config_set_buffer_size(const oconfig_item_t *ci) /* {{{ */
   return 0;
 } /* }}} int network_config_set_buffer_size */
 
+static int network_config_set_size(const oconfig_item_t *ci, /* {{{ */
+                                   size_t *ret, int max) {
+  int tmp = 0;
+
+  if (cf_util_get_int(ci, &tmp) != 0)
+    return -1;
+  else if ((tmp >= 1) && (tmp <= max))
+    *ret = (size_t)tmp;
+  else {
+    WARNING("network plugin: The `%s' must be between 1 and %i.", ci->key,
+            max);
+    return -1;
+  }
+
+  return 0;
+} /* }}} int network_config_set_size */
+
 #if HAVE_GCRYPT_H
 static int network_config_set_security_level(oconfig_item_t *ci, /* {{{ */
                                              int *retval) {
@@ -2924,6 +3961,14 @@ static int network_config(oconfig_item_t *ci) /* {{{ */
     oconfig_item_t *child = ci->children + i;
     if (strcasecmp("TimeToLive", child->key) == 0)
       network_config_set_ttl(child);
+    else if (strcasecmp("ReceiveThreads", child->key) == 0) {
+      /* Must be known before the first `Listen' socket is opened. */
+      if (listen_sockets != NULL)
+        WARNING("network plugin: `ReceiveThreads' cannot be changed after "
+                "sockets have been opened.");
+      else
+        network_config_set_size(child, &network_config_receive_threads, 256);
+    }
   }
 
   for (int i = 0; i < ci->children_num; i++) {
@@ -2933,14 +3978,25 @@ static int network_config(oconfig_item_t *ci) /* {{{ */
       network_config_add_listen(child);
     else if (strcasecmp("Server", child->key) == 0)
       network_config_add_server(child);
-    else if (strcasecmp("TimeToLive", child->key) == 0) {
+    else if ((strcasecmp("TimeToLive", child->key) == 0) ||
+             (strcasecmp("ReceiveThreads", child->key) == 0)) {
       /* Handled earlier */
-    } else if (strcasecmp("MaxPacketSize", child->key) == 0)
+    } else if (strcasecmp("DispatchThreads", child->key) == 0)
+      network_config_set_size(child, &network_config_dispatch_threads, 256);
+    else if (strcasecmp("ReceiveBatchSize", child->key) == 0)
+      network_config_set_size(child, &network_config_receive_batch, 1024);
+    else if (strcasecmp("MaxPacketSize", child->key) == 0)
       network_config_set_buffer_size(child);
     else if (strcasecmp("Forward", child->key) == 0)
       cf_util_get_boolean(child, &network_config_forward);
     else if (strcasecmp("ReportStats", child->key) == 0)
       cf_util_get_boolean(child, &network_config_stats);
+    else if (strcasecmp("SendMetaData", child->key) == 0)
+      cf_util_get_boolean(child, &network_config_send_meta);
+    else if (strcasecmp("MetaDataRefreshInterval", child->key) == 0)
+      cf_util_get_cdtime(child, &network_config_meta_refresh);
+    else if (strcasecmp("MetaDataMaxMemory", child->key) == 0)
+      network_config_set_size(child, &network_config_meta_max_memory, 65536);
     else {
       WARNING("network plugin: Option `%s' is not allowed here.", child->key);
     }
@@ -3020,31 +4076,57 @@ static int network_notification(const notification_t *n,
 static int network_shutdown(void) {
   listen_loop++;
 
-  /* Kill the listening thread */
-  if (receive_thread_running != 0) {
-    INFO("network plugin: Stopping receive thread.");
-    pthread_kill(receive_thread_id, SIGTERM);
-    pthread_join(receive_thread_id, NULL /* no return value */);
-    memset(&receive_thread_id, 0, sizeof(receive_thread_id));
-    receive_thread_running = 0;
+  /* Kill the listening threads */
+  for (size_t i = 0; i < receive_threads_num; i++) {
+    receive_thread_t *rt = receive_threads + i;
+
+    if (rt->running) {
+      INFO("network plugin: Stopping receive thread %zu.", i);
+      pthread_kill(rt->id, SIGTERM);
+      pthread_join(rt->id, NULL /* no return value */);
+      memset(&rt->id, 0, sizeof(rt->id));
+      rt->running = 0;
+    }
+
+    sfree(rt->pollfd);
+    sfree(rt->pollfd_se);
+    rt->pollfd_num = 0;
   }
+  sfree(receive_threads);
+  receive_threads_num = 0;
 
-  /* Shutdown the dispatching thread */
-  if (dispatch_thread_running != 0) {
-    INFO("network plugin: Stopping dispatch thread.");
+  /* Shutdown the dispatching threads */
+  if (dispatch_threads_num > 0) {
+    INFO("network plugin: Stopping dispatch threads.");
     pthread_mutex_lock(&receive_list_lock);
     pthread_cond_broadcast(&receive_list_cond);
     pthread_mutex_unlock(&receive_list_lock);
-    pthread_join(dispatch_thread_id, /* ret = */ NULL);
-    dispatch_thread_running = 0;
+    for (size_t i = 0; i < dispatch_threads_num; i++)
+      pthread_join(dispatch_threads[i], /* ret = */ NULL);
   }
+  sfree(dispatch_threads);
+  dispatch_threads_num = 0;
 
+  receive_pool_destroy();
+  recv_dict_destroy_all();
   sockent_destroy(listen_sockets);
 
   if (send_buffer_fill > 0)
     flush_buffer();
 
   sfree(send_buffer);
+  sfree(send_buffer_meta);
+  if (send_dict != NULL) {
+    char *key;
+    send_dict_entry_t *ent;
+
+    while (c_avl_pick(send_dict, (void *)&key, (void *)&ent) == 0) {
+      sfree(key);
+      sfree(ent);
+    }
+    c_avl_destroy(send_dict);
+    send_dict = NULL;
+  }
 
   for (sockent_t *se = sending_sockets; se != NULL; se = se->next)
     sockent_client_disconnect(se);
@@ -3150,6 +4232,19 @@ static int network_init(void) {
   }
   network_init_buffer();
 
+  if (network_config_send_meta) {
+    if (network_config_meta_refresh == 0)
+      network_config_meta_refresh = TIME_T_TO_CDTIME_T(60);
+
+    send_buffer_meta = malloc(network_config_packet_size);
+    if (send_buffer_meta == NULL) {
+      ERROR("network plugin: malloc failed.");
+      return -1;
+    }
+    send_dict_reset();
+    send_buffer_meta_len = 0;
+  }
+
   /* setup socket(s) and so on */
   if (sending_sockets != NULL) {
     plugin_register_write("network", network_write,
@@ -3159,35 +4254,50 @@ static int network_init(void) {
   }
 
   /* If no threads need to be started, return here. */
-  if ((listen_sockets_num == 0) ||
-      ((dispatch_thread_running != 0) && (receive_thread_running != 0)))
+  if ((listen_sockets_num == 0) || (dispatch_threads != NULL))
     return 0;
 
-  if (dispatch_thread_running == 0) {
+  dispatch_threads =
+      calloc(network_config_dispatch_threads, sizeof(*dispatch_threads));
+  if (dispatch_threads == NULL) {
+    ERROR("network plugin: calloc failed.");
+    return -1;
+  }
+
+  for (size_t i = 0; i < network_config_dispatch_threads; i++) {
+    char name[64];
     int status;
-    status = plugin_thread_create(&dispatch_thread_id, NULL /* no attributes */,
-                                  dispatch_thread, NULL /* no argument */,
-                                  "network disp");
+
+    snprintf(name, sizeof(name), "network disp%zu", i);
+    status = plugin_thread_create(dispatch_threads + dispatch_threads_num,
+                                  NULL /* no attributes */, dispatch_thread,
+                                  NULL /* no argument */, name);
     if (status != 0) {
       char errbuf[1024];
       ERROR("network: pthread_create failed: %s",
             sstrerror(errno, errbuf, sizeof(errbuf)));
     } else {
-      dispatch_thread_running = 1;
+      dispatch_threads_num++;
     }
   }
 
-  if (receive_thread_running == 0) {
+  for (size_t i = 0; i < receive_threads_num; i++) {
+    receive_thread_t *rt = receive_threads + i;
+    char name[64];
     int status;
-    status = plugin_thread_create(&receive_thread_id, NULL /* no attributes */,
-                                  receive_thread, NULL /* no argument */,
-                                  "network recv");
+
+    if (rt->pollfd_num == 0)
+      continue;
+
+    snprintf(name, sizeof(name), "network recv%zu", i);
+    status = plugin_thread_create(&rt->id, NULL /* no attributes */,
+                                  receive_thread, rt, name);
     if (status != 0) {
       char errbuf[1024];
       ERROR("network: pthread_create failed: %s",
             sstrerror(errno, errbuf, sizeof(errbuf)));
     } else {
-      receive_thread_running = 1;
+      rt->running = 1;
     }
   }
 
@@ -74,6 +74,11 @@
 #define TYPE_MESSAGE 0x0100
 #define TYPE_SEVERITY 0x0101
 
+/* Types to transmit meta data using a string dictionary */
+#define TYPE_DICT_SESSION 0x0020
+#define TYPE_DICT_ENTRY 0x0021
+#define TYPE_META 0x0022
+
 #define TYPE_SIGN_SHA256 0x0200
 #define TYPE_ENCR_AES256 0x0210
 
@@ -119,6 +119,11 @@ typedef struct {
   udb_query_t **queries;
   size_t queries_num;
 
+  /* Per query: 1 if it has been prepared on the current connection, -1 if
+   * it cannot be prepared (e.g. because it holds more than one command) and
+   * 0 if it has not been prepared yet. */
+  int *q_prepared;
+
   c_psql_writer_t **writers;
   size_t writers_num;
 
@@ -228,6 +233,7 @@ static c_psql_database_t *c_psql_database_new(const char *name) {
   db->max_params_num = 0;
 
   db->q_prep_areas = NULL;
+  db->q_prepared = NULL;
   db->queries = NULL;
   db->queries_num = 0;
 
@@ -281,6 +287,7 @@ static void c_psql_database_delete(void *data) {
     for (size_t i = 0; i < db->queries_num; ++i)
       udb_query_delete_preparation_area(db->q_prep_areas[i]);
   free(db->q_prep_areas);
+  sfree(db->q_prepared);
 
   sfree(db->queries);
   db->queries_num = 0;
@@ -341,6 +348,17 @@ static int c_psql_connect(c_psql_database_t *db) {
   return 0;
 } /* c_psql_connect */
 
+/* Prepared statements are bound to the connection; forget them when it is
+ * re-established. */
+static void c_psql_forget_prepared(c_psql_database_t *db) {
+  if (db->q_prepared == NULL)
+    return;
+
+  for (size_t i = 0; i < db->queries_num; ++i)
+    if (db->q_prepared[i] > 0)
+      db->q_prepared[i] = 0;
+} /* c_psql_forget_prepared */
+
 static int c_psql_check_connection(c_psql_database_t *db) {
   _Bool init = 0;
 
@@ -352,10 +370,12 @@ static int c_psql_check_connection(c_psql_database_t *db) {
       db->conn_complaint.interval = 1;
 
     c_psql_connect(db);
+    c_psql_forget_prepared(db);
   }
 
   if (CONNECTION_OK != PQstatus(db->conn)) {
     PQreset(db->conn);
+    c_psql_forget_prepared(db);
 
     /* trigger c_release() */
     if (0 == db->conn_complaint.interval)
@@ -401,17 +421,39 @@ static PGresult *c_psql_exec_query_noparams(c_psql_database_t *db,
   return PQexec(db->conn, udb_query_get_statement(q));
 } /* c_psql_exec_query_noparams */
 
+/* Prepares the query with index "idx" on the current connection. Queries that
+ * cannot be prepared are run with PQexec / PQexecParams instead. */
+static void c_psql_prepare_query(c_psql_database_t *db, udb_query_t *q,
+                                 size_t idx, int params_num) {
+  char name[32];
+  PGresult *res;
+
+  ssnprintf(name, sizeof(name), "collectd_%zu", idx);
+
+  res = PQprepare(db->conn, name, udb_query_get_statement(q), params_num,
+                  /* param types = */ NULL);
+  if (PGRES_COMMAND_OK == PQresultStatus(res))
+    db->q_prepared[idx] = 1;
+  else if (CONNECTION_OK == PQstatus(db->conn)) {
+    log_info("Cannot prepare query \"%s\", executing it directly: %s",
+             udb_query_get_name(q), PQerrorMessage(db->conn));
+    db->q_prepared[idx] = -1;
+  }
+  /* else: try again once the connection has been re-established */
+
+  PQclear(res);
+} /* c_psql_prepare_query */
+
 static PGresult *c_psql_exec_query_params(c_psql_database_t *db, udb_query_t *q,
-                                          c_psql_user_data_t *data) {
+                                          c_psql_user_data_t *data,
+                                          size_t idx) {
   const char *params[db->max_params_num];
   char interval[64];
+  int params_num = (data != NULL) ? data->params_num : 0;
 
-  if ((data == NULL) || (data->params_num == 0))
-    return c_psql_exec_query_noparams(db, q);
-
-  assert(db->max_params_num >= data->params_num);
+  assert(db->max_params_num >= params_num);
 
-  for (int i = 0; i < data->params_num; ++i) {
+  for (int i = 0; i < params_num; ++i) {
     switch (data->params[i]) {
     case C_PSQL_PARAM_HOST:
       params[i] =
@@ -437,13 +479,28 @@ static PGresult *c_psql_exec_query_params(c_psql_database_t *db, udb_query_t *q,
     }
   }
 
-  return PQexecParams(db->conn, udb_query_get_statement(q), data->params_num,
-                      NULL, (const char *const *)params, NULL, NULL, 0);
+  if (0 == db->q_prepared[idx])
+    c_psql_prepare_query(db, q, idx, params_num);
+
+  if (0 < db->q_prepared[idx]) {
+    char name[32];
+
+    ssnprintf(name, sizeof(name), "collectd_%zu", idx);
+    return PQexecPrepared(db->conn, name, params_num,
+                          (const char *const *)params, NULL, NULL, 0);
+  }
+
+  if (0 == params_num)
+    return c_psql_exec_query_noparams(db, q);
+
+  return PQexecParams(db->conn, udb_query_get_statement(q), params_num, NULL,
+                      (const char *const *)params, NULL, NULL, 0);
 } /* c_psql_exec_query_params */
 
 /* db->db_lock must be locked when calling this function */
 static int c_psql_exec_query(c_psql_database_t *db, udb_query_t *q,
-                             udb_query_preparation_area_t *prep_area) {
+                             udb_query_preparation_area_t *prep_area,
+                             size_t idx) {
   PGresult *res;
 
   c_psql_user_data_t *data;
@@ -462,7 +519,7 @@ static int c_psql_exec_query(c_psql_database_t *db, udb_query_t *q,
 
   /* Versions up to `3' don't know how to handle parameters. */
   if (3 <= db->proto_version)
-    res = c_psql_exec_query_params(db, q, data);
+    res = c_psql_exec_query_params(db, q, data, idx);
   else if ((NULL == data) || (0 == data->params_num))
     res = c_psql_exec_query_noparams(db, q);
   else {
@@ -488,7 +545,18 @@ static int c_psql_exec_query(c_psql_database_t *db, udb_query_t *q,
     if ((CONNECTION_OK != PQstatus(db->conn)) &&
         (0 == c_psql_check_connection(db))) {
       PQclear(res);
-      return c_psql_exec_query(db, q, prep_area);
+      return c_psql_exec_query(db, q, prep_area, idx);
+    }
+
+    /* The prepared statement may have become unusable, e.g. because a
+     * connection pooler sits in between or the schema has changed. */
+    if ((CONNECTION_OK == PQstatus(db->conn)) && (0 < db->q_prepared[idx])) {
+      log_info("Executing prepared query \"%s\" failed, executing it "
+               "directly from now on: %s",
+               udb_query_get_name(q), PQerrorMessage(db->conn));
+      db->q_prepared[idx] = -1;
+      PQclear(res);
+      return c_psql_exec_query(db, q, prep_area, idx);
     }
 
     log_err("Failed to execute SQL query: %s", PQerrorMessage(db->conn));
@@ -609,7 +677,7 @@ static int c_psql_read(user_data_t *ud) {
         (udb_query_check_version(q, db->server_version) <= 0))
       continue;
 
-    if (0 == c_psql_exec_query(db, q, prep_area))
+    if (0 == c_psql_exec_query(db, q, prep_area, i))
       success = 1;
   }
 
@@ -1172,7 +1240,9 @@ static int c_psql_config_database(oconfig_item_t *ci) {
     db->q_prep_areas = (udb_query_preparation_area_t **)calloc(
         db->queries_num, sizeof(*db->q_prep_areas));
 
-    if (db->q_prep_areas == NULL) {
+    db->q_prepared = calloc(db->queries_num, sizeof(*db->q_prepared));
+
+    if ((db->q_prep_areas == NULL) || (db->q_prepared == NULL)) {
       log_err("Out of memory.");
       c_psql_database_delete(db);
       return -1;
@@ -93,6 +93,7 @@
 #ifndef CONFIG_HZ
 #define CONFIG_HZ 100
 #endif
+#include "utils_avltree.h"
 /* #endif KERNEL_LINUX */
 
 #elif HAVE_LIBKVM_GETPROCS &&                                                  \
@@ -194,6 +195,9 @@ typedef struct process_entry_s {
   _Bool has_cswitch;
 
   _Bool has_fd;
+  _Bool has_status;
+
+  unsigned long long starttime;
 } process_entry_t;
 
 typedef struct procstat_entry_s {
@@ -276,6 +280,41 @@ static mach_msg_type_number_t pset_list_len;
 #elif KERNEL_LINUX
 static long pagesize_g;
 static void ps_fill_details(const procstat_t *ps, process_entry_t *entry);
+
+/* State of one process. In incremental mode the entries are kept across
+ * reads, so that /proc/<pid>/stat and status are only parsed again if stat
+ * changed and the groups a process belongs to are only determined once. */
+typedef struct ps_cache_entry_s {
+  long pid;
+  /* hash of /proc/<pid>/stat as of the last read */
+  uint64_t stat_hash;
+  _Bool valid;
+  char state;
+  process_entry_t pse;
+
+  /* groups the process belongs to and its instance in each group */
+  procstat_t **matches;
+  procstat_entry_t **instances;
+  size_t matches_num;
+} ps_cache_entry_t;
+
+#define PS_WORK_CHUNK 64
+
+typedef struct {
+  ps_cache_entry_t **entries;
+  size_t entries_num;
+  size_t next;
+  pthread_mutex_t lock;
+} ps_work_t;
+
+static _Bool ps_incremental = 0;
+static int ps_read_threads = 1;
+static _Bool ps_need_cmdline = 0;
+static size_t ps_groups_num = 0;
+
+static c_avl_tree_t *ps_cache = NULL;
+static ps_cache_entry_t **ps_entries = NULL;
+static size_t ps_entries_size = 0;
 /* #endif KERNEL_LINUX */
 
 #elif HAVE_LIBKVM_GETPROCS &&                                                  \
@@ -431,22 +470,12 @@ static void ps_update_counter(derive_t *group_counter, derive_t *curr_counter,
   *group_counter += curr_value;
 }
 
-/* add process entry to 'instances' of process 'name' (or refresh it) */
-static void ps_list_add(const char *name, const char *cmdline,
-                        process_entry_t *entry) {
-  procstat_entry_t *pse;
-
-  if (entry->id == 0)
-    return;
-
-  for (procstat_t *ps = list_head_g; ps != NULL; ps = ps->next) {
-    if ((ps_list_match(name, cmdline, ps)) == 0)
-      continue;
-
-#if KERNEL_LINUX
-    ps_fill_details(ps, entry);
-#endif
-
+/* add process entry to the instance "pse" of group "ps", or find or create
+ * the instance with the entry's id if "pse" is NULL. Returns the instance. */
+static procstat_entry_t *ps_list_add_entry(procstat_t *ps,
+                                           procstat_entry_t *pse,
+                                           process_entry_t *entry) {
+  if (pse == NULL) {
     for (pse = ps->instances; pse != NULL; pse = pse->next)
       if ((pse->id == entry->id) || (pse->next == NULL))
         break;
@@ -456,7 +485,7 @@ static void ps_list_add(const char *name, const char *cmdline,
 
       new = calloc(1, sizeof(*new));
       if (new == NULL)
-        return;
+        return NULL;
       new->id = entry->id;
 
       if (pse == NULL)
@@ -466,51 +495,70 @@ static void ps_list_add(const char *name, const char *cmdline,
 
       pse = new;
     }
+  }
 
-    pse->age = 0;
+  pse->age = 0;
 
-    ps->num_proc += entry->num_proc;
-    ps->num_lwp += entry->num_lwp;
-    ps->num_fd += entry->num_fd;
-    ps->vmem_size += entry->vmem_size;
-    ps->vmem_rss += entry->vmem_rss;
-    ps->vmem_data += entry->vmem_data;
-    ps->vmem_code += entry->vmem_code;
-    ps->stack_size += entry->stack_size;
+  ps->num_proc += entry->num_proc;
+  ps->num_lwp += entry->num_lwp;
+  ps->num_fd += entry->num_fd;
+  ps->vmem_size += entry->vmem_size;
+  ps->vmem_rss += entry->vmem_rss;
+  ps->vmem_data += entry->vmem_data;
+  ps->vmem_code += entry->vmem_code;
+  ps->stack_size += entry->stack_size;
 
-    if ((entry->io_rchar != -1) && (entry->io_wchar != -1)) {
-      ps_update_counter(&ps->io_rchar, &pse->io_rchar, entry->io_rchar);
-      ps_update_counter(&ps->io_wchar, &pse->io_wchar, entry->io_wchar);
-    }
+  if ((entry->io_rchar != -1) && (entry->io_wchar != -1)) {
+    ps_update_counter(&ps->io_rchar, &pse->io_rchar, entry->io_rchar);
+    ps_update_counter(&ps->io_wchar, &pse->io_wchar, entry->io_wchar);
+  }
 
-    if ((entry->io_syscr != -1) && (entry->io_syscw != -1)) {
-      ps_update_counter(&ps->io_syscr, &pse->io_syscr, entry->io_syscr);
-      ps_update_counter(&ps->io_syscw, &pse->io_syscw, entry->io_syscw);
-    }
+  if ((entry->io_syscr != -1) && (entry->io_syscw != -1)) {
+    ps_update_counter(&ps->io_syscr, &pse->io_syscr, entry->io_syscr);
+    ps_update_counter(&ps->io_syscw, &pse->io_syscw, entry->io_syscw);
+  }
 
-    if ((entry->io_diskr != -1) && (entry->io_diskw != -1)) {
-      ps_update_counter(&ps->io_diskr, &pse->io_diskr, entry->io_diskr);
-      ps_update_counter(&ps->io_diskw, &pse->io_diskw, entry->io_diskw);
-    }
+  if ((entry->io_diskr != -1) && (entry->io_diskw != -1)) {
+    ps_update_counter(&ps->io_diskr, &pse->io_diskr, entry->io_diskr);
+    ps_update_counter(&ps->io_diskw, &pse->io_diskw, entry->io_diskw);
+  }
 
-    if ((entry->cswitch_vol != -1) && (entry->cswitch_vol != -1)) {
-      ps_update_counter(&ps->cswitch_vol, &pse->cswitch_vol,
-                        entry->cswitch_vol);
-      ps_update_counter(&ps->cswitch_invol, &pse->cswitch_invol,
-                        entry->cswitch_invol);
-    }
+  if ((entry->cswitch_vol != -1) && (entry->cswitch_vol != -1)) {
+    ps_update_counter(&ps->cswitch_vol, &pse->cswitch_vol,
+                      entry->cswitch_vol);
+    ps_update_counter(&ps->cswitch_invol, &pse->cswitch_invol,
+                      entry->cswitch_invol);
+  }
+
+  ps_update_counter(&ps->vmem_minflt_counter, &pse->vmem_minflt_counter,
+                    entry->vmem_minflt_counter);
+  ps_update_counter(&ps->vmem_majflt_counter, &pse->vmem_majflt_counter,
+                    entry->vmem_majflt_counter);
 
-    ps_update_counter(&ps->vmem_minflt_counter, &pse->vmem_minflt_counter,
-                      entry->vmem_minflt_counter);
-    ps_update_counter(&ps->vmem_majflt_counter, &pse->vmem_majflt_counter,
-                      entry->vmem_majflt_counter);
+  ps_update_counter(&ps->cpu_user_counter, &pse->cpu_user_counter,
+                    entry->cpu_user_counter);
+  ps_update_counter(&ps->cpu_system_counter, &pse->cpu_system_counter,
+                    entry->cpu_system_counter);
+
+  return pse;
+} /* procstat_entry_t *ps_list_add_entry */
+
+#if !KERNEL_LINUX
+/* add process entry to 'instances' of process 'name' (or refresh it) */
+static void ps_list_add(const char *name, const char *cmdline,
+                        process_entry_t *entry) {
+  if (entry->id == 0)
+    return;
+
+  for (procstat_t *ps = list_head_g; ps != NULL; ps = ps->next) {
+    if ((ps_list_match(name, cmdline, ps)) == 0)
+      continue;
 
-    ps_update_counter(&ps->cpu_user_counter, &pse->cpu_user_counter,
-                      entry->cpu_user_counter);
-    ps_update_counter(&ps->cpu_system_counter, &pse->cpu_system_counter,
-                      entry->cpu_system_counter);
+    if (ps_list_add_entry(ps, NULL, entry) == NULL)
+      return;
   }
 }
+#endif /* !KERNEL_LINUX */
 
 /* remove old entries from instances of processes in list_head_g */
 static void ps_list_reset(void) {
@@ -619,6 +667,17 @@ static int ps_config(oconfig_item_t *ci) {
       cf_util_get_boolean(c, &report_ctx_switch);
     } else if (strcasecmp(c->key, "CollectFileDescriptor") == 0) {
       cf_util_get_boolean(c, &report_fd_num);
+#if KERNEL_LINUX
+    } else if (strcasecmp(c->key, "Incremental") == 0) {
+      cf_util_get_boolean(c, &ps_incremental);
+    } else if (strcasecmp(c->key, "ReadThreads") == 0) {
+      if (cf_util_get_int(c, &ps_read_threads) != 0)
+        continue;
+      if (ps_read_threads < 1) {
+        WARNING("processes plugin: `ReadThreads' must be at least 1.");
+        ps_read_threads = 1;
+      }
+#endif
     } else {
       ERROR("processes plugin: The `%s' configuration option is not "
             "understood and will be ignored.",
@@ -656,6 +715,17 @@ static int ps_init(void) {
 #elif KERNEL_LINUX
   pagesize_g = sysconf(_SC_PAGESIZE);
   DEBUG("pagesize_g = %li; CONFIG_HZ = %i;", pagesize_g, CONFIG_HZ);
+
+  /* The command line is only needed to match against regular expressions. */
+  ps_groups_num = 0;
+  ps_need_cmdline = 0;
+  for (procstat_t *ps = list_head_g; ps != NULL; ps = ps->next) {
+    ps_groups_num++;
+#if HAVE_REGEX_H
+    if (ps->re != NULL)
+      ps_need_cmdline = 1;
+#endif
+  }
 /* #endif KERNEL_LINUX */
 
 #elif HAVE_LIBKVM_GETPROCS &&                                                  \
@@ -1028,6 +1098,17 @@ static int ps_count_fd(int pid) {
 } /* int ps_count_fd (pid) */
 
 static void ps_fill_details(const procstat_t *ps, process_entry_t *entry) {
+  /* Leave the memory details at zero if this is only a zombie */
+  if ((entry->has_status == 0) && (entry->num_proc != 0)) {
+    if (ps_read_status(entry->id, entry) != 0) {
+      /* No VMem data */
+      entry->vmem_data = -1;
+      entry->vmem_code = -1;
+      DEBUG("ps_fill_details: did not get vmem data for pid %lu", entry->id);
+    }
+    entry->has_status = 1;
+  }
+
   if (entry->has_io == 0) {
     ps_read_io(entry);
     entry->has_io = 1;
@@ -1049,15 +1130,13 @@ static void ps_fill_details(const procstat_t *ps, process_entry_t *entry) {
   }
 } /* void ps_fill_details (...) */
 
-static int ps_read_process(long pid, process_entry_t *ps, char *state) {
-  char filename[64];
-  char buffer[1024];
-
+/* Parses the content of /proc/<pid>/stat in "buffer". The buffer is
+ * modified. */
+static int ps_read_process(long pid, char *buffer, size_t buffer_len,
+                           process_entry_t *ps, char *state) {
   char *fields[64];
   char fields_len;
 
-  size_t buffer_len;
-
   char *buffer_ptr;
   size_t name_start_pos;
   size_t name_end_pos;
@@ -1069,16 +1148,6 @@ static int ps_read_process(long pid, process_entry_t *ps, char *state) {
   long long unsigned vmem_rss;
   long long unsigned stack_size;
 
-  ssize_t status;
-
-  snprintf(filename, sizeof(filename), "/proc/%li/stat", pid);
-
-  status = read_file_contents(filename, buffer, sizeof(buffer) - 1);
-  if (status <= 0)
-    return -1;
-  buffer_len = (size_t)status;
-  buffer[buffer_len] = 0;
-
   /* The name of the process is enclosed in parens. Since the name can
    * contain parens itself, spaces, numbers and pretty much everything
    * else, use these to determine the process name. We don't use
@@ -1113,24 +1182,20 @@ static int ps_read_process(long pid, process_entry_t *ps, char *state) {
   fields_len = strsplit(buffer_ptr, fields, STATIC_ARRAY_SIZE(fields));
   if (fields_len < 22) {
     DEBUG("processes plugin: ps_read_process (pid = %li):"
-          " `%s' has only %i fields..",
-          pid, filename, fields_len);
+          " `/proc/%li/stat' has only %i fields..",
+          pid, pid, fields_len);
     return -1;
   }
 
   *state = fields[0][0];
+  ps->starttime = strtoull(fields[19], /* endptr = */ NULL, /* base = */ 10);
 
   if (*state == 'Z') {
     ps->num_lwp = 0;
     ps->num_proc = 0;
   } else {
+    /* May be updated from /proc/<pid>/status by ps_fill_details () */
     ps->num_lwp = strtoul(fields[17], /* endptr = */ NULL, /* base = */ 10);
-    if ((ps_read_status(pid, ps)) != 0) {
-      /* No VMem data */
-      ps->vmem_data = -1;
-      ps->vmem_code = -1;
-      DEBUG("ps_read_process: did not get vmem data for pid %li", pid);
-    }
     if (ps->num_lwp == 0)
       ps->num_lwp = 1;
     ps->num_proc = 1;
@@ -1318,6 +1383,270 @@ static int read_fork_rate(void) {
   ps_submit_fork_rate(value.derive);
   return 0;
 }
+
+/* FNV-1a */
+static uint64_t ps_hash(char const *data, size_t data_len) {
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (size_t i = 0; i < data_len; i++) {
+    hash ^= (uint64_t)(unsigned char)data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+} /* uint64_t ps_hash */
+
+static int ps_cache_compare(void const *a, void const *b) {
+  long x = *(long const *)a;
+  long y = *(long const *)b;
+  return (x > y) - (x < y);
+} /* int ps_cache_compare */
+
+static void ps_cache_entry_free(ps_cache_entry_t *ce) {
+  if (ce == NULL)
+    return;
+
+  sfree(ce->matches);
+  sfree(ce->instances);
+  sfree(ce);
+} /* void ps_cache_entry_free */
+
+static void ps_cache_destroy(c_avl_tree_t *cache) {
+  void *key;
+  void *value;
+
+  if (cache == NULL)
+    return;
+
+  while (c_avl_pick(cache, &key, &value) == 0)
+    ps_cache_entry_free(value);
+  c_avl_destroy(cache);
+} /* void ps_cache_destroy */
+
+/* determine the groups the process belongs to */
+static int ps_cache_match(ps_cache_entry_t *ce, process_entry_t *pse) {
+  char cmdline[CMDLINE_BUFFER_SIZE];
+  char const *cmdline_ptr = NULL;
+
+  ce->matches_num = 0;
+
+  if (ps_need_cmdline)
+    cmdline_ptr = ps_get_cmdline(ce->pid, pse->name, cmdline, sizeof(cmdline));
+
+  for (procstat_t *ps = list_head_g; ps != NULL; ps = ps->next) {
+    if (ps_list_match(pse->name, cmdline_ptr, ps) == 0)
+      continue;
+
+    if (ce->matches == NULL) {
+      ce->matches = calloc(ps_groups_num, sizeof(*ce->matches));
+      ce->instances = calloc(ps_groups_num, sizeof(*ce->instances));
+      if ((ce->matches == NULL) || (ce->instances == NULL)) {
+        ERROR("processes plugin: ps_cache_match: calloc failed.");
+        sfree(ce->matches);
+        sfree(ce->instances);
+        return -1;
+      }
+    }
+
+    ce->matches[ce->matches_num] = ps;
+    ce->instances[ce->matches_num] = NULL;
+    ce->matches_num++;
+  }
+
+  return 0;
+} /* int ps_cache_match */
+
+/* Reads /proc/<pid>/stat and, if it changed since the last read, the details
+ * needed by the groups the process belongs to. I/O, context switches and the
+ * number of open files are read again in any case. Clears "valid" if the
+ * process could not be read. May be called from several threads at the same
+ * time for different entries. */
+static void ps_cache_update(ps_cache_entry_t *ce) {
+  char filename[64];
+  char buffer[1024];
+  process_entry_t pse;
+  char state;
+  ssize_t status;
+  uint64_t hash;
+
+  snprintf(filename, sizeof(filename), "/proc/%li/stat", ce->pid);
+  status = read_file_contents(filename, buffer, sizeof(buffer) - 1);
+  if (status <= 0) {
+    ce->valid = 0;
+    return;
+  }
+  buffer[status] = 0;
+
+  /* The CPU times have not moved by a tick since the last read. I/O, context
+   * switches and open files may have changed all the same. */
+  hash = ps_hash(buffer, (size_t)status);
+  if (ce->valid && (ce->stat_hash == hash)) {
+    ce->pse.has_io = 0;
+    ce->pse.has_cswitch = 0;
+    ce->pse.has_fd = 0;
+    for (size_t i = 0; i < ce->matches_num; i++)
+      ps_fill_details(ce->matches[i], &ce->pse);
+    return;
+  }
+
+  memset(&pse, 0, sizeof(pse));
+  pse.id = ce->pid;
+
+  if (ps_read_process(ce->pid, buffer, (size_t)status, &pse, &state) != 0) {
+    DEBUG("processes plugin: ps_read_process (pid = %li) failed.", ce->pid);
+    ce->valid = 0;
+    return;
+  }
+
+  /* A different start time means the pid has been reused, a different name
+   * that the process called exec(). */
+  if (!ce->valid || (ce->pse.starttime != pse.starttime) ||
+      (strcmp(ce->pse.name, pse.name) != 0)) {
+    if (ps_cache_match(ce, &pse) != 0) {
+      ce->valid = 0;
+      return;
+    }
+  }
+
+  for (size_t i = 0; i < ce->matches_num; i++)
+    ps_fill_details(ce->matches[i], &pse);
+
+  memcpy(&ce->pse, &pse, sizeof(ce->pse));
+  ce->state = state;
+  ce->stat_hash = hash;
+  ce->valid = 1;
+} /* void ps_cache_update */
+
+static void *ps_cache_update_thread(void *arg) {
+  ps_work_t *work = arg;
+
+  while (42) {
+    size_t begin;
+    size_t end;
+
+    pthread_mutex_lock(&work->lock);
+    begin = work->next;
+    work->next += PS_WORK_CHUNK;
+    pthread_mutex_unlock(&work->lock);
+
+    if (begin >= work->entries_num)
+      break;
+    end = begin + PS_WORK_CHUNK;
+    if (end > work->entries_num)
+      end = work->entries_num;
+
+    for (size_t i = begin; i < end; i++)
+      ps_cache_update(work->entries[i]);
+  }
+
+  return NULL;
+} /* void *ps_cache_update_thread */
+
+/* Updates all entries, using up to "ReadThreads" threads. */
+static void ps_cache_update_all(ps_cache_entry_t **entries,
+                                size_t entries_num) {
+  ps_work_t work = {
+      .entries = entries, .entries_num = entries_num, .next = 0,
+  };
+  pthread_t *threads = NULL;
+  int threads_num = 0;
+
+  pthread_mutex_init(&work.lock, /* attr = */ NULL);
+
+  if (ps_read_threads > 1)
+    threads = calloc((size_t)ps_read_threads - 1, sizeof(*threads));
+
+  for (int i = 1; (threads != NULL) && (i < ps_read_threads); i++) {
+    /* not worth it for a handful of processes */
+    if ((size_t)i * PS_WORK_CHUNK >= entries_num)
+      break;
+
+    int status = pthread_create(&threads[threads_num], /* attr = */ NULL,
+                                ps_cache_update_thread, &work);
+    if (status != 0) {
+      char errbuf[1024];
+      ERROR("processes plugin: pthread_create failed: %s",
+            sstrerror(status, errbuf, sizeof(errbuf)));
+      break;
+    }
+    threads_num++;
+  }
+
+  ps_cache_update_thread(&work);
+
+  for (int i = 0; i < threads_num; i++)
+    pthread_join(threads[i], /* retval = */ NULL);
+  sfree(threads);
+
+  pthread_mutex_destroy(&work.lock);
+} /* void ps_cache_update_all */
+
+/* Lists the processes in /proc, taking their entries from the cache of the
+ * previous read. The entries found are moved to "cache", the ones left behind
+ * in "old_cache" belong to processes which exited. */
+static int ps_cache_scan(c_avl_tree_t *old_cache, c_avl_tree_t *cache,
+                         size_t *ret_entries_num) {
+  struct dirent *ent;
+  DIR *proc;
+  size_t entries_num = 0;
+
+  if ((proc = opendir("/proc")) == NULL) {
+    char errbuf[1024];
+    ERROR("Cannot open `/proc': %s", sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+
+  while ((ent = readdir(proc)) != NULL) {
+    ps_cache_entry_t *ce = NULL;
+    long pid;
+
+    if (!isdigit(ent->d_name[0]))
+      continue;
+
+    if ((pid = atol(ent->d_name)) < 1)
+      continue;
+
+    if (old_cache != NULL) {
+      void *key;
+      c_avl_remove(old_cache, &pid, &key, (void *)&ce);
+    }
+
+    if (ce == NULL) {
+      ce = calloc(1, sizeof(*ce));
+      if (ce == NULL) {
+        ERROR("processes plugin: ps_cache_scan: calloc failed.");
+        continue;
+      }
+      ce->pid = pid;
+    }
+
+    if ((cache != NULL) && (c_avl_insert(cache, &ce->pid, ce) != 0)) {
+      ps_cache_entry_free(ce);
+      continue;
+    }
+
+    if (entries_num >= ps_entries_size) {
+      size_t new_size = (ps_entries_size == 0) ? 1024 : 2 * ps_entries_size;
+      ps_cache_entry_t **tmp =
+          realloc(ps_entries, new_size * sizeof(*ps_entries));
+      if (tmp == NULL) {
+        ERROR("processes plugin: ps_cache_scan: realloc failed.");
+        if (cache != NULL)
+          c_avl_remove(cache, &ce->pid, NULL, NULL);
+        ps_cache_entry_free(ce);
+        continue;
+      }
+      ps_entries = tmp;
+      ps_entries_size = new_size;
+    }
+    ps_entries[entries_num] = ce;
+    entries_num++;
+  }
+
+  closedir(proc);
+
+  *ret_entries_num = entries_num;
+  return 0;
+} /* int ps_cache_scan */
 #endif /*KERNEL_LINUX */
 
 #if KERNEL_SOLARIS
@@ -1780,42 +2109,49 @@ static int ps_read(void) {
   int paging = 0;
   int blocked = 0;
 
-  struct dirent *ent;
-  DIR *proc;
-  long pid;
-
-  char cmdline[CMDLINE_BUFFER_SIZE];
-
-  int status;
-  process_entry_t pse;
-  char state;
+  c_avl_tree_t *cache = NULL;
+  size_t entries_num = 0;
 
   running = sleeping = zombies = stopped = paging = blocked = 0;
   ps_list_reset();
 
-  if ((proc = opendir("/proc")) == NULL) {
-    char errbuf[1024];
-    ERROR("Cannot open `/proc': %s", sstrerror(errno, errbuf, sizeof(errbuf)));
+  /* If a read fails, the instances are not refreshed and ps_list_reset()
+   * eventually frees them. The cache would then point to freed instances, so
+   * it is dropped and the next read starts from scratch. */
+  if (ps_incremental) {
+    cache = c_avl_create(ps_cache_compare);
+    if (cache == NULL) {
+      ERROR("processes plugin: c_avl_create failed.");
+      ps_cache_destroy(ps_cache);
+      ps_cache = NULL;
+      return -1;
+    }
+  }
+
+  if (ps_cache_scan(ps_cache, cache, &entries_num) != 0) {
+    ps_cache_destroy(cache);
+    ps_cache_destroy(ps_cache);
+    ps_cache = NULL;
     return -1;
   }
 
-  while ((ent = readdir(proc)) != NULL) {
-    if (!isdigit(ent->d_name[0]))
-      continue;
+  /* entries left in the old cache belong to processes which exited */
+  ps_cache_destroy(ps_cache);
+  ps_cache = cache;
 
-    if ((pid = atol(ent->d_name)) < 1)
-      continue;
+  ps_cache_update_all(ps_entries, entries_num);
 
-    memset(&pse, 0, sizeof(pse));
-    pse.id = pid;
+  for (size_t i = 0; i < entries_num; i++) {
+    ps_cache_entry_t *ce = ps_entries[i];
 
-    status = ps_read_process(pid, &pse, &state);
-    if (status != 0) {
-      DEBUG("ps_read_process failed: %i", status);
+    if (!ce->valid) {
+      if (ps_cache != NULL)
+        c_avl_remove(ps_cache, &ce->pid, NULL, NULL);
+      ps_cache_entry_free(ce);
       continue;
     }
 
-    switch (state) {
+    switch (ce->state) {
     case 'R':
       running++;
       break;
@@ -1836,11 +2172,15 @@ static int ps_read(void) {
       break;
     }
 
-    ps_list_add(pse.name,
-                ps_get_cmdline(pid, pse.name, cmdline, sizeof(cmdline)), &pse);
-  }
+    /* The instances are kept by the cache entry. They are not removed by
+     * ps_list_reset() because they are refreshed in every read. */
+    for (size_t j = 0; j < ce->matches_num; j++)
+      ce->instances[j] =
+          ps_list_add_entry(ce->matches[j], ce->instances[j], &ce->pse);
 
-  closedir(proc);
+    if (ps_cache == NULL)
+      ps_cache_entry_free(ce);
+  }
 
   ps_submit_state("running", running);
   ps_submit_state("sleeping", sleeping);
@@ -2389,8 +2729,21 @@ static int ps_read(void) {
   return 0;
 } /* int ps_read */
 
+#if KERNEL_LINUX
+static int ps_shutdown(void) {
+  ps_cache_destroy(ps_cache);
+  ps_cache = NULL;
+  sfree(ps_entries);
+  ps_entries_size = 0;
+  return 0;
+} /* int ps_shutdown */
+#endif
+
 void module_register(void) {
   plugin_register_complex_config("processes", ps_config);
   plugin_register_init("processes", ps_init);
   plugin_register_read("processes", ps_read);
+#if KERNEL_LINUX
+  plugin_register_shutdown("processes", ps_shutdown);
+#endif
 } /* void module_register */
@@ -152,7 +152,8 @@ static char reg_read_doc[] =
     "data if it was supplied.";
 
 static char reg_write_doc[] =
-    "register_write(callback[, data][, name]) -> identifier\n"
+    "register_write(callback[, data][, name][, batch_size][, batch_timeout])"
+    " -> identifier\n"
     "\n"
     "Register a callback function to receive values dispatched by other "
     "plugins.\n"
@@ -170,7 +171,13 @@ static char reg_write_doc[] =
     "The callback function will be called with one or two parameters:\n"
     "values: A Values object which is a copy of the dispatched values.\n"
     "data: The optional data parameter passed to the register function.\n"
-    "    If the parameter was omitted it will be omitted here, too.";
+    "    If the parameter was omitted it will be omitted here, too.\n"
+    "\n"
+    "If 'batch_size' is greater than one, values are collected and the\n"
+    "callback is called with a list of up to 'batch_size' Values objects\n"
+    "instead. A batch is passed on early once its oldest entry is older than\n"
+    "'batch_timeout' seconds, which defaults to the global interval, even if\n"
+    "no more values arrive, and when a flush is requested.";
 
 static char reg_notification_doc[] =
     "register_notification(callback[, data][, name]) -> identifier\n"
@@ -384,18 +391,17 @@ static int cpy_read_callback(user_data_t *data) {
   return 0;
 }
 
-static int cpy_write_callback(const data_set_t *ds,
-                              const value_list_t *value_list,
-                              user_data_t *data) {
-  cpy_callback_t *c = data->data;
-  PyObject *ret, *list, *temp, *dict = NULL;
+/* Builds a Values object from "value_list". You must hold the GIL to call
+ * this function. Returns a new reference or NULL after logging the error. */
+static PyObject *cpy_build_values(const data_set_t *ds,
+                                  const value_list_t *value_list) {
+  PyObject *list, *temp, *dict = NULL;
   Values *v;
 
-  CPY_LOCK_THREADS
   list = PyList_New(value_list->values_len); /* New reference. */
   if (list == NULL) {
     cpy_log_exception("write callback");
-    CPY_RETURN_FROM_THREADS 0;
+    return NULL;
   }
   for (size_t i = 0; i < value_list->values_len; ++i) {
     if (ds->ds[i].type == DS_TYPE_COUNTER) {
@@ -413,12 +419,12 @@ static int cpy_write_callback(const data_set_t *ds,
       Py_BEGIN_ALLOW_THREADS ERROR("cpy_write_callback: Unknown value type %d.",
                                    ds->ds[i].type);
       Py_END_ALLOW_THREADS Py_DECREF(list);
-      CPY_RETURN_FROM_THREADS 0;
+      return NULL;
     }
     if (PyErr_Occurred() != NULL) {
       cpy_log_exception("value building for write callback");
       Py_DECREF(list);
-      CPY_RETURN_FROM_THREADS 0;
+      return NULL;
     }
   }
   dict = PyDict_New(); /* New reference. */
@@ -491,6 +497,20 @@ static int cpy_write_callback(const data_set_t *ds,
   v->values = list;
   Py_CLEAR(v->meta);
   v->meta = dict; /* Steals a reference. */
+  return (PyObject *)v;
+}
+
+static int cpy_write_callback(const data_set_t *ds,
+                              const value_list_t *value_list,
+                              user_data_t *data) {
+  cpy_callback_t *c = data->data;
+  PyObject *ret, *v;
+
+  CPY_LOCK_THREADS
+  v = cpy_build_values(ds, value_list); /* New reference. */
+  if (v == NULL) {
+    CPY_RETURN_FROM_THREADS 0;
+  }
   ret = PyObject_CallFunctionObjArgs(c->callback, v, c->data,
                                      (void *)0); /* New reference. */
   Py_XDECREF(v);
@@ -503,6 +523,166 @@ static int cpy_write_callback(const data_set_t *ds,
   return 0;
 }
 
+/* Batched write callbacks copy the value lists and pass them to Python in
+ * one call, so the GIL is taken once per batch instead of once per value
+ * list. */
+typedef struct cpy_write_batch_s {
+  cpy_callback_t *callback;
+  pthread_mutex_t lock;
+  size_t size;
+  cdtime_t timeout;
+  value_list_t *lists;
+  const data_set_t **ds;
+  size_t num;
+  cdtime_t first;
+} cpy_write_batch_t;
+
+static void cpy_write_batch_free_lists(value_list_t *lists, size_t num) {
+  for (size_t i = 0; i < num; ++i) {
+    free(lists[i].values);
+    meta_data_destroy(lists[i].meta);
+  }
+  free(lists);
+}
+
+/* Calls the Python callback with a list of Values built from "lists" and
+ * frees "lists" and "ds". */
+static void cpy_write_batch_deliver(cpy_callback_t *c, value_list_t *lists,
+                                    const data_set_t **ds, size_t num) {
+  PyObject *ret, *batch;
+
+  CPY_LOCK_THREADS
+  batch = PyList_New(0); /* New reference. */
+  if (batch == NULL) {
+    cpy_log_exception("write callback");
+  } else {
+    for (size_t i = 0; i < num; ++i) {
+      PyObject *v = cpy_build_values(ds[i], lists + i); /* New reference. */
+      if (v == NULL)
+        continue;
+      PyList_Append(batch, v);
+      Py_DECREF(v);
+    }
+    ret = PyObject_CallFunctionObjArgs(c->callback, batch, c->data,
+                                       (void *)0); /* New reference. */
+    Py_DECREF(batch);
+    if (ret == NULL) {
+      cpy_log_exception("write callback");
+    } else {
+      Py_DECREF(ret);
+    }
+  }
+  CPY_RELEASE_THREADS
+
+  cpy_write_batch_free_lists(lists, num);
+  free(ds);
+}
+
+/* Takes the queued value lists out of "b" and returns their number.
+ * NOTE: You must hold b->lock when calling this function! */
+static size_t cpy_write_batch_take(cpy_write_batch_t *b, value_list_t **lists,
+                                   const data_set_t ***ds) {
+  size_t num = b->num;
+
+  *lists = b->lists;
+  *ds = b->ds;
+  b->lists = NULL;
+  b->ds = NULL;
+  b->num = 0;
+  return num;
+}
+
+static int cpy_write_batch_callback(const data_set_t *ds,
+                                    const value_list_t *value_list,
+                                    user_data_t *data) {
+  cpy_write_batch_t *b = data->data;
+  value_list_t *lists = NULL;
+  const data_set_t **lists_ds = NULL;
+  size_t num = 0;
+  cdtime_t now = cdtime();
+
+  pthread_mutex_lock(&b->lock);
+  if (b->lists == NULL) {
+    b->lists = calloc(b->size, sizeof(*b->lists));
+    b->ds = calloc(b->size, sizeof(*b->ds));
+    if ((b->lists == NULL) || (b->ds == NULL)) {
+      sfree(b->lists);
+      sfree(b->ds);
+      pthread_mutex_unlock(&b->lock);
+      ERROR("python plugin: cpy_write_batch_callback: calloc failed.");
+      return -1;
+    }
+  }
+
+  value_list_t *copy = b->lists + b->num;
+  *copy = *value_list;
+  copy->values = malloc(value_list->values_len * sizeof(*copy->values));
+  if (copy->values == NULL) {
+    pthread_mutex_unlock(&b->lock);
+    ERROR("python plugin: cpy_write_batch_callback: malloc failed.");
+    return -1;
+  }
+  memcpy(copy->values, value_list->values,
+         value_list->values_len * sizeof(*copy->values));
+  copy->meta = meta_data_clone(value_list->meta);
+  b->ds[b->num] = ds;
+  if (b->num == 0)
+    b->first = now;
+  b->num++;
+
+  if ((b->num >= b->size) || ((now - b->first) >= b->timeout))
+    num = cpy_write_batch_take(b, &lists, &lists_ds);
+  pthread_mutex_unlock(&b->lock);
+
+  if (num > 0)
+    cpy_write_batch_deliver(b->callback, lists, lists_ds, num);
+  return 0;
+}
+
+/* Passes on the batch if its oldest entry is older than "timeout", or in any
+ * case if "timeout" is zero. Registered as flush callback, so that the FLUSH
+ * command reaches batched writers. */
+static int cpy_write_batch_flush(cdtime_t timeout, const char *identifier,
+                                 user_data_t *data) {
+  cpy_write_batch_t *b = data->data;
+  value_list_t *lists = NULL;
+  const data_set_t **lists_ds = NULL;
+  size_t num = 0;
+
+  pthread_mutex_lock(&b->lock);
+  if ((b->num > 0) && ((timeout == 0) || ((cdtime() - b->first) >= timeout)))
+    num = cpy_write_batch_take(b, &lists, &lists_ds);
+  pthread_mutex_unlock(&b->lock);
+
+  if (num > 0)
+    cpy_write_batch_deliver(b->callback, lists, lists_ds, num);
+  return 0;
+}
+
+/* Runs twice per "batch_timeout", so that batches of writers whose input has
+ * gone quiet are passed on, too. */
+static int cpy_write_batch_read(user_data_t *data) {
+  cpy_write_batch_t *b = data->data;
+
+  return cpy_write_batch_flush(b->timeout, /* identifier = */ NULL, data);
+}
+
+static void cpy_write_batch_destroy(void *data) {
+  cpy_write_batch_t *b = data;
+
+  /* The interpreter is only finalized once the last callback has been
+   * destroyed, so the remaining values can still be delivered. */
+  if (b->num > 0)
+    cpy_write_batch_deliver(b->callback, b->lists, b->ds, b->num);
+  else {
+    free(b->lists);
+    free(b->ds);
+  }
+  pthread_mutex_destroy(&b->lock);
+  cpy_destroy_user_data(b->callback);
+  free(b);
+}
+
 static int cpy_notification_callback(const notification_t *notification,
                                      user_data_t *data) {
   cpy_callback_t *c = data->data;
@@ -777,8 +957,72 @@ static PyObject *cpy_register_log(PyObject *self, PyObject *args,
 
 static PyObject *cpy_register_write(PyObject *self, PyObject *args,
                                     PyObject *kwds) {
-  return cpy_register_generic_userdata((void *)plugin_register_write,
-                                       (void *)cpy_write_callback, args, kwds);
+  char buf[512];
+  cpy_callback_t *c = NULL;
+  int batch_size = 0;
+  double batch_timeout = 0;
+  char *name = NULL;
+  PyObject *callback = NULL, *data = NULL;
+  static char *kwlist[] = {"callback",   "data",          "name",
+                           "batch_size", "batch_timeout", NULL};
+
+  if (PyArg_ParseTupleAndKeywords(args, kwds, "O|Oetid", kwlist, &callback,
+                                  &data, NULL, &name, &batch_size,
+                                  &batch_timeout) == 0)
+    return NULL;
+  if (PyCallable_Check(callback) == 0) {
+    PyMem_Free(name);
+    PyErr_SetString(PyExc_TypeError, "callback needs a be a callable object.");
+    return NULL;
+  }
+  cpy_build_name(buf, sizeof(buf), callback, name);
+  PyMem_Free(name);
+
+  Py_INCREF(callback);
+  Py_XINCREF(data);
+
+  c = calloc(1, sizeof(*c));
+  if (c == NULL)
+    return NULL;
+
+  c->name = strdup(buf);
+  c->callback = callback;
+  c->data = data;
+  c->next = NULL;
+
+  if (batch_size <= 1) {
+    plugin_register_write(buf, cpy_write_callback,
+                          &(user_data_t){
+                              .data = c, .free_func = cpy_destroy_user_data,
+                          });
+  } else {
+    cpy_write_batch_t *b = calloc(1, sizeof(*b));
+    if (b == NULL) {
+      ++cpy_num_callbacks;
+      cpy_destroy_user_data(c);
+      return PyErr_NoMemory();
+    }
+    b->callback = c;
+    pthread_mutex_init(&b->lock, /* attr = */ NULL);
+    b->size = (size_t)batch_size;
+    b->timeout = (batch_timeout > 0) ? DOUBLE_TO_CDTIME_T(batch_timeout)
+                                     : plugin_get_interval();
+    /* "b" is freed with the write callback, which is destroyed last. */
+    plugin_register_flush(buf, cpy_write_batch_flush,
+                          &(user_data_t){.data = b});
+    char read_name[sizeof(buf) + 8];
+    snprintf(read_name, sizeof(read_name), "%s/batch", buf);
+    plugin_register_complex_read(/* group = */ "python", read_name,
+                                 cpy_write_batch_read, b->timeout / 2,
+                                 &(user_data_t){.data = b});
+    plugin_register_write(buf, cpy_write_batch_callback,
+                          &(user_data_t){
+                              .data = b, .free_func = cpy_write_batch_destroy,
+                          });
+  }
+
+  ++cpy_num_callbacks;
+  return cpy_string_to_unicode_or_bytes(buf);
 }
 
 static PyObject *cpy_register_notification(PyObject *self, PyObject *args,
@@ -943,8 +1187,21 @@ static PyObject *cpy_unregister_read(PyObject *self, PyObject *arg) {
   return cpy_unregister_generic_userdata(plugin_unregister_read, arg, "read");
 }
 
+/* Batched write callbacks share their data with a flush and a read callback,
+ * which have to go first. */
+static int cpy_unregister_write_batch(const char *name) {
+  char read_name[512 + 8];
+
+  snprintf(read_name, sizeof(read_name), "%s/batch", name);
+  if (plugin_unregister_read(read_name) == 0)
+    plugin_unregister_flush(name);
+
+  return plugin_unregister_write(name);
+}
+
 static PyObject *cpy_unregister_write(PyObject *self, PyObject *arg) {
-  return cpy_unregister_generic_userdata(plugin_unregister_write, arg, "write");
+  return cpy_unregister_generic_userdata(cpy_unregister_write_batch, arg,
+                                         "write");
 }
 
 static PyObject *cpy_unregister_notification(PyObject *self, PyObject *arg) {
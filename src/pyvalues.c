@@ -380,6 +380,25 @@ static char write_doc[] =
     "should be\n"
     "used instead of 'write'.\n";
 
+static char dispatch_many_doc[] =
+    "dispatch_many(values[, type_instances][, plugin_instances][, type]"
+    "[, plugin_instance][, type_instance][, plugin][, host][, time]"
+    "[, interval][, meta]) -> None.  Dispatch several value lists.\n"
+    "\n"
+    "Dispatch one value list for each entry of 'values'. All value lists\n"
+    "share the identifier, time, interval and meta data of this instance or\n"
+    "the parameters of the same name.\n"
+    "\n"
+    "'values' is either a sequence of value sequences or an object supporting\n"
+    "    the buffer protocol, e.g. an array.array or a numpy array, holding\n"
+    "    the numbers of all value lists back to back.\n"
+    "'type_instances' and 'plugin_instances' are optional sequences of\n"
+    "    strings with one entry per value list, overriding the respective\n"
+    "    member.\n"
+    "\n"
+    "All values are converted first, then they are dispatched without holding\n"
+    "the global interpreter lock.";
+
 static char Values_doc[] = "A Values object used for dispatching values to "
                            "collectd and receiving values from write "
                            "callbacks.";
@@ -672,6 +691,413 @@ static PyObject *Values_dispatch(Values *self, PyObject *args, PyObject *kwds) {
   Py_RETURN_NONE;
 }
 
+/* Converts one item of a value sequence according to the type of the data
+ * source. Returns non-zero with a Python exception set on failure. */
+static int cpy_build_value(const data_set_t *ds, size_t i, PyObject *item,
+                           value_t *value) {
+  PyObject *num;
+
+  switch (ds->ds[i].type) {
+  case DS_TYPE_COUNTER:
+    num = PyNumber_Long(item); /* New reference. */
+    if (num != NULL) {
+      value->counter = PyLong_AsUnsignedLongLong(num);
+      Py_XDECREF(num);
+    }
+    break;
+  case DS_TYPE_GAUGE:
+    num = PyNumber_Float(item); /* New reference. */
+    if (num != NULL) {
+      value->gauge = PyFloat_AsDouble(num);
+      Py_XDECREF(num);
+    }
+    break;
+  case DS_TYPE_DERIVE:
+    num = PyNumber_Long(item); /* New reference. */
+    if (num != NULL) {
+      value->derive = PyLong_AsLongLong(num);
+      Py_XDECREF(num);
+    }
+    break;
+  case DS_TYPE_ABSOLUTE:
+    num = PyNumber_Long(item); /* New reference. */
+    if (num != NULL) {
+      value->absolute = PyLong_AsUnsignedLongLong(num);
+      Py_XDECREF(num);
+    }
+    break;
+  default:
+    PyErr_Format(PyExc_RuntimeError, "unknown data type %d for %s",
+                 ds->ds[i].type, ds->type);
+    return -1;
+  }
+  return (PyErr_Occurred() != NULL) ? -1 : 0;
+}
+
+/* Converts a buffer holding "num" value lists back to back. Only native
+ * byte order and the numeric struct formats are supported. */
+static int cpy_build_values_from_buffer(const data_set_t *ds,
+                                        Py_buffer const *view, size_t num,
+                                        value_t *value) {
+  char const *format = (view->format != NULL) ? view->format : "B";
+  char const *ptr = view->buf;
+  size_t item_size;
+
+  if ((format[0] == '@') || (format[0] == '='))
+    format++;
+  if ((format[0] == 0) || (format[1] != 0)) {
+    PyErr_Format(PyExc_TypeError, "unsupported buffer format \"%s\"",
+                 view->format);
+    return -1;
+  }
+
+  switch (format[0]) {
+  case 'b':
+  case 'B':
+    item_size = sizeof(char);
+    break;
+  case 'h':
+  case 'H':
+    item_size = sizeof(short);
+    break;
+  case 'i':
+  case 'I':
+    item_size = sizeof(int);
+    break;
+  case 'l':
+  case 'L':
+    item_size = sizeof(long);
+    break;
+  case 'q':
+  case 'Q':
+    item_size = sizeof(long long);
+    break;
+  case 'n':
+  case 'N':
+    item_size = sizeof(size_t);
+    break;
+  case 'f':
+    item_size = sizeof(float);
+    break;
+  case 'd':
+    item_size = sizeof(double);
+    break;
+  default:
+    PyErr_Format(PyExc_TypeError, "unsupported buffer format \"%s\"",
+                 view->format);
+    return -1;
+  }
+  if ((size_t)view->itemsize != item_size) {
+    PyErr_Format(PyExc_TypeError, "unexpected item size %zd for format \"%s\"",
+                 view->itemsize, view->format);
+    return -1;
+  }
+
+#define CPY_BUFFER_ITEM(t, dst)                                                \
+  do {                                                                         \
+    t tmp;                                                                     \
+    memcpy(&tmp, ptr, sizeof(tmp));                                            \
+    dst = tmp;                                                                 \
+  } while (0)
+
+  for (size_t i = 0; i < num * ds->ds_num; i++, ptr += item_size) {
+    double d = 0;
+    int64_t s = 0;
+    uint64_t u = 0;
+    _Bool is_float = 0, is_signed = 0;
+
+    switch (format[0]) {
+    case 'b':
+      CPY_BUFFER_ITEM(signed char, s);
+      is_signed = 1;
+      break;
+    case 'B':
+      CPY_BUFFER_ITEM(unsigned char, u);
+      break;
+    case 'h':
+      CPY_BUFFER_ITEM(short, s);
+      is_signed = 1;
+      break;
+    case 'H':
+      CPY_BUFFER_ITEM(unsigned short, u);
+      break;
+    case 'i':
+      CPY_BUFFER_ITEM(int, s);
+      is_signed = 1;
+      break;
+    case 'I':
+      CPY_BUFFER_ITEM(unsigned int, u);
+      break;
+    case 'l':
+      CPY_BUFFER_ITEM(long, s);
+      is_signed = 1;
+      break;
+    case 'L':
+      CPY_BUFFER_ITEM(unsigned long, u);
+      break;
+    case 'q':
+      CPY_BUFFER_ITEM(long long, s);
+      is_signed = 1;
+      break;
+    case 'Q':
+      CPY_BUFFER_ITEM(unsigned long long, u);
+      break;
+    case 'n':
+      CPY_BUFFER_ITEM(ssize_t, s);
+      is_signed = 1;
+      break;
+    case 'N':
+      CPY_BUFFER_ITEM(size_t, u);
+      break;
+    case 'f':
+      CPY_BUFFER_ITEM(float, d);
+      is_float = 1;
+      break;
+    case 'd':
+      CPY_BUFFER_ITEM(double, d);
+      is_float = 1;
+      break;
+    }
+
+    switch (ds->ds[i % ds->ds_num].type) {
+    case DS_TYPE_GAUGE:
+      value[i].gauge =
+          is_float ? (gauge_t)d : (is_signed ? (gauge_t)s : (gauge_t)u);
+      break;
+    case DS_TYPE_DERIVE:
+      value[i].derive =
+          is_float ? (derive_t)d : (is_signed ? (derive_t)s : (derive_t)u);
+      break;
+    case DS_TYPE_COUNTER:
+      value[i].counter =
+          is_float ? (counter_t)d : (is_signed ? (counter_t)s : (counter_t)u);
+      break;
+    case DS_TYPE_ABSOLUTE:
+      value[i].absolute =
+          is_float ? (absolute_t)d
+                   : (is_signed ? (absolute_t)s : (absolute_t)u);
+      break;
+    default:
+      PyErr_Format(PyExc_RuntimeError, "unknown data type %d for %s",
+                   ds->ds[i % ds->ds_num].type, ds->type);
+      return -1;
+    }
+  }
+#undef CPY_BUFFER_ITEM
+
+  return 0;
+}
+
+/* Copies one string per value list from the sequence "seq" into "names",
+ * which holds "num" entries of DATA_MAX_NAME_LEN bytes. */
+static int cpy_build_names(PyObject *seq, size_t num, char *names,
+                           const char *what) {
+  if (!PySequence_Check(seq) || ((size_t)PySequence_Length(seq) != num)) {
+    PyErr_Format(PyExc_TypeError, "%s must be a sequence of %zu strings", what,
+                 num);
+    return -1;
+  }
+
+  for (size_t i = 0; i < num; i++) {
+    PyObject *item;
+    const char *name;
+
+    item = PySequence_GetItem(seq, (Py_ssize_t)i); /* New reference. */
+    if (item == NULL)
+      return -1;
+    name = cpy_unicode_or_bytes_to_string(&item);
+    if (name == NULL) {
+      Py_DECREF(item);
+      return -1;
+    }
+    sstrncpy(names + i * DATA_MAX_NAME_LEN, name, DATA_MAX_NAME_LEN);
+    Py_DECREF(item);
+  }
+  return 0;
+}
+
+static PyObject *Values_dispatch_many(Values *self, PyObject *args,
+                                      PyObject *kwds) {
+  const data_set_t *ds;
+  size_t num, failed = 0;
+  value_t *value = NULL;
+  char *type_instance_list = NULL, *plugin_instance_list = NULL;
+  value_list_t value_list = VALUE_LIST_INIT;
+  PyObject *values = NULL, *type_instances = NULL, *plugin_instances = NULL;
+  PyObject *meta = self->meta;
+  double time = self->data.time, interval = self->interval;
+  char *host = NULL, *plugin = NULL, *plugin_instance = NULL, *type = NULL,
+       *type_instance = NULL;
+
+  static char *kwlist[] = {"values",   "type_instances",  "plugin_instances",
+                           "type",     "plugin_instance", "type_instance",
+                           "plugin",   "host",            "time",
+                           "interval", "meta",            NULL};
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwds, "O|OOetetetetetddO", kwlist, &values, &type_instances,
+          &plugin_instances, NULL, &type, NULL, &plugin_instance, NULL,
+          &type_instance, NULL, &plugin, NULL, &host, &time, &interval, &meta))
+    return NULL;
+
+  sstrncpy(value_list.host, host ? host : self->data.host,
+           sizeof(value_list.host));
+  sstrncpy(value_list.plugin, plugin ? plugin : self->data.plugin,
+           sizeof(value_list.plugin));
+  sstrncpy(value_list.plugin_instance,
+           plugin_instance ? plugin_instance : self->data.plugin_instance,
+           sizeof(value_list.plugin_instance));
+  sstrncpy(value_list.type, type ? type : self->data.type,
+           sizeof(value_list.type));
+  sstrncpy(value_list.type_instance,
+           type_instance ? type_instance : self->data.type_instance,
+           sizeof(value_list.type_instance));
+  FreeAll();
+  if (value_list.type[0] == 0) {
+    PyErr_SetString(PyExc_RuntimeError, "type not set");
+    return NULL;
+  }
+  ds = plugin_get_ds(value_list.type);
+  if (ds == NULL) {
+    PyErr_Format(PyExc_TypeError, "Dataset %s not found", value_list.type);
+    return NULL;
+  }
+  if (meta != NULL && meta != Py_None && !PyDict_Check(meta)) {
+    PyErr_Format(PyExc_TypeError, "meta must be a dict");
+    return NULL;
+  }
+
+  if (PyObject_CheckBuffer(values)) {
+    Py_buffer view;
+    size_t items;
+
+    if (PyObject_GetBuffer(values, &view, PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) !=
+        0)
+      return NULL;
+    items = (view.itemsize > 0) ? (size_t)(view.len / view.itemsize) : 0;
+    if ((items % ds->ds_num) != 0) {
+      PyErr_Format(PyExc_RuntimeError,
+                   "type %s needs %zu values per value list, got %zu values",
+                   value_list.type, ds->ds_num, items);
+      PyBuffer_Release(&view);
+      return NULL;
+    }
+    num = items / ds->ds_num;
+    value = calloc(items + 1, sizeof(*value));
+    if (value == NULL) {
+      PyBuffer_Release(&view);
+      return PyErr_NoMemory();
+    }
+    if (cpy_build_values_from_buffer(ds, &view, num, value) != 0) {
+      PyBuffer_Release(&view);
+      free(value);
+      return NULL;
+    }
+    PyBuffer_Release(&view);
+  } else if (PySequence_Check(values)) {
+    num = (size_t)PySequence_Length(values);
+    value = calloc(num * ds->ds_num + 1, sizeof(*value));
+    if (value == NULL)
+      return PyErr_NoMemory();
+    for (size_t i = 0; i < num; i++) {
+      PyObject *item, *row;
+      size_t size;
+
+      item = PySequence_GetItem(values, (Py_ssize_t)i); /* New reference. */
+      if (item == NULL) {
+        free(value);
+        return NULL;
+      }
+      row = PySequence_Fast(item, "values must contain sequences");
+      Py_DECREF(item);
+      if (row == NULL) {
+        free(value);
+        return NULL;
+      }
+      size = (size_t)PySequence_Fast_GET_SIZE(row);
+      if (size != ds->ds_num) {
+        PyErr_Format(PyExc_RuntimeError, "type %s needs %zu values, got %zu",
+                     value_list.type, ds->ds_num, size);
+        Py_DECREF(row);
+        free(value);
+        return NULL;
+      }
+      for (size_t j = 0; j < size; j++) {
+        /* Borrowed reference. */
+        if (cpy_build_value(ds, j, PySequence_Fast_GET_ITEM(row, j),
+                            value + i * ds->ds_num + j) != 0) {
+          Py_DECREF(row);
+          free(value);
+          return NULL;
+        }
+      }
+      Py_DECREF(row);
+    }
+  } else {
+    PyErr_Format(PyExc_TypeError,
+                 "values must be a sequence or support the buffer protocol");
+    return NULL;
+  }
+
+  if (type_instances != NULL && type_instances != Py_None) {
+    type_instance_list = calloc(num + 1, DATA_MAX_NAME_LEN);
+    if ((type_instance_list == NULL) ||
+        (cpy_build_names(type_instances, num, type_instance_list,
+                         "type_instances") != 0)) {
+      free(type_instance_list);
+      free(value);
+      return PyErr_Occurred() ? NULL : PyErr_NoMemory();
+    }
+  }
+  if (plugin_instances != NULL && plugin_instances != Py_None) {
+    plugin_instance_list = calloc(num + 1, DATA_MAX_NAME_LEN);
+    if ((plugin_instance_list == NULL) ||
+        (cpy_build_names(plugin_instances, num, plugin_instance_list,
+                         "plugin_instances") != 0)) {
+      free(plugin_instance_list);
+      free(type_instance_list);
+      free(value);
+      return PyErr_Occurred() ? NULL : PyErr_NoMemory();
+    }
+  }
+
+  value_list.meta = cpy_build_meta(meta);
+  value_list.values_len = ds->ds_num;
+  value_list.time = DOUBLE_TO_CDTIME_T(time);
+  value_list.interval = DOUBLE_TO_CDTIME_T(interval);
+  if (value_list.host[0] == 0)
+    sstrncpy(value_list.host, hostname_g, sizeof(value_list.host));
+  if (value_list.plugin[0] == 0)
+    sstrncpy(value_list.plugin, "python", sizeof(value_list.plugin));
+
+  Py_BEGIN_ALLOW_THREADS;
+  for (size_t i = 0; i < num; i++) {
+    value_list.values = value + i * ds->ds_num;
+    if (type_instance_list != NULL)
+      sstrncpy(value_list.type_instance,
+               type_instance_list + i * DATA_MAX_NAME_LEN,
+               sizeof(value_list.type_instance));
+    if (plugin_instance_list != NULL)
+      sstrncpy(value_list.plugin_instance,
+               plugin_instance_list + i * DATA_MAX_NAME_LEN,
+               sizeof(value_list.plugin_instance));
+    if (plugin_dispatch_values(&value_list) != 0)
+      failed++;
+  }
+  Py_END_ALLOW_THREADS;
+
+  meta_data_destroy(value_list.meta);
+  free(plugin_instance_list);
+  free(type_instance_list);
+  free(value);
+  if (failed > 0) {
+    PyErr_Format(PyExc_RuntimeError,
+                 "error dispatching %zu of %zu value lists, read the logs",
+                 failed, num);
+    return NULL;
+  }
+  Py_RETURN_NONE;
+}
+
 static PyObject *Values_write(Values *self, PyObject *args, PyObject *kwds) {
   int ret;
   const data_set_t *ds;
@@ -866,6 +1292,8 @@ static PyMemberDef Values_members[] = {
 static PyMethodDef Values_methods[] = {
     {"dispatch", (PyCFunction)Values_dispatch, METH_VARARGS | METH_KEYWORDS,
      dispatch_doc},
+    {"dispatch_many", (PyCFunction)Values_dispatch_many,
+     METH_VARARGS | METH_KEYWORDS, dispatch_many_doc},
     {"write", (PyCFunction)Values_write, METH_VARARGS | METH_KEYWORDS,
      write_doc},
     {NULL}};
@@ -36,9 +36,21 @@
 /*
  * Private types
  */
-struct rrd_cache_s {
+/* Values of one RRD file, stored back to back as NUL-terminated strings in a
+ * single buffer. The buffer is sized for the expected number of values when
+ * it is first used and is recycled by the writer thread afterwards, so in the
+ * steady state no allocations happen on the write path. */
+struct rrd_values_s {
+  char *buffer;
+  size_t size;
+  size_t len;
   int values_num;
-  char **values;
+};
+typedef struct rrd_values_s rrd_values_t;
+
+struct rrd_cache_s {
+  rrd_values_t values;
+  rrd_values_t spare;
   cdtime_t first_value;
   cdtime_t last_value;
   int64_t random_variation;
@@ -55,13 +67,43 @@ struct rrd_queue_s {
 };
 typedef struct rrd_queue_s rrd_queue_t;
 
+/* Files are distributed over "shards" by a hash of their name. Each shard has
+ * its own cache, queues and writer thread, so neither the locks nor the
+ * writing are shared between files of different shards.
+ *
+ * XXX: If you need to lock both, cache_lock and queue_lock, at the same time,
+ * ALWAYS lock `cache_lock' first! */
+struct rrd_shard_s {
+  c_avl_tree_t *cache;
+  cdtime_t cache_flush_last;
+  pthread_mutex_t cache_lock;
+
+  rrd_queue_t *queue_head;
+  rrd_queue_t *queue_tail;
+  rrd_queue_t *flushq_head;
+  rrd_queue_t *flushq_tail;
+  pthread_t queue_thread;
+  int queue_thread_running;
+  int shutdown;
+  pthread_mutex_t queue_lock;
+  pthread_cond_t queue_cond;
+
+  /* Statistics, protected by queue_lock. */
+  size_t queue_length;
+  derive_t updates_written;
+  derive_t values_written;
+  cdtime_t flush_lag;
+};
+typedef struct rrd_shard_s rrd_shard_t;
+
 /*
  * Private variables
  */
 static const char *config_keys[] = {
-    "CacheTimeout", "CacheFlush",      "CreateFilesAsync", "DataDir",
-    "StepSize",     "HeartBeat",       "RRARows",          "RRATimespan",
-    "XFF",          "WritesPerSecond", "RandomTimeout"};
+    "CacheTimeout",      "CacheFlush",      "CreateFilesAsync", "DataDir",
+    "StepSize",          "HeartBeat",       "RRARows",          "RRATimespan",
+    "XFF",               "WritesPerSecond", "RandomTimeout",    "WriteThreads",
+    "CollectStatistics"};
 static int config_keys_num = STATIC_ARRAY_SIZE(config_keys);
 
 /* If datadir is zero, the daemon's basedir is used. If stepsize or heartbeat
@@ -83,23 +125,15 @@ static rrdcreate_config_t rrdcreate_config = {
 
     /* async = */ 0};
 
-/* XXX: If you need to lock both, cache_lock and queue_lock, at the same time,
- * ALWAYS lock `cache_lock' first! */
 static cdtime_t cache_timeout = 0;
 static cdtime_t cache_flush_timeout = 0;
 static cdtime_t random_timeout = 0;
-static cdtime_t cache_flush_last;
-static c_avl_tree_t *cache = NULL;
-static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
-
-static rrd_queue_t *queue_head = NULL;
-static rrd_queue_t *queue_tail = NULL;
-static rrd_queue_t *flushq_head = NULL;
-static rrd_queue_t *flushq_tail = NULL;
-static pthread_t queue_thread;
-static int queue_thread_running = 1;
-static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
+static size_t write_threads = 1;
+static _Bool collect_statistics = 0;
+
+static rrd_shard_t *shards = NULL;
+static size_t shards_num = 0;
 
 #if !HAVE_THREADSAFE_LIBRRD
 static pthread_mutex_t librrd_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -112,7 +146,8 @@ static int srrd_update(char *filename, char *template, int argc,
                        const char **argv) {
   int status;
 
-  optind = 0; /* bug in librrd? */
+  /* rrd_update_r() doesn't use getopt(), so unlike below "optind" is left
+   * alone: the writer threads call this concurrently. */
   rrd_clear_error();
 
   status = rrd_update_r(filename, template, argc, (void *)argv);
@@ -177,7 +212,7 @@ static int value_list_to_string_multiple(char *buffer, int buffer_len,
   memset(buffer, '\0', buffer_len);
 
   tt = CDTIME_T_TO_TIME_T(vl->time);
-  status = ssnprintf(buffer, buffer_len, "%u", (unsigned int)tt);
+  status = snprintf(buffer, buffer_len, "%u", (unsigned int)tt);
   if ((status < 1) || (status >= buffer_len))
     return -1;
   offset = status;
@@ -190,17 +225,17 @@ static int value_list_to_string_multiple(char *buffer, int buffer_len,
       return -1;
 
     if (ds->ds[i].type == DS_TYPE_COUNTER)
-      status = ssnprintf(buffer + offset, buffer_len - offset, ":%llu",
-                        vl->values[i].counter);
+      status = snprintf(buffer + offset, buffer_len - offset, ":%llu",
+                       vl->values[i].counter);
     else if (ds->ds[i].type == DS_TYPE_GAUGE)
-      status = ssnprintf(buffer + offset, buffer_len - offset, ":" GAUGE_FORMAT,
-                        vl->values[i].gauge);
+      status = snprintf(buffer + offset, buffer_len - offset, ":" GAUGE_FORMAT,
+                       vl->values[i].gauge);
     else if (ds->ds[i].type == DS_TYPE_DERIVE)
-      status = ssnprintf(buffer + offset, buffer_len - offset, ":%" PRIi64,
-                        vl->values[i].derive);
+      status = snprintf(buffer + offset, buffer_len - offset, ":%" PRIi64,
+                       vl->values[i].derive);
     else /*if (ds->ds[i].type == DS_TYPE_ABSOLUTE) */
-      status = ssnprintf(buffer + offset, buffer_len - offset, ":%" PRIu64,
-                        vl->values[i].absolute);
+      status = snprintf(buffer + offset, buffer_len - offset, ":%" PRIu64,
+                       vl->values[i].absolute);
 
     if ((status < 1) || (status >= (buffer_len - offset)))
       return -1;
@@ -222,20 +257,20 @@ static int value_list_to_string(char *buffer, int buffer_len,
   tt = CDTIME_T_TO_TIME_T(vl->time);
   switch (ds->ds[0].type) {
   case DS_TYPE_DERIVE:
-    status = ssnprintf(buffer, buffer_len, "%u:%" PRIi64, (unsigned)tt,
-                      vl->values[0].derive);
+    status = snprintf(buffer, buffer_len, "%u:%" PRIi64, (unsigned)tt,
+                     vl->values[0].derive);
     break;
   case DS_TYPE_GAUGE:
-    status = ssnprintf(buffer, buffer_len, "%u:" GAUGE_FORMAT, (unsigned)tt,
-                      vl->values[0].gauge);
+    status = snprintf(buffer, buffer_len, "%u:" GAUGE_FORMAT, (unsigned)tt,
+                     vl->values[0].gauge);
     break;
   case DS_TYPE_COUNTER:
-    status = ssnprintf(buffer, buffer_len, "%u:%llu", (unsigned)tt,
-                      vl->values[0].counter);
+    status = snprintf(buffer, buffer_len, "%u:%llu", (unsigned)tt,
+                     vl->values[0].counter);
     break;
   case DS_TYPE_ABSOLUTE:
-    status = ssnprintf(buffer, buffer_len, "%u:%" PRIu64, (unsigned)tt,
-                      vl->values[0].absolute);
+    status = snprintf(buffer, buffer_len, "%u:%" PRIu64, (unsigned)tt,
+                     vl->values[0].absolute);
     break;
   default:
     return EINVAL;
@@ -283,44 +318,134 @@ static int value_list_to_filename(char *buffer, size_t buffer_size,
   return 0;
 } /* int value_list_to_filename */
 
-static void *rrd_queue_thread(void __attribute__((unused)) * data) {
+/* FNV-1a hash of the file name. */
+static rrd_shard_t *rrd_shard_get(const char *filename) /* {{{ */
+{
+  uint32_t hash = 2166136261U;
+
+  for (const char *ptr = filename; *ptr != 0; ptr++) {
+    hash ^= (uint32_t)(unsigned char)*ptr;
+    hash *= 16777619U;
+  }
+
+  return shards + (hash % shards_num);
+} /* }}} rrd_shard_t *rrd_shard_get */
+
+/* Returns the number of values a file is expected to collect before it is
+ * written, so the buffer can be allocated at the right size from the start. */
+static size_t rrd_values_hint(cdtime_t interval) /* {{{ */
+{
+  size_t hint;
+
+  if ((cache_timeout == 0) || (interval == 0))
+    return 1;
+
+  hint = (size_t)((cache_timeout + random_timeout) / interval) + 2;
+  if (hint > 1024)
+    hint = 1024;
+
+  return hint;
+} /* }}} size_t rrd_values_hint */
+
+static int rrd_values_append(rrd_values_t *v, const char *value, /* {{{ */
+                             size_t hint) {
+  size_t value_size = strlen(value) + 1;
+
+  if ((v->size - v->len) < value_size) {
+    size_t new_size = (v->size > 0) ? 2 * v->size : hint * value_size;
+    char *tmp;
+
+    while ((new_size - v->len) < value_size)
+      new_size *= 2;
+
+    tmp = realloc(v->buffer, new_size);
+    if (tmp == NULL)
+      return ENOMEM;
+
+    v->buffer = tmp;
+    v->size = new_size;
+  }
+
+  memcpy(v->buffer + v->len, value, value_size);
+  v->len += value_size;
+  v->values_num++;
+
+  return 0;
+} /* }}} int rrd_values_append */
+
+/* Writes all values of one file with a single update call. */
+static int rrd_values_write(char *filename, rrd_values_t const *v) /* {{{ */
+{
+  const char *argv_static[64];
+  const char **argv = argv_static;
+  const char *ptr;
+  int status;
+
+  if ((size_t)v->values_num > STATIC_ARRAY_SIZE(argv_static)) {
+    argv = calloc(v->values_num, sizeof(*argv));
+    if (argv == NULL) {
+      ERROR("rrdtool plugin: calloc failed.");
+      return ENOMEM;
+    }
+  }
+
+  ptr = v->buffer;
+  for (int i = 0; i < v->values_num; i++) {
+    argv[i] = ptr;
+    ptr += strlen(ptr) + 1;
+  }
+
+  status = srrd_update(filename, NULL, v->values_num, argv);
+  DEBUG("rrdtool plugin: queue thread: Wrote %i value%s to %s", v->values_num,
+        (v->values_num == 1) ? "" : "s", filename);
+
+  if (argv != argv_static)
+    free(argv);
+
+  return status;
+} /* }}} int rrd_values_write */
+
+static void *rrd_queue_thread(void *data) {
+  rrd_shard_t *shard = data;
   struct timeval tv_next_update;
   struct timeval tv_now;
 
+  /* WritesPerSecond limits the plugin as a whole, so every writer thread gets
+   * its share of the rate. */
+  double thread_write_rate = write_rate * (double)shards_num;
+
   gettimeofday(&tv_next_update, /* timezone = */ NULL);
 
   while (42) {
     rrd_queue_t *queue_entry;
     rrd_cache_t *cache_entry;
-    char **values;
-    int values_num;
+    rrd_values_t values = {0};
+    cdtime_t first_value = 0;
+    cdtime_t lag;
     int status;
 
-    values = NULL;
-    values_num = 0;
-
-    pthread_mutex_lock(&queue_lock);
+    pthread_mutex_lock(&shard->queue_lock);
     /* Wait for values to arrive */
     while (42) {
       struct timespec ts_wait;
 
-      while ((flushq_head == NULL) && (queue_head == NULL) &&
-             (do_shutdown == 0))
-        pthread_cond_wait(&queue_cond, &queue_lock);
+      while ((shard->flushq_head == NULL) && (shard->queue_head == NULL) &&
+             (shard->shutdown == 0))
+        pthread_cond_wait(&shard->queue_cond, &shard->queue_lock);
 
-      if ((flushq_head == NULL) && (queue_head == NULL))
+      if ((shard->flushq_head == NULL) && (shard->queue_head == NULL))
         break;
 
       /* Don't delay if there's something to flush */
-      if (flushq_head != NULL)
+      if (shard->flushq_head != NULL)
         break;
 
       /* Don't delay if we're shutting down */
-      if (do_shutdown != 0)
+      if (shard->shutdown != 0)
         break;
 
       /* Don't delay if no delay was configured. */
-      if (write_rate <= 0.0)
+      if (thread_write_rate <= 0.0)
         break;
 
       gettimeofday(&tv_now, /* timezone = */ NULL);
@@ -335,7 +460,8 @@ static void *rrd_queue_thread(void __attribute__((unused)) * data) {
       ts_wait.tv_sec = tv_next_update.tv_sec;
       ts_wait.tv_nsec = 1000 * tv_next_update.tv_usec;
 
-      status = pthread_cond_timedwait(&queue_cond, &queue_lock, &ts_wait);
+      status = pthread_cond_timedwait(&shard->queue_cond, &shard->queue_lock,
+                                      &ts_wait);
       if (status == ETIMEDOUT)
         break;
     } /* while (42) */
@@ -344,47 +470,51 @@ static void *rrd_queue_thread(void __attribute__((unused)) * data) {
      * the same time, ALWAYS lock `cache_lock' first! */
 
     /* We're in the shutdown phase */
-    if ((flushq_head == NULL) && (queue_head == NULL)) {
-      pthread_mutex_unlock(&queue_lock);
+    if ((shard->flushq_head == NULL) && (shard->queue_head == NULL)) {
+      pthread_mutex_unlock(&shard->queue_lock);
       break;
     }
 
-    if (flushq_head != NULL) {
+    if (shard->flushq_head != NULL) {
       /* Dequeue the first flush entry */
-      queue_entry = flushq_head;
-      if (flushq_head == flushq_tail)
-        flushq_head = flushq_tail = NULL;
+      queue_entry = shard->flushq_head;
+      if (shard->flushq_head == shard->flushq_tail)
+        shard->flushq_head = shard->flushq_tail = NULL;
       else
-        flushq_head = flushq_head->next;
+        shard->flushq_head = shard->flushq_head->next;
     } else /* if (queue_head != NULL) */
     {
       /* Dequeue the first regular entry */
-      queue_entry = queue_head;
-      if (queue_head == queue_tail)
-        queue_head = queue_tail = NULL;
+      queue_entry = shard->queue_head;
+      if (shard->queue_head == shard->queue_tail)
+        shard->queue_head = shard->queue_tail = NULL;
       else
-        queue_head = queue_head->next;
+        shard->queue_head = shard->queue_head->next;
     }
+    shard->queue_length--;
 
     /* Unlock the queue again */
-    pthread_mutex_unlock(&queue_lock);
+    pthread_mutex_unlock(&shard->queue_lock);
 
-    /* We now need the cache lock so the entry isn't updated while
-     * we make a copy of its values */
-    pthread_mutex_lock(&cache_lock);
+    /* We now need the cache lock so the entry isn't updated while we take
+     * its values. The entry continues with the spare buffer, if any. */
+    pthread_mutex_lock(&shard->cache_lock);
 
-    status = c_avl_get(cache, queue_entry->filename, (void *)&cache_entry);
+    status =
+        c_avl_get(shard->cache, queue_entry->filename, (void *)&cache_entry);
 
     if (status == 0) {
       values = cache_entry->values;
-      values_num = cache_entry->values_num;
+      first_value = cache_entry->first_value;
 
-      cache_entry->values = NULL;
-      cache_entry->values_num = 0;
+      cache_entry->values = cache_entry->spare;
+      cache_entry->values.len = 0;
+      cache_entry->values.values_num = 0;
+      memset(&cache_entry->spare, 0, sizeof(cache_entry->spare));
       cache_entry->flags = FLAG_NONE;
     }
 
-    pthread_mutex_unlock(&cache_lock);
+    pthread_mutex_unlock(&shard->cache_lock);
 
     if (status != 0) {
       sfree(queue_entry->filename);
@@ -393,11 +523,11 @@ static void *rrd_queue_thread(void __attribute__((unused)) * data) {
     }
 
     /* Update `tv_next_update' */
-    if (write_rate > 0.0) {
+    if (thread_write_rate > 0.0) {
       gettimeofday(&tv_now, /* timezone = */ NULL);
       tv_next_update.tv_sec = tv_now.tv_sec;
       tv_next_update.tv_usec =
-          tv_now.tv_usec + ((suseconds_t)(1000000 * write_rate));
+          tv_now.tv_usec + ((suseconds_t)(1000000 * thread_write_rate));
       while (tv_next_update.tv_usec > 1000000) {
         tv_next_update.tv_sec++;
         tv_next_update.tv_usec -= 1000000;
@@ -405,14 +535,31 @@ static void *rrd_queue_thread(void __attribute__((unused)) * data) {
     }
 
     /* Write the values to the RRD-file */
-    srrd_update(queue_entry->filename, NULL, values_num, (const char **)values);
-    DEBUG("rrdtool plugin: queue thread: Wrote %i value%s to %s", values_num,
-          (values_num == 1) ? "" : "s", queue_entry->filename);
-
-    for (int i = 0; i < values_num; i++) {
-      sfree(values[i]);
+    if (values.values_num > 0)
+      rrd_values_write(queue_entry->filename, &values);
+
+    lag = cdtime() - first_value;
+    pthread_mutex_lock(&shard->queue_lock);
+    shard->updates_written++;
+    shard->values_written += (derive_t)values.values_num;
+    if (lag > shard->flush_lag)
+      shard->flush_lag = lag;
+    pthread_mutex_unlock(&shard->queue_lock);
+
+    /* Hand the buffer back to the entry so the next values don't need a new
+     * allocation. */
+    pthread_mutex_lock(&shard->cache_lock);
+    if ((values.buffer != NULL) &&
+        (c_avl_get(shard->cache, queue_entry->filename,
+                   (void *)&cache_entry) == 0) &&
+        (cache_entry->spare.buffer == NULL)) {
+      cache_entry->spare.buffer = values.buffer;
+      cache_entry->spare.size = values.size;
+      values.buffer = NULL;
     }
-    sfree(values);
+    pthread_mutex_unlock(&shard->cache_lock);
+
+    sfree(values.buffer);
     sfree(queue_entry->filename);
     sfree(queue_entry);
   } /* while (42) */
@@ -421,8 +568,8 @@ static void *rrd_queue_thread(void __attribute__((unused)) * data) {
   return (void *)0;
 } /* void *rrd_queue_thread */
 
-static int rrd_queue_enqueue(const char *filename, rrd_queue_t **head,
-                             rrd_queue_t **tail) {
+static int rrd_queue_enqueue(rrd_shard_t *shard, const char *filename,
+                             rrd_queue_t **head, rrd_queue_t **tail) {
   rrd_queue_t *queue_entry;
 
   queue_entry = malloc(sizeof(*queue_entry));
@@ -437,26 +584,27 @@ static int rrd_queue_enqueue(const char *filename, rrd_queue_t **head,
 
   queue_entry->next = NULL;
 
-  pthread_mutex_lock(&queue_lock);
+  pthread_mutex_lock(&shard->queue_lock);
 
   if (*tail == NULL)
     *head = queue_entry;
   else
     (*tail)->next = queue_entry;
   *tail = queue_entry;
+  shard->queue_length++;
 
-  pthread_cond_signal(&queue_cond);
-  pthread_mutex_unlock(&queue_lock);
+  pthread_cond_signal(&shard->queue_cond);
+  pthread_mutex_unlock(&shard->queue_lock);
 
   return 0;
 } /* int rrd_queue_enqueue */
 
-static int rrd_queue_dequeue(const char *filename, rrd_queue_t **head,
-                             rrd_queue_t **tail) {
+static int rrd_queue_dequeue(rrd_shard_t *shard, const char *filename,
+                             rrd_queue_t **head, rrd_queue_t **tail) {
   rrd_queue_t *this;
   rrd_queue_t *prev;
 
-  pthread_mutex_lock(&queue_lock);
+  pthread_mutex_lock(&shard->queue_lock);
 
   prev = NULL;
   this = *head;
@@ -470,7 +618,7 @@ static int rrd_queue_dequeue(const char *filename, rrd_queue_t **head,
   }
 
   if (this == NULL) {
-    pthread_mutex_unlock(&queue_lock);
+    pthread_mutex_unlock(&shard->queue_lock);
     return -1;
   }
 
@@ -481,8 +629,9 @@ static int rrd_queue_dequeue(const char *filename, rrd_queue_t **head,
 
   if (this->next == NULL)
     *tail = prev;
+  shard->queue_length--;
 
-  pthread_mutex_unlock(&queue_lock);
+  pthread_mutex_unlock(&shard->queue_lock);
 
   sfree(this->filename);
   sfree(this);
@@ -490,8 +639,18 @@ static int rrd_queue_dequeue(const char *filename, rrd_queue_t **head,
   return 0;
 } /* int rrd_queue_dequeue */
 
-/* XXX: You must hold "cache_lock" when calling this function! */
-static void rrd_cache_flush(cdtime_t timeout) {
+static void rrd_cache_entry_free(rrd_cache_t *rc) /* {{{ */
+{
+  if (rc == NULL)
+    return;
+
+  sfree(rc->values.buffer);
+  sfree(rc->spare.buffer);
+  sfree(rc);
+} /* }}} void rrd_cache_entry_free */
+
+/* XXX: You must hold the shard's "cache_lock" when calling this function! */
+static void rrd_cache_flush(rrd_shard_t *shard, cdtime_t timeout) {
   rrd_cache_t *rc;
   cdtime_t now;
 
@@ -504,20 +663,24 @@ static void rrd_cache_flush(cdtime_t timeout) {
   DEBUG("rrdtool plugin: Flushing cache, timeout = %.3f",
         CDTIME_T_TO_DOUBLE(timeout));
 
+  if (shard->cache == NULL)
+    return;
+
   now = cdtime();
 
   /* Build a list of entries to be flushed */
-  iter = c_avl_get_iterator(cache);
+  iter = c_avl_get_iterator(shard->cache);
   while (c_avl_iterator_next(iter, (void *)&key, (void *)&rc) == 0) {
     if (rc->flags != FLAG_NONE)
       continue;
     /* timeout == 0  =>  flush everything */
     else if ((timeout != 0) && ((now - rc->first_value) < timeout))
       continue;
-    else if (rc->values_num > 0) {
+    else if (rc->values.values_num > 0) {
       int status;
 
-      status = rrd_queue_enqueue(key, &queue_head, &queue_tail);
+      status = rrd_queue_enqueue(shard, key, &shard->queue_head,
+                                 &shard->queue_tail);
       if (status == 0)
         rc->flags = FLAG_QUEUED;
     } else /* ancient and no values -> waste of memory */
@@ -540,36 +703,31 @@ static void rrd_cache_flush(cdtime_t timeout) {
   c_avl_iterator_destroy(iter);
 
   for (int i = 0; i < keys_num; i++) {
-    if (c_avl_remove(cache, keys[i], (void *)&key, (void *)&rc) != 0) {
+    if (c_avl_remove(shard->cache, keys[i], (void *)&key, (void *)&rc) != 0) {
       DEBUG("rrdtool plugin: c_avl_remove (%s) failed.", keys[i]);
       continue;
     }
 
-    assert(rc->values == NULL);
-    assert(rc->values_num == 0);
+    assert(rc->values.values_num == 0);
 
-    sfree(rc);
+    rrd_cache_entry_free(rc);
     sfree(key);
     keys[i] = NULL;
   } /* for (i = 0..keys_num) */
 
   sfree(keys);
 
-  cache_flush_last = now;
+  shard->cache_flush_last = now;
 } /* void rrd_cache_flush */
 
 static int rrd_cache_flush_identifier(cdtime_t timeout,
                                       const char *identifier) {
+  rrd_shard_t *shard;
   rrd_cache_t *rc;
   cdtime_t now;
   int status;
   char key[2048];
 
-  if (identifier == NULL) {
-    rrd_cache_flush(timeout);
-    return 0;
-  }
-
   now = cdtime();
 
   if (datadir == NULL)
@@ -578,8 +736,17 @@ static int rrd_cache_flush_identifier(cdtime_t timeout,
     ssnprintf(key, sizeof(key), "%s/%s.rrd", datadir, identifier);
   key[sizeof(key) - 1] = 0;
 
-  status = c_avl_get(cache, key, (void *)&rc);
+  shard = rrd_shard_get(key);
+  pthread_mutex_lock(&shard->cache_lock);
+
+  if (shard->cache == NULL) {
+    pthread_mutex_unlock(&shard->cache_lock);
+    return 0;
+  }
+
+  status = c_avl_get(shard->cache, key, (void *)&rc);
   if (status != 0) {
+    pthread_mutex_unlock(&shard->cache_lock);
     INFO("rrdtool plugin: rrd_cache_flush_identifier: "
          "c_avl_get (%s) failed. Does that file really exist?",
          key);
@@ -589,18 +756,21 @@ static int rrd_cache_flush_identifier(cdtime_t timeout,
   if (rc->flags == FLAG_FLUSHQ) {
     status = 0;
   } else if (rc->flags == FLAG_QUEUED) {
-    rrd_queue_dequeue(key, &queue_head, &queue_tail);
-    status = rrd_queue_enqueue(key, &flushq_head, &flushq_tail);
+    rrd_queue_dequeue(shard, key, &shard->queue_head, &shard->queue_tail);
+    status = rrd_queue_enqueue(shard, key, &shard->flushq_head,
+                               &shard->flushq_tail);
     if (status == 0)
       rc->flags = FLAG_FLUSHQ;
   } else if ((now - rc->first_value) < timeout) {
     status = 0;
-  } else if (rc->values_num > 0) {
-    status = rrd_queue_enqueue(key, &flushq_head, &flushq_tail);
+  } else if (rc->values.values_num > 0) {
+    status = rrd_queue_enqueue(shard, key, &shard->flushq_head,
+                               &shard->flushq_tail);
     if (status == 0)
       rc->flags = FLAG_FLUSHQ;
   }
 
+  pthread_mutex_unlock(&shard->cache_lock);
   return status;
 } /* int rrd_cache_flush_identifier */
 
@@ -612,33 +782,36 @@ static int64_t rrd_get_random_variation(void) {
 } /* int64_t rrd_get_random_variation */
 
 static int rrd_cache_insert(const char *filename, const char *value,
-                            cdtime_t value_time) {
+                            cdtime_t value_time, cdtime_t value_interval) {
+  rrd_shard_t *shard;
   rrd_cache_t *rc = NULL;
   int new_rc = 0;
-  char **values_new;
+  int status;
+
+  if (shards == NULL) {
+    WARNING("rrdtool plugin: shards == NULL.");
+    return -1;
+  }
 
-  pthread_mutex_lock(&cache_lock);
+  shard = rrd_shard_get(filename);
+  pthread_mutex_lock(&shard->cache_lock);
 
   /* This shouldn't happen, but it did happen at least once, so we'll be
    * careful. */
-  if (cache == NULL) {
-    pthread_mutex_unlock(&cache_lock);
+  if (shard->cache == NULL) {
+    pthread_mutex_unlock(&shard->cache_lock);
     WARNING("rrdtool plugin: cache == NULL.");
     return -1;
   }
 
-  c_avl_get(cache, filename, (void *)&rc);
+  c_avl_get(shard->cache, filename, (void *)&rc);
 
   if (rc == NULL) {
-    rc = malloc(sizeof(*rc));
+    rc = calloc(1, sizeof(*rc));
     if (rc == NULL) {
-      pthread_mutex_unlock(&cache_lock);
+      pthread_mutex_unlock(&shard->cache_lock);
       return -1;
     }
-    rc->values_num = 0;
-    rc->values = NULL;
-    rc->first_value = 0;
-    rc->last_value = 0;
     rc->random_variation = rrd_get_random_variation();
     rc->flags = FLAG_NONE;
     new_rc = 1;
@@ -646,38 +819,24 @@ static int rrd_cache_insert(const char *filename, const char *value,
 
   assert(value_time > 0); /* plugin_dispatch() ensures this. */
   if (rc->last_value >= value_time) {
-    pthread_mutex_unlock(&cache_lock);
+    pthread_mutex_unlock(&shard->cache_lock);
     DEBUG("rrdtool plugin: (rc->last_value = %" PRIu64 ") "
           ">= (value_time = %" PRIu64 ")",
           rc->last_value, value_time);
     return -1;
   }
 
-  values_new =
-      realloc((void *)rc->values, (rc->values_num + 1) * sizeof(char *));
-  if (values_new == NULL) {
-    char errbuf[1024];
-    void *cache_key = NULL;
-
-    sstrerror(errno, errbuf, sizeof(errbuf));
-
-    c_avl_remove(cache, filename, &cache_key, NULL);
-    pthread_mutex_unlock(&cache_lock);
-
-    ERROR("rrdtool plugin: realloc failed: %s", errbuf);
-
-    sfree(cache_key);
-    sfree(rc->values);
-    sfree(rc);
+  status =
+      rrd_values_append(&rc->values, value, rrd_values_hint(value_interval));
+  if (status != 0) {
+    pthread_mutex_unlock(&shard->cache_lock);
+    ERROR("rrdtool plugin: realloc failed.");
+    if (new_rc)
+      rrd_cache_entry_free(rc);
     return -1;
   }
-  rc->values = values_new;
 
-  rc->values[rc->values_num] = strdup(value);
-  if (rc->values[rc->values_num] != NULL)
-    rc->values_num++;
-
-  if (rc->values_num == 1)
+  if (rc->values.values_num == 1)
     rc->first_value = value_time;
   rc->last_value = value_time;
 
@@ -689,22 +848,20 @@ static int rrd_cache_insert(const char *filename, const char *value,
       char errbuf[1024];
       sstrerror(errno, errbuf, sizeof(errbuf));
 
-      pthread_mutex_unlock(&cache_lock);
+      pthread_mutex_unlock(&shard->cache_lock);
 
       ERROR("rrdtool plugin: strdup failed: %s", errbuf);
 
-      sfree(rc->values[0]);
-      sfree(rc->values);
-      sfree(rc);
+      rrd_cache_entry_free(rc);
       return -1;
     }
 
-    c_avl_insert(cache, cache_key, rc);
+    c_avl_insert(shard->cache, cache_key, rc);
   }
 
   DEBUG("rrdtool plugin: rrd_cache_insert: file = %s; "
         "values_num = %i; age = %.3f;",
-        filename, rc->values_num,
+        filename, rc->values.values_num,
         CDTIME_T_TO_DOUBLE(rc->last_value - rc->first_value));
 
   if ((rc->last_value - rc->first_value) >=
@@ -712,9 +869,8 @@ static int rrd_cache_insert(const char *filename, const char *value,
     /* XXX: If you need to lock both, cache_lock and queue_lock, at
      * the same time, ALWAYS lock `cache_lock' first! */
     if (rc->flags == FLAG_NONE) {
-      int status;
-
-      status = rrd_queue_enqueue(filename, &queue_head, &queue_tail);
+      status = rrd_queue_enqueue(shard, filename, &shard->queue_head,
+                                 &shard->queue_tail);
       if (status == 0)
         rc->flags = FLAG_QUEUED;
 
@@ -725,29 +881,29 @@ static int rrd_cache_insert(const char *filename, const char *value,
   }
 
   if ((cache_timeout > 0) &&
-      ((cdtime() - cache_flush_last) > cache_flush_timeout))
-    rrd_cache_flush(cache_timeout + random_timeout);
+      ((cdtime() - shard->cache_flush_last) > cache_flush_timeout))
+    rrd_cache_flush(shard, cache_timeout + random_timeout);
 
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->cache_lock);
 
   return 0;
 } /* int rrd_cache_insert */
 
-static int rrd_cache_destroy(void) /* {{{ */
+static int rrd_cache_destroy(rrd_shard_t *shard) /* {{{ */
 {
   void *key = NULL;
   void *value = NULL;
 
   int non_empty = 0;
 
-  pthread_mutex_lock(&cache_lock);
+  pthread_mutex_lock(&shard->cache_lock);
 
-  if (cache == NULL) {
-    pthread_mutex_unlock(&cache_lock);
+  if (shard->cache == NULL) {
+    pthread_mutex_unlock(&shard->cache_lock);
     return 0;
   }
 
-  while (c_avl_pick(cache, &key, &value) == 0) {
+  while (c_avl_pick(shard->cache, &key, &value) == 0) {
     rrd_cache_t *rc;
 
     sfree(key);
@@ -756,17 +912,14 @@ static int rrd_cache_destroy(void) /* {{{ */
     rc = value;
     value = NULL;
 
-    if (rc->values_num > 0)
+    if (rc->values.values_num > 0)
       non_empty++;
 
-    for (int i = 0; i < rc->values_num; i++)
-      sfree(rc->values[i]);
-    sfree(rc->values);
-    sfree(rc);
+    rrd_cache_entry_free(rc);
   }
 
-  c_avl_destroy(cache);
-  cache = NULL;
+  c_avl_destroy(shard->cache);
+  shard->cache = NULL;
 
   if (non_empty > 0) {
     INFO("rrdtool plugin: %i cache %s had values when destroying the cache.",
@@ -776,7 +929,7 @@ static int rrd_cache_destroy(void) /* {{{ */
           "when destroying the cache.");
   }
 
-  pthread_mutex_unlock(&cache_lock);
+  pthread_mutex_unlock(&shard->cache_lock);
   return 0;
 } /* }}} int rrd_cache_destroy */
 
@@ -831,26 +984,83 @@ static int rrd_write(const data_set_t *ds, const value_list_t *vl,
     return -1;
   }
 
-  status = rrd_cache_insert(filename, values, vl->time);
+  status = rrd_cache_insert(filename, values, vl->time, vl->interval);
 
   return status;
 } /* int rrd_write */
 
 static int rrd_flush(cdtime_t timeout, const char *identifier,
                      __attribute__((unused)) user_data_t *user_data) {
-  pthread_mutex_lock(&cache_lock);
+  if (shards == NULL)
+    return 0;
 
-  if (cache == NULL) {
-    pthread_mutex_unlock(&cache_lock);
+  if (identifier != NULL) {
+    rrd_cache_flush_identifier(timeout, identifier);
     return 0;
   }
 
-  rrd_cache_flush_identifier(timeout, identifier);
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+
+    pthread_mutex_lock(&shard->cache_lock);
+    rrd_cache_flush(shard, timeout);
+    pthread_mutex_unlock(&shard->cache_lock);
+  }
 
-  pthread_mutex_unlock(&cache_lock);
   return 0;
 } /* int rrd_flush */
 
+static void rrd_stats_submit(const char *type, const char *type_instance,
+                             value_t value) {
+  value_list_t vl = VALUE_LIST_INIT;
+
+  vl.values = &value;
+  vl.values_len = 1;
+  sstrncpy(vl.plugin, "rrdtool", sizeof(vl.plugin));
+  sstrncpy(vl.type, type, sizeof(vl.type));
+  if (type_instance != NULL)
+    sstrncpy(vl.type_instance, type_instance, sizeof(vl.type_instance));
+
+  plugin_dispatch_values(&vl);
+} /* void rrd_stats_submit */
+
+/* Reports the queue length, the number of updates and values written and the
+ * largest "flush lag", i.e. the time between the oldest value of a file
+ * arriving and it being written, seen since the last read. */
+static int rrd_stats_read(void) {
+  size_t queue_length = 0;
+  derive_t updates_written = 0;
+  derive_t values_written = 0;
+  cdtime_t flush_lag = 0;
+
+  if (shards == NULL)
+    return -1;
+
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+
+    pthread_mutex_lock(&shard->queue_lock);
+    queue_length += shard->queue_length;
+    updates_written += shard->updates_written;
+    values_written += shard->values_written;
+    if (shard->flush_lag > flush_lag)
+      flush_lag = shard->flush_lag;
+    shard->flush_lag = 0;
+    pthread_mutex_unlock(&shard->queue_lock);
+  }
+
+  rrd_stats_submit("queue_length", NULL,
+                   (value_t){.gauge = (gauge_t)queue_length});
+  rrd_stats_submit("operations", "write-updates",
+                   (value_t){.derive = updates_written});
+  rrd_stats_submit("operations", "write-values",
+                   (value_t){.derive = values_written});
+  rrd_stats_submit("duration", "flush_lag",
+                   (value_t){.gauge = CDTIME_T_TO_DOUBLE(flush_lag)});
+
+  return 0;
+} /* int rrd_stats_read */
+
 static int rrd_config(const char *key, const char *value) {
   if (strcasecmp("CacheTimeout", key) == 0) {
     double tmp = atof(value);
@@ -991,6 +1201,18 @@ static int rrd_config(const char *key, const char *value) {
     } else {
       random_timeout = DOUBLE_TO_CDTIME_T(tmp);
     }
+  } else if (strcasecmp("WriteThreads", key) == 0) {
+    int tmp = atoi(value);
+    if (tmp < 1) {
+      fprintf(stderr, "rrdtool: `WriteThreads' must "
+                      "be greater than 0.\n");
+      ERROR("rrdtool: `WriteThreads' must "
+            "be greater than 0.");
+      return 1;
+    }
+    write_threads = (size_t)tmp;
+  } else if (strcasecmp("CollectStatistics", key) == 0) {
+    collect_statistics = IS_TRUE(value) ? 1 : 0;
   } else {
     return -1;
   }
@@ -998,39 +1220,60 @@ static int rrd_config(const char *key, const char *value) {
 } /* int rrd_config */
 
 static int rrd_shutdown(void) {
-  pthread_mutex_lock(&cache_lock);
-  rrd_cache_flush(0);
-  pthread_mutex_unlock(&cache_lock);
+  _Bool queued = 0;
+  _Bool running = 0;
+
+  if (shards == NULL)
+    return 0;
+
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+
+    pthread_mutex_lock(&shard->cache_lock);
+    rrd_cache_flush(shard, 0);
+    pthread_mutex_unlock(&shard->cache_lock);
+  }
 
-  pthread_mutex_lock(&queue_lock);
   do_shutdown = 1;
-  pthread_cond_signal(&queue_cond);
-  pthread_mutex_unlock(&queue_lock);
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+
+    pthread_mutex_lock(&shard->queue_lock);
+    shard->shutdown = 1;
+    if ((shard->queue_head != NULL) || (shard->flushq_head != NULL))
+      queued = 1;
+    if (shard->queue_thread_running != 0)
+      running = 1;
+    pthread_cond_signal(&shard->queue_cond);
+    pthread_mutex_unlock(&shard->queue_lock);
+  }
 
-  if ((queue_thread_running != 0) &&
-      ((queue_head != NULL) || (flushq_head != NULL))) {
-    INFO("rrdtool plugin: Shutting down the queue thread. "
+  if (running && queued) {
+    INFO("rrdtool plugin: Shutting down the queue threads. "
          "This may take a while.");
-  } else if (queue_thread_running != 0) {
-    INFO("rrdtool plugin: Shutting down the queue thread.");
+  } else if (running) {
+    INFO("rrdtool plugin: Shutting down the queue threads.");
   }
 
   /* Wait for all the values to be written to disk before returning. */
-  if (queue_thread_running != 0) {
-    pthread_join(queue_thread, NULL);
-    memset(&queue_thread, 0, sizeof(queue_thread));
-    queue_thread_running = 0;
-    DEBUG("rrdtool plugin: queue_thread exited.");
-  }
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+
+    if (shard->queue_thread_running != 0) {
+      pthread_join(shard->queue_thread, NULL);
+      memset(&shard->queue_thread, 0, sizeof(shard->queue_thread));
+      shard->queue_thread_running = 0;
+      DEBUG("rrdtool plugin: queue_thread #%zu exited.", i);
+    }
 
-  rrd_cache_destroy();
+    rrd_cache_destroy(shard);
+  }
 
   return 0;
 } /* int rrd_shutdown */
 
 static int rrd_init(void) {
   static int init_once = 0;
-  int status;
 
   if (init_once != 0)
     return 0;
@@ -1039,17 +1282,6 @@ static int rrd_init(void) {
   if (rrdcreate_config.heartbeat <= 0)
     rrdcreate_config.heartbeat = 2 * rrdcreate_config.stepsize;
 
-  /* Set the cache up */
-  pthread_mutex_lock(&cache_lock);
-
-  cache = c_avl_create((int (*)(const void *, const void *))strcmp);
-  if (cache == NULL) {
-    pthread_mutex_unlock(&cache_lock);
-    ERROR("rrdtool plugin: c_avl_create failed.");
-    return -1;
-  }
-
-  cache_flush_last = cdtime();
   if (cache_timeout == 0) {
     random_timeout = 0;
     cache_flush_timeout = 0;
@@ -1069,22 +1301,57 @@ static int rrd_init(void) {
     random_timeout = cache_timeout;
   }
 
-  pthread_mutex_unlock(&cache_lock);
-
-  status =
-      plugin_thread_create(&queue_thread, /* attr = */ NULL, rrd_queue_thread,
-                           /* args = */ NULL, "rrdtool queue");
-  if (status != 0) {
-    ERROR("rrdtool plugin: Cannot create queue-thread.");
+  /* Set the caches up */
+  shards = calloc(write_threads, sizeof(*shards));
+  if (shards == NULL) {
+    ERROR("rrdtool plugin: calloc failed.");
     return -1;
   }
-  queue_thread_running = 1;
+  shards_num = write_threads;
+
+  for (size_t i = 0; i < shards_num; i++) {
+    pthread_mutex_init(&shards[i].cache_lock, /* attr = */ NULL);
+    pthread_mutex_init(&shards[i].queue_lock, /* attr = */ NULL);
+    pthread_cond_init(&shards[i].queue_cond, /* attr = */ NULL);
+  }
+
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+
+    shard->cache = c_avl_create((int (*)(const void *, const void *))strcmp);
+    if (shard->cache == NULL) {
+      ERROR("rrdtool plugin: c_avl_create failed.");
+      rrd_shutdown();
+      return -1;
+    }
+    shard->cache_flush_last = cdtime();
+  }
+
+  for (size_t i = 0; i < shards_num; i++) {
+    rrd_shard_t *shard = shards + i;
+    int status;
+
+    status = plugin_thread_create(&shard->queue_thread, /* attr = */ NULL,
+                                  rrd_queue_thread, /* args = */ shard,
+                                  "rrdtool queue");
+    if (status != 0) {
+      ERROR("rrdtool plugin: Cannot create queue-thread.");
+      /* Stops the threads started so far. Values written from now on are
+       * ignored. */
+      rrd_shutdown();
+      return -1;
+    }
+    shard->queue_thread_running = 1;
+  }
+
+  if (collect_statistics)
+    plugin_register_read("rrdtool", rrd_stats_read);
 
   DEBUG("rrdtool plugin: rrd_init: datadir = %s; stepsize = %lu;"
-        " heartbeat = %i; rrarows = %i; xff = %lf;",
+        " heartbeat = %i; rrarows = %i; xff = %lf; write threads = %zu;",
         (datadir == NULL) ? "(null)" : datadir, rrdcreate_config.stepsize,
         rrdcreate_config.heartbeat, rrdcreate_config.rrarows,
-        rrdcreate_config.xff);
+        rrdcreate_config.xff, shards_num);
 
   return 0;
 } /* int rrd_init */
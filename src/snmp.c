@@ -33,6 +33,7 @@
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 
+#include <fcntl.h>
 #include <fnmatch.h>
 
 /*
@@ -91,6 +92,24 @@ struct host_definition_s {
   cdtime_t interval;
   data_definition_t **data_list;
   int data_list_len;
+
+  /* GETBULK: "MaxRepetitions" is the configured upper bound, zero disables
+   * GETBULK. "bulk_size" is the number of repetitions currently requested;
+   * it grows while tables are longer than a response and shrinks on errors.
+   * "bulk_limit" is lowered when the agent finds a response too big. */
+  int max_repetitions;
+  int bulk_size;
+  int bulk_limit;
+
+  /* Asynchronous polling, see csnmp_engine_thread(). "poll_state" and
+   * "poll_complaint" are protected by the engine's lock, the other members
+   * are only used by the engine thread. */
+  struct csnmp_engine_s *engine;
+  enum { CSNMP_POLL_IDLE, CSNMP_POLL_QUEUED, CSNMP_POLL_ACTIVE } poll_state;
+  c_complain_t poll_complaint;
+  int requests_pending;
+  _Bool poll_failed;
+  struct host_definition_s *poll_next;
 };
 typedef struct host_definition_s host_definition_t;
 
@@ -110,15 +129,95 @@ struct csnmp_table_values_s {
 };
 typedef struct csnmp_table_values_s csnmp_table_values_t;
 
+/* The rows of a table walk are allocated from an arena and released all at
+ * once when the walk is done, rather than with one malloc per row. */
+struct csnmp_arena_chunk_s {
+  struct csnmp_arena_chunk_s *next;
+  size_t size;
+  size_t used;
+  char data[];
+};
+typedef struct csnmp_arena_chunk_s csnmp_arena_chunk_t;
+
+struct csnmp_arena_s {
+  csnmp_arena_chunk_t *head;
+};
+typedef struct csnmp_arena_s csnmp_arena_t;
+
+#define CSNMP_ARENA_CHUNK_SIZE 65536
+
+/* State of walking one table with GETNEXT or GETBULK requests. */
+struct csnmp_walk_s {
+  host_definition_t *host;
+  data_definition_t *data;
+  const data_set_t *ds;
+
+  /* Holds the last OID returned by the device for each column. We use this
+   * in the next request to proceed. */
+  oid_t *oid_list;
+  /* Set to false when an OID has left its subtree so we don't re-request it
+   * again. */
+  _Bool *oid_list_todo;
+  size_t oid_list_len;
+
+  /* The columns of the outstanding request, in order. */
+  size_t *req_cols;
+  size_t req_cols_num;
+  int req_bulk_size;
+
+  /* `value_list_head' and `value_list_tail' implement a linked list for each
+   * value. `instance_list_head' and `instance_list_tail' implement a linked
+   * list of instance names. This is used to jump gaps in the table. */
+  csnmp_list_instances_t *instance_list_head;
+  csnmp_list_instances_t *instance_list_tail;
+  csnmp_table_values_t **value_list_head;
+  csnmp_table_values_t **value_list_tail;
+
+  csnmp_arena_t arena;
+};
+typedef struct csnmp_walk_s csnmp_walk_t;
+
+/* An engine thread polls its hosts with the asynchronous Net-SNMP API. */
+struct csnmp_engine_s {
+  pthread_t thread;
+  _Bool thread_running;
+  int wakeup_fd[2];
+
+  pthread_mutex_t lock;
+  _Bool shutdown;
+  /* Hosts waiting to be polled. Protected by `lock'. */
+  host_definition_t *queue_head;
+  host_definition_t *queue_tail;
+
+  /* Hosts being polled. Only used by the engine thread. */
+  host_definition_t *active;
+};
+typedef struct csnmp_engine_s csnmp_engine_t;
+
+/* One outstanding GET or table walk of an asynchronous poll. */
+struct csnmp_request_s {
+  host_definition_t *host;
+  data_definition_t *data;
+  csnmp_walk_t walk;
+};
+typedef struct csnmp_request_s csnmp_request_t;
+
 /*
  * Private variables
  */
 static data_definition_t *data_head = NULL;
 
+static int async_threads = 0;
+static csnmp_engine_t *engines = NULL;
+static size_t engines_num = 0;
+static size_t engines_next = 0;
+static pthread_mutex_t engines_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * Prototypes
  */
 static int csnmp_read_host(user_data_t *ud);
+static void csnmp_engines_stop(void);
 
 /*
  * Private functions
@@ -183,6 +282,10 @@ static void csnmp_host_definition_destroy(void *arg) /* {{{ */
     DEBUG("snmp plugin: Destroying host definition for host `%s'.", hd->name);
   }
 
+  /* The engine threads may still be using this host. */
+  if (hd->engine != NULL)
+    csnmp_engines_stop();
+
   csnmp_host_close_session(hd);
 
   sfree(hd->name);
@@ -587,6 +690,7 @@ static int csnmp_config_add_host(oconfig_item_t *ci) {
     return -1;
   hd->version = 2;
   C_COMPLAIN_INIT(&hd->complaint);
+  C_COMPLAIN_INIT(&hd->poll_complaint);
 
   status = cf_util_get_string(ci, &hd->name);
   if (status != 0) {
@@ -625,6 +729,8 @@ static int csnmp_config_add_host(oconfig_item_t *ci) {
       status = csnmp_config_add_host_security_level(hd, option);
     else if (strcasecmp("Context", option->key) == 0)
       status = cf_util_get_string(option, &hd->context);
+    else if (strcasecmp("MaxRepetitions", option->key) == 0)
+      status = cf_util_get_int(option, &hd->max_repetitions);
     else {
       WARNING(
           "snmp plugin: csnmp_config_add_host: Option `%s' not allowed here.",
@@ -642,6 +748,13 @@ static int csnmp_config_add_host(oconfig_item_t *ci) {
       status = -1;
       break;
     }
+    if (hd->max_repetitions < 0) {
+      WARNING("snmp plugin: `MaxRepetitions' must not be negative for host "
+              "`%s'",
+              hd->name);
+      status = -1;
+      break;
+    }
     if (hd->community == NULL && hd->version < 3) {
       WARNING("snmp plugin: `Community' not given for host `%s'", hd->name);
       status = -1;
@@ -698,9 +811,13 @@ static int csnmp_config_add_host(oconfig_item_t *ci) {
     return -1;
   }
 
+  hd->bulk_size = (hd->max_repetitions < 8) ? hd->max_repetitions : 8;
+  hd->bulk_limit = hd->max_repetitions;
+
   DEBUG("snmp plugin: hd = { name = %s, address = %s, community = %s, version "
-        "= %i }",
-        hd->name, hd->address, hd->community, hd->version);
+        "= %i, max_repetitions = %i }",
+        hd->name, hd->address, hd->community, hd->version,
+        hd->max_repetitions);
 
   ssnprintf(cb_name, sizeof(cb_name), "snmp-%s", hd->name);
 
@@ -726,7 +843,13 @@ static int csnmp_config(oconfig_item_t *ci) {
       csnmp_config_add_data(child);
     else if (strcasecmp("Host", child->key) == 0)
       csnmp_config_add_host(child);
-    else {
+    else if (strcasecmp("AsyncThreads", child->key) == 0) {
+      if ((cf_util_get_int(child, &async_threads) != 0) ||
+          (async_threads < 0)) {
+        WARNING("snmp plugin: `AsyncThreads' must be a non-negative number.");
+        async_threads = 0;
+      }
+    } else {
       WARNING("snmp plugin: Ignoring unknown config option `%s'.", child->key);
     }
   } /* for (ci->children) */
@@ -1023,51 +1146,67 @@ static int csnmp_strvbcopy(char *dst, /* {{{ */
   return 0;
 } /* }}} int csnmp_strvbcopy */
 
-static int csnmp_instance_list_add(csnmp_list_instances_t **head,
-                                   csnmp_list_instances_t **tail,
-                                   const struct snmp_pdu *res,
-                                   const host_definition_t *hd,
-                                   const data_definition_t *dd) {
-  csnmp_list_instances_t *il;
-  struct variable_list *vb;
+static void *csnmp_arena_alloc(csnmp_arena_t *arena, size_t size) /* {{{ */
+{
+  csnmp_arena_chunk_t *chunk = arena->head;
+  void *ptr;
+
+  /* Keep all allocations aligned for the oid and value_t members. */
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  if ((chunk == NULL) || ((chunk->size - chunk->used) < size)) {
+    size_t chunk_size =
+        (size > CSNMP_ARENA_CHUNK_SIZE) ? size : CSNMP_ARENA_CHUNK_SIZE;
+
+    chunk = calloc(1, sizeof(*chunk) + chunk_size);
+    if (chunk == NULL)
+      return NULL;
+    chunk->size = chunk_size;
+    chunk->next = arena->head;
+    arena->head = chunk;
+  }
+
+  ptr = chunk->data + chunk->used;
+  chunk->used += size;
+  return ptr;
+} /* }}} void *csnmp_arena_alloc */
+
+static void csnmp_arena_free(csnmp_arena_t *arena) /* {{{ */
+{
+  while (arena->head != NULL) {
+    csnmp_arena_chunk_t *next = arena->head->next;
+    sfree(arena->head);
+    arena->head = next;
+  }
+} /* }}} void csnmp_arena_free */
+
+static int csnmp_instance_list_add(csnmp_walk_t *walk,
+                                   const struct variable_list *vb) {
+  const host_definition_t *hd = walk->host;
+  const data_definition_t *dd = walk->data;
+  csnmp_list_instances_t il = {.next = NULL};
+  csnmp_list_instances_t *il_ptr;
   oid_t vb_name;
   int status;
   uint32_t is_matched;
 
-  /* Set vb on the last variable */
-  for (vb = res->variables; (vb != NULL) && (vb->next_variable != NULL);
-       vb = vb->next_variable)
-    /* do nothing */;
-  if (vb == NULL)
-    return -1;
-
   csnmp_oid_init(&vb_name, vb->name, vb->name_length);
 
-  il = calloc(1, sizeof(*il));
-  if (il == NULL) {
-    ERROR("snmp plugin: calloc failed.");
-    return -1;
-  }
-  il->next = NULL;
-
-  status = csnmp_oid_suffix(&il->suffix, &vb_name, &dd->instance.oid);
-  if (status != 0) {
-    sfree(il);
+  status = csnmp_oid_suffix(&il.suffix, &vb_name, &dd->instance.oid);
+  if (status != 0)
     return status;
-  }
 
   /* Get instance name */
   if ((vb->type == ASN_OCTET_STR) || (vb->type == ASN_BIT_STR) ||
       (vb->type == ASN_IPADDRESS)) {
     char *ptr;
 
-    csnmp_strvbcopy(il->instance, vb, sizeof(il->instance));
+    csnmp_strvbcopy(il.instance, vb, sizeof(il.instance));
     is_matched = 0;
     for (uint32_t i = 0; i < dd->ignores_len; i++) {
-      status = fnmatch(dd->ignores[i], il->instance, 0);
+      status = fnmatch(dd->ignores[i], il.instance, 0);
       if (status == 0) {
         if (dd->invert_match == 0) {
-          sfree(il);
           return 0;
         } else {
           is_matched = 1;
@@ -1076,30 +1215,34 @@ static int csnmp_instance_list_add(csnmp_list_instances_t **head,
       }
     }
     if (dd->invert_match != 0 && is_matched == 0) {
-      sfree(il);
       return 0;
     }
-    for (ptr = il->instance; *ptr != '\0'; ptr++) {
+    for (ptr = il.instance; *ptr != '\0'; ptr++) {
       if ((*ptr > 0) && (*ptr < 32))
         *ptr = ' ';
       else if (*ptr == '/')
         *ptr = '_';
     }
-    DEBUG("snmp plugin: il->instance = `%s';", il->instance);
+    DEBUG("snmp plugin: il->instance = `%s';", il.instance);
   } else {
     value_t val = csnmp_value_list_to_value(
-        vb, DS_TYPE_COUNTER,
+        (struct variable_list *)vb, DS_TYPE_COUNTER,
         /* scale = */ 1.0, /* shift = */ 0.0, hd->name, dd->name);
-    ssnprintf(il->instance, sizeof(il->instance), "%llu", val.counter);
+    ssnprintf(il.instance, sizeof(il.instance), "%llu", val.counter);
   }
 
-  /* TODO: Debugging output */
+  il_ptr = csnmp_arena_alloc(&walk->arena, sizeof(*il_ptr));
+  if (il_ptr == NULL) {
+    ERROR("snmp plugin: calloc failed.");
+    return -1;
+  }
+  memcpy(il_ptr, &il, sizeof(*il_ptr));
 
-  if (*head == NULL)
-    *head = il;
+  if (walk->instance_list_head == NULL)
+    walk->instance_list_head = il_ptr;
   else
-    (*tail)->next = il;
-  *tail = il;
+    walk->instance_list_tail->next = il_ptr;
+  walk->instance_list_tail = il_ptr;
 
   return 0;
 } /* int csnmp_instance_list_add */
@@ -1251,109 +1394,279 @@ static int csnmp_dispatch_table(host_definition_t *host,
   return (0);
 } /* int csnmp_dispatch_table */
 
-static int csnmp_read_table(host_definition_t *host, data_definition_t *data) {
-  struct snmp_pdu *req;
-  struct snmp_pdu *res = NULL;
-  struct variable_list *vb;
-
-  const data_set_t *ds;
+/* Returns the number of repetitions to request with GETBULK, or zero if
+ * GETNEXT is to be used. */
+static int csnmp_host_bulk_size(host_definition_t const *host) /* {{{ */
+{
+  if ((host->version == 1) || (host->max_repetitions <= 0))
+    return 0;
 
-  size_t oid_list_len = data->values_len + 1;
-  /* Holds the last OID returned by the device. We use this in the GETNEXT
-   * request to proceed. */
-  oid_t oid_list[oid_list_len];
-  /* Set to false when an OID has left its subtree so we don't re-request it
-   * again. */
-  _Bool oid_list_todo[oid_list_len];
+  return host->bulk_size;
+} /* }}} int csnmp_host_bulk_size */
 
-  int status;
-  size_t i;
+static void csnmp_host_bulk_adapt(host_definition_t *host, /* {{{ */
+                                  _Bool grow) {
+  if (grow)
+    host->bulk_size *= 2;
+  else
+    host->bulk_size /= 2;
 
-  /* `value_list_head' and `value_list_tail' implement a linked list for each
-   * value. `instance_list_head' and `instance_list_tail' implement a linked
-   * list of
-   * instance names. This is used to jump gaps in the table. */
-  csnmp_list_instances_t *instance_list_head;
-  csnmp_list_instances_t *instance_list_tail;
-  csnmp_table_values_t **value_list_head;
-  csnmp_table_values_t **value_list_tail;
+  if (host->bulk_size > host->bulk_limit)
+    host->bulk_size = host->bulk_limit;
+  if (host->bulk_size < 1)
+    host->bulk_size = 1;
+} /* }}} void csnmp_host_bulk_adapt */
 
-  DEBUG("snmp plugin: csnmp_read_table (host = %s, data = %s)", host->name,
-        data->name);
+static int csnmp_walk_init(csnmp_walk_t *walk, /* {{{ */
+                           host_definition_t *host, data_definition_t *data) {
+  size_t len = data->values_len + 1;
 
-  if (host->sess_handle == NULL) {
-    DEBUG("snmp plugin: csnmp_read_table: host->sess_handle == NULL");
-    return -1;
-  }
+  memset(walk, 0, sizeof(*walk));
+  walk->host = host;
+  walk->data = data;
 
-  ds = plugin_get_ds(data->type);
-  if (!ds) {
+  walk->ds = plugin_get_ds(data->type);
+  if (!walk->ds) {
     ERROR("snmp plugin: DataSet `%s' not defined.", data->type);
     return -1;
   }
 
-  if (ds->ds_num != data->values_len) {
+  if (walk->ds->ds_num != data->values_len) {
     ERROR("snmp plugin: DataSet `%s' requires %zu values, but config talks "
           "about %zu",
-          data->type, ds->ds_num, data->values_len);
+          data->type, walk->ds->ds_num, data->values_len);
     return -1;
   }
   assert(data->values_len > 0);
 
+  walk->oid_list = csnmp_arena_alloc(&walk->arena, len * sizeof(oid_t));
+  walk->oid_list_todo = csnmp_arena_alloc(&walk->arena, len * sizeof(_Bool));
+  walk->req_cols = csnmp_arena_alloc(&walk->arena, len * sizeof(size_t));
+  walk->value_list_head = csnmp_arena_alloc(
+      &walk->arena, data->values_len * sizeof(*walk->value_list_head));
+  walk->value_list_tail = csnmp_arena_alloc(
+      &walk->arena, data->values_len * sizeof(*walk->value_list_tail));
+  if ((walk->oid_list == NULL) || (walk->oid_list_todo == NULL) ||
+      (walk->req_cols == NULL) || (walk->value_list_head == NULL) ||
+      (walk->value_list_tail == NULL)) {
+    ERROR("snmp plugin: csnmp_walk_init: calloc failed.");
+    csnmp_arena_free(&walk->arena);
+    return -1;
+  }
+
   /* We need a copy of all the OIDs, because GETNEXT will destroy them. */
-  memcpy(oid_list, data->values, data->values_len * sizeof(oid_t));
+  memcpy(walk->oid_list, data->values, data->values_len * sizeof(oid_t));
+  walk->oid_list_len = len;
   if (data->instance.oid.oid_len > 0)
-    memcpy(oid_list + data->values_len, &data->instance.oid, sizeof(oid_t));
+    memcpy(walk->oid_list + data->values_len, &data->instance.oid,
+           sizeof(oid_t));
   else /* no InstanceFrom option specified. */
-    oid_list_len--;
-
-  for (i = 0; i < oid_list_len; i++)
-    oid_list_todo[i] = 1;
-
-  /* We're going to construct n linked lists, one for each "value".
-   * value_list_head will contain pointers to the heads of these linked lists,
-   * value_list_tail will contain pointers to the tail of the lists. */
-  value_list_head = calloc(data->values_len, sizeof(*value_list_head));
-  value_list_tail = calloc(data->values_len, sizeof(*value_list_tail));
-  if ((value_list_head == NULL) || (value_list_tail == NULL)) {
-    ERROR("snmp plugin: csnmp_read_table: calloc failed.");
-    sfree(value_list_head);
-    sfree(value_list_tail);
+    walk->oid_list_len--;
+
+  for (size_t i = 0; i < walk->oid_list_len; i++)
+    walk->oid_list_todo[i] = 1;
+
+  return 0;
+} /* }}} int csnmp_walk_init */
+
+/* Creates the next request of a table walk. Sets "ret" to NULL if all
+ * columns have left their subtree, i.e. the walk is complete. */
+static int csnmp_walk_request(csnmp_walk_t *walk, /* {{{ */
+                              struct snmp_pdu **ret) {
+  struct snmp_pdu *req;
+  int bulk_size = csnmp_host_bulk_size(walk->host);
+
+  *ret = NULL;
+
+  walk->req_cols_num = 0;
+  for (size_t i = 0; i < walk->oid_list_len; i++) {
+    /* Do not rerequest already finished OIDs */
+    if (walk->oid_list_todo[i])
+      walk->req_cols[walk->req_cols_num++] = i;
+  }
+
+  if (walk->req_cols_num == 0) {
+    DEBUG("snmp plugin: all variables have left their subtree");
+    return 0;
+  }
+
+  req = snmp_pdu_create((bulk_size > 0) ? SNMP_MSG_GETBULK : SNMP_MSG_GETNEXT);
+  if (req == NULL) {
+    ERROR("snmp plugin: snmp_pdu_create failed.");
     return -1;
   }
 
-  instance_list_head = NULL;
-  instance_list_tail = NULL;
+  if (bulk_size > 0) {
+    req->non_repeaters = 0;
+    req->max_repetitions = bulk_size;
+  }
+  walk->req_bulk_size = bulk_size;
 
-  status = 0;
-  while (status == 0) {
-    int oid_list_todo_num;
+  for (size_t i = 0; i < walk->req_cols_num; i++) {
+    oid_t const *o = walk->oid_list + walk->req_cols[i];
+    snmp_add_null_var(req, o->oid, o->oid_len);
+  }
 
-    req = snmp_pdu_create(SNMP_MSG_GETNEXT);
-    if (req == NULL) {
-      ERROR("snmp plugin: snmp_pdu_create failed.");
-      status = -1;
-      break;
-    }
+  *ret = req;
+  return 0;
+} /* }}} int csnmp_walk_request */
+
+/* Adds the variables of a GETNEXT or GETBULK response to the walk. In a
+ * GETBULK response the requested columns repeat, one row after another. */
+static int csnmp_walk_process(csnmp_walk_t *walk, /* {{{ */
+                              const struct snmp_pdu *res) {
+  host_definition_t *host = walk->host;
+  data_definition_t *data = walk->data;
+  struct variable_list *vb;
+  size_t vb_num = 0;
+
+  if (res->variables == NULL)
+    return -1;
+
+  for (vb = res->variables; vb != NULL; vb = vb->next_variable, vb_num++) {
+    size_t i = walk->req_cols[vb_num % walk->req_cols_num];
+
+    /* The column has left its subtree earlier in this response. */
+    if (!walk->oid_list_todo[i])
+      continue;
 
-    oid_list_todo_num = 0;
-    for (i = 0; i < oid_list_len; i++) {
-      /* Do not rerequest already finished OIDs */
-      if (!oid_list_todo[i])
+    /* An instance is configured and the res variable we process is the
+     * instance value (last index) */
+    if ((data->instance.oid.oid_len > 0) && (i == data->values_len)) {
+      if ((vb->type == SNMP_ENDOFMIBVIEW) ||
+          (snmp_oid_ncompare(data->instance.oid.oid, data->instance.oid.oid_len,
+                             vb->name, vb->name_length,
+                             data->instance.oid.oid_len) != 0)) {
+        DEBUG("snmp plugin: host = %s; data = %s; Instance left its subtree.",
+              host->name, data->name);
+        walk->oid_list_todo[i] = 0;
         continue;
-      oid_list_todo_num++;
-      snmp_add_null_var(req, oid_list[i].oid, oid_list[i].oid_len);
+      }
+
+      /* Allocate a new `csnmp_list_instances_t', insert the instance name and
+       * add it to the list */
+      if (csnmp_instance_list_add(walk, vb) != 0) {
+        ERROR("snmp plugin: host %s: csnmp_instance_list_add failed.",
+              host->name);
+        return -1;
+      }
+    } else /* The variable we are processing is a normal value */
+    {
+      csnmp_table_values_t *vt;
+      oid_t vb_name;
+      oid_t suffix;
+      int ret;
+
+      csnmp_oid_init(&vb_name, vb->name, vb->name_length);
+
+      /* Calculate the current suffix. This is later used to check that the
+       * suffix is increasing. This also checks if we left the subtree */
+      ret = csnmp_oid_suffix(&suffix, &vb_name, data->values + i);
+      if (ret != 0) {
+        DEBUG("snmp plugin: host = %s; data = %s; i = %zu; "
+              "Value probably left its subtree.",
+              host->name, data->name, i);
+        walk->oid_list_todo[i] = 0;
+        continue;
+      }
+
+      /* Make sure the OIDs returned by the agent are increasing. Otherwise
+       * our table matching algorithm will get confused. */
+      if ((walk->value_list_tail[i] != NULL) &&
+          (csnmp_oid_compare(&suffix, &walk->value_list_tail[i]->suffix) <=
+           0)) {
+        DEBUG("snmp plugin: host = %s; data = %s; i = %zu; "
+              "Suffix is not increasing.",
+              host->name, data->name, i);
+        walk->oid_list_todo[i] = 0;
+        continue;
+      }
+
+      vt = csnmp_arena_alloc(&walk->arena, sizeof(*vt));
+      if (vt == NULL) {
+        ERROR("snmp plugin: calloc failed.");
+        return -1;
+      }
+
+      vt->value =
+          csnmp_value_list_to_value(vb, walk->ds->ds[i].type, data->scale,
+                                    data->shift, host->name, data->name);
+      memcpy(&vt->suffix, &suffix, sizeof(vt->suffix));
+      vt->next = NULL;
+
+      if (walk->value_list_tail[i] == NULL)
+        walk->value_list_head[i] = vt;
+      else
+        walk->value_list_tail[i]->next = vt;
+      walk->value_list_tail[i] = vt;
     }
 
-    if (oid_list_todo_num == 0) {
-      /* The request is still empty - so we are finished */
-      DEBUG("snmp plugin: all variables have left their subtree");
-      status = 0;
+    /* Copy OID to oid_list[i] */
+    memcpy(walk->oid_list[i].oid, vb->name, sizeof(oid) * vb->name_length);
+    walk->oid_list[i].oid_len = vb->name_length;
+  } /* for (vb = res->variables ...) */
+
+  /* A full GETBULK response means the table is longer than what we asked
+   * for: ask for more next time. */
+  if ((walk->req_bulk_size > 0) &&
+      (vb_num >= walk->req_cols_num * (size_t)walk->req_bulk_size))
+    csnmp_host_bulk_adapt(host, /* grow = */ 1);
+
+  return 0;
+} /* }}} int csnmp_walk_process */
+
+/* Handles a response to csnmp_walk_request(). If the agent found a GETBULK
+ * response too big, the same request is repeated with fewer repetitions. */
+static int csnmp_walk_response(csnmp_walk_t *walk, /* {{{ */
+                               const struct snmp_pdu *res) {
+  if ((res->errstat == SNMP_ERR_TOOBIG) && (walk->req_bulk_size > 1)) {
+    DEBUG("snmp plugin: host = %s; data = %s; Response too big with %i "
+          "repetitions.",
+          walk->host->name, walk->data->name, walk->req_bulk_size);
+    walk->host->bulk_limit = walk->req_bulk_size - 1;
+    csnmp_host_bulk_adapt(walk->host, /* grow = */ 0);
+    return 0;
+  }
+
+  return csnmp_walk_process(walk, res);
+} /* }}} int csnmp_walk_response */
+
+static void csnmp_walk_finish(csnmp_walk_t *walk, _Bool dispatch) /* {{{ */
+{
+  if (dispatch)
+    csnmp_dispatch_table(walk->host, walk->data, walk->instance_list_head,
+                         walk->value_list_head);
+
+  csnmp_arena_free(&walk->arena);
+} /* }}} void csnmp_walk_finish */
+
+static int csnmp_read_table(host_definition_t *host, data_definition_t *data) {
+  csnmp_walk_t walk;
+  int status;
+
+  DEBUG("snmp plugin: csnmp_read_table (host = %s, data = %s)", host->name,
+        data->name);
+
+  if (host->sess_handle == NULL) {
+    DEBUG("snmp plugin: csnmp_read_table: host->sess_handle == NULL");
+    return -1;
+  }
+
+  if (csnmp_walk_init(&walk, host, data) != 0)
+    return -1;
+
+  status = 0;
+  while (status == 0) {
+    struct snmp_pdu *req = NULL;
+    struct snmp_pdu *res = NULL;
+
+    status = csnmp_walk_request(&walk, &req);
+    if ((status != 0) || (req == NULL))
       break;
-    }
 
-    res = NULL;
     status = snmp_sess_synch_response(host->sess_handle, req, &res);
+    /* snmp_synch_response already freed our PDU */
+    req = NULL;
     if ((status != STAT_SUCCESS) || (res == NULL)) {
       char *errstr = NULL;
 
@@ -1367,187 +1680,73 @@ static int csnmp_read_table(host_definition_t *host, data_definition_t *data) {
         snmp_free_pdu(res);
       res = NULL;
 
-      /* snmp_synch_response already freed our PDU */
-      req = NULL;
       sfree(errstr);
       csnmp_host_close_session(host);
+      if (walk.req_bulk_size > 0)
+        csnmp_host_bulk_adapt(host, /* grow = */ 0);
 
       status = -1;
       break;
     }
 
-    status = 0;
-    assert(res != NULL);
     c_release(LOG_INFO, &host->complaint,
               "snmp plugin: host %s: snmp_sess_synch_response successful.",
               host->name);
 
-    vb = res->variables;
-    if (vb == NULL) {
-      status = -1;
-      break;
-    }
-
-    for (vb = res->variables, i = 0; (vb != NULL);
-         vb = vb->next_variable, i++) {
-      /* Calculate value index from todo list */
-      while ((i < oid_list_len) && !oid_list_todo[i])
-        i++;
-
-      /* An instance is configured and the res variable we process is the
-       * instance value (last index) */
-      if ((data->instance.oid.oid_len > 0) && (i == data->values_len)) {
-        if ((vb->type == SNMP_ENDOFMIBVIEW) ||
-            (snmp_oid_ncompare(
-                 data->instance.oid.oid, data->instance.oid.oid_len, vb->name,
-                 vb->name_length, data->instance.oid.oid_len) != 0)) {
-          DEBUG("snmp plugin: host = %s; data = %s; Instance left its subtree.",
-                host->name, data->name);
-          oid_list_todo[i] = 0;
-          continue;
-        }
-
-        /* Allocate a new `csnmp_list_instances_t', insert the instance name and
-         * add it to the list */
-        if (csnmp_instance_list_add(&instance_list_head, &instance_list_tail,
-                                    res, host, data) != 0) {
-          ERROR("snmp plugin: host %s: csnmp_instance_list_add failed.",
-                host->name);
-          status = -1;
-          break;
-        }
-      } else /* The variable we are processing is a normal value */
-      {
-        csnmp_table_values_t *vt;
-        oid_t vb_name;
-        oid_t suffix;
-        int ret;
-
-        csnmp_oid_init(&vb_name, vb->name, vb->name_length);
-
-        /* Calculate the current suffix. This is later used to check that the
-         * suffix is increasing. This also checks if we left the subtree */
-        ret = csnmp_oid_suffix(&suffix, &vb_name, data->values + i);
-        if (ret != 0) {
-          DEBUG("snmp plugin: host = %s; data = %s; i = %zu; "
-                "Value probably left its subtree.",
-                host->name, data->name, i);
-          oid_list_todo[i] = 0;
-          continue;
-        }
-
-        /* Make sure the OIDs returned by the agent are increasing. Otherwise
-         * our
-         * table matching algorithm will get confused. */
-        if ((value_list_tail[i] != NULL) &&
-            (csnmp_oid_compare(&suffix, &value_list_tail[i]->suffix) <= 0)) {
-          DEBUG("snmp plugin: host = %s; data = %s; i = %zu; "
-                "Suffix is not increasing.",
-                host->name, data->name, i);
-          oid_list_todo[i] = 0;
-          continue;
-        }
-
-        vt = calloc(1, sizeof(*vt));
-        if (vt == NULL) {
-          ERROR("snmp plugin: calloc failed.");
-          status = -1;
-          break;
-        }
-
-        vt->value =
-            csnmp_value_list_to_value(vb, ds->ds[i].type, data->scale,
-                                      data->shift, host->name, data->name);
-        memcpy(&vt->suffix, &suffix, sizeof(vt->suffix));
-        vt->next = NULL;
-
-        if (value_list_tail[i] == NULL)
-          value_list_head[i] = vt;
-        else
-          value_list_tail[i]->next = vt;
-        value_list_tail[i] = vt;
-      }
-
-      /* Copy OID to oid_list[i] */
-      memcpy(oid_list[i].oid, vb->name, sizeof(oid) * vb->name_length);
-      oid_list[i].oid_len = vb->name_length;
-
-    } /* for (vb = res->variables ...) */
-
-    if (res != NULL)
-      snmp_free_pdu(res);
-    res = NULL;
-  } /* while (status == 0) */
-
-  if (res != NULL)
+    status = csnmp_walk_response(&walk, res);
     snmp_free_pdu(res);
-  res = NULL;
-
-  if (req != NULL)
-    snmp_free_pdu(req);
-  req = NULL;
-
-  if (status == 0)
-    csnmp_dispatch_table(host, data, instance_list_head, value_list_head);
-
-  /* Free all allocated variables here */
-  while (instance_list_head != NULL) {
-    csnmp_list_instances_t *next = instance_list_head->next;
-    sfree(instance_list_head);
-    instance_list_head = next;
-  }
-
-  for (i = 0; i < data->values_len; i++) {
-    while (value_list_head[i] != NULL) {
-      csnmp_table_values_t *next = value_list_head[i]->next;
-      sfree(value_list_head[i]);
-      value_list_head[i] = next;
-    }
-  }
+  } /* while (status == 0) */
 
-  sfree(value_list_head);
-  sfree(value_list_tail);
+  csnmp_walk_finish(&walk, /* dispatch = */ status == 0);
 
   return 0;
 } /* int csnmp_read_table */
 
-static int csnmp_read_value(host_definition_t *host, data_definition_t *data) {
+static struct snmp_pdu *csnmp_value_request(host_definition_t *host, /* {{{ */
+                                            data_definition_t *data) {
   struct snmp_pdu *req;
-  struct snmp_pdu *res = NULL;
-  struct variable_list *vb;
-
   const data_set_t *ds;
-  value_list_t vl = VALUE_LIST_INIT;
-
-  int status;
-  size_t i;
-
-  DEBUG("snmp plugin: csnmp_read_value (host = %s, data = %s)", host->name,
-        data->name);
-
-  if (host->sess_handle == NULL) {
-    DEBUG("snmp plugin: csnmp_read_value: host->sess_handle == NULL");
-    return -1;
-  }
 
   ds = plugin_get_ds(data->type);
   if (!ds) {
     ERROR("snmp plugin: DataSet `%s' not defined.", data->type);
-    return -1;
+    return NULL;
   }
 
   if (ds->ds_num != data->values_len) {
     ERROR("snmp plugin: DataSet `%s' requires %zu values, but config talks "
           "about %zu",
           data->type, ds->ds_num, data->values_len);
-    return -1;
+    return NULL;
   }
 
-  vl.values_len = ds->ds_num;
-  vl.values = malloc(sizeof(*vl.values) * vl.values_len);
-  if (vl.values == NULL)
+  req = snmp_pdu_create(SNMP_MSG_GET);
+  if (req == NULL) {
+    ERROR("snmp plugin: snmp_pdu_create failed.");
+    return NULL;
+  }
+
+  for (size_t i = 0; i < data->values_len; i++)
+    snmp_add_null_var(req, data->values[i].oid, data->values[i].oid_len);
+
+  return req;
+} /* }}} struct snmp_pdu *csnmp_value_request */
+
+static int csnmp_value_dispatch(host_definition_t *host, /* {{{ */
+                                data_definition_t *data,
+                                const struct snmp_pdu *res) {
+  struct variable_list *vb;
+  const data_set_t *ds;
+  value_list_t vl = VALUE_LIST_INIT;
+
+  ds = plugin_get_ds(data->type);
+  if ((ds == NULL) || (ds->ds_num != data->values_len))
     return -1;
-  for (i = 0; i < vl.values_len; i++) {
+
+  vl.values_len = ds->ds_num;
+  value_t values[vl.values_len];
+  vl.values = values;
+  for (size_t i = 0; i < vl.values_len; i++) {
     if (ds->ds[i].type == DS_TYPE_COUNTER)
       vl.values[i].counter = 0;
     else
@@ -1561,15 +1760,43 @@ static int csnmp_read_value(host_definition_t *host, data_definition_t *data) {
 
   vl.interval = host->interval;
 
-  req = snmp_pdu_create(SNMP_MSG_GET);
-  if (req == NULL) {
-    ERROR("snmp plugin: snmp_pdu_create failed.");
-    sfree(vl.values);
+  for (vb = res->variables; vb != NULL; vb = vb->next_variable) {
+#if COLLECT_DEBUG
+    char buffer[1024];
+    snprint_variable(buffer, sizeof(buffer), vb->name, vb->name_length, vb);
+    DEBUG("snmp plugin: Got this variable: %s", buffer);
+#endif /* COLLECT_DEBUG */
+
+    for (size_t i = 0; i < data->values_len; i++)
+      if (snmp_oid_compare(data->values[i].oid, data->values[i].oid_len,
+                           vb->name, vb->name_length) == 0)
+        vl.values[i] =
+            csnmp_value_list_to_value(vb, ds->ds[i].type, data->scale,
+                                      data->shift, host->name, data->name);
+  } /* for (res->variables) */
+
+  DEBUG("snmp plugin: -> plugin_dispatch_values (&vl);");
+  plugin_dispatch_values(&vl);
+
+  return 0;
+} /* }}} int csnmp_value_dispatch */
+
+static int csnmp_read_value(host_definition_t *host, data_definition_t *data) {
+  struct snmp_pdu *req;
+  struct snmp_pdu *res = NULL;
+  int status;
+
+  DEBUG("snmp plugin: csnmp_read_value (host = %s, data = %s)", host->name,
+        data->name);
+
+  if (host->sess_handle == NULL) {
+    DEBUG("snmp plugin: csnmp_read_value: host->sess_handle == NULL");
     return -1;
   }
 
-  for (i = 0; i < data->values_len; i++)
-    snmp_add_null_var(req, data->values[i].oid, data->values[i].oid_len);
+  req = csnmp_value_request(host, data);
+  if (req == NULL)
+    return -1;
 
   status = snmp_sess_synch_response(host->sess_handle, req, &res);
 
@@ -1584,35 +1811,391 @@ static int csnmp_read_value(host_definition_t *host, data_definition_t *data) {
       snmp_free_pdu(res);
 
     sfree(errstr);
-    sfree(vl.values);
     csnmp_host_close_session(host);
 
     return -1;
   }
 
-  for (vb = res->variables; vb != NULL; vb = vb->next_variable) {
-#if COLLECT_DEBUG
-    char buffer[1024];
-    snprint_variable(buffer, sizeof(buffer), vb->name, vb->name_length, vb);
-    DEBUG("snmp plugin: Got this variable: %s", buffer);
-#endif /* COLLECT_DEBUG */
+  status = csnmp_value_dispatch(host, data, res);
+  snmp_free_pdu(res);
 
-    for (i = 0; i < data->values_len; i++)
-      if (snmp_oid_compare(data->values[i].oid, data->values[i].oid_len,
-                           vb->name, vb->name_length) == 0)
-        vl.values[i] =
-            csnmp_value_list_to_value(vb, ds->ds[i].type, data->scale,
-                                      data->shift, host->name, data->name);
-  } /* for (res->variables) */
+  return status;
+} /* int csnmp_read_value */
 
-  snmp_free_pdu(res);
+/*
+ * Asynchronous polling
+ *
+ * With "AsyncThreads" set, the read callback of a host only queues the host
+ * with one of the engine threads. The engine sends the requests for all data
+ * of a host at once and handles the responses for all of its hosts in a
+ * single select(2) loop, so a few threads keep many hosts and requests in
+ * flight. Each host is polled by one engine only, which owns its session.
+ */
+static int csnmp_async_callback(int operation, struct snmp_session *sess,
+                                int reqid, struct snmp_pdu *res, void *arg);
 
-  DEBUG("snmp plugin: -> plugin_dispatch_values (&vl);");
-  plugin_dispatch_values(&vl);
-  sfree(vl.values);
+static void csnmp_request_done(csnmp_request_t *req, _Bool dispatch) /* {{{ */
+{
+  if (req->data->is_table)
+    csnmp_walk_finish(&req->walk, dispatch);
+
+  req->host->requests_pending--;
+  sfree(req);
+} /* }}} void csnmp_request_done */
+
+/* Sends the next request for "req". Returns zero if a request was sent, a
+ * positive value if the table walk is complete and -1 on error. */
+static int csnmp_async_send(csnmp_request_t *req) /* {{{ */
+{
+  struct snmp_pdu *pdu = NULL;
+
+  if (req->data->is_table) {
+    if (csnmp_walk_request(&req->walk, &pdu) != 0)
+      return -1;
+    if (pdu == NULL)
+      return 1;
+  } else {
+    pdu = csnmp_value_request(req->host, req->data);
+    if (pdu == NULL)
+      return -1;
+  }
+
+  if (snmp_sess_async_send(req->host->sess_handle, pdu, csnmp_async_callback,
+                           req) == 0) {
+    char *errstr = NULL;
+
+    snmp_sess_error(req->host->sess_handle, NULL, NULL, &errstr);
+    c_complain(LOG_ERR, &req->host->complaint,
+               "snmp plugin: host %s: snmp_sess_async_send failed: %s",
+               req->host->name, (errstr == NULL) ? "Unknown problem" : errstr);
+    sfree(errstr);
+
+    /* The PDU is only freed if it was sent successfully. */
+    snmp_free_pdu(pdu);
+    req->host->poll_failed = 1;
+    return -1;
+  }
 
   return 0;
-} /* int csnmp_read_value */
+} /* }}} int csnmp_async_send */
+
+static int csnmp_async_callback(int operation, /* {{{ */
+                                struct snmp_session __attribute__((unused)) *
+                                    sess,
+                                int __attribute__((unused)) reqid,
+                                struct snmp_pdu *res, void *arg) {
+  csnmp_request_t *req = arg;
+  host_definition_t *host = req->host;
+  int status;
+
+  if (operation != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE) {
+    c_complain(LOG_ERR, &host->complaint,
+               "snmp plugin: host %s: %s request for `%s' %s.", host->name,
+               req->data->is_table ? "Table" : "Value", req->data->name,
+               (operation == NETSNMP_CALLBACK_OP_TIMED_OUT) ? "timed out"
+                                                            : "failed");
+    if (req->data->is_table && (req->walk.req_bulk_size > 0))
+      csnmp_host_bulk_adapt(host, /* grow = */ 0);
+
+    host->poll_failed = 1;
+    csnmp_request_done(req, /* dispatch = */ 0);
+    return 1;
+  }
+
+  c_release(LOG_INFO, &host->complaint,
+            "snmp plugin: host %s: Asynchronous request successful.",
+            host->name);
+
+  if (!req->data->is_table) {
+    csnmp_value_dispatch(host, req->data, res);
+    csnmp_request_done(req, /* dispatch = */ 0);
+    return 1;
+  }
+
+  status = csnmp_walk_response(&req->walk, res);
+  if (status == 0)
+    status = csnmp_async_send(req);
+
+  /* Zero means the next request of the walk is in flight. */
+  if (status != 0)
+    csnmp_request_done(req, /* dispatch = */ status > 0);
+
+  return 1;
+} /* }}} int csnmp_async_callback */
+
+/* Called by the engine thread when all requests of a poll are done. */
+static void csnmp_engine_host_done(csnmp_engine_t *engine, /* {{{ */
+                                   host_definition_t *host) {
+  if (host->poll_failed)
+    csnmp_host_close_session(host);
+  host->poll_failed = 0;
+
+  pthread_mutex_lock(&engine->lock);
+  host->poll_state = CSNMP_POLL_IDLE;
+  pthread_mutex_unlock(&engine->lock);
+} /* }}} void csnmp_engine_host_done */
+
+/* Sends the first request for each data of "host". */
+static void csnmp_engine_host_start(csnmp_engine_t *engine, /* {{{ */
+                                    host_definition_t *host) {
+  if (host->sess_handle == NULL)
+    csnmp_host_open_session(host);
+
+  for (int i = 0; (host->sess_handle != NULL) && (i < host->data_list_len);
+       i++) {
+    csnmp_request_t *req;
+    int status;
+
+    req = calloc(1, sizeof(*req));
+    if (req == NULL) {
+      ERROR("snmp plugin: calloc failed.");
+      break;
+    }
+    req->host = host;
+    req->data = host->data_list[i];
+
+    if (req->data->is_table &&
+        (csnmp_walk_init(&req->walk, host, req->data) != 0)) {
+      sfree(req);
+      continue;
+    }
+
+    host->requests_pending++;
+    status = csnmp_async_send(req);
+    if (status != 0)
+      csnmp_request_done(req, /* dispatch = */ status > 0);
+  }
+
+  if (host->requests_pending == 0) {
+    csnmp_engine_host_done(engine, host);
+    return;
+  }
+
+  host->poll_next = engine->active;
+  engine->active = host;
+} /* }}} void csnmp_engine_host_start */
+
+static void *csnmp_engine_thread(void *arg) /* {{{ */
+{
+  csnmp_engine_t *engine = arg;
+  /* A plain fd_set cannot hold descriptors >= FD_SETSIZE, which a busy
+   * daemon with many hosts easily hands out. The large fd set grows as
+   * needed. */
+  netsnmp_large_fd_set fdset;
+
+  netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+
+  while (42) {
+    host_definition_t *queue;
+    host_definition_t **host_ptr;
+    _Bool shutdown;
+    struct timeval timeout;
+    int numfds;
+    int block;
+    int status;
+
+    pthread_mutex_lock(&engine->lock);
+    queue = engine->queue_head;
+    engine->queue_head = engine->queue_tail = NULL;
+    shutdown = engine->shutdown;
+    pthread_mutex_unlock(&engine->lock);
+
+    while (queue != NULL) {
+      host_definition_t *host = queue;
+      queue = host->poll_next;
+      host->poll_next = NULL;
+
+      /* Polls in progress are finished on shutdown, but none are started. */
+      if (shutdown)
+        csnmp_engine_host_done(engine, host);
+      else
+        csnmp_engine_host_start(engine, host);
+    }
+
+    if (shutdown && (engine->active == NULL))
+      break;
+
+    NETSNMP_LARGE_FD_ZERO(&fdset);
+    NETSNMP_LARGE_FD_SET(engine->wakeup_fd[0], &fdset);
+    numfds = engine->wakeup_fd[0] + 1;
+
+    /* Wake up at least once a second; the sessions lower the timeout to
+     * their next retransmission. */
+    timeout.tv_sec = 1;
+    timeout.tv_usec = 0;
+    block = 0;
+
+    for (host_definition_t *host = engine->active; host != NULL;
+         host = host->poll_next)
+      snmp_sess_select_info2(host->sess_handle, &numfds, &fdset, &timeout,
+                             &block);
+
+    status = netsnmp_large_fd_set_select(numfds, &fdset, /* writefds = */ NULL,
+                                         /* exceptfds = */ NULL, &timeout);
+    if (status < 0) {
+      if (errno != EINTR) {
+        char errbuf[1024];
+        ERROR("snmp plugin: select failed: %s",
+              sstrerror(errno, errbuf, sizeof(errbuf)));
+      }
+      NETSNMP_LARGE_FD_ZERO(&fdset);
+      status = 0;
+    }
+
+    if ((status > 0) && NETSNMP_LARGE_FD_ISSET(engine->wakeup_fd[0], &fdset)) {
+      char buffer[64];
+      while (read(engine->wakeup_fd[0], buffer, sizeof(buffer)) > 0)
+        /* drain */;
+    }
+
+    for (host_definition_t *host = engine->active; host != NULL;
+         host = host->poll_next) {
+      if (status > 0)
+        snmp_sess_read2(host->sess_handle, &fdset);
+      snmp_sess_timeout(host->sess_handle);
+    }
+
+    /* Retire the hosts whose requests are all done. */
+    host_ptr = &engine->active;
+    while (*host_ptr != NULL) {
+      host_definition_t *host = *host_ptr;
+
+      if (host->requests_pending > 0) {
+        host_ptr = &host->poll_next;
+        continue;
+      }
+
+      *host_ptr = host->poll_next;
+      host->poll_next = NULL;
+      csnmp_engine_host_done(engine, host);
+    }
+  } /* while (42) */
+
+  netsnmp_large_fd_set_cleanup(&fdset);
+  return NULL;
+} /* }}} void *csnmp_engine_thread */
+
+/* Interrupts the engine's select(2). */
+static void csnmp_engine_wakeup(csnmp_engine_t *engine) /* {{{ */
+{
+  /* If the pipe is full, a wakeup is pending already. */
+  if ((write(engine->wakeup_fd[1], "", 1) < 0) && (errno != EAGAIN)) {
+    char errbuf[1024];
+    ERROR("snmp plugin: write to the wakeup pipe failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+  }
+} /* }}} void csnmp_engine_wakeup */
+
+static int csnmp_engine_submit(host_definition_t *host) /* {{{ */
+{
+  csnmp_engine_t *engine;
+
+  pthread_mutex_lock(&engines_lock);
+  if (host->engine == NULL) {
+    host->engine = engines + (engines_next % engines_num);
+    engines_next++;
+  }
+  engine = host->engine;
+  pthread_mutex_unlock(&engines_lock);
+
+  pthread_mutex_lock(&engine->lock);
+  if (engine->shutdown) {
+    pthread_mutex_unlock(&engine->lock);
+    return -1;
+  }
+
+  if (host->poll_state != CSNMP_POLL_IDLE) {
+    c_complain(LOG_WARNING, &host->poll_complaint,
+               "snmp plugin: host %s: The previous poll has not finished yet. "
+               "Skipping this interval.",
+               host->name);
+    pthread_mutex_unlock(&engine->lock);
+    return 0;
+  }
+  c_release(LOG_INFO, &host->poll_complaint,
+            "snmp plugin: host %s: Polls finish in time again.", host->name);
+
+  host->poll_state = CSNMP_POLL_QUEUED;
+  if (engine->queue_tail == NULL)
+    engine->queue_head = host;
+  else
+    engine->queue_tail->poll_next = host;
+  engine->queue_tail = host;
+  pthread_mutex_unlock(&engine->lock);
+
+  csnmp_engine_wakeup(engine);
+  return 0;
+} /* }}} int csnmp_engine_submit */
+
+static int csnmp_engines_start(void) /* {{{ */
+{
+  engines = calloc((size_t)async_threads, sizeof(*engines));
+  if (engines == NULL) {
+    ERROR("snmp plugin: calloc failed.");
+    return -1;
+  }
+
+  for (int i = 0; i < async_threads; i++) {
+    csnmp_engine_t *engine = engines + engines_num;
+    int status;
+
+    pthread_mutex_init(&engine->lock, /* attr = */ NULL);
+
+    if (pipe(engine->wakeup_fd) != 0) {
+      char errbuf[1024];
+      ERROR("snmp plugin: pipe failed: %s",
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      pthread_mutex_destroy(&engine->lock);
+      break;
+    }
+    fcntl(engine->wakeup_fd[0], F_SETFL, O_NONBLOCK);
+    fcntl(engine->wakeup_fd[1], F_SETFL, O_NONBLOCK);
+
+    status = plugin_thread_create(&engine->thread, /* attr = */ NULL,
+                                  csnmp_engine_thread, engine, "snmp async");
+    if (status != 0) {
+      ERROR("snmp plugin: Creating engine thread failed.");
+      close(engine->wakeup_fd[0]);
+      close(engine->wakeup_fd[1]);
+      pthread_mutex_destroy(&engine->lock);
+      break;
+    }
+    engine->thread_running = 1;
+    engines_num++;
+  }
+
+  if (engines_num == 0) {
+    sfree(engines);
+    return -1;
+  }
+
+  return 0;
+} /* }}} int csnmp_engines_start */
+
+/* Stops all engine threads once the polls in progress are finished. */
+static void csnmp_engines_stop(void) /* {{{ */
+{
+  if (engines == NULL)
+    return;
+
+  for (size_t i = 0; i < engines_num; i++) {
+    pthread_mutex_lock(&engines[i].lock);
+    engines[i].shutdown = 1;
+    pthread_mutex_unlock(&engines[i].lock);
+    csnmp_engine_wakeup(engines + i);
+  }
+
+  for (size_t i = 0; i < engines_num; i++) {
+    if (engines[i].thread_running)
+      pthread_join(engines[i].thread, NULL);
+    close(engines[i].wakeup_fd[0]);
+    close(engines[i].wakeup_fd[1]);
+    pthread_mutex_destroy(&engines[i].lock);
+  }
+
+  sfree(engines);
+  engines_num = 0;
+} /* }}} void csnmp_engines_stop */
 
 static int csnmp_read_host(user_data_t *ud) {
   host_definition_t *host;
@@ -1625,6 +2208,9 @@ static int csnmp_read_host(user_data_t *ud) {
   if (host->interval == 0)
     host->interval = plugin_get_interval();
 
+  if (engines_num > 0)
+    return csnmp_engine_submit(host);
+
   if (host->sess_handle == NULL)
     csnmp_host_open_session(host);
 
@@ -1653,6 +2239,9 @@ static int csnmp_read_host(user_data_t *ud) {
 static int csnmp_init(void) {
   call_snmp_init_once();
 
+  if ((async_threads > 0) && (engines == NULL))
+    return csnmp_engines_start();
+
   return 0;
 } /* int csnmp_init */
 
@@ -1660,6 +2249,8 @@ static int csnmp_shutdown(void) {
   data_definition_t *data_this;
   data_definition_t *data_next;
 
+  csnmp_engines_stop();
+
   /* When we get here, the read threads have been stopped and all the
    * `host_definition_t' will be freed. */
   DEBUG("snmp plugin: Destroying all data definitions.");
@@ -0,0 +1,534 @@
+/**
+ * collectd - src/snmp_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/* The session functions of Net-SNMP are replaced by a fake agent below, which
+ * serves a small ifTable without any network traffic. PDUs are still handled
+ * by the real library. Values dispatched by the plugin are captured by
+ * test_dispatch_values(). */
+#define snmp_sess_open test_sess_open
+#define snmp_sess_close test_sess_close
+#define snmp_sess_error test_sess_error
+#define snmp_sess_synch_response test_sess_synch_response
+#define snmp_sess_async_send test_sess_async_send
+#define snmp_sess_select_info2 test_sess_select_info2
+#define snmp_sess_read2 test_sess_read2
+#define snmp_sess_timeout test_sess_timeout
+#define plugin_dispatch_values test_dispatch_values
+#define plugin_get_ds test_get_ds
+#include "snmp.c"
+#undef plugin_dispatch_values
+#undef plugin_get_ds
+
+#include "testing.h"
+
+#define TEST_ROWS 100
+/* ifOutOctets has no entry for this row, so it must not be dispatched. */
+#define TEST_GAP 7
+/* Sessions opened with this address never answer. */
+#define TEST_DEAD_ADDRESS "dead"
+
+static oid const if_descr_oid[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 2};
+static oid const if_in_octets_oid[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 10};
+static oid const if_out_octets_oid[] = {1, 3, 6, 1, 2, 1, 2, 2, 1, 16};
+static oid const users_oid[] = {1, 3, 6, 1, 2, 1, 25, 1, 5, 0};
+
+static oid const *const agent_columns[] = {if_descr_oid, if_in_octets_oid,
+                                           if_out_octets_oid};
+
+static pthread_mutex_t test_lock = PTHREAD_MUTEX_INITIALIZER;
+/* GETBULK responses with more variables are "too big"; zero means no
+ * limit. */
+static size_t agent_max_vars;
+static size_t agent_requests;
+static size_t dispatched_rows;
+static size_t dispatched_scalars;
+static size_t dispatched_bad;
+
+/*
+ * Fake agent
+ */
+typedef struct fake_request_s {
+  netsnmp_pdu *pdu;
+  netsnmp_callback callback;
+  void *arg;
+  int reqid;
+  struct fake_request_s *next;
+} fake_request_t;
+
+typedef struct {
+  _Bool dead;
+  int pipe_fd[2];
+  int reqid;
+  fake_request_t *pending;
+} fake_session_t;
+
+/* Adds the cell following "name" in lexicographic order, like an agent
+ * answering GETNEXT. Updates "name" to the OID of that cell. */
+static void agent_next(netsnmp_pdu *res, oid_t *name) {
+  for (size_t col = 0; col < STATIC_ARRAY_SIZE(agent_columns); col++) {
+    for (long row = 1; row <= TEST_ROWS; row++) {
+      oid_t cell;
+
+      if ((col == 2) && (row == TEST_GAP))
+        continue;
+
+      csnmp_oid_init(&cell, agent_columns[col], 10);
+      cell.oid[cell.oid_len++] = (oid)row;
+      if (csnmp_oid_compare(&cell, name) <= 0)
+        continue;
+
+      *name = cell;
+      if (col == 0) {
+        char descr[32];
+        ssnprintf(descr, sizeof(descr), "eth%ld", row);
+        snmp_pdu_add_variable(res, cell.oid, cell.oid_len, ASN_OCTET_STR,
+                              descr, strlen(descr));
+      } else {
+        long counter = row * ((col == 1) ? 10 : 20);
+        snmp_pdu_add_variable(res, cell.oid, cell.oid_len, ASN_COUNTER,
+                              &counter, sizeof(counter));
+      }
+      return;
+    }
+  }
+
+  snmp_pdu_add_variable(res, name->oid, name->oid_len, SNMP_ENDOFMIBVIEW,
+                        NULL, 0);
+}
+
+static netsnmp_pdu *agent_respond(netsnmp_pdu const *req) {
+  netsnmp_pdu *res = snmp_pdu_create(SNMP_MSG_RESPONSE);
+  size_t vars_num = 0;
+  long repetitions = 1;
+
+  pthread_mutex_lock(&test_lock);
+  agent_requests++;
+  pthread_mutex_unlock(&test_lock);
+
+  if (req->command == SNMP_MSG_GET) {
+    for (netsnmp_variable_list *v = req->variables; v != NULL;
+         v = v->next_variable) {
+      long users = 3;
+      snmp_pdu_add_variable(res, v->name, v->name_length, ASN_GAUGE, &users,
+                            sizeof(users));
+    }
+    return res;
+  }
+
+  for (netsnmp_variable_list *v = req->variables; v != NULL;
+       v = v->next_variable)
+    vars_num++;
+  if (req->command == SNMP_MSG_GETBULK)
+    repetitions = req->max_repetitions;
+
+  if ((agent_max_vars > 0) && (vars_num * repetitions > agent_max_vars)) {
+    res->errstat = SNMP_ERR_TOOBIG;
+    return res;
+  }
+
+  oid_t names[vars_num];
+  size_t i = 0;
+  for (netsnmp_variable_list *v = req->variables; v != NULL;
+       v = v->next_variable)
+    csnmp_oid_init(names + i++, v->name, v->name_length);
+
+  for (long r = 0; r < repetitions; r++)
+    for (i = 0; i < vars_num; i++)
+      agent_next(res, names + i);
+
+  return res;
+}
+
+void *test_sess_open(netsnmp_session *sess) {
+  fake_session_t *f = calloc(1, sizeof(*f));
+  if (f == NULL)
+    return NULL;
+
+  if (pipe(f->pipe_fd) != 0) {
+    sfree(f);
+    return NULL;
+  }
+  fcntl(f->pipe_fd[0], F_SETFL, O_NONBLOCK);
+  fcntl(f->pipe_fd[1], F_SETFL, O_NONBLOCK);
+  f->dead = (strcmp(TEST_DEAD_ADDRESS, sess->peername) == 0);
+  return f;
+}
+
+int test_sess_close(void *handle) {
+  fake_session_t *f = handle;
+
+  while (f->pending != NULL) {
+    fake_request_t *r = f->pending;
+    f->pending = r->next;
+    snmp_free_pdu(r->pdu);
+    sfree(r);
+  }
+  close(f->pipe_fd[0]);
+  close(f->pipe_fd[1]);
+  sfree(f);
+  return 1;
+}
+
+void test_sess_error(void *handle, int *clib_errorno, int *snmp_errorno,
+                     char **errstr) {
+  *errstr = strdup("Timeout");
+}
+
+int test_sess_synch_response(void *handle, netsnmp_pdu *req,
+                             netsnmp_pdu **res) {
+  fake_session_t *f = handle;
+
+  *res = f->dead ? NULL : agent_respond(req);
+  snmp_free_pdu(req);
+  return f->dead ? STAT_TIMEOUT : STAT_SUCCESS;
+}
+
+int test_sess_async_send(void *handle, netsnmp_pdu *pdu,
+                         netsnmp_callback callback, void *arg) {
+  fake_session_t *f = handle;
+  fake_request_t **tail = &f->pending;
+  fake_request_t *r;
+
+  /* The response is "received" right away. If the pipe is full, a wakeup is
+   * pending already. */
+  if (!f->dead && (write(f->pipe_fd[1], "", 1) < 0) && (errno != EAGAIN))
+    return 0;
+
+  r = calloc(1, sizeof(*r));
+  if (r == NULL)
+    return 0;
+  r->pdu = pdu;
+  r->callback = callback;
+  r->arg = arg;
+  r->reqid = ++f->reqid;
+
+  while (*tail != NULL)
+    tail = &(*tail)->next;
+  *tail = r;
+  return r->reqid;
+}
+
+int test_sess_select_info2(void *handle, int *numfds,
+                           netsnmp_large_fd_set *fdset, struct timeval *timeout,
+                           int *block) {
+  fake_session_t *f = handle;
+
+  NETSNMP_LARGE_FD_SET(f->pipe_fd[0], fdset);
+  if (*numfds <= f->pipe_fd[0])
+    *numfds = f->pipe_fd[0] + 1;
+
+  /* Requests to a dead agent time out right away. */
+  if (f->dead && (f->pending != NULL)) {
+    timeout->tv_sec = 0;
+    timeout->tv_usec = 0;
+    *block = 0;
+  }
+  return 1;
+}
+
+/* Calls the callbacks of all pending requests. The callbacks may send further
+ * requests, which are answered by the next call. */
+static void fake_deliver(fake_session_t *f, int operation) {
+  fake_request_t *r = f->pending;
+  f->pending = NULL;
+
+  while (r != NULL) {
+    fake_request_t *next = r->next;
+    netsnmp_pdu *res = NULL;
+
+    if (operation == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE)
+      res = agent_respond(r->pdu);
+    r->callback(operation, /* session = */ NULL, r->reqid, res, r->arg);
+
+    snmp_free_pdu(res);
+    snmp_free_pdu(r->pdu);
+    sfree(r);
+    r = next;
+  }
+}
+
+int test_sess_read2(void *handle, netsnmp_large_fd_set *fdset) {
+  fake_session_t *f = handle;
+  char buffer[64];
+
+  if (!NETSNMP_LARGE_FD_ISSET(f->pipe_fd[0], fdset))
+    return 0;
+
+  while (read(f->pipe_fd[0], buffer, sizeof(buffer)) > 0)
+    /* drain */;
+  if (!f->dead)
+    fake_deliver(f, NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE);
+  return 0;
+}
+
+void test_sess_timeout(void *handle) {
+  fake_session_t *f = handle;
+
+  if (f->dead)
+    fake_deliver(f, NETSNMP_CALLBACK_OP_TIMED_OUT);
+}
+
+/*
+ * Plugin interface
+ */
+static data_source_t if_dsrc[] = {{"rx", DS_TYPE_DERIVE, 0, NAN},
+                                  {"tx", DS_TYPE_DERIVE, 0, NAN}};
+static data_set_t if_ds = {"test_if", STATIC_ARRAY_SIZE(if_dsrc), if_dsrc};
+static data_source_t users_dsrc[] = {{"value", DS_TYPE_GAUGE, 0, NAN}};
+static data_set_t users_ds = {"test_users", STATIC_ARRAY_SIZE(users_dsrc),
+                              users_dsrc};
+
+const data_set_t *test_get_ds(char const *name) {
+  if (strcmp(if_ds.type, name) == 0)
+    return &if_ds;
+  if (strcmp(users_ds.type, name) == 0)
+    return &users_ds;
+  return NULL;
+}
+
+int test_dispatch_values(value_list_t const *vl) {
+  pthread_mutex_lock(&test_lock);
+  if (strcmp(if_ds.type, vl->type) == 0) {
+    long row = atol(vl->type_instance + strlen("eth"));
+    if ((strncmp("eth", vl->type_instance, strlen("eth")) != 0) ||
+        (row == TEST_GAP) || (vl->values[0].derive != row * 10) ||
+        (vl->values[1].derive != row * 20))
+      dispatched_bad++;
+    dispatched_rows++;
+  } else if (strcmp(users_ds.type, vl->type) == 0) {
+    if (vl->values[0].gauge != 3.0)
+      dispatched_bad++;
+    dispatched_scalars++;
+  } else {
+    dispatched_bad++;
+  }
+  pthread_mutex_unlock(&test_lock);
+  return 0;
+}
+
+static void test_reset(void) {
+  agent_max_vars = 0;
+  agent_requests = 0;
+  dispatched_rows = 0;
+  dispatched_scalars = 0;
+  dispatched_bad = 0;
+}
+
+static data_definition_t table_data;
+static data_definition_t scalar_data;
+static data_definition_t *test_data_list[] = {&table_data, &scalar_data};
+
+static void test_data_init(void) {
+  static oid_t table_values[2];
+  static oid_t scalar_values[1];
+
+  table_data.name = "table";
+  table_data.type = "test_if";
+  table_data.is_table = 1;
+  table_data.scale = 1.0;
+  csnmp_oid_init(&table_data.instance.oid, if_descr_oid, 10);
+  csnmp_oid_init(table_values + 0, if_in_octets_oid, 10);
+  csnmp_oid_init(table_values + 1, if_out_octets_oid, 10);
+  table_data.values = table_values;
+  table_data.values_len = STATIC_ARRAY_SIZE(table_values);
+
+  scalar_data.name = "scalar";
+  scalar_data.type = "test_users";
+  scalar_data.scale = 1.0;
+  csnmp_oid_init(scalar_values + 0, users_oid, 10);
+  scalar_data.values = scalar_values;
+  scalar_data.values_len = STATIC_ARRAY_SIZE(scalar_values);
+}
+
+/* Sets up a host like csnmp_config_add_host() does. */
+static host_definition_t *test_host(char const *name, char const *address,
+                                    int version, int max_repetitions) {
+  host_definition_t *hd = calloc(1, sizeof(*hd));
+  if (hd == NULL)
+    return NULL;
+
+  hd->name = strdup(name);
+  hd->address = strdup(address);
+  hd->community = strdup("public");
+  hd->version = version;
+  C_COMPLAIN_INIT(&hd->complaint);
+  C_COMPLAIN_INIT(&hd->poll_complaint);
+  hd->max_repetitions = max_repetitions;
+  hd->bulk_size = (max_repetitions < 8) ? max_repetitions : 8;
+  hd->bulk_limit = max_repetitions;
+
+  hd->data_list = malloc(sizeof(test_data_list));
+  if (hd->data_list != NULL)
+    memcpy(hd->data_list, test_data_list, sizeof(test_data_list));
+  hd->data_list_len = STATIC_ARRAY_SIZE(test_data_list);
+  return hd;
+}
+
+/* Waits until the engine has finished polling "host". */
+static int test_wait_idle(host_definition_t *host) {
+  for (int i = 0; i < 10000; i++) {
+    pthread_mutex_lock(&host->engine->lock);
+    _Bool idle = (host->poll_state == CSNMP_POLL_IDLE);
+    pthread_mutex_unlock(&host->engine->lock);
+    if (idle)
+      return 0;
+    usleep(1000);
+  }
+  return -1;
+}
+
+DEF_TEST(getnext_walk) {
+  host_definition_t *host = test_host("getnext", "agent", 1, 0);
+  CHECK_NOT_NULL(host);
+
+  test_reset();
+  CHECK_ZERO(csnmp_read_host(&(user_data_t){.data = host}));
+  EXPECT_EQ_INT(TEST_ROWS - 1, (int)dispatched_rows);
+  EXPECT_EQ_INT(1, (int)dispatched_scalars);
+  EXPECT_EQ_INT(0, (int)dispatched_bad);
+  /* One row per request, plus the request finding the end of the table and
+   * the GET. */
+  EXPECT_EQ_INT(TEST_ROWS + 2, (int)agent_requests);
+
+  csnmp_host_definition_destroy(host);
+  return 0;
+}
+
+DEF_TEST(getbulk_walk) {
+  host_definition_t *host = test_host("getbulk", "agent", 2, 64);
+  CHECK_NOT_NULL(host);
+
+  test_reset();
+  CHECK_ZERO(csnmp_read_host(&(user_data_t){.data = host}));
+  EXPECT_EQ_INT(TEST_ROWS - 1, (int)dispatched_rows);
+  EXPECT_EQ_INT(1, (int)dispatched_scalars);
+  EXPECT_EQ_INT(0, (int)dispatched_bad);
+  /* The repetitions double with each full response: 8 + 16 + 32 + 64 rows. */
+  EXPECT_EQ_INT(64, host->bulk_size);
+  OK(agent_requests <= 6);
+
+  /* The next walk starts with the maximum. */
+  test_reset();
+  CHECK_ZERO(csnmp_read_host(&(user_data_t){.data = host}));
+  EXPECT_EQ_INT(TEST_ROWS - 1, (int)dispatched_rows);
+  OK(agent_requests <= 3);
+
+  csnmp_host_definition_destroy(host);
+  return 0;
+}
+
+DEF_TEST(getbulk_too_big) {
+  host_definition_t *host = test_host("toobig", "agent", 2, 64);
+  CHECK_NOT_NULL(host);
+
+  /* Three columns with 8 repetitions are 24 variables. */
+  test_reset();
+  agent_max_vars = 20;
+  CHECK_ZERO(csnmp_read_host(&(user_data_t){.data = host}));
+  EXPECT_EQ_INT(TEST_ROWS - 1, (int)dispatched_rows);
+  EXPECT_EQ_INT(0, (int)dispatched_bad);
+  OK(host->bulk_limit < 8);
+  OK(host->bulk_size <= host->bulk_limit);
+
+  csnmp_host_definition_destroy(host);
+  return 0;
+}
+
+DEF_TEST(sync_timeout) {
+  host_definition_t *host = test_host("timeout", TEST_DEAD_ADDRESS, 2, 64);
+  CHECK_NOT_NULL(host);
+
+  test_reset();
+  csnmp_read_host(&(user_data_t){.data = host});
+  EXPECT_EQ_INT(0, (int)dispatched_rows);
+  EXPECT_EQ_INT(0, (int)dispatched_scalars);
+  /* The session is reopened by the next read. */
+  OK(host->sess_handle == NULL);
+  /* Timeouts halve the number of repetitions. */
+  EXPECT_EQ_INT(4, host->bulk_size);
+
+  csnmp_host_definition_destroy(host);
+  return 0;
+}
+
+DEF_TEST(async_engine) {
+  host_definition_t *hosts[8];
+  host_definition_t *dead;
+
+  async_threads = 2;
+  CHECK_ZERO(csnmp_engines_start());
+  EXPECT_EQ_INT(2, (int)engines_num);
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(hosts); i++) {
+    char name[32];
+    ssnprintf(name, sizeof(name), "async%zu", i);
+    hosts[i] = test_host(name, "agent", 2, 64);
+    CHECK_NOT_NULL(hosts[i]);
+  }
+  dead = test_host("async-timeout", TEST_DEAD_ADDRESS, 2, 64);
+  CHECK_NOT_NULL(dead);
+
+  for (int round = 0; round < 2; round++) {
+    test_reset();
+    for (size_t i = 0; i < STATIC_ARRAY_SIZE(hosts); i++)
+      CHECK_ZERO(csnmp_read_host(&(user_data_t){.data = hosts[i]}));
+    CHECK_ZERO(csnmp_read_host(&(user_data_t){.data = dead}));
+
+    for (size_t i = 0; i < STATIC_ARRAY_SIZE(hosts); i++)
+      CHECK_ZERO(test_wait_idle(hosts[i]));
+    CHECK_ZERO(test_wait_idle(dead));
+
+    pthread_mutex_lock(&test_lock);
+    EXPECT_EQ_INT(STATIC_ARRAY_SIZE(hosts) * (TEST_ROWS - 1),
+                  (int)dispatched_rows);
+    EXPECT_EQ_INT(STATIC_ARRAY_SIZE(hosts), (int)dispatched_scalars);
+    EXPECT_EQ_INT(0, (int)dispatched_bad);
+    pthread_mutex_unlock(&test_lock);
+
+    /* Failed polls close the session and shrink the repetitions. */
+    OK(dead->sess_handle == NULL);
+    OK(dead->bulk_size < 8);
+  }
+
+  /* The engines finish the polls in progress and exit. */
+  csnmp_engines_stop();
+  EXPECT_EQ_INT(0, (int)engines_num);
+  async_threads = 0;
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(hosts); i++)
+    csnmp_host_definition_destroy(hosts[i]);
+  csnmp_host_definition_destroy(dead);
+  return 0;
+}
+
+int main(void) {
+  test_data_init();
+
+  RUN_TEST(getnext_walk);
+  RUN_TEST(getbulk_walk);
+  RUN_TEST(getbulk_too_big);
+  RUN_TEST(sync_timeout);
+  RUN_TEST(async_engine);
+
+  END_TEST;
+}
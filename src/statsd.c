@@ -24,6 +24,8 @@
  *   Florian octo Forster <octo at collectd.org>
  */
 
+#define _GNU_SOURCE /* For recvmmsg(2) */
+
 #include "collectd.h"
 
 #include "common.h"
@@ -48,6 +50,21 @@
 #define STATSD_DEFAULT_SERVICE "8125"
 #endif
 
+/* Number of independently locked partitions of the metrics. */
+#ifndef STATSD_SHARDS_NUM
+#define STATSD_SHARDS_NUM 64
+#endif
+
+/* Maximum size of a datagram and number of datagrams read at once. */
+#define STATSD_PACKET_SIZE 4096
+#define STATSD_RECV_BATCH 32
+
+/* Sets are approximated using HyperLogLog with 2^STATSD_HLL_BITS registers of
+ * one byte each. The standard error is 1.04 / sqrt(2^STATSD_HLL_BITS), i.e.
+ * about 1.6%. */
+#define STATSD_HLL_BITS 12
+#define STATSD_HLL_SIZE (1 << STATSD_HLL_BITS)
+
 enum metric_type_e { STATSD_COUNTER, STATSD_TIMER, STATSD_GAUGE, STATSD_SET };
 typedef enum metric_type_e metric_type_t;
 
@@ -57,17 +74,39 @@ struct statsd_metric_s {
   derive_t counter;
   latency_counter_t *latency;
   c_avl_tree_t *set;
+  uint8_t *set_hll;
   unsigned long updates_num;
 };
 typedef struct statsd_metric_s statsd_metric_t;
 
-static c_avl_tree_t *metrics_tree = NULL;
-static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Metrics are distributed over the shards by the hash of their name, so that
+ * receive threads only contend when they update metrics in the same shard. */
+struct statsd_shard_s {
+  c_avl_tree_t *tree;
+  pthread_mutex_t lock;
+};
+typedef struct statsd_shard_s statsd_shard_t;
+
+static statsd_shard_t metrics_shards[STATSD_SHARDS_NUM];
+static _Bool metrics_initialized = 0;
 
-static pthread_t network_thread;
-static _Bool network_thread_running = 0;
+/* Buffers of one receive thread. */
+struct statsd_recv_buffer_s {
+  char data[STATSD_RECV_BATCH][STATSD_PACKET_SIZE];
+#if HAVE_RECVMMSG
+  struct mmsghdr msgs[STATSD_RECV_BATCH];
+  struct iovec iovs[STATSD_RECV_BATCH];
+#endif
+};
+typedef struct statsd_recv_buffer_s statsd_recv_buffer_t;
+
+static pthread_t *network_threads = NULL;
+static size_t network_threads_num = 0;
 static _Bool network_thread_shutdown = 0;
 
+static int conf_receive_threads = 1;
+static _Bool conf_approximate_sets = 0;
+
 static char *conf_node = NULL;
 static char *conf_service = NULL;
 
@@ -85,12 +124,73 @@ static _Bool conf_timer_upper = 0;
 static _Bool conf_timer_sum = 0;
 static _Bool conf_timer_count = 0;
 
-/* Must hold metrics_lock when calling this function. */
-static statsd_metric_t *statsd_metric_lookup_unsafe(char const *name, /* {{{ */
-                                                    metric_type_t type) {
+/* 64 bit FNV-1a, followed by the finalizer of MurmurHash3 so that all bits
+ * are usable for the HyperLogLog registers. */
+static uint64_t statsd_hash(char const *str) /* {{{ */
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (unsigned char const *ptr = (void const *)str; *ptr != 0; ptr++) {
+    hash ^= (uint64_t)*ptr;
+    hash *= 1099511628211ULL;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+
+  return hash;
+} /* }}} uint64_t statsd_hash */
+
+static void statsd_hll_add(uint8_t *registers, char const *key) /* {{{ */
+{
+  uint64_t hash = statsd_hash(key);
+  size_t index = (size_t)(hash >> (64 - STATSD_HLL_BITS));
+  uint64_t bits = hash << STATSD_HLL_BITS;
+  uint8_t rank = 1;
+
+  /* position of the first set bit in the remaining bits */
+  while ((rank <= (64 - STATSD_HLL_BITS)) && ((bits & (1ULL << 63)) == 0)) {
+    bits <<= 1;
+    rank++;
+  }
+
+  if (registers[index] < rank)
+    registers[index] = rank;
+} /* }}} void statsd_hll_add */
+
+static double statsd_hll_estimate(uint8_t const *registers) /* {{{ */
+{
+  double m = (double)STATSD_HLL_SIZE;
+  double sum = 0.0;
+  size_t zeros = 0;
+
+  for (size_t i = 0; i < STATSD_HLL_SIZE; i++) {
+    sum += ldexp(1.0, -(int)registers[i]);
+    if (registers[i] == 0)
+      zeros++;
+  }
+
+  double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+
+  /* Use linear counting for small cardinalities. */
+  if ((estimate <= 2.5 * m) && (zeros > 0))
+    estimate = m * log(m / (double)zeros);
+
+  return estimate;
+} /* }}} double statsd_hll_estimate */
+
+/* Looks up, or creates, the metric and locks the shard it belongs to. On
+ * success the caller must unlock (*ret_shard)->lock. */
+static statsd_metric_t *statsd_metric_lock(char const *name, /* {{{ */
+                                           metric_type_t type,
+                                           statsd_shard_t **ret_shard) {
   char key[DATA_MAX_NAME_LEN + 2];
   char *key_copy;
   statsd_metric_t *metric;
+  statsd_shard_t *shard;
   int status;
 
   switch (type) {
@@ -113,18 +213,25 @@ static statsd_metric_t *statsd_metric_lookup_unsafe(char const *name, /* {{{ */
   key[1] = ':';
   sstrncpy(&key[2], name, sizeof(key) - 2);
 
-  status = c_avl_get(metrics_tree, key, (void *)&metric);
-  if (status == 0)
+  shard = metrics_shards + (statsd_hash(key) % STATSD_SHARDS_NUM);
+  pthread_mutex_lock(&shard->lock);
+
+  status = c_avl_get(shard->tree, key, (void *)&metric);
+  if (status == 0) {
+    *ret_shard = shard;
     return metric;
+  }
 
   key_copy = strdup(key);
   if (key_copy == NULL) {
+    pthread_mutex_unlock(&shard->lock);
     ERROR("statsd plugin: strdup failed.");
     return NULL;
   }
 
   metric = calloc(1, sizeof(*metric));
   if (metric == NULL) {
+    pthread_mutex_unlock(&shard->lock);
     ERROR("statsd plugin: calloc failed.");
     sfree(key_copy);
     return NULL;
@@ -133,34 +240,34 @@ static statsd_metric_t *statsd_metric_lookup_unsafe(char const *name, /* {{{ */
   metric->type = type;
   metric->latency = NULL;
   metric->set = NULL;
+  metric->set_hll = NULL;
 
-  status = c_avl_insert(metrics_tree, key_copy, metric);
+  status = c_avl_insert(shard->tree, key_copy, metric);
   if (status != 0) {
+    pthread_mutex_unlock(&shard->lock);
     ERROR("statsd plugin: c_avl_insert failed.");
     sfree(key_copy);
     sfree(metric);
     return NULL;
   }
 
+  *ret_shard = shard;
   return metric;
-} /* }}} statsd_metric_lookup_unsafe */
+} /* }}} statsd_metric_lock */
 
 static int statsd_metric_set(char const *name, double value, /* {{{ */
                              metric_type_t type) {
   statsd_metric_t *metric;
+  statsd_shard_t *shard;
 
-  pthread_mutex_lock(&metrics_lock);
-
-  metric = statsd_metric_lookup_unsafe(name, type);
-  if (metric == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+  metric = statsd_metric_lock(name, type, &shard);
+  if (metric == NULL)
     return -1;
-  }
 
   metric->value = value;
   metric->updates_num++;
 
-  pthread_mutex_unlock(&metrics_lock);
+  pthread_mutex_unlock(&shard->lock);
 
   return 0;
 } /* }}} int statsd_metric_set */
@@ -168,19 +275,16 @@ static int statsd_metric_set(char const *name, double value, /* {{{ */
 static int statsd_metric_add(char const *name, double delta, /* {{{ */
                              metric_type_t type) {
   statsd_metric_t *metric;
+  statsd_shard_t *shard;
 
-  pthread_mutex_lock(&metrics_lock);
-
-  metric = statsd_metric_lookup_unsafe(name, type);
-  if (metric == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+  metric = statsd_metric_lock(name, type, &shard);
+  if (metric == NULL)
     return -1;
-  }
 
   metric->value += delta;
   metric->updates_num++;
 
-  pthread_mutex_unlock(&metrics_lock);
+  pthread_mutex_unlock(&shard->lock);
 
   return 0;
 } /* }}} int statsd_metric_add */
@@ -208,6 +312,7 @@ static void statsd_metric_free(statsd_metric_t *metric) /* {{{ */
     metric->set = NULL;
   }
 
+  sfree(metric->set_hll);
   sfree(metric);
 } /* }}} void statsd_metric_free */
 
@@ -271,6 +376,7 @@ static int statsd_handle_gauge(char const *name, /* {{{ */
 static int statsd_handle_timer(char const *name, /* {{{ */
                                char const *value_str, char const *extra) {
   statsd_metric_t *metric;
+  statsd_shard_t *shard;
   value_t value_ms;
   value_t scale;
   cdtime_t value;
@@ -296,40 +402,49 @@ static int statsd_handle_timer(char const *name, /* {{{ */
 
   value = MS_TO_CDTIME_T(value_ms.gauge / scale.gauge);
 
-  pthread_mutex_lock(&metrics_lock);
-
-  metric = statsd_metric_lookup_unsafe(name, STATSD_TIMER);
-  if (metric == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+  metric = statsd_metric_lock(name, STATSD_TIMER, &shard);
+  if (metric == NULL)
     return -1;
-  }
 
   if (metric->latency == NULL)
     metric->latency = latency_counter_create();
   if (metric->latency == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+    pthread_mutex_unlock(&shard->lock);
     return -1;
   }
 
   latency_counter_add(metric->latency, value);
   metric->updates_num++;
 
-  pthread_mutex_unlock(&metrics_lock);
+  pthread_mutex_unlock(&shard->lock);
   return 0;
 } /* }}} int statsd_handle_timer */
 
 static int statsd_handle_set(char const *name, /* {{{ */
                              char const *set_key_orig) {
   statsd_metric_t *metric = NULL;
+  statsd_shard_t *shard;
   char *set_key;
   int status;
 
-  pthread_mutex_lock(&metrics_lock);
-
-  metric = statsd_metric_lookup_unsafe(name, STATSD_SET);
-  if (metric == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+  metric = statsd_metric_lock(name, STATSD_SET, &shard);
+  if (metric == NULL)
     return -1;
+
+  if (conf_approximate_sets) {
+    if (metric->set_hll == NULL)
+      metric->set_hll = calloc(STATSD_HLL_SIZE, sizeof(*metric->set_hll));
+    if (metric->set_hll == NULL) {
+      pthread_mutex_unlock(&shard->lock);
+      ERROR("statsd plugin: calloc failed.");
+      return -1;
+    }
+
+    statsd_hll_add(metric->set_hll, set_key_orig);
+    metric->updates_num++;
+
+    pthread_mutex_unlock(&shard->lock);
+    return 0;
   }
 
   /* Make sure metric->set exists. */
@@ -337,21 +452,21 @@ static int statsd_handle_set(char const *name, /* {{{ */
     metric->set = c_avl_create((int (*)(const void *, const void *))strcmp);
 
   if (metric->set == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+    pthread_mutex_unlock(&shard->lock);
     ERROR("statsd plugin: c_avl_create failed.");
     return -1;
   }
 
   set_key = strdup(set_key_orig);
   if (set_key == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
+    pthread_mutex_unlock(&shard->lock);
     ERROR("statsd plugin: strdup failed.");
     return -1;
   }
 
   status = c_avl_insert(metric->set, set_key, /* value = */ NULL);
   if (status < 0) {
-    pthread_mutex_unlock(&metrics_lock);
+    pthread_mutex_unlock(&shard->lock);
     if (status < 0)
       ERROR("statsd plugin: c_avl_insert (\"%s\") failed with status %i.",
             set_key, status);
@@ -364,7 +479,7 @@ static int statsd_handle_set(char const *name, /* {{{ */
 
   metric->updates_num++;
 
-  pthread_mutex_unlock(&metrics_lock);
+  pthread_mutex_unlock(&shard->lock);
   return 0;
 } /* }}} int statsd_handle_set */
 
@@ -438,13 +553,48 @@ static void statsd_parse_buffer(char *buffer) /* {{{ */
   }
 } /* }}} void statsd_parse_buffer */
 
-static void statsd_network_read(int fd) /* {{{ */
+#if HAVE_RECVMMSG
+/* Reads up to STATSD_RECV_BATCH datagrams with a single system call. */
+static void statsd_network_read(int fd, statsd_recv_buffer_t *rb) /* {{{ */
+{
+  int status;
+
+  for (size_t i = 0; i < STATSD_RECV_BATCH; i++) {
+    /* leave room for the terminating null byte */
+    rb->iovs[i].iov_base = rb->data[i];
+    rb->iovs[i].iov_len = STATSD_PACKET_SIZE - 1;
+
+    memset(&rb->msgs[i], 0, sizeof(rb->msgs[i]));
+    rb->msgs[i].msg_hdr.msg_iov = &rb->iovs[i];
+    rb->msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  status = recvmmsg(fd, rb->msgs, STATSD_RECV_BATCH, MSG_DONTWAIT,
+                    /* timeout = */ NULL);
+  if (status < 0) {
+    char errbuf[1024];
+
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+      return;
+
+    ERROR("statsd plugin: recvmmsg(2) failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return;
+  }
+
+  for (int i = 0; i < status; i++) {
+    rb->data[i][rb->msgs[i].msg_len] = 0;
+    statsd_parse_buffer(rb->data[i]);
+  }
+} /* }}} void statsd_network_read */
+#else  /* if !HAVE_RECVMMSG */
+static void statsd_network_read(int fd, statsd_recv_buffer_t *rb) /* {{{ */
 {
-  char buffer[4096];
+  char *buffer = rb->data[0];
   size_t buffer_size;
   ssize_t status;
 
-  status = recv(fd, buffer, sizeof(buffer), /* flags = */ MSG_DONTWAIT);
+  status = recv(fd, buffer, STATSD_PACKET_SIZE, /* flags = */ MSG_DONTWAIT);
   if (status < 0) {
     char errbuf[1024];
 
@@ -457,12 +607,13 @@ static void statsd_network_read(int fd) /* {{{ */
   }
 
   buffer_size = (size_t)status;
-  if (buffer_size >= sizeof(buffer))
-    buffer_size = sizeof(buffer) - 1;
+  if (buffer_size >= STATSD_PACKET_SIZE)
+    buffer_size = STATSD_PACKET_SIZE - 1;
   buffer[buffer_size] = 0;
 
   statsd_parse_buffer(buffer);
 } /* }}} void statsd_network_read */
+#endif /* !HAVE_RECVMMSG */
 
 static int statsd_network_init(struct pollfd **ret_fds, /* {{{ */
                                size_t *ret_fds_num) {
@@ -503,6 +654,21 @@ static int statsd_network_init(struct pollfd **ret_fds, /* {{{ */
       continue;
     }
 
+#ifdef SO_REUSEPORT
+    /* With multiple receive threads every thread binds its own socket and the
+     * kernel distributes the datagrams among them. */
+    if (conf_receive_threads > 1) {
+      int yes = 1;
+      if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) != 0) {
+        char errbuf[1024];
+        ERROR("statsd plugin: setsockopt (SO_REUSEPORT) failed: %s",
+              sstrerror(errno, errbuf, sizeof(errbuf)));
+        close(fd);
+        continue;
+      }
+    }
+#endif
+
     getnameinfo(ai_ptr->ai_addr, ai_ptr->ai_addrlen, dbg_node, sizeof(dbg_node),
                 dbg_service, sizeof(dbg_service),
                 NI_DGRAM | NI_NUMERICHOST | NI_NUMERICSERV);
@@ -548,13 +714,21 @@ static int statsd_network_init(struct pollfd **ret_fds, /* {{{ */
 
 static void *statsd_network_thread(void *args) /* {{{ */
 {
+  statsd_recv_buffer_t *rb;
   struct pollfd *fds = NULL;
   size_t fds_num = 0;
   int status;
 
+  rb = malloc(sizeof(*rb));
+  if (rb == NULL) {
+    ERROR("statsd plugin: malloc failed.");
+    pthread_exit((void *)0);
+  }
+
   status = statsd_network_init(&fds, &fds_num);
   if (status != 0) {
     ERROR("statsd plugin: Unable to open listening sockets.");
+    sfree(rb);
     pthread_exit((void *)0);
   }
 
@@ -575,7 +749,7 @@ static void *statsd_network_thread(void *args) /* {{{ */
       if ((fds[i].revents & (POLLIN | POLLPRI)) == 0)
         continue;
 
-      statsd_network_read(fds[i].fd);
+      statsd_network_read(fds[i].fd, rb);
       fds[i].revents = 0;
     }
   } /* while (!network_thread_shutdown) */
@@ -584,6 +758,7 @@ static void *statsd_network_thread(void *args) /* {{{ */
   for (size_t i = 0; i < fds_num; i++)
     close(fds[i].fd);
   sfree(fds);
+  sfree(rb);
 
   return (void *)0;
 } /* }}} void *statsd_network_thread */
@@ -648,42 +823,81 @@ static int statsd_config(oconfig_item_t *ci) /* {{{ */
       cf_util_get_boolean(child, &conf_timer_count);
     else if (strcasecmp("TimerPercentile", child->key) == 0)
       statsd_config_timer_percentile(child);
+    else if (strcasecmp("ReceiveThreads", child->key) == 0)
+      cf_util_get_int(child, &conf_receive_threads);
+    else if (strcasecmp("ApproximateSets", child->key) == 0)
+      cf_util_get_boolean(child, &conf_approximate_sets);
     else
       ERROR("statsd plugin: The \"%s\" config option is not valid.",
             child->key);
   }
 
+  if (conf_receive_threads < 1) {
+    WARNING("statsd plugin: \"ReceiveThreads\" must be at least one.");
+    conf_receive_threads = 1;
+  }
+#ifndef SO_REUSEPORT
+  if (conf_receive_threads > 1) {
+    WARNING("statsd plugin: \"ReceiveThreads\" requires SO_REUSEPORT, which "
+            "is not available on this system. Using one thread.");
+    conf_receive_threads = 1;
+  }
+#endif
+
   return 0;
 } /* }}} int statsd_config */
 
+static int statsd_metrics_init(void) /* {{{ */
+{
+  if (metrics_initialized)
+    return 0;
+
+  for (size_t i = 0; i < STATSD_SHARDS_NUM; i++) {
+    pthread_mutex_init(&metrics_shards[i].lock, /* attr = */ NULL);
+    metrics_shards[i].tree =
+        c_avl_create((int (*)(const void *, const void *))strcmp);
+    if (metrics_shards[i].tree == NULL) {
+      ERROR("statsd plugin: c_avl_create failed.");
+      return -1;
+    }
+  }
+  metrics_initialized = 1;
+
+  return 0;
+} /* }}} int statsd_metrics_init */
+
 static int statsd_init(void) /* {{{ */
 {
-  pthread_mutex_lock(&metrics_lock);
-  if (metrics_tree == NULL)
-    metrics_tree = c_avl_create((int (*)(const void *, const void *))strcmp);
+  if (statsd_metrics_init() != 0)
+    return -1;
 
-  if (!network_thread_running) {
-    int status;
+  if (network_threads == NULL) {
+    network_threads =
+        calloc((size_t)conf_receive_threads, sizeof(*network_threads));
+    if (network_threads == NULL) {
+      ERROR("statsd plugin: calloc failed.");
+      return -1;
+    }
 
-    status = pthread_create(&network_thread,
-                            /* attr = */ NULL, statsd_network_thread,
-                            /* args = */ NULL);
-    if (status != 0) {
-      char errbuf[1024];
-      pthread_mutex_unlock(&metrics_lock);
-      ERROR("statsd plugin: pthread_create failed: %s",
-            sstrerror(errno, errbuf, sizeof(errbuf)));
-      return status;
+    for (int i = 0; i < conf_receive_threads; i++) {
+      int status = plugin_thread_create(&network_threads[network_threads_num],
+                                        /* attr = */ NULL,
+                                        statsd_network_thread,
+                                        /* args = */ NULL, "statsd listen");
+      if (status != 0) {
+        char errbuf[1024];
+        ERROR("statsd plugin: pthread_create failed: %s",
+              sstrerror(status, errbuf, sizeof(errbuf)));
+        return status;
+      }
+      network_threads_num++;
     }
   }
-  network_thread_running = 1;
-
-  pthread_mutex_unlock(&metrics_lock);
 
   return 0;
 } /* }}} int statsd_init */
 
-/* Must hold metrics_lock when calling this function. */
+/* Must hold the lock of the metric's shard when calling this function. */
 static int statsd_metric_clear_set_unsafe(statsd_metric_t *metric) /* {{{ */
 {
   void *key;
@@ -692,6 +906,9 @@ static int statsd_metric_clear_set_unsafe(statsd_metric_t *metric) /* {{{ */
   if ((metric == NULL) || (metric->type != STATSD_SET))
     return EINVAL;
 
+  if (metric->set_hll != NULL)
+    memset(metric->set_hll, 0, STATSD_HLL_SIZE * sizeof(*metric->set_hll));
+
   if (metric->set == NULL)
     return 0;
 
@@ -703,7 +920,7 @@ static int statsd_metric_clear_set_unsafe(statsd_metric_t *metric) /* {{{ */
   return 0;
 } /* }}} int statsd_metric_clear_set_unsafe */
 
-/* Must hold metrics_lock when calling this function. */
+/* Must hold the lock of the metric's shard when calling this function. */
 static int statsd_metric_submit_unsafe(char const *name,
                                        statsd_metric_t *metric) /* {{{ */
 {
@@ -788,7 +1005,9 @@ static int statsd_metric_submit_unsafe(char const *name,
     latency_counter_reset(metric->latency);
     return 0;
   } else if (metric->type == STATSD_SET) {
-    if (metric->set == NULL)
+    if (metric->set_hll != NULL)
+      vl.values[0].gauge = nearbyint(statsd_hll_estimate(metric->set_hll));
+    else if (metric->set == NULL)
       vl.values[0].gauge = 0.0;
     else
       vl.values[0].gauge = (gauge_t)c_avl_size(metric->set);
@@ -819,7 +1038,7 @@ static int statsd_metric_submit_unsafe(char const *name,
   return plugin_dispatch_values(&vl);
 } /* }}} int statsd_metric_submit_unsafe */
 
-static int statsd_read(void) /* {{{ */
+static void statsd_read_shard(statsd_shard_t *shard) /* {{{ */
 {
   c_avl_iterator_t *iter;
   char *name;
@@ -828,14 +1047,9 @@ static int statsd_read(void) /* {{{ */
   char **to_be_deleted = NULL;
   size_t to_be_deleted_num = 0;
 
-  pthread_mutex_lock(&metrics_lock);
+  pthread_mutex_lock(&shard->lock);
 
-  if (metrics_tree == NULL) {
-    pthread_mutex_unlock(&metrics_lock);
-    return 0;
-  }
-
-  iter = c_avl_get_iterator(metrics_tree);
+  iter = c_avl_get_iterator(shard->tree);
   while (c_avl_iterator_next(iter, (void *)&name, (void *)&metric) == 0) {
     if ((metric->updates_num == 0) &&
         ((conf_delete_counters && (metric->type == STATSD_COUNTER)) ||
@@ -861,7 +1075,7 @@ static int statsd_read(void) /* {{{ */
   for (size_t i = 0; i < to_be_deleted_num; i++) {
     int status;
 
-    status = c_avl_remove(metrics_tree, to_be_deleted[i], (void *)&name,
+    status = c_avl_remove(shard->tree, to_be_deleted[i], (void *)&name,
                           (void *)&metric);
     if (status != 0) {
       ERROR("stats plugin: c_avl_remove (\"%s\") failed with status %i.",
@@ -873,9 +1087,20 @@ static int statsd_read(void) /* {{{ */
     statsd_metric_free(metric);
   }
 
-  pthread_mutex_unlock(&metrics_lock);
+  pthread_mutex_unlock(&shard->lock);
 
   strarray_free(to_be_deleted, to_be_deleted_num);
+} /* }}} void statsd_read_shard */
+
+static int statsd_read(void) /* {{{ */
+{
+  if (!metrics_initialized)
+    return 0;
+
+  /* Only one shard is locked at a time, so the receive threads are blocked
+   * for a small fraction of the metrics only. */
+  for (size_t i = 0; i < STATSD_SHARDS_NUM; i++)
+    statsd_read_shard(metrics_shards + i);
 
   return 0;
 } /* }}} int statsd_read */
@@ -885,27 +1110,34 @@ static int statsd_shutdown(void) /* {{{ */
   void *key;
   void *value;
 
-  if (network_thread_running) {
-    network_thread_shutdown = 1;
-    pthread_kill(network_thread, SIGTERM);
-    pthread_join(network_thread, /* retval = */ NULL);
-  }
-  network_thread_running = 0;
-
-  pthread_mutex_lock(&metrics_lock);
-
-  while (c_avl_pick(metrics_tree, &key, &value) == 0) {
-    sfree(key);
-    statsd_metric_free(value);
+  network_thread_shutdown = 1;
+  for (size_t i = 0; i < network_threads_num; i++)
+    pthread_kill(network_threads[i], SIGTERM);
+  for (size_t i = 0; i < network_threads_num; i++)
+    pthread_join(network_threads[i], /* retval = */ NULL);
+  sfree(network_threads);
+  network_threads_num = 0;
+
+  if (metrics_initialized) {
+    for (size_t i = 0; i < STATSD_SHARDS_NUM; i++) {
+      statsd_shard_t *shard = metrics_shards + i;
+
+      pthread_mutex_lock(&shard->lock);
+      while (c_avl_pick(shard->tree, &key, &value) == 0) {
+        sfree(key);
+        statsd_metric_free(value);
+      }
+      c_avl_destroy(shard->tree);
+      shard->tree = NULL;
+      pthread_mutex_unlock(&shard->lock);
+      pthread_mutex_destroy(&shard->lock);
+    }
+    metrics_initialized = 0;
   }
-  c_avl_destroy(metrics_tree);
-  metrics_tree = NULL;
 
   sfree(conf_node);
   sfree(conf_service);
 
-  pthread_mutex_unlock(&metrics_lock);
-
   return 0;
 } /* }}} int statsd_shutdown */
 
@@ -0,0 +1,182 @@
+/**
+ * collectd - src/statsd_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/* Values dispatched by statsd_read() are captured by test_dispatch_values()
+ * instead of the mock. */
+#define plugin_dispatch_values test_dispatch_values
+#include "statsd.c"
+#undef plugin_dispatch_values
+
+#include "testing.h"
+
+#define TEST_METRICS 500
+#define TEST_UPDATES 3
+
+static size_t dispatched_num;
+static derive_t dispatched_derive_sum;
+static gauge_t dispatched_gauge_sum;
+static gauge_t dispatched_objects_sum;
+
+int test_dispatch_values(value_list_t const *vl) {
+  dispatched_num++;
+  if (strcmp("derive", vl->type) == 0)
+    dispatched_derive_sum += vl->values[0].derive;
+  else if (strcmp("gauge", vl->type) == 0)
+    dispatched_gauge_sum += vl->values[0].gauge;
+  else if (strcmp("objects", vl->type) == 0)
+    dispatched_objects_sum += vl->values[0].gauge;
+  return 0;
+}
+
+static void test_dispatch_reset(void) {
+  dispatched_num = 0;
+  dispatched_derive_sum = 0;
+  dispatched_gauge_sum = 0.0;
+  dispatched_objects_sum = 0.0;
+}
+
+static void test_parse(char const *format, int i, int value) {
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer), format, i, value);
+  statsd_parse_buffer(buffer);
+}
+
+DEF_TEST(hll_estimate) {
+  /* The standard error is 1.04 / sqrt(STATSD_HLL_SIZE), about 1.6%. Allow
+   * three standard errors. Since the hash is deterministic, so is the
+   * estimate. */
+  double max_error = 3.0 * 1.04 / sqrt((double)STATSD_HLL_SIZE);
+  int cardinalities[] = {0, 1, 10, 100, 1000, 10000, 100000, 1000000};
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(cardinalities); i++) {
+    int n = cardinalities[i];
+    uint8_t *registers = calloc(STATSD_HLL_SIZE, sizeof(*registers));
+    CHECK_NOT_NULL(registers);
+
+    for (int j = 0; j < n; j++) {
+      char key[32];
+      snprintf(key, sizeof(key), "key-%d", j);
+      statsd_hll_add(registers, key);
+      /* Duplicates must not change the estimate. */
+      if ((j % 2) == 0)
+        statsd_hll_add(registers, key);
+    }
+
+    double estimate = statsd_hll_estimate(registers);
+    double error = (n == 0) ? estimate : fabs(estimate - n) / (double)n;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "cardinality %d: estimate %.0f, error %.4f", n,
+             estimate, error);
+    OK1(error <= max_error, msg);
+
+    sfree(registers);
+  }
+
+  return 0;
+}
+
+DEF_TEST(approximate_sets) {
+  conf_approximate_sets = 1;
+  CHECK_ZERO(statsd_metrics_init());
+
+  for (int i = 0; i < 10000; i++) {
+    test_parse("set.approximate:%d|s", i, 0);
+    test_parse("set.approximate:%d|s", i % 100, 0);
+  }
+
+  test_dispatch_reset();
+  CHECK_ZERO(statsd_read());
+  EXPECT_EQ_INT(1, (int)dispatched_num);
+
+  double error = fabs(dispatched_objects_sum - 10000.0) / 10000.0;
+  OK1(error <= 3.0 * 1.04 / sqrt((double)STATSD_HLL_SIZE),
+      "approximate set size is within three standard errors");
+
+  /* The set is cleared after each read. */
+  test_dispatch_reset();
+  CHECK_ZERO(statsd_read());
+  EXPECT_EQ_DOUBLE(0.0, dispatched_objects_sum);
+
+  statsd_shutdown();
+  conf_approximate_sets = 0;
+  return 0;
+}
+
+DEF_TEST(shards) {
+  conf_approximate_sets = 0;
+  CHECK_ZERO(statsd_metrics_init());
+
+  for (int j = 0; j < TEST_UPDATES; j++) {
+    for (int i = 0; i < TEST_METRICS; i++) {
+      test_parse("counter.%d:%d|c", i, 1);
+      test_parse("gauge.%d:%d|g", i, i);
+      test_parse("set.%d:%d|s", i, j);
+    }
+  }
+
+  /* Metrics are spread over the shards by name. The totals must not depend
+   * on the number of shards, see test_plugin_statsd_single_shard. */
+  size_t shards_used = 0;
+  size_t metrics_num = 0;
+  for (size_t i = 0; i < STATSD_SHARDS_NUM; i++) {
+    int size = c_avl_size(metrics_shards[i].tree);
+    if (size > 0)
+      shards_used++;
+    metrics_num += (size_t)size;
+  }
+  EXPECT_EQ_INT(3 * TEST_METRICS, (int)metrics_num);
+  if (STATSD_SHARDS_NUM > 1)
+    OK1(shards_used == STATSD_SHARDS_NUM, "metrics use all shards");
+
+  test_dispatch_reset();
+  CHECK_ZERO(statsd_read());
+  EXPECT_EQ_INT(3 * TEST_METRICS, (int)dispatched_num);
+  EXPECT_EQ_INT(TEST_METRICS * TEST_UPDATES, (int)dispatched_derive_sum);
+  EXPECT_EQ_DOUBLE((double)(TEST_METRICS * (TEST_METRICS - 1) / 2),
+                   dispatched_gauge_sum);
+  EXPECT_EQ_DOUBLE((double)(TEST_METRICS * TEST_UPDATES),
+                   dispatched_objects_sum);
+
+  /* Counters are cumulative, sets are cleared after each read. */
+  for (int i = 0; i < TEST_METRICS; i++)
+    test_parse("counter.%d:%d|c", i, 2);
+
+  test_dispatch_reset();
+  CHECK_ZERO(statsd_read());
+  EXPECT_EQ_INT(3 * TEST_METRICS, (int)dispatched_num);
+  EXPECT_EQ_INT(TEST_METRICS * (TEST_UPDATES + 2),
+                (int)dispatched_derive_sum);
+  EXPECT_EQ_DOUBLE(0.0, dispatched_objects_sum);
+
+  statsd_shutdown();
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(hll_estimate);
+  RUN_TEST(approximate_sets);
+  RUN_TEST(shards);
+
+  END_TEST;
+}
@@ -50,9 +50,11 @@ static int sl_config(const char *key, const char *value) {
     log_level = parse_log_severity(value);
     if (log_level < 0) {
       log_level = LOG_INFO;
+      plugin_set_log_level("syslog", log_level);
       ERROR("syslog: invalid loglevel [%s] defaulting to 'info'", value);
       return 1;
     }
+    plugin_set_log_level("syslog", log_level);
   } else if (strcasecmp(key, "NotifyLevel") == 0) {
     notif_severity = parse_notif_severity(value);
     if (notif_severity < 0)
@@ -145,6 +147,7 @@ void module_register(void) {
 
   plugin_register_config("syslog", sl_config, config_keys, config_keys_num);
   plugin_register_log("syslog", sl_log, /* user_data = */ NULL);
+  plugin_set_log_level("syslog", log_level);
   plugin_register_notification("syslog", sl_notification, NULL);
   plugin_register_shutdown("syslog", sl_shutdown);
 } /* void module_register(void) */
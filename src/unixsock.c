@@ -32,27 +32,43 @@
 #include "utils_cmd_flush.h"
 #include "utils_cmd_getthreshold.h"
 #include "utils_cmd_getval.h"
+#include "utils_cmd_history.h"
 #include "utils_cmd_listval.h"
 #include "utils_cmd_putnotif.h"
 #include "utils_cmd_putval.h"
+#include "utils_cmd_putvals.h"
 
 #include <sys/stat.h>
 #include <sys/un.h>
 
 #include <grp.h>
 
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifndef UNIX_PATH_MAX
 #define UNIX_PATH_MAX sizeof(((struct sockaddr_un *)0)->sun_path)
 #endif
 
 #define US_DEFAULT_PATH LOCALSTATEDIR "/run/" PACKAGE_NAME "-unixsock"
 
+#ifndef US_DEFAULT_WORKER_THREADS
+#define US_DEFAULT_WORKER_THREADS 4
+#endif
+
+/* Maximum length of a command line. */
+#define US_LINE_SIZE 65536
+
+/* Clients that do not read their responses for this long are disconnected. */
+#define US_SEND_TIMEOUT 10
+
 /*
  * Private variables
  */
 /* valid configuration file keys */
 static const char *config_keys[] = {"SocketFile", "SocketGroup", "SocketPerms",
-                                    "DeleteSocket"};
+                                    "DeleteSocket", "WorkerThreads"};
 static int config_keys_num = STATIC_ARRAY_SIZE(config_keys);
 
 static int loop = 0;
@@ -63,6 +79,7 @@ static char *sock_file = NULL;
 static char *sock_group = NULL;
 static int sock_perms = S_IRWXU | S_IRWXG;
 static _Bool delete_socket = 0;
+static int worker_threads_num = US_DEFAULT_WORKER_THREADS;
 
 static pthread_t listen_thread = (pthread_t)0;
 
@@ -163,10 +180,355 @@ static int us_open_socket(void) {
   return 0;
 } /* int us_open_socket */
 
+/* us_handle_command executes one command line. "putvals" holds the state of
+ * PUTVALS blocks on this connection and is allocated on first use. Returns
+ * non-zero if the connection should be closed. */
+static int us_handle_command(FILE *fhout, cmd_putvals_t **putvals,
+                             char const *command, char *buffer) {
+  if (cmd_putvals_active(*putvals)) {
+    cmd_handle_putvals(fhout, *putvals, buffer);
+  } else if (strcasecmp(command, "putvals") == 0) {
+    if (*putvals == NULL)
+      *putvals = cmd_putvals_create();
+    if (*putvals == NULL)
+      fprintf(fhout, "-1 malloc failed\n");
+    else
+      cmd_handle_putvals(fhout, *putvals, buffer);
+  } else if (strcasecmp(command, "getval") == 0) {
+    cmd_handle_getval(fhout, buffer);
+  } else if (strcasecmp(command, "getthreshold") == 0) {
+    handle_getthreshold(fhout, buffer);
+  } else if (strcasecmp(command, "putval") == 0) {
+    cmd_handle_putval(fhout, buffer);
+  } else if (strcasecmp(command, "listval") == 0) {
+    cmd_handle_listval(fhout, buffer);
+  } else if (strcasecmp(command, "putnotif") == 0) {
+    handle_putnotif(fhout, buffer);
+  } else if (strcasecmp(command, "flush") == 0) {
+    cmd_handle_flush(fhout, buffer);
+  } else if (strcasecmp(command, "history") == 0) {
+    cmd_handle_history(fhout, buffer);
+  } else {
+    if ((fprintf(fhout, "-1 Unknown command: %s\n", command) < 0) ||
+        (fflush(fhout) != 0)) {
+      char errbuf[1024];
+      WARNING("unixsock plugin: failed to write to socket #%i: %s",
+              fileno(fhout), sstrerror(errno, errbuf, sizeof(errbuf)));
+      return -1;
+    }
+  }
+
+  return ferror(fhout) ? -1 : 0;
+} /* int us_handle_command */
+
+#if HAVE_SYS_EPOLL_H
+/*
+ * Event driven server: a single thread waits for all connections using epoll
+ * and hands connections with pending input to a fixed number of worker
+ * threads. Each connection is registered with EPOLLONESHOT, so it is handled
+ * by at most one worker at a time, and re-armed once its input has been
+ * processed.
+ */
+typedef struct us_client_s {
+  int fd;
+  FILE *fh;
+
+  char buffer[US_LINE_SIZE];
+  size_t fill;
+  /* The current line is too long and is being skipped. */
+  _Bool discard;
+
+  cmd_putvals_t *putvals;
+
+  struct us_client_s *queue_next;
+  struct us_client_s *prev;
+  struct us_client_s *next;
+} us_client_t;
+
+static int epoll_fd = -1;
+
+static pthread_mutex_t clients_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t clients_cond = PTHREAD_COND_INITIALIZER;
+static us_client_t *clients;
+static us_client_t *queue_head;
+static us_client_t *queue_tail;
+static _Bool workers_stop;
+
+static pthread_t *workers;
+static size_t workers_num;
+
+static void us_client_close(us_client_t *c) {
+  pthread_mutex_lock(&clients_lock);
+  if (c->prev != NULL)
+    c->prev->next = c->next;
+  else
+    clients = c->next;
+  if (c->next != NULL)
+    c->next->prev = c->prev;
+  pthread_mutex_unlock(&clients_lock);
+
+  DEBUG("unixsock plugin: Closing connection on fd #%i", c->fd);
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+  if (c->fh != NULL)
+    fclose(c->fh);
+  close(c->fd);
+  cmd_putvals_destroy(c->putvals);
+  sfree(c);
+} /* void us_client_close */
+
+static int us_client_arm(us_client_t *c, int op) {
+  struct epoll_event ev = {
+      .events = EPOLLIN | EPOLLONESHOT, .data.ptr = c,
+  };
+
+  if (epoll_ctl(epoll_fd, op, c->fd, &ev) != 0) {
+    char errbuf[1024];
+    ERROR("unixsock plugin: epoll_ctl failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+
+  return 0;
+} /* int us_client_arm */
+
+static void us_client_accept(int fd) {
+  us_client_t *c = calloc(1, sizeof(*c));
+  if (c == NULL) {
+    ERROR("unixsock plugin: calloc failed.");
+    close(fd);
+    return;
+  }
+  c->fd = fd;
+
+  /* Responses are written with blocking I/O, but a client that stops reading
+   * must not block a worker forever. */
+  struct timeval tv = {.tv_sec = US_SEND_TIMEOUT};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  int fdout = dup(fd);
+  if (fdout >= 0)
+    c->fh = fdopen(fdout, "w");
+  if (c->fh == NULL) {
+    char errbuf[1024];
+    ERROR("unixsock plugin: fdopen failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    if (fdout >= 0)
+      close(fdout);
+    close(fd);
+    sfree(c);
+    return;
+  }
+
+  pthread_mutex_lock(&clients_lock);
+  c->next = clients;
+  if (clients != NULL)
+    clients->prev = c;
+  clients = c;
+  pthread_mutex_unlock(&clients_lock);
+
+  if (us_client_arm(c, EPOLL_CTL_ADD) != 0)
+    us_client_close(c);
+} /* void us_client_accept */
+
+/* us_client_handle reads the available input and executes all complete
+ * lines. Returns non-zero if the connection should be closed. */
+static int us_client_handle(us_client_t *c) {
+  ssize_t status = read(c->fd, c->buffer + c->fill, sizeof(c->buffer) - c->fill);
+  if (status < 0) {
+    if ((errno == EINTR) || (errno == EAGAIN))
+      return 0;
+
+    char errbuf[1024];
+    WARNING("unixsock plugin: failed to read from socket #%i: %s", c->fd,
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  } else if (status == 0) {
+    return -1;
+  }
+  c->fill += (size_t)status;
+
+  size_t offset = 0;
+  while (offset < c->fill) {
+    char *line = c->buffer + offset;
+    char *end = memchr(line, '\n', c->fill - offset);
+    if (end == NULL)
+      break;
+    *end = 0;
+    offset = (size_t)(end - c->buffer) + 1;
+
+    if (c->discard) {
+      c->discard = 0;
+      continue;
+    }
+
+    if ((end > line) && (end[-1] == '\r'))
+      end[-1] = 0;
+    while ((*line == ' ') || (*line == '\t'))
+      line++;
+    if (*line == 0)
+      continue;
+
+    char command[32];
+    size_t command_len = strcspn(line, " \t");
+    if (command_len >= sizeof(command))
+      command_len = sizeof(command) - 1;
+    memcpy(command, line, command_len);
+    command[command_len] = 0;
+
+    if (us_handle_command(c->fh, &c->putvals, command, line) != 0)
+      return -1;
+  }
+
+  if (offset > 0) {
+    memmove(c->buffer, c->buffer + offset, c->fill - offset);
+    c->fill -= offset;
+  }
+
+  if (c->fill == sizeof(c->buffer)) {
+    fprintf(c->fh, "-1 Line too long\n");
+    fflush(c->fh);
+    c->fill = 0;
+    c->discard = 1;
+  }
+
+  return 0;
+} /* int us_client_handle */
+
+static void *us_worker_thread(void __attribute__((unused)) * arg) {
+  pthread_mutex_lock(&clients_lock);
+  while (!workers_stop) {
+    us_client_t *c = queue_head;
+    if (c == NULL) {
+      pthread_cond_wait(&clients_cond, &clients_lock);
+      continue;
+    }
+
+    queue_head = c->queue_next;
+    if (queue_head == NULL)
+      queue_tail = NULL;
+    c->queue_next = NULL;
+    pthread_mutex_unlock(&clients_lock);
+
+    if ((us_client_handle(c) != 0) || (us_client_arm(c, EPOLL_CTL_MOD) != 0))
+      us_client_close(c);
+
+    pthread_mutex_lock(&clients_lock);
+  }
+  pthread_mutex_unlock(&clients_lock);
+
+  return (void *)0;
+} /* void *us_worker_thread */
+
+static int us_start_workers(void) {
+  workers = calloc((size_t)worker_threads_num, sizeof(*workers));
+  if (workers == NULL)
+    return -1;
+
+  workers_stop = 0;
+  for (int i = 0; i < worker_threads_num; i++) {
+    int status = plugin_thread_create(&workers[workers_num], NULL,
+                                      us_worker_thread, NULL, "unixsock worker");
+    if (status != 0) {
+      char errbuf[1024];
+      ERROR("unixsock plugin: pthread_create failed: %s",
+            sstrerror(status, errbuf, sizeof(errbuf)));
+      break;
+    }
+    workers_num++;
+  }
+
+  return (workers_num > 0) ? 0 : -1;
+} /* int us_start_workers */
+
+static void us_stop_workers(void) {
+  pthread_mutex_lock(&clients_lock);
+  workers_stop = 1;
+  pthread_cond_broadcast(&clients_cond);
+  pthread_mutex_unlock(&clients_lock);
+
+  for (size_t i = 0; i < workers_num; i++)
+    pthread_join(workers[i], NULL);
+  sfree(workers);
+  workers_num = 0;
+
+  /* All workers are gone, so the remaining connections are idle. */
+  while (clients != NULL)
+    us_client_close(clients);
+  queue_head = queue_tail = NULL;
+} /* void us_stop_workers */
+
+static int us_event_loop(void) {
+  char errbuf[1024];
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    ERROR("unixsock plugin: epoll_create1 failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+
+  fcntl(sock_fd, F_SETFL, fcntl(sock_fd, F_GETFL) | O_NONBLOCK);
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+  if ((epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock_fd, &ev) != 0) ||
+      (us_start_workers() != 0)) {
+    ERROR("unixsock plugin: Setting up the server failed.");
+    us_stop_workers();
+    close(epoll_fd);
+    epoll_fd = -1;
+    return -1;
+  }
+
+  while (loop != 0) {
+    struct epoll_event events[64];
+
+    int num = epoll_wait(epoll_fd, events, STATIC_ARRAY_SIZE(events), 1000);
+    if (num < 0) {
+      if (errno == EINTR)
+        continue;
+      ERROR("unixsock plugin: epoll_wait failed: %s",
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      break;
+    }
+
+    for (int i = 0; i < num; i++) {
+      us_client_t *c = events[i].data.ptr;
+
+      if (c == NULL) {
+        int fd;
+        while ((fd = accept(sock_fd, NULL, NULL)) >= 0) {
+          DEBUG("unixsock plugin: Accepted connection on fd #%i", fd);
+          us_client_accept(fd);
+        }
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+          ERROR("unixsock plugin: accept failed: %s",
+                sstrerror(errno, errbuf, sizeof(errbuf)));
+        continue;
+      }
+
+      pthread_mutex_lock(&clients_lock);
+      if (queue_tail == NULL)
+        queue_head = c;
+      else
+        queue_tail->queue_next = c;
+      queue_tail = c;
+      pthread_cond_signal(&clients_cond);
+      pthread_mutex_unlock(&clients_lock);
+    }
+  } /* while (loop) */
+
+  us_stop_workers();
+  close(epoll_fd);
+  epoll_fd = -1;
+
+  return 0;
+} /* int us_event_loop */
+#endif /* HAVE_SYS_EPOLL_H */
+
 static void *us_handle_client(void *arg) {
   int fdin;
   int fdout;
   FILE *fhin, *fhout;
+  cmd_putvals_t *putvals = NULL;
 
   fdin = *((int *)arg);
   free(arg);
@@ -250,35 +612,19 @@ static void *us_handle_client(void *arg) {
         strsplit(buffer_copy, fields, sizeof(fields) / sizeof(fields[0]));
     if (fields_num < 1) {
       fprintf(fhout, "-1 Internal error\n");
+      cmd_putvals_destroy(putvals);
       fclose(fhin);
       fclose(fhout);
       pthread_exit((void *)1);
       return (void *)1;
     }
 
-    if (strcasecmp(fields[0], "getval") == 0) {
-      cmd_handle_getval(fhout, buffer);
-    } else if (strcasecmp(fields[0], "getthreshold") == 0) {
-      handle_getthreshold(fhout, buffer);
-    } else if (strcasecmp(fields[0], "putval") == 0) {
-      cmd_handle_putval(fhout, buffer);
-    } else if (strcasecmp(fields[0], "listval") == 0) {
-      cmd_handle_listval(fhout, buffer);
-    } else if (strcasecmp(fields[0], "putnotif") == 0) {
-      handle_putnotif(fhout, buffer);
-    } else if (strcasecmp(fields[0], "flush") == 0) {
-      cmd_handle_flush(fhout, buffer);
-    } else {
-      if (fprintf(fhout, "-1 Unknown command: %s\n", fields[0]) < 0) {
-        char errbuf[1024];
-        WARNING("unixsock plugin: failed to write to socket #%i: %s",
-                fileno(fhout), sstrerror(errno, errbuf, sizeof(errbuf)));
-        break;
-      }
-    }
+    if (us_handle_command(fhout, &putvals, fields[0], buffer) != 0)
+      break;
   } /* while (fgets) */
 
   DEBUG("unixsock plugin: us_handle_client: Exiting..");
+  cmd_putvals_destroy(putvals);
   fclose(fhin);
   fclose(fhout);
 
@@ -298,6 +644,12 @@ static void *us_server_thread(void __attribute__((unused)) * arg) {
   if (us_open_socket() != 0)
     pthread_exit((void *)1);
 
+#if HAVE_SYS_EPOLL_H
+  /* Only fall back to one thread per connection if epoll does not work. */
+  if (us_event_loop() == 0)
+    loop = 0;
+#endif
+
   while (loop != 0) {
     DEBUG("unixsock plugin: Calling accept..");
     status = accept(sock_fd, NULL, NULL);
@@ -376,6 +728,13 @@ static int us_config(const char *key, const char *val) {
       delete_socket = 1;
     else
       delete_socket = 0;
+  } else if (strcasecmp(key, "WorkerThreads") == 0) {
+    int tmp = atoi(val);
+    if (tmp < 1) {
+      ERROR("unixsock plugin: \"WorkerThreads\" must be at least one.");
+      return 1;
+    }
+    worker_threads_num = tmp;
   } else {
     return -1;
   }
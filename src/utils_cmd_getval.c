@@ -37,41 +37,64 @@ cmd_status_t cmd_parse_getval(size_t argc, char **argv,
                               cmd_getval_t *ret_getval,
                               const cmd_options_t *opts,
                               cmd_error_handler_t *err) {
-  char *identifier_copy;
-  int status;
-
   if ((ret_getval == NULL) || (opts == NULL)) {
     errno = EINVAL;
     cmd_error(CMD_ERROR, err, "Invalid arguments to cmd_parse_getval.");
     return CMD_ERROR;
   }
 
-  if (argc != 1) {
-    if (argc == 0)
-      cmd_error(CMD_PARSE_ERROR, err, "Missing identifier.");
-    else
-      cmd_error(CMD_PARSE_ERROR, err, "Garbage after identifier: `%s'.",
-                argv[1]);
+  if (argc == 0) {
+    cmd_error(CMD_PARSE_ERROR, err, "Missing identifier.");
     return CMD_PARSE_ERROR;
   }
 
-  /* parse_identifier() modifies its first argument,
-   * returning pointers into it */
-  identifier_copy = sstrdup(argv[0]);
+  if (argc > 1) {
+    ret_getval->raw_identifiers = calloc(argc, sizeof(char *));
+    ret_getval->identifiers = calloc(argc, sizeof(identifier_t));
+    if ((ret_getval->raw_identifiers == NULL) ||
+        (ret_getval->identifiers == NULL)) {
+      cmd_error(CMD_ERROR, err, "calloc failed.");
+      cmd_destroy_getval(ret_getval);
+      return CMD_ERROR;
+    }
+  }
 
-  status = parse_identifier(
-      argv[0], &ret_getval->identifier.host, &ret_getval->identifier.plugin,
-      &ret_getval->identifier.plugin_instance, &ret_getval->identifier.type,
-      &ret_getval->identifier.type_instance, opts->identifier_default_host);
-  if (status != 0) {
-    DEBUG("cmd_parse_getval: Cannot parse identifier `%s'.", identifier_copy);
-    cmd_error(CMD_PARSE_ERROR, err, "Cannot parse identifier `%s'.",
-              identifier_copy);
-    sfree(identifier_copy);
-    return CMD_PARSE_ERROR;
+  for (size_t i = 0; i < argc; i++) {
+    identifier_t *id = (argc > 1) ? ret_getval->identifiers + i
+                                  : &ret_getval->identifier;
+
+    /* parse_identifier() modifies its first argument,
+     * returning pointers into it */
+    char *identifier_copy = sstrdup(argv[i]);
+
+    int status = parse_identifier(argv[i], &id->host, &id->plugin,
+                                  &id->plugin_instance, &id->type,
+                                  &id->type_instance,
+                                  opts->identifier_default_host);
+    if (status != 0) {
+      DEBUG("cmd_parse_getval: Cannot parse identifier `%s'.",
+            identifier_copy);
+      cmd_error(CMD_PARSE_ERROR, err, "Cannot parse identifier `%s'.",
+                identifier_copy);
+      sfree(identifier_copy);
+      cmd_destroy_getval(ret_getval);
+      return CMD_PARSE_ERROR;
+    }
+
+    if (argc == 1) {
+      ret_getval->raw_identifier = identifier_copy;
+      break;
+    }
+
+    ret_getval->raw_identifiers[i] = identifier_copy;
+    ret_getval->identifiers_num++;
+  }
+
+  if (argc > 1) {
+    ret_getval->raw_identifier = sstrdup(ret_getval->raw_identifiers[0]);
+    ret_getval->identifier = ret_getval->identifiers[0];
   }
 
-  ret_getval->raw_identifier = identifier_copy;
   return CMD_OK;
 } /* cmd_status_t cmd_parse_getval */
 
@@ -86,6 +109,70 @@ cmd_status_t cmd_parse_getval(size_t argc, char **argv,
     fflush(fh);                                                                \
   } while (0)
 
+/* cmd_handle_getval_multi answers a GETVAL with multiple identifiers with one
+ * line per identifier, in the order in which they were given:
+ *
+ *   <identifier> <ds0>=<value> [<ds1>=<value> ...]
+ *   <identifier> error="<message>"
+ *
+ * The response is flushed once at the end. */
+static cmd_status_t cmd_handle_getval_multi(FILE *fh,
+                                            cmd_getval_t const *getval) {
+  print_to_socket(fh, "%zu Value%s found\n", getval->identifiers_num,
+                  (getval->identifiers_num == 1) ? "" : "s");
+
+  for (size_t i = 0; i < getval->identifiers_num; i++) {
+    char const *name = getval->raw_identifiers[i];
+    gauge_t *values = NULL;
+    size_t values_num = 0;
+
+    const data_set_t *ds = plugin_get_ds(getval->identifiers[i].type);
+    if (ds == NULL) {
+      if (fprintf(fh, "%s error=\"Type `%s' is unknown.\"\n", name,
+                  getval->identifiers[i].type) < 0)
+        return CMD_ERROR;
+      continue;
+    }
+
+    if ((uc_get_rate_by_name(name, &values, &values_num) != 0) ||
+        (values_num != ds->ds_num)) {
+      sfree(values);
+      if (fprintf(fh, "%s error=\"No such value.\"\n", name) < 0)
+        return CMD_ERROR;
+      continue;
+    }
+
+    if (fputs(name, fh) < 0) {
+      sfree(values);
+      return CMD_ERROR;
+    }
+    for (size_t j = 0; j < values_num; j++) {
+      int status;
+      if (isnan(values[j]))
+        status = fprintf(fh, " %s=NaN", ds->ds[j].name);
+      else
+        status = fprintf(fh, " %s=%12e", ds->ds[j].name, values[j]);
+      if (status < 0) {
+        sfree(values);
+        return CMD_ERROR;
+      }
+    }
+    sfree(values);
+
+    if (fputc('\n', fh) == EOF)
+      return CMD_ERROR;
+  }
+
+  if (fflush(fh) != 0) {
+    char errbuf[1024];
+    WARNING("cmd_handle_getval: failed to write to socket #%i: %s", fileno(fh),
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+    return CMD_ERROR;
+  }
+
+  return CMD_OK;
+} /* cmd_status_t cmd_handle_getval_multi */
+
 cmd_status_t cmd_handle_getval(FILE *fh, char *buffer) {
   cmd_error_handler_t err = {cmd_error_fh, fh};
   cmd_status_t status;
@@ -111,6 +198,12 @@ cmd_status_t cmd_handle_getval(FILE *fh, char *buffer) {
     return CMD_UNKNOWN_COMMAND;
   }
 
+  if (cmd.cmd.getval.identifiers_num > 0) {
+    status = cmd_handle_getval_multi(fh, &cmd.cmd.getval);
+    cmd_destroy(&cmd);
+    return status;
+  }
+
   ds = plugin_get_ds(cmd.cmd.getval.identifier.type);
   if (ds == NULL) {
     DEBUG("cmd_handle_getval: plugin_get_ds (%s) == NULL;",
@@ -163,4 +256,11 @@ void cmd_destroy_getval(cmd_getval_t *getval) {
     return;
 
   sfree(getval->raw_identifier);
+
+  if (getval->raw_identifiers != NULL)
+    for (size_t i = 0; i < getval->identifiers_num; i++)
+      sfree(getval->raw_identifiers[i]);
+  sfree(getval->raw_identifiers);
+  sfree(getval->identifiers);
+  getval->identifiers_num = 0;
 } /* void cmd_destroy_getval */
@@ -0,0 +1,237 @@
+/**
+ * collectd - src/utils_cmd_history.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "plugin.h"
+
+#include "utils_cmd_history.h"
+#include "utils_history.h"
+
+/* Parses a time given in seconds since the epoch. Zero and negative values
+ * are relative to the current time. */
+static int cmd_history_parse_time(char const *value, cdtime_t *ret) {
+  char *endptr = NULL;
+
+  errno = 0;
+  double v = strtod(value, &endptr);
+  if ((endptr == value) || (*endptr != 0) || (errno != 0) || !isfinite(v))
+    return -1;
+
+  if (v > 0.0) {
+    *ret = DOUBLE_TO_CDTIME_T(v);
+    return 0;
+  }
+
+  cdtime_t now = cdtime();
+  cdtime_t offset = DOUBLE_TO_CDTIME_T(-v);
+  *ret = (offset < now) ? now - offset : 1;
+  return 0;
+} /* int cmd_history_parse_time */
+
+cmd_status_t cmd_parse_history(size_t argc, char **argv,
+                               cmd_history_t *ret_history,
+                               const cmd_options_t *opts,
+                               cmd_error_handler_t *err) {
+  if ((ret_history == NULL) || (opts == NULL)) {
+    errno = EINVAL;
+    cmd_error(CMD_ERROR, err, "Invalid arguments to cmd_parse_history.");
+    return CMD_ERROR;
+  }
+
+  if (argc == 0) {
+    cmd_error(CMD_PARSE_ERROR, err, "Missing identifier.");
+    return CMD_PARSE_ERROR;
+  }
+
+  /* parse_identifier() modifies its first argument,
+   * returning pointers into it */
+  ret_history->raw_identifier = sstrdup(argv[0]);
+  identifier_t *id = &ret_history->identifier;
+  if (parse_identifier(argv[0], &id->host, &id->plugin, &id->plugin_instance,
+                       &id->type, &id->type_instance,
+                       opts->identifier_default_host) != 0) {
+    cmd_error(CMD_PARSE_ERROR, err, "Cannot parse identifier `%s'.",
+              ret_history->raw_identifier);
+    cmd_destroy_history(ret_history);
+    return CMD_PARSE_ERROR;
+  }
+
+  for (size_t i = 1; i < argc; i++) {
+    char *opt_key = NULL;
+    char *opt_value = NULL;
+    int status;
+
+    status = cmd_parse_option(argv[i], &opt_key, &opt_value, err);
+    if (status != 0) {
+      if (status == CMD_NO_OPTION)
+        cmd_error(CMD_PARSE_ERROR, err, "Invalid option string `%s'.", argv[i]);
+      cmd_destroy_history(ret_history);
+      return CMD_PARSE_ERROR;
+    }
+
+    if (strcasecmp("start", opt_key) == 0) {
+      status = cmd_history_parse_time(opt_value, &ret_history->start);
+    } else if (strcasecmp("end", opt_key) == 0) {
+      status = cmd_history_parse_time(opt_value, &ret_history->end);
+    } else if (strcasecmp("step", opt_key) == 0) {
+      char *endptr = NULL;
+
+      errno = 0;
+      double step = strtod(opt_value, &endptr);
+      if ((endptr == opt_value) || (*endptr != 0) || (errno != 0) ||
+          !isfinite(step) || (step <= 0.0))
+        status = -1;
+      else
+        ret_history->step = DOUBLE_TO_CDTIME_T(step);
+    } else if (strcasecmp("aggregate", opt_key) == 0) {
+      if (strcasecmp("average", opt_value) == 0)
+        ret_history->aggregation = UH_AVERAGE;
+      else if (strcasecmp("minimum", opt_value) == 0)
+        ret_history->aggregation = UH_MINIMUM;
+      else if (strcasecmp("maximum", opt_value) == 0)
+        ret_history->aggregation = UH_MAXIMUM;
+      else
+        status = -1;
+    } else {
+      cmd_error(CMD_PARSE_ERROR, err, "Cannot parse option `%s'.", opt_key);
+      cmd_destroy_history(ret_history);
+      return CMD_PARSE_ERROR;
+    }
+
+    if (status != 0) {
+      cmd_error(CMD_PARSE_ERROR, err, "Invalid value for option `%s': %s",
+                opt_key, opt_value);
+      cmd_destroy_history(ret_history);
+      return CMD_PARSE_ERROR;
+    }
+  }
+
+  if ((ret_history->start != 0) && (ret_history->end != 0) &&
+      (ret_history->start > ret_history->end)) {
+    cmd_error(CMD_PARSE_ERROR, err, "The start time is after the end time.");
+    cmd_destroy_history(ret_history);
+    return CMD_PARSE_ERROR;
+  }
+
+  return CMD_OK;
+} /* cmd_status_t cmd_parse_history */
+
+/* cmd_handle_history answers with one line per point:
+ *
+ *   <time> <ds0>=<value> [<ds1>=<value> ...]
+ *
+ * The response is flushed once at the end. */
+cmd_status_t cmd_handle_history(FILE *fh, char *buffer) {
+  cmd_error_handler_t err = {cmd_error_fh, fh};
+  cmd_status_t status;
+  cmd_t cmd;
+
+  if ((fh == NULL) || (buffer == NULL))
+    return -1;
+
+  DEBUG("utils_cmd_history: cmd_handle_history (fh = %p, buffer = %s);",
+        (void *)fh, buffer);
+
+  if ((status = cmd_parse(buffer, &cmd, NULL, &err)) != CMD_OK)
+    return status;
+  if (cmd.type != CMD_HISTORY) {
+    cmd_error(CMD_UNKNOWN_COMMAND, &err, "Unexpected command: `%s'.",
+              CMD_TO_STRING(cmd.type));
+    cmd_destroy(&cmd);
+    return CMD_UNKNOWN_COMMAND;
+  }
+
+  cmd_history_t *history = &cmd.cmd.history;
+  if (!uh_enabled()) {
+    cmd_error(CMD_ERROR, &err, "The history store is disabled.");
+    cmd_destroy(&cmd);
+    return CMD_ERROR;
+  }
+
+  const data_set_t *ds = plugin_get_ds(history->identifier.type);
+  if (ds == NULL) {
+    cmd_error(CMD_ERROR, &err, "Type `%s' is unknown.",
+              history->identifier.type);
+    cmd_destroy(&cmd);
+    return CMD_ERROR;
+  }
+
+  cdtime_t *times = NULL;
+  gauge_t *values = NULL;
+  size_t points_num = 0;
+  size_t values_num = 0;
+  if ((uh_query(history->raw_identifier, history->start, history->end,
+                history->step, history->aggregation, &times, &values,
+                &points_num, &values_num) != 0) ||
+      (values_num != ds->ds_num)) {
+    sfree(times);
+    sfree(values);
+    cmd_error(CMD_ERROR, &err, "No such value.");
+    cmd_destroy(&cmd);
+    return CMD_ERROR;
+  }
+  cmd_destroy(&cmd);
+
+  status = CMD_OK;
+  if (fprintf(fh, "%zu Point%s found\n", points_num,
+              (points_num == 1) ? "" : "s") < 0)
+    status = CMD_ERROR;
+  for (size_t i = 0; (status == CMD_OK) && (i < points_num); i++) {
+    if (fprintf(fh, "%.3f", CDTIME_T_TO_DOUBLE(times[i])) < 0)
+      status = CMD_ERROR;
+
+    for (size_t j = 0; (status == CMD_OK) && (j < values_num); j++) {
+      gauge_t v = values[i * values_num + j];
+      int ret;
+      if (isnan(v))
+        ret = fprintf(fh, " %s=NaN", ds->ds[j].name);
+      else
+        ret = fprintf(fh, " %s=%12e", ds->ds[j].name, v);
+      if (ret < 0)
+        status = CMD_ERROR;
+    }
+
+    if ((status == CMD_OK) && (fputc('\n', fh) == EOF))
+      status = CMD_ERROR;
+  }
+  sfree(times);
+  sfree(values);
+
+  if ((status != CMD_OK) || (fflush(fh) != 0)) {
+    char errbuf[1024];
+    WARNING("cmd_handle_history: failed to write to socket #%i: %s",
+            fileno(fh), sstrerror(errno, errbuf, sizeof(errbuf)));
+    return CMD_ERROR;
+  }
+
+  return CMD_OK;
+} /* cmd_status_t cmd_handle_history */
+
+void cmd_destroy_history(cmd_history_t *history) {
+  if (history == NULL)
+    return;
+
+  sfree(history->raw_identifier);
+} /* void cmd_destroy_history */
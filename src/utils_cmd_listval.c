@@ -33,51 +33,178 @@
 #include "utils_cmd_listval.h"
 #include "utils_parse_option.h"
 
+#include <fnmatch.h>
+
+#ifndef LISTVAL_CHUNK_SIZE
+#define LISTVAL_CHUNK_SIZE 1024
+#endif
+
 cmd_status_t cmd_parse_listval(size_t argc, char **argv,
-                               cmd_listval_t *ret_listval
-                               __attribute__((unused)),
+                               cmd_listval_t *ret_listval,
                                const cmd_options_t *opts
                                __attribute__((unused)),
                                cmd_error_handler_t *err) {
-  if (argc != 0) {
-    cmd_error(CMD_PARSE_ERROR, err, "Garbage after end of command: `%s'.",
-              argv[0]);
-    return CMD_PARSE_ERROR;
+  for (size_t i = 0; i < argc; i++) {
+    char *opt_key = NULL;
+    char *opt_value = NULL;
+
+    int status = cmd_parse_option(argv[i], &opt_key, &opt_value, err);
+    if (status != CMD_OK) {
+      if (status == CMD_NO_OPTION)
+        cmd_error(CMD_PARSE_ERROR, err, "Garbage after end of command: `%s'.",
+                  argv[i]);
+      cmd_destroy_listval(ret_listval);
+      return CMD_PARSE_ERROR;
+    }
+
+    if (strcasecmp("prefix", opt_key) == 0) {
+      sfree(ret_listval->prefix);
+      ret_listval->prefix = sstrdup(opt_value);
+    } else if (strcasecmp("glob", opt_key) == 0) {
+      sfree(ret_listval->glob);
+      ret_listval->glob = sstrdup(opt_value);
+    } else if (strcasecmp("stream", opt_key) == 0) {
+      ret_listval->stream = IS_TRUE(opt_value);
+    } else {
+      cmd_error(CMD_PARSE_ERROR, err, "Cannot parse option `%s'.", opt_key);
+      cmd_destroy_listval(ret_listval);
+      return CMD_PARSE_ERROR;
+    }
   }
 
   return CMD_OK;
 } /* cmd_status_t cmd_parse_listval */
 
-#define free_everything_and_return(status)                                     \
-  do {                                                                         \
-    for (size_t j = 0; j < number; j++) {                                      \
-      sfree(names[j]);                                                         \
-      names[j] = NULL;                                                         \
-    }                                                                          \
-    sfree(names);                                                              \
-    sfree(times);                                                              \
-    return status;                                                             \
-  } while (0)
-
-#define print_to_socket(fh, ...)                                               \
-  do {                                                                         \
-    if (fprintf(fh, __VA_ARGS__) < 0) {                                        \
-      char errbuf[1024];                                                       \
-      WARNING("handle_listval: failed to write to socket #%i: %s", fileno(fh), \
-              sstrerror(errno, errbuf, sizeof(errbuf)));                       \
-      free_everything_and_return(CMD_ERROR);                                   \
-    }                                                                          \
-    fflush(fh);                                                                \
-  } while (0)
+/* listval_prefix returns the prefix used to look up names in the cache. That
+ * is the "prefix" option or the literal beginning of the "glob" pattern,
+ * whichever is longer. If both are given, the shorter one is not implied by
+ * the longer one, so listval_collect checks names against "prefix" as well. */
+static char *listval_prefix(cmd_listval_t const *lv) {
+  size_t glob_len = 0;
+
+  if (lv->glob != NULL)
+    glob_len = strcspn(lv->glob, "*?[\\");
+
+  if ((lv->prefix != NULL) && (strlen(lv->prefix) >= glob_len))
+    return sstrdup(lv->prefix);
+  if (glob_len == 0)
+    return NULL;
+
+  char *prefix = malloc(glob_len + 1);
+  if (prefix == NULL)
+    return NULL;
+  sstrncpy(prefix, lv->glob, glob_len + 1);
+  return prefix;
+}
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t size;
+  size_t lines;
+} listval_buffer_t;
+
+/* listval_collect walks the cache in chunks, holding the cache lock only for
+ * one chunk at a time. It formats matching names into "buffer" and calls
+ * "flush" whenever a chunk has been processed. */
+static cmd_status_t
+listval_collect(cmd_listval_t const *lv, listval_buffer_t *buffer,
+                int (*flush)(listval_buffer_t *, void *), void *user_data,
+                cmd_error_handler_t *err) {
+  char after[6 * DATA_MAX_NAME_LEN] = "";
+  char *prefix = listval_prefix(lv);
+  size_t prefix_len = (lv->prefix != NULL) ? strlen(lv->prefix) : 0;
+
+  do {
+    char **names = NULL;
+    cdtime_t *times = NULL;
+    size_t number = 0;
+
+    int status = uc_get_names_chunk(after, sizeof(after), prefix,
+                                    LISTVAL_CHUNK_SIZE, &names, &times,
+                                    &number);
+    if (status != 0) {
+      DEBUG("command listval: uc_get_names_chunk failed with status %i",
+            status);
+      cmd_error(CMD_ERROR, err, "uc_get_names failed.");
+      sfree(prefix);
+      return CMD_ERROR;
+    }
+
+    for (size_t i = 0; i < number; i++) {
+      if ((status == 0) &&
+          ((lv->prefix == NULL) ||
+           (strncmp(names[i], lv->prefix, prefix_len) == 0)) &&
+          ((lv->glob == NULL) || (fnmatch(lv->glob, names[i], 0) == 0))) {
+        size_t need = strlen(names[i]) + 32;
+        if ((buffer->size - buffer->len) < need) {
+          size_t size = 2 * buffer->size + need;
+          char *tmp = realloc(buffer->data, size);
+          if (tmp == NULL) {
+            status = ENOMEM;
+          } else {
+            buffer->data = tmp;
+            buffer->size = size;
+          }
+        }
+        if (status == 0) {
+          buffer->len += (size_t)snprintf(
+              buffer->data + buffer->len, buffer->size - buffer->len,
+              "%.3f %s\n", CDTIME_T_TO_DOUBLE(times[i]), names[i]);
+          buffer->lines++;
+        }
+      }
+      sfree(names[i]);
+    }
+    sfree(names);
+    sfree(times);
+
+    if (status != 0) {
+      cmd_error(CMD_ERROR, err, "realloc failed.");
+      sfree(prefix);
+      return CMD_ERROR;
+    }
+
+    if ((flush != NULL) && (flush(buffer, user_data) != 0)) {
+      sfree(prefix);
+      return CMD_ERROR;
+    }
+  } while (after[0] != 0);
+
+  sfree(prefix);
+  return CMD_OK;
+} /* cmd_status_t listval_collect */
+
+static int listval_write(FILE *fh, listval_buffer_t *buffer) {
+  if ((fprintf(fh, "%zu Value%s found\n", buffer->lines,
+               (buffer->lines == 1) ? "" : "s") < 0) ||
+      ((buffer->len > 0) && (fwrite(buffer->data, buffer->len, 1, fh) != 1)) ||
+      (fflush(fh) != 0)) {
+    char errbuf[1024];
+    WARNING("handle_listval: failed to write to socket #%i: %s", fileno(fh),
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+
+  buffer->len = 0;
+  buffer->lines = 0;
+  return 0;
+} /* int listval_write */
+
+/* In streaming mode, every chunk is sent as a block that looks like a regular
+ * LISTVAL response. An empty block terminates the stream. */
+static int listval_stream_cb(listval_buffer_t *buffer, void *user_data) {
+  if (buffer->lines == 0)
+    return 0;
+  return listval_write(user_data, buffer);
+} /* int listval_stream_cb */
 
 cmd_status_t cmd_handle_listval(FILE *fh, char *buffer) {
   cmd_error_handler_t err = {cmd_error_fh, fh};
   cmd_status_t status;
   cmd_t cmd;
 
-  char **names = NULL;
-  cdtime_t *times = NULL;
-  size_t number = 0;
+  listval_buffer_t out = {NULL, 0, 0, 0};
 
   DEBUG("utils_cmd_listval: handle_listval (fh = %p, buffer = %s);", (void *)fh,
         buffer);
@@ -87,24 +214,30 @@ cmd_status_t cmd_handle_listval(FILE *fh, char *buffer) {
   if (cmd.type != CMD_LISTVAL) {
     cmd_error(CMD_UNKNOWN_COMMAND, &err, "Unexpected command: `%s'.",
               CMD_TO_STRING(cmd.type));
-    free_everything_and_return(CMD_UNKNOWN_COMMAND);
+    cmd_destroy(&cmd);
+    return CMD_UNKNOWN_COMMAND;
   }
 
-  status = uc_get_names(&names, &times, &number);
-  if (status != 0) {
-    DEBUG("command listval: uc_get_names failed with status %i", status);
-    cmd_error(CMD_ERROR, &err, "uc_get_names failed.");
-    free_everything_and_return(CMD_ERROR);
-  }
+  cmd_listval_t *lv = &cmd.cmd.listval;
+  if (lv->stream)
+    status = listval_collect(lv, &out, listval_stream_cb, fh, &err);
+  else
+    status = listval_collect(lv, &out, /* flush = */ NULL, NULL, &err);
 
-  print_to_socket(fh, "%i Value%s found\n", (int)number,
-                  (number == 1) ? "" : "s");
-  for (size_t i = 0; i < number; i++)
-    print_to_socket(fh, "%.3f %s\n", CDTIME_T_TO_DOUBLE(times[i]), names[i]);
+  /* Write the complete response or, in streaming mode, the terminating empty
+   * block. */
+  if ((status == CMD_OK) && (listval_write(fh, &out) != 0))
+    status = CMD_ERROR;
 
-  free_everything_and_return(CMD_OK);
+  sfree(out.data);
+  cmd_destroy(&cmd);
+  return status;
 } /* cmd_status_t cmd_handle_listval */
 
-void cmd_destroy_listval(cmd_listval_t *listval __attribute__((unused))) {
-  /* nothing to do */
+void cmd_destroy_listval(cmd_listval_t *listval) {
+  if (listval == NULL)
+    return;
+
+  sfree(listval->prefix);
+  sfree(listval->glob);
 } /* void cmd_destroy_listval */
@@ -0,0 +1,352 @@
+/**
+ * collectd - src/utils_cmd_putvals.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_cmd_putvals.h"
+
+/* Value lists are dispatched once this many have been parsed, or the values
+ * buffer is full. */
+#define CMD_PUTVALS_BATCH 64
+#define CMD_PUTVALS_VALUES 512
+
+struct cmd_putvals_s {
+  _Bool active;
+  _Bool header_ok;
+
+  /* Lines of the current block, value lists dispatched, lines and value
+   * lists which failed, and the first error. */
+  size_t lines;
+  size_t dispatched;
+  size_t failed;
+  char error[256];
+
+  /* The data set of the previous line; lines of the same type often follow
+   * each other. */
+  data_set_t const *ds;
+
+  /* Host, plugin, plugin instance, time and interval of all value lists are
+   * set when the block is started; only the type, type instance and values
+   * are set per line. */
+  value_list_t vl[CMD_PUTVALS_BATCH];
+  size_t vl_num;
+  value_t values[CMD_PUTVALS_VALUES];
+  size_t values_num;
+};
+
+static void cmd_putvals_fail(cmd_putvals_t *pv, size_t num, char const *format,
+                             ...) {
+  pv->failed += num;
+  if (pv->error[0] != 0)
+    return;
+
+  char msg[192];
+  va_list ap;
+  va_start(ap, format);
+  vsnprintf(msg, sizeof(msg), format, ap);
+  va_end(ap);
+
+  if (pv->lines > 0)
+    snprintf(pv->error, sizeof(pv->error), "line %zu: %s", pv->lines, msg);
+  else
+    sstrncpy(pv->error, msg, sizeof(pv->error));
+} /* void cmd_putvals_fail */
+
+/* Like parse_value(), but requires the entire string to be a valid number
+ * and does not copy it. */
+static int cmd_putvals_parse_value(char const *str, value_t *ret, int type) {
+  char *endptr = NULL;
+
+  errno = 0;
+  switch (type) {
+  case DS_TYPE_GAUGE:
+    if (strcmp("U", str) == 0) {
+      ret->gauge = NAN;
+      return 0;
+    }
+    ret->gauge = (gauge_t)strtod(str, &endptr);
+    break;
+  case DS_TYPE_COUNTER:
+    ret->counter = (counter_t)strtoull(str, &endptr, 0);
+    break;
+  case DS_TYPE_DERIVE:
+    ret->derive = (derive_t)strtoll(str, &endptr, 0);
+    break;
+  case DS_TYPE_ABSOLUTE:
+    ret->absolute = (absolute_t)strtoull(str, &endptr, 0);
+    break;
+  default:
+    return -1;
+  }
+
+  if ((endptr == str) || (*endptr != 0) || (errno != 0))
+    return -1;
+  return 0;
+} /* int cmd_putvals_parse_value */
+
+static void cmd_putvals_flush(cmd_putvals_t *pv) {
+  if (pv->vl_num == 0)
+    return;
+
+  if (plugin_dispatch_values_batch(pv->vl, pv->vl_num) == 0)
+    pv->dispatched += pv->vl_num;
+  else
+    cmd_putvals_fail(pv, pv->vl_num, "Dispatching values failed.");
+
+  pv->vl_num = 0;
+  pv->values_num = 0;
+} /* void cmd_putvals_flush */
+
+static void cmd_putvals_begin(cmd_putvals_t *pv, char *buffer) {
+  value_list_t vl = VALUE_LIST_INIT;
+  char *fields[8];
+
+  pv->active = 1;
+  pv->header_ok = 0;
+  pv->lines = 0;
+  pv->dispatched = 0;
+  pv->failed = 0;
+  pv->error[0] = 0;
+  pv->ds = NULL;
+  pv->vl_num = 0;
+  pv->values_num = 0;
+
+  int fields_num = strsplit(buffer, fields, STATIC_ARRAY_SIZE(fields));
+  if (fields_num < 2) {
+    cmd_putvals_fail(pv, 1, "Missing identifier prefix.");
+    return;
+  }
+
+  char *host = fields[1];
+  size_t len = strlen(host);
+  if ((len >= 2) && (host[0] == '"') && (host[len - 1] == '"')) {
+    host[len - 1] = 0;
+    host++;
+  }
+
+  char *plugin = strchr(host, '/');
+  if ((plugin == NULL) || (plugin == host) || (plugin[1] == 0) ||
+      (strchr(plugin + 1, '/') != NULL)) {
+    cmd_putvals_fail(pv, 1, "Invalid identifier prefix `%s'.", host);
+    return;
+  }
+  *plugin++ = 0;
+
+  char *plugin_instance = strchr(plugin, '-');
+  if (plugin_instance != NULL)
+    *plugin_instance++ = 0;
+
+  if ((strlen(host) >= sizeof(vl.host)) ||
+      (strlen(plugin) >= sizeof(vl.plugin)) ||
+      ((plugin_instance != NULL) &&
+       (strlen(plugin_instance) >= sizeof(vl.plugin_instance)))) {
+    cmd_putvals_fail(pv, 1, "Identifier prefix too long.");
+    return;
+  }
+  sstrncpy(vl.host, host, sizeof(vl.host));
+  sstrncpy(vl.plugin, plugin, sizeof(vl.plugin));
+  if (plugin_instance != NULL)
+    sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
+
+  for (int i = 2; i < fields_num; i++) {
+    char *key = NULL;
+    char *value = NULL;
+    char *endptr = NULL;
+    double tmp;
+
+    if (cmd_parse_option(fields[i], &key, &value, NULL) != CMD_OK) {
+      cmd_putvals_fail(pv, 1, "Invalid option string `%s'.", fields[i]);
+      return;
+    }
+
+    if ((strcasecmp("time", key) == 0) && (strcmp("N", value) == 0)) {
+      vl.time = cdtime();
+      continue;
+    } else if ((strcasecmp("time", key) != 0) &&
+               (strcasecmp("interval", key) != 0)) {
+      cmd_putvals_fail(pv, 1, "Cannot parse option `%s'.", key);
+      return;
+    }
+
+    errno = 0;
+    tmp = strtod(value, &endptr);
+    if ((endptr == value) || (*endptr != 0) || (errno != 0) || !(tmp > 0.0)) {
+      cmd_putvals_fail(pv, 1, "Invalid value for option `%s': %s", key,
+                       value);
+      return;
+    }
+
+    if (strcasecmp("time", key) == 0)
+      vl.time = DOUBLE_TO_CDTIME_T(tmp);
+    else
+      vl.interval = DOUBLE_TO_CDTIME_T(tmp);
+  }
+
+  /* All values of the block share the same time. */
+  if (vl.time == 0)
+    vl.time = cdtime();
+
+  for (size_t i = 0; i < CMD_PUTVALS_BATCH; i++)
+    pv->vl[i] = vl;
+  pv->header_ok = 1;
+} /* void cmd_putvals_begin */
+
+static void cmd_putvals_line(cmd_putvals_t *pv, char *line) {
+  char *type = line;
+  char *values = type + strcspn(type, " \t");
+  if (*values == 0) {
+    cmd_putvals_fail(pv, 1, "Missing values.");
+    return;
+  }
+  *values++ = 0;
+  while (isspace((int)*values))
+    values++;
+  size_t len = strlen(values);
+  while ((len > 0) && isspace((int)values[len - 1]))
+    values[--len] = 0;
+
+  char *type_instance = strchr(type, '-');
+  if (type_instance != NULL)
+    *type_instance++ = 0;
+
+  if ((strlen(type) >= DATA_MAX_NAME_LEN) ||
+      ((type_instance != NULL) &&
+       (strlen(type_instance) >= DATA_MAX_NAME_LEN))) {
+    cmd_putvals_fail(pv, 1, "Identifier too long.");
+    return;
+  }
+
+  if ((pv->ds == NULL) || (strcmp(pv->ds->type, type) != 0)) {
+    pv->ds = plugin_get_ds(type);
+    if (pv->ds == NULL) {
+      cmd_putvals_fail(pv, 1, "Type `%s' isn't defined.", type);
+      return;
+    }
+  }
+  data_set_t const *ds = pv->ds;
+  if (ds->ds_num > CMD_PUTVALS_VALUES) {
+    cmd_putvals_fail(pv, 1, "Type `%s' has too many data sources.", type);
+    return;
+  }
+
+  if ((pv->vl_num == CMD_PUTVALS_BATCH) ||
+      (pv->values_num + ds->ds_num > CMD_PUTVALS_VALUES))
+    cmd_putvals_flush(pv);
+
+  value_t *v = pv->values + pv->values_num;
+  char *ptr = values;
+  for (size_t i = 0; i < ds->ds_num; i++) {
+    char *end = strchr(ptr, ':');
+    if ((end == NULL) != (i == ds->ds_num - 1)) {
+      cmd_putvals_fail(pv, 1, "Type `%s' expects %zu value%s.", type,
+                       ds->ds_num, (ds->ds_num == 1) ? "" : "s");
+      return;
+    }
+    if (end != NULL)
+      *end = 0;
+
+    if (cmd_putvals_parse_value(ptr, v + i, ds->ds[i].type) != 0) {
+      cmd_putvals_fail(pv, 1, "Cannot parse value `%s'.", ptr);
+      return;
+    }
+
+    if (end != NULL)
+      ptr = end + 1;
+  }
+
+  value_list_t *vl = pv->vl + pv->vl_num;
+  vl->values = v;
+  vl->values_len = ds->ds_num;
+  sstrncpy(vl->type, type, sizeof(vl->type));
+  if (type_instance != NULL)
+    sstrncpy(vl->type_instance, type_instance, sizeof(vl->type_instance));
+  else
+    vl->type_instance[0] = 0;
+
+  pv->vl_num++;
+  pv->values_num += ds->ds_num;
+} /* void cmd_putvals_line */
+
+static cmd_status_t cmd_putvals_end(cmd_putvals_t *pv, FILE *fh) {
+  cmd_error_handler_t err = {cmd_error_fh, fh};
+
+  cmd_putvals_flush(pv);
+  pv->active = 0;
+
+  if (pv->failed > 0) {
+    cmd_error(CMD_ERROR, &err,
+              "%zu value%s dispatched, %zu failed; first error: %s",
+              pv->dispatched, (pv->dispatched == 1) ? "" : "s", pv->failed,
+              pv->error);
+    return CMD_ERROR;
+  }
+
+  if (fh != stdout)
+    cmd_error(CMD_OK, &err, "Success: %zu %s been dispatched.", pv->dispatched,
+              (pv->dispatched == 1) ? "value has" : "values have");
+  return CMD_OK;
+} /* cmd_status_t cmd_putvals_end */
+
+cmd_putvals_t *cmd_putvals_create(void) {
+  return calloc(1, sizeof(cmd_putvals_t));
+} /* cmd_putvals_t *cmd_putvals_create */
+
+void cmd_putvals_destroy(cmd_putvals_t *pv) { sfree(pv); }
+
+_Bool cmd_putvals_active(cmd_putvals_t const *pv) {
+  return (pv != NULL) && pv->active;
+} /* _Bool cmd_putvals_active */
+
+cmd_status_t cmd_handle_putvals(FILE *fh, cmd_putvals_t *pv, char *buffer) {
+  if ((fh == NULL) || (pv == NULL) || (buffer == NULL))
+    return CMD_ERROR;
+
+  while (isspace((int)*buffer))
+    buffer++;
+  size_t len = strlen(buffer);
+  while ((len > 0) && isspace((int)buffer[len - 1]))
+    buffer[--len] = 0;
+
+  if (!pv->active) {
+    if ((strncasecmp("PUTVALS", buffer, strlen("PUTVALS")) != 0) ||
+        ((buffer[7] != 0) && !isspace((int)buffer[7]))) {
+      cmd_error_handler_t err = {cmd_error_fh, fh};
+      cmd_error(CMD_UNKNOWN_COMMAND, &err, "Unexpected command.");
+      return CMD_UNKNOWN_COMMAND;
+    }
+
+    cmd_putvals_begin(pv, buffer);
+    return CMD_OK;
+  }
+
+  if (*buffer == 0)
+    return CMD_OK;
+  if (strcasecmp("END", buffer) == 0)
+    return cmd_putvals_end(pv, fh);
+
+  pv->lines++;
+  if (pv->header_ok)
+    cmd_putvals_line(pv, buffer);
+  return CMD_OK;
+} /* cmd_status_t cmd_handle_putvals */
@@ -0,0 +1,64 @@
+/**
+ * collectd - src/utils_cmd_putvals.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_CMD_PUTVALS_H
+#define UTILS_CMD_PUTVALS_H 1
+
+#include "plugin.h"
+#include "utils_cmds.h"
+
+#include <stdio.h>
+
+/* PUTVALS submits many values sharing host, plugin, plugin instance, time
+ * and interval in one block of lines:
+ *
+ *   PUTVALS <host>/<plugin>[-<plugin_instance>] [time=<time>] [interval=<s>]
+ *   <type>[-<type_instance>] <value>[:<value>...]
+ *   ...
+ *   END
+ *
+ * Value lines are parsed in place and the resulting value lists are
+ * dispatched in batches using plugin_dispatch_values_batch(). Invalid lines
+ * are skipped; the result of the entire block is reported once "END" has been
+ * received.
+ *
+ * A cmd_putvals_t holds the state of one input stream, e.g. one connection,
+ * and is reused for all blocks sent over it. */
+struct cmd_putvals_s;
+typedef struct cmd_putvals_s cmd_putvals_t;
+
+cmd_putvals_t *cmd_putvals_create(void);
+
+/* Frees the state. Values of a block which has not been ended yet are
+ * discarded. */
+void cmd_putvals_destroy(cmd_putvals_t *pv);
+
+/* Returns true while a block has been started and not been ended yet. All
+ * lines have to be passed to cmd_handle_putvals() during that time. */
+_Bool cmd_putvals_active(cmd_putvals_t const *pv);
+
+/* Handles the "PUTVALS" line starting a block and all subsequent lines up to
+ * and including "END". */
+cmd_status_t cmd_handle_putvals(FILE *fh, cmd_putvals_t *pv, char *buffer);
+
+#endif /* UTILS_CMD_PUTVALS_H */
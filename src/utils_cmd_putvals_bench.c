@@ -0,0 +1,94 @@
+/**
+ * collectd - src/utils_cmd_putvals_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Compares submitting BENCH_VALUES values as one PUTVAL line each against
+ * PUTVALS blocks of BENCH_BLOCK lines, both parsed and handed to the
+ * (mocked) dispatch functions the way the exec and unixsock plugins do.
+ * Build with "make bench_utils_cmd_putvals".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_cmd_putval.h"
+#include "utils_cmd_putvals.h"
+
+#include <time.h>
+
+#define BENCH_VALUES 1000000
+#define BENCH_BLOCK 1000
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+int main(void) {
+  char line[256];
+  FILE *fh = fopen("/dev/null", "w");
+  if (fh == NULL)
+    return 1;
+
+  double start = cpu_time();
+  for (size_t i = 0; i < BENCH_VALUES; i++) {
+    snprintf(line, sizeof(line),
+             "PUTVAL \"myhost.example.com/bench-0/MAGIC-%zu\" interval=10 "
+             "N:%zu",
+             i % BENCH_BLOCK, i);
+    cmd_handle_putval(fh, line);
+  }
+  double putval = cpu_time() - start;
+
+  cmd_putvals_t *pv = cmd_putvals_create();
+  if (pv == NULL)
+    return 1;
+
+  start = cpu_time();
+  for (size_t i = 0; i < BENCH_VALUES; i++) {
+    if ((i % BENCH_BLOCK) == 0) {
+      sstrncpy(line, "PUTVALS \"myhost.example.com/bench-0\" interval=10",
+               sizeof(line));
+      cmd_handle_putvals(fh, pv, line);
+    }
+
+    snprintf(line, sizeof(line), "MAGIC-%zu %zu", i % BENCH_BLOCK, i);
+    cmd_handle_putvals(fh, pv, line);
+
+    if ((i % BENCH_BLOCK) == BENCH_BLOCK - 1) {
+      sstrncpy(line, "END", sizeof(line));
+      cmd_handle_putvals(fh, pv, line);
+    }
+  }
+  double putvals = cpu_time() - start;
+
+  cmd_putvals_destroy(pv);
+  fclose(fh);
+
+  printf("PUTVAL:  %7.3f s, %9.0f values/s\n", putval,
+         BENCH_VALUES / putval);
+  printf("PUTVALS: %7.3f s, %9.0f values/s (%.1fx)\n", putvals,
+         BENCH_VALUES / putvals, putval / putvals);
+  return 0;
+}
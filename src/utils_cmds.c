@@ -30,6 +30,7 @@
 #include "daemon/common.h"
 #include "utils_cmd_flush.h"
 #include "utils_cmd_getval.h"
+#include "utils_cmd_history.h"
 #include "utils_cmd_listval.h"
 #include "utils_cmd_putval.h"
 #include "utils_parse_option.h"
@@ -204,6 +205,10 @@ cmd_status_t cmd_parsev(size_t argc, char **argv, cmd_t *ret_cmd,
     ret_cmd->type = CMD_GETVAL;
     status =
         cmd_parse_getval(argc - 1, argv + 1, &ret_cmd->cmd.getval, opts, err);
+  } else if (strcasecmp("HISTORY", command) == 0) {
+    ret_cmd->type = CMD_HISTORY;
+    status =
+        cmd_parse_history(argc - 1, argv + 1, &ret_cmd->cmd.history, opts, err);
   } else if (strcasecmp("LISTVAL", command) == 0) {
     ret_cmd->type = CMD_LISTVAL;
     status =
@@ -257,6 +262,9 @@ void cmd_destroy(cmd_t *cmd) {
   case CMD_PUTVAL:
     cmd_destroy_putval(&cmd->cmd.putval);
     break;
+  case CMD_HISTORY:
+    cmd_destroy_history(&cmd->cmd.history);
+    break;
   }
 } /* void cmd_destroy */
 
@@ -28,6 +28,7 @@
 #define UTILS_CMDS_H 1
 
 #include "plugin.h"
+#include "utils_history.h"
 
 #include <stdarg.h>
 
@@ -37,15 +38,18 @@ typedef enum {
   CMD_GETVAL = 2,
   CMD_LISTVAL = 3,
   CMD_PUTVAL = 4,
+  CMD_HISTORY = 5,
 } cmd_type_t;
 #define CMD_TO_STRING(type)                                                    \
-  ((type) == CMD_FLUSH) ? "FLUSH" : ((type) == CMD_GETVAL)                     \
-                                        ? "GETVAL"                             \
-                                        : ((type) == CMD_LISTVAL)              \
-                                              ? "LISTVAL"                      \
-                                              : ((type) == CMD_PUTVAL)         \
-                                                    ? "PUTVAL"                 \
-                                                    : "UNKNOWN"
+  ((type) == CMD_FLUSH)                                                        \
+      ? "FLUSH"                                                                \
+      : ((type) == CMD_GETVAL)                                                 \
+            ? "GETVAL"                                                         \
+            : ((type) == CMD_LISTVAL)                                          \
+                  ? "LISTVAL"                                                  \
+                  : ((type) == CMD_PUTVAL)                                     \
+                        ? "PUTVAL"                                             \
+                        : ((type) == CMD_HISTORY) ? "HISTORY" : "UNKNOWN"
 
 typedef struct {
   double timeout;
@@ -59,9 +63,22 @@ typedef struct {
 typedef struct {
   char *raw_identifier;
   identifier_t identifier;
+
+  /* All identifiers, including the first one above, if more than one
+   * identifier was given. */
+  char **raw_identifiers;
+  identifier_t *identifiers;
+  size_t identifiers_num;
 } cmd_getval_t;
 
 typedef struct {
+  /* Only list identifiers starting with "prefix" and / or matching the
+   * shell wildcard pattern "glob". */
+  char *prefix;
+  char *glob;
+
+  /* Send the list in blocks instead of a single response. */
+  _Bool stream;
 } cmd_listval_t;
 
 typedef struct {
@@ -74,6 +91,19 @@ typedef struct {
   size_t vl_num;
 } cmd_putval_t;
 
+typedef struct {
+  char *raw_identifier;
+  identifier_t identifier;
+
+  /* Absolute times; zero if not given, i.e. the range is not limited. */
+  cdtime_t start;
+  cdtime_t end;
+
+  /* Aggregate points into intervals of this length, if non-zero. */
+  cdtime_t step;
+  uh_aggregation_t aggregation;
+} cmd_history_t;
+
 /*
  * NAME
  *   cmd_t
@@ -88,6 +118,7 @@ typedef struct {
     cmd_getval_t getval;
     cmd_listval_t listval;
     cmd_putval_t putval;
+    cmd_history_t history;
   } cmd;
 } cmd_t;
 
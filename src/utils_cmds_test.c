@@ -24,9 +24,12 @@
  *   Sebastian 'tokkee' Harl <sh at tokkee.org>
  **/
 
-#include "common.h"
+/* testing.h must come first to declare mock_dispatched in plugin.h. */
 #include "testing.h"
+
+#include "common.h"
 #include "utils_cmds.h"
+#include "utils_cmd_putvals.h"
 
 static void error_cb(void *ud, cmd_status_t status, const char *format,
                      va_list ap) {
@@ -91,6 +94,10 @@ static struct {
     {
         "GETVAL magic/MAGIC", &default_host_opts, CMD_OK, CMD_GETVAL,
     },
+    {
+        "GETVAL myhost/magic/MAGIC myhost/cpu-0/cpu-idle", NULL, CMD_OK,
+        CMD_GETVAL,
+    },
 
     /* Invalid GETVAL commands. */
     {
@@ -102,16 +109,26 @@ static struct {
     {
         "GETVAL invalid", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
     },
+    {
+        "GETVAL myhost/magic/MAGIC invalid", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
+    },
 
     /* Valid LISTVAL commands. */
     {
         "LISTVAL", NULL, CMD_OK, CMD_LISTVAL,
     },
+    {
+        "LISTVAL prefix=myhost/cpu glob=*/cpu-idle stream=true", NULL, CMD_OK,
+        CMD_LISTVAL,
+    },
 
     /* Invalid LISTVAL commands. */
     {
         "LISTVAL invalid", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
     },
+    {
+        "LISTVAL invalid=option", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
+    },
 
     /* Valid PUTVAL commands. */
     {
@@ -171,6 +188,44 @@ static struct {
     },
     */
 
+    /* Valid HISTORY commands. */
+    {
+        "HISTORY myhost/magic/MAGIC", NULL, CMD_OK, CMD_HISTORY,
+    },
+    {
+        "HISTORY magic/MAGIC start=-3600", &default_host_opts, CMD_OK,
+        CMD_HISTORY,
+    },
+    {
+        "HISTORY myhost/magic/MAGIC start=1500000000 end=1500003600 step=60 "
+        "aggregate=maximum",
+        NULL, CMD_OK, CMD_HISTORY,
+    },
+
+    /* Invalid HISTORY commands. */
+    {
+        "HISTORY", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
+    },
+    {
+        "HISTORY invalid", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
+    },
+    {
+        "HISTORY myhost/magic/MAGIC step=0", NULL, CMD_PARSE_ERROR, CMD_UNKNOWN,
+    },
+    {
+        "HISTORY myhost/magic/MAGIC aggregate=median", NULL, CMD_PARSE_ERROR,
+        CMD_UNKNOWN,
+    },
+    {
+        /* Start after end. */
+        "HISTORY myhost/magic/MAGIC start=1500003600 end=1500000000", NULL,
+        CMD_PARSE_ERROR, CMD_UNKNOWN,
+    },
+    {
+        "HISTORY myhost/magic/MAGIC invalid=option", NULL, CMD_PARSE_ERROR,
+        CMD_UNKNOWN,
+    },
+
     /* Invalid commands. */
     {
         "INVALID", NULL, CMD_UNKNOWN_COMMAND, CMD_UNKNOWN,
@@ -218,7 +273,112 @@ DEF_TEST(parse) {
   return test_result;
 }
 
+/* Feeds the lines to a PUTVALS parser and returns the last response. */
+static char *putvals(cmd_putvals_t *pv, char const **lines, size_t lines_num,
+                     char *ret, size_t ret_size) {
+  FILE *fh = tmpfile();
+  if (fh == NULL)
+    return NULL;
+
+  for (size_t i = 0; i < lines_num; i++) {
+    char buffer[1024];
+    sstrncpy(buffer, lines[i], sizeof(buffer));
+    cmd_handle_putvals(fh, pv, buffer);
+  }
+
+  ret[0] = 0;
+  rewind(fh);
+  while (fgets(ret, (int)ret_size, fh) != NULL)
+    ;
+  fclose(fh);
+
+  size_t len = strlen(ret);
+  if ((len > 0) && (ret[len - 1] == '\n'))
+    ret[len - 1] = 0;
+  return ret;
+}
+
+DEF_TEST(putvals) {
+  cmd_putvals_t *pv;
+  char response[1024];
+
+  CHECK_NOT_NULL(pv = cmd_putvals_create());
+
+  char const *mixed[] = {
+      "PUTVALS myhost/magic-inst time=1500000000 interval=10",
+      "MAGIC-a 1",
+      "MAGIC 0x10",
+      "MAGIC-b x",
+      "UNKNOWN 3",
+      "MAGIC 1:2",
+      "END",
+  };
+  mock_dispatched_reset();
+  putvals(pv, mixed, STATIC_ARRAY_SIZE(mixed), response, sizeof(response));
+  EXPECT_EQ_STR("-1 2 values dispatched, 3 failed; first error: "
+                "line 3: Cannot parse value `x'.",
+                response);
+  OK(!cmd_putvals_active(pv));
+
+  EXPECT_EQ_INT(2, (int)mock_dispatched_num);
+  for (size_t i = 0; i < mock_dispatched_num; i++) {
+    value_list_t *vl = mock_dispatched + i;
+    EXPECT_EQ_STR("myhost", vl->host);
+    EXPECT_EQ_STR("magic", vl->plugin);
+    EXPECT_EQ_STR("inst", vl->plugin_instance);
+    EXPECT_EQ_STR("MAGIC", vl->type);
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(1500000000), vl->time);
+    EXPECT_EQ_UINT64(TIME_T_TO_CDTIME_T(10), vl->interval);
+    EXPECT_EQ_INT(1, (int)vl->values_len);
+  }
+  EXPECT_EQ_STR("a", mock_dispatched[0].type_instance);
+  EXPECT_EQ_INT(1, (int)mock_dispatched[0].values[0].derive);
+  EXPECT_EQ_STR("", mock_dispatched[1].type_instance);
+  EXPECT_EQ_INT(16, (int)mock_dispatched[1].values[0].derive);
+
+  /* More lines than fit into one batch. */
+  char const *many[102];
+  many[0] = "PUTVALS \"myhost/magic\"";
+  for (size_t i = 1; i < 101; i++)
+    many[i] = "MAGIC-instance 42";
+  many[101] = "END";
+  mock_dispatched_reset();
+  putvals(pv, many, STATIC_ARRAY_SIZE(many), response, sizeof(response));
+  EXPECT_EQ_STR("0 Success: 100 values have been dispatched.", response);
+  EXPECT_EQ_INT(100, (int)mock_dispatched_num);
+  for (size_t i = 0; i < mock_dispatched_num; i++) {
+    value_list_t *vl = mock_dispatched + i;
+    EXPECT_EQ_STR("myhost", vl->host);
+    EXPECT_EQ_STR("magic", vl->plugin);
+    EXPECT_EQ_STR("", vl->plugin_instance);
+    EXPECT_EQ_STR("instance", vl->type_instance);
+    EXPECT_EQ_INT(42, (int)vl->values[0].derive);
+  }
+
+  /* Lines of a block with an invalid header are ignored. */
+  char const *invalid[] = {
+      "PUTVALS invalid", "MAGIC 1", "END",
+  };
+  mock_dispatched_reset();
+  putvals(pv, invalid, STATIC_ARRAY_SIZE(invalid), response, sizeof(response));
+  EXPECT_EQ_STR("-1 0 values dispatched, 1 failed; first error: "
+                "Invalid identifier prefix `invalid'.",
+                response);
+  EXPECT_EQ_INT(0, (int)mock_dispatched_num);
+
+  char const *unterminated[] = {"PUTVALS myhost/magic", "MAGIC 1"};
+  putvals(pv, unterminated, STATIC_ARRAY_SIZE(unterminated), response,
+          sizeof(response));
+  OK(cmd_putvals_active(pv));
+  EXPECT_EQ_INT(0, (int)mock_dispatched_num);
+
+  cmd_putvals_destroy(pv);
+  mock_dispatched_reset();
+  return 0;
+}
+
 int main(int argc, char **argv) {
   RUN_TEST(parse);
+  RUN_TEST(putvals);
   END_TEST;
 }
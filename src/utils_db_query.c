@@ -72,6 +72,9 @@ struct udb_result_preparation_area_s /* {{{ */
   char **metadata_buffer;
   char *plugin_instance;
 
+  /* Value list with all fields that don't depend on the row. */
+  value_list_t vl;
+
   struct udb_result_preparation_area_s *next;
 }; /* }}} */
 typedef struct udb_result_preparation_area_s udb_result_preparation_area_t;
@@ -86,9 +89,25 @@ struct udb_query_preparation_area_s /* {{{ */
 
   cdtime_t interval;
 
+  /* The column mapping is kept across reads and reused as long as the query
+   * returns the same columns. "prepared" is set while the mapping is valid,
+   * "active" between udb_query_prepare_result and udb_query_finish_result. */
+  char **column_names;
+  _Bool prepared;
+  _Bool active;
+
+  /* Value lists are collected here and dispatched in batches. */
+  value_list_t *batch_vl;
+  size_t batch_vl_num;
+  value_t *batch_values;
+  size_t batch_values_num;
+  size_t batch_values_max;
+
   udb_result_preparation_area_t *result_prep_areas;
 }; /* }}} */
 
+#define UDB_BATCH_SIZE 64
+
 /*
  * Config Private functions
  */
@@ -181,116 +200,115 @@ static int udb_config_set_uint(unsigned int *ret_value, /* {{{ */
 /*
  * Result private functions
  */
+static void udb_query_flush(udb_query_preparation_area_t *q_area) /* {{{ */
+{
+  if (q_area->batch_vl_num == 0)
+    return;
+
+  plugin_dispatch_values_batch(q_area->batch_vl, q_area->batch_vl_num);
+
+  for (size_t i = 0; i < q_area->batch_vl_num; i++) {
+    meta_data_destroy(q_area->batch_vl[i].meta);
+    q_area->batch_vl[i].meta = NULL;
+  }
+  q_area->batch_vl_num = 0;
+  q_area->batch_values_num = 0;
+} /* }}} void udb_query_flush */
+
+/* Appends "str" to the buffer, truncating it if necessary. */
+static void udb_append(char **ptr, size_t *avail, char const *str) /* {{{ */
+{
+  size_t len = strlen(str);
+
+  if (len > *avail)
+    len = *avail;
+
+  memcpy(*ptr, str, len);
+  *ptr += len;
+  *avail -= len;
+} /* }}} void udb_append */
+
+static void udb_result_format_type_instance(
+    udb_result_t const *r, /* {{{ */
+    udb_result_preparation_area_t const *r_area, char *buffer,
+    size_t buffer_size) {
+  char *ptr = buffer;
+  size_t avail = buffer_size - 1;
+
+  if (r->instance_prefix != NULL)
+    udb_append(&ptr, &avail, r->instance_prefix);
+
+  for (size_t i = 0; i < r->instances_num; i++) {
+    if ((i > 0) || (r->instance_prefix != NULL))
+      udb_append(&ptr, &avail, "-");
+    udb_append(&ptr, &avail, r_area->instances_buffer[i]);
+  }
+
+  *ptr = 0;
+} /* }}} void udb_result_format_type_instance */
+
 static int udb_result_submit(udb_result_t *r, /* {{{ */
                              udb_result_preparation_area_t *r_area,
                              udb_query_t const *q,
                              udb_query_preparation_area_t *q_area) {
-  value_list_t vl = VALUE_LIST_INIT;
+  value_list_t *vl;
 
   assert(r != NULL);
   assert(r_area->ds != NULL);
   assert(((size_t)r_area->ds->ds_num) == r->values_num);
   assert(r->values_num > 0);
+  assert(r->values_num <= q_area->batch_values_max);
 
-  vl.values = calloc(r->values_num, sizeof(*vl.values));
-  if (vl.values == NULL) {
-    ERROR("db query utils: calloc failed.");
-    return -1;
-  }
-  vl.values_len = r_area->ds->ds_num;
+  if (q_area->batch_vl_num >= UDB_BATCH_SIZE)
+    udb_query_flush(q_area);
+
+  /* Start from the prepared template. The plugin instance (unless it is read
+   * from a column) and the type are already set. */
+  vl = q_area->batch_vl + q_area->batch_vl_num;
+  memcpy(vl, &r_area->vl, sizeof(*vl));
+  vl->values = q_area->batch_values + q_area->batch_values_num;
 
   for (size_t i = 0; i < r->values_num; i++) {
     char *value_str = r_area->values_buffer[i];
 
-    if (0 != parse_value(value_str, &vl.values[i], r_area->ds->ds[i].type)) {
+    if (0 != parse_value(value_str, &vl->values[i], r_area->ds->ds[i].type)) {
       ERROR("db query utils: udb_result_submit: Parsing `%s' as %s failed.",
             value_str, DS_TYPE_TO_STRING(r_area->ds->ds[i].type));
       errno = EINVAL;
-      free(vl.values);
       return -1;
     }
   }
 
-  if (q_area->interval > 0)
-    vl.interval = q_area->interval;
-
-  sstrncpy(vl.host, q_area->host, sizeof(vl.host));
-  sstrncpy(vl.plugin, q_area->plugin, sizeof(vl.plugin));
-  sstrncpy(vl.type, r->type, sizeof(vl.type));
+  if (q->plugin_instance_from != NULL)
+    sstrncpy(vl->plugin_instance, r_area->plugin_instance,
+             sizeof(vl->plugin_instance));
 
-  /* Set vl.plugin_instance */
-  if (q->plugin_instance_from != NULL) {
-    sstrncpy(vl.plugin_instance, r_area->plugin_instance,
-             sizeof(vl.plugin_instance));
-  } else {
-    sstrncpy(vl.plugin_instance, q_area->db_name, sizeof(vl.plugin_instance));
-  }
-
-  /* Set vl.type_instance {{{ */
-  if (r->instances_num == 0) {
-    if (r->instance_prefix == NULL)
-      vl.type_instance[0] = 0;
-    else
-      sstrncpy(vl.type_instance, r->instance_prefix, sizeof(vl.type_instance));
-  } else /* if ((r->instances_num > 0) */
-  {
-    if (r->instance_prefix == NULL) {
-      int status = strjoin(vl.type_instance, sizeof(vl.type_instance),
-                           r_area->instances_buffer, r->instances_num, "-");
-      if (status < 0) {
-        ERROR(
-            "udb_result_submit: creating type_instance failed with status %d.",
-            status);
-        return status;
-      }
-    } else {
-      char tmp[DATA_MAX_NAME_LEN];
-
-      int status = strjoin(tmp, sizeof(tmp), r_area->instances_buffer,
-                           r->instances_num, "-");
-      if (status < 0) {
-        ERROR(
-            "udb_result_submit: creating type_instance failed with status %d.",
-            status);
-        return status;
-      }
-      tmp[sizeof(tmp) - 1] = 0;
-
-      ssnprintf(vl.type_instance, sizeof(vl.type_instance), "%s-%s",
-               r->instance_prefix, tmp);
-    }
-  }
-  vl.type_instance[sizeof(vl.type_instance) - 1] = 0;
-  /* }}} */
+  udb_result_format_type_instance(r, r_area, vl->type_instance,
+                                  sizeof(vl->type_instance));
 
   /* Annotate meta data. {{{ */
   if (r->metadata_num > 0) {
-    vl.meta = meta_data_create();
-    if (vl.meta == NULL) {
+    vl->meta = meta_data_create();
+    if (vl->meta == NULL) {
       ERROR("db query utils:: meta_data_create failed.");
       return -ENOMEM;
     }
 
     for (size_t i = 0; i < r->metadata_num; i++) {
-      int status = meta_data_add_string(vl.meta, r->metadata[i],
+      int status = meta_data_add_string(vl->meta, r->metadata[i],
                                         r_area->metadata_buffer[i]);
       if (status != 0) {
         ERROR("db query utils:: meta_data_add_string failed.");
-        meta_data_destroy(vl.meta);
-        vl.meta = NULL;
+        meta_data_destroy(vl->meta);
+        vl->meta = NULL;
         return status;
       }
     }
   }
   /* }}} */
 
-  plugin_dispatch_values(&vl);
-
-  if (r->metadata_num > 0) {
-    meta_data_destroy(vl.meta);
-    vl.meta = NULL;
-  }
-  sfree(vl.values);
+  q_area->batch_vl_num++;
+  q_area->batch_values_num += r->values_num;
   return 0;
 } /* }}} void udb_result_submit */
 
@@ -845,18 +863,22 @@ int udb_query_check_version(udb_query_t *q, unsigned int version) /* {{{ */
   return 1;
 } /* }}} int udb_query_check_version */
 
-void udb_query_finish_result(udb_query_t const *q, /* {{{ */
-                             udb_query_preparation_area_t *prep_area) {
+/* Frees the column mapping of "prep_area", so that the next call to
+ * udb_query_prepare_result() builds it from scratch. */
+static void udb_query_reset_result(udb_query_t const *q, /* {{{ */
+                                   udb_query_preparation_area_t *prep_area) {
   udb_result_preparation_area_t *r_area;
   udb_result_t *r;
 
-  if ((q == NULL) || (prep_area == NULL))
-    return;
+  udb_query_flush(prep_area);
+  prep_area->prepared = 0;
+  prep_area->active = 0;
 
   prep_area->column_num = 0;
   sfree(prep_area->host);
   sfree(prep_area->plugin);
   sfree(prep_area->db_name);
+  sfree(prep_area->column_names);
 
   prep_area->interval = 0;
 
@@ -867,6 +889,61 @@ void udb_query_finish_result(udb_query_t const *q, /* {{{ */
       break;
     udb_result_finish_result(r, r_area);
   }
+} /* }}} void udb_query_reset_result */
+
+/* Returns true if the mapping in "prep_area" was built for the same columns
+ * and the same host, plugin, database and interval. */
+static _Bool udb_query_is_prepared(udb_query_preparation_area_t const *prep_area,
+                                   const char *host, const char *plugin,
+                                   const char *db_name, char **column_names,
+                                   size_t column_num, cdtime_t interval) {
+  if (!prep_area->prepared || (prep_area->column_num != column_num) ||
+      (prep_area->interval != interval) ||
+      (strcmp(prep_area->host, host) != 0) ||
+      (strcmp(prep_area->plugin, plugin) != 0) ||
+      (strcmp(prep_area->db_name, db_name) != 0))
+    return 0;
+
+  for (size_t i = 0; i < column_num; i++)
+    if (strcmp(prep_area->column_names[i], column_names[i]) != 0)
+      return 0;
+
+  return 1;
+} /* }}} _Bool udb_query_is_prepared */
+
+/* Copies the column names into a single allocation. */
+static char **udb_copy_column_names(char **column_names, /* {{{ */
+                                    size_t column_num) {
+  size_t size = column_num * sizeof(char *);
+  char **copy;
+  char *ptr;
+
+  for (size_t i = 0; i < column_num; i++)
+    size += strlen(column_names[i]) + 1;
+
+  copy = malloc(size);
+  if (copy == NULL)
+    return NULL;
+
+  ptr = (char *)(copy + column_num);
+  for (size_t i = 0; i < column_num; i++) {
+    size_t len = strlen(column_names[i]) + 1;
+
+    memcpy(ptr, column_names[i], len);
+    copy[i] = ptr;
+    ptr += len;
+  }
+
+  return copy;
+} /* }}} char **udb_copy_column_names */
+
+void udb_query_finish_result(udb_query_t const *q, /* {{{ */
+                             udb_query_preparation_area_t *prep_area) {
+  if ((q == NULL) || (prep_area == NULL))
+    return;
+
+  udb_query_flush(prep_area);
+  prep_area->active = 0;
 } /* }}} void udb_query_finish_result */
 
 int udb_query_handle_result(udb_query_t const *q, /* {{{ */
@@ -880,8 +957,7 @@ int udb_query_handle_result(udb_query_t const *q, /* {{{ */
   if ((q == NULL) || (prep_area == NULL))
     return -EINVAL;
 
-  if ((prep_area->column_num < 1) || (prep_area->host == NULL) ||
-      (prep_area->plugin == NULL) || (prep_area->db_name == NULL)) {
+  if (!prep_area->active) {
     ERROR("db query utils: Query `%s': Query is not prepared; "
           "can't handle result.",
           q->name);
@@ -923,25 +999,35 @@ int udb_query_prepare_result(udb_query_t const *q, /* {{{ */
                              size_t column_num, cdtime_t interval) {
   udb_result_preparation_area_t *r_area;
   udb_result_t *r;
+  size_t values_max;
   int status;
 
   if ((q == NULL) || (prep_area == NULL))
     return -EINVAL;
 
-  udb_query_finish_result(q, prep_area);
+  /* Reuse the mapping from the previous read if the columns didn't change. */
+  udb_query_flush(prep_area);
+  if (udb_query_is_prepared(prep_area, host, plugin, db_name, column_names,
+                            column_num, interval)) {
+    prep_area->active = 1;
+    return 0;
+  }
+
+  udb_query_reset_result(q, prep_area);
 
   prep_area->column_num = column_num;
   prep_area->host = strdup(host);
   prep_area->plugin = strdup(plugin);
   prep_area->db_name = strdup(db_name);
+  prep_area->column_names = udb_copy_column_names(column_names, column_num);
 
   prep_area->interval = interval;
 
   if ((prep_area->host == NULL) || (prep_area->plugin == NULL) ||
-      (prep_area->db_name == NULL)) {
+      (prep_area->db_name == NULL) || (prep_area->column_names == NULL)) {
     ERROR("db query utils: Query `%s': Prepare failed: Out of memory.",
           q->name);
-    udb_query_finish_result(q, prep_area);
+    udb_query_reset_result(q, prep_area);
     return -ENOMEM;
   }
 
@@ -970,29 +1056,69 @@ int udb_query_prepare_result(udb_query_t const *q, /* {{{ */
       ERROR("db query utils: udb_query_prepare_result: "
             "Column `%s' from `PluginInstanceFrom' could not be found.",
             q->plugin_instance_from);
-      udb_query_finish_result(q, prep_area);
+      udb_query_reset_result(q, prep_area);
       return -ENOENT;
     }
   }
   /* }}} */
 
+  values_max = 0;
   for (r = q->results, r_area = prep_area->result_prep_areas; r != NULL;
        r = r->next, r_area = r_area->next) {
     if (!r_area) {
       ERROR("db query utils: Query `%s': Invalid number of result "
             "preparation areas.",
             q->name);
-      udb_query_finish_result(q, prep_area);
+      udb_query_reset_result(q, prep_area);
       return -EINVAL;
     }
 
     status = udb_result_prepare_result(r, r_area, column_names, column_num);
     if (status != 0) {
-      udb_query_finish_result(q, prep_area);
+      udb_query_reset_result(q, prep_area);
       return status;
     }
+
+    /* Fill in everything that is the same for all rows. */
+    r_area->vl = (value_list_t)VALUE_LIST_INIT;
+    r_area->vl.values_len = r->values_num;
+    if (interval > 0)
+      r_area->vl.interval = interval;
+    sstrncpy(r_area->vl.host, host, sizeof(r_area->vl.host));
+    sstrncpy(r_area->vl.plugin, plugin, sizeof(r_area->vl.plugin));
+    sstrncpy(r_area->vl.plugin_instance, db_name,
+             sizeof(r_area->vl.plugin_instance));
+    sstrncpy(r_area->vl.type, r->type, sizeof(r_area->vl.type));
+
+    if (values_max < r->values_num)
+      values_max = r->values_num;
   }
 
+  /* Allocate the batch buffers {{{ */
+  if (prep_area->batch_vl == NULL) {
+    prep_area->batch_vl = calloc(UDB_BATCH_SIZE, sizeof(*prep_area->batch_vl));
+    if (prep_area->batch_vl == NULL) {
+      ERROR("db query utils: udb_query_prepare_result: calloc failed.");
+      udb_query_reset_result(q, prep_area);
+      return -ENOMEM;
+    }
+  }
+
+  if (prep_area->batch_values_max < values_max) {
+    value_t *tmp = realloc(prep_area->batch_values,
+                           UDB_BATCH_SIZE * values_max * sizeof(*tmp));
+    if (tmp == NULL) {
+      ERROR("db query utils: udb_query_prepare_result: realloc failed.");
+      udb_query_reset_result(q, prep_area);
+      return -ENOMEM;
+    }
+    prep_area->batch_values = tmp;
+    prep_area->batch_values_max = values_max;
+  }
+  /* }}} */
+
+  prep_area->prepared = 1;
+  prep_area->active = 1;
   return 0;
 } /* }}} int udb_query_prepare_result */
 
@@ -1048,14 +1174,21 @@ void udb_query_delete_preparation_area(
 
     sfree(area->instances_pos);
     sfree(area->values_pos);
+    sfree(area->metadata_pos);
     sfree(area->instances_buffer);
     sfree(area->values_buffer);
+    sfree(area->metadata_buffer);
     free(area);
   }
 
+  udb_query_flush(q_area);
+  sfree(q_area->batch_vl);
+  sfree(q_area->batch_values);
+
   sfree(q_area->host);
   sfree(q_area->plugin);
   sfree(q_area->db_name);
+  sfree(q_area->column_names);
 
   free(q_area);
 } /* }}} void udb_query_delete_preparation_area */
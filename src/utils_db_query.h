@@ -67,6 +67,15 @@ void *udb_query_get_user_data(udb_query_t *q);
  */
 int udb_query_check_version(udb_query_t *q, unsigned int version);
 
+/*
+ * udb_query_prepare_result, udb_query_handle_result, udb_query_finish_result
+ *
+ * The column mapping computed by `udb_query_prepare_result' is kept in the
+ * preparation area and reused by later calls with the same columns.
+ * `udb_query_handle_result' collects the resulting value lists, which are
+ * dispatched in batches and, at the latest, by `udb_query_finish_result'.
+ * A preparation area must not be used by more than one thread at a time.
+ */
 int udb_query_prepare_result(udb_query_t const *q,
                              udb_query_preparation_area_t *prep_area,
                              const char *host, const char *plugin,
@@ -0,0 +1,143 @@
+/**
+ * collectd - src/utils_db_query_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "testing.h"
+#include "utils_db_query.h"
+
+#define STRING_VALUE(s)                                                        \
+  { .value.string = (s), .type = OCONFIG_TYPE_STRING }
+
+/* <Query "test">
+ *   Statement "SELECT name, value FROM test"
+ *   <Result>
+ *     Type "MAGIC"
+ *     InstancePrefix "prefix"
+ *     InstancesFrom "name"
+ *     ValuesFrom "value"
+ *   </Result>
+ * </Query> */
+static oconfig_value_t query_name = STRING_VALUE("test");
+static oconfig_value_t statement = STRING_VALUE("SELECT name, value FROM test");
+static oconfig_value_t type = STRING_VALUE("MAGIC");
+static oconfig_value_t prefix = STRING_VALUE("prefix");
+static oconfig_value_t instances_from = STRING_VALUE("name");
+static oconfig_value_t values_from = STRING_VALUE("value");
+
+static oconfig_item_t result_children[] = {
+    {.key = "Type", .values = &type, .values_num = 1},
+    {.key = "InstancePrefix", .values = &prefix, .values_num = 1},
+    {.key = "InstancesFrom", .values = &instances_from, .values_num = 1},
+    {.key = "ValuesFrom", .values = &values_from, .values_num = 1},
+};
+
+static oconfig_item_t query_children[] = {
+    {.key = "Statement", .values = &statement, .values_num = 1},
+    {.key = "Result",
+     .children = result_children,
+     .children_num = STATIC_ARRAY_SIZE(result_children)},
+};
+
+static oconfig_item_t query_config = {
+    .key = "Query",
+    .values = &query_name,
+    .values_num = 1,
+    .children = query_children,
+    .children_num = STATIC_ARRAY_SIZE(query_children),
+};
+
+static int prepare(udb_query_t *q, udb_query_preparation_area_t *prep_area,
+                   char const *col0, char const *col1) {
+  char *column_names[] = {(char *)col0, (char *)col1};
+
+  return udb_query_prepare_result(q, prep_area, "example.com", "test", "db",
+                                  column_names, 2, 0);
+}
+
+static int handle(udb_query_t *q, udb_query_preparation_area_t *prep_area,
+                  char const *col0, char const *col1) {
+  char *column_values[] = {(char *)col0, (char *)col1};
+
+  return udb_query_handle_result(q, prep_area, column_values);
+}
+
+DEF_TEST(prepare_handle_finish) {
+  udb_query_t **queries = NULL;
+  size_t queries_num = 0;
+
+  CHECK_ZERO(udb_query_create(&queries, &queries_num, &query_config, NULL));
+  EXPECT_EQ_INT(1, (int)queries_num);
+  udb_query_t *q = queries[0];
+
+  udb_query_preparation_area_t *prep_area;
+  CHECK_NOT_NULL(prep_area = udb_query_allocate_preparation_area(q));
+
+  /* Not prepared yet. */
+  EXPECT_EQ_INT(-EINVAL, handle(q, prep_area, "foo", "42"));
+
+  CHECK_ZERO(prepare(q, prep_area, "name", "value"));
+  EXPECT_EQ_INT(0, handle(q, prep_area, "foo", "42"));
+  EXPECT_EQ_INT(-1, handle(q, prep_area, "foo", "not a number"));
+  /* More rows than fit into one batch. */
+  for (int i = 0; i < 1000; i++)
+    EXPECT_EQ_INT(0, handle(q, prep_area, "foo", "42"));
+  udb_query_finish_result(q, prep_area);
+
+  /* Finished. */
+  EXPECT_EQ_INT(-EINVAL, handle(q, prep_area, "foo", "42"));
+
+  /* Same columns: the mapping is reused. */
+  CHECK_ZERO(prepare(q, prep_area, "name", "value"));
+  EXPECT_EQ_INT(0, handle(q, prep_area, "foo", "42"));
+  udb_query_finish_result(q, prep_area);
+
+  /* Different column order: the mapping is rebuilt. */
+  CHECK_ZERO(prepare(q, prep_area, "value", "name"));
+  EXPECT_EQ_INT(0, handle(q, prep_area, "42", "foo"));
+  udb_query_finish_result(q, prep_area);
+
+  /* Column names are matched case-insensitively. */
+  CHECK_ZERO(prepare(q, prep_area, "NAME", "VALUE"));
+  EXPECT_EQ_INT(0, handle(q, prep_area, "foo", "42"));
+  udb_query_finish_result(q, prep_area);
+
+  /* Missing column. */
+  EXPECT_EQ_INT(-ENOENT, prepare(q, prep_area, "name", "other"));
+  EXPECT_EQ_INT(-EINVAL, handle(q, prep_area, "foo", "42"));
+
+  CHECK_ZERO(prepare(q, prep_area, "name", "value"));
+  EXPECT_EQ_INT(0, handle(q, prep_area, "foo", "42"));
+  udb_query_finish_result(q, prep_area);
+
+  udb_query_delete_preparation_area(prep_area);
+  udb_query_free(queries, queries_num);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(prepare_handle_finish);
+
+  END_TEST;
+}
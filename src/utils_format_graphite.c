@@ -42,8 +42,6 @@ static int gr_format_values(char *ret, size_t ret_len, int ds_num,
 
   assert(0 == strcmp(ds->type, vl->type));
 
-  memset(ret, 0, ret_len);
-
 #define BUFFER_ADD(...)                                                        \
   do {                                                                         \
     status = snprintf(ret + offset, ret_len - offset, __VA_ARGS__);            \
@@ -172,12 +170,49 @@ static void escape_graphite_string(char *buffer, char escape_char) {
     *head = escape_char;
 }
 
-int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
-                    value_list_t const *vl, char const *prefix,
-                    char const *postfix, char const escape_char,
-                    unsigned int flags) {
+/* gr_format_key writes the escaped metric name of data source "ds_index" to
+ * "key" and returns its length. */
+static int gr_format_key(char *key, size_t key_size, name_cache_t *cache,
+                         data_set_t const *ds, value_list_t const *vl,
+                         size_t ds_index, char const *prefix,
+                         char const *postfix, char const escape_char,
+                         unsigned int flags) {
+  char const *ds_name = NULL;
+  int status;
+
+  if (cache != NULL) {
+    status = name_cache_get(cache, vl, ds_index, key, key_size);
+    if (status >= 0)
+      return status;
+  }
+
+  if ((flags & GRAPHITE_ALWAYS_APPEND_DS) || (ds->ds_num > 1))
+    ds_name = ds->ds[ds_index].name;
+
+  /* Copy the identifier to `key' and escape it. */
+  status = gr_format_name(key, (int)key_size, vl, ds_name, prefix, postfix,
+                          escape_char, flags);
+  if (status != 0)
+    return status;
+
+  escape_graphite_string(key, escape_char);
+
+  size_t key_len = strlen(key);
+  if (cache != NULL)
+    name_cache_put(cache, vl, ds_index, key, key_len);
+
+  return (int)key_len;
+}
+
+int format_graphite_cached(char *buffer, size_t buffer_size,
+                           data_set_t const *ds, value_list_t const *vl,
+                           char const *prefix, char const *postfix,
+                           char const escape_char, unsigned int flags,
+                           name_cache_t *cache) {
   int status = 0;
-  int buffer_pos = 0;
+  size_t buffer_pos = 0;
+  char timestamp[24];
+  size_t timestamp_len;
 
   gauge_t *rates = NULL;
   if (flags & GRAPHITE_STORE_RATES) {
@@ -188,26 +223,22 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
     }
   }
 
+  timestamp_len =
+      (size_t)snprintf(timestamp, sizeof(timestamp), " %u\r\n",
+                       (unsigned int)CDTIME_T_TO_TIME_T(vl->time));
+
   for (size_t i = 0; i < ds->ds_num; i++) {
-    char const *ds_name = NULL;
     char key[10 * DATA_MAX_NAME_LEN];
     char values[512];
-    size_t message_len;
-    char message[1024];
 
-    if ((flags & GRAPHITE_ALWAYS_APPEND_DS) || (ds->ds_num > 1))
-      ds_name = ds->ds[i].name;
-
-    /* Copy the identifier to `key' and escape it. */
-    status = gr_format_name(key, sizeof(key), vl, ds_name, prefix, postfix,
-                            escape_char, flags);
-    if (status != 0) {
+    int key_len = gr_format_key(key, sizeof(key), cache, ds, vl, i, prefix,
+                                postfix, escape_char, flags);
+    if (key_len < 0) {
       ERROR("format_graphite: error with gr_format_name");
       sfree(rates);
-      return status;
+      return key_len;
     }
 
-    escape_graphite_string(key, escape_char);
     /* Convert the values to an ASCII representation and put that into
      * `values'. */
     status = gr_format_values(values, sizeof(values), i, ds, vl, rates);
@@ -216,29 +247,32 @@ int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
       sfree(rates);
       return status;
     }
+    size_t values_len = strlen(values);
 
-    /* Compute the graphite command */
-    message_len =
-        (size_t)snprintf(message, sizeof(message), "%s %s %u\r\n", key, values,
-                         (unsigned int)CDTIME_T_TO_TIME_T(vl->time));
-    if (message_len >= sizeof(message)) {
-      ERROR("format_graphite: message buffer too small: "
-            "Need %zu bytes.",
-            message_len + 1);
-      sfree(rates);
-      return -ENOMEM;
-    }
-
-    /* Append it in case we got multiple data set */
+    /* Append the graphite command "<key> <values> <timestamp>\r\n". */
+    size_t message_len = (size_t)key_len + 1 + values_len + timestamp_len;
     if ((buffer_pos + message_len) >= buffer_size) {
       ERROR("format_graphite: target buffer too small");
       sfree(rates);
       return -ENOMEM;
     }
-    memcpy((void *)(buffer + buffer_pos), message, message_len);
-    buffer_pos += message_len;
+    memcpy(buffer + buffer_pos, key, (size_t)key_len);
+    buffer_pos += (size_t)key_len;
+    buffer[buffer_pos++] = ' ';
+    memcpy(buffer + buffer_pos, values, values_len);
+    buffer_pos += values_len;
+    memcpy(buffer + buffer_pos, timestamp, timestamp_len);
+    buffer_pos += timestamp_len;
     buffer[buffer_pos] = '\0';
   }
   sfree(rates);
   return status;
+} /* int format_graphite_cached */
+
+int format_graphite(char *buffer, size_t buffer_size, data_set_t const *ds,
+                    value_list_t const *vl, char const *prefix,
+                    char const *postfix, char const escape_char,
+                    unsigned int flags) {
+  return format_graphite_cached(buffer, buffer_size, ds, vl, prefix, postfix,
+                                escape_char, flags, /* cache = */ NULL);
 } /* int format_graphite */
@@ -25,6 +25,7 @@
 #include "collectd.h"
 
 #include "plugin.h"
+#include "utils_name_cache.h"
 
 #define GRAPHITE_STORE_RATES 0x01
 #define GRAPHITE_SEPARATE_INSTANCES 0x02
@@ -37,4 +38,13 @@ int format_graphite(char *buffer, size_t buffer_size, const data_set_t *ds,
                     const char *postfix, const char escape_char,
                     unsigned int flags);
 
+/* format_graphite_cached is like format_graphite, but looks up the escaped
+ * metric names in "cache" and only formats those not found. The cache must
+ * only be used with one set of prefix, postfix, escape character and flags. */
+int format_graphite_cached(char *buffer, size_t buffer_size,
+                           const data_set_t *ds, const value_list_t *vl,
+                           const char *prefix, const char *postfix,
+                           const char escape_char, unsigned int flags,
+                           name_cache_t *cache);
+
 #endif /* UTILS_FORMAT_GRAPHITE_H */
@@ -0,0 +1,110 @@
+/**
+ * collectd - src/utils_format_graphite_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Formats BENCH_VALUES values of BENCH_SERIES series in the Graphite format,
+ * without a name cache, with a cache holding all series, and with a cache
+ * too small for them, which is the worst case because every lookup misses.
+ * Build with "make bench_utils_format_graphite".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_format_graphite.h"
+
+#include <time.h>
+
+#define BENCH_VALUES 2000000
+#define BENCH_SERIES 10000
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static data_source_t dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+static data_set_t ds = {"gauge", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+static value_list_t *series;
+
+static double bench_run(char const *name, size_t cache_size,
+                        double baseline) {
+  name_cache_t *cache = NULL;
+  char buffer[1428];
+  size_t bytes = 0;
+
+  if (cache_size > 0)
+    cache = name_cache_create(cache_size);
+
+  double start = cpu_time();
+  for (size_t i = 0; i < BENCH_VALUES; i++) {
+    value_list_t *vl = series + (i % BENCH_SERIES);
+    vl->values[0].gauge = (gauge_t)i;
+
+    if (format_graphite_cached(buffer, sizeof(buffer), &ds, vl, "collectd.",
+                               NULL, '_', GRAPHITE_SEPARATE_INSTANCES,
+                               cache) != 0)
+      exit(1);
+    bytes += strlen(buffer);
+  }
+  double elapsed = cpu_time() - start;
+
+  name_cache_destroy(cache);
+
+  printf("%-16s %7.3f s, %9.0f values/s, %5.0f ns/value", name, elapsed,
+         BENCH_VALUES / elapsed, 1e9 * elapsed / BENCH_VALUES);
+  if (baseline > 0)
+    printf(" (%.1fx)", baseline / elapsed);
+  printf(", %zu bytes\n", bytes);
+  return elapsed;
+}
+
+int main(void) {
+  series = calloc(BENCH_SERIES, sizeof(*series));
+  if (series == NULL)
+    return 1;
+
+  for (size_t i = 0; i < BENCH_SERIES; i++) {
+    value_list_t *vl = series + i;
+
+    vl->values = calloc(1, sizeof(*vl->values));
+    vl->values_len = 1;
+    vl->time = TIME_T_TO_CDTIME_T(1500000000);
+    vl->interval = TIME_T_TO_CDTIME_T(10);
+    sstrncpy(vl->host, "myhost.example.com", sizeof(vl->host));
+    sstrncpy(vl->plugin, "interface", sizeof(vl->plugin));
+    snprintf(vl->plugin_instance, sizeof(vl->plugin_instance), "eth%zu",
+             i / 100);
+    sstrncpy(vl->type, "gauge", sizeof(vl->type));
+    snprintf(vl->type_instance, sizeof(vl->type_instance), "rx queue %zu",
+             i % 100);
+  }
+
+  double uncached = bench_run("uncached", 0, 0);
+  bench_run("cached", BENCH_SERIES, uncached);
+  bench_run("cache too small", BENCH_SERIES / 2, uncached);
+
+  return 0;
+}
@@ -152,6 +152,18 @@ DEF_TEST(metric_name) {
                                      cases[i].prefix, cases[i].suffix, '@',
                                      cases[i].flags));
     EXPECT_EQ_STR(want, got);
+
+    /* The first call fills the cache, the second one uses it. */
+    name_cache_t *cache = name_cache_create(4);
+    CHECK_NOT_NULL(cache);
+    for (int j = 0; j < 2; j++) {
+      EXPECT_EQ_INT(0, format_graphite_cached(got, sizeof(got), &ds_single,
+                                              &vl, cases[i].prefix,
+                                              cases[i].suffix, '@',
+                                              cases[i].flags, cache));
+      EXPECT_EQ_STR(want, got);
+    }
+    name_cache_destroy(cache);
   }
 
   return 0;
@@ -29,6 +29,7 @@
 #include "utils_format_json.h"
 
 #include "common.h"
+#include "meta_data.h"
 #include "plugin.h"
 #include "utils_cache.h"
 
@@ -43,367 +44,325 @@
 #endif
 #endif
 
-static int json_escape_string(char *buffer, size_t buffer_size, /* {{{ */
-                              const char *string) {
-  size_t dst_pos;
+/* The JSON writer appends directly to the caller's buffer and keeps it null
+ * terminated. Once something doesn't fit, "overflow" is set and all further
+ * output is dropped. */
+typedef struct {
+  char *buffer;
+  size_t size;
+  size_t fill;
+  _Bool overflow;
+} json_writer_t;
+
+static void jw_add(json_writer_t *w, char const *str, size_t len) /* {{{ */
+{
+  if (w->overflow || (len >= w->size - w->fill)) {
+    w->overflow = 1;
+    return;
+  }
 
-  if ((buffer == NULL) || (string == NULL))
-    return -EINVAL;
+  memcpy(w->buffer + w->fill, str, len);
+  w->fill += len;
+  w->buffer[w->fill] = 0;
+} /* }}} void jw_add */
 
-  if (buffer_size < 3)
-    return -ENOMEM;
+#define JW_ADD_LITERAL(w, str) jw_add((w), (str), sizeof(str) - 1)
 
-  dst_pos = 0;
+__attribute__((format(printf, 2, 3))) static void
+jw_add_printf(json_writer_t *w, char const *format, ...) /* {{{ */
+{
+  va_list ap;
+  int status;
 
-#define BUFFER_ADD(c)                                                          \
-  do {                                                                         \
-    if (dst_pos >= (buffer_size - 1)) {                                        \
-      buffer[buffer_size - 1] = 0;                                             \
-      return -ENOMEM;                                                          \
-    }                                                                          \
-    buffer[dst_pos] = (c);                                                     \
-    dst_pos++;                                                                 \
-  } while (0)
+  if (w->overflow)
+    return;
 
-  /* Escape special characters */
-  BUFFER_ADD('"');
-  for (size_t src_pos = 0; string[src_pos] != 0; src_pos++) {
-    if ((string[src_pos] == '"') || (string[src_pos] == '\\')) {
-      BUFFER_ADD('\\');
-      BUFFER_ADD(string[src_pos]);
-    } else if (string[src_pos] <= 0x001F)
-      BUFFER_ADD('?');
-    else
-      BUFFER_ADD(string[src_pos]);
-  } /* for */
-  BUFFER_ADD('"');
-  buffer[dst_pos] = 0;
+  va_start(ap, format);
+  status = vsnprintf(w->buffer + w->fill, w->size - w->fill, format, ap);
+  va_end(ap);
 
-#undef BUFFER_ADD
+  if ((status < 0) || ((size_t)status >= w->size - w->fill)) {
+    w->overflow = 1;
+    w->buffer[w->fill] = 0;
+    return;
+  }
+  w->fill += (size_t)status;
+} /* }}} void jw_add_printf */
 
-  return 0;
-} /* }}} int json_escape_string */
+static void jw_add_uint(json_writer_t *w, uint64_t value) /* {{{ */
+{
+  char buffer[24];
+  char *ptr = buffer + sizeof(buffer);
+
+  do {
+    *(--ptr) = '0' + (char)(value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  jw_add(w, ptr, (size_t)(buffer + sizeof(buffer) - ptr));
+} /* }}} void jw_add_uint */
+
+static void jw_add_int(json_writer_t *w, int64_t value) /* {{{ */
+{
+  if (value < 0) {
+    JW_ADD_LITERAL(w, "-");
+    /* Negate as unsigned to handle INT64_MIN. */
+    jw_add_uint(w, 0 - (uint64_t)value);
+  } else
+    jw_add_uint(w, (uint64_t)value);
+} /* }}} void jw_add_int */
+
+/* Returns non-zero if any of the eight bytes in "word" is a double quote, a
+ * backslash or a control character. */
+static uint64_t json_word_needs_escape(uint64_t word) /* {{{ */
+{
+  uint64_t const ones = UINT64_C(0x0101010101010101);
+  uint64_t const highs = UINT64_C(0x8080808080808080);
+  uint64_t quote = word ^ (ones * '"');
+  uint64_t backslash = word ^ (ones * '\\');
+
+  /* Sets the high bit of bytes that are zero, resp. smaller than 0x20. */
+  return (((quote - ones) & ~quote) | ((backslash - ones) & ~backslash) |
+          ((word - ones * 0x20) & ~word)) &
+         highs;
+} /* }}} uint64_t json_word_needs_escape */
+
+static _Bool json_char_needs_escape(char c) /* {{{ */
+{
+  return (c == '"') || (c == '\\') || ((unsigned char)c < 0x20);
+} /* }}} _Bool json_char_needs_escape */
+
+/* Appends "str" as a JSON string. Double quotes and backslashes are escaped,
+ * control characters are replaced with question marks. Runs of characters
+ * that need no escaping are found eight bytes at a time and copied at once. */
+static void jw_add_string(json_writer_t *w, char const *str) /* {{{ */
+{
+  size_t len = strlen(str);
+  size_t start = 0;
+  size_t i = 0;
+
+  JW_ADD_LITERAL(w, "\"");
+  while (i < len) {
+    while (i + sizeof(uint64_t) <= len) {
+      uint64_t word;
+
+      memcpy(&word, str + i, sizeof(word));
+      if (json_word_needs_escape(word))
+        break;
+      i += sizeof(word);
+    }
 
-static int values_to_json(char *buffer, size_t buffer_size, /* {{{ */
+    size_t end = (i + sizeof(uint64_t) < len) ? i + sizeof(uint64_t) : len;
+    while ((i < end) && !json_char_needs_escape(str[i]))
+      i++;
+    if (i == end)
+      continue;
+
+    jw_add(w, str + start, i - start);
+    if ((str[i] == '"') || (str[i] == '\\')) {
+      char escaped[2] = {'\\', str[i]};
+      jw_add(w, escaped, sizeof(escaped));
+    } else
+      JW_ADD_LITERAL(w, "?");
+
+    i++;
+    start = i;
+  }
+  jw_add(w, str + start, len - start);
+  JW_ADD_LITERAL(w, "\"");
+} /* }}} void jw_add_string */
+
+static int values_to_json(json_writer_t *w, /* {{{ */
                           const data_set_t *ds, const value_list_t *vl,
                           int store_rates) {
-  size_t offset = 0;
   gauge_t *rates = NULL;
 
-  memset(buffer, 0, buffer_size);
-
-#define BUFFER_ADD(...)                                                        \
-  do {                                                                         \
-    int status;                                                                \
-    status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1) {                                                          \
-      sfree(rates);                                                            \
-      return -1;                                                               \
-    } else if (((size_t)status) >= (buffer_size - offset)) {                   \
-      sfree(rates);                                                            \
-      return -ENOMEM;                                                          \
-    } else                                                                     \
-      offset += ((size_t)status);                                              \
-  } while (0)
-
-  BUFFER_ADD("[");
+  JW_ADD_LITERAL(w, "[");
   for (size_t i = 0; i < ds->ds_num; i++) {
     if (i > 0)
-      BUFFER_ADD(",");
+      JW_ADD_LITERAL(w, ",");
 
     if (ds->ds[i].type == DS_TYPE_GAUGE) {
       if (isfinite(vl->values[i].gauge))
-        BUFFER_ADD(JSON_GAUGE_FORMAT, vl->values[i].gauge);
+        jw_add_printf(w, JSON_GAUGE_FORMAT, vl->values[i].gauge);
       else
-        BUFFER_ADD("null");
+        JW_ADD_LITERAL(w, "null");
     } else if (store_rates) {
       if (rates == NULL)
         rates = uc_get_rate(ds, vl);
       if (rates == NULL) {
         WARNING("utils_format_json: uc_get_rate failed.");
-        sfree(rates);
         return -1;
       }
 
       if (isfinite(rates[i]))
-        BUFFER_ADD(JSON_GAUGE_FORMAT, rates[i]);
+        jw_add_printf(w, JSON_GAUGE_FORMAT, rates[i]);
       else
-        BUFFER_ADD("null");
+        JW_ADD_LITERAL(w, "null");
     } else if (ds->ds[i].type == DS_TYPE_COUNTER)
-      BUFFER_ADD("%llu", vl->values[i].counter);
+      jw_add_uint(w, (uint64_t)vl->values[i].counter);
     else if (ds->ds[i].type == DS_TYPE_DERIVE)
-      BUFFER_ADD("%" PRIi64, vl->values[i].derive);
+      jw_add_int(w, (int64_t)vl->values[i].derive);
     else if (ds->ds[i].type == DS_TYPE_ABSOLUTE)
-      BUFFER_ADD("%" PRIu64, vl->values[i].absolute);
+      jw_add_uint(w, (uint64_t)vl->values[i].absolute);
     else {
       ERROR("format_json: Unknown data source type: %i", ds->ds[i].type);
       sfree(rates);
       return -1;
     }
   } /* for ds->ds_num */
-  BUFFER_ADD("]");
-
-#undef BUFFER_ADD
+  JW_ADD_LITERAL(w, "]");
 
-  DEBUG("format_json: values_to_json: buffer = %s;", buffer);
   sfree(rates);
   return 0;
 } /* }}} int values_to_json */
 
-static int dstypes_to_json(char *buffer, size_t buffer_size, /* {{{ */
-                           const data_set_t *ds) {
-  size_t offset = 0;
-
-  memset(buffer, 0, buffer_size);
-
-#define BUFFER_ADD(...)                                                        \
-  do {                                                                         \
-    int status;                                                                \
-    status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1)                                                            \
-      return -1;                                                               \
-    else if (((size_t)status) >= (buffer_size - offset))                       \
-      return -ENOMEM;                                                          \
-    else                                                                       \
-      offset += ((size_t)status);                                              \
-  } while (0)
-
-  BUFFER_ADD("[");
+/* Appends the parts of a value list's JSON that only depend on the data set,
+ * i.e. the "dstypes" and "dsnames" fields. */
+static void ds_to_json(json_writer_t *w, const data_set_t *ds) /* {{{ */
+{
+  JW_ADD_LITERAL(w, ",\"dstypes\":[");
   for (size_t i = 0; i < ds->ds_num; i++) {
     if (i > 0)
-      BUFFER_ADD(",");
-
-    BUFFER_ADD("\"%s\"", DS_TYPE_TO_STRING(ds->ds[i].type));
-  } /* for ds->ds_num */
-  BUFFER_ADD("]");
-
-#undef BUFFER_ADD
-
-  DEBUG("format_json: dstypes_to_json: buffer = %s;", buffer);
-
-  return 0;
-} /* }}} int dstypes_to_json */
-
-static int dsnames_to_json(char *buffer, size_t buffer_size, /* {{{ */
-                           const data_set_t *ds) {
-  size_t offset = 0;
-
-  memset(buffer, 0, buffer_size);
-
-#define BUFFER_ADD(...)                                                        \
-  do {                                                                         \
-    int status;                                                                \
-    status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1)                                                            \
-      return -1;                                                               \
-    else if (((size_t)status) >= (buffer_size - offset))                       \
-      return -ENOMEM;                                                          \
-    else                                                                       \
-      offset += ((size_t)status);                                              \
-  } while (0)
+      JW_ADD_LITERAL(w, ",");
+    jw_add_string(w, DS_TYPE_TO_STRING(ds->ds[i].type));
+  }
 
-  BUFFER_ADD("[");
+  JW_ADD_LITERAL(w, "],\"dsnames\":[");
   for (size_t i = 0; i < ds->ds_num; i++) {
     if (i > 0)
-      BUFFER_ADD(",");
-
-    BUFFER_ADD("\"%s\"", ds->ds[i].name);
-  } /* for ds->ds_num */
-  BUFFER_ADD("]");
-
-#undef BUFFER_ADD
-
-  DEBUG("format_json: dsnames_to_json: buffer = %s;", buffer);
-
-  return 0;
-} /* }}} int dsnames_to_json */
-
-static int meta_data_keys_to_json(char *buffer, size_t buffer_size, /* {{{ */
-                                  meta_data_t *meta, char **keys,
-                                  size_t keys_num) {
-  size_t offset = 0;
-  int status;
-
-  buffer[0] = 0;
-
-#define BUFFER_ADD(...)                                                        \
-  do {                                                                         \
-    status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1)                                                            \
-      return -1;                                                               \
-    else if (((size_t)status) >= (buffer_size - offset))                       \
-      return -ENOMEM;                                                          \
-    else                                                                       \
-      offset += ((size_t)status);                                              \
-  } while (0)
-
-  for (size_t i = 0; i < keys_num; ++i) {
-    int type;
-    char *key = keys[i];
-
-    type = meta_data_type(meta, key);
-    if (type == MD_TYPE_STRING) {
-      char *value = NULL;
-      if (meta_data_get_string(meta, key, &value) == 0) {
-        char temp[512] = "";
-
-        status = json_escape_string(temp, sizeof(temp), value);
-        sfree(value);
-        if (status != 0)
-          return status;
-
-        BUFFER_ADD(",\"%s\":%s", key, temp);
-      }
-    } else if (type == MD_TYPE_SIGNED_INT) {
-      int64_t value = 0;
-      if (meta_data_get_signed_int(meta, key, &value) == 0)
-        BUFFER_ADD(",\"%s\":%" PRIi64, key, value);
-    } else if (type == MD_TYPE_UNSIGNED_INT) {
-      uint64_t value = 0;
-      if (meta_data_get_unsigned_int(meta, key, &value) == 0)
-        BUFFER_ADD(",\"%s\":%" PRIu64, key, value);
-    } else if (type == MD_TYPE_DOUBLE) {
-      double value = 0.0;
-      if (meta_data_get_double(meta, key, &value) == 0)
-        BUFFER_ADD(",\"%s\":%f", key, value);
-    } else if (type == MD_TYPE_BOOLEAN) {
-      _Bool value = 0;
-      if (meta_data_get_boolean(meta, key, &value) == 0)
-        BUFFER_ADD(",\"%s\":%s", key, value ? "true" : "false");
-    }
-  } /* for (keys) */
-
-  if (offset == 0)
-    return ENOENT;
-
-  buffer[0] = '{'; /* replace leading ',' */
-  BUFFER_ADD("}");
+      JW_ADD_LITERAL(w, ",");
+    jw_add_string(w, ds->ds[i].name);
+  }
+  JW_ADD_LITERAL(w, "]");
+} /* }}} void ds_to_json */
+
+static int meta_data_entry_to_json(char const *key, int type, /* {{{ */
+                                   void const *value, void *user_data) {
+  json_writer_t *w = user_data;
+
+  switch (type) {
+  case MD_TYPE_STRING:
+  case MD_TYPE_SIGNED_INT:
+  case MD_TYPE_UNSIGNED_INT:
+  case MD_TYPE_DOUBLE:
+  case MD_TYPE_BOOLEAN:
+    break;
+  default:
+    return 0;
+  }
 
-#undef BUFFER_ADD
+  /* All entries have a leading comma. The first one is replaced with a curly
+   * brace in `meta_data_to_json'. */
+  JW_ADD_LITERAL(w, ",");
+  jw_add_string(w, key);
+  JW_ADD_LITERAL(w, ":");
+
+  if (type == MD_TYPE_STRING)
+    jw_add_string(w, value);
+  else if (type == MD_TYPE_SIGNED_INT)
+    jw_add_int(w, *(int64_t const *)value);
+  else if (type == MD_TYPE_UNSIGNED_INT)
+    jw_add_uint(w, *(uint64_t const *)value);
+  else if (type == MD_TYPE_DOUBLE)
+    jw_add_printf(w, "%f", *(double const *)value);
+  else if (*(_Bool const *)value)
+    JW_ADD_LITERAL(w, "true");
+  else
+    JW_ADD_LITERAL(w, "false");
 
-  return 0;
-} /* }}} int meta_data_keys_to_json */
+  return w->overflow ? -ENOMEM : 0;
+} /* }}} int meta_data_entry_to_json */
 
-static int meta_data_to_json(char *buffer, size_t buffer_size, /* {{{ */
-                             meta_data_t *meta) {
-  char **keys = NULL;
-  size_t keys_num;
+static int meta_data_to_json(json_writer_t *w, meta_data_t *meta) /* {{{ */
+{
+  size_t start;
   int status;
 
-  if ((buffer == NULL) || (buffer_size == 0) || (meta == NULL))
-    return EINVAL;
+  JW_ADD_LITERAL(w, ",\"meta\":");
+  if (w->overflow)
+    return -ENOMEM;
+  start = w->fill;
 
-  status = meta_data_toc(meta, &keys);
-  if (status <= 0)
+  status = meta_data_iterate(meta, meta_data_entry_to_json, w);
+  if (status != 0)
     return status;
-  keys_num = (size_t)status;
 
-  status = meta_data_keys_to_json(buffer, buffer_size, meta, keys, keys_num);
-
-  for (size_t i = 0; i < keys_num; ++i)
-    sfree(keys[i]);
-  sfree(keys);
+  /* Leave out "meta" if it has no entries. */
+  if (w->fill == start) {
+    w->fill = start - strlen(",\"meta\":");
+    w->buffer[w->fill] = 0;
+    return 0;
+  }
 
-  return status;
+  w->buffer[start] = '{'; /* replace leading ',' */
+  JW_ADD_LITERAL(w, "}");
+  return 0;
 } /* }}} int meta_data_to_json */
 
-static int value_list_to_json(char *buffer, size_t buffer_size, /* {{{ */
+/* Appends one value list. If "ds_json" is not empty, it holds the output of
+ * `ds_to_json' for "ds" and is copied instead of formatting the data set
+ * again. Otherwise it is set to the position of that output in the buffer. */
+static int value_list_to_json(json_writer_t *w, /* {{{ */
                               const data_set_t *ds, const value_list_t *vl,
-                              int store_rates) {
-  char temp[512];
-  size_t offset = 0;
+                              int store_rates, size_t *ds_json_pos,
+                              size_t *ds_json_len) {
+  size_t start = w->fill;
   int status;
 
-  memset(buffer, 0, buffer_size);
-
-#define BUFFER_ADD(...)                                                        \
-  do {                                                                         \
-    status = snprintf(buffer + offset, buffer_size - offset, __VA_ARGS__);     \
-    if (status < 1)                                                            \
-      return -1;                                                               \
-    else if (((size_t)status) >= (buffer_size - offset))                       \
-      return -ENOMEM;                                                          \
-    else                                                                       \
-      offset += ((size_t)status);                                              \
-  } while (0)
-
   /* All value lists have a leading comma. The first one will be replaced with
    * a square bracket in `format_json_finalize'. */
-  BUFFER_ADD(",{");
+  JW_ADD_LITERAL(w, ",{\"values\":");
 
-  status = values_to_json(temp, sizeof(temp), ds, vl, store_rates);
+  status = values_to_json(w, ds, vl, store_rates);
   if (status != 0)
-    return status;
-  BUFFER_ADD("\"values\":%s", temp);
-
-  status = dstypes_to_json(temp, sizeof(temp), ds);
-  if (status != 0)
-    return status;
-  BUFFER_ADD(",\"dstypes\":%s", temp);
-
-  status = dsnames_to_json(temp, sizeof(temp), ds);
-  if (status != 0)
-    return status;
-  BUFFER_ADD(",\"dsnames\":%s", temp);
-
-  BUFFER_ADD(",\"time\":%.3f", CDTIME_T_TO_DOUBLE(vl->time));
-  BUFFER_ADD(",\"interval\":%.3f", CDTIME_T_TO_DOUBLE(vl->interval));
-
-#define BUFFER_ADD_KEYVAL(key, value)                                          \
-  do {                                                                         \
-    status = json_escape_string(temp, sizeof(temp), (value));                  \
-    if (status != 0)                                                           \
-      return status;                                                           \
-    BUFFER_ADD(",\"%s\":%s", (key), temp);                                     \
-  } while (0)
+    goto fail;
+
+  if (*ds_json_len > 0)
+    jw_add(w, w->buffer + *ds_json_pos, *ds_json_len);
+  else {
+    *ds_json_pos = w->fill;
+    ds_to_json(w, ds);
+    *ds_json_len = w->overflow ? 0 : w->fill - *ds_json_pos;
+  }
 
-  BUFFER_ADD_KEYVAL("host", vl->host);
-  BUFFER_ADD_KEYVAL("plugin", vl->plugin);
-  BUFFER_ADD_KEYVAL("plugin_instance", vl->plugin_instance);
-  BUFFER_ADD_KEYVAL("type", vl->type);
-  BUFFER_ADD_KEYVAL("type_instance", vl->type_instance);
+  JW_ADD_LITERAL(w, ",\"time\":");
+  jw_add_printf(w, "%.3f", CDTIME_T_TO_DOUBLE(vl->time));
+  JW_ADD_LITERAL(w, ",\"interval\":");
+  jw_add_printf(w, "%.3f", CDTIME_T_TO_DOUBLE(vl->interval));
+
+  JW_ADD_LITERAL(w, ",\"host\":");
+  jw_add_string(w, vl->host);
+  JW_ADD_LITERAL(w, ",\"plugin\":");
+  jw_add_string(w, vl->plugin);
+  JW_ADD_LITERAL(w, ",\"plugin_instance\":");
+  jw_add_string(w, vl->plugin_instance);
+  JW_ADD_LITERAL(w, ",\"type\":");
+  jw_add_string(w, vl->type);
+  JW_ADD_LITERAL(w, ",\"type_instance\":");
+  jw_add_string(w, vl->type_instance);
 
   if (vl->meta != NULL) {
-    char meta_buffer[buffer_size];
-    memset(meta_buffer, 0, sizeof(meta_buffer));
-    status = meta_data_to_json(meta_buffer, sizeof(meta_buffer), vl->meta);
+    status = meta_data_to_json(w, vl->meta);
     if (status != 0)
-      return status;
-
-    BUFFER_ADD(",\"meta\":%s", meta_buffer);
-  } /* if (vl->meta != NULL) */
-
-  BUFFER_ADD("}");
-
-#undef BUFFER_ADD_KEYVAL
-#undef BUFFER_ADD
-
-  DEBUG("format_json: value_list_to_json: buffer = %s;", buffer);
+      goto fail;
+  }
 
-  return 0;
+  JW_ADD_LITERAL(w, "}");
+  if (!w->overflow)
+    return 0;
+  status = -ENOMEM;
+
+fail:
+  /* Remove the partial output. */
+  w->fill = start;
+  w->buffer[start] = 0;
+  w->overflow = 0;
+  if (*ds_json_pos >= start)
+    *ds_json_len = 0;
+  return status;
 } /* }}} int value_list_to_json */
 
-static int format_json_value_list_nocheck(char *buffer, /* {{{ */
-                                          size_t *ret_buffer_fill,
-                                          size_t *ret_buffer_free,
-                                          const data_set_t *ds,
-                                          const value_list_t *vl,
-                                          int store_rates, size_t temp_size) {
-  char temp[temp_size];
-  int status;
-
-  status = value_list_to_json(temp, sizeof(temp), ds, vl, store_rates);
-  if (status != 0)
-    return status;
-  temp_size = strlen(temp);
-
-  memcpy(buffer + (*ret_buffer_fill), temp, temp_size + 1);
-  (*ret_buffer_fill) += temp_size;
-  (*ret_buffer_free) -= temp_size;
-
-  return 0;
-} /* }}} int format_json_value_list_nocheck */
-
 int format_json_initialize(char *buffer, /* {{{ */
                            size_t *ret_buffer_fill, size_t *ret_buffer_free) {
   size_t buffer_fill;
@@ -422,7 +381,7 @@ int format_json_initialize(char *buffer, /* {{{ */
   if (buffer_free < 3)
     return -ENOMEM;
 
-  memset(buffer, 0, buffer_free);
+  buffer[0] = 0;
   *ret_buffer_fill = buffer_fill;
   *ret_buffer_free = buffer_free;
 
@@ -460,6 +419,23 @@ int format_json_value_list(char *buffer, /* {{{ */
                            size_t *ret_buffer_fill, size_t *ret_buffer_free,
                            const data_set_t *ds, const value_list_t *vl,
                            int store_rates) {
+  return format_json_value_lists(buffer, ret_buffer_fill, ret_buffer_free, &ds,
+                                 vl, 1, store_rates, /* ret_done = */ NULL);
+} /* }}} int format_json_value_list */
+
+int format_json_value_lists(char *buffer, /* {{{ */
+                            size_t *ret_buffer_fill, size_t *ret_buffer_free,
+                            const data_set_t *const *ds,
+                            const value_list_t *vl, size_t vl_num,
+                            int store_rates, size_t *ret_done) {
+  size_t ds_json_pos = 0;
+  size_t ds_json_len = 0;
+  size_t i;
+  int status = 0;
+
+  if (ret_done != NULL)
+    *ret_done = 0;
+
   if ((buffer == NULL) || (ret_buffer_fill == NULL) ||
       (ret_buffer_free == NULL) || (ds == NULL) || (vl == NULL))
     return -EINVAL;
@@ -467,10 +443,36 @@ int format_json_value_list(char *buffer, /* {{{ */
   if (*ret_buffer_free < 3)
     return -ENOMEM;
 
-  return format_json_value_list_nocheck(buffer, ret_buffer_fill,
-                                        ret_buffer_free, ds, vl, store_rates,
-                                        (*ret_buffer_free) - 2);
-} /* }}} int format_json_value_list */
+  /* Keep two bytes for `format_json_finalize'. */
+  json_writer_t w = {
+      .buffer = buffer,
+      .size = *ret_buffer_fill + *ret_buffer_free - 2,
+      .fill = *ret_buffer_fill,
+  };
+
+  for (i = 0; i < vl_num; i++) {
+    if (ds[i] == NULL) {
+      status = -EINVAL;
+      break;
+    }
+
+    /* Consecutive value lists of the same type share the data set part. */
+    if ((i > 0) && (ds[i] != ds[i - 1]))
+      ds_json_len = 0;
+
+    status = value_list_to_json(&w, ds[i], vl + i, store_rates, &ds_json_pos,
+                                &ds_json_len);
+    if (status != 0)
+      break;
+  }
+
+  (*ret_buffer_free) -= w.fill - *ret_buffer_fill;
+  (*ret_buffer_fill) = w.fill;
+  if (ret_done != NULL)
+    *ret_done = i;
+
+  return status;
+} /* }}} int format_json_value_lists */
 
 #if HAVE_LIBYAJL
 static int json_add_string(yajl_gen g, char const *str) /* {{{ */
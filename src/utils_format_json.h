@@ -40,6 +40,17 @@ int format_json_initialize(char *buffer, size_t *ret_buffer_fill,
 int format_json_value_list(char *buffer, size_t *ret_buffer_fill,
                            size_t *ret_buffer_free, const data_set_t *ds,
                            const value_list_t *vl, int store_rates);
+/* Formats "vl_num" value lists in one call; "ds[i]" is the data set of
+ * "vl[i]". Consecutive value lists with the same data set share its
+ * formatted "dstypes" and "dsnames" fields. Stops at the first value list that
+ * cannot be formatted, e.g. because the buffer is full, and returns its error.
+ * Value lists formatted up to that point are kept and their number is stored
+ * in "ret_done", if not NULL. */
+int format_json_value_lists(char *buffer, size_t *ret_buffer_fill,
+                            size_t *ret_buffer_free,
+                            const data_set_t *const *ds,
+                            const value_list_t *vl, size_t vl_num,
+                            int store_rates, size_t *ret_done);
 int format_json_finalize(char *buffer, size_t *ret_buffer_fill,
                          size_t *ret_buffer_free);
 int format_json_notification(char *buffer, size_t buffer_size,
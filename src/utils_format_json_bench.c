@@ -0,0 +1,148 @@
+/**
+ * collectd - src/utils_format_json_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Formats BENCH_VALUES values of BENCH_SERIES series into a buffer of
+ * BENCH_BUFFER_SIZE bytes, one value list at a time as write_http and
+ * write_kafka do, with meta data attached, and BENCH_BATCH value lists per
+ * call to format_json_value_lists().
+ * Build with "make bench_utils_format_json".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "meta_data.h"
+#include "utils_format_json.h"
+
+#include <time.h>
+
+#define BENCH_VALUES 2000000
+#define BENCH_SERIES 10000
+#define BENCH_BATCH 64
+#define BENCH_BUFFER_SIZE 65536
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static data_source_t dsrc[] = {{"rx", DS_TYPE_DERIVE, 0.0, NAN},
+                               {"tx", DS_TYPE_DERIVE, 0.0, NAN}};
+static data_set_t ds = {"if_octets", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+static value_list_t *series;
+static data_set_t const *series_ds[BENCH_SERIES];
+
+static double bench_run(char const *name, size_t batch, double baseline) {
+  char *buffer = malloc(BENCH_BUFFER_SIZE);
+  size_t fill = 0;
+  size_t avail = BENCH_BUFFER_SIZE;
+  size_t flushes = 0;
+  size_t bytes = 0;
+
+  if (buffer == NULL)
+    exit(1);
+  format_json_initialize(buffer, &fill, &avail);
+
+  double start = cpu_time();
+  for (size_t i = 0; i < BENCH_VALUES;) {
+    size_t first = i % BENCH_SERIES;
+    size_t num = batch;
+    if (num > BENCH_SERIES - first)
+      num = BENCH_SERIES - first;
+
+    for (size_t j = 0; j < num; j++) {
+      series[first + j].values[0].derive = (derive_t)(i + j);
+      series[first + j].values[1].derive = (derive_t)(2 * (i + j));
+    }
+    i += num;
+
+    while (num > 0) {
+      size_t done = 0;
+      int status = format_json_value_lists(buffer, &fill, &avail,
+                                           series_ds + first, series + first,
+                                           num, /* store_rates = */ 0, &done);
+      first += done;
+      num -= done;
+      if (status == 0)
+        break;
+      if ((status != -ENOMEM) || (fill == 0))
+        exit(1);
+
+      /* Buffer is full: "send" it and start over. */
+      format_json_finalize(buffer, &fill, &avail);
+      bytes += fill;
+      flushes++;
+      fill = 0;
+      avail = BENCH_BUFFER_SIZE;
+      format_json_initialize(buffer, &fill, &avail);
+    }
+  }
+  double elapsed = cpu_time() - start;
+  bytes += fill;
+
+  free(buffer);
+
+  printf("%-16s %7.3f s, %9.0f values/s, %5.0f ns/value", name, elapsed,
+         BENCH_VALUES / elapsed, 1e9 * elapsed / BENCH_VALUES);
+  if (baseline > 0)
+    printf(" (%.1fx)", baseline / elapsed);
+  printf(", %zu bytes in %zu buffers\n", bytes, flushes + 1);
+  return elapsed;
+}
+
+int main(void) {
+  series = calloc(BENCH_SERIES, sizeof(*series));
+  if (series == NULL)
+    return 1;
+
+  for (size_t i = 0; i < BENCH_SERIES; i++) {
+    value_list_t *vl = series + i;
+
+    vl->values = calloc(ds.ds_num, sizeof(*vl->values));
+    vl->values_len = ds.ds_num;
+    vl->time = TIME_T_TO_CDTIME_T(1500000000);
+    vl->interval = TIME_T_TO_CDTIME_T(10);
+    sstrncpy(vl->host, "myhost.example.com", sizeof(vl->host));
+    sstrncpy(vl->plugin, "interface", sizeof(vl->plugin));
+    snprintf(vl->plugin_instance, sizeof(vl->plugin_instance), "eth%zu",
+             i % 100);
+    sstrncpy(vl->type, "if_octets", sizeof(vl->type));
+    series_ds[i] = &ds;
+  }
+
+  double single = bench_run("single", 1, 0);
+  bench_run("batch", BENCH_BATCH, single);
+
+  for (size_t i = 0; i < BENCH_SERIES; i++) {
+    series[i].meta = meta_data_create();
+    meta_data_add_string(series[i].meta, "network:received", "true");
+    meta_data_add_unsigned_int(series[i].meta, "network:ttl", 64);
+  }
+  bench_run("single, meta", 1, single);
+  bench_run("batch, meta", BENCH_BATCH, single);
+
+  return 0;
+}
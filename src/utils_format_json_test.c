@@ -39,6 +39,7 @@
 #include "collectd.h"
 
 #include "common.h" /* for STATIC_ARRAY_SIZE */
+#include "meta_data.h"
 #include "testing.h"
 #include "utils_format_json.h"
 
@@ -176,8 +177,137 @@ DEF_TEST(notification) {
   return expect_json_labels(got, labels, STATIC_ARRAY_SIZE(labels));
 }
 
+static data_source_t dsrc[] = {
+    {"gauge", DS_TYPE_GAUGE, 0, NAN},
+    {"derive", DS_TYPE_DERIVE, 0, NAN},
+    {"counter", DS_TYPE_COUNTER, 0, NAN},
+    {"absolute", DS_TYPE_ABSOLUTE, 0, NAN},
+};
+static data_set_t ds = {"test", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+#define WANT_VALUE_LIST(values, meta)                                          \
+  "{\"values\":" values ",\"dstypes\":[\"gauge\",\"derive\",\"counter\","     \
+  "\"absolute\"],\"dsnames\":[\"gauge\",\"derive\",\"counter\","              \
+  "\"absolute\"],\"time\":1448284606.125,\"interval\":10.000,"                 \
+  "\"host\":\"example.com\",\"plugin\":\"unit\",\"plugin_instance\":\"\","     \
+  "\"type\":\"test\",\"type_instance\":\"a\\\"b\\\\c?d\"" meta "}"
+
+DEF_TEST(value_list) {
+  value_t values[] = {{.gauge = 42.5},
+                      {.derive = -17},
+                      {.counter = 18446744073709551615ULL},
+                      {.absolute = 0}};
+  /* 1448284606.125 ^= 1555083754651779072 */
+  value_list_t vl = {.values = values,
+                     .values_len = STATIC_ARRAY_SIZE(values),
+                     .time = 1555083754651779072ULL,
+                     .interval = TIME_T_TO_CDTIME_T(10),
+                     .host = "example.com",
+                     .plugin = "unit",
+                     .type = "test",
+                     .type_instance = "a\"b\\c\td"};
+
+  char got[1024];
+  size_t fill = 0;
+  size_t avail = sizeof(got);
+
+  CHECK_ZERO(format_json_initialize(got, &fill, &avail));
+  CHECK_ZERO(format_json_value_list(got, &fill, &avail, &ds, &vl, 0));
+
+  values[0].gauge = NAN;
+  CHECK_NOT_NULL(vl.meta = meta_data_create());
+  CHECK_ZERO(meta_data_add_string(vl.meta, "string", "x\"y"));
+  CHECK_ZERO(meta_data_add_signed_int(vl.meta, "signed", -1));
+  CHECK_ZERO(meta_data_add_boolean(vl.meta, "boolean", 1));
+  CHECK_ZERO(format_json_value_list(got, &fill, &avail, &ds, &vl, 0));
+  meta_data_destroy(vl.meta);
+
+  /* Empty meta data is left out. */
+  CHECK_NOT_NULL(vl.meta = meta_data_create());
+  CHECK_ZERO(format_json_value_list(got, &fill, &avail, &ds, &vl, 0));
+  meta_data_destroy(vl.meta);
+
+  CHECK_ZERO(format_json_finalize(got, &fill, &avail));
+#define VALUES "[42.5,-17,18446744073709551615,0]"
+#define VALUES_NAN "[null,-17,18446744073709551615,0]"
+#define META ",\"meta\":{\"string\":\"x\\\"y\",\"signed\":-1,\"boolean\":true}"
+  EXPECT_EQ_STR("[" WANT_VALUE_LIST(VALUES, "") "," WANT_VALUE_LIST(
+                    VALUES_NAN, META) "," WANT_VALUE_LIST(VALUES_NAN, "") "]",
+                got);
+#undef VALUES
+#undef VALUES_NAN
+#undef META
+  EXPECT_EQ_INT(strlen(got), fill);
+  EXPECT_EQ_INT(sizeof(got) - strlen(got), avail);
+
+  return 0;
+}
+
+DEF_TEST(value_lists) {
+  value_t values[] = {{.gauge = 1}, {.derive = 2}, {.counter = 3},
+                      {.absolute = 4}};
+  value_list_t vl[3] = {{.values = values,
+                         .values_len = STATIC_ARRAY_SIZE(values),
+                         .time = 1555083754651779072ULL,
+                         .interval = TIME_T_TO_CDTIME_T(10),
+                         .host = "example.com",
+                         .plugin = "unit",
+                         .type = "test",
+                         .type_instance = "a\"b\\c\td"}};
+  data_set_t const *vl_ds[3] = {&ds, &ds, &ds};
+  vl[2] = vl[1] = vl[0];
+
+  char want[1024];
+  char got[1024];
+  size_t fill = 0;
+  size_t avail = sizeof(want);
+  size_t done = 0;
+
+  /* The same value lists, formatted one at a time. */
+  CHECK_ZERO(format_json_initialize(want, &fill, &avail));
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(vl); i++)
+    CHECK_ZERO(format_json_value_list(want, &fill, &avail, &ds, &vl[i], 0));
+  CHECK_ZERO(format_json_finalize(want, &fill, &avail));
+  EXPECT_EQ_STR("[" WANT_VALUE_LIST("[1,2,3,4]", "") "," WANT_VALUE_LIST(
+                    "[1,2,3,4]", "") "," WANT_VALUE_LIST("[1,2,3,4]", "") "]",
+                want);
+
+  fill = 0;
+  avail = sizeof(got);
+  CHECK_ZERO(format_json_initialize(got, &fill, &avail));
+  CHECK_ZERO(format_json_value_lists(got, &fill, &avail, vl_ds, vl,
+                                     STATIC_ARRAY_SIZE(vl), 0, &done));
+  EXPECT_EQ_INT(STATIC_ARRAY_SIZE(vl), done);
+  CHECK_ZERO(format_json_finalize(got, &fill, &avail));
+  EXPECT_EQ_STR(want, got);
+
+  /* When the buffer is too small, complete value lists are kept. */
+  size_t small_size = (strlen(want) / 2) + 2;
+  fill = 0;
+  avail = small_size;
+  CHECK_ZERO(format_json_initialize(got, &fill, &avail));
+  EXPECT_EQ_INT(-ENOMEM,
+                format_json_value_lists(got, &fill, &avail, vl_ds, vl,
+                                        STATIC_ARRAY_SIZE(vl), 0, &done));
+  EXPECT_EQ_INT(1, done);
+  EXPECT_EQ_INT(strlen(got), fill);
+  EXPECT_EQ_INT(small_size - fill, avail);
+
+  /* A failed call leaves the buffer unchanged. */
+  EXPECT_EQ_INT(-ENOMEM,
+                format_json_value_list(got, &fill, &avail, &ds, &vl[0], 0));
+  EXPECT_EQ_INT(strlen(got), fill);
+
+  CHECK_ZERO(format_json_finalize(got, &fill, &avail));
+  EXPECT_EQ_STR("[" WANT_VALUE_LIST("[1,2,3,4]", "") "]", got);
+
+  return 0;
+}
+
 int main(void) {
   RUN_TEST(notification);
+  RUN_TEST(value_list);
+  RUN_TEST(value_lists);
 
   END_TEST;
 }
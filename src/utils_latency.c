@@ -37,10 +37,23 @@
 #define LLONG_MAX 9223372036854775807LL
 #endif
 
-#ifndef HISTOGRAM_DEFAULT_BIN_WIDTH
-/* 1048576 = 2^20 ^= 1/1024 s */
-#define HISTOGRAM_DEFAULT_BIN_WIDTH 1048576
-#endif
+/*
+ * The histogram is log-linear: values are grouped by their order of magnitude,
+ * i.e. the position of their most significant bit, and each group is divided
+ * into HISTOGRAM_SUB_BUCKETS buckets of equal width. Group zero holds the
+ * values below HISTOGRAM_SUB_BUCKETS with a bucket width of one. Every other
+ * group covers one power of two, so the width of a bucket is at most
+ * 1/HISTOGRAM_SUB_BUCKETS of its lower bound. This bounds the relative error
+ * of percentiles, regardless of the range of the values, and adding a value
+ * never requires re-bucketing.
+ *
+ * Buckets have an exclusive lower bound and an inclusive upper bound, i.e.
+ * the bucket of a latency is determined by (latency - 1). Groups are allocated
+ * when the first value of their order of magnitude is added.
+ */
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_GROUPS (64 - HISTOGRAM_SUB_BITS + 1)
+#define HISTOGRAM_NUM_BUCKETS (HISTOGRAM_GROUPS * HISTOGRAM_SUB_BUCKETS)
 
 struct latency_counter_s {
   cdtime_t start_time;
@@ -51,67 +64,73 @@ struct latency_counter_s {
   cdtime_t min;
   cdtime_t max;
 
-  cdtime_t bin_width;
-  int histogram[HISTOGRAM_NUM_BINS];
+  uint64_t *groups[HISTOGRAM_GROUPS];
 };
 
-/*
-* Histogram represents the distribution of data, it has a list of "bins".
-* Each bin represents an interval and has a count (frequency) of
-* number of values fall within its interval.
-*
-* Histogram's range is determined by the number of bins and the bin width,
-* There are 1000 bins and all bins have the same width of default 1 millisecond.
-* When a value above this range is added, Histogram's range is increased by
-* increasing the bin width (note that number of bins remains always at 1000).
-* This operation of increasing bin width is little expensive as each bin need
-* to be visited to update it's count. To reduce frequent change of bin width,
-* new bin width will be the next nearest power of 2. Example: 2, 4, 8, 16, 32,
-* 64, 128, 256, 512, 1024, 2048, 5086, ...
-*
-* So, if the required bin width is 300, then new bin width will be 512 as it is
-* the next nearest power of 2.
-*/
-static void change_bin_width(latency_counter_t *lc, cdtime_t latency) /* {{{ */
+/* Returns the position of the most significant bit set in "v". */
+static int histogram_msb(uint64_t v) /* {{{ */
 {
-  /* This function is called because the new value is above histogram's range.
-   * First find the required bin width:
-   *           requiredBinWidth = (value + 1) / numBins
-   * then get the next nearest power of 2
-   *           newBinWidth = 2^(ceil(log2(requiredBinWidth)))
-   */
-  double required_bin_width =
-      ((double)(latency + 1)) / ((double)HISTOGRAM_NUM_BINS);
-  double required_bin_width_logbase2 = log(required_bin_width) / log(2.0);
-  cdtime_t new_bin_width =
-      (cdtime_t)(pow(2.0, ceil(required_bin_width_logbase2)) + .5);
-  cdtime_t old_bin_width = lc->bin_width;
-
-  lc->bin_width = new_bin_width;
-
-  /* bin_width has been increased, now iterate through all bins and move the
-   * old bin's count to new bin. */
-  if (lc->num > 0) // if the histogram has data then iterate else skip
-  {
-    double width_change_ratio =
-        ((double)old_bin_width) / ((double)new_bin_width);
-
-    for (size_t i = 0; i < HISTOGRAM_NUM_BINS; i++) {
-      size_t new_bin = (size_t)(((double)i) * width_change_ratio);
-      if (i == new_bin)
-        continue;
-      assert(new_bin < i);
-
-      lc->histogram[new_bin] += lc->histogram[i];
-      lc->histogram[i] = 0;
+#if defined(__GNUC__) && __GNUC__
+  return 63 - __builtin_clzll(v);
+#else
+  int msb = 0;
+
+  for (int shift = 32; shift > 0; shift /= 2) {
+    if (v >= (((uint64_t)1) << shift)) {
+      v >>= shift;
+      msb += shift;
     }
   }
 
-  DEBUG("utils_latency: change_bin_width: latency = %.3f; "
-        "old_bin_width = %.3f; new_bin_width = %.3f;",
-        CDTIME_T_TO_DOUBLE(latency), CDTIME_T_TO_DOUBLE(old_bin_width),
-        CDTIME_T_TO_DOUBLE(new_bin_width));
-} /* }}} void change_bin_width */
+  return msb;
+#endif
+} /* }}} int histogram_msb */
+
+/* Returns the index of the bucket holding "latency". Buckets are numbered
+ * consecutively, the group being index / HISTOGRAM_SUB_BUCKETS. */
+static size_t histogram_index(cdtime_t latency) /* {{{ */
+{
+  uint64_t v = (uint64_t)(latency - 1);
+
+  if (v < HISTOGRAM_SUB_BUCKETS)
+    return (size_t)v;
+
+  int msb = histogram_msb(v);
+  size_t group = (size_t)(msb - HISTOGRAM_SUB_BITS + 1);
+  size_t bucket =
+      (size_t)(v >> (msb - HISTOGRAM_SUB_BITS)) - HISTOGRAM_SUB_BUCKETS;
+
+  return group * HISTOGRAM_SUB_BUCKETS + bucket;
+} /* }}} size_t histogram_index */
+
+/* Returns the exclusive lower bound of the bucket. */
+static cdtime_t histogram_lower(size_t index) /* {{{ */
+{
+  size_t group = index / HISTOGRAM_SUB_BUCKETS;
+  size_t bucket = index % HISTOGRAM_SUB_BUCKETS;
+
+  if (group == 0)
+    return (cdtime_t)bucket;
+  return ((cdtime_t)(HISTOGRAM_SUB_BUCKETS + bucket)) << (group - 1);
+} /* }}} cdtime_t histogram_lower */
+
+static cdtime_t histogram_width(size_t index) /* {{{ */
+{
+  size_t group = index / HISTOGRAM_SUB_BUCKETS;
+
+  if (group == 0)
+    return 1;
+  return ((cdtime_t)1) << (group - 1);
+} /* }}} cdtime_t histogram_width */
+
+static uint64_t histogram_count(const latency_counter_t *lc, /* {{{ */
+                                size_t index) {
+  uint64_t const *group = lc->groups[index / HISTOGRAM_SUB_BUCKETS];
+
+  if (group == NULL)
+    return 0;
+  return group[index % HISTOGRAM_SUB_BUCKETS];
+} /* }}} uint64_t histogram_count */
 
 latency_counter_t *latency_counter_create(void) /* {{{ */
 {
@@ -121,19 +140,24 @@ latency_counter_t *latency_counter_create(void) /* {{{ */
   if (lc == NULL)
     return NULL;
 
-  lc->bin_width = HISTOGRAM_DEFAULT_BIN_WIDTH;
   latency_counter_reset(lc);
   return lc;
 } /* }}} latency_counter_t *latency_counter_create */
 
 void latency_counter_destroy(latency_counter_t *lc) /* {{{ */
 {
+  if (lc == NULL)
+    return;
+
+  for (size_t i = 0; i < HISTOGRAM_GROUPS; i++)
+    sfree(lc->groups[i]);
   sfree(lc);
 } /* }}} void latency_counter_destroy */
 
 void latency_counter_add(latency_counter_t *lc, cdtime_t latency) /* {{{ */
 {
-  cdtime_t bin;
+  size_t index;
+  uint64_t **group;
 
   if ((lc == NULL) || (latency == 0) || (latency > ((cdtime_t)LLONG_MAX)))
     return;
@@ -148,50 +172,70 @@ void latency_counter_add(latency_counter_t *lc, cdtime_t latency) /* {{{ */
   if (lc->max < latency)
     lc->max = latency;
 
-  /* A latency of _exactly_ 1.0 ms is stored in the buffer 0, so
-   * subtract one from the cdtime_t value so that exactly 1.0 ms get sorted
-   * accordingly. */
-  bin = (latency - 1) / lc->bin_width;
-  if (bin >= HISTOGRAM_NUM_BINS) {
-    change_bin_width(lc, latency);
-    bin = (latency - 1) / lc->bin_width;
-    if (bin >= HISTOGRAM_NUM_BINS) {
-      ERROR("utils_latency: latency_counter_add: Invalid bin: %" PRIu64, bin);
+  index = histogram_index(latency);
+  group = &lc->groups[index / HISTOGRAM_SUB_BUCKETS];
+  if (*group == NULL) {
+    *group = calloc(HISTOGRAM_SUB_BUCKETS, sizeof(**group));
+    if (*group == NULL) {
+      ERROR("utils_latency: latency_counter_add: calloc failed.");
       return;
     }
   }
-  lc->histogram[bin]++;
+  (*group)[index % HISTOGRAM_SUB_BUCKETS]++;
 } /* }}} void latency_counter_add */
 
+int latency_counter_merge(latency_counter_t *dst, /* {{{ */
+                          const latency_counter_t *src) {
+  if ((dst == NULL) || (src == NULL))
+    return EINVAL;
+
+  if (src->num == 0)
+    return 0;
+
+  for (size_t i = 0; i < HISTOGRAM_GROUPS; i++) {
+    if (src->groups[i] == NULL)
+      continue;
+
+    if (dst->groups[i] == NULL) {
+      dst->groups[i] = calloc(HISTOGRAM_SUB_BUCKETS, sizeof(*dst->groups[i]));
+      if (dst->groups[i] == NULL) {
+        ERROR("utils_latency: latency_counter_merge: calloc failed.");
+        return ENOMEM;
+      }
+    }
+
+    for (size_t j = 0; j < HISTOGRAM_SUB_BUCKETS; j++)
+      dst->groups[i][j] += src->groups[i][j];
+  }
+
+  if ((dst->num == 0) || (dst->min > src->min))
+    dst->min = src->min;
+  if (dst->max < src->max)
+    dst->max = src->max;
+  if (dst->start_time > src->start_time)
+    dst->start_time = src->start_time;
+
+  dst->sum += src->sum;
+  dst->num += src->num;
+
+  return 0;
+} /* }}} int latency_counter_merge */
+
 void latency_counter_reset(latency_counter_t *lc) /* {{{ */
 {
   if (lc == NULL)
     return;
 
-  cdtime_t bin_width = lc->bin_width;
-  cdtime_t max_bin = (lc->max - 1) / lc->bin_width;
-
-/*
-  If max latency is REDUCE_THRESHOLD times less than histogram's range,
-  then cut it in half. REDUCE_THRESHOLD must be >= 2.
-  Value of 4 is selected to reduce frequent changes of bin width.
-*/
-#define REDUCE_THRESHOLD 4
-  if ((lc->num > 0) && (lc->bin_width >= HISTOGRAM_DEFAULT_BIN_WIDTH * 2) &&
-      (max_bin < HISTOGRAM_NUM_BINS / REDUCE_THRESHOLD)) {
-    /* new bin width will be the previous power of 2 */
-    bin_width = bin_width / 2;
-
-    DEBUG("utils_latency: latency_counter_reset: max_latency = %.3f; "
-          "max_bin = %" PRIu64 "; old_bin_width = %.3f; new_bin_width = %.3f;",
-          CDTIME_T_TO_DOUBLE(lc->max), max_bin,
-          CDTIME_T_TO_DOUBLE(lc->bin_width), CDTIME_T_TO_DOUBLE(bin_width));
-  }
+  /* Keep the groups allocated: the same range of values is likely to be
+   * seen again in the next interval. */
+  for (size_t i = 0; i < HISTOGRAM_GROUPS; i++)
+    if (lc->groups[i] != NULL)
+      memset(lc->groups[i], 0, HISTOGRAM_SUB_BUCKETS * sizeof(*lc->groups[i]));
 
-  memset(lc, 0, sizeof(*lc));
-
-  /* preserve bin width */
-  lc->bin_width = bin_width;
+  lc->sum = 0;
+  lc->num = 0;
+  lc->min = 0;
+  lc->max = 0;
   lc->start_time = cdtime();
 } /* }}} void latency_counter_reset */
 
@@ -239,44 +283,47 @@ cdtime_t latency_counter_get_percentile(latency_counter_t *lc, /* {{{ */
   double percent_upper;
   double percent_lower;
   double p;
-  cdtime_t latency_lower;
   cdtime_t latency_interpolated;
-  int sum;
+  uint64_t sum;
   size_t i;
 
   if ((lc == NULL) || (lc->num == 0) || !((percent > 0.0) && (percent < 100.0)))
     return 0;
 
-  /* Find index i so that at least "percent" events are within i+1 ms. */
+  /* Find the bucket i so that at least "percent" events are within its upper
+   * bound. Buckets below the minimum are skipped right away. */
   percent_upper = 0.0;
   percent_lower = 0.0;
   sum = 0;
-  for (i = 0; i < HISTOGRAM_NUM_BINS; i++) {
+  for (i = histogram_index(lc->min); i < HISTOGRAM_NUM_BUCKETS; i++) {
+    uint64_t count = histogram_count(lc, i);
+    if (count == 0)
+      continue;
+
     percent_lower = percent_upper;
-    sum += lc->histogram[i];
-    if (sum == 0)
-      percent_upper = 0.0;
-    else
-      percent_upper = 100.0 * ((double)sum) / ((double)lc->num);
+    sum += count;
+    percent_upper = 100.0 * ((double)sum) / ((double)lc->num);
 
     if (percent_upper >= percent)
       break;
   }
 
-  if (i >= HISTOGRAM_NUM_BINS)
+  if (i >= HISTOGRAM_NUM_BUCKETS)
     return 0;
 
   assert(percent_upper >= percent);
   assert(percent_lower < percent);
 
-  if (i == 0)
-    return lc->bin_width;
-
-  latency_lower = ((cdtime_t)i) * lc->bin_width;
   p = (percent - percent_lower) / (percent_upper - percent_lower);
-
   latency_interpolated =
-      latency_lower + DOUBLE_TO_CDTIME_T(p * CDTIME_T_TO_DOUBLE(lc->bin_width));
+      histogram_lower(i) +
+      DOUBLE_TO_CDTIME_T(p * CDTIME_T_TO_DOUBLE(histogram_width(i)));
+
+  /* The first and last bucket are only partially used. */
+  if (latency_interpolated < lc->min)
+    latency_interpolated = lc->min;
+  if (latency_interpolated > lc->max)
+    latency_interpolated = lc->max;
 
   DEBUG("latency_counter_get_percentile: latency_interpolated = %.3f",
         CDTIME_T_TO_DOUBLE(latency_interpolated));
@@ -294,50 +341,48 @@ double latency_counter_get_rate(const latency_counter_t *lc, /* {{{ */
   if (lower == upper)
     return 0;
 
-  /* Buckets have an exclusive lower bound and an inclusive upper bound. That
-   * means that the first bucket, index 0, represents (0-bin_width]. That means
-   * that latency==bin_width needs to result in bin=0, that's why we need to
-   * subtract one before dividing by bin_width. */
-  cdtime_t lower_bin = 0;
+  /* lower is *exclusive* => determine bucket for lower+1 */
+  size_t lower_bucket = 0;
   if (lower)
-    /* lower is *exclusive* => determine bucket for lower+1 */
-    lower_bin = ((lower + 1) - 1) / lc->bin_width;
+    lower_bucket = histogram_index(lower + 1);
 
-  /* lower is greater than the longest latency observed => rate is zero. */
-  if (lower_bin >= HISTOGRAM_NUM_BINS)
-    return 0;
-
-  cdtime_t upper_bin = HISTOGRAM_NUM_BINS - 1;
-  if (upper)
-    upper_bin = (upper - 1) / lc->bin_width;
-
-  if (upper_bin >= HISTOGRAM_NUM_BINS) {
-    upper_bin = HISTOGRAM_NUM_BINS - 1;
+  size_t upper_bucket = HISTOGRAM_NUM_BUCKETS - 1;
+  if (upper && (upper <= (cdtime_t)LLONG_MAX))
+    upper_bucket = histogram_index(upper);
+  else
     upper = 0;
-  }
 
   double sum = 0;
-  for (size_t i = lower_bin; i <= upper_bin; i++)
-    sum += lc->histogram[i];
+  for (size_t i = lower_bucket; i <= upper_bucket; i++) {
+    /* skip groups which have never been used */
+    if ((i % HISTOGRAM_SUB_BUCKETS == 0) &&
+        (lc->groups[i / HISTOGRAM_SUB_BUCKETS] == NULL)) {
+      i += HISTOGRAM_SUB_BUCKETS - 1;
+      continue;
+    }
+    sum += (double)histogram_count(lc, i);
+  }
 
   if (lower) {
-    /* Approximate ratio of requests in lower_bin, that fall between
-     * lower_bin_boundary and lower. This ratio is then subtracted from sum to
-     * increase accuracy. */
-    cdtime_t lower_bin_boundary = lower_bin * lc->bin_width;
-    assert(lower >= lower_bin_boundary);
-    double lower_ratio =
-        (double)(lower - lower_bin_boundary) / ((double)lc->bin_width);
-    sum -= lower_ratio * lc->histogram[lower_bin];
+    /* Approximate ratio of requests in lower_bucket, that fall between
+     * the bucket's lower boundary and lower. This ratio is then subtracted
+     * from sum to increase accuracy. */
+    cdtime_t lower_boundary = histogram_lower(lower_bucket);
+    assert(lower >= lower_boundary);
+    double ratio = (double)(lower - lower_boundary) /
+                   (double)histogram_width(lower_bucket);
+    sum -= ratio * (double)histogram_count(lc, lower_bucket);
   }
 
   if (upper) {
-    /* As above: approximate ratio of requests in upper_bin, that fall between
-     * upper and upper_bin_boundary. */
-    cdtime_t upper_bin_boundary = (upper_bin + 1) * lc->bin_width;
-    assert(upper <= upper_bin_boundary);
-    double ratio = (double)(upper_bin_boundary - upper) / (double)lc->bin_width;
-    sum -= ratio * lc->histogram[upper_bin];
+    /* As above: approximate ratio of requests in upper_bucket, that fall
+     * between upper and the bucket's upper boundary. */
+    cdtime_t upper_boundary =
+        histogram_lower(upper_bucket) + histogram_width(upper_bucket);
+    assert(upper <= upper_boundary);
+    double ratio = (double)(upper_boundary - upper) /
+                   (double)histogram_width(upper_bucket);
+    sum -= ratio * (double)histogram_count(lc, upper_bucket);
   }
 
   return sum / (CDTIME_T_TO_DOUBLE(now - lc->start_time));
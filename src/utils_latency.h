@@ -28,8 +28,10 @@
 
 #include "utils_time.h"
 
-#ifndef HISTOGRAM_NUM_BINS
-#define HISTOGRAM_NUM_BINS 1000
+/* Each power of two is divided into 2^HISTOGRAM_SUB_BITS buckets, i.e. the
+ * width of a bucket is at most 1/64 of its lower bound by default. */
+#ifndef HISTOGRAM_SUB_BITS
+#define HISTOGRAM_SUB_BITS 6
 #endif
 
 struct latency_counter_s;
@@ -41,6 +43,10 @@ void latency_counter_destroy(latency_counter_t *lc);
 void latency_counter_add(latency_counter_t *lc, cdtime_t latency);
 void latency_counter_reset(latency_counter_t *lc);
 
+/* latency_counter_merge adds all values of "src" to "dst", e.g. to combine
+ * counters filled by different threads. */
+int latency_counter_merge(latency_counter_t *dst, const latency_counter_t *src);
+
 cdtime_t latency_counter_get_min(latency_counter_t *lc);
 cdtime_t latency_counter_get_max(latency_counter_t *lc);
 cdtime_t latency_counter_get_sum(latency_counter_t *lc);
@@ -0,0 +1,144 @@
+/**
+ * collectd - src/utils_latency_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Measures the cost of latency_counter_add() and
+ * latency_counter_get_percentile() and the error of the reported percentiles
+ * for a few typical distributions of latencies. The program only uses the
+ * public interface, so it can be linked against other implementations of
+ * utils_latency.c for comparison. Build with "make bench_utils_latency".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_latency.h"
+
+#include <math.h>
+#include <time.h>
+
+#define BENCH_VALUES 1000000
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+/* xorshift64*, for reproducible results */
+static double bench_random(void) {
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (double)((rng_state * 2685821657736338717ULL) >> 11) /
+         9007199254740992.0;
+}
+
+static double bench_normal(void) {
+  double u = bench_random();
+  double v = bench_random();
+  return sqrt(-2.0 * log(u + 1e-300)) * cos(2.0 * M_PI * v);
+}
+
+/* uniformly distributed between 1 ms and 1 s */
+static double dist_uniform(void) { return 0.001 + 0.999 * bench_random(); }
+
+/* log-normal with a median of 5 ms */
+static double dist_lognormal(void) { return 0.005 * exp(1.5 * bench_normal()); }
+
+/* 90% fast responses around 1 ms, 10% timeouts around 2 s */
+static double dist_bimodal(void) {
+  if (bench_random() < 0.9)
+    return 0.001 * (1.0 + 0.1 * bench_normal());
+  return 2.0 + 0.05 * bench_normal();
+}
+
+static struct {
+  char const *name;
+  double (*generate)(void);
+} distributions[] = {
+    {"uniform", dist_uniform},
+    {"lognormal", dist_lognormal},
+    {"bimodal", dist_bimodal},
+};
+
+static double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+/* keeps the compiler from optimizing the measured calls away */
+static volatile cdtime_t sink;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static int compare_cdtime(void const *a, void const *b) {
+  cdtime_t x = *(cdtime_t const *)a;
+  cdtime_t y = *(cdtime_t const *)b;
+  return (x > y) - (x < y);
+}
+
+int main(void) {
+  cdtime_t *values = calloc(BENCH_VALUES, sizeof(*values));
+  if (values == NULL)
+    return 1;
+
+  for (size_t d = 0; d < STATIC_ARRAY_SIZE(distributions); d++) {
+    for (size_t i = 0; i < BENCH_VALUES; i++) {
+      double v = distributions[d].generate();
+      values[i] = DOUBLE_TO_CDTIME_T((v > 1e-6) ? v : 1e-6);
+    }
+
+    latency_counter_t *lc = latency_counter_create();
+    if (lc == NULL)
+      return 1;
+
+    double start = now();
+    for (size_t i = 0; i < BENCH_VALUES; i++)
+      latency_counter_add(lc, values[i]);
+    double add_ns = 1e9 * (now() - start) / BENCH_VALUES;
+
+    size_t rounds = 1000;
+    start = now();
+    for (size_t r = 0; r < rounds; r++)
+      for (size_t p = 0; p < STATIC_ARRAY_SIZE(percentiles); p++)
+        sink = latency_counter_get_percentile(lc, percentiles[p]);
+    double percentile_ns = 1e9 * (now() - start) /
+                           (double)(rounds * STATIC_ARRAY_SIZE(percentiles));
+
+    printf("%-10s add: %6.1f ns  percentile: %8.1f ns\n",
+           distributions[d].name, add_ns, percentile_ns);
+
+    qsort(values, BENCH_VALUES, sizeof(*values), compare_cdtime);
+    for (size_t p = 0; p < STATIC_ARRAY_SIZE(percentiles); p++) {
+      size_t index = (size_t)ceil(percentiles[p] / 100.0 * BENCH_VALUES) - 1;
+      double want = CDTIME_T_TO_DOUBLE(values[index]);
+      double got =
+          CDTIME_T_TO_DOUBLE(latency_counter_get_percentile(lc, percentiles[p]));
+      printf("  p%-5g exact: %12.6f s  reported: %12.6f s  error: %8.3f%%\n",
+             percentiles[p], want, got, 100.0 * (got - want) / want);
+    }
+
+    latency_counter_destroy(lc);
+  }
+
+  free(values);
+  return 0;
+}
@@ -102,15 +102,10 @@ DEF_TEST(percentile) {
 }
 
 DEF_TEST(get_rate) {
-  /* We re-declare the struct here so we can inspect its content. */
+  /* We re-declare the beginning of the struct here so we can access the start
+   * time. */
   struct {
     cdtime_t start_time;
-    cdtime_t sum;
-    size_t num;
-    cdtime_t min;
-    cdtime_t max;
-    cdtime_t bin_width;
-    int histogram[HISTOGRAM_NUM_BINS];
   } * peek;
   latency_counter_t *l;
 
@@ -121,71 +116,47 @@ DEF_TEST(get_rate) {
     latency_counter_add(l, TIME_T_TO_CDTIME_T(i));
   }
 
-  /* We expect a bucket width of 125ms. */
-  EXPECT_EQ_UINT64(DOUBLE_TO_CDTIME_T(0.125), peek->bin_width);
-
-  struct {
-    size_t index;
-    int want;
-  } bucket_cases[] = {
-      {0, 0},  /* (0.000-0.125] */
-      {1, 0},  /* (0.125-0.250] */
-      {2, 0},  /* (0.250-0.375] */
-      {3, 0},  /* (0.375-0.500] */
-      {4, 0},  /* (0.500-0.625] */
-      {5, 0},  /* (0.625-0.750] */
-      {6, 0},  /* (0.750-0.875] */
-      {7, 1},  /* (0.875-1.000] */
-      {8, 0},  /* (1.000-1.125] */
-      {9, 0},  /* (1.125-1.250] */
-      {10, 0}, /* (1.250-1.375] */
-      {11, 0}, /* (1.375-1.500] */
-      {12, 0}, /* (1.500-1.625] */
-      {13, 0}, /* (1.625-1.750] */
-      {14, 0}, /* (1.750-1.875] */
-      {15, 1}, /* (1.875-2.000] */
-      {16, 0}, /* (2.000-2.125] */
-  };
-
-  for (size_t i = 0; i < STATIC_ARRAY_SIZE(bucket_cases); i++) {
-    size_t index = bucket_cases[i].index;
-    EXPECT_EQ_INT(bucket_cases[i].want, peek->histogram[index]);
-  }
-
+  /* Between one and two seconds buckets are 1/64 s wide, between 64 and 128
+   * seconds they are one second wide. */
   struct {
     cdtime_t lower_bound;
     cdtime_t upper_bound;
     double want;
   } cases[] = {
       {
-          // bucket 6 is zero
+          // bucket below the t=1 update is zero
           DOUBLE_TO_CDTIME_T_STATIC(0.750), DOUBLE_TO_CDTIME_T_STATIC(0.875),
           0.00,
       },
       {
-          // bucket 7 contains the t=1 update
+          // contains the t=1 update
           DOUBLE_TO_CDTIME_T_STATIC(0.875), DOUBLE_TO_CDTIME_T_STATIC(1.000),
           1.00,
       },
       {
-          // range: bucket 7 - bucket 15; contains the t=1 and t=2 updates
+          // contains the t=1 and t=2 updates
           DOUBLE_TO_CDTIME_T_STATIC(0.875), DOUBLE_TO_CDTIME_T_STATIC(2.000),
           2.00,
       },
       {
-          // lower bucket is only partially applied
-          DOUBLE_TO_CDTIME_T_STATIC(0.875 + (0.125 / 4)),
-          DOUBLE_TO_CDTIME_T_STATIC(2.000), 1.75,
+          // upper bound is within the (1.984375-2.000] bucket
+          DOUBLE_TO_CDTIME_T_STATIC(0.875),
+          DOUBLE_TO_CDTIME_T_STATIC(2.000 - (1.0 / 256.0)), 1.75,
       },
       {
-          // upper bucket is only partially applied
-          DOUBLE_TO_CDTIME_T_STATIC(0.875),
-          DOUBLE_TO_CDTIME_T_STATIC(2.000 - (0.125 / 4)), 1.75,
+          // lower bound is within the (0.9921875-1.000] bucket
+          DOUBLE_TO_CDTIME_T_STATIC(1.000 - (1.0 / 512.0)),
+          DOUBLE_TO_CDTIME_T_STATIC(2.000), 1.25,
       },
       {
           // both buckets are only partially applied
-          DOUBLE_TO_CDTIME_T_STATIC(0.875 + (0.125 / 4)),
-          DOUBLE_TO_CDTIME_T_STATIC(2.000 - (0.125 / 4)), 1.50,
+          DOUBLE_TO_CDTIME_T_STATIC(1.000 - (1.0 / 512.0)),
+          DOUBLE_TO_CDTIME_T_STATIC(2.000 - (1.0 / 256.0)), 1.00,
+      },
+      {
+          // lower and upper bound are within the same bucket
+          DOUBLE_TO_CDTIME_T_STATIC(124.250), DOUBLE_TO_CDTIME_T_STATIC(124.750),
+          0.50,
       },
       {
           // lower bound is unspecified
@@ -193,7 +164,7 @@ DEF_TEST(get_rate) {
       },
       {
           // upper bound is unspecified
-          DOUBLE_TO_CDTIME_T_STATIC(125.000 - 0.125), 0, 1.00,
+          DOUBLE_TO_CDTIME_T_STATIC(124.000), 0, 1.00,
       },
       {
           // overflow test: upper >> longest latency
@@ -225,10 +196,73 @@ DEF_TEST(get_rate) {
   return 0;
 }
 
+DEF_TEST(relative_error) {
+  latency_counter_t *l;
+
+  CHECK_NOT_NULL(l = latency_counter_create());
+
+  /* Values from one microsecond to 1000 seconds: a linear histogram with the
+   * same number of buckets could not resolve the lower percentiles. */
+  for (size_t i = 0; i < 10000; i++)
+    latency_counter_add(l, US_TO_CDTIME_T(1) << (i % 30));
+
+  for (double percent = 5.0; percent < 100.0; percent += 5.0) {
+    /* percent% of the values are below 2^(30 * percent / 100) microseconds */
+    double want = ldexp(1e-6, (int)ceil(30.0 * percent / 100.0) - 1);
+    double got = CDTIME_T_TO_DOUBLE(latency_counter_get_percentile(l, percent));
+
+    printf("# percentile %.0f: want %g, got %g\n", percent, want, got);
+    OK(fabs(got - want) <= want / 64.0);
+  }
+
+  latency_counter_destroy(l);
+  return 0;
+}
+
+DEF_TEST(merge) {
+  latency_counter_t *a;
+  latency_counter_t *b;
+  latency_counter_t *all;
+
+  CHECK_NOT_NULL(a = latency_counter_create());
+  CHECK_NOT_NULL(b = latency_counter_create());
+  CHECK_NOT_NULL(all = latency_counter_create());
+
+  for (time_t i = 1; i <= 100; i++) {
+    latency_counter_add((i % 2) ? a : b, TIME_T_TO_CDTIME_T(i));
+    latency_counter_add(all, TIME_T_TO_CDTIME_T(i));
+  }
+
+  CHECK_ZERO(latency_counter_merge(a, b));
+
+  EXPECT_EQ_INT(100, (int)latency_counter_get_num(a));
+  EXPECT_EQ_DOUBLE(1.0, CDTIME_T_TO_DOUBLE(latency_counter_get_min(a)));
+  EXPECT_EQ_DOUBLE(100.0, CDTIME_T_TO_DOUBLE(latency_counter_get_max(a)));
+  EXPECT_EQ_DOUBLE(5050.0, CDTIME_T_TO_DOUBLE(latency_counter_get_sum(a)));
+  for (double percent = 10.0; percent < 100.0; percent += 10.0)
+    EXPECT_EQ_UINT64(latency_counter_get_percentile(all, percent),
+                     latency_counter_get_percentile(a, percent));
+
+  /* merging into an empty counter copies the source */
+  latency_counter_reset(b);
+  EXPECT_EQ_INT(0, (int)latency_counter_get_num(b));
+  CHECK_ZERO(latency_counter_merge(b, a));
+  EXPECT_EQ_DOUBLE(1.0, CDTIME_T_TO_DOUBLE(latency_counter_get_min(b)));
+  EXPECT_EQ_UINT64(latency_counter_get_percentile(all, 50.0),
+                   latency_counter_get_percentile(b, 50.0));
+
+  latency_counter_destroy(a);
+  latency_counter_destroy(b);
+  latency_counter_destroy(all);
+  return 0;
+}
+
 int main(void) {
   RUN_TEST(simple);
   RUN_TEST(percentile);
   RUN_TEST(get_rate);
+  RUN_TEST(relative_error);
+  RUN_TEST(merge);
 
   END_TEST;
 }
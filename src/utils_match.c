@@ -36,17 +36,47 @@
 #define UTILS_MATCH_FLAGS_EXCLUDE_REGEX 0x02
 #define UTILS_MATCH_FLAGS_REGEX 0x04
 
+/* Longest literal used to prefilter lines, see match_required_literal(). */
+#define UTILS_MATCH_LITERAL_MAX 32
+
 struct cu_match_s {
   regex_t regex;
   regex_t excluderegex;
   int flags;
 
+  /* Strings any line matching `regex' resp. `excluderegex' must contain, or
+   * NULL if none could be determined. */
+  char *literal;
+  char *exclude_literal;
+
   int (*callback)(const char *str, char *const *matches, size_t matches_num,
                   void *user_data);
+  int (*slice_callback)(const char *str, cu_match_slice_t const *matches,
+                        size_t matches_num, void *user_data);
   void *user_data;
   void (*free)(void *user_data);
 };
 
+/* The literals of all matches of a set are searched for with a single
+ * Aho-Corasick automaton, stored as a complete transition table. Pattern
+ * `2 * i' is the literal of matches[i], `2 * i + 1' that of its exclude
+ * regex. */
+struct cu_match_set_s {
+  cu_match_t **matches;
+  size_t matches_num;
+
+  _Bool dirty;
+  int32_t *delta;        /* states_num * 256 transitions */
+  int32_t *output;       /* first pattern ending in a state, or -1 */
+  int32_t *dict;         /* next state on the suffix chain with output */
+  int32_t *pattern_next; /* next pattern with the same literal */
+  size_t states_num;
+
+  /* pattern p has been seen in the current line iff hits[p] == generation */
+  unsigned int *hits;
+  unsigned int generation;
+};
+
 /*
  * Private functions
  */
@@ -72,10 +102,23 @@ static char *match_substr(const char *str, int begin, int end) {
   return ret;
 } /* char *match_substr */
 
+/* Copies a submatch to `buffer', so that strtod(3) and friends stop at its
+ * end. Numbers don't need more than a few dozen characters. */
+static char const *match_slice_copy(cu_match_slice_t const *slice,
+                                    char *buffer, size_t buffer_size) {
+  size_t len = slice->len;
+  if (len >= buffer_size)
+    len = buffer_size - 1;
+  memcpy(buffer, slice->ptr, len);
+  buffer[len] = 0;
+  return buffer;
+} /* char const *match_slice_copy */
+
 static int default_callback(const char __attribute__((unused)) * str,
-                            char *const *matches, size_t matches_num,
-                            void *user_data) {
+                            cu_match_slice_t const *matches,
+                            size_t matches_num, void *user_data) {
   cu_match_value_t *data = (cu_match_value_t *)user_data;
+  char buffer[64];
 
   if (data->ds_type & UTILS_MATCH_DS_TYPE_GAUGE) {
     gauge_t value;
@@ -90,8 +133,10 @@ static int default_callback(const char __attribute__((unused)) * str,
     if (matches_num < 2)
       return -1;
 
-    value = (gauge_t)strtod(matches[1], &endptr);
-    if (matches[1] == endptr)
+    char const *number =
+        match_slice_copy(matches + 1, buffer, sizeof(buffer));
+    value = (gauge_t)strtod(number, &endptr);
+    if (number == endptr)
       return -1;
 
     if (data->ds_type & UTILS_MATCH_CF_GAUGE_DIST) {
@@ -134,8 +179,10 @@ static int default_callback(const char __attribute__((unused)) * str,
     if (matches_num < 2)
       return -1;
 
-    value = (counter_t)strtoull(matches[1], &endptr, 0);
-    if (matches[1] == endptr)
+    char const *number =
+        match_slice_copy(matches + 1, buffer, sizeof(buffer));
+    value = (counter_t)strtoull(number, &endptr, 0);
+    if (number == endptr)
       return -1;
 
     if (data->ds_type & UTILS_MATCH_CF_COUNTER_SET)
@@ -161,8 +208,10 @@ static int default_callback(const char __attribute__((unused)) * str,
     if (matches_num < 2)
       return -1;
 
-    value = (derive_t)strtoll(matches[1], &endptr, 0);
-    if (matches[1] == endptr)
+    char const *number =
+        match_slice_copy(matches + 1, buffer, sizeof(buffer));
+    value = (derive_t)strtoll(number, &endptr, 0);
+    if (number == endptr)
       return -1;
 
     if (data->ds_type & UTILS_MATCH_CF_DERIVE_SET)
@@ -182,8 +231,10 @@ static int default_callback(const char __attribute__((unused)) * str,
     if (matches_num < 2)
       return -1;
 
-    value = (absolute_t)strtoull(matches[1], &endptr, 0);
-    if (matches[1] == endptr)
+    char const *number =
+        match_slice_copy(matches + 1, buffer, sizeof(buffer));
+    value = (absolute_t)strtoull(number, &endptr, 0);
+    if (number == endptr)
       return -1;
 
     if (data->ds_type & UTILS_MATCH_CF_ABSOLUTE_SET)
@@ -202,6 +253,113 @@ static int default_callback(const char __attribute__((unused)) * str,
   return 0;
 } /* int default_callback */
 
+/* Returns the longest string that is part of every string matching the
+ * extended regular expression `regex', or NULL if there is none. Only literals
+ * outside of groups are considered and any top-level alternation gives up, so
+ * the result is conservative: a line not containing the literal can't match.
+ * The literal is truncated to UTILS_MATCH_LITERAL_MAX bytes, any prefix of it
+ * is required, too. */
+static char *match_required_literal(char const *regex) /* {{{ */
+{
+  char best[UTILS_MATCH_LITERAL_MAX + 1];
+  char cur[UTILS_MATCH_LITERAL_MAX + 1];
+  size_t best_len = 0;
+  size_t cur_len = 0;
+  _Bool cur_full = 0;
+  _Bool last_literal = 0;
+  int depth = 0;
+
+#define FLUSH_LITERAL                                                          \
+  do {                                                                         \
+    if (cur_len > best_len) {                                                  \
+      memcpy(best, cur, cur_len);                                              \
+      best_len = cur_len;                                                      \
+    }                                                                          \
+    cur_len = 0;                                                               \
+    cur_full = 0;                                                              \
+    last_literal = 0;                                                          \
+  } while (0)
+
+  for (char const *p = regex; *p != 0; p++) {
+    char c = *p;
+
+    if (c == '\\') {
+      p++;
+      /* GNU regex gives \w, \b, \` and friends a special meaning. */
+      if ((*p == 0) || (strchr(".[]()*+?{}|^$\\/-", *p) == NULL)) {
+        if (*p == 0)
+          break;
+        FLUSH_LITERAL;
+        continue;
+      }
+      c = *p;
+    } else if (c == '[') {
+      char const *q = p + 1;
+      if (*q == '^')
+        q++;
+      if (*q == ']')
+        q++;
+      while ((*q != 0) && (*q != ']')) {
+        if ((q[0] == '[') && (q[1] != 0) && (strchr(":.=", q[1]) != NULL)) {
+          char const *end = strchr(q + 2, q[1]);
+          if ((end == NULL) || (end[1] != ']'))
+            return NULL;
+          q = end + 1;
+        }
+        q++;
+      }
+      if (*q == 0)
+        return NULL;
+      p = q;
+      FLUSH_LITERAL;
+      continue;
+    } else if (c == '(') {
+      depth++;
+      FLUSH_LITERAL;
+      continue;
+    } else if (c == ')') {
+      depth--;
+      FLUSH_LITERAL;
+      continue;
+    } else if (c == '|') {
+      if (depth == 0)
+        return NULL;
+      continue;
+    } else if ((c == '*') || (c == '?') || (c == '{')) {
+      /* The preceding character is optional. If the literal is already
+       * full, that character has not been added in the first place. */
+      if (last_literal && !cur_full && (cur_len > 0))
+        cur_len--;
+      FLUSH_LITERAL;
+      if (c == '{') {
+        while ((p[1] != 0) && (p[0] != '}'))
+          p++;
+      }
+      continue;
+    } else if ((c == '+') || (c == '.') || (c == '^') || (c == '$')) {
+      FLUSH_LITERAL;
+      continue;
+    }
+
+    if (depth > 0)
+      continue;
+
+    if (cur_len < UTILS_MATCH_LITERAL_MAX)
+      cur[cur_len++] = c;
+    else
+      cur_full = 1;
+    last_literal = 1;
+  }
+  FLUSH_LITERAL;
+#undef FLUSH_LITERAL
+
+  if (best_len == 0)
+    return NULL;
+
+  best[best_len] = 0;
+  return strdup(best);
+} /* }}} char *match_required_literal */
+
 static void match_simple_free(void *data) {
   cu_match_value_t *user_data = (cu_match_value_t *)data;
   if (user_data->latency)
@@ -213,12 +371,14 @@ static void match_simple_free(void *data) {
 /*
  * Public functions
  */
-cu_match_t *
-match_create_callback(const char *regex, const char *excluderegex,
-                      int (*callback)(const char *str, char *const *matches,
-                                      size_t matches_num, void *user_data),
-                      void *user_data,
-                      void (*free_user_data)(void *user_data)) {
+static cu_match_t *
+match_create(const char *regex, const char *excluderegex, /* {{{ */
+             int (*callback)(const char *str, char *const *matches,
+                             size_t matches_num, void *user_data),
+             int (*slice_callback)(const char *str,
+                                   cu_match_slice_t const *matches,
+                                   size_t matches_num, void *user_data),
+             void *user_data, void (*free_user_data)(void *user_data)) {
   cu_match_t *obj;
   int status;
 
@@ -236,25 +396,49 @@ match_create_callback(const char *regex, const char *excluderegex,
     return NULL;
   }
   obj->flags |= UTILS_MATCH_FLAGS_REGEX;
+  obj->literal = match_required_literal(regex);
 
   if (excluderegex && strcmp(excluderegex, "") != 0) {
     status = regcomp(&obj->excluderegex, excluderegex, REG_EXTENDED);
     if (status != 0) {
       ERROR("Compiling the excluding regular expression \"%s\" failed.",
             excluderegex);
+      regfree(&obj->regex);
+      sfree(obj->literal);
       sfree(obj);
       return NULL;
     }
     obj->flags |= UTILS_MATCH_FLAGS_EXCLUDE_REGEX;
+    obj->exclude_literal = match_required_literal(excluderegex);
   }
 
   obj->callback = callback;
+  obj->slice_callback = slice_callback;
   obj->user_data = user_data;
   obj->free = free_user_data;
 
   return obj;
+} /* }}} cu_match_t *match_create */
+
+cu_match_t *
+match_create_callback(const char *regex, const char *excluderegex,
+                      int (*callback)(const char *str, char *const *matches,
+                                      size_t matches_num, void *user_data),
+                      void *user_data,
+                      void (*free_user_data)(void *user_data)) {
+  return match_create(regex, excluderegex, callback, NULL, user_data,
+                      free_user_data);
 } /* cu_match_t *match_create_callback */
 
+cu_match_t *match_create_slice_callback(
+    const char *regex, const char *excluderegex,
+    int (*callback)(const char *str, cu_match_slice_t const *matches,
+                    size_t matches_num, void *user_data),
+    void *user_data, void (*free_user_data)(void *user_data)) {
+  return match_create(regex, excluderegex, NULL, callback, user_data,
+                      free_user_data);
+} /* cu_match_t *match_create_slice_callback */
+
 cu_match_t *match_create_simple(const char *regex, const char *excluderegex,
                                 int match_ds_type) {
   cu_match_value_t *user_data;
@@ -275,8 +459,8 @@ cu_match_t *match_create_simple(const char *regex, const char *excluderegex,
     }
   }
 
-  obj = match_create_callback(regex, excluderegex, default_callback, user_data,
-                              match_simple_free);
+  obj = match_create_slice_callback(regex, excluderegex, default_callback,
+                                    user_data, match_simple_free);
   if (obj == NULL) {
     if (user_data->latency)
       latency_counter_destroy(user_data->latency);
@@ -310,19 +494,22 @@ void match_destroy(cu_match_t *obj) {
   if ((obj->user_data != NULL) && (obj->free != NULL))
     (*obj->free)(obj->user_data);
 
+  sfree(obj->literal);
+  sfree(obj->exclude_literal);
   sfree(obj);
 } /* void match_destroy */
 
-int match_apply(cu_match_t *obj, const char *str) {
+/* Runs the regular expressions of `obj' on `str' and calls the callback if
+ * it matches. The exclude regex is skipped unless `check_exclude' is set. */
+static int match_exec(cu_match_t *obj, const char *str, /* {{{ */
+                      _Bool check_exclude) {
   int status;
   regmatch_t re_match[32];
   char *matches[32] = {0};
+  cu_match_slice_t slices[32];
   size_t matches_num;
 
-  if ((obj == NULL) || (str == NULL))
-    return -1;
-
-  if (obj->flags & UTILS_MATCH_FLAGS_EXCLUDE_REGEX) {
+  if (check_exclude && (obj->flags & UTILS_MATCH_FLAGS_EXCLUDE_REGEX)) {
     status =
         regexec(&obj->excluderegex, str, STATIC_ARRAY_SIZE(re_match), re_match,
                 /* eflags = */ 0);
@@ -340,6 +527,22 @@ int match_apply(cu_match_t *obj, const char *str) {
   if (status != 0)
     return 0;
 
+  if (obj->slice_callback != NULL) {
+    for (matches_num = 0; matches_num < STATIC_ARRAY_SIZE(slices);
+         matches_num++) {
+      regmatch_t *m = re_match + matches_num;
+      if ((m->rm_so < 0) || (m->rm_eo < 0))
+        break;
+      slices[matches_num].ptr = str + m->rm_so;
+      slices[matches_num].len = (size_t)(m->rm_eo - m->rm_so);
+    }
+
+    status = obj->slice_callback(str, slices, matches_num, obj->user_data);
+    if (status != 0)
+      ERROR("utils_match: match_apply: callback failed.");
+    return status;
+  }
+
   for (matches_num = 0; matches_num < STATIC_ARRAY_SIZE(matches);
        matches_num++) {
     if ((re_match[matches_num].rm_so < 0) || (re_match[matches_num].rm_eo < 0))
@@ -367,6 +570,13 @@ int match_apply(cu_match_t *obj, const char *str) {
   }
 
   return status;
+} /* }}} int match_exec */
+
+int match_apply(cu_match_t *obj, const char *str) {
+  if ((obj == NULL) || (str == NULL))
+    return -1;
+
+  return match_exec(obj, str, /* check_exclude = */ 1);
 } /* int match_apply */
 
 void *match_get_user_data(cu_match_t *obj) {
@@ -374,3 +584,203 @@ void *match_get_user_data(cu_match_t *obj) {
     return NULL;
   return obj->user_data;
 } /* void *match_get_user_data */
+
+cu_match_set_t *match_set_create(void) /* {{{ */
+{
+  return calloc(1, sizeof(cu_match_set_t));
+} /* }}} cu_match_set_t *match_set_create */
+
+static void match_set_free_automaton(cu_match_set_t *set) /* {{{ */
+{
+  sfree(set->delta);
+  sfree(set->output);
+  sfree(set->dict);
+  sfree(set->pattern_next);
+  sfree(set->hits);
+  set->states_num = 0;
+} /* }}} void match_set_free_automaton */
+
+void match_set_destroy(cu_match_set_t *set) /* {{{ */
+{
+  if (set == NULL)
+    return;
+
+  match_set_free_automaton(set);
+  sfree(set->matches);
+  sfree(set);
+} /* }}} void match_set_destroy */
+
+int match_set_add(cu_match_set_t *set, cu_match_t *match) /* {{{ */
+{
+  cu_match_t **tmp;
+
+  if ((set == NULL) || (match == NULL))
+    return EINVAL;
+
+  tmp = realloc(set->matches, sizeof(*tmp) * (set->matches_num + 1));
+  if (tmp == NULL)
+    return ENOMEM;
+  set->matches = tmp;
+  set->matches[set->matches_num] = match;
+  set->matches_num++;
+
+  set->dirty = 1;
+  return 0;
+} /* }}} int match_set_add */
+
+/* Adds a state to the trie and returns its index, or -1 on failure. */
+static int32_t match_set_add_state(cu_match_set_t *set) /* {{{ */
+{
+  size_t n = set->states_num + 1;
+  int32_t *delta = realloc(set->delta, n * 256 * sizeof(*delta));
+  if (delta == NULL)
+    return -1;
+  set->delta = delta;
+
+  int32_t *output = realloc(set->output, n * sizeof(*output));
+  if (output == NULL)
+    return -1;
+  set->output = output;
+
+  for (size_t c = 0; c < 256; c++)
+    set->delta[set->states_num * 256 + c] = -1;
+  set->output[set->states_num] = -1;
+
+  return (int32_t)set->states_num++;
+} /* }}} int32_t match_set_add_state */
+
+static int match_set_add_literal(cu_match_set_t *set, /* {{{ */
+                                 char const *literal, int32_t pattern) {
+  int32_t state = 0;
+
+  for (unsigned char const *p = (unsigned char const *)literal; *p != 0;
+       p++) {
+    int32_t next = set->delta[state * 256 + *p];
+    if (next < 0) {
+      next = match_set_add_state(set);
+      if (next < 0)
+        return ENOMEM;
+      set->delta[state * 256 + *p] = next;
+    }
+    state = next;
+  }
+
+  set->pattern_next[pattern] = set->output[state];
+  set->output[state] = pattern;
+  return 0;
+} /* }}} int match_set_add_literal */
+
+static int match_set_compile(cu_match_set_t *set) /* {{{ */
+{
+  size_t patterns_num = 2 * set->matches_num;
+  int32_t *fail = NULL;
+  int32_t *queue = NULL;
+  int status = ENOMEM;
+
+  match_set_free_automaton(set);
+
+  set->pattern_next = calloc(patterns_num + 1, sizeof(*set->pattern_next));
+  set->hits = calloc(patterns_num + 1, sizeof(*set->hits));
+  if ((set->pattern_next == NULL) || (set->hits == NULL) ||
+      (match_set_add_state(set) != 0))
+    goto out;
+
+  for (size_t i = 0; i < set->matches_num; i++) {
+    cu_match_t *m = set->matches[i];
+    if ((m->literal != NULL) &&
+        (match_set_add_literal(set, m->literal, (int32_t)(2 * i)) != 0))
+      goto out;
+    if ((m->exclude_literal != NULL) &&
+        (match_set_add_literal(set, m->exclude_literal,
+                               (int32_t)(2 * i + 1)) != 0))
+      goto out;
+  }
+
+  /* Turn the trie into a complete automaton, breadth first. */
+  set->dict = malloc(set->states_num * sizeof(*set->dict));
+  fail = calloc(set->states_num, sizeof(*fail));
+  queue = malloc(set->states_num * sizeof(*queue));
+  if ((set->dict == NULL) || (fail == NULL) || (queue == NULL))
+    goto out;
+
+  size_t head = 0, tail = 0;
+  set->dict[0] = -1;
+  queue[tail++] = 0;
+  while (head < tail) {
+    int32_t s = queue[head++];
+
+    for (size_t c = 0; c < 256; c++) {
+      int32_t t = set->delta[s * 256 + c];
+
+      if (t < 0) {
+        set->delta[s * 256 + c] = (s == 0) ? 0 : set->delta[fail[s] * 256 + c];
+        continue;
+      }
+
+      fail[t] = (s == 0) ? 0 : set->delta[fail[s] * 256 + c];
+      set->dict[t] =
+          (set->output[fail[t]] >= 0) ? fail[t] : set->dict[fail[t]];
+      queue[tail++] = t;
+    }
+  }
+
+  set->generation = 0;
+  set->dirty = 0;
+  status = 0;
+
+out:
+  sfree(fail);
+  sfree(queue);
+  if (status != 0) {
+    ERROR("utils_match: match_set_compile: Out of memory.");
+    match_set_free_automaton(set);
+  }
+  return status;
+} /* }}} int match_set_compile */
+
+int match_set_apply(cu_match_set_t *set, const char *str) /* {{{ */
+{
+  int ret = 0;
+
+  if ((set == NULL) || (str == NULL))
+    return -1;
+
+  if (set->dirty) {
+    int status = match_set_compile(set);
+    if (status != 0)
+      return status;
+  }
+
+  set->generation++;
+  if (set->generation == 0) {
+    memset(set->hits, 0, 2 * set->matches_num * sizeof(*set->hits));
+    set->generation = 1;
+  }
+
+  /* Single pass over the line, recording which literals occur. */
+  int32_t state = 0;
+  for (unsigned char const *p = (unsigned char const *)str; *p != 0; p++) {
+    state = set->delta[state * 256 + *p];
+
+    int32_t s = (set->output[state] >= 0) ? state : set->dict[state];
+    for (; s >= 0; s = set->dict[s])
+      for (int32_t pat = set->output[s]; pat >= 0; pat = set->pattern_next[pat])
+        set->hits[pat] = set->generation;
+  }
+
+  for (size_t i = 0; i < set->matches_num; i++) {
+    cu_match_t *m = set->matches[i];
+
+    if ((m->literal != NULL) && (set->hits[2 * i] != set->generation))
+      continue;
+
+    _Bool check_exclude =
+        (m->exclude_literal == NULL) ||
+        (set->hits[2 * i + 1] == set->generation);
+
+    if (match_exec(m, str, check_exclude) != 0)
+      ret = -1;
+  }
+
+  return ret;
+} /* }}} int match_set_apply */
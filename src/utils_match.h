@@ -68,6 +68,17 @@
 struct cu_match_s;
 typedef struct cu_match_s cu_match_t;
 
+struct cu_match_set_s;
+typedef struct cu_match_set_s cu_match_set_t;
+
+/* A (sub-)match, pointing into the string passed to `match_apply'. Not
+ * null-terminated. */
+struct cu_match_slice_s {
+  const char *ptr;
+  size_t len;
+};
+typedef struct cu_match_slice_s cu_match_slice_t;
+
 struct cu_match_value_s {
   int ds_type;
   value_t value;
@@ -105,6 +116,21 @@ match_create_callback(const char *regex, const char *excluderegex,
                                       size_t matches_num, void *user_data),
                       void *user_data, void (*free_user_data)(void *user_data));
 
+/*
+ * NAME
+ *  match_create_slice_callback
+ *
+ * DESCRIPTION
+ *  Like `match_create_callback', but the (sub-)matches are passed to the
+ *  callback as slices of the matched string rather than as copies. `matches[0]'
+ *  is the entire match. This avoids allocating memory for every matching line.
+ */
+cu_match_t *match_create_slice_callback(
+    const char *regex, const char *excluderegex,
+    int (*callback)(const char *str, cu_match_slice_t const *matches,
+                    size_t matches_num, void *user_data),
+    void *user_data, void (*free_user_data)(void *user_data));
+
 /*
  * NAME
  *  match_create_simple
@@ -176,4 +202,46 @@ int match_apply(cu_match_t *obj, const char *str);
  */
 void *match_get_user_data(cu_match_t *obj);
 
+/*
+ * NAME
+ *  match_set_create
+ *
+ * DESCRIPTION
+ *  Creates an empty set of matches. `match_set_apply' has the same effect as
+ *  calling `match_apply' for each match of the set in turn, but scans the
+ *  string only once for literals required by the regular expressions and runs
+ *  regexec(3) only on matches which can possibly succeed.
+ *  A set must not be applied by more than one thread at a time.
+ */
+cu_match_set_t *match_set_create(void);
+
+/*
+ * NAME
+ *  match_set_destroy
+ *
+ * DESCRIPTION
+ *  Frees the set. The matches added to it are NOT destroyed.
+ */
+void match_set_destroy(cu_match_set_t *set);
+
+/*
+ * NAME
+ *  match_set_add
+ *
+ * DESCRIPTION
+ *  Appends `match' to the set. The match must stay valid as long as the set is
+ *  used. Returns zero on success, an errno value otherwise.
+ */
+int match_set_add(cu_match_set_t *set, cu_match_t *match);
+
+/*
+ * NAME
+ *  match_set_apply
+ *
+ * DESCRIPTION
+ *  Applies all matches of the set to `str', in the order they have been
+ *  added. Returns non-zero if any callback failed.
+ */
+int match_set_apply(cu_match_set_t *set, const char *str);
+
 #endif /* UTILS_MATCH_H */
@@ -0,0 +1,175 @@
+/**
+ * collectd - src/utils_match_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Measures the throughput, in lines per second, of applying the <Match>
+ * blocks of a typical tail plugin configuration for Lustre servers one by one
+ * with match_apply() versus all at once with match_set_apply().
+ *
+ * The log is read from the file given as the first argument, e.g. a recorded
+ * console log. Without argument, BENCH_LINES lines resembling a Lustre OSS
+ * console log are generated. Build with "make bench_utils_match".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_match.h"
+
+#include <time.h>
+
+#define BENCH_LINES 200000
+#define BENCH_ROUNDS 5
+
+static char const *regexes[] = {
+    "LustreError: [0-9]+:[0-9]+:\\(ldlm_lockd.c:[0-9]+\\)",
+    "lock callback timer expired after ([0-9]+)s",
+    "evicting client at ([0-9.]+)@",
+    "Connection restored to",
+    "Connection to .* was lost",
+    "Client .* reconnecting",
+    "slow creates: ([0-9]+)s",
+    "slow journal start ([0-9]+)s",
+    "slow commitrw commit ([0-9]+)s",
+    "slow brw_start ([0-9]+)s",
+    "Service thread pid ([0-9]+) was inactive for ([0-9.]+)s",
+    "Watchdog triggered for pid ([0-9]+)",
+    "recovery is timed out, evict stale exports",
+    "Recovery over after ([0-9]+):([0-9]+)",
+    "disconnecting ([0-9]+) stale clients",
+    "ost_io: This server is not able to keep up",
+    "bulk IO read error with",
+    "bulk IO write error with",
+    "client was evicted",
+    "Network is unreachable",
+    "o2iblnd: .*timed out",
+    "RDMA has too many",
+    "Skipped ([0-9]+) previous similar messages?",
+    "ldiskfs_journal_start_sb",
+    "request sent has timed out for slow reply",
+    "ptlrpc_expire_one_request",
+    "scrub .* completed",
+    "quota: .* over limit",
+    "OI scrub",
+    "MGS: Regenerating",
+    "Lustre: Mounted ([a-zA-Z0-9_-]+)",
+    "EXT4-fs error",
+};
+
+static char const *templates[] = {
+    "[%7lu.%06lu] LustreError: %lu:0:(ldlm_lockd.c:256) ### lock callback "
+    "timer expired after 101s: evicting client at 10.1.%lu.%lu@o2ib",
+    "[%7lu.%06lu] Lustre: fs0-OST00%02lu: Client 7c1%lux (at 10.1.0.%lu@o2ib) "
+    "reconnecting",
+    "[%7lu.%06lu] Lustre: fs0-OST00%02lu: Connection restored to %lu "
+    "(at 10.1.0.%lu@o2ib)",
+    "[%7lu.%06lu] Lustre: %lu:0:(service.c:1339) Skipped %lu previous "
+    "similar messages (%lu)",
+    "[%7lu.%06lu] Lustre: fs0-OST00%02lu: slow creates: %lus due to heavy IO "
+    "load (%lu)",
+    "[%7lu.%06lu] md: md%lu: resync done, %lu blocks (%lu)",
+    "[%7lu.%06lu] sd %lu:0:0:0: [sdb] Synchronizing SCSI cache %lu %lu",
+    "[%7lu.%06lu] systemd[%lu]: Started Session %lu of user root (%lu).",
+};
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static char **read_lines(char const *path, size_t *lines_num) {
+  char buffer[4096];
+  size_t num = 0;
+  char **lines = calloc(BENCH_LINES, sizeof(*lines));
+  if (lines == NULL)
+    return NULL;
+
+  if (path == NULL) {
+    for (num = 0; num < BENCH_LINES; num++) {
+      unsigned long r = (unsigned long)random();
+      /* mostly noise, like a real console log */
+      char const *t = templates[(r % 4 == 0) ? (r / 4) % 5
+                                             : 5 + (r / 4) % 3];
+      snprintf(buffer, sizeof(buffer), t, num / 100, (num % 100) * 10000,
+               r % 32, r % 1000, r % 251);
+      lines[num] = strdup(buffer);
+    }
+    *lines_num = num;
+    return lines;
+  }
+
+  FILE *fh = fopen(path, "r");
+  if (fh == NULL)
+    return NULL;
+  while ((num < BENCH_LINES) && (fgets(buffer, sizeof(buffer), fh) != NULL))
+    lines[num++] = strdup(buffer);
+  fclose(fh);
+
+  *lines_num = num;
+  return lines;
+}
+
+int main(int argc, char **argv) {
+  cu_match_t *matches[STATIC_ARRAY_SIZE(regexes)];
+  size_t lines_num = 0;
+  char **lines = read_lines((argc > 1) ? argv[1] : NULL, &lines_num);
+  if ((lines == NULL) || (lines_num == 0))
+    return 1;
+
+  cu_match_set_t *set = match_set_create();
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(regexes); i++) {
+    matches[i] = match_create_simple(regexes[i], NULL,
+                                     UTILS_MATCH_DS_TYPE_DERIVE |
+                                         UTILS_MATCH_CF_DERIVE_INC);
+    if ((matches[i] == NULL) || (match_set_add(set, matches[i]) != 0))
+      return 1;
+  }
+
+  double start = cpu_time();
+  for (size_t r = 0; r < BENCH_ROUNDS; r++)
+    for (size_t i = 0; i < lines_num; i++)
+      for (size_t j = 0; j < STATIC_ARRAY_SIZE(matches); j++)
+        match_apply(matches[j], lines[i]);
+  double single = cpu_time() - start;
+
+  start = cpu_time();
+  for (size_t r = 0; r < BENCH_ROUNDS; r++)
+    for (size_t i = 0; i < lines_num; i++)
+      match_set_apply(set, lines[i]);
+  double combined = cpu_time() - start;
+
+  double total = (double)(BENCH_ROUNDS * lines_num);
+  printf("%zu matches, %zu lines\n", STATIC_ARRAY_SIZE(matches), lines_num);
+  printf("match_apply:     %10.0f lines/s\n", total / single);
+  printf("match_set_apply: %10.0f lines/s (%.1fx)\n", total / combined,
+         single / combined);
+
+  match_set_destroy(set);
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(matches); i++)
+    match_destroy(matches[i]);
+  for (size_t i = 0; i < lines_num; i++)
+    free(lines[i]);
+  free(lines);
+  return 0;
+}
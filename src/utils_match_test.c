@@ -0,0 +1,155 @@
+/**
+ * collectd - src/utils_match_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "testing.h"
+#include "utils_match.h"
+
+static char const *lines[] = {
+    "LustreError: 1234:0:(ldlm_lockd.c:256) ### lock callback timer expired",
+    "Lustre: fs0-OST0001: Connection restored to 10.0.0.1@o2ib",
+    "color: red, colour: blue",
+    "fobar fooobar foo.bar",
+    "aab ab aaab",
+    "warning: 42 slow requests",
+    "error: 7 failed",
+    "abc",
+    "xyz",
+    "took 150ms",
+    "kernel.log rotated",
+    "",
+    "a line without anything of interest",
+    "ac abc abbbc",
+    "Lustre: fs0-OST0002: started",
+    "error: disk full",
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab",
+};
+
+static struct {
+  char const *regex;
+  char const *exclude;
+} regexes[] = {
+    {"LustreError", NULL},
+    {"Connection restored to ([0-9.]+)@", NULL},
+    {"fo+bar", NULL},
+    {"colou?r", NULL},
+    {"a{2}b", NULL},
+    {"(error|warn)ing: ([0-9]+)", NULL},
+    {"^abc$", NULL},
+    {"x|y", NULL},
+    {"[[:digit:]]+ms", NULL},
+    {"[]a]b", NULL},
+    {"\\.log", NULL},
+    {"ab*c", NULL},
+    {"fs0-OST[0-9]+", "restored"},
+    {"error", "fail(ed)?"},
+    {"foo\\.bar", "o{3}"},
+    {"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa?b", NULL},
+    {".*", "interest"},
+};
+
+DEF_TEST(match_set) {
+  cu_match_t *single[STATIC_ARRAY_SIZE(regexes)];
+  cu_match_t *in_set[STATIC_ARRAY_SIZE(regexes)];
+  cu_match_set_t *set;
+
+  CHECK_NOT_NULL(set = match_set_create());
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(regexes); i++) {
+    int ds_type = UTILS_MATCH_DS_TYPE_DERIVE | UTILS_MATCH_CF_DERIVE_INC;
+    CHECK_NOT_NULL(single[i] = match_create_simple(
+                       regexes[i].regex, regexes[i].exclude, ds_type));
+    CHECK_NOT_NULL(in_set[i] = match_create_simple(
+                       regexes[i].regex, regexes[i].exclude, ds_type));
+    CHECK_ZERO(match_set_add(set, in_set[i]));
+  }
+
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(lines); i++) {
+    for (size_t j = 0; j < STATIC_ARRAY_SIZE(regexes); j++)
+      CHECK_ZERO(match_apply(single[j], lines[i]));
+    CHECK_ZERO(match_set_apply(set, lines[i]));
+  }
+
+  /* the set must count exactly the same lines as the individual matches */
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(regexes); i++) {
+    cu_match_value_t *want = match_get_user_data(single[i]);
+    cu_match_value_t *got = match_get_user_data(in_set[i]);
+    EXPECT_EQ_INT(want->value.derive, got->value.derive);
+  }
+
+  match_set_destroy(set);
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(regexes); i++) {
+    match_destroy(single[i]);
+    match_destroy(in_set[i]);
+  }
+  return 0;
+}
+
+static int slice_callback(const char *str, cu_match_slice_t const *matches,
+                          size_t matches_num, void *user_data) {
+  int *calls = user_data;
+
+  EXPECT_EQ_INT(3, matches_num);
+  OK(matches[0].ptr == str + 5);
+  EXPECT_EQ_INT(14, matches[0].len);
+  OK(strncmp("read", matches[1].ptr, matches[1].len) == 0);
+  EXPECT_EQ_INT(4, matches[1].len);
+  OK(strncmp("4096", matches[2].ptr, matches[2].len) == 0);
+  EXPECT_EQ_INT(4, matches[2].len);
+
+  (*calls)++;
+  return 0;
+}
+
+DEF_TEST(slices) {
+  int calls = 0;
+  cu_match_t *m;
+
+  CHECK_NOT_NULL(m = match_create_slice_callback(
+                     "op=([a-z]+) n=([0-9]+)", NULL, slice_callback, &calls,
+                     /* free_user_data = */ NULL));
+  CHECK_ZERO(match_apply(m, "pid: op=read n=4096 done"));
+  CHECK_ZERO(match_apply(m, "no match here"));
+  EXPECT_EQ_INT(1, calls);
+  match_destroy(m);
+
+  /* the submatch ends before the following digits */
+  CHECK_NOT_NULL(
+      m = match_create_simple("value=([0-9]+)x", NULL,
+                              UTILS_MATCH_DS_TYPE_GAUGE |
+                                  UTILS_MATCH_CF_GAUGE_LAST));
+  CHECK_ZERO(match_apply(m, "value=12x34"));
+  EXPECT_EQ_DOUBLE(12.0, ((cu_match_value_t *)match_get_user_data(m))
+                             ->value.gauge);
+  match_destroy(m);
+
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(match_set);
+  RUN_TEST(slices);
+
+  END_TEST;
+}
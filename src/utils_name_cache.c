@@ -0,0 +1,294 @@
+/**
+ * collectd - src/utils_name_cache.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "plugin.h"
+#include "utils_name_cache.h"
+
+#define NC_FIELDS_NUM 5
+
+/* Entries are chained into a hash table and into a doubly linked list in
+ * order of use, most recent first. "data" holds the fields of the identity,
+ * each followed by its terminating null byte, and then the name. */
+struct nc_entry_s;
+typedef struct nc_entry_s nc_entry_t;
+struct nc_entry_s {
+  uint32_t hash;
+  size_t ds_index;
+  nc_entry_t *chain;
+
+  nc_entry_t *prev;
+  nc_entry_t *next;
+
+  char *name;
+  size_t name_len;
+  char data[];
+};
+
+struct name_cache_s {
+  pthread_mutex_t lock;
+
+  nc_entry_t **buckets;
+  size_t buckets_num;
+  size_t entries_num;
+  size_t max_entries;
+
+  nc_entry_t *head;
+  nc_entry_t *tail;
+};
+
+static void nc_fields(value_list_t const *vl, /* {{{ */
+                      char const *fields[NC_FIELDS_NUM]) {
+  fields[0] = vl->host;
+  fields[1] = vl->plugin;
+  fields[2] = vl->plugin_instance;
+  fields[3] = vl->type;
+  fields[4] = vl->type_instance;
+} /* }}} void nc_fields */
+
+/* FNV-1a over all fields including their null bytes, so that "ab" + "c" and
+ * "a" + "bc" differ. */
+static uint32_t nc_hash(char const *fields[NC_FIELDS_NUM], /* {{{ */
+                        size_t ds_index) {
+  uint32_t hash = 2166136261U;
+
+  for (size_t i = 0; i < NC_FIELDS_NUM; i++) {
+    char const *ptr = fields[i];
+    do {
+      hash ^= (uint32_t)(unsigned char)*ptr;
+      hash *= 16777619U;
+    } while (*(ptr++) != 0);
+  }
+
+  hash ^= (uint32_t)ds_index;
+  hash *= 16777619U;
+  return hash;
+} /* }}} uint32_t nc_hash */
+
+static _Bool nc_entry_match(nc_entry_t const *e, /* {{{ */
+                            char const *fields[NC_FIELDS_NUM], uint32_t hash,
+                            size_t ds_index) {
+  char const *ptr = e->data;
+
+  if ((e->hash != hash) || (e->ds_index != ds_index))
+    return 0;
+
+  for (size_t i = 0; i < NC_FIELDS_NUM; i++) {
+    size_t len = strlen(fields[i]) + 1;
+    if (memcmp(ptr, fields[i], len) != 0)
+      return 0;
+    ptr += len;
+  }
+
+  return 1;
+} /* }}} _Bool nc_entry_match */
+
+/* Returns the link pointing to the matching entry, or to the NULL pointer at
+ * the end of the bucket if there is none. */
+static nc_entry_t **nc_find(name_cache_t *nc, /* {{{ */
+                            char const *fields[NC_FIELDS_NUM], uint32_t hash,
+                            size_t ds_index) {
+  nc_entry_t **link = nc->buckets + (hash & (nc->buckets_num - 1));
+
+  while ((*link != NULL) && !nc_entry_match(*link, fields, hash, ds_index))
+    link = &(*link)->chain;
+
+  return link;
+} /* }}} nc_entry_t **nc_find */
+
+static void nc_list_unlink(name_cache_t *nc, nc_entry_t *e) /* {{{ */
+{
+  if (e->prev != NULL)
+    e->prev->next = e->next;
+  else
+    nc->head = e->next;
+
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  else
+    nc->tail = e->prev;
+
+  e->prev = e->next = NULL;
+} /* }}} void nc_list_unlink */
+
+static void nc_list_push(name_cache_t *nc, nc_entry_t *e) /* {{{ */
+{
+  e->prev = NULL;
+  e->next = nc->head;
+  if (nc->head != NULL)
+    nc->head->prev = e;
+  else
+    nc->tail = e;
+  nc->head = e;
+} /* }}} void nc_list_push */
+
+/* Removes "e", which "*link" points to, from the cache and frees it. */
+static void nc_remove(name_cache_t *nc, nc_entry_t **link) /* {{{ */
+{
+  nc_entry_t *e = *link;
+
+  *link = e->chain;
+  nc_list_unlink(nc, e);
+  nc->entries_num--;
+  sfree(e);
+} /* }}} void nc_remove */
+
+static void nc_evict(name_cache_t *nc) /* {{{ */
+{
+  nc_entry_t *e = nc->tail;
+  nc_entry_t **link = nc->buckets + (e->hash & (nc->buckets_num - 1));
+
+  while (*link != e)
+    link = &(*link)->chain;
+
+  nc_remove(nc, link);
+} /* }}} void nc_evict */
+
+name_cache_t *name_cache_create(size_t max_entries) /* {{{ */
+{
+  name_cache_t *nc;
+
+  if (max_entries == 0)
+    return NULL;
+
+  nc = calloc(1, sizeof(*nc));
+  if (nc == NULL)
+    return NULL;
+
+  /* A power of two at least as large as the cache keeps the chains short. */
+  nc->buckets_num = 16;
+  while (nc->buckets_num < max_entries)
+    nc->buckets_num *= 2;
+
+  nc->buckets = calloc(nc->buckets_num, sizeof(*nc->buckets));
+  if (nc->buckets == NULL) {
+    sfree(nc);
+    return NULL;
+  }
+
+  nc->max_entries = max_entries;
+  pthread_mutex_init(&nc->lock, /* attr = */ NULL);
+  return nc;
+} /* }}} name_cache_t *name_cache_create */
+
+void name_cache_destroy(name_cache_t *nc) /* {{{ */
+{
+  if (nc == NULL)
+    return;
+
+  while (nc->head != NULL) {
+    nc_entry_t *e = nc->head;
+    nc->head = e->next;
+    sfree(e);
+  }
+
+  pthread_mutex_destroy(&nc->lock);
+  sfree(nc->buckets);
+  sfree(nc);
+} /* }}} void name_cache_destroy */
+
+int name_cache_get(name_cache_t *nc, value_list_t const *vl, /* {{{ */
+                   size_t ds_index, char *buffer, size_t buffer_size) {
+  char const *fields[NC_FIELDS_NUM];
+  int status;
+
+  if ((nc == NULL) || (vl == NULL) || (buffer == NULL))
+    return -EINVAL;
+
+  nc_fields(vl, fields);
+  uint32_t hash = nc_hash(fields, ds_index);
+
+  pthread_mutex_lock(&nc->lock);
+
+  nc_entry_t *e = *nc_find(nc, fields, hash, ds_index);
+  if (e == NULL) {
+    status = -ENOENT;
+  } else if (e->name_len >= buffer_size) {
+    status = -ENOMEM;
+  } else {
+    memcpy(buffer, e->name, e->name_len + 1);
+    status = (int)e->name_len;
+
+    if (nc->head != e) {
+      nc_list_unlink(nc, e);
+      nc_list_push(nc, e);
+    }
+  }
+
+  pthread_mutex_unlock(&nc->lock);
+  return status;
+} /* }}} int name_cache_get */
+
+int name_cache_put(name_cache_t *nc, value_list_t const *vl, /* {{{ */
+                   size_t ds_index, char const *name, size_t name_len) {
+  char const *fields[NC_FIELDS_NUM];
+  size_t fields_len[NC_FIELDS_NUM];
+  size_t size = 0;
+
+  if ((nc == NULL) || (vl == NULL) || (name == NULL) || (name_len > INT_MAX))
+    return EINVAL;
+
+  nc_fields(vl, fields);
+  for (size_t i = 0; i < NC_FIELDS_NUM; i++) {
+    fields_len[i] = strlen(fields[i]) + 1;
+    size += fields_len[i];
+  }
+
+  nc_entry_t *e = malloc(sizeof(*e) + size + name_len + 1);
+  if (e == NULL)
+    return ENOMEM;
+
+  e->hash = nc_hash(fields, ds_index);
+  e->ds_index = ds_index;
+  e->prev = e->next = NULL;
+
+  char *ptr = e->data;
+  for (size_t i = 0; i < NC_FIELDS_NUM; i++) {
+    memcpy(ptr, fields[i], fields_len[i]);
+    ptr += fields_len[i];
+  }
+  e->name = ptr;
+  e->name_len = name_len;
+  memcpy(e->name, name, name_len);
+  e->name[name_len] = 0;
+
+  pthread_mutex_lock(&nc->lock);
+
+  nc_entry_t **link = nc_find(nc, fields, e->hash, ds_index);
+  if (*link != NULL)
+    nc_remove(nc, link);
+  else if (nc->entries_num >= nc->max_entries)
+    nc_evict(nc);
+
+  /* Eviction may have changed the chain, so insert at the bucket's head. */
+  link = nc->buckets + (e->hash & (nc->buckets_num - 1));
+  e->chain = *link;
+  *link = e;
+  nc_list_push(nc, e);
+  nc->entries_num++;
+
+  pthread_mutex_unlock(&nc->lock);
+  return 0;
+} /* }}} int name_cache_put */
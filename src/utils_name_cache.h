@@ -0,0 +1,61 @@
+/**
+ * collectd - src/utils_name_cache.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_NAME_CACHE_H
+#define UTILS_NAME_CACHE_H 1
+
+#include "collectd.h"
+
+#include "plugin.h"
+
+/* A name cache maps the identity of a series, i.e. host, plugin, plugin
+ * instance, type and type instance of a value list plus the index of the data
+ * source, to the metric name a write plugin formatted and escaped for it.
+ * Since that name never changes for a series, writers only need to build it
+ * the first time they see the series. The cache holds at most "max_entries"
+ * names and evicts the least recently used one when full.
+ *
+ * Names depend on the writer's options, so each writer needs its own cache.
+ * A name cache is safe to use from multiple threads. */
+struct name_cache_s;
+typedef struct name_cache_s name_cache_t;
+
+#ifndef NAME_CACHE_DEFAULT_SIZE
+#define NAME_CACHE_DEFAULT_SIZE 16384
+#endif
+
+name_cache_t *name_cache_create(size_t max_entries);
+void name_cache_destroy(name_cache_t *nc);
+
+/* name_cache_get copies the name stored for "ds_index" of "vl" to "buffer".
+ * Returns the length of the name, -ENOENT if it is not cached, or -ENOMEM if
+ * "buffer" is too small. */
+int name_cache_get(name_cache_t *nc, value_list_t const *vl, size_t ds_index,
+                   char *buffer, size_t buffer_size);
+
+/* name_cache_put stores a copy of the first "name_len" bytes of "name" for
+ * "ds_index" of "vl", replacing any previous entry. */
+int name_cache_put(name_cache_t *nc, value_list_t const *vl, size_t ds_index,
+                   char const *name, size_t name_len);
+
+#endif /* UTILS_NAME_CACHE_H */
@@ -0,0 +1,127 @@
+/**
+ * collectd - src/utils_name_cache_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "testing.h"
+#include "utils_name_cache.h"
+
+static value_list_t make_vl(char const *plugin, char const *plugin_instance) {
+  value_list_t vl = {
+      .host = "example.com", .type = "gauge",
+  };
+
+  sstrncpy(vl.plugin, plugin, sizeof(vl.plugin));
+  sstrncpy(vl.plugin_instance, plugin_instance, sizeof(vl.plugin_instance));
+  return vl;
+}
+
+static int put(name_cache_t *nc, value_list_t const *vl, size_t ds_index,
+               char const *name) {
+  return name_cache_put(nc, vl, ds_index, name, strlen(name));
+}
+
+DEF_TEST(get_put) {
+  name_cache_t *nc;
+  char buffer[64];
+
+  CHECK_NOT_NULL(nc = name_cache_create(16));
+
+  value_list_t vl = make_vl("cpu", "0");
+  EXPECT_EQ_INT(-ENOENT, name_cache_get(nc, &vl, 0, buffer, sizeof(buffer)));
+
+  CHECK_ZERO(put(nc, &vl, 0, "example_com.cpu-0.gauge"));
+  EXPECT_EQ_INT(23, name_cache_get(nc, &vl, 0, buffer, sizeof(buffer)));
+  EXPECT_EQ_STR("example_com.cpu-0.gauge", buffer);
+
+  /* Other data sources of the same series are separate entries. */
+  EXPECT_EQ_INT(-ENOENT, name_cache_get(nc, &vl, 1, buffer, sizeof(buffer)));
+
+  /* The name and its null byte must fit. */
+  EXPECT_EQ_INT(-ENOMEM, name_cache_get(nc, &vl, 0, buffer, 23));
+  EXPECT_EQ_INT(23, name_cache_get(nc, &vl, 0, buffer, 24));
+
+  /* Replacing an entry. */
+  CHECK_ZERO(put(nc, &vl, 0, "renamed"));
+  EXPECT_EQ_INT(7, name_cache_get(nc, &vl, 0, buffer, sizeof(buffer)));
+  EXPECT_EQ_STR("renamed", buffer);
+
+  /* Fields are compared separately, not concatenated. */
+  value_list_t vl_ab = make_vl("ab", "c");
+  value_list_t vl_a = make_vl("a", "bc");
+  CHECK_ZERO(put(nc, &vl_ab, 0, "ab-c"));
+  EXPECT_EQ_INT(-ENOENT, name_cache_get(nc, &vl_a, 0, buffer, sizeof(buffer)));
+  CHECK_ZERO(put(nc, &vl_a, 0, "a-bc"));
+  EXPECT_EQ_INT(4, name_cache_get(nc, &vl_ab, 0, buffer, sizeof(buffer)));
+  EXPECT_EQ_STR("ab-c", buffer);
+  EXPECT_EQ_INT(4, name_cache_get(nc, &vl_a, 0, buffer, sizeof(buffer)));
+  EXPECT_EQ_STR("a-bc", buffer);
+
+  name_cache_destroy(nc);
+  return 0;
+}
+
+DEF_TEST(lru) {
+  name_cache_t *nc;
+  char buffer[64];
+
+  CHECK_NOT_NULL(nc = name_cache_create(2));
+
+  value_list_t one = make_vl("one", "");
+  value_list_t two = make_vl("two", "");
+  value_list_t three = make_vl("three", "");
+
+  CHECK_ZERO(put(nc, &one, 0, "one"));
+  CHECK_ZERO(put(nc, &two, 0, "two"));
+
+  /* Using "one" makes "two" the least recently used entry. */
+  EXPECT_EQ_INT(3, name_cache_get(nc, &one, 0, buffer, sizeof(buffer)));
+  CHECK_ZERO(put(nc, &three, 0, "three"));
+
+  EXPECT_EQ_INT(3, name_cache_get(nc, &one, 0, buffer, sizeof(buffer)));
+  EXPECT_EQ_INT(-ENOENT, name_cache_get(nc, &two, 0, buffer, sizeof(buffer)));
+  EXPECT_EQ_INT(5, name_cache_get(nc, &three, 0, buffer, sizeof(buffer)));
+
+  /* Many more series than entries. */
+  for (size_t i = 0; i < 1000; i++) {
+    char name[16];
+    ssnprintf(name, sizeof(name), "%zu", i);
+    value_list_t vl = make_vl("many", name);
+    CHECK_ZERO(put(nc, &vl, 0, name));
+    EXPECT_EQ_INT((int)strlen(name),
+                  name_cache_get(nc, &vl, 0, buffer, sizeof(buffer)));
+    EXPECT_EQ_STR(name, buffer);
+  }
+  EXPECT_EQ_INT(-ENOENT, name_cache_get(nc, &one, 0, buffer, sizeof(buffer)));
+
+  name_cache_destroy(nc);
+  return 0;
+}
+
+int main(void) {
+  RUN_TEST(get_put);
+  RUN_TEST(lru);
+
+  END_TEST;
+}
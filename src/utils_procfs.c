@@ -0,0 +1,202 @@
+/**
+ * collectd - src/utils_procfs.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_procfs.h"
+
+#ifndef PROCFS_INITIAL_BUFFER_SIZE
+#define PROCFS_INITIAL_BUFFER_SIZE 4096
+#endif
+
+/* Upper bound for the buffer, to protect against files which never end. */
+#ifndef PROCFS_MAX_BUFFER_SIZE
+#define PROCFS_MAX_BUFFER_SIZE (1024 * 1024 * 1024)
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+struct procfs_file_s {
+  char *path;
+  int fd;
+
+  char *buffer;
+  size_t buffer_size;
+  size_t data_size;
+
+  /* beginning of the next line returned by procfs_getline */
+  char *next_line;
+};
+
+procfs_file_t *procfs_open(char const *path) /* {{{ */
+{
+  procfs_file_t *pf = calloc(1, sizeof(*pf));
+  if (pf == NULL)
+    return NULL;
+
+  pf->path = strdup(path);
+  pf->buffer = malloc(PROCFS_INITIAL_BUFFER_SIZE);
+  if ((pf->path == NULL) || (pf->buffer == NULL)) {
+    procfs_close(pf);
+    errno = ENOMEM;
+    return NULL;
+  }
+  pf->buffer_size = PROCFS_INITIAL_BUFFER_SIZE;
+  pf->buffer[0] = 0;
+
+  pf->fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (pf->fd < 0) {
+    int status = errno;
+    pf->fd = -1;
+    procfs_close(pf);
+    errno = status;
+    return NULL;
+  }
+
+  return pf;
+} /* }}} procfs_file_t *procfs_open */
+
+void procfs_close(procfs_file_t *pf) /* {{{ */
+{
+  if (pf == NULL)
+    return;
+
+  if (pf->fd >= 0)
+    close(pf->fd);
+  sfree(pf->path);
+  sfree(pf->buffer);
+  sfree(pf);
+} /* }}} void procfs_close */
+
+char const *procfs_path(procfs_file_t const *pf) /* {{{ */
+{
+  return (pf != NULL) ? pf->path : NULL;
+} /* }}} char const *procfs_path */
+
+static ssize_t procfs_read_fd(procfs_file_t *pf) /* {{{ */
+{
+  size_t offset = 0;
+
+  while (42) {
+    /* keep one byte for the terminating null byte */
+    if (offset + 1 >= pf->buffer_size) {
+      if (pf->buffer_size >= PROCFS_MAX_BUFFER_SIZE)
+        return -EFBIG;
+
+      char *tmp = realloc(pf->buffer, 2 * pf->buffer_size);
+      if (tmp == NULL)
+        return -ENOMEM;
+      pf->buffer = tmp;
+      pf->buffer_size *= 2;
+    }
+
+    ssize_t status = pread(pf->fd, pf->buffer + offset,
+                           pf->buffer_size - offset - 1, (off_t)offset);
+    if (status < 0) {
+      if (errno == EINTR)
+        continue;
+      return -errno;
+    } else if (status == 0) {
+      break;
+    }
+
+    offset += (size_t)status;
+  }
+
+  pf->buffer[offset] = 0;
+  pf->data_size = offset;
+  pf->next_line = pf->buffer;
+
+  return (ssize_t)offset;
+} /* }}} ssize_t procfs_read_fd */
+
+ssize_t procfs_read(procfs_file_t *pf) /* {{{ */
+{
+  if (pf == NULL)
+    return -EINVAL;
+
+  pf->data_size = 0;
+  pf->buffer[0] = 0;
+  pf->next_line = NULL;
+
+  ssize_t status = -EBADF;
+  if (pf->fd >= 0) {
+    status = procfs_read_fd(pf);
+    if (status >= 0)
+      return status;
+  }
+
+  /* The file may have been removed and created again, e.g. when a device
+   * was re-attached. Try once with a new file descriptor. */
+  if (pf->fd >= 0)
+    close(pf->fd);
+  pf->fd = open(pf->path, O_RDONLY | O_CLOEXEC);
+  if (pf->fd < 0) {
+    status = -errno;
+    pf->fd = -1;
+    return status;
+  }
+
+  return procfs_read_fd(pf);
+} /* }}} ssize_t procfs_read */
+
+char *procfs_data(procfs_file_t *pf) /* {{{ */
+{
+  return (pf != NULL) ? pf->buffer : NULL;
+} /* }}} char *procfs_data */
+
+char *procfs_getline(procfs_file_t *pf) /* {{{ */
+{
+  if ((pf == NULL) || (pf->next_line == NULL))
+    return NULL;
+
+  char *line = pf->next_line;
+  char *end = pf->buffer + pf->data_size;
+  if (line >= end) {
+    pf->next_line = NULL;
+    return NULL;
+  }
+
+  char *newline = memchr(line, '\n', (size_t)(end - line));
+  if (newline == NULL) {
+    /* last line without a newline */
+    pf->next_line = NULL;
+  } else {
+    *newline = 0;
+    pf->next_line = newline + 1;
+  }
+
+  return line;
+} /* }}} char *procfs_getline */
+
+int procfs_getfields(procfs_file_t *pf, char **fields, /* {{{ */
+                     size_t size) {
+  char *line = procfs_getline(pf);
+  if (line == NULL)
+    return -1;
+
+  return strsplit(line, fields, size);
+} /* }}} int procfs_getfields */
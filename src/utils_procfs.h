@@ -0,0 +1,67 @@
+/**
+ * collectd - src/utils_procfs.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_PROCFS_H
+#define UTILS_PROCFS_H 1
+
+#include "collectd.h"
+
+/* A procfs_file_t keeps a file in /proc or /sys open across reads. Reading
+ * the file from offset zero with pread(2) makes the kernel generate its
+ * content anew, so the file is opened once and then re-read in every
+ * interval into a buffer which is reused and grows as needed.
+ *
+ * The content can be walked line by line without copying; lines are
+ * null-terminated in place and may be modified by the caller, e.g. split with
+ * strsplit(). A procfs_file_t must not be used by multiple threads at the
+ * same time. */
+struct procfs_file_s;
+typedef struct procfs_file_s procfs_file_t;
+
+/* procfs_open opens "path". Returns NULL and sets errno on failure. */
+procfs_file_t *procfs_open(char const *path);
+void procfs_close(procfs_file_t *pf);
+
+char const *procfs_path(procfs_file_t const *pf);
+
+/* procfs_read reads the current content of the file and rewinds the line
+ * iterator. If reading fails, e.g. because the file was removed and created
+ * again, the file is reopened once. Returns the size of the content or a
+ * negative errno value. */
+ssize_t procfs_read(procfs_file_t *pf);
+
+/* procfs_data returns the content read by the last procfs_read(),
+ * null-terminated. */
+char *procfs_data(procfs_file_t *pf);
+
+/* procfs_getline returns the next line of the content, without the newline
+ * character, or NULL if all lines have been returned. */
+char *procfs_getline(procfs_file_t *pf);
+
+/* procfs_getfields splits the next line at white space, like strsplit(), and
+ * stores pointers to up to "size" fields in "fields". Returns the number of
+ * fields, which may be zero for empty lines, or -1 if all lines have been
+ * returned. */
+int procfs_getfields(procfs_file_t *pf, char **fields, size_t size);
+
+#endif /* UTILS_PROCFS_H */
@@ -0,0 +1,130 @@
+/**
+ * collectd - src/utils_procfs_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Compares reading the files used by the cpu, memory, interface, disk and
+ * load plugins with fopen()/fgets()/fclose() in every interval against
+ * re-reading them through a procfs_file_t. Reports the CPU time and the
+ * number of read system calls per iteration, the latter taken from
+ * /proc/self/io. Build with "make bench_utils_procfs".
+ */
+
+#include "collectd.h"
+
+#include "common.h"
+#include "utils_procfs.h"
+
+#include <time.h>
+
+#define BENCH_ITERATIONS 20000
+
+static char const *files[] = {
+    "/proc/stat", "/proc/meminfo", "/proc/net/dev", "/proc/diskstats",
+    "/proc/loadavg",
+};
+
+/* keeps the compiler from optimizing the parsing away */
+static volatile size_t sink;
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static uint64_t read_syscalls(void) {
+  char buffer[1024];
+  uint64_t syscr = 0;
+  FILE *fh = fopen("/proc/self/io", "r");
+
+  if (fh == NULL)
+    return 0;
+  while (fgets(buffer, sizeof(buffer), fh) != NULL)
+    if (strncmp(buffer, "syscr:", 6) == 0)
+      syscr = strtoull(buffer + 6, NULL, 10);
+  fclose(fh);
+  return syscr;
+}
+
+static int read_stdio(char const *path) {
+  char buffer[1024];
+  char *fields[32];
+  FILE *fh = fopen(path, "r");
+
+  if (fh == NULL)
+    return -1;
+  while (fgets(buffer, sizeof(buffer), fh) != NULL)
+    sink += (size_t)strsplit(buffer, fields, STATIC_ARRAY_SIZE(fields));
+  fclose(fh);
+  return 0;
+}
+
+static int read_procfs(procfs_file_t *pf) {
+  char *fields[32];
+  int num;
+
+  if (procfs_read(pf) < 0)
+    return -1;
+  while ((num = procfs_getfields(pf, fields, STATIC_ARRAY_SIZE(fields))) >= 0)
+    sink += (size_t)num;
+  return 0;
+}
+
+int main(void) {
+  for (size_t i = 0; i < STATIC_ARRAY_SIZE(files); i++) {
+    procfs_file_t *pf = procfs_open(files[i]);
+    if (pf == NULL) {
+      printf("%-16s not available\n", files[i]);
+      continue;
+    }
+
+    uint64_t syscr = read_syscalls();
+    double start = cpu_time();
+    for (size_t n = 0; n < BENCH_ITERATIONS; n++)
+      if (read_stdio(files[i]) != 0)
+        return 1;
+    double stdio_us = 1e6 * (cpu_time() - start) / BENCH_ITERATIONS;
+    double stdio_reads =
+        (double)(read_syscalls() - syscr - 1) / BENCH_ITERATIONS;
+
+    syscr = read_syscalls();
+    start = cpu_time();
+    for (size_t n = 0; n < BENCH_ITERATIONS; n++)
+      if (read_procfs(pf) != 0)
+        return 1;
+    double procfs_us = 1e6 * (cpu_time() - start) / BENCH_ITERATIONS;
+    double procfs_reads =
+        (double)(read_syscalls() - syscr - 1) / BENCH_ITERATIONS;
+
+    /* fopen/fclose add two system calls per iteration which do not show up
+     * in syscr. */
+    printf("%-16s stdio: %7.2f us, %4.1f reads + 2  "
+           "procfs: %7.2f us, %4.1f reads (%.1fx)\n",
+           files[i], stdio_us, stdio_reads, procfs_us, procfs_reads,
+           stdio_us / procfs_us);
+
+    procfs_close(pf);
+  }
+
+  return 0;
+}
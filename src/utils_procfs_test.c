@@ -0,0 +1,150 @@
+/**
+ * collectd - src/utils_procfs_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "testing.h"
+#include "utils_procfs.h"
+
+static char test_file[] = "/tmp/collectd-procfs-test.XXXXXX";
+
+static int write_file(char const *content) {
+  FILE *fh = fopen(test_file, "w");
+  if (fh == NULL)
+    return -1;
+  fputs(content, fh);
+  fclose(fh);
+  return 0;
+}
+
+DEF_TEST(lines) {
+  procfs_file_t *pf;
+  char *fields[4];
+
+  CHECK_ZERO(write_file("cpu  1 2 3\ncpu0 4 5 6\n\nintr 7"));
+  CHECK_NOT_NULL(pf = procfs_open(test_file));
+  EXPECT_EQ_STR(test_file, procfs_path(pf));
+
+  /* nothing has been read yet */
+  OK(procfs_getline(pf) == NULL);
+
+  EXPECT_EQ_INT(29, (int)procfs_read(pf));
+  EXPECT_EQ_STR("cpu  1 2 3", procfs_getline(pf));
+  EXPECT_EQ_INT(4, procfs_getfields(pf, fields, STATIC_ARRAY_SIZE(fields)));
+  EXPECT_EQ_STR("cpu0", fields[0]);
+  EXPECT_EQ_STR("6", fields[3]);
+  EXPECT_EQ_INT(0, procfs_getfields(pf, fields, STATIC_ARRAY_SIZE(fields)));
+  /* the last line is not terminated by a newline */
+  EXPECT_EQ_INT(2, procfs_getfields(pf, fields, STATIC_ARRAY_SIZE(fields)));
+  EXPECT_EQ_STR("7", fields[1]);
+  EXPECT_EQ_INT(-1, procfs_getfields(pf, fields, STATIC_ARRAY_SIZE(fields)));
+  OK(procfs_getline(pf) == NULL);
+
+  /* reading again rewinds and sees the new content */
+  CHECK_ZERO(write_file("foo\n"));
+  EXPECT_EQ_INT(4, (int)procfs_read(pf));
+  EXPECT_EQ_STR("foo", procfs_getline(pf));
+  OK(procfs_getline(pf) == NULL);
+
+  procfs_close(pf);
+  return 0;
+}
+
+DEF_TEST(grow) {
+  procfs_file_t *pf;
+  char line[64];
+  size_t size = 0;
+
+  FILE *fh = fopen(test_file, "w");
+  CHECK_NOT_NULL(fh);
+  for (int i = 0; i < 10000; i++) {
+    snprintf(line, sizeof(line), "line %d\n", i);
+    fputs(line, fh);
+    size += strlen(line);
+  }
+  fclose(fh);
+
+  CHECK_NOT_NULL(pf = procfs_open(test_file));
+  EXPECT_EQ_INT((int)size, (int)procfs_read(pf));
+  EXPECT_EQ_INT((int)size, (int)strlen(procfs_data(pf)));
+
+  int num = 0;
+  char *l;
+  while ((l = procfs_getline(pf)) != NULL) {
+    snprintf(line, sizeof(line), "line %d", num);
+    if (strcmp(line, l) != 0)
+      break;
+    num++;
+  }
+  EXPECT_EQ_INT(10000, num);
+
+  procfs_close(pf);
+  return 0;
+}
+
+DEF_TEST(errors) {
+  OK(procfs_open("/nonexistent/collectd-procfs-test") == NULL);
+  EXPECT_EQ_INT(ENOENT, errno);
+
+  OK(procfs_read(NULL) < 0);
+  OK(procfs_getline(NULL) == NULL);
+  procfs_close(NULL);
+
+  return 0;
+}
+
+DEF_TEST(proc) {
+  procfs_file_t *pf = procfs_open("/proc/self/stat");
+  if (pf == NULL) {
+    printf("# /proc/self/stat not available, skipping\n");
+    return 0;
+  }
+
+  /* The content is generated anew by each read. */
+  OK(procfs_read(pf) > 0);
+  OK(procfs_getline(pf) != NULL);
+  OK(procfs_read(pf) > 0);
+  OK(procfs_getline(pf) != NULL);
+
+  procfs_close(pf);
+  return 0;
+}
+
+int main(void) {
+  int fd = mkstemp(test_file);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+
+  RUN_TEST(lines);
+  RUN_TEST(grow);
+  RUN_TEST(errors);
+  RUN_TEST(proc);
+
+  unlink(test_file);
+
+  END_TEST;
+}
@@ -0,0 +1,726 @@
+/**
+ * collectd - src/utils_spool.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "plugin.h"
+#include "utils_crc32.h"
+#include "utils_spool.h"
+
+#include <dirent.h>
+#include <sys/mman.h>
+
+/*
+ * Segment file layout:
+ *
+ *   +--------------------------------------+
+ *   | magic "cdspool1"                     |  8 bytes
+ *   | read offset (host byte order)        |  8 bytes
+ *   | reserved                             | 16 bytes
+ *   +--------------------------------------+
+ *   | size (4 bytes) | crc32 (4 bytes)     |  record header
+ *   | data, padded to a multiple of 8      |
+ *   +--------------------------------------+
+ *   | ...                                  |
+ *   | zero bytes up to the segment size    |  size == 0 marks the end
+ *   +--------------------------------------+
+ *
+ * Segment files are named after a sequence number which increases with each
+ * new segment, so the oldest data is in the segment with the lowest number.
+ * The read offset is updated in place after each record has been replayed.
+ */
+
+#define SPOOL_MAGIC "cdspool1"
+#define SPOOL_SUFFIX ".spool"
+
+struct segment_header_s {
+  char magic[8];
+  uint64_t read_offset;
+  uint64_t reserved[2];
+};
+typedef struct segment_header_s segment_header_t;
+
+struct record_header_s {
+  uint32_t size;
+  uint32_t crc;
+};
+typedef struct record_header_s record_header_t;
+
+#define RECORD_SIZE(data_size)                                                 \
+  (sizeof(record_header_t) + (((data_size) + 7) & ~((size_t)7)))
+
+struct segment_s {
+  uint64_t seq;
+  int fd;
+  char *map;
+  size_t size;
+};
+typedef struct segment_s segment_t;
+
+struct spool_s {
+  char *directory;
+  spool_options_t opts;
+  pthread_mutex_t lock;
+
+  /* sequence numbers of all segments, oldest first */
+  uint64_t *segments;
+  size_t segments_num;
+
+  /* newest segment, records are appended here */
+  segment_t write;
+  size_t write_offset;
+  /* oldest segment, records are replayed from here */
+  segment_t read;
+
+  uint64_t pending;
+  uint64_t dropped;
+
+  double tokens;
+  cdtime_t tokens_time;
+
+  /* Serializes replays. Records are copied to "replay_buffer" so that "lock"
+   * is not held while the callback runs. */
+  pthread_mutex_t replay_lock;
+  char *replay_buffer;
+  size_t replay_buffer_size;
+
+  /* Background replay, see spool_replay_start(). Protected by "lock". */
+  pthread_t replay_thread;
+  pthread_cond_t replay_cond;
+  _Bool replay_running;
+  _Bool replay_stop;
+  spool_replay_callback_t replay_callback;
+  void *replay_user_data;
+};
+
+static void segment_path(spool_t *s, uint64_t seq, char *buffer, /* {{{ */
+                         size_t buffer_size) {
+  snprintf(buffer, buffer_size, "%s/%020" PRIu64 SPOOL_SUFFIX, s->directory,
+           seq);
+} /* }}} void segment_path */
+
+static void segment_close(segment_t *seg) /* {{{ */
+{
+  if (seg->map != NULL) {
+    msync(seg->map, seg->size, MS_ASYNC);
+    munmap(seg->map, seg->size);
+  }
+  if (seg->fd >= 0)
+    close(seg->fd);
+
+  seg->map = NULL;
+  seg->fd = -1;
+  seg->size = 0;
+} /* }}} void segment_close */
+
+static int segment_open(spool_t *s, uint64_t seq, _Bool create, /* {{{ */
+                        segment_t *seg) {
+  char path[PATH_MAX];
+  char errbuf[1024];
+  struct stat statbuf;
+
+  segment_path(s, seq, path, sizeof(path));
+
+  seg->seq = seq;
+  seg->map = NULL;
+  seg->fd = open(path, create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+  if (seg->fd < 0) {
+    ERROR("spool: open (%s) failed: %s", path,
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+
+  if (create) {
+    /* Allocate the blocks up front: writing to a sparse mapping on a full
+     * file system would raise SIGBUS. */
+#if HAVE_POSIX_FALLOCATE
+    int status = posix_fallocate(seg->fd, 0, (off_t)s->opts.segment_size);
+#else
+    int status = ftruncate(seg->fd, (off_t)s->opts.segment_size);
+    if (status != 0)
+      status = errno;
+#endif
+    if (status != 0) {
+      ERROR("spool: Allocating %zu bytes for %s failed: %s",
+            s->opts.segment_size, path,
+            sstrerror(status, errbuf, sizeof(errbuf)));
+      close(seg->fd);
+      unlink(path);
+      seg->fd = -1;
+      return -1;
+    }
+    seg->size = s->opts.segment_size;
+  } else {
+    if (fstat(seg->fd, &statbuf) != 0) {
+      ERROR("spool: fstat (%s) failed: %s", path,
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+      close(seg->fd);
+      seg->fd = -1;
+      return -1;
+    }
+    seg->size = (size_t)statbuf.st_size;
+    if (seg->size < sizeof(segment_header_t)) {
+      WARNING("spool: %s is too small to be a spool segment.", path);
+      close(seg->fd);
+      seg->fd = -1;
+      return -1;
+    }
+  }
+
+  seg->map =
+      mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+  if (seg->map == MAP_FAILED) {
+    ERROR("spool: mmap (%s) failed: %s", path,
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    seg->map = NULL;
+    close(seg->fd);
+    seg->fd = -1;
+    if (create)
+      unlink(path);
+    return -1;
+  }
+
+  segment_header_t *hdr = (segment_header_t *)seg->map;
+  if (create) {
+    memcpy(hdr->magic, SPOOL_MAGIC, sizeof(hdr->magic));
+    hdr->read_offset = sizeof(*hdr);
+  } else if ((memcmp(hdr->magic, SPOOL_MAGIC, sizeof(hdr->magic)) != 0) ||
+             (hdr->read_offset < sizeof(*hdr)) ||
+             (hdr->read_offset > seg->size)) {
+    WARNING("spool: %s is not a valid spool segment.", path);
+    segment_close(seg);
+    return -1;
+  }
+
+  return 0;
+} /* }}} int segment_open */
+
+/* segment_record validates the record at "offset" and returns its data. */
+static int segment_record(segment_t const *seg, size_t offset, /* {{{ */
+                          size_t end, void **ret_data, size_t *ret_size) {
+  record_header_t rh;
+
+  if ((offset + sizeof(rh)) > end)
+    return ENOENT;
+
+  memcpy(&rh, seg->map + offset, sizeof(rh));
+  if (rh.size == 0)
+    return ENOENT;
+
+  if ((rh.size > end - offset - sizeof(rh)) ||
+      (RECORD_SIZE(rh.size) > end - offset))
+    return EILSEQ;
+
+  void *data = seg->map + offset + sizeof(rh);
+  if (crc32_buffer(data, rh.size) != rh.crc)
+    return EILSEQ;
+
+  *ret_data = data;
+  *ret_size = rh.size;
+  return 0;
+} /* }}} int segment_record */
+
+/* segment_scan returns the offset following the last valid record at or after
+ * "offset". */
+static size_t segment_scan(segment_t const *seg, size_t offset, /* {{{ */
+                           uint64_t *ret_records) {
+  void *data;
+  size_t size;
+  uint64_t records = 0;
+
+  while (segment_record(seg, offset, seg->size, &data, &size) == 0) {
+    offset += RECORD_SIZE(size);
+    records++;
+  }
+
+  if (ret_records != NULL)
+    *ret_records = records;
+  return offset;
+} /* }}} size_t segment_scan */
+
+/* spool_drop_oldest removes the oldest segment. It must not be the write
+ * segment. */
+static void spool_drop_oldest(spool_t *s, _Bool complain) /* {{{ */
+{
+  char path[PATH_MAX];
+  uint64_t seq = s->segments[0];
+
+  assert(s->segments_num > 1);
+
+  if (s->read.map == NULL)
+    segment_open(s, seq, /* create = */ 0, &s->read);
+
+  if (s->read.map != NULL) {
+    segment_header_t *hdr = (segment_header_t *)s->read.map;
+    size_t offset = (size_t)hdr->read_offset;
+    uint64_t records = 0;
+    size_t end = segment_scan(&s->read, offset, &records);
+
+    s->pending -= (end - offset);
+    s->dropped += records;
+    if (complain && (records > 0))
+      WARNING("spool: %s: size limit reached, dropping %" PRIu64
+              " records (%zu bytes).",
+              s->directory, records, end - offset);
+  }
+  segment_close(&s->read);
+
+  segment_path(s, seq, path, sizeof(path));
+  unlink(path);
+
+  s->segments_num--;
+  memmove(s->segments, s->segments + 1, s->segments_num * sizeof(*s->segments));
+} /* }}} void spool_drop_oldest */
+
+static int spool_new_segment(spool_t *s) /* {{{ */
+{
+  uint64_t seq = 0;
+
+  if (s->segments_num > 0)
+    seq = s->segments[s->segments_num - 1] + 1;
+
+  while ((s->segments_num > 1) &&
+         ((s->segments_num + 1) * (uint64_t)s->opts.segment_size >
+          s->opts.max_size))
+    spool_drop_oldest(s, /* complain = */ 1);
+
+  uint64_t *tmp =
+      realloc(s->segments, (s->segments_num + 1) * sizeof(*s->segments));
+  if (tmp == NULL)
+    return ENOMEM;
+  s->segments = tmp;
+
+  segment_t seg = {.fd = -1};
+  if (segment_open(s, seq, /* create = */ 1, &seg) != 0)
+    return -1;
+
+  segment_close(&s->write);
+  s->write = seg;
+  s->write_offset = sizeof(segment_header_t);
+  s->segments[s->segments_num] = seq;
+  s->segments_num++;
+  return 0;
+} /* }}} int spool_new_segment */
+
+static int spool_compare_seq(const void *a, const void *b) /* {{{ */
+{
+  uint64_t x = *(uint64_t const *)a;
+  uint64_t y = *(uint64_t const *)b;
+
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+} /* }}} int spool_compare_seq */
+
+/* spool_recover loads the segments left in the directory by a previous
+ * instance. */
+static int spool_recover(spool_t *s) /* {{{ */
+{
+  char errbuf[1024];
+  DIR *dh;
+  struct dirent *de;
+
+  dh = opendir(s->directory);
+  if (dh == NULL) {
+    ERROR("spool: opendir (%s) failed: %s", s->directory,
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+
+  while ((de = readdir(dh)) != NULL) {
+    char *endptr = NULL;
+    uint64_t seq;
+
+    if (de->d_name[0] == '.')
+      continue;
+
+    errno = 0;
+    seq = (uint64_t)strtoull(de->d_name, &endptr, 10);
+    if ((errno != 0) || (endptr == de->d_name) ||
+        (strcmp(endptr, SPOOL_SUFFIX) != 0))
+      continue;
+
+    uint64_t *tmp =
+        realloc(s->segments, (s->segments_num + 1) * sizeof(*s->segments));
+    if (tmp == NULL) {
+      closedir(dh);
+      return ENOMEM;
+    }
+    s->segments = tmp;
+    s->segments[s->segments_num] = seq;
+    s->segments_num++;
+  }
+  closedir(dh);
+
+  qsort(s->segments, s->segments_num, sizeof(*s->segments),
+        spool_compare_seq);
+
+  for (size_t i = 0; i < s->segments_num;) {
+    segment_t seg = {.fd = -1};
+
+    if (segment_open(s, s->segments[i], /* create = */ 0, &seg) != 0) {
+      s->segments_num--;
+      memmove(s->segments + i, s->segments + i + 1,
+              (s->segments_num - i) * sizeof(*s->segments));
+      continue;
+    }
+
+    size_t offset = (size_t)((segment_header_t *)seg.map)->read_offset;
+    size_t end = segment_scan(&seg, offset, NULL);
+    s->pending += end - offset;
+
+    if (i == s->segments_num - 1) {
+      s->write = seg;
+      s->write_offset = end;
+    } else {
+      segment_close(&seg);
+    }
+    i++;
+  }
+
+  if (s->pending > 0)
+    INFO("spool: %s: recovered %" PRIu64 " bytes in %zu segments.",
+         s->directory, s->pending, s->segments_num);
+
+  return 0;
+} /* }}} int spool_recover */
+
+spool_t *spool_create(char const *directory, /* {{{ */
+                      spool_options_t const *opts) {
+  spool_options_t default_opts = SPOOL_OPTIONS_INIT;
+  char dir[PATH_MAX];
+  spool_t *s;
+
+  if (directory == NULL)
+    return NULL;
+  if (opts == NULL)
+    opts = &default_opts;
+
+  s = calloc(1, sizeof(*s));
+  if (s == NULL)
+    return NULL;
+
+  s->directory = strdup(directory);
+  s->opts = *opts;
+  s->write.fd = -1;
+  s->read.fd = -1;
+
+  if (s->opts.segment_size == 0)
+    s->opts.segment_size = SPOOL_DEFAULT_SEGMENT_SIZE;
+  s->opts.segment_size &= ~((size_t)7);
+  if (s->opts.segment_size < 2 * sizeof(segment_header_t))
+    s->opts.segment_size = 2 * sizeof(segment_header_t);
+  /* Two segments are needed to rotate without dropping the one being
+   * written to. */
+  if (s->opts.max_size < 2 * (uint64_t)s->opts.segment_size)
+    s->opts.max_size = 2 * (uint64_t)s->opts.segment_size;
+
+  s->tokens = (double)s->opts.replay_rate;
+  s->tokens_time = cdtime();
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_mutex_init(&s->replay_lock, NULL);
+  pthread_cond_init(&s->replay_cond, NULL);
+
+  snprintf(dir, sizeof(dir), "%s/", directory);
+  if ((s->directory == NULL) || (check_create_dir(dir) != 0) ||
+      (spool_recover(s) != 0)) {
+    ERROR("spool: Opening the spool in \"%s\" failed.", directory);
+    spool_destroy(s);
+    return NULL;
+  }
+
+  return s;
+} /* }}} spool_t *spool_create */
+
+void spool_destroy(spool_t *s) /* {{{ */
+{
+  if (s == NULL)
+    return;
+
+  spool_replay_stop(s);
+
+  segment_close(&s->read);
+  segment_close(&s->write);
+  pthread_mutex_destroy(&s->lock);
+  pthread_mutex_destroy(&s->replay_lock);
+  pthread_cond_destroy(&s->replay_cond);
+  sfree(s->replay_buffer);
+  sfree(s->segments);
+  sfree(s->directory);
+  sfree(s);
+} /* }}} void spool_destroy */
+
+int spool_append(spool_t *s, void const *data, size_t size) /* {{{ */
+{
+  record_header_t rh;
+
+  if ((s == NULL) || (data == NULL) || (size == 0) || (size > UINT32_MAX))
+    return EINVAL;
+
+  if (RECORD_SIZE(size) > s->opts.segment_size - sizeof(segment_header_t)) {
+    ERROR("spool: %s: a record of %zu bytes does not fit into a segment.",
+          s->directory, size);
+    return EINVAL;
+  }
+
+  pthread_mutex_lock(&s->lock);
+
+  if ((s->write.map == NULL) ||
+      (s->write_offset + RECORD_SIZE(size) > s->write.size)) {
+    int status = spool_new_segment(s);
+    if (status != 0) {
+      pthread_mutex_unlock(&s->lock);
+      return status;
+    }
+  }
+
+  char *ptr = s->write.map + s->write_offset;
+  rh.size = (uint32_t)size;
+  rh.crc = crc32_buffer(data, size);
+  memcpy(ptr + sizeof(rh), data, size);
+  memcpy(ptr, &rh, sizeof(rh));
+
+  s->write_offset += RECORD_SIZE(size);
+  s->pending += RECORD_SIZE(size);
+
+  pthread_mutex_unlock(&s->lock);
+  return 0;
+} /* }}} int spool_append */
+
+/* spool_release removes all segments once everything has been replayed, so
+ * that an idle spool does not use any disk space. */
+static void spool_release(spool_t *s) /* {{{ */
+{
+  char path[PATH_MAX];
+
+  segment_close(&s->read);
+  segment_close(&s->write);
+  for (size_t i = 0; i < s->segments_num; i++) {
+    segment_path(s, s->segments[i], path, sizeof(path));
+    unlink(path);
+  }
+  s->segments_num = 0;
+  s->write_offset = 0;
+  s->pending = 0;
+} /* }}} void spool_release */
+
+int spool_replay(spool_t *s, spool_replay_callback_t callback, /* {{{ */
+                 void *user_data) {
+  int count = 0;
+
+  if ((s == NULL) || (callback == NULL))
+    return -EINVAL;
+
+  pthread_mutex_lock(&s->replay_lock);
+  pthread_mutex_lock(&s->lock);
+
+  if (s->opts.replay_rate > 0) {
+    cdtime_t now = cdtime();
+    double rate = (double)s->opts.replay_rate;
+
+    s->tokens += rate * CDTIME_T_TO_DOUBLE(now - s->tokens_time);
+    if (s->tokens > rate)
+      s->tokens = rate;
+    s->tokens_time = now;
+  }
+
+  while (s->segments_num > 0) {
+    _Bool is_write = (s->segments_num == 1);
+    void *data = NULL;
+    size_t size = 0;
+
+    if ((s->opts.replay_rate > 0) && (s->tokens <= 0.0))
+      break;
+
+    if ((s->read.map == NULL) &&
+        (segment_open(s, s->segments[0], /* create = */ 0, &s->read) != 0)) {
+      /* Unreadable: skip this segment. */
+      if (is_write) {
+        spool_release(s);
+        break;
+      }
+      spool_drop_oldest(s, /* complain = */ 0);
+      continue;
+    }
+
+    segment_header_t *hdr = (segment_header_t *)s->read.map;
+    size_t offset = (size_t)hdr->read_offset;
+    size_t end = is_write ? s->write_offset : s->read.size;
+
+    int status = segment_record(&s->read, offset, end, &data, &size);
+    if (status == EILSEQ) {
+      WARNING("spool: %s: checksum mismatch in segment %" PRIu64
+              " at offset %zu, skipping the rest of the segment.",
+              s->directory, s->read.seq, offset);
+      s->dropped++;
+      hdr->read_offset = end;
+      status = ENOENT;
+    }
+    if (status == ENOENT) {
+      if (is_write) {
+        spool_release(s);
+        break;
+      }
+      spool_drop_oldest(s, /* complain = */ 0);
+      continue;
+    }
+
+    if (size > s->replay_buffer_size) {
+      char *tmp = realloc(s->replay_buffer, size);
+      if (tmp == NULL) {
+        count = (count > 0) ? count : -ENOMEM;
+        break;
+      }
+      s->replay_buffer = tmp;
+      s->replay_buffer_size = size;
+    }
+    memcpy(s->replay_buffer, data, size);
+    uint64_t seq = s->read.seq;
+
+    /* The callback may append to this spool, e.g. when sending fails. */
+    pthread_mutex_unlock(&s->lock);
+    status = callback(s->replay_buffer, size, user_data);
+    pthread_mutex_lock(&s->lock);
+    if (status != 0)
+      break;
+
+    /* Unless the segment was dropped in the meantime, acknowledge the
+     * record. */
+    if ((s->segments_num > 0) && (s->segments[0] == seq) &&
+        (s->read.map != NULL) && (s->read.seq == seq)) {
+      hdr = (segment_header_t *)s->read.map;
+      if (hdr->read_offset == offset) {
+        hdr->read_offset = offset + RECORD_SIZE(size);
+        s->pending -= RECORD_SIZE(size);
+      }
+    }
+    s->tokens -= (double)size;
+    count++;
+  }
+
+  pthread_mutex_unlock(&s->lock);
+  pthread_mutex_unlock(&s->replay_lock);
+  return count;
+} /* }}} int spool_replay */
+
+static void *spool_replay_thread(void *arg) /* {{{ */
+{
+  spool_t *s = arg;
+
+  pthread_mutex_lock(&s->lock);
+  while (!s->replay_stop) {
+    if (s->pending > 0) {
+      pthread_mutex_unlock(&s->lock);
+      spool_replay(s, s->replay_callback, s->replay_user_data);
+      pthread_mutex_lock(&s->lock);
+      if (s->replay_stop)
+        break;
+    }
+
+    /* The replay rate is a budget per second, so there is no point in
+     * trying more often. */
+    struct timespec ts = CDTIME_T_TO_TIMESPEC(cdtime() + SPOOL_REPLAY_INTERVAL);
+    pthread_cond_timedwait(&s->replay_cond, &s->lock, &ts);
+  }
+  pthread_mutex_unlock(&s->lock);
+
+  return NULL;
+} /* }}} void *spool_replay_thread */
+
+int spool_replay_start(spool_t *s, spool_replay_callback_t callback, /* {{{ */
+                       void *user_data) {
+  if ((s == NULL) || (callback == NULL))
+    return EINVAL;
+
+  pthread_mutex_lock(&s->lock);
+  if (s->replay_running) {
+    pthread_mutex_unlock(&s->lock);
+    return 0;
+  }
+
+  s->replay_callback = callback;
+  s->replay_user_data = user_data;
+  s->replay_stop = 0;
+
+  int status = plugin_thread_create(&s->replay_thread, /* attr = */ NULL,
+                                    spool_replay_thread, s, "spool replay");
+  if (status != 0) {
+    char errbuf[1024];
+    ERROR("spool: %s: Starting the replay thread failed: %s", s->directory,
+          sstrerror(status, errbuf, sizeof(errbuf)));
+    pthread_mutex_unlock(&s->lock);
+    return status;
+  }
+
+  s->replay_running = 1;
+  pthread_mutex_unlock(&s->lock);
+  return 0;
+} /* }}} int spool_replay_start */
+
+void spool_replay_stop(spool_t *s) /* {{{ */
+{
+  if (s == NULL)
+    return;
+
+  pthread_mutex_lock(&s->lock);
+  if (!s->replay_running) {
+    pthread_mutex_unlock(&s->lock);
+    return;
+  }
+  s->replay_stop = 1;
+  pthread_cond_broadcast(&s->replay_cond);
+  pthread_mutex_unlock(&s->lock);
+
+  pthread_join(s->replay_thread, NULL);
+
+  pthread_mutex_lock(&s->lock);
+  s->replay_running = 0;
+  pthread_mutex_unlock(&s->lock);
+} /* }}} void spool_replay_stop */
+
+uint64_t spool_pending(spool_t *s) /* {{{ */
+{
+  uint64_t pending;
+
+  if (s == NULL)
+    return 0;
+
+  pthread_mutex_lock(&s->lock);
+  pending = s->pending;
+  pthread_mutex_unlock(&s->lock);
+
+  return pending;
+} /* }}} uint64_t spool_pending */
+
+uint64_t spool_dropped(spool_t *s) /* {{{ */
+{
+  uint64_t dropped;
+
+  if (s == NULL)
+    return 0;
+
+  pthread_mutex_lock(&s->lock);
+  dropped = s->dropped;
+  pthread_mutex_unlock(&s->lock);
+
+  return dropped;
+} /* }}} uint64_t spool_dropped */
@@ -0,0 +1,105 @@
+/**
+ * collectd - src/utils_spool.h
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#ifndef UTILS_SPOOL_H
+#define UTILS_SPOOL_H 1
+
+#include "collectd.h"
+
+/* A spool is an append-only queue of records on disk, used by write plugins
+ * to keep formatted data while their backend is unreachable. Records are
+ * stored in memory mapped segment files of a fixed size, each record
+ * protected by a CRC32 checksum. The spool survives restarts of the daemon;
+ * replaying resumes with the first record that has not been acknowledged.
+ *
+ * A spool is safe to use from multiple threads, but each directory must only
+ * be used by one spool at a time. */
+struct spool_s;
+typedef struct spool_s spool_t;
+
+#ifndef SPOOL_DEFAULT_SEGMENT_SIZE
+#define SPOOL_DEFAULT_SEGMENT_SIZE 4194304 /* 4 MiB */
+#endif
+
+#ifndef SPOOL_DEFAULT_MAX_SIZE
+#define SPOOL_DEFAULT_MAX_SIZE 268435456 /* 256 MiB */
+#endif
+
+#ifndef SPOOL_REPLAY_INTERVAL
+#define SPOOL_REPLAY_INTERVAL TIME_T_TO_CDTIME_T(1)
+#endif
+
+typedef struct {
+  /* Size of one segment file in bytes. Records larger than a segment are
+   * rejected. */
+  size_t segment_size;
+  /* Maximum size of all segments. When exceeded, the oldest segment is
+   * discarded. */
+  uint64_t max_size;
+  /* Maximum number of bytes replayed per second, zero means no limit. */
+  uint64_t replay_rate;
+} spool_options_t;
+
+#define SPOOL_OPTIONS_INIT                                                     \
+  { SPOOL_DEFAULT_SEGMENT_SIZE, SPOOL_DEFAULT_MAX_SIZE, 0 }
+
+/* spool_create opens the spool in "directory", creating the directory if
+ * necessary, and recovers records left by a previous instance. */
+spool_t *spool_create(char const *directory, spool_options_t const *opts);
+void spool_destroy(spool_t *s);
+
+/* spool_append adds a copy of "data" as one record. */
+int spool_append(spool_t *s, void const *data, size_t size);
+
+/* spool_replay_callback_t is called for each record. Returning non-zero stops
+ * the replay and keeps the record in the spool. "data" is a copy and the spool
+ * is not locked during the call, so the callback may append to the spool. */
+typedef int (*spool_replay_callback_t)(void const *data, size_t size,
+                                       void *user_data);
+
+/* spool_replay passes records to "callback", oldest first, until the spool is
+ * empty, the callback fails or the replay rate has been exhausted. Returns the
+ * number of records removed from the spool or a negative errno value. */
+int spool_replay(spool_t *s, spool_replay_callback_t callback,
+                 void *user_data);
+
+/* spool_replay_start starts a thread which calls spool_replay() with
+ * "callback" about once every SPOOL_REPLAY_INTERVAL while records are
+ * pending, so that senders don't have to replay on their write path. Does
+ * nothing if the thread is already running. */
+int spool_replay_start(spool_t *s, spool_replay_callback_t callback,
+                       void *user_data);
+
+/* spool_replay_stop stops the replay thread, waiting for a replay in progress
+ * to finish. The callback must therefore not be blocked by the caller.
+ * spool_destroy() calls this, too. */
+void spool_replay_stop(spool_t *s);
+
+/* spool_pending returns the number of bytes waiting to be replayed. */
+uint64_t spool_pending(spool_t *s);
+
+/* spool_dropped returns the number of records discarded because the spool
+ * reached its size limit or was corrupted. */
+uint64_t spool_dropped(spool_t *s);
+
+#endif /* UTILS_SPOOL_H */
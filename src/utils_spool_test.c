@@ -0,0 +1,407 @@
+/**
+ * collectd - src/utils_spool_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+#include "collectd.h"
+
+#include "common.h"
+#include "testing.h"
+#include "utils_spool.h"
+
+#include <dirent.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+static char spool_dir[] = "/tmp/collectd-spool-test.XXXXXX";
+
+static void remove_spool_files(void) {
+  DIR *dh = opendir(spool_dir);
+  struct dirent *de;
+
+  if (dh == NULL)
+    return;
+  while ((de = readdir(dh)) != NULL) {
+    char path[PATH_MAX];
+    if (de->d_name[0] == '.')
+      continue;
+    snprintf(path, sizeof(path), "%s/%s", spool_dir, de->d_name);
+    unlink(path);
+  }
+  closedir(dh);
+}
+
+static size_t count_spool_files(void) {
+  DIR *dh = opendir(spool_dir);
+  struct dirent *de;
+  size_t num = 0;
+
+  if (dh == NULL)
+    return 0;
+  while ((de = readdir(dh)) != NULL)
+    if (de->d_name[0] != '.')
+      num++;
+  closedir(dh);
+  return num;
+}
+
+typedef struct {
+  char buffer[65536];
+  size_t fill;
+  size_t records;
+  size_t fail_after;
+} collect_t;
+
+static int collect_cb(void const *data, size_t size, void *user_data) {
+  collect_t *c = user_data;
+
+  if ((c->fail_after > 0) && (c->records >= c->fail_after))
+    return -1;
+  if (c->fill + size > sizeof(c->buffer))
+    return -1;
+
+  memcpy(c->buffer + c->fill, data, size);
+  c->fill += size;
+  c->records++;
+  return 0;
+}
+
+static int append_lines(spool_t *s, size_t first, size_t num) {
+  for (size_t i = first; i < first + num; i++) {
+    char line[64];
+    snprintf(line, sizeof(line), "put test.metric %zu %zu\n", i, i);
+    int status = spool_append(s, line, strlen(line));
+    if (status != 0)
+      return status;
+  }
+  return 0;
+}
+
+static int check_lines(collect_t const *c, size_t first, size_t num) {
+  size_t offset = 0;
+
+  for (size_t i = first; i < first + num; i++) {
+    char line[64];
+    int len = snprintf(line, sizeof(line), "put test.metric %zu %zu\n", i, i);
+    if ((offset + len > c->fill) || (memcmp(c->buffer + offset, line, len)))
+      return -1;
+    offset += len;
+  }
+  return (offset == c->fill) ? 0 : -1;
+}
+
+DEF_TEST(append_replay) {
+  spool_t *s = spool_create(spool_dir, NULL);
+  collect_t c = {.fill = 0};
+
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, (int)spool_pending(s));
+  EXPECT_EQ_INT(0, append_lines(s, 0, 100));
+  OK(spool_pending(s) > 0);
+
+  EXPECT_EQ_INT(100, spool_replay(s, collect_cb, &c));
+  EXPECT_EQ_INT(0, check_lines(&c, 0, 100));
+  EXPECT_EQ_INT(0, (int)spool_pending(s));
+  /* segments are removed once everything has been replayed */
+  EXPECT_EQ_INT(0, (int)count_spool_files());
+
+  /* a failing callback keeps the record */
+  memset(&c, 0, sizeof(c));
+  c.fail_after = 10;
+  EXPECT_EQ_INT(0, append_lines(s, 0, 20));
+  EXPECT_EQ_INT(10, spool_replay(s, collect_cb, &c));
+  c.fail_after = 0;
+  EXPECT_EQ_INT(10, spool_replay(s, collect_cb, &c));
+  EXPECT_EQ_INT(0, check_lines(&c, 0, 20));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+typedef struct {
+  spool_t *spool;
+  size_t records;
+  size_t requeue;
+} requeue_t;
+
+/* requeue_cb appends the first records to the spool again, like a sender
+ * that spools data it fails to send. */
+static int requeue_cb(void const *data, size_t size, void *user_data) {
+  requeue_t *r = user_data;
+
+  r->records++;
+  if (r->records <= r->requeue)
+    return spool_append(r->spool, data, size);
+  return 0;
+}
+
+DEF_TEST(append_during_replay) {
+  spool_t *s = spool_create(spool_dir, NULL);
+  requeue_t r = {.spool = s, .requeue = 5};
+
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 10));
+  EXPECT_EQ_INT(15, spool_replay(s, requeue_cb, &r));
+  EXPECT_EQ_INT(15, (int)r.records);
+  EXPECT_EQ_INT(0, (int)spool_pending(s));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+DEF_TEST(segments_and_restart) {
+  spool_options_t opts = SPOOL_OPTIONS_INIT;
+  collect_t c = {.fill = 0};
+
+  opts.segment_size = 1024;
+  opts.max_size = 1024 * 1024;
+
+  spool_t *s = spool_create(spool_dir, &opts);
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 200));
+  OK(count_spool_files() > 1);
+
+  c.fail_after = 50;
+  EXPECT_EQ_INT(50, spool_replay(s, collect_cb, &c));
+  spool_destroy(s);
+
+  /* a new instance continues where the previous one stopped */
+  s = spool_create(spool_dir, &opts);
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 200, 10));
+  c.fail_after = 0;
+  EXPECT_EQ_INT(160, spool_replay(s, collect_cb, &c));
+  EXPECT_EQ_INT(0, check_lines(&c, 0, 210));
+  EXPECT_EQ_INT(0, (int)spool_dropped(s));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+DEF_TEST(size_limit) {
+  spool_options_t opts = SPOOL_OPTIONS_INIT;
+  collect_t c = {.fill = 0};
+
+  opts.segment_size = 1024;
+  opts.max_size = 4 * 1024;
+
+  spool_t *s = spool_create(spool_dir, &opts);
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 1000));
+  OK(count_spool_files() <= 4);
+  OK(spool_dropped(s) > 0);
+  OK(spool_pending(s) <= opts.max_size);
+
+  /* the newest records are kept */
+  size_t kept = 1000 - (size_t)spool_dropped(s);
+  EXPECT_EQ_INT((int)kept, spool_replay(s, collect_cb, &c));
+  EXPECT_EQ_INT(0, check_lines(&c, 1000 - kept, kept));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+DEF_TEST(checksum) {
+  spool_options_t opts = SPOOL_OPTIONS_INIT;
+  collect_t c = {.fill = 0};
+  char path[PATH_MAX];
+
+  opts.segment_size = 1024;
+
+  spool_t *s = spool_create(spool_dir, &opts);
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 100));
+  spool_destroy(s);
+
+  /* corrupt the data of the first record in the first segment */
+  snprintf(path, sizeof(path), "%s/%020d.spool", spool_dir, 0);
+  FILE *fh = fopen(path, "r+");
+  OK(fh != NULL);
+  fseek(fh, 32 + 8 + 4, SEEK_SET);
+  fputc('X', fh);
+  fclose(fh);
+
+  s = spool_create(spool_dir, &opts);
+  OK(s != NULL);
+  int n = spool_replay(s, collect_cb, &c);
+  OK(n > 0);
+  OK(n < 100);
+  EXPECT_EQ_INT(1, (int)spool_dropped(s));
+  EXPECT_EQ_INT(0, check_lines(&c, 100 - n, n));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+DEF_TEST(replay_rate) {
+  spool_options_t opts = SPOOL_OPTIONS_INIT;
+  collect_t c = {.fill = 0};
+
+  /* The time is mocked, so only the initial burst of one second is
+   * available. */
+  opts.replay_rate = 100;
+
+  spool_t *s = spool_create(spool_dir, &opts);
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 100));
+
+  int n = spool_replay(s, collect_cb, &c);
+  OK(n >= 1);
+  OK(n <= 5);
+  EXPECT_EQ_INT(0, spool_replay(s, collect_cb, &c));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+DEF_TEST(replay_thread) {
+  spool_t *s = spool_create(spool_dir, NULL);
+  collect_t c = {.fill = 0};
+
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 100));
+
+  EXPECT_EQ_INT(0, spool_replay_start(s, collect_cb, &c));
+  /* starting again is a no-op */
+  EXPECT_EQ_INT(0, spool_replay_start(s, collect_cb, &c));
+  for (int i = 0; (i < 500) && (spool_pending(s) > 0); i++)
+    usleep(10000);
+  EXPECT_EQ_INT(0, (int)spool_pending(s));
+
+  spool_replay_stop(s);
+  EXPECT_EQ_INT(0, check_lines(&c, 0, 100));
+
+  /* spool_destroy() stops a running thread */
+  EXPECT_EQ_INT(0, spool_replay_start(s, collect_cb, &c));
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+/* Local TCP sink which can be stopped and started again. */
+typedef struct {
+  struct sockaddr_in addr;
+  int listen_fd;
+  int client_fd;
+} sink_t;
+
+static int sink_start(sink_t *sink) {
+  int one = 1;
+
+  sink->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sink->listen_fd < 0)
+    return -1;
+  setsockopt(sink->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if ((bind(sink->listen_fd, (struct sockaddr *)&sink->addr,
+            sizeof(sink->addr)) != 0) ||
+      (listen(sink->listen_fd, 1) != 0))
+    return -1;
+
+  socklen_t len = sizeof(sink->addr);
+  return getsockname(sink->listen_fd, (struct sockaddr *)&sink->addr, &len);
+}
+
+static void sink_stop(sink_t *sink) {
+  close(sink->listen_fd);
+  sink->listen_fd = -1;
+}
+
+static int sink_send_cb(void const *data, size_t size, void *user_data) {
+  sink_t *sink = user_data;
+
+  if (sink->client_fd < 0) {
+    sink->client_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(sink->client_fd, (struct sockaddr *)&sink->addr,
+                sizeof(sink->addr)) != 0) {
+      close(sink->client_fd);
+      sink->client_fd = -1;
+      return -1;
+    }
+  }
+
+  return (swrite(sink->client_fd, data, size) == 0) ? 0 : -1;
+}
+
+DEF_TEST(tcp_sink) {
+  sink_t sink = {.listen_fd = -1, .client_fd = -1};
+  collect_t c = {.fill = 0};
+
+  sink.addr.sin_family = AF_INET;
+  sink.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sink.addr.sin_port = 0;
+
+  OK(sink_start(&sink) == 0);
+  sink_stop(&sink);
+
+  /* backend down: everything stays in the spool */
+  spool_t *s = spool_create(spool_dir, NULL);
+  OK(s != NULL);
+  EXPECT_EQ_INT(0, append_lines(s, 0, 50));
+  EXPECT_EQ_INT(0, spool_replay(s, sink_send_cb, &sink));
+  OK(spool_pending(s) > 0);
+
+  /* backend up again: records are delivered in order */
+  OK(sink_start(&sink) == 0);
+  EXPECT_EQ_INT(50, spool_replay(s, sink_send_cb, &sink));
+  EXPECT_EQ_INT(0, (int)spool_pending(s));
+
+  int fd = accept(sink.listen_fd, NULL, NULL);
+  OK(fd >= 0);
+  close(sink.client_fd);
+  ssize_t status;
+  while ((status = read(fd, c.buffer + c.fill, sizeof(c.buffer) - c.fill)) > 0)
+    c.fill += (size_t)status;
+  close(fd);
+  sink_stop(&sink);
+
+  EXPECT_EQ_INT(0, check_lines(&c, 0, 50));
+
+  spool_destroy(s);
+  remove_spool_files();
+  return 0;
+}
+
+int main(void) {
+  if (mkdtemp(spool_dir) == NULL) {
+    perror("mkdtemp");
+    return 1;
+  }
+
+  RUN_TEST(append_replay);
+  RUN_TEST(append_during_replay);
+  RUN_TEST(segments_and_restart);
+  RUN_TEST(size_limit);
+  RUN_TEST(checksum);
+  RUN_TEST(replay_rate);
+  RUN_TEST(replay_thread);
+  RUN_TEST(tcp_sink);
+
+  remove_spool_files();
+  rmdir(spool_dir);
+
+  END_TEST;
+}
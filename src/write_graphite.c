@@ -49,6 +49,7 @@
 
 #include "utils_complain.h"
 #include "utils_format_graphite.h"
+#include "utils_spool.h"
 
 #include <netdb.h>
 
@@ -77,6 +78,11 @@
 #define WG_SEND_BUF_SIZE 1428
 #endif
 
+/* Bytes per second sent from the spool after an outage. */
+#ifndef WG_DEFAULT_SPOOL_REPLAY_RATE
+#define WG_DEFAULT_SPOOL_REPLAY_RATE 1048576
+#endif
+
 #ifndef WG_MIN_RECONNECT_INTERVAL
 #define WG_MIN_RECONNECT_INTERVAL TIME_T_TO_CDTIME_T(1)
 #endif
@@ -99,6 +105,10 @@ struct wg_callback {
 
   unsigned int format_flags;
 
+  /* Escaped metric names by series; NULL if "NameCacheSize" is zero. */
+  name_cache_t *names;
+  size_t names_size;
+
   char send_buf[WG_SEND_BUF_SIZE];
   size_t send_buf_free;
   size_t send_buf_fill;
@@ -112,6 +122,11 @@ struct wg_callback {
   cdtime_t last_reconnect_time;
   cdtime_t reconnect_interval;
   _Bool reconnect_interval_reached;
+
+  char *spool_dir;
+  spool_options_t spool_opts;
+  spool_t *spool;
+  _Bool spool_replay_started;
 };
 
 /* wg_force_reconnect_check closes cb->sock_fd when it was open for longer
@@ -172,6 +187,26 @@ static int wg_send_buffer(struct wg_callback *cb) {
   return 0;
 }
 
+/* wg_spool_send is called by the spool's replay thread for each record. The
+ * record is only sent if the connection is up; reconnecting is left to the
+ * write and flush callbacks. */
+static int wg_spool_send(void const *data, size_t size, void *user_data) {
+  struct wg_callback *cb = user_data;
+  int status = 0;
+
+  pthread_mutex_lock(&cb->send_lock);
+  if (cb->sock_fd < 0) {
+    status = -1;
+  } else if (swrite(cb->sock_fd, data, size) != 0) {
+    close(cb->sock_fd);
+    cb->sock_fd = -1;
+    status = -1;
+  }
+  pthread_mutex_unlock(&cb->send_lock);
+
+  return status;
+}
+
 /* NOTE: You must hold cb->send_lock when calling this function! */
 static int wg_flush_nolock(cdtime_t timeout, struct wg_callback *cb) {
   int status;
@@ -195,6 +230,8 @@ static int wg_flush_nolock(cdtime_t timeout, struct wg_callback *cb) {
   }
 
   status = wg_send_buffer(cb);
+  if ((status != 0) && (cb->spool != NULL))
+    status = spool_append(cb->spool, cb->send_buf, cb->send_buf_fill);
   wg_reset_buffer(cb);
 
   return status;
@@ -296,6 +333,9 @@ static void wg_callback_free(void *data) {
 
   cb = data;
 
+  /* The replay thread takes send_lock, so it is stopped first. */
+  spool_replay_stop(cb->spool);
+
   pthread_mutex_lock(&cb->send_lock);
 
   wg_flush_nolock(/* timeout = */ 0, cb);
@@ -305,12 +345,19 @@ static void wg_callback_free(void *data) {
     cb->sock_fd = -1;
   }
 
+  spool_destroy(cb->spool);
+  cb->spool = NULL;
+
+  name_cache_destroy(cb->names);
+  cb->names = NULL;
+
   sfree(cb->name);
   sfree(cb->node);
   sfree(cb->protocol);
   sfree(cb->service);
   sfree(cb->prefix);
   sfree(cb->postfix);
+  sfree(cb->spool_dir);
 
   pthread_mutex_destroy(&cb->send_lock);
 
@@ -353,11 +400,23 @@ static int wg_send_message(char const *message, struct wg_callback *cb) {
 
   pthread_mutex_lock(&cb->send_lock);
 
+  /* The replay thread is started here rather than at configuration time,
+   * because threads do not survive the daemon forking into the background. */
+  if ((cb->spool != NULL) && !cb->spool_replay_started) {
+    spool_replay_start(cb->spool, wg_spool_send, cb);
+    cb->spool_replay_started = 1;
+  }
+
   wg_force_reconnect_check(cb);
 
   if (cb->sock_fd < 0) {
     status = wg_callback_init(cb);
-    if (status != 0) {
+    if ((status != 0) && (cb->spool != NULL)) {
+      /* Keep the message until the backend is reachable again. */
+      status = spool_append(cb->spool, message, message_len);
+      pthread_mutex_unlock(&cb->send_lock);
+      return status;
+    } else if (status != 0) {
       /* An error message has already been printed. */
       pthread_mutex_unlock(&cb->send_lock);
       return -1;
@@ -394,7 +453,7 @@ static int wg_send_message(char const *message, struct wg_callback *cb) {
 
 static int wg_write_messages(const data_set_t *ds, const value_list_t *vl,
                              struct wg_callback *cb) {
-  char buffer[WG_SEND_BUF_SIZE] = {0};
+  char buffer[WG_SEND_BUF_SIZE];
   int status;
 
   if (0 != strcmp(ds->type, vl->type)) {
@@ -403,8 +462,9 @@ static int wg_write_messages(const data_set_t *ds, const value_list_t *vl,
     return -1;
   }
 
-  status = format_graphite(buffer, sizeof(buffer), ds, vl, cb->prefix,
-                           cb->postfix, cb->escape_char, cb->format_flags);
+  status = format_graphite_cached(buffer, sizeof(buffer), ds, vl, cb->prefix,
+                                  cb->postfix, cb->escape_char,
+                                  cb->format_flags, cb->names);
   if (status != 0) /* error message has been printed already. */
     return status;
 
@@ -479,6 +539,9 @@ static int wg_config_node(oconfig_item_t *ci) {
   cb->postfix = NULL;
   cb->escape_char = WG_DEFAULT_ESCAPE;
   cb->format_flags = GRAPHITE_STORE_RATES;
+  cb->names_size = NAME_CACHE_DEFAULT_SIZE;
+  cb->spool_opts = (spool_options_t)SPOOL_OPTIONS_INIT;
+  cb->spool_opts.replay_rate = WG_DEFAULT_SPOOL_REPLAY_RATE;
 
   /* FIXME: Legacy configuration syntax. */
   if (strcasecmp("Carbon", ci->key) != 0) {
@@ -527,7 +590,39 @@ static int wg_config_node(oconfig_item_t *ci) {
       cf_util_get_flag(child, &cb->format_flags, GRAPHITE_DROP_DUPE_FIELDS);
     else if (strcasecmp("EscapeCharacter", child->key) == 0)
       config_set_char(&cb->escape_char, child);
-    else {
+    else if (strcasecmp("SpoolDirectory", child->key) == 0)
+      cf_util_get_string(child, &cb->spool_dir);
+    else if (strcasecmp("SpoolMaxSize", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp > 0))
+        cb->spool_opts.max_size = ((uint64_t)tmp) * 1048576;
+      else {
+        ERROR("write_graphite plugin: \"SpoolMaxSize\" must be a positive "
+              "number of megabytes.");
+        status = -1;
+      }
+    } else if (strcasecmp("SpoolReplayRate", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp >= 0))
+        cb->spool_opts.replay_rate = (uint64_t)tmp;
+      else {
+        ERROR("write_graphite plugin: \"SpoolReplayRate\" must be a "
+              "non-negative number of bytes per second.");
+        status = -1;
+      }
+    } else if (strcasecmp("NameCacheSize", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp >= 0))
+        cb->names_size = (size_t)tmp;
+      else {
+        ERROR("write_graphite plugin: \"NameCacheSize\" must be a "
+              "non-negative number of metrics.");
+        status = -1;
+      }
+    } else {
       ERROR("write_graphite plugin: Invalid configuration "
             "option: %s.",
             child->key);
@@ -543,6 +638,17 @@ static int wg_config_node(oconfig_item_t *ci) {
     return status;
   }
 
+  if (cb->names_size > 0)
+    cb->names = name_cache_create(cb->names_size);
+
+  if (cb->spool_dir != NULL) {
+    cb->spool = spool_create(cb->spool_dir, &cb->spool_opts);
+    if (cb->spool == NULL)
+      ERROR("write_graphite plugin: Opening the spool in \"%s\" failed. "
+            "Values will be dropped while %s:%s is unreachable.",
+            cb->spool_dir, cb->node, cb->service);
+  }
+
   /* FIXME: Legacy configuration syntax. */
   if (cb->name == NULL)
     snprintf(callback_name, sizeof(callback_name), "write_graphite/%s/%s/%s",
@@ -27,15 +27,40 @@
 
 #include "common.h"
 #include "plugin.h"
+#include "utils_complain.h"
 #include "utils_format_json.h"
 #include "utils_format_kairosdb.h"
 
 #include <curl/curl.h>
 
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #ifndef WRITE_HTTP_DEFAULT_BUFFER_SIZE
 #define WRITE_HTTP_DEFAULT_BUFFER_SIZE 4096
 #endif
 
+/* Number of requests that may wait for a free connection, per connection. */
+#ifndef WH_QUEUE_FACTOR
+#define WH_QUEUE_FACTOR 16
+#endif
+
+/* Failed requests are retried after WH_RETRY_INTERVAL, doubling with each
+ * attempt up to WH_RETRY_INTERVAL_MAX. */
+#ifndef WH_RETRY_INTERVAL
+#define WH_RETRY_INTERVAL MS_TO_CDTIME_T(500)
+#endif
+#ifndef WH_RETRY_INTERVAL_MAX
+#define WH_RETRY_INTERVAL_MAX TIME_T_TO_CDTIME_T(30)
+#endif
+
+/* Requests that are not sent within this time after shutdown was requested are
+ * dropped. */
+#ifndef WH_SHUTDOWN_TIMEOUT
+#define WH_SHUTDOWN_TIMEOUT TIME_T_TO_CDTIME_T(5)
+#endif
+
 /*
  * Private variables
  */
@@ -68,6 +93,14 @@ struct wh_callback_s {
   _Bool send_metrics;
   _Bool send_notifications;
 
+#define WH_COMPRESSION_NONE 0
+#define WH_COMPRESSION_GZIP 1
+#define WH_COMPRESSION_DEFLATE 2
+  int compression;
+  /* compressed request body in synchronous mode */
+  char *zbuffer;
+  size_t zbuffer_size;
+
   CURL *curl;
   struct curl_slist *headers;
   char curl_errbuf[CURL_ERROR_SIZE];
@@ -81,9 +114,62 @@ struct wh_callback_s {
   pthread_mutex_t send_lock;
 
   int data_ttl;
+
+  _Bool async_send;
+  int concurrent_requests;
+  int max_retries;
+  struct wh_async_s *async;
 };
 typedef struct wh_callback_s wh_callback_t;
 
+/* wh_request_t is a request body waiting to be sent in asynchronous mode. Its
+ * buffer is at least "send_buffer_size" bytes large, so that it can be swapped
+ * with the send buffer. */
+typedef struct wh_request_s {
+  char *data;
+  size_t size;
+  size_t len;
+  int attempts;
+  cdtime_t next_attempt;
+  struct wh_request_s *next;
+} wh_request_t;
+
+typedef struct {
+  CURL *curl;
+  wh_request_t *req;
+  char *zbuffer;
+  size_t zbuffer_size;
+  char curl_errbuf[CURL_ERROR_SIZE];
+} wh_slot_t;
+
+struct wh_async_s {
+  wh_callback_t *cb;
+
+  /* lock protects the request lists and flags below */
+  pthread_mutex_t lock;
+  wh_request_t *queue_head;
+  wh_request_t *queue_tail;
+  wh_request_t *free;
+  size_t requests_num;
+  size_t requests_max;
+  _Bool wake_pending;
+  _Bool stop;
+  c_complain_t full_complaint;
+
+  /* only used by the sender thread */
+  CURLM *multi;
+  wh_slot_t *slots;
+  size_t slots_num;
+  wh_request_t *retry_head;
+  wh_request_t *retry_tail;
+  c_complain_t send_complaint;
+  int wake_fd[2];
+
+  pthread_t thread;
+  _Bool thread_running;
+};
+typedef struct wh_async_s wh_async_t;
+
 static char **http_attrs;
 static size_t http_attrs_num;
 
@@ -115,13 +201,74 @@ static void wh_reset_buffer(wh_callback_t *cb) /* {{{ */
   }
 } /* }}} wh_reset_buffer */
 
+#if HAVE_ZLIB
+/* wh_compress compresses "len" bytes at "data" into "*buffer", growing it as
+ * required. Returns the compressed size or zero on error. */
+static size_t wh_compress(int compression, char const *data, /* {{{ */
+                          size_t len, char **buffer, size_t *buffer_size) {
+  z_stream z = {0};
+
+  /* 16 selects the gzip format, otherwise the zlib format is used, which is
+   * what HTTP calls "deflate". */
+  int window_bits = (compression == WH_COMPRESSION_GZIP) ? (15 + 16) : 15;
+  if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return 0;
+
+  size_t bound = (size_t)deflateBound(&z, (uLong)len);
+  if (*buffer_size < bound) {
+    char *tmp = realloc(*buffer, bound);
+    if (tmp == NULL) {
+      deflateEnd(&z);
+      return 0;
+    }
+    *buffer = tmp;
+    *buffer_size = bound;
+  }
+
+  z.next_in = (Bytef *)data;
+  z.avail_in = (uInt)len;
+  z.next_out = (Bytef *)*buffer;
+  z.avail_out = (uInt)*buffer_size;
+
+  int status = deflate(&z, Z_FINISH);
+  size_t out_len = (size_t)z.total_out;
+  deflateEnd(&z);
+
+  return (status == Z_STREAM_END) ? out_len : 0;
+} /* }}} size_t wh_compress */
+#endif
+
+/* wh_set_body sets the body of the next request sent by "curl", compressing it
+ * into "*zbuffer" if configured. */
+static int wh_set_body(wh_callback_t *cb, CURL *curl, /* {{{ */
+                       char const *data, size_t len, char **zbuffer,
+                       size_t *zbuffer_size) {
+#if HAVE_ZLIB
+  if (cb->compression != WH_COMPRESSION_NONE) {
+    len = wh_compress(cb->compression, data, len, zbuffer, zbuffer_size);
+    if (len == 0) {
+      ERROR("write_http plugin: Compressing the request body failed.");
+      return -1;
+    }
+    data = *zbuffer;
+  }
+#endif
+
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)len);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data);
+  return 0;
+} /* }}} int wh_set_body */
+
 /* must hold cb->send_lock when calling */
-static int wh_post_nolock(wh_callback_t *cb, char const *data) /* {{{ */
-{
+static int wh_post_nolock(wh_callback_t *cb, char const *data, /* {{{ */
+                          size_t len) {
   int status = 0;
 
   curl_easy_setopt(cb->curl, CURLOPT_URL, cb->location);
-  curl_easy_setopt(cb->curl, CURLOPT_POSTFIELDS, data);
+  if (wh_set_body(cb, cb->curl, data, len, &cb->zbuffer, &cb->zbuffer_size) !=
+      0)
+    return -1;
   status = curl_easy_perform(cb->curl);
 
   wh_log_http_error(cb);
@@ -134,10 +281,62 @@ static int wh_post_nolock(wh_callback_t *cb, char const *data) /* {{{ */
   return status;
 } /* }}} wh_post_nolock */
 
+/* wh_curl_setup applies the options of "cb" to "curl". */
+static void wh_curl_setup(wh_callback_t *cb, CURL *curl, /* {{{ */
+                          char *errbuf) {
+  if (cb->low_speed_limit > 0 && cb->low_speed_time > 0) {
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT,
+                     (long)(cb->low_speed_limit * cb->low_speed_time));
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)cb->low_speed_time);
+  }
+
+#ifdef HAVE_CURLOPT_TIMEOUT_MS
+  if (cb->timeout > 0)
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)cb->timeout);
+#endif
+
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, COLLECTD_USERAGENT);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, cb->headers);
+  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 50L);
+
+  if (cb->user != NULL) {
+#ifdef HAVE_CURLOPT_USERNAME
+    curl_easy_setopt(curl, CURLOPT_USERNAME, cb->user);
+    curl_easy_setopt(curl, CURLOPT_PASSWORD,
+                     (cb->pass == NULL) ? "" : cb->pass);
+#else
+    curl_easy_setopt(curl, CURLOPT_USERPWD, cb->credentials);
+#endif
+    curl_easy_setopt(curl, CURLOPT_HTTPAUTH, CURLAUTH_ANY);
+  }
+
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, (long)cb->verify_peer);
+  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, cb->verify_host ? 2L : 0L);
+  curl_easy_setopt(curl, CURLOPT_SSLVERSION, cb->sslversion);
+  if (cb->cacert != NULL)
+    curl_easy_setopt(curl, CURLOPT_CAINFO, cb->cacert);
+  if (cb->capath != NULL)
+    curl_easy_setopt(curl, CURLOPT_CAPATH, cb->capath);
+
+  if (cb->clientkey != NULL && cb->clientcert != NULL) {
+    curl_easy_setopt(curl, CURLOPT_SSLKEY, cb->clientkey);
+    curl_easy_setopt(curl, CURLOPT_SSLCERT, cb->clientcert);
+
+    if (cb->clientkeypass != NULL)
+      curl_easy_setopt(curl, CURLOPT_SSLKEYPASSWD, cb->clientkeypass);
+  }
+} /* }}} void wh_curl_setup */
+
+static int wh_async_start(wh_async_t *a);
+
+/* must hold cb->send_lock when calling */
 static int wh_callback_init(wh_callback_t *cb) /* {{{ */
 {
   if (cb->curl != NULL)
-    return 0;
+    return (cb->async != NULL) ? wh_async_start(cb->async) : 0;
 
   cb->curl = curl_easy_init();
   if (cb->curl == NULL) {
@@ -145,40 +344,20 @@ static int wh_callback_init(wh_callback_t *cb) /* {{{ */
     return -1;
   }
 
-  if (cb->low_speed_limit > 0 && cb->low_speed_time > 0) {
-    curl_easy_setopt(cb->curl, CURLOPT_LOW_SPEED_LIMIT,
-                     (long)(cb->low_speed_limit * cb->low_speed_time));
-    curl_easy_setopt(cb->curl, CURLOPT_LOW_SPEED_TIME,
-                     (long)cb->low_speed_time);
-  }
-
-#ifdef HAVE_CURLOPT_TIMEOUT_MS
-  if (cb->timeout > 0)
-    curl_easy_setopt(cb->curl, CURLOPT_TIMEOUT_MS, (long)cb->timeout);
-#endif
-
-  curl_easy_setopt(cb->curl, CURLOPT_NOSIGNAL, 1L);
-  curl_easy_setopt(cb->curl, CURLOPT_USERAGENT, COLLECTD_USERAGENT);
-
   cb->headers = curl_slist_append(cb->headers, "Accept:  */*");
   if (cb->format == WH_FORMAT_JSON || cb->format == WH_FORMAT_KAIROSDB)
     cb->headers =
         curl_slist_append(cb->headers, "Content-Type: application/json");
   else
     cb->headers = curl_slist_append(cb->headers, "Content-Type: text/plain");
+  if (cb->compression == WH_COMPRESSION_GZIP)
+    cb->headers = curl_slist_append(cb->headers, "Content-Encoding: gzip");
+  else if (cb->compression == WH_COMPRESSION_DEFLATE)
+    cb->headers = curl_slist_append(cb->headers, "Content-Encoding: deflate");
   cb->headers = curl_slist_append(cb->headers, "Expect:");
-  curl_easy_setopt(cb->curl, CURLOPT_HTTPHEADER, cb->headers);
-
-  curl_easy_setopt(cb->curl, CURLOPT_ERRORBUFFER, cb->curl_errbuf);
-  curl_easy_setopt(cb->curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(cb->curl, CURLOPT_MAXREDIRS, 50L);
 
+#ifndef HAVE_CURLOPT_USERNAME
   if (cb->user != NULL) {
-#ifdef HAVE_CURLOPT_USERNAME
-    curl_easy_setopt(cb->curl, CURLOPT_USERNAME, cb->user);
-    curl_easy_setopt(cb->curl, CURLOPT_PASSWORD,
-                     (cb->pass == NULL) ? "" : cb->pass);
-#else
     size_t credentials_size;
 
     credentials_size = strlen(cb->user) + 2;
@@ -193,31 +372,560 @@ static int wh_callback_init(wh_callback_t *cb) /* {{{ */
 
     snprintf(cb->credentials, credentials_size, "%s:%s", cb->user,
              (cb->pass == NULL) ? "" : cb->pass);
-    curl_easy_setopt(cb->curl, CURLOPT_USERPWD, cb->credentials);
+  }
 #endif
-    curl_easy_setopt(cb->curl, CURLOPT_HTTPAUTH, CURLAUTH_ANY);
+
+  wh_curl_setup(cb, cb->curl, cb->curl_errbuf);
+
+  wh_reset_buffer(cb);
+
+  return (cb->async != NULL) ? wh_async_start(cb->async) : 0;
+} /* }}} int wh_callback_init */
+
+/*
+ * Asynchronous mode
+ *
+ * Write threads format values into the send buffer as usual. When it is full
+ * or flushed, it is swapped with the (empty) buffer of a free request and the
+ * request is queued, so writers never wait for the network. A dedicated thread
+ * sends queued requests using the multi interface of libcurl, with up to
+ * "ConcurrentRequests" requests in flight over reused connections. Requests
+ * failing with a transport error or a 408, 429 or 5xx status are retried with
+ * exponential backoff, up to "MaxRetries" times. When all requests are in use,
+ * the oldest queued request is dropped.
+ */
+#if HAVE_CURL_MULTI_WAIT
+/* NOTE: You must hold a->lock when calling this function! */
+static void wh_async_wake(wh_async_t *a) {
+  char c = 0;
+
+  if (a->wake_pending)
+    return;
+  a->wake_pending = 1;
+
+  /* If the pipe is full, the sender thread will wake up anyway. */
+  if (write(a->wake_fd[1], &c, sizeof(c)) < 0)
+    a->wake_pending = 0;
+}
+
+/* NOTE: You must hold a->lock when calling this function! */
+static void wh_async_release(wh_async_t *a, wh_request_t *req) {
+  req->next = a->free;
+  a->free = req;
+}
+
+/* wh_async_get_request returns an unused request. When all requests are in
+ * use, the oldest queued request is dropped and returned.
+ * NOTE: You must hold a->lock when calling this function! */
+static wh_request_t *wh_async_get_request(wh_async_t *a) {
+  wh_request_t *req = NULL;
+
+  if (a->free != NULL) {
+    req = a->free;
+    a->free = req->next;
+  } else if (a->requests_num < a->requests_max) {
+    req = calloc(1, sizeof(*req));
+    if (req == NULL)
+      return NULL;
+    req->size = a->cb->send_buffer_size;
+    req->data = malloc(req->size);
+    if (req->data == NULL) {
+      sfree(req);
+      return NULL;
+    }
+    a->requests_num++;
+  } else if (a->queue_head != NULL) {
+    req = a->queue_head;
+    a->queue_head = req->next;
+    if (a->queue_head == NULL)
+      a->queue_tail = NULL;
+
+    c_complain(LOG_WARNING, &a->full_complaint,
+               "write_http plugin: The send queue for \"%s\" is full. "
+               "Dropping the oldest data.",
+               a->cb->name);
+  } else {
+    c_complain(LOG_WARNING, &a->full_complaint,
+               "write_http plugin: The send queue for \"%s\" is full. "
+               "Dropping new data.",
+               a->cb->name);
+    return NULL;
   }
 
-  curl_easy_setopt(cb->curl, CURLOPT_SSL_VERIFYPEER, (long)cb->verify_peer);
-  curl_easy_setopt(cb->curl, CURLOPT_SSL_VERIFYHOST, cb->verify_host ? 2L : 0L);
-  curl_easy_setopt(cb->curl, CURLOPT_SSLVERSION, cb->sslversion);
-  if (cb->cacert != NULL)
-    curl_easy_setopt(cb->curl, CURLOPT_CAINFO, cb->cacert);
-  if (cb->capath != NULL)
-    curl_easy_setopt(cb->curl, CURLOPT_CAPATH, cb->capath);
+  req->len = 0;
+  req->attempts = 0;
+  req->next_attempt = 0;
+  req->next = NULL;
+  return req;
+}
 
-  if (cb->clientkey != NULL && cb->clientcert != NULL) {
-    curl_easy_setopt(cb->curl, CURLOPT_SSLKEY, cb->clientkey);
-    curl_easy_setopt(cb->curl, CURLOPT_SSLCERT, cb->clientcert);
+/* NOTE: You must hold a->lock when calling this function! */
+static void wh_async_queue(wh_async_t *a, wh_request_t *req) {
+  if (a->queue_tail == NULL)
+    a->queue_head = req;
+  else
+    a->queue_tail->next = req;
+  a->queue_tail = req;
+
+  /* Only report recovery once the queue has drained completely, so that a
+   * sender running at the limit doesn't flood the log. */
+  if (a->queue_head == req)
+    c_release(LOG_INFO, &a->full_complaint,
+              "write_http plugin: The send queue for \"%s\" is no longer "
+              "full.",
+              a->cb->name);
+
+  wh_async_wake(a);
+}
 
-    if (cb->clientkeypass != NULL)
-      curl_easy_setopt(cb->curl, CURLOPT_SSLKEYPASSWD, cb->clientkeypass);
+/* wh_async_submit_buffer queues the first "len" bytes of "*buffer", which must
+ * be "send_buffer_size" bytes large, by swapping it with the buffer of a free
+ * request. Request buffers only ever grow, so the buffer returned in "*buffer"
+ * is at least as large. */
+static int wh_async_submit_buffer(wh_async_t *a, char **buffer, /* {{{ */
+                                  size_t len) {
+  pthread_mutex_lock(&a->lock);
+  wh_request_t *req = wh_async_get_request(a);
+  if (req == NULL) {
+    pthread_mutex_unlock(&a->lock);
+    return -1;
   }
 
-  wh_reset_buffer(cb);
+  assert(req->size >= a->cb->send_buffer_size);
+  char *tmp = req->data;
+  req->data = *buffer;
+  req->size = a->cb->send_buffer_size;
+  *buffer = tmp;
+  req->len = len;
 
+  wh_async_queue(a, req);
+  pthread_mutex_unlock(&a->lock);
   return 0;
-} /* }}} int wh_callback_init */
+} /* }}} int wh_async_submit_buffer */
+
+static int wh_async_submit_copy(wh_async_t *a, char const *data) /* {{{ */
+{
+  size_t len = strlen(data);
+
+  pthread_mutex_lock(&a->lock);
+  wh_request_t *req = wh_async_get_request(a);
+  if (req == NULL) {
+    pthread_mutex_unlock(&a->lock);
+    return -1;
+  }
+
+  if (req->size < len + 1) {
+    char *tmp = realloc(req->data, len + 1);
+    if (tmp == NULL) {
+      wh_async_release(a, req);
+      pthread_mutex_unlock(&a->lock);
+      return -1;
+    }
+    req->data = tmp;
+    req->size = len + 1;
+  }
+  memcpy(req->data, data, len + 1);
+  req->len = len;
+
+  wh_async_queue(a, req);
+  pthread_mutex_unlock(&a->lock);
+  return 0;
+} /* }}} int wh_async_submit_copy */
+
+static void wh_slot_start(wh_async_t *a, wh_slot_t *slot, /* {{{ */
+                          wh_request_t *req) {
+  wh_callback_t *cb = a->cb;
+
+  slot->req = req;
+  curl_easy_setopt(slot->curl, CURLOPT_URL, cb->location);
+  if (wh_set_body(cb, slot->curl, req->data, req->len, &slot->zbuffer,
+                  &slot->zbuffer_size) == 0) {
+    CURLMcode status = curl_multi_add_handle(a->multi, slot->curl);
+    if (status == CURLM_OK)
+      return;
+
+    ERROR("write_http plugin: curl_multi_add_handle failed: %s",
+          curl_multi_strerror(status));
+  }
+
+  slot->req = NULL;
+  pthread_mutex_lock(&a->lock);
+  wh_async_release(a, req);
+  pthread_mutex_unlock(&a->lock);
+} /* }}} void wh_slot_start */
+
+/* wh_slot_done handles the outcome of the request sent by "slot": the request
+ * is released on success and scheduled for another attempt on temporary
+ * failures. */
+static void wh_slot_done(wh_async_t *a, wh_slot_t *slot, /* {{{ */
+                         CURLcode result) {
+  wh_callback_t *cb = a->cb;
+  wh_request_t *req = slot->req;
+  long http_code = 0;
+  _Bool retry = 0;
+
+  slot->req = NULL;
+  curl_easy_getinfo(slot->curl, CURLINFO_RESPONSE_CODE, &http_code);
+
+  if (result != CURLE_OK) {
+    c_complain(LOG_ERR, &a->send_complaint,
+               "write_http plugin: Sending to \"%s\" failed with status %i: "
+               "%s",
+               cb->name, (int)result, slot->curl_errbuf);
+    retry = 1;
+  } else if ((http_code < 200) || (http_code >= 300)) {
+    if (cb->log_http_error)
+      INFO("write_http plugin: HTTP Error code: %lu", http_code);
+    retry = (http_code == 408) || (http_code == 429) || (http_code >= 500);
+    if (!retry)
+      c_complain(LOG_ERR, &a->send_complaint,
+                 "write_http plugin: \"%s\" rejected a request with HTTP "
+                 "status %ld. Dropping it.",
+                 cb->name, http_code);
+  } else {
+    c_release(LOG_INFO, &a->send_complaint,
+              "write_http plugin: Sending to \"%s\" succeeded again.",
+              cb->name);
+    if (cb->log_http_error && (http_code != 200))
+      INFO("write_http plugin: HTTP Error code: %lu", http_code);
+  }
+
+  if (retry && (req->attempts < cb->max_retries)) {
+    cdtime_t backoff = WH_RETRY_INTERVAL;
+    for (int i = 0; (i < req->attempts) && (backoff < WH_RETRY_INTERVAL_MAX);
+         i++)
+      backoff *= 2;
+    if (backoff > WH_RETRY_INTERVAL_MAX)
+      backoff = WH_RETRY_INTERVAL_MAX;
+
+    req->attempts++;
+    req->next_attempt = cdtime() + backoff;
+    req->next = NULL;
+    if (a->retry_tail == NULL)
+      a->retry_head = req;
+    else
+      a->retry_tail->next = req;
+    a->retry_tail = req;
+    return;
+  }
+
+  if (retry)
+    ERROR("write_http plugin: Giving up on a request to \"%s\" after %d "
+          "attempts.",
+          cb->name, req->attempts + 1);
+
+  pthread_mutex_lock(&a->lock);
+  wh_async_release(a, req);
+  pthread_mutex_unlock(&a->lock);
+} /* }}} void wh_slot_done */
+
+/* wh_async_next_retry removes and returns the first request that is due for a
+ * retry. Otherwise, "*wait" is lowered to the time until the next one is. */
+static wh_request_t *wh_async_next_retry(wh_async_t *a, cdtime_t now,
+                                         cdtime_t *wait) {
+  wh_request_t *prev = NULL;
+
+  for (wh_request_t *req = a->retry_head; req != NULL; req = req->next) {
+    if (req->next_attempt <= now) {
+      if (prev == NULL)
+        a->retry_head = req->next;
+      else
+        prev->next = req->next;
+      if (a->retry_tail == req)
+        a->retry_tail = prev;
+      req->next = NULL;
+      return req;
+    }
+
+    if (req->next_attempt - now < *wait)
+      *wait = req->next_attempt - now;
+    prev = req;
+  }
+
+  return NULL;
+}
+
+static void *wh_async_thread(void *arg) /* {{{ */
+{
+  wh_async_t *a = arg;
+  cdtime_t deadline = 0;
+
+  while (42) {
+    char buffer[64];
+    while (read(a->wake_fd[0], buffer, sizeof(buffer)) > 0)
+      /* drain */;
+
+    cdtime_t now = cdtime();
+    cdtime_t wait = TIME_T_TO_CDTIME_T(1);
+
+    /* Hand due retries, then queued requests, to idle slots. */
+    for (size_t i = 0; i < a->slots_num; i++) {
+      wh_slot_t *slot = a->slots + i;
+      if (slot->req != NULL)
+        continue;
+
+      wh_request_t *req = wh_async_next_retry(a, now, &wait);
+      if (req == NULL) {
+        pthread_mutex_lock(&a->lock);
+        a->wake_pending = 0;
+        req = a->queue_head;
+        if (req != NULL) {
+          a->queue_head = req->next;
+          if (a->queue_head == NULL)
+            a->queue_tail = NULL;
+          req->next = NULL;
+        }
+        pthread_mutex_unlock(&a->lock);
+      }
+      if (req == NULL)
+        break;
+
+      wh_slot_start(a, slot, req);
+    }
+
+    int running = 0;
+    CURLMcode mstatus = curl_multi_perform(a->multi, &running);
+    if (mstatus != CURLM_OK)
+      ERROR("write_http plugin: curl_multi_perform failed: %s",
+            curl_multi_strerror(mstatus));
+
+    CURLMsg *msg;
+    int queued = 0;
+    while ((msg = curl_multi_info_read(a->multi, &queued)) != NULL) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+
+      char *priv = NULL;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &priv);
+      wh_slot_t *slot = (wh_slot_t *)priv;
+      CURLcode result = msg->data.result;
+
+      /* msg is invalid after the handle has been removed. */
+      curl_multi_remove_handle(a->multi, slot->curl);
+      wh_slot_done(a, slot, result);
+      /* Start the next request right away. */
+      wait = 0;
+    }
+
+    pthread_mutex_lock(&a->lock);
+    _Bool stop = a->stop;
+    _Bool idle = (a->queue_head == NULL) && (a->retry_head == NULL);
+    pthread_mutex_unlock(&a->lock);
+    for (size_t i = 0; i < a->slots_num; i++)
+      idle = idle && (a->slots[i].req == NULL);
+
+    if (stop) {
+      if (deadline == 0)
+        deadline = now + WH_SHUTDOWN_TIMEOUT;
+      if (idle || (now >= deadline))
+        break;
+    }
+
+    if (wait > 0) {
+      struct curl_waitfd wake = {
+          .fd = a->wake_fd[0], .events = CURL_WAIT_POLLIN,
+      };
+      curl_multi_wait(a->multi, &wake, 1, (int)CDTIME_T_TO_MS(wait),
+                      /* numfds = */ NULL);
+    }
+  }
+
+  /* Drop what could not be sent. */
+  uint64_t lost = 0;
+  for (size_t i = 0; i < a->slots_num; i++) {
+    wh_slot_t *slot = a->slots + i;
+    if (slot->req == NULL)
+      continue;
+
+    curl_multi_remove_handle(a->multi, slot->curl);
+    lost += slot->req->len;
+    pthread_mutex_lock(&a->lock);
+    wh_async_release(a, slot->req);
+    pthread_mutex_unlock(&a->lock);
+    slot->req = NULL;
+  }
+
+  pthread_mutex_lock(&a->lock);
+  if (a->retry_tail != NULL) {
+    a->retry_tail->next = a->queue_head;
+    a->queue_head = a->retry_head;
+    a->retry_head = a->retry_tail = NULL;
+  }
+  while (a->queue_head != NULL) {
+    wh_request_t *req = a->queue_head;
+    a->queue_head = req->next;
+    lost += req->len;
+    wh_async_release(a, req);
+  }
+  a->queue_tail = NULL;
+  pthread_mutex_unlock(&a->lock);
+
+  if (lost > 0)
+    WARNING("write_http plugin: %" PRIu64 " bytes for \"%s\" could not be "
+            "sent before shutdown and have been dropped.",
+            lost, a->cb->name);
+
+  return NULL;
+} /* }}} void *wh_async_thread */
+
+/* NOTE: You must hold cb->send_lock when calling this function! */
+static int wh_async_start(wh_async_t *a) /* {{{ */
+{
+  char errbuf[1024];
+
+  if (a->thread_running)
+    return 0;
+
+  if (a->multi == NULL) {
+    a->multi = curl_multi_init();
+    if (a->multi == NULL) {
+      ERROR("write_http plugin: curl_multi_init failed.");
+      return -1;
+    }
+  }
+
+  for (size_t i = 0; i < a->slots_num; i++) {
+    wh_slot_t *slot = a->slots + i;
+    if (slot->curl != NULL)
+      continue;
+
+    slot->curl = curl_easy_init();
+    if (slot->curl == NULL) {
+      ERROR("write_http plugin: curl_easy_init failed.");
+      return -1;
+    }
+    wh_curl_setup(a->cb, slot->curl, slot->curl_errbuf);
+    curl_easy_setopt(slot->curl, CURLOPT_PRIVATE, slot);
+  }
+
+  if (pipe(a->wake_fd) != 0) {
+    ERROR("write_http plugin: pipe failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+  for (size_t i = 0; i < 2; i++)
+    fcntl(a->wake_fd[i], F_SETFL, fcntl(a->wake_fd[i], F_GETFL) | O_NONBLOCK);
+
+  int status = plugin_thread_create(&a->thread, /* attr = */ NULL,
+                                    wh_async_thread, a, "write_http");
+  if (status != 0) {
+    ERROR("write_http plugin: Starting the sender thread failed: %s",
+          sstrerror(status, errbuf, sizeof(errbuf)));
+    close(a->wake_fd[0]);
+    close(a->wake_fd[1]);
+    a->wake_fd[0] = a->wake_fd[1] = -1;
+    return -1;
+  }
+
+  a->thread_running = 1;
+  return 0;
+} /* }}} int wh_async_start */
+
+static int wh_async_create(wh_callback_t *cb) /* {{{ */
+{
+  wh_async_t *a = calloc(1, sizeof(*a));
+  if (a == NULL)
+    return ENOMEM;
+
+  a->cb = cb;
+  a->wake_fd[0] = a->wake_fd[1] = -1;
+  a->slots_num = (size_t)cb->concurrent_requests;
+  a->requests_max = a->slots_num * (1 + WH_QUEUE_FACTOR);
+  a->slots = calloc(a->slots_num, sizeof(*a->slots));
+  if (a->slots == NULL) {
+    sfree(a);
+    return ENOMEM;
+  }
+  C_COMPLAIN_INIT(&a->full_complaint);
+  C_COMPLAIN_INIT(&a->send_complaint);
+  pthread_mutex_init(&a->lock, NULL);
+
+  cb->async = a;
+  return 0;
+} /* }}} int wh_async_create */
+
+static void wh_request_list_free(wh_request_t *req) {
+  while (req != NULL) {
+    wh_request_t *next = req->next;
+    sfree(req->data);
+    sfree(req);
+    req = next;
+  }
+}
+
+/* wh_async_destroy waits for queued requests to be sent, for at most
+ * WH_SHUTDOWN_TIMEOUT, and stops the sender thread. */
+static void wh_async_destroy(wh_callback_t *cb) /* {{{ */
+{
+  wh_async_t *a = cb->async;
+
+  if (a == NULL)
+    return;
+
+  if (a->thread_running) {
+    pthread_mutex_lock(&a->lock);
+    a->stop = 1;
+    wh_async_wake(a);
+    pthread_mutex_unlock(&a->lock);
+
+    pthread_join(a->thread, NULL);
+    close(a->wake_fd[0]);
+    close(a->wake_fd[1]);
+  }
+
+  for (size_t i = 0; i < a->slots_num; i++) {
+    if (a->slots[i].curl != NULL)
+      curl_easy_cleanup(a->slots[i].curl);
+    sfree(a->slots[i].zbuffer);
+  }
+  sfree(a->slots);
+  if (a->multi != NULL)
+    curl_multi_cleanup(a->multi);
+
+  wh_request_list_free(a->queue_head);
+  wh_request_list_free(a->retry_head);
+  wh_request_list_free(a->free);
+
+  pthread_mutex_destroy(&a->lock);
+  sfree(a);
+  cb->async = NULL;
+} /* }}} void wh_async_destroy */
+#else /* !HAVE_CURL_MULTI_WAIT */
+static int wh_async_submit_buffer(wh_async_t *a, char **buffer, size_t len) {
+  return ENOTSUP;
+}
+
+static int wh_async_submit_copy(wh_async_t *a, char const *data) {
+  return ENOTSUP;
+}
+
+static int wh_async_start(wh_async_t *a) { return ENOTSUP; }
+
+static int wh_async_create(wh_callback_t *cb) {
+  ERROR("write_http plugin: \"AsyncSend\" is not supported by this version "
+        "of libcurl.");
+  return ENOTSUP;
+}
+
+static void wh_async_destroy(wh_callback_t *cb) {}
+#endif /* HAVE_CURL_MULTI_WAIT */
+
+/* wh_send_buffer_nolock sends the send buffer, or queues it in asynchronous
+ * mode, and resets it.
+ * NOTE: You must hold cb->send_lock when calling this function! */
+static int wh_send_buffer_nolock(wh_callback_t *cb) /* {{{ */
+{
+  int status;
+
+  if (cb->async != NULL)
+    status = wh_async_submit_buffer(cb->async, &cb->send_buffer,
+                                    cb->send_buffer_fill);
+  else
+    status = wh_post_nolock(cb, cb->send_buffer, cb->send_buffer_fill);
+
+  wh_reset_buffer(cb);
+  return status;
+} /* }}} int wh_send_buffer_nolock */
 
 static int wh_flush_nolock(cdtime_t timeout, wh_callback_t *cb) /* {{{ */
 {
@@ -242,8 +950,7 @@ static int wh_flush_nolock(cdtime_t timeout, wh_callback_t *cb) /* {{{ */
       return 0;
     }
 
-    status = wh_post_nolock(cb, cb->send_buffer);
-    wh_reset_buffer(cb);
+    status = wh_send_buffer_nolock(cb);
   } else if (cb->format == WH_FORMAT_JSON || cb->format == WH_FORMAT_KAIROSDB) {
     if (cb->send_buffer_fill <= 2) {
       cb->send_buffer_init_time = cdtime();
@@ -259,8 +966,7 @@ static int wh_flush_nolock(cdtime_t timeout, wh_callback_t *cb) /* {{{ */
       return status;
     }
 
-    status = wh_post_nolock(cb, cb->send_buffer);
-    wh_reset_buffer(cb);
+    status = wh_send_buffer_nolock(cb);
   } else {
     ERROR("write_http: wh_flush_nolock: "
           "Unknown format: %i",
@@ -308,6 +1014,8 @@ static void wh_callback_free(void *data) /* {{{ */
   if (cb->send_buffer != NULL)
     wh_flush_nolock(/* timeout = */ 0, cb);
 
+  wh_async_destroy(cb);
+
   if (cb->curl != NULL) {
     curl_easy_cleanup(cb->curl);
     cb->curl = NULL;
@@ -329,6 +1037,7 @@ static void wh_callback_free(void *data) /* {{{ */
   sfree(cb->clientcert);
   sfree(cb->clientkeypass);
   sfree(cb->send_buffer);
+  sfree(cb->zbuffer);
 
   sfree(cb);
 } /* }}} void wh_callback_free */
@@ -564,7 +1273,10 @@ static int wh_notify(notification_t const *n, user_data_t *ud) /* {{{ */
     return -1;
   }
 
-  status = wh_post_nolock(cb, alert);
+  if (cb->async != NULL)
+    status = wh_async_submit_copy(cb->async, alert);
+  else
+    status = wh_post_nolock(cb, alert, strlen(alert));
   pthread_mutex_unlock(&cb->send_lock);
 
   return status;
@@ -596,6 +1308,38 @@ static int config_set_format(wh_callback_t *cb, /* {{{ */
   return 0;
 } /* }}} int config_set_format */
 
+static int config_set_compression(wh_callback_t *cb, /* {{{ */
+                                  oconfig_item_t *ci) {
+  char *string = NULL;
+
+  int status = cf_util_get_string(ci, &string);
+  if (status != 0)
+    return status;
+
+  if (strcasecmp("None", string) == 0)
+    cb->compression = WH_COMPRESSION_NONE;
+#if HAVE_ZLIB
+  else if (strcasecmp("gzip", string) == 0)
+    cb->compression = WH_COMPRESSION_GZIP;
+  else if (strcasecmp("deflate", string) == 0)
+    cb->compression = WH_COMPRESSION_DEFLATE;
+#else
+  else if ((strcasecmp("gzip", string) == 0) ||
+           (strcasecmp("deflate", string) == 0)) {
+    ERROR("write_http plugin: Compression is not supported because the "
+          "plugin has been built without zlib.");
+    status = -1;
+  }
+#endif
+  else {
+    ERROR("write_http plugin: Invalid compression: %s", string);
+    status = -1;
+  }
+
+  sfree(string);
+  return status;
+} /* }}} int config_set_compression */
+
 static int wh_config_append_string(const char *name,
                                    struct curl_slist **dest, /* {{{ */
                                    oconfig_item_t *ci) {
@@ -638,6 +1382,10 @@ static int wh_config_node(oconfig_item_t *ci) /* {{{ */
   cb->send_notifications = 0;
   cb->data_ttl = 0;
   cb->sync_send = 0;
+  cb->compression = WH_COMPRESSION_NONE;
+  cb->async_send = 0;
+  cb->concurrent_requests = 4;
+  cb->max_retries = 3;
 
   pthread_mutex_init(&cb->send_lock, /* attr = */ NULL);
 
@@ -722,7 +1470,23 @@ static int wh_config_node(oconfig_item_t *ci) /* {{{ */
       status = wh_config_append_string("Header", &cb->headers, child);
     else if (strcasecmp("SyncSend", child->key) == 0)
       status = cf_util_get_boolean(child, &cb->sync_send);
-    else if (strcasecmp("Attribute", child->key) == 0) {
+    else if (strcasecmp("Compression", child->key) == 0)
+      status = config_set_compression(cb, child);
+    else if (strcasecmp("AsyncSend", child->key) == 0)
+      status = cf_util_get_boolean(child, &cb->async_send);
+    else if (strcasecmp("ConcurrentRequests", child->key) == 0) {
+      status = cf_util_get_int(child, &cb->concurrent_requests);
+      if ((status == 0) && (cb->concurrent_requests < 1)) {
+        ERROR("write_http plugin: `ConcurrentRequests' must be at least 1.");
+        status = EINVAL;
+      }
+    } else if (strcasecmp("MaxRetries", child->key) == 0) {
+      status = cf_util_get_int(child, &cb->max_retries);
+      if ((status == 0) && (cb->max_retries < 0)) {
+        ERROR("write_http plugin: `MaxRetries' must not be negative.");
+        status = EINVAL;
+      }
+    } else if (strcasecmp("Attribute", child->key) == 0) {
       char *key = NULL;
       char *val = NULL;
 
@@ -802,6 +1566,11 @@ static int wh_config_node(oconfig_item_t *ci) /* {{{ */
   /* Nulls the buffer and sets ..._free and ..._fill. */
   wh_reset_buffer(cb);
 
+  if (cb->async_send && (wh_async_create(cb) != 0)) {
+    wh_callback_free(cb);
+    return -1;
+  }
+
   snprintf(callback_name, sizeof(callback_name), "write_http/%s", cb->name);
   DEBUG("write_http: Registering write callback '%s' with URL '%s'",
         callback_name, cb->location);
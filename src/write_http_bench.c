@@ -0,0 +1,258 @@
+/**
+ * collectd - src/write_http_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Writes BENCH_VALUES values in JSON format from BENCH_THREADS threads to an
+ * in-process HTTP sink that answers each request after BENCH_DELAY_MS
+ * milliseconds, in synchronous and asynchronous mode, and reports throughput,
+ * the latency of the write callback and the number of bytes received.
+ * Build with "make bench_write_http".
+ */
+
+#include "write_http.c"
+
+#include "utils_latency.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define BENCH_VALUES 400000
+#define BENCH_THREADS 4
+#define BENCH_DELAY_MS 2
+#define BENCH_BUFFER_SIZE 65536
+
+/* cdtime() is mocked by libplugin_mock. */
+static cdtime_t bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TIMESPEC_TO_CDTIME_T(&ts);
+}
+
+/* bench_find returns the offset of "needle" in the first "len" bytes of
+ * "buffer", or "len" if it is not found. */
+static size_t bench_find(char const *buffer, size_t len, char const *needle) {
+  size_t needle_len = strlen(needle);
+
+  for (size_t i = 0; i + needle_len <= len; i++)
+    if (memcmp(buffer + i, needle, needle_len) == 0)
+      return i;
+  return len;
+}
+
+static uint64_t sink_requests;
+static uint64_t sink_bytes;
+static pthread_mutex_t sink_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *sink_conn(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  char buffer[16384];
+  size_t fill = 0;
+
+  while (42) {
+    size_t end = bench_find(buffer, fill, "\r\n\r\n");
+    if (end == fill) {
+      if (fill == sizeof(buffer))
+        break;
+      ssize_t n = read(fd, buffer + fill, sizeof(buffer) - fill);
+      if (n <= 0)
+        break;
+      fill += (size_t)n;
+      continue;
+    }
+
+    size_t header_len = end + 4;
+    size_t body_len = 0;
+    size_t cl = bench_find(buffer, end, "Content-Length:");
+    if (cl < end)
+      body_len = (size_t)strtoull(buffer + cl + strlen("Content-Length:"),
+                                  NULL, 10);
+
+    /* Discard the headers and the body. */
+    size_t todo = header_len + body_len;
+    while (todo > 0) {
+      if (fill == 0) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0)
+          goto out;
+        fill = (size_t)n;
+      }
+      size_t len = (todo < fill) ? todo : fill;
+      memmove(buffer, buffer + len, fill - len);
+      fill -= len;
+      todo -= len;
+    }
+
+    pthread_mutex_lock(&sink_lock);
+    sink_requests++;
+    sink_bytes += body_len;
+    pthread_mutex_unlock(&sink_lock);
+
+    usleep(1000 * BENCH_DELAY_MS);
+    char const *resp = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+    if (swrite(fd, resp, strlen(resp)) != 0)
+      break;
+  }
+
+out:
+  close(fd);
+  return NULL;
+}
+
+static void *sink_thread(void *arg) {
+  int listen_fd = (int)(intptr_t)arg;
+
+  while (42) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+      continue;
+
+    pthread_t t;
+    pthread_create(&t, NULL, sink_conn, (void *)(intptr_t)fd);
+    pthread_detach(t);
+  }
+
+  return NULL;
+}
+
+static int sink_start(void) {
+  struct sockaddr_in sa = {
+      .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  socklen_t sa_len = sizeof(sa);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if ((fd < 0) || (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) ||
+      (listen(fd, 128) != 0) ||
+      (getsockname(fd, (struct sockaddr *)&sa, &sa_len) != 0))
+    return -1;
+
+  pthread_t t;
+  pthread_create(&t, NULL, sink_thread, (void *)(intptr_t)fd);
+  return ntohs(sa.sin_port);
+}
+
+static data_source_t dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+static data_set_t ds = {"gauge", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+typedef struct {
+  wh_callback_t *cb;
+  size_t index;
+  latency_counter_t *latency;
+} bench_writer_t;
+
+static void *bench_writer(void *arg) {
+  bench_writer_t *w = arg;
+  value_list_t vl = VALUE_LIST_INIT;
+  value_t v;
+
+  vl.values = &v;
+  vl.values_len = 1;
+  vl.interval = TIME_T_TO_CDTIME_T(10);
+  sstrncpy(vl.host, "myhost.example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "bench", sizeof(vl.plugin));
+  snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%zu", w->index);
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+
+  for (size_t i = 0; i < BENCH_VALUES / BENCH_THREADS; i++) {
+    snprintf(vl.type_instance, sizeof(vl.type_instance), "metric%zu",
+             i % 1000);
+    v.gauge = (gauge_t)i;
+    vl.time = TIME_T_TO_CDTIME_T(1500000000) + i;
+
+    cdtime_t start = bench_now();
+    wh_write(&ds, &vl, &(user_data_t){.data = w->cb});
+    latency_counter_add(w->latency, bench_now() - start);
+  }
+
+  return NULL;
+}
+
+static void bench_run(char const *name, char const *url, _Bool async_send,
+                      int compression) {
+  wh_callback_t *cb = calloc(1, sizeof(*cb));
+  cb->name = strdup(name);
+  cb->location = strdup(url);
+  cb->format = WH_FORMAT_JSON;
+  cb->sslversion = CURL_SSLVERSION_DEFAULT;
+  cb->send_metrics = 1;
+  cb->compression = compression;
+  cb->concurrent_requests = 4;
+  cb->max_retries = 3;
+  cb->send_buffer_size = BENCH_BUFFER_SIZE;
+  cb->send_buffer = malloc(cb->send_buffer_size);
+  pthread_mutex_init(&cb->send_lock, NULL);
+  wh_reset_buffer(cb);
+  if (async_send && (wh_async_create(cb) != 0))
+    exit(1);
+
+  sink_requests = sink_bytes = 0;
+  latency_counter_t *latency = latency_counter_create();
+  bench_writer_t writers[BENCH_THREADS];
+  pthread_t threads[BENCH_THREADS];
+
+  cdtime_t start = bench_now();
+  for (size_t i = 0; i < BENCH_THREADS; i++) {
+    writers[i] = (bench_writer_t){
+        .cb = cb, .index = i, .latency = latency_counter_create(),
+    };
+    pthread_create(threads + i, NULL, bench_writer, writers + i);
+  }
+  for (size_t i = 0; i < BENCH_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    latency_counter_merge(latency, writers[i].latency);
+    latency_counter_destroy(writers[i].latency);
+  }
+  /* Flushes and waits for the sender thread. */
+  wh_callback_free(cb);
+  double elapsed = CDTIME_T_TO_DOUBLE(bench_now() - start);
+
+  printf("%-14s %9.0f values/s  write p50 %8.1f us  p99 %8.1f us  "
+         "max %8.1f us  %6" PRIu64 " requests  %6.1f MB\n",
+         name, BENCH_VALUES / elapsed,
+         1e6 * CDTIME_T_TO_DOUBLE(latency_counter_get_percentile(latency, 50)),
+         1e6 * CDTIME_T_TO_DOUBLE(latency_counter_get_percentile(latency, 99)),
+         1e6 * CDTIME_T_TO_DOUBLE(latency_counter_get_max(latency)),
+         sink_requests, (double)sink_bytes / 1e6);
+  latency_counter_destroy(latency);
+}
+
+int main(void) {
+  char url[64];
+
+  int port = sink_start();
+  if (port < 0)
+    return 1;
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d/", port);
+
+  curl_global_init(CURL_GLOBAL_SSL);
+
+  bench_run("sync", url, 0, WH_COMPRESSION_NONE);
+#if HAVE_CURL_MULTI_WAIT
+  bench_run("async", url, 1, WH_COMPRESSION_NONE);
+#if HAVE_ZLIB
+  bench_run("async gzip", url, 1, WH_COMPRESSION_GZIP);
+#endif
+#endif
+
+  return 0;
+}
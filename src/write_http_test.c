@@ -0,0 +1,426 @@
+/**
+ * collectd - src/write_http_test.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/* Requests are sent to an in-process HTTP sink, which records the request
+ * bodies and answers with scripted status codes. cdtime() is mocked by
+ * libplugin_mock, so the sender thread is given the real clock to schedule
+ * retries. The queue, retry and shutdown timings are shortened. */
+#define WH_QUEUE_FACTOR 2
+#define WH_RETRY_INTERVAL MS_TO_CDTIME_T(10)
+#define WH_SHUTDOWN_TIMEOUT MS_TO_CDTIME_T(200)
+#define cdtime test_cdtime
+#include "write_http.c"
+#undef cdtime
+
+#include "testing.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define SINK_MAX_REQUESTS 64
+#define SINK_MAX_SCRIPT 8
+/* Time waited for the sink to see a request before giving up. */
+#define TEST_WAIT_MS 5000
+
+cdtime_t test_cdtime(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TIMESPEC_TO_CDTIME_T(&ts);
+}
+
+static pthread_mutex_t sink_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sink_cond = PTHREAD_COND_INITIALIZER;
+static char *sink_bodies[SINK_MAX_REQUESTS];
+static size_t sink_requests;
+/* Status codes of the next responses; 200 once the script is used up. */
+static int sink_script[SINK_MAX_SCRIPT];
+static size_t sink_script_num;
+static size_t sink_script_pos;
+/* While set, responses are held back. */
+static _Bool sink_hold;
+static int sink_port;
+
+static void sink_reset(void) {
+  pthread_mutex_lock(&sink_lock);
+  for (size_t i = 0; i < sink_requests; i++)
+    sfree(sink_bodies[i]);
+  sink_requests = 0;
+  sink_script_num = sink_script_pos = 0;
+  sink_hold = 0;
+  pthread_cond_broadcast(&sink_cond);
+  pthread_mutex_unlock(&sink_lock);
+}
+
+static void sink_set_hold(_Bool hold) {
+  pthread_mutex_lock(&sink_lock);
+  sink_hold = hold;
+  pthread_cond_broadcast(&sink_cond);
+  pthread_mutex_unlock(&sink_lock);
+}
+
+static void sink_set_script(int const *status, size_t num) {
+  pthread_mutex_lock(&sink_lock);
+  memcpy(sink_script, status, num * sizeof(*status));
+  sink_script_num = num;
+  sink_script_pos = 0;
+  pthread_mutex_unlock(&sink_lock);
+}
+
+/* sink_wait waits until the sink has seen "num" requests. */
+static int sink_wait(size_t num) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += TEST_WAIT_MS / 1000;
+
+  int status = 0;
+  pthread_mutex_lock(&sink_lock);
+  while ((sink_requests < num) && (status == 0))
+    status = pthread_cond_timedwait(&sink_cond, &sink_lock, &ts);
+  pthread_mutex_unlock(&sink_lock);
+  return (sink_requests >= num) ? 0 : -1;
+}
+
+static size_t sink_count(void) {
+  pthread_mutex_lock(&sink_lock);
+  size_t n = sink_requests;
+  pthread_mutex_unlock(&sink_lock);
+  return n;
+}
+
+/* sink_body returns the body of the "i"th request, or an empty string. */
+static char const *sink_body(size_t i) {
+  pthread_mutex_lock(&sink_lock);
+  char const *body = (i < sink_requests) ? sink_bodies[i] : "";
+  pthread_mutex_unlock(&sink_lock);
+  return body;
+}
+
+static size_t sink_find(char const *buffer, size_t len, char const *needle) {
+  size_t needle_len = strlen(needle);
+
+  for (size_t i = 0; i + needle_len <= len; i++)
+    if (memcmp(buffer + i, needle, needle_len) == 0)
+      return i;
+  return len;
+}
+
+static void *sink_conn(void *arg) {
+  int fd = (int)(intptr_t)arg;
+  char buffer[4096];
+  size_t fill = 0;
+
+  while (42) {
+    size_t end = sink_find(buffer, fill, "\r\n\r\n");
+    size_t body_len = 0;
+    if (end < fill) {
+      size_t cl = sink_find(buffer, end, "Content-Length:");
+      if (cl < end)
+        body_len = (size_t)strtoull(buffer + cl + strlen("Content-Length:"),
+                                    NULL, 10);
+    }
+
+    if ((end == fill) || (fill < end + 4 + body_len)) {
+      if (fill == sizeof(buffer))
+        break;
+      ssize_t n = read(fd, buffer + fill, sizeof(buffer) - fill);
+      if (n <= 0)
+        break;
+      fill += (size_t)n;
+      continue;
+    }
+
+    char *body = calloc(1, body_len + 1);
+    memcpy(body, buffer + end + 4, body_len);
+    size_t len = end + 4 + body_len;
+    memmove(buffer, buffer + len, fill - len);
+    fill -= len;
+
+    pthread_mutex_lock(&sink_lock);
+    if (sink_requests < SINK_MAX_REQUESTS)
+      sink_bodies[sink_requests++] = body;
+    else
+      sfree(body);
+    int status = 200;
+    if (sink_script_pos < sink_script_num)
+      status = sink_script[sink_script_pos++];
+    pthread_cond_broadcast(&sink_cond);
+    while (sink_hold)
+      pthread_cond_wait(&sink_cond, &sink_lock);
+    pthread_mutex_unlock(&sink_lock);
+
+    char resp[128];
+    snprintf(resp, sizeof(resp),
+             "HTTP/1.1 %d Status\r\nContent-Length: 0\r\n\r\n", status);
+    if (swrite(fd, resp, strlen(resp)) != 0)
+      break;
+  }
+
+  close(fd);
+  return NULL;
+}
+
+static void *sink_thread(void *arg) {
+  int listen_fd = (int)(intptr_t)arg;
+
+  while (42) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+      continue;
+
+    pthread_t t;
+    pthread_create(&t, NULL, sink_conn, (void *)(intptr_t)fd);
+    pthread_detach(t);
+  }
+
+  return NULL;
+}
+
+static int sink_start(void) {
+  struct sockaddr_in sa = {
+      .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  socklen_t sa_len = sizeof(sa);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if ((fd < 0) || (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) ||
+      (listen(fd, 16) != 0) ||
+      (getsockname(fd, (struct sockaddr *)&sa, &sa_len) != 0))
+    return -1;
+
+  pthread_t t;
+  pthread_create(&t, NULL, sink_thread, (void *)(intptr_t)fd);
+  pthread_detach(t);
+  sink_port = ntohs(sa.sin_port);
+  return 0;
+}
+
+/* test_callback returns an asynchronous callback sending to the sink, with
+ * its sender thread running. */
+static wh_callback_t *test_callback(int concurrent_requests, int max_retries) {
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%d/", sink_port);
+
+  wh_callback_t *cb = calloc(1, sizeof(*cb));
+  cb->name = strdup("test");
+  cb->location = strdup(url);
+  cb->format = WH_FORMAT_COMMAND;
+  cb->sslversion = CURL_SSLVERSION_DEFAULT;
+  cb->send_metrics = 1;
+  cb->async_send = 1;
+  cb->concurrent_requests = concurrent_requests;
+  cb->max_retries = max_retries;
+  cb->send_buffer_size = 1024;
+  cb->send_buffer = malloc(cb->send_buffer_size);
+  pthread_mutex_init(&cb->send_lock, NULL);
+  if ((wh_async_create(cb) != 0) || (wh_callback_init(cb) != 0)) {
+    wh_callback_free(cb);
+    return NULL;
+  }
+  return cb;
+}
+
+static int test_submit(wh_callback_t *cb, char const *data) {
+  pthread_mutex_lock(&cb->send_lock);
+  int status = wh_async_submit_copy(cb->async, data);
+  pthread_mutex_unlock(&cb->send_lock);
+  return status;
+}
+
+DEF_TEST(queue) {
+  sink_reset();
+  wh_callback_t *cb = test_callback(/* concurrent_requests = */ 1,
+                                    /* max_retries = */ 0);
+  CHECK_NOT_NULL(cb);
+
+  /* One request in flight and WH_QUEUE_FACTOR waiting fit without drops. */
+  char data[16];
+  for (int i = 0; i < 1 + WH_QUEUE_FACTOR; i++) {
+    snprintf(data, sizeof(data), "request %d", i);
+    EXPECT_EQ_INT(0, test_submit(cb, data));
+  }
+  CHECK_ZERO(sink_wait(1 + WH_QUEUE_FACTOR));
+
+  /* Values written through the send buffer are queued on flush. */
+  data_source_t dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+  data_set_t ds = {"gauge", STATIC_ARRAY_SIZE(dsrc), dsrc};
+  value_list_t vl = VALUE_LIST_INIT;
+  vl.values = &(value_t){.gauge = 42};
+  vl.values_len = 1;
+  vl.time = TIME_T_TO_CDTIME_T(1500000000);
+  vl.interval = TIME_T_TO_CDTIME_T(10);
+  sstrncpy(vl.host, "example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "test", sizeof(vl.plugin));
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+  EXPECT_EQ_INT(0, wh_write(&ds, &vl, &(user_data_t){.data = cb}));
+  EXPECT_EQ_INT(1 + WH_QUEUE_FACTOR, (int)sink_count());
+  EXPECT_EQ_INT(0, wh_flush(0, NULL, &(user_data_t){.data = cb}));
+  CHECK_ZERO(sink_wait(2 + WH_QUEUE_FACTOR));
+
+  for (int i = 0; i < 1 + WH_QUEUE_FACTOR; i++) {
+    snprintf(data, sizeof(data), "request %d", i);
+    EXPECT_EQ_STR(data, sink_body((size_t)i));
+  }
+  char const *putval = sink_body(1 + WH_QUEUE_FACTOR);
+  OK(strncmp(putval, "PUTVAL example.com/test/gauge ", 30) == 0);
+
+  wh_callback_free(cb);
+  EXPECT_EQ_INT(2 + WH_QUEUE_FACTOR, (int)sink_count());
+  return 0;
+}
+
+DEF_TEST(drop_oldest) {
+  sink_reset();
+  sink_set_hold(1);
+  wh_callback_t *cb = test_callback(/* concurrent_requests = */ 1,
+                                    /* max_retries = */ 0);
+  CHECK_NOT_NULL(cb);
+
+  /* The first request occupies the only connection ... */
+  EXPECT_EQ_INT(0, test_submit(cb, "first"));
+  CHECK_ZERO(sink_wait(1));
+
+  /* ... so only WH_QUEUE_FACTOR requests can wait. Older ones are dropped. */
+  char data[16];
+  for (int i = 0; i < WH_QUEUE_FACTOR + 3; i++) {
+    snprintf(data, sizeof(data), "request %d", i);
+    EXPECT_EQ_INT(0, test_submit(cb, data));
+  }
+  EXPECT_EQ_INT(1, (int)sink_count());
+
+  sink_set_hold(0);
+  CHECK_ZERO(sink_wait(1 + WH_QUEUE_FACTOR));
+  wh_callback_free(cb);
+
+  EXPECT_EQ_INT(1 + WH_QUEUE_FACTOR, (int)sink_count());
+  EXPECT_EQ_STR("first", sink_body(0));
+  for (int i = 0; i < WH_QUEUE_FACTOR; i++) {
+    snprintf(data, sizeof(data), "request %d", i + 3);
+    EXPECT_EQ_STR(data, sink_body((size_t)i + 1));
+  }
+  return 0;
+}
+
+DEF_TEST(retry) {
+  /* 408, 429 and 5xx responses are retried ... */
+  sink_reset();
+  sink_set_script((int[]){503, 429, 408}, 3);
+  wh_callback_t *cb = test_callback(/* concurrent_requests = */ 1,
+                                    /* max_retries = */ 3);
+  CHECK_NOT_NULL(cb);
+  EXPECT_EQ_INT(0, test_submit(cb, "retried"));
+  CHECK_ZERO(sink_wait(4));
+  wh_callback_free(cb);
+  EXPECT_EQ_INT(4, (int)sink_count());
+  for (size_t i = 0; i < 4; i++)
+    EXPECT_EQ_STR("retried", sink_body(i));
+
+  /* ... up to MaxRetries times ... */
+  sink_reset();
+  sink_set_script((int[]){500, 500}, 2);
+  cb = test_callback(/* concurrent_requests = */ 1, /* max_retries = */ 1);
+  CHECK_NOT_NULL(cb);
+  EXPECT_EQ_INT(0, test_submit(cb, "lost"));
+  CHECK_ZERO(sink_wait(2));
+  EXPECT_EQ_INT(0, test_submit(cb, "next"));
+  CHECK_ZERO(sink_wait(3));
+  wh_callback_free(cb);
+  EXPECT_EQ_INT(3, (int)sink_count());
+  EXPECT_EQ_STR("lost", sink_body(0));
+  EXPECT_EQ_STR("lost", sink_body(1));
+  EXPECT_EQ_STR("next", sink_body(2));
+
+  /* ... while other errors are not. */
+  sink_reset();
+  sink_set_script((int[]){400}, 1);
+  cb = test_callback(/* concurrent_requests = */ 1, /* max_retries = */ 3);
+  CHECK_NOT_NULL(cb);
+  EXPECT_EQ_INT(0, test_submit(cb, "rejected"));
+  CHECK_ZERO(sink_wait(1));
+  EXPECT_EQ_INT(0, test_submit(cb, "next"));
+  CHECK_ZERO(sink_wait(2));
+  wh_callback_free(cb);
+  EXPECT_EQ_INT(2, (int)sink_count());
+  EXPECT_EQ_STR("rejected", sink_body(0));
+  EXPECT_EQ_STR("next", sink_body(1));
+  return 0;
+}
+
+DEF_TEST(shutdown_drain) {
+  /* Queued requests are sent before the sender thread exits ... */
+  sink_reset();
+  wh_callback_t *cb = test_callback(/* concurrent_requests = */ 2,
+                                    /* max_retries = */ 0);
+  CHECK_NOT_NULL(cb);
+
+  char data[16];
+  for (int i = 0; i < 6; i++) {
+    snprintf(data, sizeof(data), "request %d", i);
+    EXPECT_EQ_INT(0, test_submit(cb, data));
+  }
+  wh_callback_free(cb);
+
+  EXPECT_EQ_INT(6, (int)sink_count());
+  for (int i = 0; i < 6; i++) {
+    _Bool found = 0;
+    snprintf(data, sizeof(data), "request %d", i);
+    for (size_t j = 0; j < 6; j++)
+      found = found || (strcmp(data, sink_body(j)) == 0);
+    OK1(found, data);
+  }
+
+  /* ... but no longer than WH_SHUTDOWN_TIMEOUT. */
+  sink_reset();
+  sink_set_hold(1);
+  cb = test_callback(/* concurrent_requests = */ 1, /* max_retries = */ 0);
+  CHECK_NOT_NULL(cb);
+  EXPECT_EQ_INT(0, test_submit(cb, "stuck"));
+  EXPECT_EQ_INT(0, test_submit(cb, "dropped"));
+  CHECK_ZERO(sink_wait(1));
+
+  cdtime_t start = test_cdtime();
+  wh_callback_free(cb);
+  cdtime_t elapsed = test_cdtime() - start;
+  OK(elapsed >= WH_SHUTDOWN_TIMEOUT / 2);
+  OK(elapsed < WH_SHUTDOWN_TIMEOUT + TIME_T_TO_CDTIME_T(2));
+  EXPECT_EQ_INT(1, (int)sink_count());
+
+  sink_set_hold(0);
+  return 0;
+}
+
+int main(void) {
+  /* Held responses may be written to connections closed by the plugin. */
+  signal(SIGPIPE, SIG_IGN);
+  curl_global_init(CURL_GLOBAL_SSL);
+  CHECK_ZERO(sink_start());
+
+#if HAVE_CURL_MULTI_WAIT
+  RUN_TEST(queue);
+  RUN_TEST(drop_oldest);
+  RUN_TEST(retry);
+  RUN_TEST(shutdown_drain);
+#endif
+
+  sink_reset();
+  END_TEST;
+}
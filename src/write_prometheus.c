@@ -36,6 +36,10 @@
 
 #include <microhttpd.h>
 
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #ifndef PROMETHEUS_DEFAULT_STALENESS_DELTA
 #define PROMETHEUS_DEFAULT_STALENESS_DELTA TIME_T_TO_CDTIME_T_STATIC(300)
 #endif
@@ -47,13 +51,105 @@
   "encoding=delimited"
 #define CONTENT_TYPE_TEXT "text/plain; version=0.0.4"
 
+#ifndef PROMETHEUS_DEFAULT_RENDER_INTERVAL
+#define PROMETHEUS_DEFAULT_RENDER_INTERVAL TIME_T_TO_CDTIME_T_STATIC(1)
+#endif
+
+/* Block size used when handing a snapshot to microhttpd. */
+#define RESPONSE_BLOCK_SIZE 65536
+
+/* Tag of the "metric" field (4, length-delimited) of a MetricFamily. */
+#define METRIC_FAMILY_METRIC_TAG ((4 << 3) | 2)
+
+/* prom_family_t and prom_metric_t extend the protobuf messages with their
+ * pre-rendered representation. The protobuf message must be the first member
+ * so that pointers can be converted in both directions. */
+typedef struct {
+  Io__Prometheus__Client__Metric pb;
+
+  /* The text line, i.e. 'name{labels} value timestamp\n'. The part up to and
+   * including the space after the labels never changes. */
+  char *text;
+  size_t text_len;
+  size_t text_size;
+  size_t text_prefix_len;
+
+  /* The metric packed as "metric" field of a MetricFamily, including tag and
+   * length. Only maintained once a client has asked for protobuf. */
+  uint8_t *proto;
+  size_t proto_len;
+  _Bool proto_dirty;
+} prom_metric_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t len;
+  size_t size;
+} prom_buffer_t;
+
+/* A chunk is the complete exposition of one metric family. Chunks are
+ * immutable once rendered and shared between the family and the snapshot
+ * being assembled from them. "refs" is protected by metrics_lock. */
+typedef struct {
+  prom_buffer_t text;
+  /* The family in delimited ProtoBuf format. Only rendered once a client has
+   * asked for protobuf. */
+  prom_buffer_t proto;
+  size_t refs;
+} prom_chunk_t;
+
+typedef struct {
+  Io__Prometheus__Client__MetricFamily pb;
+
+  char *text_header;
+  size_t text_header_len;
+
+  /* The family packed without any metrics. */
+  uint8_t *proto_header;
+  size_t proto_header_len;
+
+  /* The last rendered chunk and whether a metric has changed since. */
+  prom_chunk_t *chunk;
+  _Bool dirty;
+} prom_family_t;
+
+/* A snapshot is a complete, immutable exposition of all metrics. It is
+ * replaced by the render thread and kept alive by reference counting while
+ * responses are using it. */
+enum { FORMAT_TEXT = 0, FORMAT_PROTO, FORMAT_NUM };
+enum { ENCODING_PLAIN = 0, ENCODING_GZIP, ENCODING_NUM };
+
+typedef struct {
+  prom_buffer_t body[FORMAT_NUM][ENCODING_NUM];
+  uint64_t generation;
+  size_t refs;
+} prom_snapshot_t;
+
+typedef struct {
+  prom_snapshot_t *snapshot;
+  prom_buffer_t const *body;
+} prom_response_t;
+
 static c_avl_tree_t *metrics;
 static pthread_mutex_t metrics_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Incremented whenever "metrics" changes. Protected by metrics_lock. */
+static uint64_t metrics_generation = 1;
+
+static prom_snapshot_t *snapshot;
+static _Bool want_proto_render;
+static _Bool want_gzip_render;
+static pthread_mutex_t snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t render_thread;
+static _Bool render_thread_running;
+static _Bool render_thread_stop;
+static pthread_cond_t render_cond = PTHREAD_COND_INITIALIZER;
 
 static unsigned short httpd_port = 9103;
 static struct MHD_Daemon *httpd;
 
 static cdtime_t staleness_delta = PROMETHEUS_DEFAULT_STALENESS_DELTA;
+static cdtime_t render_interval = PROMETHEUS_DEFAULT_RENDER_INTERVAL;
 
 /* Unfortunately, protoc-c doesn't export it's implementation of varint, so we
  * need to implement our own. */
@@ -72,30 +168,39 @@ static size_t varint(uint8_t buffer[static VARINT_UINT32_BYTES],
   return 0;
 }
 
-/* format_protobuf iterates over all metric families in "metrics" and adds them
- * to a buffer in ProtoBuf format. It prefixes each protobuf with its encoded
- * size, the so called "delimited" format. */
-static void format_protobuf(ProtobufCBuffer *buffer) {
-  pthread_mutex_lock(&metrics_lock);
+static int buffer_reserve(prom_buffer_t *b, size_t len) {
+  if ((b->size - b->len) >= len)
+    return 0;
 
-  char *unused_name;
-  Io__Prometheus__Client__MetricFamily *fam;
-  c_avl_iterator_t *iter = c_avl_get_iterator(metrics);
-  while (c_avl_iterator_next(iter, (void *)&unused_name, (void *)&fam) == 0) {
-    /* Prometheus uses a message length prefix to determine where one
-     * MetricFamily ends and the next begins. This delimiter is encoded as a
-     * "varint", which is common in Protobufs. */
-    uint8_t delim[VARINT_UINT32_BYTES] = {0};
-    size_t delim_len = varint(
-        delim,
-        (uint32_t)io__prometheus__client__metric_family__get_packed_size(fam));
-    buffer->append(buffer, delim_len, delim);
+  size_t size = (b->size > 0) ? b->size : 4096;
+  while ((size - b->len) < len)
+    size *= 2;
 
-    io__prometheus__client__metric_family__pack_to_buffer(fam, buffer);
-  }
-  c_avl_iterator_destroy(iter);
+  uint8_t *tmp = realloc(b->data, size);
+  if (tmp == NULL)
+    return ENOMEM;
+  b->data = tmp;
+  b->size = size;
+  return 0;
+}
 
-  pthread_mutex_unlock(&metrics_lock);
+static int buffer_append(prom_buffer_t *b, void const *data, size_t len) {
+  if (len == 0)
+    return 0;
+
+  int status = buffer_reserve(b, len);
+  if (status != 0)
+    return status;
+
+  memcpy(b->data + b->len, data, len);
+  b->len += len;
+  return 0;
+}
+
+static void buffer_reset(prom_buffer_t *b) {
+  sfree(b->data);
+  b->len = 0;
+  b->size = 0;
 }
 
 static char const *escape_label_value(char *buffer, size_t buffer_size,
@@ -167,60 +272,466 @@ static char *format_labels(char *buffer, size_t buffer_size,
   return buffer;
 }
 
-/* format_protobuf iterates over all metric families in "metrics" and adds them
- * to a buffer in plain text format. */
-static void format_text(ProtobufCBuffer *buffer) {
-  pthread_mutex_lock(&metrics_lock);
+/* metric_render_text updates the text line of "m" after its value has
+ * changed. The label part is only formatted the first time. */
+static int metric_render_text(prom_metric_t *m, char const *name, int type) {
+  if (m->text == NULL) {
+    char labels[1024];
+    char prefix[2048];
+
+    ssnprintf(prefix, sizeof(prefix), "%s{%s} ", name,
+              format_labels(labels, sizeof(labels), &m->pb));
+    size_t len = strlen(prefix);
+
+    /* Enough for most values and timestamps, grown below if necessary. */
+    m->text_size = len + 48;
+    m->text = malloc(m->text_size);
+    if (m->text == NULL)
+      return ENOMEM;
+    memcpy(m->text, prefix, len);
+    m->text_prefix_len = len;
+  }
 
-  char *unused_name;
-  Io__Prometheus__Client__MetricFamily *fam;
-  c_avl_iterator_t *iter = c_avl_get_iterator(metrics);
-  while (c_avl_iterator_next(iter, (void *)&unused_name, (void *)&fam) == 0) {
-    char line[1024]; /* 4x DATA_MAX_NAME_LEN? */
+  char timestamp_ms[24] = "";
+  if (m->pb.has_timestamp_ms)
+    ssnprintf(timestamp_ms, sizeof(timestamp_ms), " %" PRIi64,
+              m->pb.timestamp_ms);
+
+  while (42) {
+    char *ptr = m->text + m->text_prefix_len;
+    size_t size = m->text_size - m->text_prefix_len;
+    int len;
+
+    if (type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
+      len = snprintf(ptr, size, GAUGE_FORMAT "%s\n", m->pb.gauge->value,
+                     timestamp_ms);
+    else /* if (type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__COUNTER) */
+      len = snprintf(ptr, size, "%.0f%s\n", m->pb.counter->value,
+                     timestamp_ms);
+    if (len < 0)
+      return EINVAL;
+
+    if ((size_t)len < size) {
+      m->text_len = m->text_prefix_len + (size_t)len;
+      return 0;
+    }
+
+    char *tmp = realloc(m->text, m->text_prefix_len + (size_t)len + 1);
+    if (tmp == NULL)
+      return ENOMEM;
+    m->text = tmp;
+    m->text_size = m->text_prefix_len + (size_t)len + 1;
+  }
+}
+
+/* metric_render_proto packs "m" as a "metric" field of a MetricFamily, i.e.
+ * with tag and length prefix, so that families can be assembled by
+ * concatenation. */
+static int metric_render_proto(prom_metric_t *m) {
+  if (!m->proto_dirty && (m->proto != NULL))
+    return 0;
+
+  size_t len = io__prometheus__client__metric__get_packed_size(&m->pb);
+  uint8_t delim[VARINT_UINT32_BYTES] = {0};
+  size_t delim_len = varint(delim, (uint32_t)len);
+
+  uint8_t *tmp = realloc(m->proto, 1 + delim_len + len);
+  if (tmp == NULL)
+    return ENOMEM;
+  m->proto = tmp;
+
+  m->proto[0] = METRIC_FAMILY_METRIC_TAG;
+  memcpy(m->proto + 1, delim, delim_len);
+  io__prometheus__client__metric__pack(&m->pb, m->proto + 1 + delim_len);
+  m->proto_len = 1 + delim_len + len;
+  m->proto_dirty = 0;
+  return 0;
+}
+
+/* family_render_proto_header packs "fam" without its metrics. */
+static int family_render_proto_header(prom_family_t *fam) {
+  if (fam->proto_header != NULL)
+    return 0;
+
+  Io__Prometheus__Client__MetricFamily header = fam->pb;
+  header.n_metric = 0;
+  header.metric = NULL;
+
+  size_t len = io__prometheus__client__metric_family__get_packed_size(&header);
+  fam->proto_header = malloc(len > 0 ? len : 1);
+  if (fam->proto_header == NULL)
+    return ENOMEM;
+  io__prometheus__client__metric_family__pack(&header, fam->proto_header);
+  fam->proto_header_len = len;
+  return 0;
+}
+
+static void chunk_destroy(prom_chunk_t *c) {
+  if (c == NULL)
+    return;
+
+  buffer_reset(&c->text);
+  buffer_reset(&c->proto);
+  sfree(c);
+}
+
+/* chunk_unref drops a reference to "c" and returns "c" if it is no longer
+ * used, so that it can be destroyed after releasing metrics_lock.
+ * NOTE: You must hold metrics_lock when calling this function! */
+static prom_chunk_t *chunk_unref(prom_chunk_t *c) {
+  if (c == NULL)
+    return NULL;
+
+  assert(c->refs > 0);
+  c->refs--;
+  return (c->refs == 0) ? c : NULL;
+}
+
+/* family_render_proto adds "fam" to "b" in ProtoBuf format, prefixed with its
+ * encoded size, the so called "delimited" format.
+ * NOTE: You must hold metrics_lock when calling this function! */
+static int family_render_proto(prom_buffer_t *b, prom_family_t *fam) {
+  int status = family_render_proto_header(fam);
+  if (status != 0)
+    return status;
+
+  size_t fam_len = fam->proto_header_len;
+  for (size_t i = 0; i < fam->pb.n_metric; i++) {
+    prom_metric_t *m = (prom_metric_t *)fam->pb.metric[i];
+    status = metric_render_proto(m);
+    if (status != 0)
+      return status;
+    fam_len += m->proto_len;
+  }
 
-    ssnprintf(line, sizeof(line), "# HELP %s %s\n", fam->name, fam->help);
-    buffer->append(buffer, strlen(line), (uint8_t *)line);
+  /* Prometheus uses a message length prefix to determine where one
+   * MetricFamily ends and the next begins. This delimiter is encoded as a
+   * "varint", which is common in Protobufs. */
+  uint8_t delim[VARINT_UINT32_BYTES] = {0};
+  size_t delim_len = varint(delim, (uint32_t)fam_len);
+
+  status = buffer_reserve(b, delim_len + fam_len);
+  if (status != 0)
+    return status;
+  buffer_append(b, delim, delim_len);
+  buffer_append(b, fam->proto_header, fam->proto_header_len);
+  for (size_t i = 0; i < fam->pb.n_metric; i++) {
+    prom_metric_t *m = (prom_metric_t *)fam->pb.metric[i];
+    buffer_append(b, m->proto, m->proto_len);
+  }
+
+  return 0;
+}
 
-    ssnprintf(line, sizeof(line), "# TYPE %s %s\n", fam->name,
-             (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
-                 ? "gauge"
-                 : "counter");
-    buffer->append(buffer, strlen(line), (uint8_t *)line);
+/* family_render creates a new chunk holding "fam" in plain text format and,
+ * if "want_proto" is true, in ProtoBuf format. The metrics' text lines are
+ * kept up to date by the writers, so this is mostly copying.
+ * NOTE: You must hold metrics_lock when calling this function! */
+static prom_chunk_t *family_render(prom_family_t *fam, _Bool want_proto) {
+  prom_chunk_t *c = calloc(1, sizeof(*c));
+  if (c == NULL)
+    return NULL;
 
-    for (size_t i = 0; i < fam->n_metric; i++) {
-      Io__Prometheus__Client__Metric *m = fam->metric[i];
+  size_t text_len = fam->text_header_len;
+  for (size_t i = 0; i < fam->pb.n_metric; i++)
+    text_len += ((prom_metric_t *)fam->pb.metric[i])->text_len;
 
-      char labels[1024];
+  int status = buffer_reserve(&c->text, text_len);
+  if (status == 0)
+    status = buffer_append(&c->text, fam->text_header, fam->text_header_len);
+  for (size_t i = 0; (status == 0) && (i < fam->pb.n_metric); i++) {
+    prom_metric_t *m = (prom_metric_t *)fam->pb.metric[i];
+    status = buffer_append(&c->text, m->text, m->text_len);
+  }
 
-      char timestamp_ms[24] = "";
-      if (m->has_timestamp_ms)
-        ssnprintf(timestamp_ms, sizeof(timestamp_ms), " %" PRIi64,
-                 m->timestamp_ms);
+  if ((status == 0) && want_proto)
+    status = family_render_proto(&c->proto, fam);
 
-      if (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
-        ssnprintf(line, sizeof(line), "%s{%s} " GAUGE_FORMAT "%s\n", fam->name,
-                 format_labels(labels, sizeof(labels), m), m->gauge->value,
-                 timestamp_ms);
-      else /* if (fam->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__COUNTER) */
-        ssnprintf(line, sizeof(line), "%s{%s} %.0f%s\n", fam->name,
-                 format_labels(labels, sizeof(labels), m), m->counter->value,
-                 timestamp_ms);
+  if (status != 0) {
+    chunk_destroy(c);
+    return NULL;
+  }
 
-      buffer->append(buffer, strlen(line), (uint8_t *)line);
+  c->refs = 1;
+  return c;
+}
+
+/* snapshot_collect re-renders the chunks of all families that have changed
+ * and returns references to the chunks of all families in "ret_chunks".
+ * NOTE: You must hold metrics_lock when calling this function! */
+static int snapshot_collect(prom_chunk_t ***ret_chunks, size_t *ret_chunks_num,
+                            _Bool want_proto) {
+  int families_num = c_avl_size(metrics);
+  prom_chunk_t **chunks =
+      calloc((families_num > 0) ? (size_t)families_num : 1, sizeof(*chunks));
+  if (chunks == NULL)
+    return ENOMEM;
+
+  char *unused_name;
+  prom_family_t *fam;
+  size_t chunks_num = 0;
+  int status = 0;
+
+  c_avl_iterator_t *iter = c_avl_get_iterator(metrics);
+  while (c_avl_iterator_next(iter, (void *)&unused_name, (void *)&fam) == 0) {
+    prom_chunk_t *c = fam->chunk;
+
+    if (fam->dirty || (c == NULL) || (want_proto && (c->proto.data == NULL))) {
+      c = family_render(fam, want_proto);
+      if (c == NULL) {
+        status = ENOMEM;
+        break;
+      }
+      chunk_destroy(chunk_unref(fam->chunk));
+      fam->chunk = c;
+      fam->dirty = 0;
     }
+
+    c->refs++;
+    chunks[chunks_num] = c;
+    chunks_num++;
   }
   c_avl_iterator_destroy(iter);
 
+  if (status != 0) {
+    for (size_t i = 0; i < chunks_num; i++)
+      chunks[i]->refs--;
+    sfree(chunks);
+    return status;
+  }
+
+  *ret_chunks = chunks;
+  *ret_chunks_num = chunks_num;
+  return 0;
+}
+
+/* snapshot_assemble concatenates the chunks into the snapshot's bodies. */
+static int snapshot_assemble(prom_snapshot_t *s, prom_chunk_t **chunks,
+                             size_t chunks_num, _Bool want_proto) {
+  prom_buffer_t *text = &s->body[FORMAT_TEXT][ENCODING_PLAIN];
+  prom_buffer_t *proto = &s->body[FORMAT_PROTO][ENCODING_PLAIN];
+  size_t text_len = 0;
+  size_t proto_len = 0;
+
+  for (size_t i = 0; i < chunks_num; i++) {
+    text_len += chunks[i]->text.len;
+    proto_len += chunks[i]->proto.len;
+  }
+
   char server[1024];
   ssnprintf(server, sizeof(server), "\n# collectd/write_prometheus %s at %s\n",
-           PACKAGE_VERSION, hostname_g);
-  buffer->append(buffer, strlen(server), (uint8_t *)server);
+            PACKAGE_VERSION, hostname_g);
+
+  int status = buffer_reserve(text, text_len + strlen(server));
+  if (status != 0)
+    return status;
+  for (size_t i = 0; i < chunks_num; i++)
+    buffer_append(text, chunks[i]->text.data, chunks[i]->text.len);
+  buffer_append(text, server, strlen(server));
+
+  if (!want_proto)
+    return 0;
 
+  /* Make sure there is a body even without any metrics. */
+  status = buffer_reserve(proto, (proto_len > 0) ? proto_len : 1);
+  if (status != 0)
+    return status;
+  for (size_t i = 0; i < chunks_num; i++)
+    buffer_append(proto, chunks[i]->proto.data, chunks[i]->proto.len);
+
+  return 0;
+}
+
+#if HAVE_ZLIB
+/* compress_gzip compresses "in" into "out" using the gzip format. */
+static int compress_gzip(prom_buffer_t *out, prom_buffer_t const *in) {
+  z_stream z = {0};
+
+  /* 15 window bits + 16 selects the gzip header. Compression happens once per
+   * snapshot, so the default level is affordable. */
+  if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    return -1;
+
+  int status = buffer_reserve(out, deflateBound(&z, in->len));
+  if (status != 0) {
+    deflateEnd(&z);
+    return status;
+  }
+
+  z.next_in = in->data;
+  z.avail_in = in->len;
+  z.next_out = out->data;
+  z.avail_out = out->size;
+
+  status = deflate(&z, Z_FINISH);
+  out->len = out->size - z.avail_out;
+  deflateEnd(&z);
+
+  return (status == Z_STREAM_END) ? 0 : -1;
+}
+#endif
+
+static void snapshot_destroy(prom_snapshot_t *s) {
+  if (s == NULL)
+    return;
+
+  for (size_t i = 0; i < FORMAT_NUM; i++)
+    for (size_t j = 0; j < ENCODING_NUM; j++)
+      buffer_reset(&s->body[i][j]);
+  sfree(s);
+}
+
+static void snapshot_release(prom_snapshot_t *s) {
+  pthread_mutex_lock(&snapshot_lock);
+  assert(s->refs > 0);
+  s->refs--;
+  _Bool unused = (s->refs == 0);
+  pthread_mutex_unlock(&snapshot_lock);
+
+  if (unused)
+    snapshot_destroy(s);
+}
+
+/* snapshot_update renders a new snapshot if the metrics have changed since the
+ * last one was created, and replaces the current snapshot. Only families that
+ * have changed are rendered while holding metrics_lock. Assembling the
+ * snapshot from the families' chunks, compression and freeing the old
+ * snapshot happen without it, so that writers are blocked as little as
+ * possible. */
+static int snapshot_update(void) {
+  pthread_mutex_lock(&snapshot_lock);
+  _Bool want_proto = want_proto_render;
+  _Bool want_gzip = want_gzip_render;
+  prom_snapshot_t *current = snapshot;
+  uint64_t current_generation = (current != NULL) ? current->generation : 0;
+  _Bool have_proto =
+      (current != NULL) && (current->body[FORMAT_PROTO][ENCODING_PLAIN].data);
+  _Bool have_gzip =
+      (current != NULL) && (current->body[FORMAT_TEXT][ENCODING_GZIP].data);
+  pthread_mutex_unlock(&snapshot_lock);
+
+  prom_snapshot_t *s = calloc(1, sizeof(*s));
+  if (s == NULL)
+    return ENOMEM;
+
+  cdtime_t start = cdtime();
+  prom_chunk_t **chunks = NULL;
+  size_t chunks_num = 0;
+
+  pthread_mutex_lock(&metrics_lock);
+  if ((metrics_generation == current_generation) &&
+      (have_proto || !want_proto) && (have_gzip || !want_gzip)) {
+    pthread_mutex_unlock(&metrics_lock);
+    snapshot_destroy(s);
+    return 0;
+  }
+
+  s->generation = metrics_generation;
+  int status = snapshot_collect(&chunks, &chunks_num, want_proto);
+  pthread_mutex_unlock(&metrics_lock);
+
+  if (status == 0)
+    status = snapshot_assemble(s, chunks, chunks_num, want_proto);
+
+  /* Chunks that have been replaced in the meantime are only referenced from
+   * here. */
+  pthread_mutex_lock(&metrics_lock);
+  for (size_t i = 0; i < chunks_num; i++)
+    chunks[i] = chunk_unref(chunks[i]);
   pthread_mutex_unlock(&metrics_lock);
+  for (size_t i = 0; i < chunks_num; i++)
+    chunk_destroy(chunks[i]);
+  sfree(chunks);
+
+  if (status != 0) {
+    ERROR("write_prometheus plugin: Rendering the metrics failed with status "
+          "%d.",
+          status);
+    snapshot_destroy(s);
+    return status;
+  }
+
+#if HAVE_ZLIB
+  if (want_gzip) {
+    for (size_t i = 0; i < FORMAT_NUM; i++) {
+      if (s->body[i][ENCODING_PLAIN].data == NULL)
+        continue;
+      if (compress_gzip(&s->body[i][ENCODING_GZIP],
+                        &s->body[i][ENCODING_PLAIN]) != 0) {
+        ERROR("write_prometheus plugin: Compressing the metrics failed.");
+        buffer_reset(&s->body[i][ENCODING_GZIP]);
+      }
+    }
+  }
+#endif
+
+  cdtime_t duration = cdtime() - start;
+  DEBUG("write_prometheus plugin: Rendered %zu bytes in %.3f seconds.",
+        s->body[FORMAT_TEXT][ENCODING_PLAIN].len, CDTIME_T_TO_DOUBLE(duration));
+  if (duration > render_interval) {
+    static c_complain_t slow_render = C_COMPLAIN_INIT_STATIC;
+    c_complain(LOG_WARNING, &slow_render,
+               "write_prometheus plugin: Rendering the metrics took %.3f "
+               "seconds, more than \"RenderInterval\" (%.3f seconds).",
+               CDTIME_T_TO_DOUBLE(duration),
+               CDTIME_T_TO_DOUBLE(render_interval));
+  }
+
+  pthread_mutex_lock(&snapshot_lock);
+  prom_snapshot_t *old = snapshot;
+  snapshot = s;
+  s->refs = 1;
+  pthread_mutex_unlock(&snapshot_lock);
+
+  if (old != NULL)
+    snapshot_release(old);
+
+  return 0;
+}
+
+static void *render_thread_main(__attribute__((unused)) void *arg) {
+  pthread_mutex_lock(&snapshot_lock);
+  while (!render_thread_stop) {
+    pthread_mutex_unlock(&snapshot_lock);
+    snapshot_update();
+    pthread_mutex_lock(&snapshot_lock);
+
+    if (render_thread_stop)
+      break;
+
+    struct timespec ts = CDTIME_T_TO_TIMESPEC(cdtime() + render_interval);
+    pthread_cond_timedwait(&render_cond, &snapshot_lock, &ts);
+  }
+  pthread_mutex_unlock(&snapshot_lock);
+
+  return NULL;
+}
+
+static ssize_t response_read(void *cls, uint64_t pos, char *buf, size_t max) {
+  prom_response_t *r = cls;
+
+  if (pos >= r->body->len)
+    return MHD_CONTENT_READER_END_OF_STREAM;
+
+  size_t len = r->body->len - (size_t)pos;
+  if (len > max)
+    len = max;
+  memcpy(buf, r->body->data + pos, len);
+  return (ssize_t)len;
+}
+
+static void response_free(void *cls) {
+  prom_response_t *r = cls;
+
+  snapshot_release(r->snapshot);
+  sfree(r);
 }
 
 /* http_handler is the callback called by the microhttpd library. It essentially
- * handles all HTTP request aspects and creates an HTTP response. */
+ * handles all HTTP request aspects and creates an HTTP response. The response
+ * is served from the current snapshot, so scrapes never have to wait for the
+ * metrics to be formatted. */
 static int http_handler(void *cls, struct MHD_Connection *connection,
                         const char *url, const char *method,
                         const char *version, const char *upload_data,
@@ -244,29 +755,53 @@ static int http_handler(void *cls, struct MHD_Connection *connection,
       (accept != NULL) &&
       (strstr(accept, "application/vnd.google.protobuf") != NULL);
 
-  uint8_t scratch[4096] = {0};
-  ProtobufCBufferSimple simple = PROTOBUF_C_BUFFER_SIMPLE_INIT(scratch);
-  ProtobufCBuffer *buffer = (ProtobufCBuffer *)&simple;
-
-  if (want_proto)
-    format_protobuf(buffer);
-  else
-    format_text(buffer);
-
-#if defined(MHD_VERSION) && MHD_VERSION >= 0x00090500
-  struct MHD_Response *res = MHD_create_response_from_buffer(
-      simple.len, simple.data, MHD_RESPMEM_MUST_COPY);
-#else
-  struct MHD_Response *res = MHD_create_response_from_data(
-      simple.len, simple.data, /* must_free = */ 0, /* must_copy = */ 1);
-#endif
+  char const *accept_encoding = MHD_lookup_connection_value(
+      connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  _Bool want_gzip =
+      (accept_encoding != NULL) && (strstr(accept_encoding, "gzip") != NULL);
+
+  prom_response_t *r = calloc(1, sizeof(*r));
+  if (r == NULL)
+    return MHD_NO;
+
+  pthread_mutex_lock(&snapshot_lock);
+  /* Formats and encodings are only rendered once they have been asked for.
+   * Until the next snapshot is ready, the response falls back to plain
+   * text, which Prometheus accepts as well. */
+  if ((want_proto && !want_proto_render) || (want_gzip && !want_gzip_render)) {
+    want_proto_render |= want_proto;
+    want_gzip_render |= want_gzip;
+    pthread_cond_signal(&render_cond);
+  }
+  r->snapshot = snapshot;
+  r->snapshot->refs++;
+  pthread_mutex_unlock(&snapshot_lock);
+
+  int format = FORMAT_TEXT;
+  if (want_proto && (r->snapshot->body[FORMAT_PROTO][ENCODING_PLAIN].data))
+    format = FORMAT_PROTO;
+  int encoding = ENCODING_PLAIN;
+  if (want_gzip && (r->snapshot->body[format][ENCODING_GZIP].data))
+    encoding = ENCODING_GZIP;
+  r->body = &r->snapshot->body[format][encoding];
+
+  struct MHD_Response *res = MHD_create_response_from_callback(
+      r->body->len, RESPONSE_BLOCK_SIZE, response_read, r, response_free);
+  if (res == NULL) {
+    response_free(r);
+    return MHD_NO;
+  }
   MHD_add_response_header(res, MHD_HTTP_HEADER_CONTENT_TYPE,
-                          want_proto ? CONTENT_TYPE_PROTO : CONTENT_TYPE_TEXT);
+                          (format == FORMAT_PROTO) ? CONTENT_TYPE_PROTO
+                                                   : CONTENT_TYPE_TEXT);
+  MHD_add_response_header(res, MHD_HTTP_HEADER_VARY,
+                          MHD_HTTP_HEADER_ACCEPT_ENCODING);
+  if (encoding == ENCODING_GZIP)
+    MHD_add_response_header(res, MHD_HTTP_HEADER_CONTENT_ENCODING, "gzip");
 
   int status = MHD_queue_response(connection, MHD_HTTP_OK, res);
 
   MHD_destroy_response(res);
-  PROTOBUF_C_BUFFER_SIMPLE_CLEAR(&simple);
   return status;
 }
 
@@ -328,7 +863,11 @@ static void metric_destroy(Io__Prometheus__Client__Metric *msg) {
   sfree(msg->gauge);
   sfree(msg->counter);
 
-  sfree(msg);
+  prom_metric_t *m = (prom_metric_t *)msg;
+  sfree(m->text);
+  sfree(m->proto);
+
+  sfree(m);
 }
 
 /* metric_cmp compares two metrics. It's prototype makes it easy to use with
@@ -422,15 +961,16 @@ static int metric_cmp(void const *a, void const *b) {
 /* metric_clone allocates and initializes a new metric based on orig. */
 static Io__Prometheus__Client__Metric *
 metric_clone(Io__Prometheus__Client__Metric const *orig) {
-  Io__Prometheus__Client__Metric *copy = calloc(1, sizeof(*copy));
-  if (copy == NULL)
+  prom_metric_t *m = calloc(1, sizeof(*m));
+  if (m == NULL)
     return NULL;
+  Io__Prometheus__Client__Metric *copy = &m->pb;
   io__prometheus__client__metric__init(copy);
 
   copy->n_label = orig->n_label;
   copy->label = calloc(copy->n_label, sizeof(*copy->label));
   if (copy->label == NULL) {
-    sfree(copy);
+    sfree(m);
     return NULL;
   }
 
@@ -540,6 +1080,7 @@ metric_family_delete_metric(Io__Prometheus__Client__MetricFamily *fam,
   if (i >= fam->n_metric)
     return ENOENT;
 
+  ((prom_family_t *)fam)->dirty = 1;
   metric_destroy(fam->metric[i]);
   if ((fam->n_metric - 1) > i)
     memmove(&fam->metric[i], &fam->metric[i + 1],
@@ -599,8 +1140,15 @@ static int metric_family_update(Io__Prometheus__Client__MetricFamily *fam,
   if (m == NULL)
     return -1;
 
-  return metric_update(m, vl->values[ds_index], ds->ds[ds_index].type, vl->time,
-                       vl->interval);
+  int status = metric_update(m, vl->values[ds_index], ds->ds[ds_index].type,
+                             vl->time, vl->interval);
+  if (status != 0)
+    return status;
+
+  prom_metric_t *pm = (prom_metric_t *)m;
+  pm->proto_dirty = 1;
+  ((prom_family_t *)fam)->dirty = 1;
+  return metric_render_text(pm, fam->name, fam->type);
 }
 
 /* metric_family_destroy frees the memory used by a metric family. */
@@ -616,16 +1164,23 @@ static void metric_family_destroy(Io__Prometheus__Client__MetricFamily *msg) {
   }
   sfree(msg->metric);
 
-  sfree(msg);
+  prom_family_t *fam = (prom_family_t *)msg;
+  sfree(fam->text_header);
+  sfree(fam->proto_header);
+  /* A snapshot being assembled may still use the chunk. */
+  chunk_destroy(chunk_unref(fam->chunk));
+
+  sfree(fam);
 }
 
 /* metric_family_create allocates and initializes a new metric family. */
 static Io__Prometheus__Client__MetricFamily *
 metric_family_create(char *name, data_set_t const *ds, value_list_t const *vl,
                      size_t ds_index) {
-  Io__Prometheus__Client__MetricFamily *msg = calloc(1, sizeof(*msg));
-  if (msg == NULL)
+  prom_family_t *fam = calloc(1, sizeof(*fam));
+  if (fam == NULL)
     return NULL;
+  Io__Prometheus__Client__MetricFamily *msg = &fam->pb;
   io__prometheus__client__metric_family__init(msg);
 
   msg->name = name;
@@ -643,6 +1198,21 @@ metric_family_create(char *name, data_set_t const *ds, value_list_t const *vl,
                   : IO__PROMETHEUS__CLIENT__METRIC_TYPE__COUNTER;
   msg->has_type = 1;
 
+  char header[2048];
+  ssnprintf(header, sizeof(header), "# HELP %s %s\n# TYPE %s %s\n", msg->name,
+            msg->help, msg->name,
+            (msg->type == IO__PROMETHEUS__CLIENT__METRIC_TYPE__GAUGE)
+                ? "gauge"
+                : "counter");
+  fam->text_header = strdup(header);
+  if ((msg->help == NULL) || (fam->text_header == NULL)) {
+    /* "name" is owned by the caller until we return successfully. */
+    msg->name = NULL;
+    metric_family_destroy(msg);
+    return NULL;
+  }
+  fam->text_header_len = strlen(header);
+
   return msg;
 }
 
@@ -740,6 +1310,13 @@ static int prom_config(oconfig_item_t *ci) {
         httpd_port = (unsigned short)status;
     } else if (strcasecmp("StalenessDelta", child->key) == 0) {
       cf_util_get_cdtime(child, &staleness_delta);
+    } else if (strcasecmp("RenderInterval", child->key) == 0) {
+      cdtime_t tmp = 0;
+      if ((cf_util_get_cdtime(child, &tmp) == 0) && (tmp > 0))
+        render_interval = tmp;
+      else
+        ERROR("write_prometheus plugin: \"RenderInterval\" must be a "
+              "positive number.");
     } else {
       WARNING("write_prometheus plugin: Ignoring unknown configuration option "
               "\"%s\".",
@@ -759,6 +1336,25 @@ static int prom_init() {
     }
   }
 
+  /* Make sure there is always a snapshot to serve. */
+  if (snapshot == NULL) {
+    int status = snapshot_update();
+    if (status != 0)
+      return status;
+  }
+
+  if (!render_thread_running) {
+    render_thread_stop = 0;
+    int status = plugin_thread_create(&render_thread, /* attr = */ NULL,
+                                      render_thread_main, /* arg = */ NULL,
+                                      "wprom render");
+    if (status != 0) {
+      ERROR("write_prometheus plugin: Starting the render thread failed.");
+      return -1;
+    }
+    render_thread_running = 1;
+  }
+
   if (httpd == NULL) {
     unsigned int flags = MHD_USE_THREAD_PER_CONNECTION;
 #if MHD_VERSION >= 0x00093300
@@ -799,6 +1395,7 @@ static int prom_write(data_set_t const *ds, value_list_t const *vl,
     }
   }
 
+  metrics_generation++;
   pthread_mutex_unlock(&metrics_lock);
   return 0;
 }
@@ -838,6 +1435,7 @@ static int prom_missing(value_list_t const *vl,
     }
   }
 
+  metrics_generation++;
   pthread_mutex_unlock(&metrics_lock);
   return 0;
 }
@@ -848,6 +1446,24 @@ static int prom_shutdown() {
     httpd = NULL;
   }
 
+  if (render_thread_running) {
+    pthread_mutex_lock(&snapshot_lock);
+    render_thread_stop = 1;
+    pthread_cond_signal(&render_cond);
+    pthread_mutex_unlock(&snapshot_lock);
+
+    pthread_join(render_thread, NULL);
+    render_thread_running = 0;
+  }
+
+  /* All responses have been released by MHD_stop_daemon(). */
+  pthread_mutex_lock(&snapshot_lock);
+  prom_snapshot_t *s = snapshot;
+  snapshot = NULL;
+  pthread_mutex_unlock(&snapshot_lock);
+  if (s != NULL)
+    snapshot_release(s);
+
   pthread_mutex_lock(&metrics_lock);
   if (metrics != NULL) {
     char *name;
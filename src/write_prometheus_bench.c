@@ -0,0 +1,209 @@
+/**
+ * collectd - src/write_prometheus_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Keeps BENCH_FAMILIES metric families with BENCH_METRICS metrics each up to
+ * date from BENCH_THREADS writer threads, each series being updated about
+ * every BENCH_SERIES_INTERVAL_MS milliseconds, while scraping the plugin over
+ * HTTP every BENCH_SCRAPE_INTERVAL_MS milliseconds. Reports the latency of
+ * scrapes and of the write callback, which is blocked while metrics are being
+ * rendered, for the text and protobuf formats, with and without gzip.
+ * Build with "make bench_write_prometheus".
+ */
+
+#include "write_prometheus.c"
+
+#include "utils_latency.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define BENCH_FAMILIES 1000
+#define BENCH_METRICS 100
+#define BENCH_THREADS 4
+#define BENCH_SERIES_INTERVAL_MS 2000
+#define BENCH_SCRAPE_INTERVAL_MS 100
+#define BENCH_RENDER_INTERVAL_MS 100
+#define BENCH_SECONDS 5
+#define BENCH_PORT 19103
+
+/* cdtime() is mocked by libplugin_mock. */
+static cdtime_t bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TIMESPEC_TO_CDTIME_T(&ts);
+}
+
+static data_source_t dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+static data_set_t ds = {"gauge", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+static _Bool bench_stop;
+
+typedef struct {
+  size_t index;
+  latency_counter_t *latency;
+} bench_writer_t;
+
+static void *bench_writer(void *arg) {
+  bench_writer_t *w = arg;
+  size_t series_num = BENCH_FAMILIES * BENCH_METRICS / BENCH_THREADS;
+  /* Values are written in batches of one family, as read callbacks do. */
+  cdtime_t pause = MS_TO_CDTIME_T(BENCH_SERIES_INTERVAL_MS) /
+                   (series_num / BENCH_METRICS);
+  value_list_t vl = VALUE_LIST_INIT;
+  value_t v;
+
+  vl.values = &v;
+  vl.values_len = 1;
+  vl.interval = TIME_T_TO_CDTIME_T(10);
+  sstrncpy(vl.host, "myhost.example.com", sizeof(vl.host));
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+
+  for (size_t i = 0; !bench_stop; i++) {
+    size_t series = i % series_num;
+    size_t family = w->index + BENCH_THREADS * (series / BENCH_METRICS);
+
+    snprintf(vl.plugin, sizeof(vl.plugin), "family%zu", family);
+    snprintf(vl.type_instance, sizeof(vl.type_instance), "metric%zu",
+             series % BENCH_METRICS);
+    v.gauge = (gauge_t)i;
+    vl.time = bench_now();
+
+    cdtime_t start = bench_now();
+    prom_write(&ds, &vl, NULL);
+    latency_counter_add(w->latency, bench_now() - start);
+
+    if ((series % BENCH_METRICS) == BENCH_METRICS - 1) {
+      struct timespec ts = CDTIME_T_TO_TIMESPEC(pause);
+      nanosleep(&ts, NULL);
+    }
+  }
+
+  return NULL;
+}
+
+/* bench_scrape fetches the metrics and returns the number of bytes received,
+ * including headers. */
+static size_t bench_scrape(char const *accept, char const *accept_encoding) {
+  struct sockaddr_in sa = {
+      .sin_family = AF_INET,
+      .sin_port = htons(BENCH_PORT),
+      .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  char buffer[65536];
+  size_t bytes = 0;
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if ((fd < 0) || (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0)) {
+    char errbuf[256];
+    fprintf(stderr, "connect failed: %s\n",
+            sstrerror(errno, errbuf, sizeof(errbuf)));
+    exit(1);
+  }
+
+  int len = snprintf(buffer, sizeof(buffer),
+                     "GET /metrics HTTP/1.0\r\nAccept: %s\r\n"
+                     "Accept-Encoding: %s\r\n\r\n",
+                     accept, accept_encoding);
+  if (swrite(fd, buffer, (size_t)len) != 0)
+    exit(1);
+
+  ssize_t n;
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    bytes += (size_t)n;
+  close(fd);
+
+  return bytes;
+}
+
+static void bench_run(char const *name, char const *accept,
+                      char const *accept_encoding) {
+  latency_counter_t *scrapes = latency_counter_create();
+  latency_counter_t *writes = latency_counter_create();
+  bench_writer_t writers[BENCH_THREADS];
+  pthread_t threads[BENCH_THREADS];
+  size_t bytes = 0;
+
+  /* Let the render thread pick up the requested format. */
+  bench_scrape(accept, accept_encoding);
+  struct timespec ts = CDTIME_T_TO_TIMESPEC(2 * render_interval);
+  nanosleep(&ts, NULL);
+
+  bench_stop = 0;
+  for (size_t i = 0; i < BENCH_THREADS; i++) {
+    writers[i] = (bench_writer_t){
+        .index = i, .latency = latency_counter_create(),
+    };
+    pthread_create(threads + i, NULL, bench_writer, writers + i);
+  }
+
+  cdtime_t end = bench_now() + TIME_T_TO_CDTIME_T(BENCH_SECONDS);
+  while (bench_now() < end) {
+    cdtime_t start = bench_now();
+    bytes = bench_scrape(accept, accept_encoding);
+    latency_counter_add(scrapes, bench_now() - start);
+
+    ts = CDTIME_T_TO_TIMESPEC(MS_TO_CDTIME_T(BENCH_SCRAPE_INTERVAL_MS));
+    nanosleep(&ts, NULL);
+  }
+
+  bench_stop = 1;
+  for (size_t i = 0; i < BENCH_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    latency_counter_merge(writes, writers[i].latency);
+    latency_counter_destroy(writers[i].latency);
+  }
+
+#define US(t) (1e6 * CDTIME_T_TO_DOUBLE(t))
+  printf("%-14s scrape p50 %8.0f us  p99 %8.0f us  max %8.0f us  %8zu bytes"
+         "  |  write p50 %6.1f us  p99 %8.1f us  max %8.0f us\n",
+         name, US(latency_counter_get_percentile(scrapes, 50)),
+         US(latency_counter_get_percentile(scrapes, 99)),
+         US(latency_counter_get_max(scrapes)), bytes,
+         US(latency_counter_get_percentile(writes, 50)),
+         US(latency_counter_get_percentile(writes, 99)),
+         US(latency_counter_get_max(writes)));
+#undef US
+
+  latency_counter_destroy(scrapes);
+  latency_counter_destroy(writes);
+}
+
+int main(void) {
+  httpd_port = BENCH_PORT;
+  render_interval = MS_TO_CDTIME_T(BENCH_RENDER_INTERVAL_MS);
+  /* Timestamps come from the real clock, cdtime() is mocked. */
+  staleness_delta = TIME_T_TO_CDTIME_T(3600);
+
+  if (prom_init() != 0)
+    return 1;
+
+  bench_run("text", "text/plain", "identity");
+#if HAVE_ZLIB
+  bench_run("text gzip", "text/plain", "gzip");
+#endif
+  bench_run("protobuf", "application/vnd.google.protobuf", "identity");
+
+  prom_shutdown();
+  return 0;
+}
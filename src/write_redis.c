@@ -28,6 +28,7 @@
 
 #include "common.h"
 #include "plugin.h"
+#include "utils_avltree.h"
 
 #include <hiredis/hiredis.h>
 #include <sys/time.h>
@@ -36,6 +37,28 @@
 #define REDIS_DEFAULT_PREFIX "collectd/"
 #endif
 
+#ifndef WR_DEFAULT_PIPELINE_SIZE
+#define WR_DEFAULT_PIPELINE_SIZE 256
+#endif
+
+/* One connection to the Redis server. Commands are appended to the output
+ * buffer of "conn" and only sent, and their replies read, once "values_num"
+ * reaches the pipeline size, the batch gets older than one interval (checked
+ * on write and by wr_flush_timer), or the node is flushed. "idents" holds the identifiers written in the current
+ * batch, so that the "SADD" and "ZREMRANGEBYRANK" commands are issued once
+ * per series and batch instead of once per value. */
+struct wr_conn_s {
+  redisContext *conn;
+  pthread_mutex_t lock;
+
+  size_t pending;
+  size_t values_num;
+  cdtime_t batch_start;
+  cdtime_t batch_interval;
+  c_avl_tree_t *idents;
+};
+typedef struct wr_conn_s wr_conn_t;
+
 struct wr_node_s {
   char name[DATA_MAX_NAME_LEN];
 
@@ -46,18 +69,195 @@ struct wr_node_s {
   int database;
   int max_set_size;
   _Bool store_rates;
+  size_t pipeline_size;
 
-  redisContext *conn;
-  pthread_mutex_t lock;
+  /* Each series is always written over the same connection, so that
+   * trimming its sorted set never races with additions on another
+   * connection. */
+  wr_conn_t *conns;
+  size_t conns_num;
 };
 typedef struct wr_node_s wr_node_t;
 
 /*
  * Functions
  */
+static wr_conn_t *wr_conn_get(wr_node_t *node, char const *ident) /* {{{ */
+{
+  /* FNV-1a */
+  uint32_t hash = 2166136261U;
+
+  if (node->conns_num == 1)
+    return node->conns;
+
+  for (char const *ptr = ident; *ptr != 0; ptr++) {
+    hash ^= (uint32_t)(unsigned char)*ptr;
+    hash *= 16777619U;
+  }
+
+  return node->conns + (hash % node->conns_num);
+} /* }}} wr_conn_t *wr_conn_get */
+
+static void wr_conn_clear(wr_conn_t *c) /* {{{ */
+{
+  char *ident;
+  void *unused;
+
+  while (c_avl_pick(c->idents, (void *)&ident, &unused) == 0)
+    sfree(ident);
+
+  c->pending = 0;
+  c->values_num = 0;
+} /* }}} void wr_conn_clear */
+
+/* Closes the connection and drops everything that has not been sent yet. */
+static void wr_disconnect(wr_conn_t *c) /* {{{ */
+{
+  if (c->conn != NULL) {
+    redisFree(c->conn);
+    c->conn = NULL;
+  }
+
+  wr_conn_clear(c);
+} /* }}} void wr_disconnect */
+
+static int wr_connect(wr_node_t *node, wr_conn_t *c) /* {{{ */
+{
+  redisReply *rr;
+
+  c->conn =
+      redisConnectWithTimeout((char *)node->host, node->port, node->timeout);
+  if (c->conn == NULL) {
+    ERROR("write_redis plugin: Connecting to host \"%s\" (port %i) failed: "
+          "Unknown reason",
+          (node->host != NULL) ? node->host : "localhost",
+          (node->port != 0) ? node->port : 6379);
+    return -1;
+  } else if (c->conn->err) {
+    ERROR("write_redis plugin: Connecting to host \"%s\" (port %i) failed: %s",
+          (node->host != NULL) ? node->host : "localhost",
+          (node->port != 0) ? node->port : 6379, c->conn->errstr);
+    wr_disconnect(c);
+    return -1;
+  }
+
+  rr = redisCommand(c->conn, "SELECT %d", node->database);
+  if (rr == NULL)
+    WARNING("SELECT command error. database:%d message:%s", node->database,
+            c->conn->errstr);
+  else
+    freeReplyObject(rr);
+
+  return 0;
+} /* }}} int wr_connect */
+
+/* Appends one "SADD" for all series of the batch and, if "MaxSetSize" is set,
+ * one "ZREMRANGEBYRANK" per series. */
+static int wr_append_series(wr_node_t *node, wr_conn_t *c) /* {{{ */
+{
+  char const *prefix =
+      (node->prefix != NULL) ? node->prefix : REDIS_DEFAULT_PREFIX;
+  char set_name[512];
+  int idents_num;
+  char const **argv;
+  c_avl_iterator_t *iter;
+  char *ident;
+  void *unused;
+  int status;
+
+  idents_num = c_avl_size(c->idents);
+  if (idents_num == 0)
+    return 0;
+
+  argv = calloc((size_t)idents_num + 2, sizeof(*argv));
+  if (argv == NULL)
+    return ENOMEM;
+
+  ssnprintf(set_name, sizeof(set_name), "%svalues", prefix);
+  argv[0] = "SADD";
+  argv[1] = set_name;
+
+  int argc = 2;
+  iter = c_avl_get_iterator(c->idents);
+  while (c_avl_iterator_next(iter, (void *)&ident, &unused) == 0)
+    argv[argc++] = ident;
+  c_avl_iterator_destroy(iter);
+
+  status = redisAppendCommandArgv(c->conn, argc, argv, /* argvlen = */ NULL);
+  sfree(argv);
+  if (status != REDIS_OK)
+    return -1;
+  c->pending++;
+
+  if (node->max_set_size < 0)
+    return 0;
+
+  iter = c_avl_get_iterator(c->idents);
+  while (c_avl_iterator_next(iter, (void *)&ident, &unused) == 0) {
+    status = redisAppendCommand(c->conn, "ZREMRANGEBYRANK %s%s %d %d", prefix,
+                                ident, 0, (-1 * node->max_set_size) - 1);
+    if (status != REDIS_OK)
+      break;
+    c->pending++;
+  }
+  c_avl_iterator_destroy(iter);
+
+  return (status == REDIS_OK) ? 0 : -1;
+} /* }}} int wr_append_series */
+
+/* Sends the current batch and reads all outstanding replies.
+ * NOTE: You must hold c->lock when calling this function! */
+static int wr_flush_nolock(wr_node_t *node, wr_conn_t *c) /* {{{ */
+{
+  size_t commands_num;
+  size_t errors_num = 0;
+  char first_error[256] = "";
+
+  if ((c->conn == NULL) || (c->values_num == 0))
+    return 0;
+
+  if (wr_append_series(node, c) != 0) {
+    ERROR("write_redis plugin: Appending commands for node \"%s\" failed: %s",
+          node->name, c->conn->errstr);
+    wr_disconnect(c);
+    return -1;
+  }
+
+  commands_num = c->pending;
+  while (c->pending > 0) {
+    redisReply *rr = NULL;
+
+    /* The first call writes the whole output buffer. */
+    if (redisGetReply(c->conn, (void *)&rr) != REDIS_OK) {
+      ERROR("write_redis plugin: Sending %zu values to node \"%s\" failed: %s",
+            c->values_num, node->name, c->conn->errstr);
+      wr_disconnect(c);
+      return -1;
+    }
+    c->pending--;
+
+    if ((rr != NULL) && (rr->type == REDIS_REPLY_ERROR)) {
+      if (errors_num == 0)
+        sstrncpy(first_error, rr->str, sizeof(first_error));
+      errors_num++;
+    }
+    if (rr != NULL)
+      freeReplyObject(rr);
+  }
+
+  if (errors_num > 0)
+    WARNING("write_redis plugin: %zu of %zu commands sent to node \"%s\" "
+            "failed. The first error was: %s",
+            errors_num, commands_num, node->name, first_error);
+
+  wr_conn_clear(c);
+  return 0;
+} /* }}} int wr_flush_nolock */
+
 static int wr_write(const data_set_t *ds, /* {{{ */
                     const value_list_t *vl, user_data_t *ud) {
   wr_node_t *node = ud->data;
+  wr_conn_t *c;
   char ident[512];
   char key[512];
   char value[512] = {0};
@@ -65,7 +265,6 @@ static int wr_write(const data_set_t *ds, /* {{{ */
   size_t value_size;
   char *value_ptr;
   int status;
-  redisReply *rr;
 
   status = FORMAT_VL(ident, sizeof(ident), vl);
   if (status != 0)
@@ -80,68 +279,87 @@ static int wr_write(const data_set_t *ds, /* {{{ */
   if (status != 0)
     return status;
 
-  pthread_mutex_lock(&node->lock);
-
-  if (node->conn == NULL) {
-    node->conn =
-        redisConnectWithTimeout((char *)node->host, node->port, node->timeout);
-    if (node->conn == NULL) {
-      ERROR("write_redis plugin: Connecting to host \"%s\" (port %i) failed: "
-            "Unknown reason",
-            (node->host != NULL) ? node->host : "localhost",
-            (node->port != 0) ? node->port : 6379);
-      pthread_mutex_unlock(&node->lock);
-      return -1;
-    } else if (node->conn->err) {
-      ERROR(
-          "write_redis plugin: Connecting to host \"%s\" (port %i) failed: %s",
-          (node->host != NULL) ? node->host : "localhost",
-          (node->port != 0) ? node->port : 6379, node->conn->errstr);
-      pthread_mutex_unlock(&node->lock);
-      return -1;
-    }
+  c = wr_conn_get(node, ident);
+  pthread_mutex_lock(&c->lock);
 
-    rr = redisCommand(node->conn, "SELECT %d", node->database);
-    if (rr == NULL)
-      WARNING("SELECT command error. database:%d message:%s", node->database,
-              node->conn->errstr);
-    else
-      freeReplyObject(rr);
+  if ((c->conn == NULL) && (wr_connect(node, c) != 0)) {
+    pthread_mutex_unlock(&c->lock);
+    return -1;
   }
 
-  rr = redisCommand(node->conn, "ZADD %s %s %s", key, time, value);
-  if (rr == NULL)
-    WARNING("ZADD command error. key:%s message:%s", key, node->conn->errstr);
-  else
-    freeReplyObject(rr);
+  if (redisAppendCommand(c->conn, "ZADD %s %s %s", key, time, value) !=
+      REDIS_OK) {
+    ERROR("write_redis plugin: Appending ZADD for key \"%s\" failed: %s", key,
+          c->conn->errstr);
+    wr_disconnect(c);
+    pthread_mutex_unlock(&c->lock);
+    return -1;
+  }
+  c->pending++;
 
-  if (node->max_set_size >= 0) {
-    rr = redisCommand(node->conn, "ZREMRANGEBYRANK %s %d %d", key, 0,
-                      (-1 * node->max_set_size) - 1);
-    if (rr == NULL)
-      WARNING("ZREMRANGEBYRANK command error. key:%s message:%s", key,
-              node->conn->errstr);
-    else
-      freeReplyObject(rr);
+  if (c->values_num == 0) {
+    c->batch_start = cdtime();
+    c->batch_interval = vl->interval;
   }
+  c->values_num++;
 
-  /* TODO(octo): This is more overhead than necessary. Use the cache and
-   * metadata to determine if it is a new metric and call SADD only once for
-   * each metric. */
-  rr = redisCommand(
-      node->conn, "SADD %svalues %s",
-      (node->prefix != NULL) ? node->prefix : REDIS_DEFAULT_PREFIX, ident);
-  if (rr == NULL)
-    WARNING("SADD command error. ident:%s message:%s", ident,
-            node->conn->errstr);
-  else
-    freeReplyObject(rr);
+  if (c_avl_get(c->idents, ident, /* value = */ NULL) != 0) {
+    char *ident_copy = strdup(ident);
+    if ((ident_copy == NULL) ||
+        (c_avl_insert(c->idents, ident_copy, /* value = */ NULL) != 0))
+      sfree(ident_copy);
+  }
 
-  pthread_mutex_unlock(&node->lock);
+  status = 0;
+  if ((c->values_num >= node->pipeline_size) ||
+      ((cdtime() - c->batch_start) >= c->batch_interval))
+    status = wr_flush_nolock(node, c);
 
-  return 0;
+  pthread_mutex_unlock(&c->lock);
+
+  return status;
 } /* }}} int wr_write */
 
+static int wr_flush(cdtime_t timeout, /* {{{ */
+                    const char *identifier __attribute__((unused)),
+                    user_data_t *ud) {
+  wr_node_t *node = ud->data;
+  int status = 0;
+
+  for (size_t i = 0; i < node->conns_num; i++) {
+    wr_conn_t *c = node->conns + i;
+
+    pthread_mutex_lock(&c->lock);
+    /* timeout == 0  => flush unconditionally */
+    if ((timeout == 0) || ((c->batch_start + timeout) <= cdtime()))
+      if (wr_flush_nolock(node, c) != 0)
+        status = -1;
+    pthread_mutex_unlock(&c->lock);
+  }
+
+  return status;
+} /* }}} int wr_flush */
+
+/* Sends the batches older than one interval. Batches are otherwise only
+ * checked when the next value is written, so without this the last values
+ * could stay queued indefinitely. Registered as a read callback. */
+static int wr_flush_timer(user_data_t *ud) /* {{{ */
+{
+  wr_node_t *node = ud->data;
+  cdtime_t now = cdtime();
+
+  for (size_t i = 0; i < node->conns_num; i++) {
+    wr_conn_t *c = node->conns + i;
+
+    pthread_mutex_lock(&c->lock);
+    if ((c->values_num > 0) && ((now - c->batch_start) >= c->batch_interval))
+      wr_flush_nolock(node, c);
+    pthread_mutex_unlock(&c->lock);
+  }
+
+  return 0;
+} /* }}} int wr_flush_timer */
+
 static void wr_config_free(void *ptr) /* {{{ */
 {
   wr_node_t *node = ptr;
@@ -149,15 +367,41 @@ static void wr_config_free(void *ptr) /* {{{ */
   if (node == NULL)
     return;
 
-  if (node->conn != NULL) {
-    redisFree(node->conn);
-    node->conn = NULL;
+  for (size_t i = 0; (node->conns != NULL) && (i < node->conns_num); i++) {
+    wr_conn_t *c = node->conns + i;
+
+    wr_flush_nolock(node, c);
+    wr_disconnect(c);
+    c_avl_destroy(c->idents);
+    pthread_mutex_destroy(&c->lock);
   }
+  sfree(node->conns);
 
   sfree(node->host);
+  sfree(node->prefix);
   sfree(node);
 } /* }}} void wr_config_free */
 
+static int wr_conns_create(wr_node_t *node) /* {{{ */
+{
+  node->conns = calloc(node->conns_num, sizeof(*node->conns));
+  if (node->conns == NULL)
+    return ENOMEM;
+
+  for (size_t i = 0; i < node->conns_num; i++) {
+    wr_conn_t *c = node->conns + i;
+
+    c->idents = c_avl_create((int (*)(const void *, const void *))strcmp);
+    if (c->idents == NULL) {
+      node->conns_num = i;
+      return ENOMEM;
+    }
+    pthread_mutex_init(&c->lock, /* attr = */ NULL);
+  }
+
+  return 0;
+} /* }}} int wr_conns_create */
+
 static int wr_config_node(oconfig_item_t *ci) /* {{{ */
 {
   wr_node_t *node;
@@ -171,12 +415,12 @@ static int wr_config_node(oconfig_item_t *ci) /* {{{ */
   node->port = 0;
   node->timeout.tv_sec = 0;
   node->timeout.tv_usec = 1000;
-  node->conn = NULL;
   node->prefix = NULL;
   node->database = 0;
   node->max_set_size = -1;
   node->store_rates = 1;
-  pthread_mutex_init(&node->lock, /* attr = */ NULL);
+  node->pipeline_size = WR_DEFAULT_PIPELINE_SIZE;
+  node->conns_num = 1;
 
   status = cf_util_get_string_buffer(ci, node->name, sizeof(node->name));
   if (status != 0) {
@@ -207,6 +451,24 @@ static int wr_config_node(oconfig_item_t *ci) /* {{{ */
       status = cf_util_get_int(child, &node->max_set_size);
     } else if (strcasecmp("StoreRates", child->key) == 0) {
       status = cf_util_get_boolean(child, &node->store_rates);
+    } else if (strcasecmp("PipelineSize", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp < 1)) {
+        ERROR("write_redis plugin: \"PipelineSize\" must be a positive "
+              "number.");
+        status = EINVAL;
+      } else if (status == 0)
+        node->pipeline_size = (size_t)tmp;
+    } else if (strcasecmp("Connections", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp < 1)) {
+        ERROR("write_redis plugin: \"Connections\" must be a positive "
+              "number.");
+        status = EINVAL;
+      } else if (status == 0)
+        node->conns_num = (size_t)tmp;
     } else
       WARNING("write_redis plugin: Ignoring unknown config option \"%s\".",
               child->key);
@@ -215,6 +477,9 @@ static int wr_config_node(oconfig_item_t *ci) /* {{{ */
       break;
   } /* for (i = 0; i < ci->children_num; i++) */
 
+  if (status == 0)
+    status = wr_conns_create(node);
+
   if (status == 0) {
     char cb_name[sizeof("write_redis/") + DATA_MAX_NAME_LEN];
 
@@ -225,6 +490,13 @@ static int wr_config_node(oconfig_item_t *ci) /* {{{ */
                               &(user_data_t){
                                   .data = node, .free_func = wr_config_free,
                               });
+    if (status == 0) {
+      plugin_register_flush(cb_name, wr_flush, &(user_data_t){.data = node});
+      if (node->pipeline_size > 1)
+        plugin_register_complex_read(/* group = */ "write_redis", cb_name,
+                                     wr_flush_timer, /* interval = */ 0,
+                                     &(user_data_t){.data = node});
+    }
   }
 
   if (status != 0)
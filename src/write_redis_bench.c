@@ -0,0 +1,125 @@
+/**
+ * collectd - src/write_redis_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Writes BENCH_VALUES values of BENCH_SERIES series from BENCH_THREADS threads
+ * to a running Redis server with different pipeline sizes and numbers of
+ * connections, and reports the throughput. The keys are created below the
+ * "collectd-bench/" prefix in database BENCH_DATABASE.
+ * Build with "make bench_write_redis" and run as
+ * "bench_write_redis [host [port]]".
+ */
+
+#include "write_redis.c"
+
+#include <time.h>
+
+#define BENCH_VALUES 200000
+#define BENCH_SERIES 1000
+#define BENCH_THREADS 4
+#define BENCH_DATABASE 15
+
+static double wall_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static data_source_t dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+static data_set_t ds = {"gauge", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+typedef struct {
+  wr_node_t *node;
+  size_t index;
+} bench_writer_t;
+
+static void *bench_writer(void *arg) {
+  bench_writer_t *w = arg;
+  value_list_t vl = VALUE_LIST_INIT;
+  value_t v;
+
+  vl.values = &v;
+  vl.values_len = 1;
+  vl.interval = TIME_T_TO_CDTIME_T(10);
+  sstrncpy(vl.host, "myhost.example.com", sizeof(vl.host));
+  sstrncpy(vl.plugin, "bench", sizeof(vl.plugin));
+  snprintf(vl.plugin_instance, sizeof(vl.plugin_instance), "%zu", w->index);
+  sstrncpy(vl.type, "gauge", sizeof(vl.type));
+
+  for (size_t i = 0; i < BENCH_VALUES / BENCH_THREADS; i++) {
+    snprintf(vl.type_instance, sizeof(vl.type_instance), "metric%zu",
+             i % (BENCH_SERIES / BENCH_THREADS));
+    v.gauge = (gauge_t)i;
+    vl.time = TIME_T_TO_CDTIME_T(1500000000 + i);
+
+    wr_write(&ds, &vl, &(user_data_t){.data = w->node});
+  }
+
+  return NULL;
+}
+
+static void bench_run(char const *host, int port, size_t pipeline_size,
+                      size_t conns_num) {
+  wr_node_t *node = calloc(1, sizeof(*node));
+  sstrncpy(node->name, "bench", sizeof(node->name));
+  node->host = (host != NULL) ? strdup(host) : NULL;
+  node->port = port;
+  node->timeout.tv_sec = 1;
+  node->prefix = strdup("collectd-bench/");
+  node->database = BENCH_DATABASE;
+  node->max_set_size = 100;
+  node->store_rates = 1;
+  node->pipeline_size = pipeline_size;
+  node->conns_num = conns_num;
+  if (wr_conns_create(node) != 0)
+    exit(1);
+
+  bench_writer_t writers[BENCH_THREADS];
+  pthread_t threads[BENCH_THREADS];
+
+  double start = wall_time();
+  for (size_t i = 0; i < BENCH_THREADS; i++) {
+    writers[i] = (bench_writer_t){.node = node, .index = i};
+    pthread_create(threads + i, NULL, bench_writer, writers + i);
+  }
+  for (size_t i = 0; i < BENCH_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  /* Sends the last batch. */
+  wr_config_free(node);
+  double elapsed = wall_time() - start;
+
+  printf("PipelineSize %4zu  Connections %zu  %9.0f values/s\n", pipeline_size,
+         conns_num, BENCH_VALUES / elapsed);
+}
+
+int main(int argc, char **argv) {
+  char const *host = (argc > 1) ? argv[1] : NULL;
+  int port = (argc > 2) ? atoi(argv[2]) : 0;
+
+  bench_run(host, port, 1, 1);
+  bench_run(host, port, 16, 1);
+  bench_run(host, port, 256, 1);
+  bench_run(host, port, 256, 4);
+
+  return 0;
+}
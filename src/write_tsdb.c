@@ -46,13 +46,21 @@
 #include "common.h"
 #include "plugin.h"
 #include "utils_cache.h"
+#include "utils_complain.h"
+#include "utils_name_cache.h"
 #include "utils_random.h"
+#include "utils_spool.h"
 
 #include <pthread.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <syslog.h>
 #include <netdb.h>
 
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifndef WT_DEFAULT_NODE
 #define WT_DEFAULT_NODE "localhost"
 #endif
@@ -65,11 +73,41 @@
 #define WT_DEFAULT_ESCAPE '.'
 #endif
 
+/* Bytes per second sent from the spool after an outage. */
+#ifndef WT_DEFAULT_SPOOL_REPLAY_RATE
+#define WT_DEFAULT_SPOOL_REPLAY_RATE 1048576
+#endif
+
 /* Ethernet - (IPv6 + TCP) = 1500 - (40 + 32) = 1428 */
 #ifndef WT_SEND_BUF_SIZE
 #define WT_SEND_BUF_SIZE 1428
 #endif
 
+/* Asynchronous mode: values are formatted into chunks of this size, which are
+ * sent by a dedicated thread. */
+#ifndef WT_CHUNK_SIZE
+#define WT_CHUNK_SIZE 65536
+#endif
+
+#ifndef WT_DEFAULT_BUFFER_SIZE
+#define WT_DEFAULT_BUFFER_SIZE 4194304
+#endif
+
+/* Maximum number of chunks handed to one connection, i.e. passed to one
+ * writev() call. */
+#ifndef WT_CONN_MAX_CHUNKS
+#define WT_CONN_MAX_CHUNKS 8
+#endif
+
+/* Chunks that are not sent within this time after shutdown was requested are
+ * spooled or dropped. */
+#ifndef WT_SHUTDOWN_TIMEOUT
+#define WT_SHUTDOWN_TIMEOUT TIME_T_TO_CDTIME_T(5)
+#endif
+
+/* Metric names are truncated to this size, including the null byte. */
+#define WT_NAME_SIZE (10 * DATA_MAX_NAME_LEN)
+
 /*
  * Private variables
  */
@@ -86,6 +124,10 @@ struct wt_callback {
   _Bool always_append_ds;
   _Bool derive_rate;
 
+  /* Escaped metric names by series; NULL if "NameCacheSize" is zero. */
+  name_cache_t *names;
+  size_t names_size;
+
   char send_buf[WT_SEND_BUF_SIZE];
   size_t send_buf_free;
   size_t send_buf_fill;
@@ -98,11 +140,78 @@ struct wt_callback {
   cdtime_t next_random_ttl;
   uint64_t connect_interval;
   uint64_t last_connect_timestamp;
+
+  char *spool_dir;
+  spool_options_t spool_opts;
+  spool_t *spool;
+  _Bool spool_replay_started;
+
+  _Bool async_send;
+  size_t buffer_size;
+  size_t connections;
+  struct wt_async *async;
+};
+
+typedef struct wt_chunk_s {
+  char *data;
+  size_t fill;
+  /* bytes written to the socket */
+  size_t sent;
+  cdtime_t init_time;
+  struct wt_chunk_s *next;
+} wt_chunk_t;
+
+typedef struct {
+  int fd;
+  _Bool connecting;
+  size_t index;
+
+  /* chunks assigned to this connection, sent in order */
+  wt_chunk_t *head;
+  wt_chunk_t *tail;
+  size_t chunks_num;
+
+  cdtime_t next_attempt;
+  cdtime_t backoff;
+  c_complain_t complaint;
+} wt_conn_t;
+
+struct wt_async {
+  struct wt_callback *cb;
+
+  /* lock protects the chunk lists below */
+  pthread_mutex_t lock;
+  wt_chunk_t *fill;
+  wt_chunk_t *ready_head;
+  wt_chunk_t *ready_tail;
+  size_t ready_num;
+  wt_chunk_t *free;
+  size_t chunks_num;
+  size_t chunks_max;
+  _Bool wake_pending;
+  uint64_t dropped;
+  c_complain_t full_complaint;
+
+  /* only used by the sender thread */
+  int wake_fd[2];
+  int epoll_fd;
+  wt_conn_t *conns;
+  size_t conns_num;
+  struct addrinfo *ai_list;
+  size_t ai_num;
+  cdtime_t ai_last_update;
+
+  pthread_t thread;
+  _Bool thread_running;
+  _Bool stop;
 };
 
 static cdtime_t resolve_interval = 0;
 static cdtime_t resolve_jitter = 0;
 
+static void wt_async_destroy(struct wt_callback *cb);
+static void wt_async_flush(struct wt_callback *cb, cdtime_t timeout);
+
 /*
  * Functions
  */
@@ -131,6 +240,26 @@ static int wt_send_buffer(struct wt_callback *cb) {
   return 0;
 }
 
+/* wt_spool_send is called by the spool's replay thread for each record when
+ * the asynchronous sender is not used. The record is only sent if the
+ * connection is up; reconnecting is left to the write and flush callbacks. */
+static int wt_spool_send(void const *data, size_t size, void *user_data) {
+  struct wt_callback *cb = user_data;
+  int status = 0;
+
+  pthread_mutex_lock(&cb->send_lock);
+  if (cb->sock_fd < 0) {
+    status = -1;
+  } else if (swrite(cb->sock_fd, data, size) != 0) {
+    close(cb->sock_fd);
+    cb->sock_fd = -1;
+    status = -1;
+  }
+  pthread_mutex_unlock(&cb->send_lock);
+
+  return status;
+}
+
 /* NOTE: You must hold cb->send_lock when calling this function! */
 static int wt_flush_nolock(cdtime_t timeout, struct wt_callback *cb) {
   int status;
@@ -154,6 +283,8 @@ static int wt_flush_nolock(cdtime_t timeout, struct wt_callback *cb) {
   }
 
   status = wt_send_buffer(cb);
+  if ((status != 0) && (cb->spool != NULL))
+    status = spool_append(cb->spool, cb->send_buf, cb->send_buf_fill);
   wt_reset_buffer(cb);
 
   return status;
@@ -294,6 +425,10 @@ static void wt_callback_free(void *data) {
 
   cb = data;
 
+  wt_async_destroy(cb);
+  /* The replay thread takes send_lock, so it is stopped first. */
+  spool_replay_stop(cb->spool);
+
   pthread_mutex_lock(&cb->send_lock);
 
   wt_flush_nolock(0, cb);
@@ -301,9 +436,16 @@ static void wt_callback_free(void *data) {
   close(cb->sock_fd);
   cb->sock_fd = -1;
 
+  spool_destroy(cb->spool);
+  cb->spool = NULL;
+
+  name_cache_destroy(cb->names);
+  cb->names = NULL;
+
   sfree(cb->node);
   sfree(cb->service);
   sfree(cb->host_tags);
+  sfree(cb->spool_dir);
 
   pthread_mutex_destroy(&cb->send_lock);
 
@@ -321,6 +463,11 @@ static int wt_flush(cdtime_t timeout,
 
   cb = user_data->data;
 
+  if (cb->async != NULL) {
+    wt_async_flush(cb, timeout);
+    return 0;
+  }
+
   pthread_mutex_lock(&cb->send_lock);
 
   if (cb->sock_fd < 0) {
@@ -349,8 +496,6 @@ static int wt_format_values(char *ret, size_t ret_len, int ds_num,
 
   assert(0 == strcmp(ds->type, vl->type));
 
-  memset(ret, 0, ret_len);
-
 #define BUFFER_ADD(...)                                                        \
   do {                                                                         \
     status = snprintf(ret + offset, ret_len - offset, __VA_ARGS__);            \
@@ -404,7 +549,12 @@ static int wt_format_name(char *ret, int ret_len, const value_list_t *vl,
   const char *meta_prefix = "tsdb_prefix";
 
   if (vl->meta) {
-    status = meta_data_get_string(vl->meta, meta_name, &temp);
+    status = meta_data_get_string_buffer(vl->meta, meta_name, ret, ret_len);
+    if (status == 0)
+      return 0;
+    if (status == -ENOMEM)
+      /* too long: truncate it */
+      status = meta_data_get_string(vl->meta, meta_name, &temp);
     if (status == -ENOENT) {
       /* defaults to empty string */
     } else if (status < 0) {
@@ -468,6 +618,842 @@ static int wt_format_name(char *ret, int ret_len, const value_list_t *vl,
   return 0;
 }
 
+/* wt_format_key writes the escaped name of data source "ds_index" to "key"
+ * and returns its length. Names of full length are kept in the name cache,
+ * unless the value list sets them with the "tsdb_name" or "tsdb_prefix" meta
+ * data. */
+static int wt_format_key(char *key, size_t key_size, const data_set_t *ds,
+                         const value_list_t *vl, size_t ds_index,
+                         const struct wt_callback *cb) {
+  const char *ds_name = NULL;
+  _Bool cached = (cb->names != NULL);
+  int status;
+
+  if (cached && (vl->meta != NULL) &&
+      ((meta_data_exists(vl->meta, "tsdb_name") != 0) ||
+       (meta_data_exists(vl->meta, "tsdb_prefix") != 0)))
+    cached = 0;
+
+  if (cached) {
+    status = name_cache_get(cb->names, vl, ds_index, key, key_size);
+    if (status >= 0)
+      return status;
+  }
+
+  if (cb->always_append_ds || (ds->ds_num > 1))
+    ds_name = ds->ds[ds_index].name;
+
+  status = wt_format_name(key, (int)key_size, vl, cb, ds_name);
+  if (status != 0)
+    return status;
+  escape_string(key, key_size);
+
+  size_t key_len = strlen(key);
+  if (cached && (key_size == WT_NAME_SIZE))
+    name_cache_put(cb->names, vl, ds_index, key, key_len);
+
+  return (int)key_len;
+}
+
+/*
+ * Asynchronous mode
+ *
+ * Write threads format values directly into large chunks. Full chunks are
+ * queued and sent by a dedicated thread over one or more non-blocking
+ * connections, each of which takes the next queued chunk whenever it has
+ * room, so busy or slow TSDs receive less data. When all connections are
+ * down, chunks accumulate until "BufferSize" is reached and then spill into
+ * the spool, if one is configured.
+ */
+#if HAVE_SYS_EPOLL_H
+/* wt_async_format formats one "put" line directly into "buffer". Returns the
+ * number of bytes written, zero if the value is skipped, or -ENOMEM if
+ * "buffer" is too small. */
+static int wt_async_format(char *buffer, size_t size, const data_set_t *ds,
+                           const value_list_t *vl, size_t ds_index,
+                           gauge_t const *rates, struct wt_callback *cb) {
+  size_t name_size = WT_NAME_SIZE;
+  size_t offset = 0;
+  int status;
+  int type = ds->ds[ds_index].type;
+  _Bool use_rate =
+      cb->store_rates || (cb->derive_rate && (type == DS_TYPE_DERIVE));
+
+#define WT_APPEND(...)                                                         \
+  do {                                                                         \
+    status = snprintf(buffer + offset, size - offset, __VA_ARGS__);            \
+    if ((status < 0) || ((size_t)status >= (size - offset)))                   \
+      return -ENOMEM;                                                          \
+    offset += (size_t)status;                                                  \
+  } while (0)
+
+  if ((type == DS_TYPE_GAUGE) && isnan(vl->values[ds_index].gauge))
+    return 0;
+  if ((type != DS_TYPE_GAUGE) && use_rate && isnan(rates[ds_index]))
+    return 0;
+
+  WT_APPEND("put ");
+
+  /* Names are truncated to "name_size" like in synchronous mode, but must not
+   * be truncated because the chunk is full. */
+  _Bool limited = (size - offset) <= name_size;
+  if (limited)
+    name_size = size - offset;
+  status = wt_format_key(buffer + offset, name_size, ds, vl, ds_index, cb);
+  if (status < 0)
+    return status;
+  size_t name_len = (size_t)status;
+  if (limited && (name_len + 1 >= name_size))
+    return -ENOMEM;
+  offset += name_len;
+
+  WT_APPEND(" %.0f ", CDTIME_T_TO_DOUBLE(vl->time));
+
+  if (type == DS_TYPE_GAUGE)
+    WT_APPEND(GAUGE_FORMAT, vl->values[ds_index].gauge);
+  else if (use_rate)
+    WT_APPEND(GAUGE_FORMAT, rates[ds_index]);
+  else if (type == DS_TYPE_COUNTER)
+    WT_APPEND("%llu", vl->values[ds_index].counter);
+  else if (type == DS_TYPE_DERIVE)
+    WT_APPEND("%" PRIi64, vl->values[ds_index].derive);
+  else if (type == DS_TYPE_ABSOLUTE)
+    WT_APPEND("%" PRIu64, vl->values[ds_index].absolute);
+  else {
+    ERROR("write_tsdb plugin: Unknown data source type: %i", type);
+    return -EINVAL;
+  }
+
+  WT_APPEND(" fqdn=%s ", vl->host);
+
+  if (vl->meta != NULL) {
+    status = meta_data_get_string_buffer(vl->meta, "tsdb_tags",
+                                         buffer + offset, size - offset);
+    if (status == 0)
+      offset += strlen(buffer + offset);
+    else if (status != -ENOENT)
+      return status;
+  }
+
+  WT_APPEND(" %s\r\n", cb->host_tags ? cb->host_tags : "");
+
+#undef WT_APPEND
+
+  return (int)offset;
+}
+
+/* NOTE: You must hold a->lock when calling this function! */
+static void wt_async_wake(struct wt_async *a) {
+  char c = 0;
+
+  if (a->wake_pending)
+    return;
+  a->wake_pending = 1;
+
+  /* If the pipe is full, the sender thread will wake up anyway. */
+  if (write(a->wake_fd[1], &c, sizeof(c)) < 0)
+    a->wake_pending = 0;
+}
+
+/* wt_async_get_chunk returns an empty chunk. When all chunks are in use and
+ * "may_spool" is true, the oldest queued chunk is moved to the spool.
+ * NOTE: You must hold a->lock when calling this function! */
+static wt_chunk_t *wt_async_get_chunk(struct wt_async *a, _Bool may_spool) {
+  wt_chunk_t *c = NULL;
+
+  if (a->free != NULL) {
+    c = a->free;
+    a->free = c->next;
+  } else if (a->chunks_num < a->chunks_max) {
+    c = calloc(1, sizeof(*c));
+    if (c == NULL)
+      return NULL;
+    c->data = malloc(WT_CHUNK_SIZE);
+    if (c->data == NULL) {
+      sfree(c);
+      return NULL;
+    }
+    a->chunks_num++;
+  } else if (may_spool && (a->cb->spool != NULL) && (a->ready_head != NULL)) {
+    c = a->ready_head;
+    a->ready_head = c->next;
+    if (a->ready_head == NULL)
+      a->ready_tail = NULL;
+    a->ready_num--;
+
+    if (spool_append(a->cb->spool, c->data + c->sent, c->fill - c->sent) != 0)
+      a->dropped++;
+  } else {
+    return NULL;
+  }
+
+  c->fill = 0;
+  c->sent = 0;
+  c->init_time = cdtime();
+  c->next = NULL;
+  return c;
+}
+
+/* NOTE: You must hold a->lock when calling this function! */
+static void wt_async_queue(struct wt_async *a, wt_chunk_t *c) {
+  c->next = NULL;
+  if (a->ready_tail == NULL)
+    a->ready_head = c;
+  else
+    a->ready_tail->next = c;
+  a->ready_tail = c;
+  a->ready_num++;
+  wt_async_wake(a);
+}
+
+/* NOTE: You must hold a->lock when calling this function! */
+static void wt_async_seal(struct wt_async *a) {
+  if ((a->fill == NULL) || (a->fill->fill == 0))
+    return;
+
+  wt_async_queue(a, a->fill);
+  a->fill = NULL;
+}
+
+/* NOTE: You must hold a->lock when calling this function! */
+static void wt_async_release(struct wt_async *a, wt_chunk_t *head,
+                             wt_chunk_t *tail) {
+  tail->next = a->free;
+  a->free = head;
+}
+
+static void wt_conn_want_write(struct wt_async *a, wt_conn_t *conn,
+                               _Bool want_write) {
+  struct epoll_event ev = {
+      .events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = conn,
+  };
+
+  epoll_ctl(a->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+/* wt_conn_close closes the connection and hands data that has not been sent
+ * back to the queue, starting at the last complete line. */
+static void wt_conn_close(struct wt_async *a, wt_conn_t *conn,
+                          _Bool failed) {
+  if (conn->fd >= 0) {
+    epoll_ctl(a->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->fd = -1;
+  }
+  conn->connecting = 0;
+
+  if (conn->head != NULL) {
+    for (wt_chunk_t *c = conn->head; c != NULL; c = c->next)
+      while ((c->sent > 0) && (c->data[c->sent - 1] != '\n'))
+        c->sent--;
+
+    pthread_mutex_lock(&a->lock);
+    conn->tail->next = a->ready_head;
+    a->ready_head = conn->head;
+    if (a->ready_tail == NULL)
+      a->ready_tail = conn->tail;
+    a->ready_num += conn->chunks_num;
+    pthread_mutex_unlock(&a->lock);
+
+    conn->head = NULL;
+    conn->tail = NULL;
+    conn->chunks_num = 0;
+  }
+
+  if (failed) {
+    if (conn->backoff == 0)
+      conn->backoff = TIME_T_TO_CDTIME_T(DEFAULT_CONNECT_INTERVAL);
+    else if (conn->backoff < TIME_T_TO_CDTIME_T(MAX_CONNECT_INTERVAL))
+      conn->backoff *= 2;
+    conn->next_attempt = cdtime() + conn->backoff;
+  }
+}
+
+static void wt_conn_send(struct wt_async *a, wt_conn_t *conn) {
+  while (conn->head != NULL) {
+    struct iovec iov[WT_CONN_MAX_CHUNKS];
+    int iov_num = 0;
+
+    for (wt_chunk_t *c = conn->head; (c != NULL) && (iov_num < WT_CONN_MAX_CHUNKS);
+         c = c->next) {
+      iov[iov_num].iov_base = c->data + c->sent;
+      iov[iov_num].iov_len = c->fill - c->sent;
+      iov_num++;
+    }
+
+    ssize_t status = writev(conn->fd, iov, iov_num);
+    if (status < 0) {
+      char errbuf[1024];
+
+      if (errno == EINTR)
+        continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        wt_conn_want_write(a, conn, 1);
+        return;
+      }
+
+      c_complain(LOG_ERR, &conn->complaint,
+                 "write_tsdb plugin: Sending to %s:%s failed: %s",
+                 a->cb->node, a->cb->service,
+                 sstrerror(errno, errbuf, sizeof(errbuf)));
+      wt_conn_close(a, conn, /* failed = */ 1);
+      return;
+    }
+
+    size_t sent = (size_t)status;
+    wt_chunk_t *done_head = NULL;
+    wt_chunk_t *done_tail = NULL;
+    while ((sent > 0) && (conn->head != NULL)) {
+      wt_chunk_t *c = conn->head;
+      size_t remaining = c->fill - c->sent;
+
+      if (sent < remaining) {
+        c->sent += sent;
+        break;
+      }
+
+      sent -= remaining;
+      conn->head = c->next;
+      if (conn->head == NULL)
+        conn->tail = NULL;
+      conn->chunks_num--;
+
+      c->next = NULL;
+      if (done_tail == NULL)
+        done_head = c;
+      else
+        done_tail->next = c;
+      done_tail = c;
+    }
+
+    if (done_head != NULL) {
+      pthread_mutex_lock(&a->lock);
+      wt_async_release(a, done_head, done_tail);
+      pthread_mutex_unlock(&a->lock);
+    }
+  }
+
+  wt_conn_want_write(a, conn, 0);
+}
+
+static void wt_conn_established(wt_conn_t *conn, struct wt_callback *cb) {
+  conn->connecting = 0;
+  conn->backoff = 0;
+  c_release(LOG_INFO, &conn->complaint,
+            "write_tsdb plugin: Connection %zu to %s:%s established.",
+            conn->index, cb->node, cb->service);
+}
+
+static int wt_async_resolve(struct wt_async *a) {
+  struct wt_callback *cb = a->cb;
+  struct addrinfo *ai_list = NULL;
+  cdtime_t now = cdtime();
+
+  if ((a->ai_list != NULL) && ((now - a->ai_last_update) < resolve_interval))
+    return 0;
+
+  struct addrinfo ai_hints = {
+      .ai_family = AF_UNSPEC,
+      .ai_flags = AI_ADDRCONFIG,
+      .ai_protocol = IPPROTO_TCP,
+      .ai_socktype = SOCK_STREAM,
+  };
+
+  int status = getaddrinfo(cb->node, cb->service, &ai_hints, &ai_list);
+  if (status != 0) {
+    c_complain(LOG_ERR, &a->conns[0].complaint,
+               "write_tsdb plugin: getaddrinfo(%s, %s) failed: %s", cb->node,
+               cb->service, gai_strerror(status));
+    /* keep using the previous addresses */
+    return (a->ai_list != NULL) ? 0 : -1;
+  }
+
+  if (a->ai_list != NULL)
+    freeaddrinfo(a->ai_list);
+  a->ai_list = ai_list;
+  a->ai_last_update = now;
+  a->ai_num = 0;
+  for (struct addrinfo *ai = ai_list; ai != NULL; ai = ai->ai_next)
+    a->ai_num++;
+
+  return 0;
+}
+
+static void wt_conn_connect(struct wt_async *a, wt_conn_t *conn) {
+  struct wt_callback *cb = a->cb;
+  char errbuf[1024];
+
+  if ((wt_async_resolve(a) != 0) || (a->ai_num == 0)) {
+    wt_conn_close(a, conn, /* failed = */ 1);
+    return;
+  }
+
+  /* Spread the connections over all addresses, e.g. multiple TSDs behind one
+   * name, and try the next address after a failure. */
+  struct addrinfo *ai = a->ai_list;
+  size_t skip = (conn->index + (size_t)(conn->backoff / TIME_T_TO_CDTIME_T(1))) %
+                a->ai_num;
+  for (size_t i = 0; i < skip; i++)
+    ai = ai->ai_next;
+
+  conn->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (conn->fd < 0) {
+    c_complain(LOG_ERR, &conn->complaint,
+               "write_tsdb plugin: socket(2) failed: %s",
+               sstrerror(errno, errbuf, sizeof(errbuf)));
+    wt_conn_close(a, conn, /* failed = */ 1);
+    return;
+  }
+
+  set_sock_opts(conn->fd);
+  fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+
+  int status = connect(conn->fd, ai->ai_addr, ai->ai_addrlen);
+  if ((status != 0) && (errno != EINPROGRESS)) {
+    c_complain(LOG_ERR, &conn->complaint,
+               "write_tsdb plugin: Connecting to %s:%s failed: %s", cb->node,
+               cb->service, sstrerror(errno, errbuf, sizeof(errbuf)));
+    close(conn->fd);
+    conn->fd = -1;
+    wt_conn_close(a, conn, /* failed = */ 1);
+    return;
+  }
+
+  conn->connecting = (status != 0);
+  struct epoll_event ev = {
+      .events = conn->connecting ? EPOLLOUT : EPOLLIN, .data.ptr = conn,
+  };
+  if (epoll_ctl(a->epoll_fd, EPOLL_CTL_ADD, conn->fd, &ev) != 0) {
+    ERROR("write_tsdb plugin: epoll_ctl failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    close(conn->fd);
+    conn->fd = -1;
+    wt_conn_close(a, conn, /* failed = */ 1);
+    return;
+  }
+
+  if (!conn->connecting)
+    wt_conn_established(conn, cb);
+}
+
+static void wt_conn_handle_event(struct wt_async *a, wt_conn_t *conn,
+                                 uint32_t events) {
+  char errbuf[1024];
+
+  if (conn->fd < 0)
+    return;
+
+  if (conn->connecting) {
+    int error = 0;
+    socklen_t error_len = sizeof(error);
+
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0)
+      error = errno;
+    if (error != 0) {
+      c_complain(LOG_ERR, &conn->complaint,
+                 "write_tsdb plugin: Connecting to %s:%s failed: %s",
+                 a->cb->node, a->cb->service,
+                 sstrerror(error, errbuf, sizeof(errbuf)));
+      wt_conn_close(a, conn, /* failed = */ 1);
+      return;
+    }
+
+    wt_conn_established(conn, a->cb);
+    wt_conn_want_write(a, conn, 0);
+    return;
+  }
+
+  if (events & EPOLLIN) {
+    /* The TSD reports errors on the connection. Discard them, but notice when
+     * it has been closed. */
+    char buffer[4096];
+    ssize_t status = read(conn->fd, buffer, sizeof(buffer));
+    if ((status == 0) ||
+        ((status < 0) && (errno != EAGAIN) && (errno != EINTR))) {
+      c_complain(LOG_ERR, &conn->complaint,
+                 "write_tsdb plugin: Connection to %s:%s closed by peer.",
+                 a->cb->node, a->cb->service);
+      wt_conn_close(a, conn, /* failed = */ 1);
+      return;
+    }
+  }
+
+  if (events & (EPOLLERR | EPOLLHUP)) {
+    wt_conn_close(a, conn, /* failed = */ 1);
+    return;
+  }
+
+  if (events & EPOLLOUT)
+    wt_conn_send(a, conn);
+}
+
+static int wt_async_spool_cb(void const *data, size_t size, void *user_data) {
+  struct wt_async *a = user_data;
+
+  if (size > WT_CHUNK_SIZE) {
+    ERROR("write_tsdb plugin: Dropping spooled record of %zu bytes.", size);
+    return 0;
+  }
+
+  pthread_mutex_lock(&a->lock);
+  wt_chunk_t *c = wt_async_get_chunk(a, /* may_spool = */ 0);
+  if (c == NULL) {
+    pthread_mutex_unlock(&a->lock);
+    return -1;
+  }
+  memcpy(c->data, data, size);
+  c->fill = size;
+  wt_async_queue(a, c);
+  pthread_mutex_unlock(&a->lock);
+
+  return 0;
+}
+
+/* wt_async_distribute hands queued chunks to the connections with the least
+ * amount of outstanding data. Returns true if a connection is available. */
+static _Bool wt_async_distribute(struct wt_async *a) {
+  _Bool have_conn = 0;
+
+  pthread_mutex_lock(&a->lock);
+  /* Send partially filled chunks rather than waiting for them to fill up when
+   * the connections are idle. */
+  if (a->ready_head == NULL)
+    wt_async_seal(a);
+
+  while (42) {
+    wt_conn_t *best = NULL;
+
+    for (size_t i = 0; i < a->conns_num; i++) {
+      wt_conn_t *conn = a->conns + i;
+      if ((conn->fd < 0) || conn->connecting)
+        continue;
+      have_conn = 1;
+      if ((conn->chunks_num < WT_CONN_MAX_CHUNKS) &&
+          ((best == NULL) || (conn->chunks_num < best->chunks_num)))
+        best = conn;
+    }
+
+    if ((best == NULL) || (a->ready_head == NULL))
+      break;
+
+    wt_chunk_t *c = a->ready_head;
+    a->ready_head = c->next;
+    if (a->ready_head == NULL)
+      a->ready_tail = NULL;
+    a->ready_num--;
+
+    c->next = NULL;
+    if (best->tail == NULL)
+      best->head = c;
+    else
+      best->tail->next = c;
+    best->tail = c;
+    best->chunks_num++;
+  }
+  pthread_mutex_unlock(&a->lock);
+
+  return have_conn;
+}
+
+static void *wt_async_thread(void *arg) {
+  struct wt_async *a = arg;
+  struct wt_callback *cb = a->cb;
+  cdtime_t deadline = 0;
+
+  while (42) {
+    struct epoll_event events[16];
+
+    int num = epoll_wait(a->epoll_fd, events, STATIC_ARRAY_SIZE(events), 100);
+    for (int i = 0; i < num; i++) {
+      if (events[i].data.ptr == NULL) {
+        char buffer[64];
+        while (read(a->wake_fd[0], buffer, sizeof(buffer)) > 0)
+          /* drain */;
+        pthread_mutex_lock(&a->lock);
+        a->wake_pending = 0;
+        pthread_mutex_unlock(&a->lock);
+        continue;
+      }
+      wt_conn_handle_event(a, events[i].data.ptr, events[i].events);
+    }
+
+    _Bool have_conn = wt_async_distribute(a);
+
+    for (size_t i = 0; i < a->conns_num; i++) {
+      wt_conn_t *conn = a->conns + i;
+      if ((conn->fd >= 0) && !conn->connecting && (conn->head != NULL))
+        wt_conn_send(a, conn);
+    }
+
+    pthread_mutex_lock(&a->lock);
+    _Bool stop = a->stop;
+    _Bool idle = (a->ready_head == NULL) &&
+                 ((a->fill == NULL) || (a->fill->fill == 0));
+    pthread_mutex_unlock(&a->lock);
+
+    for (size_t i = 0; i < a->conns_num; i++)
+      idle = idle && (a->conns[i].head == NULL);
+
+    if (have_conn && idle && !stop && (cb->spool != NULL))
+      spool_replay(cb->spool, wt_async_spool_cb, a);
+
+    cdtime_t now = cdtime();
+    if (stop) {
+      if (deadline == 0)
+        deadline = now + WT_SHUTDOWN_TIMEOUT;
+      if (idle || (now >= deadline))
+        break;
+    }
+
+    for (size_t i = 0; i < a->conns_num; i++) {
+      wt_conn_t *conn = a->conns + i;
+      if ((conn->fd < 0) && (now >= conn->next_attempt))
+        wt_conn_connect(a, conn);
+    }
+  }
+
+  for (size_t i = 0; i < a->conns_num; i++)
+    wt_conn_close(a, a->conns + i, /* failed = */ 0);
+
+  /* Keep what could not be sent in the spool. */
+  uint64_t lost = 0;
+  pthread_mutex_lock(&a->lock);
+  wt_async_seal(a);
+  while (a->ready_head != NULL) {
+    wt_chunk_t *c = a->ready_head;
+    a->ready_head = c->next;
+    if ((cb->spool == NULL) ||
+        (spool_append(cb->spool, c->data + c->sent, c->fill - c->sent) != 0))
+      lost += c->fill - c->sent;
+    wt_async_release(a, c, c);
+  }
+  a->ready_tail = NULL;
+  a->ready_num = 0;
+  pthread_mutex_unlock(&a->lock);
+
+  if (lost > 0)
+    WARNING("write_tsdb plugin: %" PRIu64 " bytes for %s:%s could not be "
+            "sent before shutdown and have been dropped.",
+            lost, cb->node, cb->service);
+
+  return NULL;
+}
+
+/* NOTE: You must hold a->lock when calling this function! */
+static int wt_async_start(struct wt_async *a) {
+  char errbuf[1024];
+
+  if (a->thread_running)
+    return 0;
+
+  if (pipe(a->wake_fd) != 0) {
+    ERROR("write_tsdb plugin: pipe failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    return -1;
+  }
+  for (size_t i = 0; i < 2; i++)
+    fcntl(a->wake_fd[i], F_SETFL, fcntl(a->wake_fd[i], F_GETFL) | O_NONBLOCK);
+
+  a->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (a->epoll_fd < 0) {
+    ERROR("write_tsdb plugin: epoll_create1 failed: %s",
+          sstrerror(errno, errbuf, sizeof(errbuf)));
+    close(a->wake_fd[0]);
+    close(a->wake_fd[1]);
+    return -1;
+  }
+
+  struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+  epoll_ctl(a->epoll_fd, EPOLL_CTL_ADD, a->wake_fd[0], &ev);
+
+  int status = plugin_thread_create(&a->thread, /* attr = */ NULL,
+                                    wt_async_thread, a, "write_tsdb");
+  if (status != 0) {
+    ERROR("write_tsdb plugin: Starting the sender thread failed: %s",
+          sstrerror(status, errbuf, sizeof(errbuf)));
+    close(a->epoll_fd);
+    close(a->wake_fd[0]);
+    close(a->wake_fd[1]);
+    return -1;
+  }
+
+  a->thread_running = 1;
+  return 0;
+}
+
+static int wt_async_write(const data_set_t *ds, const value_list_t *vl,
+                          struct wt_callback *cb) {
+  struct wt_async *a = cb->async;
+  gauge_t *rates = NULL;
+  int status = 0;
+
+  for (size_t i = 0; i < ds->ds_num; i++) {
+    if ((ds->ds[i].type == DS_TYPE_GAUGE) ||
+        !(cb->store_rates ||
+          (cb->derive_rate && (ds->ds[i].type == DS_TYPE_DERIVE))))
+      continue;
+
+    rates = uc_get_rate(ds, vl);
+    if (rates == NULL) {
+      WARNING("write_tsdb plugin: uc_get_rate failed.");
+      return -1;
+    }
+    break;
+  }
+
+  pthread_mutex_lock(&a->lock);
+
+  if (wt_async_start(a) != 0) {
+    pthread_mutex_unlock(&a->lock);
+    sfree(rates);
+    return -1;
+  }
+
+  for (size_t i = 0; i < ds->ds_num; i++) {
+    while (42) {
+      if (a->fill == NULL) {
+        a->fill = wt_async_get_chunk(a, /* may_spool = */ 1);
+        if (a->fill == NULL) {
+          a->dropped++;
+          c_complain(LOG_WARNING, &a->full_complaint,
+                     "write_tsdb plugin: The send buffer for %s:%s is full. "
+                     "Dropping values.",
+                     cb->node, cb->service);
+          status = -1;
+          break;
+        }
+        c_release(LOG_INFO, &a->full_complaint,
+                  "write_tsdb plugin: The send buffer for %s:%s is no longer "
+                  "full.",
+                  cb->node, cb->service);
+      }
+
+      wt_chunk_t *c = a->fill;
+      int len = wt_async_format(c->data + c->fill, WT_CHUNK_SIZE - c->fill, ds,
+                                vl, i, rates, cb);
+      if (len >= 0) {
+        c->fill += (size_t)len;
+        break;
+      }
+
+      if ((len != -ENOMEM) || (c->fill == 0)) {
+        ERROR("write_tsdb plugin: Formatting a value failed.");
+        status = -1;
+        break;
+      }
+
+      /* Chunk is full. */
+      wt_async_seal(a);
+    }
+
+    if (status != 0)
+      break;
+  }
+
+  pthread_mutex_unlock(&a->lock);
+
+  sfree(rates);
+  return status;
+}
+
+static void wt_async_flush(struct wt_callback *cb, cdtime_t timeout) {
+  struct wt_async *a = cb->async;
+
+  pthread_mutex_lock(&a->lock);
+  if ((a->fill != NULL) &&
+      ((timeout == 0) || ((a->fill->init_time + timeout) <= cdtime())))
+    wt_async_seal(a);
+  pthread_mutex_unlock(&a->lock);
+}
+
+static int wt_async_create(struct wt_callback *cb) {
+  struct wt_async *a = calloc(1, sizeof(*a));
+  if (a == NULL)
+    return ENOMEM;
+
+  a->cb = cb;
+  a->wake_fd[0] = a->wake_fd[1] = -1;
+  a->epoll_fd = -1;
+  a->chunks_max = cb->buffer_size / WT_CHUNK_SIZE;
+  if (a->chunks_max < 2)
+    a->chunks_max = 2;
+  a->conns_num = (cb->connections > 0) ? cb->connections : 1;
+  a->conns = calloc(a->conns_num, sizeof(*a->conns));
+  if (a->conns == NULL) {
+    sfree(a);
+    return ENOMEM;
+  }
+  for (size_t i = 0; i < a->conns_num; i++) {
+    a->conns[i].fd = -1;
+    a->conns[i].index = i;
+    C_COMPLAIN_INIT(&a->conns[i].complaint);
+  }
+  C_COMPLAIN_INIT(&a->full_complaint);
+  pthread_mutex_init(&a->lock, NULL);
+
+  cb->async = a;
+  return 0;
+}
+
+static void wt_chunk_list_free(wt_chunk_t *c) {
+  while (c != NULL) {
+    wt_chunk_t *next = c->next;
+    sfree(c->data);
+    sfree(c);
+    c = next;
+  }
+}
+
+static void wt_async_destroy(struct wt_callback *cb) {
+  struct wt_async *a = cb->async;
+
+  if (a == NULL)
+    return;
+
+  pthread_mutex_lock(&a->lock);
+  _Bool running = a->thread_running;
+  a->stop = 1;
+  wt_async_seal(a);
+  if (running)
+    wt_async_wake(a);
+  pthread_mutex_unlock(&a->lock);
+
+  if (running) {
+    pthread_join(a->thread, NULL);
+    close(a->epoll_fd);
+    close(a->wake_fd[0]);
+    close(a->wake_fd[1]);
+  }
+
+  if (a->ai_list != NULL)
+    freeaddrinfo(a->ai_list);
+
+  if (a->fill != NULL)
+    wt_chunk_list_free(a->fill);
+  wt_chunk_list_free(a->ready_head);
+  wt_chunk_list_free(a->free);
+
+  sfree(a->conns);
+  pthread_mutex_destroy(&a->lock);
+  sfree(a);
+  cb->async = NULL;
+}
+#else /* !HAVE_SYS_EPOLL_H */
+static int wt_async_write(const data_set_t *ds, const value_list_t *vl,
+                          struct wt_callback *cb) {
+  return ENOTSUP;
+}
+
+static void wt_async_flush(struct wt_callback *cb, cdtime_t timeout) {}
+
+static int wt_async_create(struct wt_callback *cb) {
+  ERROR("write_tsdb plugin: \"AsyncSend\" is not supported on this platform.");
+  return ENOTSUP;
+}
+
+static void wt_async_destroy(struct wt_callback *cb) {}
+#endif /* HAVE_SYS_EPOLL_H */
+
 static int wt_send_message(const char *key, const char *value, cdtime_t time,
                            struct wt_callback *cb, const char *host,
                            meta_data_t *md) {
@@ -514,9 +1500,21 @@ static int wt_send_message(const char *key, const char *value, cdtime_t time,
 
   pthread_mutex_lock(&cb->send_lock);
 
+  /* The replay thread is started here rather than at configuration time,
+   * because threads do not survive the daemon forking into the background. */
+  if ((cb->spool != NULL) && !cb->spool_replay_started) {
+    spool_replay_start(cb->spool, wt_spool_send, cb);
+    cb->spool_replay_started = 1;
+  }
+
   if (cb->sock_fd < 0) {
     status = wt_callback_init(cb);
-    if (status != 0) {
+    if ((status != 0) && (cb->spool != NULL)) {
+      /* Keep the message until the backend is reachable again. */
+      status = spool_append(cb->spool, message, message_len);
+      pthread_mutex_unlock(&cb->send_lock);
+      return status;
+    } else if (status != 0) {
       if (status != -EAGAIN)
         ERROR("write_tsdb plugin: wt_callback_init failed.");
       pthread_mutex_unlock(&cb->send_lock);
@@ -553,7 +1551,7 @@ static int wt_send_message(const char *key, const char *value, cdtime_t time,
 
 static int wt_write_messages(const data_set_t *ds, const value_list_t *vl,
                              struct wt_callback *cb) {
-  char key[10 * DATA_MAX_NAME_LEN];
+  char key[WT_NAME_SIZE];
   char values[512];
 
   int status;
@@ -565,19 +1563,12 @@ static int wt_write_messages(const data_set_t *ds, const value_list_t *vl,
   }
 
   for (size_t i = 0; i < ds->ds_num; i++) {
-    const char *ds_name = NULL;
-
-    if (cb->always_append_ds || (ds->ds_num > 1))
-      ds_name = ds->ds[i].name;
-
     /* Copy the identifier to 'key' and escape it. */
-    status = wt_format_name(key, sizeof(key), vl, cb, ds_name);
-    if (status != 0) {
+    status = wt_format_key(key, sizeof(key), ds, vl, i, cb);
+    if (status < 0) {
       ERROR("write_tsdb plugin: error with format_name");
       return status;
     }
-
-    escape_string(key, sizeof(key));
     /* Convert the values to an ASCII representation and put that into
      * 'values'. */
     status =
@@ -612,6 +1603,9 @@ static int wt_write(const data_set_t *ds, const value_list_t *vl,
 
   cb = user_data->data;
 
+  if (cb->async != NULL)
+    return wt_async_write(ds, vl, cb);
+
   status = wt_write_messages(ds, vl, cb);
 
   return status;
@@ -620,6 +1614,7 @@ static int wt_write(const data_set_t *ds, const value_list_t *vl,
 static int wt_config_tsd(oconfig_item_t *ci) {
   struct wt_callback *cb;
   char callback_name[DATA_MAX_NAME_LEN];
+  int status = 0;
 
   cb = calloc(1, sizeof(*cb));
   if (cb == NULL) {
@@ -631,6 +1626,11 @@ static int wt_config_tsd(oconfig_item_t *ci) {
   cb->next_random_ttl = new_random_ttl();
   cb->connect_interval = DEFAULT_CONNECT_INTERVAL;
   cb->last_connect_timestamp = 0;
+  cb->spool_opts = (spool_options_t)SPOOL_OPTIONS_INIT;
+  cb->spool_opts.replay_rate = WT_DEFAULT_SPOOL_REPLAY_RATE;
+  cb->buffer_size = WT_DEFAULT_BUFFER_SIZE;
+  cb->connections = 1;
+  cb->names_size = NAME_CACHE_DEFAULT_SIZE;
 
   pthread_mutex_init(&cb->send_lock, NULL);
 
@@ -649,11 +1649,97 @@ static int wt_config_tsd(oconfig_item_t *ci) {
       cf_util_get_boolean(child, &cb->derive_rate);
     else if (strcasecmp("AlwaysAppendDS", child->key) == 0)
       cf_util_get_boolean(child, &cb->always_append_ds);
-    else {
+    else if (strcasecmp("AsyncSend", child->key) == 0)
+      cf_util_get_boolean(child, &cb->async_send);
+    else if (strcasecmp("BufferSize", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp > 0))
+        cb->buffer_size = (size_t)tmp;
+      else {
+        ERROR("write_tsdb plugin: \"BufferSize\" must be a positive number "
+              "of bytes.");
+        status = -1;
+      }
+    } else if (strcasecmp("Connections", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp > 0))
+        cb->connections = (size_t)tmp;
+      else {
+        ERROR("write_tsdb plugin: \"Connections\" must be a positive "
+              "number.");
+        status = -1;
+      }
+    } else if (strcasecmp("SpoolDirectory", child->key) == 0)
+      cf_util_get_string(child, &cb->spool_dir);
+    else if (strcasecmp("SpoolMaxSize", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp > 0))
+        cb->spool_opts.max_size = ((uint64_t)tmp) * 1048576;
+      else {
+        ERROR("write_tsdb plugin: \"SpoolMaxSize\" must be a positive "
+              "number of megabytes.");
+        status = -1;
+      }
+    } else if (strcasecmp("SpoolReplayRate", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp >= 0))
+        cb->spool_opts.replay_rate = (uint64_t)tmp;
+      else {
+        ERROR("write_tsdb plugin: \"SpoolReplayRate\" must be a "
+              "non-negative number of bytes per second.");
+        status = -1;
+      }
+    } else if (strcasecmp("NameCacheSize", child->key) == 0) {
+      int tmp = 0;
+      status = cf_util_get_int(child, &tmp);
+      if ((status == 0) && (tmp >= 0))
+        cb->names_size = (size_t)tmp;
+      else {
+        ERROR("write_tsdb plugin: \"NameCacheSize\" must be a "
+              "non-negative number of metrics.");
+        status = -1;
+      }
+    } else {
       ERROR("write_tsdb plugin: Invalid configuration "
             "option: %s.",
             child->key);
     }
+
+    if (status != 0)
+      break;
+  }
+
+  if (status != 0) {
+    wt_callback_free(cb);
+    return status;
+  }
+
+  if (cb->names_size > 0)
+    cb->names = name_cache_create(cb->names_size);
+
+  if (cb->spool_dir != NULL) {
+    cb->spool = spool_create(cb->spool_dir, &cb->spool_opts);
+    if (cb->spool == NULL)
+      ERROR("write_tsdb plugin: Opening the spool in \"%s\" failed. Values "
+            "will be dropped while %s:%s is unreachable.",
+            cb->spool_dir, cb->node != NULL ? cb->node : WT_DEFAULT_NODE,
+            cb->service != NULL ? cb->service : WT_DEFAULT_SERVICE);
+  }
+
+  if (cb->async_send) {
+    /* The sender thread uses these for logging and resolving. */
+    if (cb->node == NULL)
+      cb->node = strdup(WT_DEFAULT_NODE);
+    if (cb->service == NULL)
+      cb->service = strdup(WT_DEFAULT_SERVICE);
+    if ((cb->node == NULL) || (cb->service == NULL) ||
+        (wt_async_create(cb) != 0))
+      ERROR("write_tsdb plugin: Asynchronous mode could not be enabled, "
+            "falling back to synchronous mode.");
   }
 
   snprintf(callback_name, sizeof(callback_name), "write_tsdb/%s/%s",
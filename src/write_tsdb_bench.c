@@ -0,0 +1,107 @@
+/**
+ * collectd - src/write_tsdb_bench.c
+ * Copyright (C) 2026       collectd contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **/
+
+/*
+ * Formats the metric names and values of BENCH_VALUES values of BENCH_SERIES
+ * series the way the write_tsdb plugin does, with and without the name cache.
+ * Build with "make bench_write_tsdb".
+ */
+
+#include "write_tsdb.c"
+
+#include <time.h>
+
+#define BENCH_VALUES 2000000
+#define BENCH_SERIES 10000
+
+static double cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+static data_source_t dsrc[] = {{"value", DS_TYPE_GAUGE, 0.0, NAN}};
+static data_set_t ds = {"gauge", STATIC_ARRAY_SIZE(dsrc), dsrc};
+
+static value_list_t *series;
+
+static double bench_run(char const *name, size_t cache_size,
+                        double baseline) {
+  struct wt_callback cb = {.names_size = cache_size};
+  char key[WT_NAME_SIZE];
+  char values[512];
+  size_t bytes = 0;
+
+  if (cache_size > 0)
+    cb.names = name_cache_create(cache_size);
+
+  double start = cpu_time();
+  for (size_t i = 0; i < BENCH_VALUES; i++) {
+    value_list_t *vl = series + (i % BENCH_SERIES);
+    vl->values[0].gauge = (gauge_t)i;
+
+    int status = wt_format_key(key, sizeof(key), &ds, vl, 0, &cb);
+    if ((status < 0) ||
+        (wt_format_values(values, sizeof(values), 0, &ds, vl, 0, 0) != 0))
+      exit(1);
+    bytes += (size_t)status + strlen(values);
+  }
+  double elapsed = cpu_time() - start;
+
+  name_cache_destroy(cb.names);
+
+  printf("%-16s %7.3f s, %9.0f values/s, %5.0f ns/value", name, elapsed,
+         BENCH_VALUES / elapsed, 1e9 * elapsed / BENCH_VALUES);
+  if (baseline > 0)
+    printf(" (%.1fx)", baseline / elapsed);
+  printf(", %zu bytes\n", bytes);
+  return elapsed;
+}
+
+int main(void) {
+  series = calloc(BENCH_SERIES, sizeof(*series));
+  if (series == NULL)
+    return 1;
+
+  for (size_t i = 0; i < BENCH_SERIES; i++) {
+    value_list_t *vl = series + i;
+
+    vl->values = calloc(1, sizeof(*vl->values));
+    vl->values_len = 1;
+    vl->time = TIME_T_TO_CDTIME_T(1500000000);
+    vl->interval = TIME_T_TO_CDTIME_T(10);
+    sstrncpy(vl->host, "myhost.example.com", sizeof(vl->host));
+    sstrncpy(vl->plugin, "interface", sizeof(vl->plugin));
+    snprintf(vl->plugin_instance, sizeof(vl->plugin_instance), "eth%zu",
+             i / 100);
+    sstrncpy(vl->type, "gauge", sizeof(vl->type));
+    snprintf(vl->type_instance, sizeof(vl->type_instance), "rx queue %zu",
+             i % 100);
+  }
+
+  double uncached = bench_run("uncached", 0, 0);
+  bench_run("cached", BENCH_SERIES, uncached);
+  bench_run("cache too small", BENCH_SERIES / 2, uncached);
+
+  return 0;
+}